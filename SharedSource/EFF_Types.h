@@ -41,7 +41,7 @@ static const char* const kEFFIssueTrackerURL = "https://github.com/nerrons/effer
 // The object IDs for the audio objects this driver implements.
 //
 // EFFDevice always publishes this fixed set of objects (except when EFFDevice's volume or mute
-// controls are disabled). We might need to change that at some point, but so far it hasn't caused
+// controls are disabled, or its per-app loopback stream isn't in use). We might need to change that at some point, but so far it hasn't caused
 // any problems and it makes the driver much simpler.
 
 enum
@@ -61,6 +61,8 @@ enum
     kObjectID_Stream_Input_UI_Sounds            = 10,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Stream_Output_UI_Sounds           = 11,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Volume_Output_Master_UI_Sounds    = 12,  // Belongs to kObjectID_Device_UI_Sounds
+    // EFFDevice's per-app loopback stream. See kAudioDeviceCustomPropertyAppLoopback.
+    kObjectID_Stream_Input_Apps                 = 13,  // Belongs to kObjectID_Device
 };
 
 // AudioObjectPropertyElement docs: "Elements are numbered sequentially where 0 represents the
@@ -96,7 +98,8 @@ enum
     // music player is the only client playing audio) or audible. See enum values below. This property is only
     // updated after the audible state has been different for kDeviceAudibleStateMinChangedFramesForUpdate
     // consecutive frames. (To avoid excessive CPU use if for some reason the audible state starts changing
-    // very often.)
+    // very often.) It's based on the mix from before EFFDevice's mute is applied, so muting the device doesn't
+    // make it silent.
     kAudioDeviceCustomPropertyDeviceAudibleState                      = 'daud',
     // A CFBoolean similar to kAudioDevicePropertyDeviceIsRunning except it ignores whether IO is running for
     // EFFApp. This is so EFFApp knows when it can stop doing IO to save CPU.
@@ -108,9 +111,69 @@ enum
     // will add new app volumes or replace existing ones, but there's currently no way to delete an app from
     // the internal collection.
     kAudioDeviceCustomPropertyAppVolumes                              = 'apvs',
+    // The same settings as kAudioDeviceCustomPropertyAppVolumes, but packed into a CFData, which is much cheaper
+    // to read and write than the CFArray of CFDictionaries. See EFFAppVolumesBinaryHeader for the format.
+    //
+    // When getting this property, the qualifier can be a CFNumber<SInt64> generation, in which case only the apps
+    // whose settings have changed since that generation are returned, including those changed back to the
+    // defaults. Without a qualifier, it returns the same apps as kAudioDeviceCustomPropertyAppVolumes. Either
+    // way, the header's mGeneration can be passed as the qualifier next time.
+    //
+    // Apps that were removed aren't returned as changes, so if any were removed since the qualifier's
+    // generation, the full list is returned instead and the header has kEFFAppVolumesBinaryFlagFullList set.
+    // The reader should then replace what it has rather than update it.
+    kAudioDeviceCustomPropertyAppVolumesBinary                        = 'apvb',
+    // A CFDictionary with the peak and RMS levels of the mix and of each client from the most recent IO
+    // cycle. See the dictionary keys below for more info. Read-only. Getting this property never blocks the
+    // IO thread, so it's fine to poll it at the UI's frame rate. No notifications are sent when it changes.
+    // The mix is metered after EFFDevice's mute is applied, so its levels fade to zero while the device is
+    // muted. The clients' levels aren't affected.
+    kAudioDeviceCustomPropertyLevelMeters                             = 'lvlm',
+    // A CFDictionary of timing histograms for the device's IO operations and counts of IO problems, since the
+    // driver was loaded. See the dictionary keys below for more info. Read-only. A notification is sent
+    // periodically while IO is running, after the driver logs a summary of the stats.
+    kAudioDeviceCustomPropertyIOStats                                 = 'iost',
     // A CFArray of CFBooleans indicating which of EFFDevice's controls are enabled. All controls are enabled
     // by default. This property is settable. See the array indices below for more info.
-    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct'
+    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct',
+    // Slaves the rate of EFFDevice's clock to a reference clock, normally the output device EFFApp is playing
+    // EFFDevice's audio through, so the two don't drift apart. EFFApp sets this to a CFData holding an
+    // EFFClockReferenceTimeStamp each time it gets a new timestamp from the output device, e.g. each IO cycle.
+    // Getting this property returns a CFDictionary describing the clock's state instead. See the dictionary keys
+    // below for more info. No notifications are sent when it changes.
+    kAudioDeviceCustomPropertyClockReference                          = 'clkr',
+    // A CFNumber<SInt32> holding one of the EFFLatencyProfile values, which trade CPU usage and robustness for
+    // latency. This property is settable. Like the sample rate, the new profile is applied asynchronously, after
+    // the HAL has stopped IO, so getting it straight after setting it can return the old value.
+    kAudioDeviceCustomPropertyLatencyProfile                          = 'ltcy',
+    // Records EFFDevice's output mix, the audio EFFApp plays through to the output device, to a file. Setting this
+    // property to a CFDictionary with a kEFFRecordingKey_Path starts recording to that path, stopping any recording
+    // already in progress. Setting it to a dictionary without a path stops recording. Getting it returns a
+    // CFDictionary describing the current or most recent recording. See the dictionary keys below for more info.
+    // coreaudiod is sandboxed, so the path has to be somewhere it can write to, e.g. under /tmp. No notifications
+    // are sent when it changes. Only EFFApp can set this property. Other clients get kAudioDevicePermissionsError.
+    // Like the device's input stream, the recording has EFFDevice's mute applied, so it's silent while the device
+    // is muted. (Stem recordings and the per-app loopback stream come from before the mute.)
+    kAudioDeviceCustomPropertyRecording                               = 'rcrd',
+    // Records each client's audio (normally one client per app), before its volume and pan are applied, to a
+    // separate track (stem) of one multi-channel file. Each track has as many channels as EFFDevice's stream, and the
+    // tracks are in the order the clients first played audio while recording. Set and get it like kAudioDeviceCustomPropertyRecording, with
+    // the same keys plus the kEFFStemRecordingKey_ ones. It's independent of kAudioDeviceCustomPropertyRecording,
+    // so both can record at once.
+    kAudioDeviceCustomPropertyStemRecording                           = 'stem',
+    // Adds a second input stream to EFFDevice that has a separate group of channels (a "pair") for each of up to
+    // kEFFAppLoopbackMaxPairs selected apps, so they can be processed separately with one read per IO cycle. Each pair
+    // has as many channels as EFFDevice's other streams, i.e. two by default, and carries the apps' audio after their
+    // volume and pan have been applied. The stream has one pair per dictionary in the selection and its channels follow
+    // the main input stream's.
+    //
+    // Set it to a CFArray of up to kEFFAppLoopbackMaxPairs CFDictionaries, one for each pair in order. Each selects apps
+    // by kEFFAppLoopbackKey_ProcessID or kEFFAppLoopbackKey_BundleID, and all of the clients it selects are mixed into its
+    // pair. A client selected by more than one dictionary only goes to the first. Pairs no client matches are silent.
+    // Setting it to an empty array removes the stream. Like the sample rate, the stream is added, resized and removed
+    // asynchronously, after the HAL has stopped IO. Until then, clients selected for pairs the stream doesn't have yet
+    // aren't captured. Getting it returns the selection.
+    kAudioDeviceCustomPropertyAppLoopback                             = 'aplb'
 };
 
 // The number of silent/audible frames before EFFDriver will change kAudioDeviceCustomPropertyDeviceAudibleState
@@ -142,6 +205,55 @@ enum EFFDeviceAudibleState : SInt32
 #define kEFFAppVolumesKey_ProcessID         "pid"
 // The app's bundle ID as a CFString. May be omitted if kEFFAppVolumesKey_ProcessID is present.
 #define kEFFAppVolumesKey_BundleID          "bid"
+// Optional. A CFNumber<SInt32> between 0 and kAppRampMaxFrames. The number of frames over which the volume and pan
+// position changes in the same dictionary are ramped, to avoid audible steps. 0 applies them immediately. Defaults to
+// kAppRampDefaultFrames.
+#define kEFFAppVolumesKey_RampFrames        "rfrm"
+// Optional. A CFNumber<SInt32> holding one of the EFFAppVolumeRampShape values. Only affects volume changes. Pan
+// position changes are always ramped linearly. Defaults to kEFFAppVolumeRampShapeLinear.
+#define kEFFAppVolumesKey_RampShape         "rshp"
+
+// kAudioDeviceCustomPropertyLevelMeters keys
+//
+// A CFDictionary of levels (see below) for the mix of all clients, i.e. after their relative volumes and pan
+// positions have been applied.
+#define kEFFLevelMetersKey_Mix              "mix"
+// A CFArray of CFDictionaries, one for each client that did IO in the most recent cycle. Each contains the levels
+// for that client's audio, after its relative volume and pan position have been applied, and its
+// kEFFAppVolumesKey_ProcessID and kEFFAppVolumesKey_BundleID.
+#define kEFFLevelMetersKey_Clients          "clnt"
+// The levels. Each is a CFNumber<Float32> linear amplitude (i.e. 1.0 is full scale) for the most recent IO buffer.
+#define kEFFLevelMetersKey_PeakLeft         "pkl"
+#define kEFFLevelMetersKey_PeakRight        "pkr"
+#define kEFFLevelMetersKey_RMSLeft          "rmsl"
+#define kEFFLevelMetersKey_RMSRight         "rmsr"
+
+// kAudioDeviceCustomPropertyIOStats keys
+//
+// A CFDictionary with a dictionary for each IO operation, keyed by the operation's name ("ReadInput",
+// "ProcessOutput", "ProcessMix", "WriteMix" and "IOMutexWait", which is the time spent waiting to lock the
+// device's IO mutex).
+#define kEFFIOStatsKey_Operations           "ops"
+// CFArray of CFNumber<UInt64>. The lower bound in nanoseconds of each histogram bucket.
+#define kEFFIOStatsKey_BucketBounds         "bnds"
+// CFNumber<UInt64> counts for the whole device.
+#define kEFFIOStatsKey_Cycles               "cycl"
+#define kEFFIOStatsKey_DeadlineMisses       "dlms"
+#define kEFFIOStatsKey_RingBufferOverloads  "ovld"
+#define kEFFIOStatsKey_SilentFrames         "slnc"
+// Client IO state updates requested from the IO thread that were queued for the non-real-time worker thread,
+// and those that were dropped because they wouldn't have changed the client's state.
+#define kEFFIOStatsKey_ClientIOTasksQueued  "ciot"
+#define kEFFIOStatsKey_ClientIOTasksSkipped "cios"
+// Blocks of audio dropped from recordings because writing them to disk had fallen behind. See
+// kAudioDeviceCustomPropertyRecording.
+#define kEFFIOStatsKey_RecordingDroppedBlocks "rdrp"
+// Keys in each operation's dictionary. The times are CFNumber<UInt64> nanoseconds. The histogram is a CFArray
+// of CFNumber<UInt64> counts, one for each of the buckets in kEFFIOStatsKey_BucketBounds.
+#define kEFFIOStatsKey_Count                "cnt"
+#define kEFFIOStatsKey_TotalNanos           "tot"
+#define kEFFIOStatsKey_MaxNanos             "max"
+#define kEFFIOStatsKey_Histogram            "hist"
 
 // Volume curve range for app volumes
 #define kAppRelativeVolumeMaxRawValue   100
@@ -154,6 +266,181 @@ enum EFFDeviceAudibleState : SInt32
 #define kAppPanCenterRawValue 0
 #define kAppPanRightRawValue  100
 
+// Ramp lengths for app volume and pan position changes, in frames
+#define kAppRampDefaultFrames 512
+#define kAppRampMaxFrames     65535
+
+// kEFFAppVolumesKey_RampShape values
+enum EFFAppVolumeRampShape : SInt32
+{
+    // The volume changes by the same amount each frame.
+    kEFFAppVolumeRampShapeLinear      = 0,
+    // The volume changes by the same number of dB each frame.
+    kEFFAppVolumeRampShapeExponential = 1
+};
+
+// kAudioDeviceCustomPropertyAppVolumesBinary format
+//
+// The data starts with an EFFAppVolumesBinaryHeader, followed by four arrays with one element for each of the
+// header's mNumberApps apps:
+//
+//   SInt32 process IDs, or kEFFAppVolumesBinaryNoValue if the app is only identified by its bundle ID.
+//   UInt32 bundle IDs, each the byte offset of the app's bundle ID in the string table, or
+//          kEFFAppVolumesBinaryNoBundleID if the app is only identified by its process ID.
+//   SInt32 relative volumes, as for kEFFAppVolumesKey_RelativeVolume.
+//   SInt32 pan positions, as for kEFFAppVolumesKey_PanPosition.
+//
+// and finally the string table, which is mStringTableSize bytes of null-terminated UTF-8 bundle IDs. Apps with the
+// same bundle ID share the string. All values are in native byte order.
+//
+// When setting the property, a volume or pan position of kEFFAppVolumesBinaryNoValue leaves that setting unchanged.
+#define kEFFAppVolumesBinaryFormatVersion   1
+#define kEFFAppVolumesBinaryNoValue         INT32_MIN
+#define kEFFAppVolumesBinaryNoBundleID      UINT32_MAX
+
+// Set in the header's mFlags when getting the property returns every app with non-default settings, rather than
+// just the changes since the qualifier's generation.
+#define kEFFAppVolumesBinaryFlagFullList    (1u << 0)
+
+typedef struct EFFAppVolumesBinaryHeader
+{
+    // Always kEFFAppVolumesBinaryFormatVersion.
+    UInt32  mFormatVersion;
+    UInt32  mNumberApps;
+    // When getting the property, the generation of the settings returned. Ignored when setting it.
+    UInt64  mGeneration;
+    UInt32  mStringTableSize;
+    // When setting the property, the ramp applied to every app's changes. See kEFFAppVolumesKey_RampFrames and
+    // kEFFAppVolumesKey_RampShape. Ignored when getting it.
+    UInt32  mRampFrames;
+    SInt32  mRampShape;
+    // When getting the property, kEFFAppVolumesBinaryFlag values. Ignored when setting it.
+    UInt32  mFlags;
+} EFFAppVolumesBinaryHeader;
+
+// kAudioDeviceCustomPropertyClockReference format
+//
+// When setting the property, the timestamps should come from the same clock, in order, and without large gaps between
+// them. A timestamp that isn't continuous with the previous ones, e.g. because the output device was restarted or
+// changed, makes EFFDevice start locking to the reference again and increment its zero timestamp seed.
+typedef struct EFFClockReferenceTimeStamp
+{
+    // The reference device's sample time and the host time at that sample time, e.g. from the mSampleTime and
+    // mHostTime of the output time stamp passed to its IOProc.
+    Float64 mSampleTime;
+    UInt64  mHostTime;
+    // The reference device's nominal sample rate.
+    Float64 mNominalSampleRate;
+} EFFClockReferenceTimeStamp;
+
+// kAudioDeviceCustomPropertyClockReference keys
+//
+// CFBoolean. True once EFFDevice has been given a reference timestamp.
+#define kEFFClockReferenceKey_Locked            "lckd"
+// CFNumber<Float64>. The reference's estimated actual sample rate divided by its nominal sample rate. EFFDevice's
+// clock runs at the same rate relative to its own nominal sample rate. 1.0 until it has a reference.
+#define kEFFClockReferenceKey_RateScalar        "rate"
+// CFNumber<Float64>. The number of host clock ticks per frame EFFDevice's clock is currently running at.
+#define kEFFClockReferenceKey_HostTicksPerFrame "tpf"
+// CFNumber<UInt64>. The seed of EFFDevice's zero timestamps.
+#define kEFFClockReferenceKey_Seed              "seed"
+
+// kAudioDeviceCustomPropertyLatencyProfile values
+//
+// Each profile sets the period of EFFDevice's zero timestamps and the safety offset and latency it reports. A shorter
+// period makes the HAL's view of the device's timeline more precise, which is needed for small IO buffers, but wakes the
+// HAL more often. A smaller safety offset lowers the latency through the device, but leaves less margin for late IO
+// cycles. Every profile supports IO buffers up to the largest the HAL offers. See EFF_LatencyProfile.
+enum EFFLatencyProfile : SInt32
+{
+    // Suits playback, which can use large IO buffers. Zero timestamps every 16384 frames, a 256 frame safety offset.
+    kEFFLatencyProfileStandard = 0,
+    // Zero timestamps every 1024 frames, a 64 frame safety offset.
+    kEFFLatencyProfileLow      = 1,
+    // For live monitoring, with IO buffers of 128 to 256 frames. Zero timestamps every 256 frames, a 16 frame safety
+    // offset.
+    kEFFLatencyProfileLive     = 2
+};
+
+// kAudioDeviceCustomPropertyRecording keys
+//
+// CFString. The absolute path of the file to record to. It's created, and mustn't already exist. Existing files,
+// including symlinks, are never replaced. Omitted when getting the property if nothing is being recorded.
+#define kEFFRecordingKey_Path               "path"
+// CFNumber<SInt32>. An EFFRecordingFileFormat. Optional when setting the property. WAV by default.
+#define kEFFRecordingKey_FileFormat         "ffmt"
+// CFNumber<SInt32>. An EFFRecordingSampleFormat. Optional when setting the property. Float32 by default.
+#define kEFFRecordingKey_SampleFormat       "sfmt"
+// The rest are only returned when getting the property. The counts are CFNumber<UInt64>s, kept from the most recent
+// recording until the next one starts.
+//
+// CFBoolean. True while recording.
+#define kEFFRecordingKey_IsRecording        "rec"
+// The frames written to the file so far and the bytes of audio data they took.
+#define kEFFRecordingKey_FramesWritten      "frms"
+#define kEFFRecordingKey_BytesWritten       "byts"
+// Blocks of audio the IO thread had to drop because writing to the file had fallen behind, and the frames in them.
+// Dropped frames are written as silence so the rest of the recording stays in time.
+#define kEFFRecordingKey_DroppedBlocks      "drpb"
+#define kEFFRecordingKey_DroppedFrames      "drpf"
+// CFNumber<SInt32>. If writing the file failed, the error, e.g. an errno value. Otherwise 0. Nothing more is written
+// after an error.
+#define kEFFRecordingKey_Error              "err"
+
+// kAudioDeviceCustomPropertyStemRecording keys, as well as the kAudioDeviceCustomPropertyRecording ones. For stem
+// recordings, kEFFRecordingKey_DroppedBlocks is the number of times writing the file fell so far behind that audio
+// was lost.
+//
+// CFNumber<SInt32>. The number of tracks in the file, from 1 to kEFFStemRecordingMaxTracks. Clients that start playing
+// audio after all the tracks have been taken aren't recorded. Optional when setting the property. 8 by default.
+#define kEFFStemRecordingKey_TrackCount     "trks"
+// Only returned when getting the property:
+//
+// CFArray of CFDictionaries. One for each track that's been taken, in order. See the kEFFStemTrackKey_ keys.
+#define kEFFStemRecordingKey_Tracks         "trkl"
+// CFNumber<UInt64>. The IO buffers that weren't recorded because all the tracks had been taken.
+#define kEFFStemRecordingKey_UntrackedBuffers "untb"
+
+#define kEFFStemRecordingMaxTracks          32
+#define kEFFStemRecordingDefaultTracks      8
+
+// kEFFStemRecordingKey_Tracks keys
+//
+// CFNumber<SInt32>. The track's index in the file. Its first channel is this times the channels per track.
+#define kEFFStemTrackKey_Index              "idx"
+// CFNumber<SInt32> and CFString. The process and bundle ID of the client recorded to the track. Omitted if the
+// client went away before they could be looked up. The bundle ID is also omitted if the client doesn't have one.
+#define kEFFStemTrackKey_ProcessID          "pid"
+#define kEFFStemTrackKey_BundleID           "bid"
+
+// kAudioDeviceCustomPropertyAppLoopback keys
+//
+// CFNumber<SInt32>. Selects the clients of the process with this ID.
+#define kEFFAppLoopbackKey_ProcessID        "pid"
+// CFString. Selects the clients with this bundle ID, including ones added later, e.g. if the app is relaunched.
+#define kEFFAppLoopbackKey_BundleID         "bid"
+
+#define kEFFAppLoopbackMaxPairs             16
+
+// kEFFRecordingKey_FileFormat values
+enum EFFRecordingFileFormat : SInt32
+{
+    // Switches to RF64 (EBU Tech 3306) if the file grows past 4 GiB.
+    kEFFRecordingFileFormatWAV = 0,
+    kEFFRecordingFileFormatCAF = 1,
+    // Just the interleaved little-endian samples.
+    kEFFRecordingFileFormatRaw = 2
+};
+
+// kEFFRecordingKey_SampleFormat values
+enum EFFRecordingSampleFormat : SInt32
+{
+    // The mix as it is, with nothing lost.
+    kEFFRecordingSampleFormatFloat32 = 0,
+    // Packed 24-bit integers. Three quarters of the size, but samples outside [-1, 1) are clipped.
+    kEFFRecordingSampleFormatInt24   = 1
+};
+
 // kAudioDeviceCustomPropertyEnabledOutputControls indices
 enum
 {
@@ -198,12 +485,60 @@ static const AudioObjectPropertyAddress kEFFAppVolumesAddress = {
     kAudioObjectPropertyElementMaster
 };
 
+static const AudioObjectPropertyAddress kEFFAppVolumesBinaryAddress = {
+    kAudioDeviceCustomPropertyAppVolumesBinary,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFLevelMetersAddress = {
+    kAudioDeviceCustomPropertyLevelMeters,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFIOStatsAddress = {
+    kAudioDeviceCustomPropertyIOStats,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
 static const AudioObjectPropertyAddress kEFFEnabledOutputControlsAddress = {
     kAudioDeviceCustomPropertyEnabledOutputControls,
     kAudioObjectPropertyScopeOutput,
     kAudioObjectPropertyElementMaster
 };
 
+static const AudioObjectPropertyAddress kEFFClockReferenceAddress = {
+    kAudioDeviceCustomPropertyClockReference,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFLatencyProfileAddress = {
+    kAudioDeviceCustomPropertyLatencyProfile,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFRecordingAddress = {
+    kAudioDeviceCustomPropertyRecording,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFStemRecordingAddress = {
+    kAudioDeviceCustomPropertyStemRecording,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kEFFAppLoopbackAddress = {
+    kAudioDeviceCustomPropertyAppLoopback,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
 
 #pragma mark XPC Return Codes
 
@@ -16,6 +16,7 @@
 
 // STL Includes
 #include <functional>
+#include <memory>
 #endif /* defined(__cplusplus) */
 
 // System Includes
@@ -144,6 +145,17 @@ namespace EFF_Utils
         return static_cast<T __nonnull>(v);
     }
     
+    // Runs task asynchronously on queue, like dispatch_async, but takes a lambda (or any other
+    // callable) instead of a block. Code that uses this rather than blocks can also be built by
+    // compilers without blocks support, e.g. GCC for the tests on Linux.
+    template <typename T>
+    inline void DispatchAsync(dispatch_queue_t queue, T task) {
+        dispatch_async_f(queue, new T(std::move(task)), [](void* __nullable context) {
+            std::unique_ptr<T> theTask(static_cast<T*>(context));
+            (*theTask)();
+        });
+    }
+    
     // Log (and swallow) errors returned by Mach functions. Returns false if there was an error.
     bool LogIfMachError(const char* callerName,
                         const char* errorReturnedBy,
@@ -0,0 +1,174 @@
+//
+//  EFF_AppLoopback.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_AppLoopback.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// System Includes
+#include <stddef.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+void    EFF_AppLoopback::Allocate(UInt32 inChannelsPerPair, UInt32 inPairCount, UInt32 inCapacityFrames)
+{
+    EFFAssert(inChannelsPerPair > 0, "EFF_AppLoopback::Allocate: No channels");
+    EFFAssert((inPairCount > 0) && (inPairCount <= kMaxPairs), "EFF_AppLoopback::Allocate: Bad pair count");
+
+    mChannelsPerPair = inChannelsPerPair;
+    // Clamped in case asserts are disabled.
+    mPairCount = (inPairCount == 0) ? 1 : ((inPairCount > kMaxPairs) ? UInt32(kMaxPairs) : inPairCount);
+    mRingBuffer.Allocate(GetChannelsPerFrame(), inCapacityFrames);
+
+    // Allocate everything up front so the IO thread never has to.
+    mCycleCapacityFrames = inCapacityFrames;
+    mCycleBuffer.assign(static_cast<size_t>(mCycleCapacityFrames) * GetChannelsPerFrame(), 0.0f);
+
+    mCycleSampleTime = 0;
+    mCycleFrames = 0;
+    mMixedPairs = 0;
+}
+
+void    EFF_AppLoopback::Deallocate()
+{
+    mRingBuffer.Deallocate();
+
+    mCycleBuffer.clear();
+    mCycleBuffer.shrink_to_fit();
+    mCycleCapacityFrames = 0;
+    mChannelsPerPair = 0;
+    mPairCount = 0;
+
+    mMixedPairs = 0;
+}
+
+#pragma mark IO
+
+void    EFF_AppLoopback::MixClientRT(UInt32 inPair,
+                                     const Float32* inBuffer,
+                                     UInt32 inFrames,
+                                     Float64 inSampleTime)
+{
+    if(inPair >= mPairCount || inFrames > mCycleCapacityFrames || mChannelsPerPair == 0)
+    {
+        return;
+    }
+
+    SampleTime theSampleTime = static_cast<SampleTime>(inSampleTime);
+
+    // The first client of each cycle starts a new one. Any clients mixed into the cycle buffer
+    // before are from a cycle EndCycleRT wasn't called for, so they're thrown away.
+    if((mMixedPairs == 0) || (theSampleTime != mCycleSampleTime) || (inFrames != mCycleFrames))
+    {
+        mCycleSampleTime = theSampleTime;
+        mCycleFrames = inFrames;
+        mMixedPairs = 0;
+    }
+
+    const UInt32 thePairBit = 1u << inPair;
+    WritePairRT(inPair, inBuffer, inFrames, (mMixedPairs & thePairBit) != 0);
+    mMixedPairs |= thePairBit;
+}
+
+EFF_RingBufferError EFF_AppLoopback::EndCycleRT(UInt32 inFrames, Float64 inSampleTime)
+{
+    SampleTime theSampleTime = static_cast<SampleTime>(inSampleTime);
+
+    if((mMixedPairs == 0) || (theSampleTime != mCycleSampleTime) || (inFrames != mCycleFrames))
+    {
+        // No selected clients played this cycle, so there's nothing to store. FetchRT will return
+        // silence for it.
+        mMixedPairs = 0;
+        return kEFFRingBufferError_OK;
+    }
+
+    // Silence the pairs that no clients were mixed into. Their channels still have the audio from
+    // whichever cycle last used them.
+    for(UInt32 thePair = 0; thePair < mPairCount; thePair++)
+    {
+        if((mMixedPairs & (1u << thePair)) == 0)
+        {
+            WritePairRT(thePair, nullptr, inFrames, false);
+        }
+    }
+
+    mMixedPairs = 0;
+
+    return mRingBuffer.Store(mCycleBuffer.data(), inFrames, theSampleTime);
+}
+
+EFF_RingBufferError EFF_AppLoopback::FetchRT(Float32* outBuffer,
+                                             UInt32 inFrames,
+                                             Float64 inSampleTime,
+                                             UInt32* __nullable outSilentFrames)
+const
+{
+    return mRingBuffer.Fetch(outBuffer,
+                             inFrames,
+                             static_cast<SampleTime>(inSampleTime),
+                             outSilentFrames);
+}
+
+#pragma mark Implementation
+
+void    EFF_AppLoopback::WritePairRT(UInt32 inPair,
+                                     const Float32* __nullable inSource,
+                                     UInt32 inFrames,
+                                     bool inAdd)
+{
+    const UInt32 theStride = GetChannelsPerFrame();
+    Float32* theDest = mCycleBuffer.data() + inPair * mChannelsPerPair;
+
+    if(mChannelsPerPair == 2)
+    {
+        // The common case, with a loop for each kind of write so none of them has to branch.
+        if(inSource == nullptr)
+        {
+            for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++, theDest += theStride)
+            {
+                theDest[0] = 0.0f;
+                theDest[1] = 0.0f;
+            }
+        }
+        else if(inAdd)
+        {
+            for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++, theDest += theStride)
+            {
+                theDest[0] += inSource[2 * theFrame];
+                theDest[1] += inSource[2 * theFrame + 1];
+            }
+        }
+        else
+        {
+            for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++, theDest += theStride)
+            {
+                theDest[0] = inSource[2 * theFrame];
+                theDest[1] = inSource[2 * theFrame + 1];
+            }
+        }
+
+        return;
+    }
+
+    for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++, theDest += theStride)
+    {
+        for(UInt32 theChannel = 0; theChannel < mChannelsPerPair; theChannel++)
+        {
+            Float32 theSample = (inSource == nullptr) ? 0.0f : inSource[theFrame * mChannelsPerPair + theChannel];
+            theDest[theChannel] = inAdd ? (theDest[theChannel] + theSample) : theSample;
+        }
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,137 @@
+//
+//  EFF_AppLoopback.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  The audio for EFFDevice's per-app loopback stream. See kAudioDeviceCustomPropertyAppLoopback.
+//
+//  The stream's frames have a group ("pair") of channels for each selected app, so all of the apps
+//  can be read together with a single ReadInput. Only the selected pairs are allocated, mixed,
+//  stored and fetched, so the IO thread's work grows with the selection rather than kMaxPairs. In
+//  ProcessOutput, MixClientRT
+//  mixes each selected client's audio into its pair's channels of a cycle buffer. The first client
+//  in a pair each cycle is copied rather than added, so the cycle buffer doesn't have to be cleared
+//  first. WriteMix then calls EndCycleRT, which silences the pairs no client played into and stores
+//  the cycle in a wide EFF_LoopbackRingBuffer at the cycle's output sample time, like the mix in
+//  EFF_Device::WriteOutputData. ReadInput fetches from it with FetchRT at the input sample time,
+//  again like the main input stream.
+//
+//  If no selected client plays during a cycle, nothing is stored for it and FetchRT returns silence
+//  for its frames.
+//
+//  The RT methods are real-time safe and must only be called from one thread at a time. Allocate and
+//  Deallocate must only be called while IO is stopped.
+//
+
+#ifndef EFF_AppLoopback_h
+#define EFF_AppLoopback_h
+
+// Local Includes
+#include "EFF_LoopbackRingBuffer.h"
+#include "EFF_Types.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_AppLoopback
+{
+
+public:
+    typedef EFF_LoopbackRingBuffer::SampleTime SampleTime;
+
+    static const UInt32         kMaxPairs = kEFFAppLoopbackMaxPairs;
+
+#pragma mark Construction/Destruction
+
+                                EFF_AppLoopback() = default;
+                                // Disallow copying
+                                EFF_AppLoopback(const EFF_AppLoopback&) = delete;
+                                EFF_AppLoopback& operator=(const EFF_AppLoopback&) = delete;
+
+    /*!
+     Allocate (or reallocate) the ring buffer and the cycle buffer, discarding their audio.
+
+     @param inChannelsPerPair The number of channels in each pair, i.e. in EFFDevice's other streams.
+     @param inPairCount The number of pairs, i.e. of apps selected. Between 1 and kMaxPairs.
+     @param inCapacityFrames The minimum number of frames the ring buffer can hold. Also the largest
+                             IO cycle MixClientRT and EndCycleRT accept.
+     */
+    void                        Allocate(UInt32 inChannelsPerPair, UInt32 inPairCount, UInt32 inCapacityFrames);
+    void                        Deallocate();
+
+    /*! The number of pairs passed to Allocate, or 0 if it isn't allocated. */
+    UInt32                      GetPairCount() const { return mPairCount; }
+    /*! The number of channels in the per-app loopback stream, or 0 if it isn't allocated. */
+    UInt32                      GetChannelsPerFrame() const { return mChannelsPerPair * mPairCount; }
+
+#pragma mark IO
+
+    /*!
+     Mix one client's audio for the current IO cycle into its pair. Real-time safe.
+
+     @param inPair The client's pair. See EFF_ClientIOParams::mAppLoopbackPair. Ignored if it's
+                   past the allocated pairs, which happens between a bigger selection being set and
+                   the stream being resized for it.
+     @param inBuffer Interleaved, with the number of channels per pair passed to Allocate.
+     @param inFrames The size of the IO cycle's buffer.
+     @param inSampleTime The IO cycle's output sample time.
+     */
+    void                        MixClientRT(UInt32 inPair,
+                                            const Float32* inBuffer,
+                                            UInt32 inFrames,
+                                            Float64 inSampleTime);
+    /*!
+     Store the IO cycle's audio in the ring buffer. Call it after the last MixClientRT call for the
+     cycle. Real-time safe.
+
+     @return The error from EFF_LoopbackRingBuffer::Store, if any.
+     */
+    EFF_RingBufferError         EndCycleRT(UInt32 inFrames, Float64 inSampleTime);
+    /*!
+     Copy the frames from inSampleTime into outBuffer, which has GetChannelsPerFrame() channels. See
+     EFF_LoopbackRingBuffer::Fetch. Real-time safe.
+     */
+    EFF_RingBufferError         FetchRT(Float32* outBuffer,
+                                        UInt32 inFrames,
+                                        Float64 inSampleTime,
+                                        UInt32* __nullable outSilentFrames) const;
+
+#pragma mark Implementation
+
+private:
+    // Write inFrames frames of inSource, or silence if it's null, to the pair's channels in
+    // mCycleBuffer. If inAdd is true, inSource is added to them instead.
+    void                        WritePairRT(UInt32 inPair,
+                                            const Float32* __nullable inSource,
+                                            UInt32 inFrames,
+                                            bool inAdd);
+
+    EFF_LoopbackRingBuffer      mRingBuffer;
+    // One IO cycle of the stream's frames, which the clients are mixed into.
+    std::vector<Float32>        mCycleBuffer;
+    UInt32                      mCycleCapacityFrames    = 0;
+    UInt32                      mChannelsPerPair        = 0;
+    UInt32                      mPairCount              = 0;
+
+    // The IO thread's state for the current cycle.
+    SampleTime                  mCycleSampleTime        = 0;
+    UInt32                      mCycleFrames            = 0;
+    // Bit n is set if a client has been mixed into pair n this cycle. 0 if there's no current cycle.
+    UInt32                      mMixedPairs             = 0;
+
+    static_assert(kMaxPairs <= 32, "mMixedPairs has one bit per pair");
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_AppLoopback_h */
+
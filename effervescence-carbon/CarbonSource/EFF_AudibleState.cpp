@@ -12,6 +12,9 @@
 // Self Include
 #include "EFF_AudibleState.h"
 
+// Local Includes
+#include "EFF_AudioKernels.h"
+
 // PublicUtility Includes
 #include "CADebugMacros.h"
 #pragma clang diagnostic push
@@ -54,6 +57,7 @@ noexcept
 // Update the sample times of the most recent audible music, silent music and audible non-music
 // samples we've received.
 void    EFF_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
+                                             UInt32 inChannelsPerFrame,
                                              UInt32 inIOBufferFrameSize,
                                              Float64 inOutputSampleTime,
                                              const Float32* inBuffer)
@@ -63,7 +67,7 @@ void    EFF_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
 
     if(inClientIsMusicPlayer)
     {
-        if(BufferIsAudible(inIOBufferFrameSize, inBuffer))
+        if(BufferIsAudible(inChannelsPerFrame, inIOBufferFrameSize, inBuffer))
         {
             mSampleTimes.latestAudibleMusic = std::max(mSampleTimes.latestAudibleMusic,
                                                        endFrameSampleTime);
@@ -77,7 +81,7 @@ void    EFF_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
     else if(endFrameSampleTime > mSampleTimes.latestAudibleNonMusic &&  // Don't bother checking the
                                                                         // buffer if it won't change
                                                                         // anything.
-            BufferIsAudible(inIOBufferFrameSize, inBuffer))
+            BufferIsAudible(inChannelsPerFrame, inIOBufferFrameSize, inBuffer))
     {
         mSampleTimes.latestAudibleNonMusic = std::max(mSampleTimes.latestAudibleNonMusic,
                                                       endFrameSampleTime);
@@ -86,11 +90,12 @@ void    EFF_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
 
 // Update the sample time of the most recent silent sample we've received. (The music player
 // client is not considered separate for the latest silent sample.)
-bool    EFF_AudibleState::UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
+bool    EFF_AudibleState::UpdateWithMixedIO(UInt32 inChannelsPerFrame,
+                                            UInt32 inIOBufferFrameSize,
                                             Float64 inOutputSampleTime,
                                             const Float32* inBuffer)
 {
-    bool audible = BufferIsAudible(inIOBufferFrameSize, inBuffer);
+    bool audible = BufferIsAudible(inChannelsPerFrame, inIOBufferFrameSize, inBuffer);
 
     // The sample time of the last frame we're looking at.
     Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
@@ -160,7 +165,9 @@ bool    EFF_AudibleState::RecalculateState(Float64 inEndFrameSampleTime)
 }
 
 // static
-bool    EFF_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize, const Float32* inBuffer)
+bool    EFF_AudibleState::BufferIsAudible(UInt32 inChannelsPerFrame,
+                                          UInt32 inIOBufferFrameSize,
+                                          const Float32* inBuffer)
 {
     // Check each frame to see if any are audible. This could be much more accurate, but seems to
     // work well enough for now.
@@ -174,28 +181,12 @@ bool    EFF_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize, const Floa
     // A fairly long period of silence before unpausing the music player isn't a big problem, which
     // means EFFApp can wait much longer before unpausing than before pausing. So this function errs
     // toward considering the buffer silent, which helps EFFApp ignore short sounds.
-    if(inIOBufferFrameSize > 0)
-    {
-        // Bounds for the left channel samples.
-        Float32 firstSampleLLower = inBuffer[0] - kSampleVolumeMarginRaw;
-        Float32 firstSampleLUpper = inBuffer[0] + kSampleVolumeMarginRaw;
-        // Bounds for the right channel samples.
-        Float32 firstSampleRLower = inBuffer[1] - kSampleVolumeMarginRaw;
-        Float32 firstSampleRUpper = inBuffer[1] + kSampleVolumeMarginRaw;
-
-        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2)
-        {
-            bool audibleL =
-                    (inBuffer[i] < firstSampleLLower) || (inBuffer[i] > firstSampleLUpper);
-            bool audibleR =
-                    (inBuffer[i + 1] < firstSampleRLower) || (inBuffer[i + 1] > firstSampleRUpper);
-
-            if(audibleL || audibleR)
-            {
-                return true;
-            }
-        }
-    }
-
-    return false;
+    //
+    // A frame is audible if any of its samples is outside kSampleVolumeMarginRaw of the first
+    // frame's sample for the same channel. The check returns at the first audible frame (and is
+    // vectorised for stereo), which matters because this runs for every client every cycle.
+    return EFF_AudioKernels::AnySampleOutsideFirstFrameMargin(inBuffer,
+                                                              inChannelsPerFrame,
+                                                              inIOBufferFrameSize,
+                                                              kSampleVolumeMarginRaw);
 }
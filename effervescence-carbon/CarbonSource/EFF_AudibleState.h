@@ -53,6 +53,7 @@ public:
      Real-time safe. Not thread safe.
      */
     void                        UpdateWithClientIO(bool inClientIsMusicPlayer,
+                                                   UInt32 inChannelsPerFrame,
                                                    UInt32 inIOBufferFrameSize,
                                                    Float64 inOutputSampleTime,
                                                    const Float32* inBuffer);
@@ -65,14 +66,16 @@ public:
 
      @return True if the audible state changed.
      */
-    bool                        UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
+    bool                        UpdateWithMixedIO(UInt32 inChannelsPerFrame,
+                                                  UInt32 inIOBufferFrameSize,
                                                   Float64 inOutputSampleTime,
                                                   const Float32* inBuffer);
     
 private:
     bool                        RecalculateState(Float64 inEndFrameSampleTime);
 
-    static bool                 BufferIsAudible(UInt32 inIOBufferFrameSize,
+    static bool                 BufferIsAudible(UInt32 inChannelsPerFrame,
+                                                UInt32 inIOBufferFrameSize,
                                                 const Float32* inBuffer);
 
     EFFDeviceAudibleState       mState;
@@ -0,0 +1,1048 @@
+//
+//  EFF_AudioKernels.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_AudioKernels.h"
+
+// STL Includes
+#include <algorithm>
+
+// System Includes
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__arm64__) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Stereo Matrix Implementations
+
+typedef void (*EFF_ApplyStereoMatrixFunc)(const EFF_StereoMatrix& inMatrix,
+                                          Float32* ioBuffer,
+                                          UInt32 inFrameCount);
+
+// The vector versions process as many whole vectors of frames as they can and then pass the
+// remaining frames to a narrower version.
+//
+// The AVX2 versions call _mm256_zeroupper before passing frames to the SSE versions. Clang would
+// insert it anyway, but GCC doesn't in functions that only enable AVX2 through a target attribute,
+// and running SSE code with the upper halves of the YMM registers dirty is very slow.
+
+template <bool kClip>
+static void ApplyStereoMatrix_Scalar(const EFF_StereoMatrix& inMatrix,
+                                     Float32* ioBuffer,
+                                     UInt32 inFrameCount)
+{
+    for(UInt32 i = 0; i < inFrameCount * 2; i += 2)
+    {
+        Float32 L = ioBuffer[i];
+        Float32 R = ioBuffer[i + 1];
+
+        Float32 theNewL = inMatrix.mLL * L + inMatrix.mRL * R;
+        Float32 theNewR = inMatrix.mLR * L + inMatrix.mRR * R;
+
+        if(kClip)
+        {
+            // Clamp to [-1, 1]. (Written this way rather than with std::min/std::max so the
+            // compiler can vectorise it.)
+            theNewL = theNewL < -1.0f ? -1.0f : theNewL;
+            theNewL = theNewL > 1.0f ? 1.0f : theNewL;
+            theNewR = theNewR < -1.0f ? -1.0f : theNewR;
+            theNewR = theNewR > 1.0f ? 1.0f : theNewR;
+        }
+
+        ioBuffer[i] = theNewL;
+        ioBuffer[i + 1] = theNewR;
+    }
+}
+
+#if defined(__x86_64__)
+
+// The vector versions all work the same way. For a vector of interleaved frames v = [L0 R0 L1 R1 ...]
+// we make a copy with each frame's channels swapped, s = [R0 L0 R1 L1 ...]. Then the output is
+//     v * [LL RR LL RR ...] + s * [RL LR RL LR ...]
+// which is the matrix applied to every frame at once.
+
+// SSE2 is always available on x86-64.
+template <bool kClip>
+static void ApplyStereoMatrix_SSE(const EFF_StereoMatrix& inMatrix,
+                                  Float32* ioBuffer,
+                                  UInt32 inFrameCount)
+{
+    const __m128 theSameChannelCoeffs = _mm_setr_ps(inMatrix.mLL, inMatrix.mRR, inMatrix.mLL, inMatrix.mRR);
+    const __m128 theOtherChannelCoeffs = _mm_setr_ps(inMatrix.mRL, inMatrix.mLR, inMatrix.mRL, inMatrix.mLR);
+    const __m128 theMin = _mm_set1_ps(-1.0f);
+    const __m128 theMax = _mm_set1_ps(1.0f);
+
+    // 2 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~1u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 4)
+    {
+        __m128 theFrames = _mm_loadu_ps(ioBuffer + i);
+        __m128 theSwapped = _mm_shuffle_ps(theFrames, theFrames, _MM_SHUFFLE(2, 3, 0, 1));
+
+        __m128 theOut = _mm_add_ps(_mm_mul_ps(theFrames, theSameChannelCoeffs),
+                                   _mm_mul_ps(theSwapped, theOtherChannelCoeffs));
+
+        if(kClip)
+        {
+            theOut = _mm_min_ps(_mm_max_ps(theOut, theMin), theMax);
+        }
+
+        _mm_storeu_ps(ioBuffer + i, theOut);
+    }
+
+    ApplyStereoMatrix_Scalar<kClip>(inMatrix, ioBuffer + theVectorFrames * 2, inFrameCount - theVectorFrames);
+}
+
+template <bool kClip>
+__attribute__((target("avx2")))
+static void ApplyStereoMatrix_AVX2(const EFF_StereoMatrix& inMatrix,
+                                   Float32* ioBuffer,
+                                   UInt32 inFrameCount)
+{
+    const __m256 theSameChannelCoeffs = _mm256_setr_ps(inMatrix.mLL, inMatrix.mRR, inMatrix.mLL, inMatrix.mRR,
+                                                       inMatrix.mLL, inMatrix.mRR, inMatrix.mLL, inMatrix.mRR);
+    const __m256 theOtherChannelCoeffs = _mm256_setr_ps(inMatrix.mRL, inMatrix.mLR, inMatrix.mRL, inMatrix.mLR,
+                                                        inMatrix.mRL, inMatrix.mLR, inMatrix.mRL, inMatrix.mLR);
+    const __m256 theMin = _mm256_set1_ps(-1.0f);
+    const __m256 theMax = _mm256_set1_ps(1.0f);
+
+    // 4 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 8)
+    {
+        __m256 theFrames = _mm256_loadu_ps(ioBuffer + i);
+        __m256 theSwapped = _mm256_permute_ps(theFrames, _MM_SHUFFLE(2, 3, 0, 1));
+
+        __m256 theOut = _mm256_add_ps(_mm256_mul_ps(theFrames, theSameChannelCoeffs),
+                                      _mm256_mul_ps(theSwapped, theOtherChannelCoeffs));
+
+        if(kClip)
+        {
+            theOut = _mm256_min_ps(_mm256_max_ps(theOut, theMin), theMax);
+        }
+
+        _mm256_storeu_ps(ioBuffer + i, theOut);
+    }
+
+    _mm256_zeroupper();
+
+    // Finish off with SSE, which will in turn leave at most one frame for the scalar version.
+    ApplyStereoMatrix_SSE<kClip>(inMatrix, ioBuffer + theVectorFrames * 2, inFrameCount - theVectorFrames);
+}
+
+#elif defined(__arm64__) || defined(__aarch64__)
+
+// See the comment above ApplyStereoMatrix_SSE. NEON is always available on arm64.
+template <bool kClip>
+static void ApplyStereoMatrix_NEON(const EFF_StereoMatrix& inMatrix,
+                                   Float32* ioBuffer,
+                                   UInt32 inFrameCount)
+{
+    const float32x4_t theSameChannelCoeffs = { inMatrix.mLL, inMatrix.mRR, inMatrix.mLL, inMatrix.mRR };
+    const float32x4_t theOtherChannelCoeffs = { inMatrix.mRL, inMatrix.mLR, inMatrix.mRL, inMatrix.mLR };
+    const float32x4_t theMin = vdupq_n_f32(-1.0f);
+    const float32x4_t theMax = vdupq_n_f32(1.0f);
+
+    // 2 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~1u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 4)
+    {
+        float32x4_t theFrames = vld1q_f32(ioBuffer + i);
+        // Swaps the two floats in each 64-bit half, i.e. the channels in each frame.
+        float32x4_t theSwapped = vrev64q_f32(theFrames);
+
+        float32x4_t theOut = vaddq_f32(vmulq_f32(theFrames, theSameChannelCoeffs),
+                                       vmulq_f32(theSwapped, theOtherChannelCoeffs));
+
+        if(kClip)
+        {
+            theOut = vminq_f32(vmaxq_f32(theOut, theMin), theMax);
+        }
+
+        vst1q_f32(ioBuffer + i, theOut);
+    }
+
+    ApplyStereoMatrix_Scalar<kClip>(inMatrix, ioBuffer + theVectorFrames * 2, inFrameCount - theVectorFrames);
+}
+
+#endif
+
+#pragma mark Gain Implementations
+
+typedef void (*EFF_ApplyGainFunc)(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount);
+
+// The ramp versions apply the gain for frame i, inStartGain + inStep * (i + 1), to frames
+// [inFirstFrame, inEndFrame) of ioBuffer. Each frame's gain is computed from the start rather than
+// by accumulating the steps, so the vector and scalar versions give the same results and errors
+// don't build up.
+typedef void (*EFF_ApplyStereoGainRampFunc)(Float32 inStartGain,
+                                            Float32 inStep,
+                                            Float32* ioBuffer,
+                                            UInt32 inFirstFrame,
+                                            UInt32 inEndFrame);
+
+static void ApplyGain_Scalar(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    for(UInt32 i = 0; i < inSampleCount; i++)
+    {
+        ioBuffer[i] *= inGain;
+    }
+}
+
+static void ApplyStereoGainRamp_Scalar(Float32 inStartGain,
+                                       Float32 inStep,
+                                       Float32* ioBuffer,
+                                       UInt32 inFirstFrame,
+                                       UInt32 inEndFrame)
+{
+    for(UInt32 i = inFirstFrame; i < inEndFrame; i++)
+    {
+        const Float32 theGain = inStartGain + inStep * static_cast<Float32>(i + 1);
+
+        ioBuffer[i * 2] *= theGain;
+        ioBuffer[i * 2 + 1] *= theGain;
+    }
+}
+
+#if defined(__x86_64__)
+
+static void ApplyGain_SSE(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    const __m128 theGain = _mm_set1_ps(inGain);
+
+    UInt32 theVectorSamples = inSampleCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorSamples; i += 4)
+    {
+        _mm_storeu_ps(ioBuffer + i, _mm_mul_ps(_mm_loadu_ps(ioBuffer + i), theGain));
+    }
+
+    ApplyGain_Scalar(inGain, ioBuffer + theVectorSamples, inSampleCount - theVectorSamples);
+}
+
+__attribute__((target("avx2")))
+static void ApplyGain_AVX2(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    const __m256 theGain = _mm256_set1_ps(inGain);
+
+    UInt32 theVectorSamples = inSampleCount & ~7u;
+
+    for(UInt32 i = 0; i < theVectorSamples; i += 8)
+    {
+        _mm256_storeu_ps(ioBuffer + i, _mm256_mul_ps(_mm256_loadu_ps(ioBuffer + i), theGain));
+    }
+
+    _mm256_zeroupper();
+    ApplyGain_SSE(inGain, ioBuffer + theVectorSamples, inSampleCount - theVectorSamples);
+}
+
+// The ramp versions keep a vector of the frame numbers (plus one) for each sample, e.g.
+// [i+1 i+1 i+2 i+2] for 2 frames per vector, and compute the gains from it.
+
+static void ApplyStereoGainRamp_SSE(Float32 inStartGain,
+                                    Float32 inStep,
+                                    Float32* ioBuffer,
+                                    UInt32 inFirstFrame,
+                                    UInt32 inEndFrame)
+{
+    const __m128 theStartGain = _mm_set1_ps(inStartGain);
+    const __m128 theStep = _mm_set1_ps(inStep);
+    const __m128 theFramesPerVector = _mm_set1_ps(2.0f);
+    const Float32 theFirstFrame = static_cast<Float32>(inFirstFrame);
+    __m128 theFrameNumbers = _mm_setr_ps(theFirstFrame + 1.0f, theFirstFrame + 1.0f,
+                                         theFirstFrame + 2.0f, theFirstFrame + 2.0f);
+
+    // 2 frames per vector.
+    UInt32 theVectorEndFrame = inFirstFrame + ((inEndFrame - inFirstFrame) & ~1u);
+
+    for(UInt32 i = inFirstFrame; i < theVectorEndFrame; i += 2)
+    {
+        __m128 theGains = _mm_add_ps(theStartGain, _mm_mul_ps(theStep, theFrameNumbers));
+        _mm_storeu_ps(ioBuffer + i * 2, _mm_mul_ps(_mm_loadu_ps(ioBuffer + i * 2), theGains));
+        theFrameNumbers = _mm_add_ps(theFrameNumbers, theFramesPerVector);
+    }
+
+    ApplyStereoGainRamp_Scalar(inStartGain, inStep, ioBuffer, theVectorEndFrame, inEndFrame);
+}
+
+__attribute__((target("avx2")))
+static void ApplyStereoGainRamp_AVX2(Float32 inStartGain,
+                                     Float32 inStep,
+                                     Float32* ioBuffer,
+                                     UInt32 inFirstFrame,
+                                     UInt32 inEndFrame)
+{
+    const __m256 theStartGain = _mm256_set1_ps(inStartGain);
+    const __m256 theStep = _mm256_set1_ps(inStep);
+    const __m256 theFramesPerVector = _mm256_set1_ps(4.0f);
+    const Float32 theFirstFrame = static_cast<Float32>(inFirstFrame);
+    __m256 theFrameNumbers = _mm256_setr_ps(theFirstFrame + 1.0f, theFirstFrame + 1.0f,
+                                            theFirstFrame + 2.0f, theFirstFrame + 2.0f,
+                                            theFirstFrame + 3.0f, theFirstFrame + 3.0f,
+                                            theFirstFrame + 4.0f, theFirstFrame + 4.0f);
+
+    // 4 frames per vector.
+    UInt32 theVectorEndFrame = inFirstFrame + ((inEndFrame - inFirstFrame) & ~3u);
+
+    for(UInt32 i = inFirstFrame; i < theVectorEndFrame; i += 4)
+    {
+        __m256 theGains = _mm256_add_ps(theStartGain, _mm256_mul_ps(theStep, theFrameNumbers));
+        _mm256_storeu_ps(ioBuffer + i * 2, _mm256_mul_ps(_mm256_loadu_ps(ioBuffer + i * 2), theGains));
+        theFrameNumbers = _mm256_add_ps(theFrameNumbers, theFramesPerVector);
+    }
+
+    _mm256_zeroupper();
+    ApplyStereoGainRamp_SSE(inStartGain, inStep, ioBuffer, theVectorEndFrame, inEndFrame);
+}
+
+#elif defined(__arm64__) || defined(__aarch64__)
+
+static void ApplyGain_NEON(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    UInt32 theVectorSamples = inSampleCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorSamples; i += 4)
+    {
+        vst1q_f32(ioBuffer + i, vmulq_n_f32(vld1q_f32(ioBuffer + i), inGain));
+    }
+
+    ApplyGain_Scalar(inGain, ioBuffer + theVectorSamples, inSampleCount - theVectorSamples);
+}
+
+// See the comment above ApplyStereoGainRamp_SSE.
+static void ApplyStereoGainRamp_NEON(Float32 inStartGain,
+                                     Float32 inStep,
+                                     Float32* ioBuffer,
+                                     UInt32 inFirstFrame,
+                                     UInt32 inEndFrame)
+{
+    const float32x4_t theStartGain = vdupq_n_f32(inStartGain);
+    const float32x4_t theStep = vdupq_n_f32(inStep);
+    const float32x4_t theFramesPerVector = vdupq_n_f32(2.0f);
+    const Float32 theFirstFrame = static_cast<Float32>(inFirstFrame);
+    float32x4_t theFrameNumbers = { theFirstFrame + 1.0f, theFirstFrame + 1.0f,
+                                    theFirstFrame + 2.0f, theFirstFrame + 2.0f };
+
+    // 2 frames per vector.
+    UInt32 theVectorEndFrame = inFirstFrame + ((inEndFrame - inFirstFrame) & ~1u);
+
+    for(UInt32 i = inFirstFrame; i < theVectorEndFrame; i += 2)
+    {
+        // Multiply and add separately, rather than with vmlaq_f32, so the results match the
+        // scalar version's.
+        float32x4_t theGains = vaddq_f32(theStartGain, vmulq_f32(theStep, theFrameNumbers));
+        vst1q_f32(ioBuffer + i * 2, vmulq_f32(vld1q_f32(ioBuffer + i * 2), theGains));
+        theFrameNumbers = vaddq_f32(theFrameNumbers, theFramesPerVector);
+    }
+
+    ApplyStereoGainRamp_Scalar(inStartGain, inStep, ioBuffer, theVectorEndFrame, inEndFrame);
+}
+
+#endif
+
+#pragma mark Margin Check Implementations
+
+typedef bool (*EFF_AnySampleOutsideMarginFunc)(const Float32* inBuffer,
+                                               UInt32 inFrameCount,
+                                               const Float32 inLower[2],
+                                               const Float32 inUpper[2]);
+
+// inLower and inUpper are the bounds for the left and right channels. These all use ordered
+// comparisons, so a NaN sample is never outside the bounds.
+
+static bool AnySampleOutsideMargin_Scalar(const Float32* inBuffer,
+                                          UInt32 inFrameCount,
+                                          const Float32 inLower[2],
+                                          const Float32 inUpper[2])
+{
+    for(UInt32 i = 0; i < inFrameCount * 2; i += 2)
+    {
+        bool outsideL = (inBuffer[i] < inLower[0]) || (inBuffer[i] > inUpper[0]);
+        bool outsideR = (inBuffer[i + 1] < inLower[1]) || (inBuffer[i + 1] > inUpper[1]);
+
+        if(outsideL || outsideR)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#if defined(__x86_64__)
+
+static bool AnySampleOutsideMargin_SSE(const Float32* inBuffer,
+                                       UInt32 inFrameCount,
+                                       const Float32 inLower[2],
+                                       const Float32 inUpper[2])
+{
+    const __m128 theLower = _mm_setr_ps(inLower[0], inLower[1], inLower[0], inLower[1]);
+    const __m128 theUpper = _mm_setr_ps(inUpper[0], inUpper[1], inUpper[0], inUpper[1]);
+
+    // 2 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~1u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 4)
+    {
+        __m128 theFrames = _mm_loadu_ps(inBuffer + i);
+        __m128 theOutside = _mm_or_ps(_mm_cmplt_ps(theFrames, theLower), _mm_cmpgt_ps(theFrames, theUpper));
+
+        if(_mm_movemask_ps(theOutside) != 0)
+        {
+            return true;
+        }
+    }
+
+    return AnySampleOutsideMargin_Scalar(inBuffer + theVectorFrames * 2,
+                                         inFrameCount - theVectorFrames,
+                                         inLower,
+                                         inUpper);
+}
+
+__attribute__((target("avx2")))
+static bool AnySampleOutsideMargin_AVX2(const Float32* inBuffer,
+                                        UInt32 inFrameCount,
+                                        const Float32 inLower[2],
+                                        const Float32 inUpper[2])
+{
+    const __m256 theLower = _mm256_setr_ps(inLower[0], inLower[1], inLower[0], inLower[1],
+                                           inLower[0], inLower[1], inLower[0], inLower[1]);
+    const __m256 theUpper = _mm256_setr_ps(inUpper[0], inUpper[1], inUpper[0], inUpper[1],
+                                           inUpper[0], inUpper[1], inUpper[0], inUpper[1]);
+
+    // 4 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 8)
+    {
+        __m256 theFrames = _mm256_loadu_ps(inBuffer + i);
+        __m256 theOutside = _mm256_or_ps(_mm256_cmp_ps(theFrames, theLower, _CMP_LT_OQ),
+                                         _mm256_cmp_ps(theFrames, theUpper, _CMP_GT_OQ));
+
+        if(_mm256_movemask_ps(theOutside) != 0)
+        {
+            _mm256_zeroupper();
+            return true;
+        }
+    }
+
+    _mm256_zeroupper();
+    return AnySampleOutsideMargin_SSE(inBuffer + theVectorFrames * 2,
+                                      inFrameCount - theVectorFrames,
+                                      inLower,
+                                      inUpper);
+}
+
+#elif defined(__arm64__) || defined(__aarch64__)
+
+static bool AnySampleOutsideMargin_NEON(const Float32* inBuffer,
+                                        UInt32 inFrameCount,
+                                        const Float32 inLower[2],
+                                        const Float32 inUpper[2])
+{
+    const float32x4_t theLower = { inLower[0], inLower[1], inLower[0], inLower[1] };
+    const float32x4_t theUpper = { inUpper[0], inUpper[1], inUpper[0], inUpper[1] };
+
+    // 2 frames per vector.
+    UInt32 theVectorFrames = inFrameCount & ~1u;
+
+    for(UInt32 i = 0; i < theVectorFrames * 2; i += 4)
+    {
+        float32x4_t theFrames = vld1q_f32(inBuffer + i);
+        uint32x4_t theOutside = vorrq_u32(vcltq_f32(theFrames, theLower), vcgtq_f32(theFrames, theUpper));
+
+        if(vmaxvq_u32(theOutside) != 0)
+        {
+            return true;
+        }
+    }
+
+    return AnySampleOutsideMargin_Scalar(inBuffer + theVectorFrames * 2,
+                                         inFrameCount - theVectorFrames,
+                                         inLower,
+                                         inUpper);
+}
+
+#endif
+
+#pragma mark Dot Product Implementations
+
+typedef Float32 (*EFF_DotProductFunc)(const Float32* inA, const Float32* inB, UInt32 inCount);
+
+// The vector versions sum in a different order to the scalar version, so their results can differ
+// by rounding errors.
+
+static Float32 DotProduct_Scalar(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    Float32 theSum = 0.0f;
+
+    for(UInt32 i = 0; i < inCount; i++)
+    {
+        theSum += inA[i] * inB[i];
+    }
+
+    return theSum;
+}
+
+#if defined(__x86_64__)
+
+static inline Float32 HorizontalSum_SSE(__m128 inVector)
+{
+    __m128 theSums = _mm_add_ps(inVector, _mm_movehl_ps(inVector, inVector));
+    theSums = _mm_add_ss(theSums, _mm_shuffle_ps(theSums, theSums, 1));
+    return _mm_cvtss_f32(theSums);
+}
+
+static Float32 DotProduct_SSE(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    __m128 theSums = _mm_setzero_ps();
+
+    UInt32 theVectorCount = inCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorCount; i += 4)
+    {
+        theSums = _mm_add_ps(theSums, _mm_mul_ps(_mm_loadu_ps(inA + i), _mm_loadu_ps(inB + i)));
+    }
+
+    return HorizontalSum_SSE(theSums) +
+           DotProduct_Scalar(inA + theVectorCount, inB + theVectorCount, inCount - theVectorCount);
+}
+
+__attribute__((target("avx2")))
+static Float32 DotProduct_AVX2(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    __m256 theSums = _mm256_setzero_ps();
+
+    UInt32 theVectorCount = inCount & ~7u;
+
+    for(UInt32 i = 0; i < theVectorCount; i += 8)
+    {
+        theSums = _mm256_add_ps(theSums, _mm256_mul_ps(_mm256_loadu_ps(inA + i), _mm256_loadu_ps(inB + i)));
+    }
+
+    __m128 theHalfSums = _mm_add_ps(_mm256_castps256_ps128(theSums), _mm256_extractf128_ps(theSums, 1));
+
+    _mm256_zeroupper();
+    return HorizontalSum_SSE(theHalfSums) +
+           DotProduct_SSE(inA + theVectorCount, inB + theVectorCount, inCount - theVectorCount);
+}
+
+#elif defined(__arm64__) || defined(__aarch64__)
+
+static Float32 DotProduct_NEON(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    float32x4_t theSums = vdupq_n_f32(0.0f);
+
+    UInt32 theVectorCount = inCount & ~3u;
+
+    for(UInt32 i = 0; i < theVectorCount; i += 4)
+    {
+        theSums = vfmaq_f32(theSums, vld1q_f32(inA + i), vld1q_f32(inB + i));
+    }
+
+    return vaddvq_f32(theSums) +
+           DotProduct_Scalar(inA + theVectorCount, inB + theVectorCount, inCount - theVectorCount);
+}
+
+#endif
+
+#pragma mark Any Channel Count Implementations
+
+// These are the versions for buffers that aren't stereo. They're scalar and templated on the channel
+// count. kChannels is 0 for the generic versions, which use inChannelsPerFrame instead. Otherwise,
+// the layout is known at compile time, so the compiler can unroll the loop over each frame's
+// channels and evaluate the IsUnpairedChannel checks itself.
+
+template <bool kClip>
+static inline Float32 ClipSample(Float32 inSample)
+{
+    if(kClip)
+    {
+        inSample = inSample < -1.0f ? -1.0f : inSample;
+        inSample = inSample > 1.0f ? 1.0f : inSample;
+    }
+
+    return inSample;
+}
+
+template <bool kClip>
+static inline void ApplyPanGainMatrixToFrame(const EFF_StereoMatrix& inPair,
+                                             Float32 inUnpairedGain,
+                                             UInt32 inChannelsPerFrame,
+                                             Float32* ioFrame)
+{
+    UInt32 theChannel = 0;
+
+    while(theChannel < inChannelsPerFrame)
+    {
+        if(EFF_AudioKernels::IsUnpairedChannel(inChannelsPerFrame, theChannel))
+        {
+            ioFrame[theChannel] = ClipSample<kClip>(inUnpairedGain * ioFrame[theChannel]);
+            theChannel++;
+        }
+        else
+        {
+            Float32 L = ioFrame[theChannel];
+            Float32 R = ioFrame[theChannel + 1];
+
+            ioFrame[theChannel] = ClipSample<kClip>(inPair.mLL * L + inPair.mRL * R);
+            ioFrame[theChannel + 1] = ClipSample<kClip>(inPair.mLR * L + inPair.mRR * R);
+            theChannel += 2;
+        }
+    }
+}
+
+template <UInt32 kChannels, bool kClip>
+static void ApplyPanGainMatrix_Channels(const EFF_PanGainMatrix& inMatrix,
+                                        UInt32 inChannelsPerFrame,
+                                        Float32* ioBuffer,
+                                        UInt32 inFrameCount)
+{
+    const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelsPerFrame;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        ApplyPanGainMatrixToFrame<kClip>(inMatrix.mPair,
+                                         inMatrix.mUnpairedGain,
+                                         theChannels,
+                                         ioBuffer + i * theChannels);
+    }
+}
+
+template <bool kClip>
+static void ApplyPanGainMatrix_AnyChannels(const EFF_PanGainMatrix& inMatrix,
+                                           UInt32 inChannelsPerFrame,
+                                           Float32* ioBuffer,
+                                           UInt32 inFrameCount)
+{
+    switch(inChannelsPerFrame)
+    {
+        case 1:
+            ApplyPanGainMatrix_Channels<1, kClip>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        case 6:
+            ApplyPanGainMatrix_Channels<6, kClip>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        case 8:
+            ApplyPanGainMatrix_Channels<8, kClip>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        default:
+            ApplyPanGainMatrix_Channels<0, kClip>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+    };
+}
+
+template <UInt32 kChannels>
+static void ApplyGainRamp_Channels(Float32 inStartGain,
+                                   Float32 inStep,
+                                   UInt32 inChannelsPerFrame,
+                                   Float32* ioBuffer,
+                                   UInt32 inFrameCount)
+{
+    const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelsPerFrame;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        const Float32 theGain = inStartGain + inStep * static_cast<Float32>(i + 1);
+
+        for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+        {
+            ioBuffer[i * theChannels + theChannel] *= theGain;
+        }
+    }
+}
+
+template <UInt32 kChannels>
+static bool AnySampleOutsideMargin_Channels(const Float32* inBuffer,
+                                            UInt32 inChannelsPerFrame,
+                                            UInt32 inFrameCount,
+                                            Float32 inMargin)
+{
+    const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelsPerFrame;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+        {
+            const Float32 theSample = inBuffer[i * theChannels + theChannel];
+            const Float32 theFirstSample = inBuffer[theChannel];
+
+            if((theSample < theFirstSample - inMargin) || (theSample > theFirstSample + inMargin))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+#pragma mark Dispatch
+
+template <bool kClip>
+static EFF_ApplyStereoMatrixFunc ChooseApplyStereoMatrix()
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return ApplyStereoMatrix_AVX2<kClip>;
+    }
+
+    return ApplyStereoMatrix_SSE<kClip>;
+#elif defined(__arm64__) || defined(__aarch64__)
+    return ApplyStereoMatrix_NEON<kClip>;
+#else
+    return ApplyStereoMatrix_Scalar<kClip>;
+#endif
+}
+
+static EFF_ApplyGainFunc ChooseApplyGain()
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return ApplyGain_AVX2;
+    }
+
+    return ApplyGain_SSE;
+#elif defined(__arm64__) || defined(__aarch64__)
+    return ApplyGain_NEON;
+#else
+    return ApplyGain_Scalar;
+#endif
+}
+
+static EFF_ApplyStereoGainRampFunc ChooseApplyStereoGainRamp()
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return ApplyStereoGainRamp_AVX2;
+    }
+
+    return ApplyStereoGainRamp_SSE;
+#elif defined(__arm64__) || defined(__aarch64__)
+    return ApplyStereoGainRamp_NEON;
+#else
+    return ApplyStereoGainRamp_Scalar;
+#endif
+}
+
+static EFF_AnySampleOutsideMarginFunc ChooseAnySampleOutsideMargin()
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return AnySampleOutsideMargin_AVX2;
+    }
+
+    return AnySampleOutsideMargin_SSE;
+#elif defined(__arm64__) || defined(__aarch64__)
+    return AnySampleOutsideMargin_NEON;
+#else
+    return AnySampleOutsideMargin_Scalar;
+#endif
+}
+
+static EFF_DotProductFunc ChooseDotProduct()
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return DotProduct_AVX2;
+    }
+
+    return DotProduct_SSE;
+#elif defined(__arm64__) || defined(__aarch64__)
+    return DotProduct_NEON;
+#else
+    return DotProduct_Scalar;
+#endif
+}
+
+// Chosen when the driver is loaded rather than on first use so the IO thread never has to.
+static const EFF_ApplyStereoMatrixFunc sApplyStereoMatrix        = ChooseApplyStereoMatrix<false>();
+static const EFF_ApplyStereoMatrixFunc sApplyStereoMatrixClipped = ChooseApplyStereoMatrix<true>();
+static const EFF_ApplyGainFunc sApplyGain = ChooseApplyGain();
+static const EFF_ApplyStereoGainRampFunc sApplyStereoGainRamp = ChooseApplyStereoGainRamp();
+static const EFF_AnySampleOutsideMarginFunc sAnySampleOutsideMargin = ChooseAnySampleOutsideMargin();
+static const EFF_DotProductFunc sDotProduct = ChooseDotProduct();
+
+#pragma mark Pan Gain Matrix
+
+EFF_PanGainMatrix   EFF_AudioKernels::MakePanGainMatrix(Float32 inRelativeVolume, Float32 inPanPosition)
+{
+    EFF_PanGainMatrix theMatrix;
+    EFF_StereoMatrix& thePair = theMatrix.mPair;
+
+    // Apply balance w/ crossfeed.
+    if(inPanPosition > 0.0f)
+    {
+        // L' = L * (1 - pan)
+        // R' = R + L * pan
+        thePair.mLL = 1.0f - inPanPosition;
+        thePair.mLR = inPanPosition;
+    }
+    else if(inPanPosition < 0.0f)
+    {
+        // L' = L + R * -pan
+        // R' = R * (1 + pan)
+        thePair.mRL = -inPanPosition;
+        thePair.mRR = 1.0f + inPanPosition;
+    }
+
+    // Then the gain.
+    thePair.mLL *= inRelativeVolume;
+    thePair.mRL *= inRelativeVolume;
+    thePair.mLR *= inRelativeVolume;
+    thePair.mRR *= inRelativeVolume;
+    theMatrix.mUnpairedGain = inRelativeVolume;
+
+    return theMatrix;
+}
+
+void    EFF_AudioKernels::ApplyPanGainMatrix(const EFF_PanGainMatrix& inMatrix,
+                                             UInt32 inChannelsPerFrame,
+                                             bool inClip,
+                                             Float32* ioBuffer,
+                                             UInt32 inFrameCount)
+{
+    if(inChannelsPerFrame == 2)
+    {
+        ApplyStereoMatrix(inMatrix.mPair, inClip, ioBuffer, inFrameCount);
+    }
+    else if(inChannelsPerFrame == 1 && !inClip)
+    {
+        // Mono audio only has the unpaired channel, so this is just a gain.
+        sApplyGain(inMatrix.mUnpairedGain, ioBuffer, inFrameCount);
+    }
+    else if(inClip)
+    {
+        ApplyPanGainMatrix_AnyChannels<true>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+    }
+    else
+    {
+        ApplyPanGainMatrix_AnyChannels<false>(inMatrix, inChannelsPerFrame, ioBuffer, inFrameCount);
+    }
+}
+
+void    EFF_AudioKernels::ApplyPanGainMatrixRamp(const EFF_PanGainMatrix& inStartMatrix,
+                                                 const EFF_PanGainMatrix& inEndMatrix,
+                                                 UInt32 inChannelsPerFrame,
+                                                 bool inClip,
+                                                 Float32* ioBuffer,
+                                                 UInt32 inFrameCount)
+{
+    if(inChannelsPerFrame == 2)
+    {
+        ApplyStereoMatrixRamp(inStartMatrix.mPair, inEndMatrix.mPair, inClip, ioBuffer, inFrameCount);
+        return;
+    }
+
+    if(inFrameCount == 0)
+    {
+        return;
+    }
+
+    const Float32 theFrameCount = static_cast<Float32>(inFrameCount);
+    const EFF_StereoMatrix& theStart = inStartMatrix.mPair;
+    const EFF_StereoMatrix theStep = {
+        (inEndMatrix.mPair.mLL - theStart.mLL) / theFrameCount,
+        (inEndMatrix.mPair.mRL - theStart.mRL) / theFrameCount,
+        (inEndMatrix.mPair.mLR - theStart.mLR) / theFrameCount,
+        (inEndMatrix.mPair.mRR - theStart.mRR) / theFrameCount
+    };
+    const Float32 theUnpairedStep = (inEndMatrix.mUnpairedGain - inStartMatrix.mUnpairedGain) / theFrameCount;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        // As in ApplyStereoMatrixRamp, compute each frame's matrix from the start.
+        const Float32 theFrame = static_cast<Float32>(i + 1);
+        const EFF_StereoMatrix thePair = {
+            theStart.mLL + theStep.mLL * theFrame,
+            theStart.mRL + theStep.mRL * theFrame,
+            theStart.mLR + theStep.mLR * theFrame,
+            theStart.mRR + theStep.mRR * theFrame
+        };
+        const Float32 theUnpairedGain = inStartMatrix.mUnpairedGain + theUnpairedStep * theFrame;
+        Float32* theFrameSamples = ioBuffer + i * inChannelsPerFrame;
+
+        if(inClip)
+        {
+            ApplyPanGainMatrixToFrame<true>(thePair, theUnpairedGain, inChannelsPerFrame, theFrameSamples);
+        }
+        else
+        {
+            ApplyPanGainMatrixToFrame<false>(thePair, theUnpairedGain, inChannelsPerFrame, theFrameSamples);
+        }
+    }
+}
+
+void    EFF_AudioKernels::ApplyStereoMatrix(const EFF_StereoMatrix& inMatrix,
+                                            bool inClip,
+                                            Float32* ioBuffer,
+                                            UInt32 inFrameCount)
+{
+    (inClip ? sApplyStereoMatrixClipped : sApplyStereoMatrix)(inMatrix, ioBuffer, inFrameCount);
+}
+
+void    EFF_AudioKernels::ApplyStereoMatrixRamp(const EFF_StereoMatrix& inStartMatrix,
+                                                const EFF_StereoMatrix& inEndMatrix,
+                                                bool inClip,
+                                                Float32* ioBuffer,
+                                                UInt32 inFrameCount)
+{
+    if(inFrameCount == 0)
+    {
+        return;
+    }
+
+    const Float32 theFrameCount = static_cast<Float32>(inFrameCount);
+    const EFF_StereoMatrix theStep = {
+        (inEndMatrix.mLL - inStartMatrix.mLL) / theFrameCount,
+        (inEndMatrix.mRL - inStartMatrix.mRL) / theFrameCount,
+        (inEndMatrix.mLR - inStartMatrix.mLR) / theFrameCount,
+        (inEndMatrix.mRR - inStartMatrix.mRR) / theFrameCount
+    };
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        // Compute each frame's matrix from the start rather than accumulating the steps, so errors
+        // don't build up and the last frame gets inEndMatrix.
+        const Float32 theFrame = static_cast<Float32>(i + 1);
+        const Float32 theLL = inStartMatrix.mLL + theStep.mLL * theFrame;
+        const Float32 theRL = inStartMatrix.mRL + theStep.mRL * theFrame;
+        const Float32 theLR = inStartMatrix.mLR + theStep.mLR * theFrame;
+        const Float32 theRR = inStartMatrix.mRR + theStep.mRR * theFrame;
+
+        Float32 L = ioBuffer[i * 2];
+        Float32 R = ioBuffer[i * 2 + 1];
+
+        Float32 theNewL = theLL * L + theRL * R;
+        Float32 theNewR = theLR * L + theRR * R;
+
+        if(inClip)
+        {
+            theNewL = theNewL < -1.0f ? -1.0f : theNewL;
+            theNewL = theNewL > 1.0f ? 1.0f : theNewL;
+            theNewR = theNewR < -1.0f ? -1.0f : theNewR;
+            theNewR = theNewR > 1.0f ? 1.0f : theNewR;
+        }
+
+        ioBuffer[i * 2] = theNewL;
+        ioBuffer[i * 2 + 1] = theNewR;
+    }
+}
+
+#pragma mark Gain
+
+void    EFF_AudioKernels::ApplyGain(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    sApplyGain(inGain, ioBuffer, inSampleCount);
+}
+
+void    EFF_AudioKernels::ApplyGainRamp(Float32 inStartGain,
+                                        Float32 inEndGain,
+                                        UInt32 inChannelsPerFrame,
+                                        Float32* ioBuffer,
+                                        UInt32 inFrameCount)
+{
+    if(inFrameCount == 0)
+    {
+        return;
+    }
+
+    const Float32 theStep = (inEndGain - inStartGain) / static_cast<Float32>(inFrameCount);
+
+    switch(inChannelsPerFrame)
+    {
+        case 1:
+            ApplyGainRamp_Channels<1>(inStartGain, theStep, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        case 2:
+            sApplyStereoGainRamp(inStartGain, theStep, ioBuffer, 0, inFrameCount);
+            break;
+
+        case 6:
+            ApplyGainRamp_Channels<6>(inStartGain, theStep, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        case 8:
+            ApplyGainRamp_Channels<8>(inStartGain, theStep, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+
+        default:
+            ApplyGainRamp_Channels<0>(inStartGain, theStep, inChannelsPerFrame, ioBuffer, inFrameCount);
+            break;
+    };
+}
+
+#pragma mark Margin Check
+
+bool    EFF_AudioKernels::AnySampleOutsideFirstFrameMargin(const Float32* inBuffer,
+                                                           UInt32 inChannelsPerFrame,
+                                                           UInt32 inFrameCount,
+                                                           Float32 inMargin)
+{
+    if(inFrameCount == 0)
+    {
+        return false;
+    }
+
+    switch(inChannelsPerFrame)
+    {
+        case 1:
+            return AnySampleOutsideMargin_Channels<1>(inBuffer, inChannelsPerFrame, inFrameCount, inMargin);
+
+        case 2:
+            {
+                const Float32 theLower[2] = { inBuffer[0] - inMargin, inBuffer[1] - inMargin };
+                const Float32 theUpper[2] = { inBuffer[0] + inMargin, inBuffer[1] + inMargin };
+
+                // Audible buffers usually have a sample outside the margin in the second frame, and
+                // for that the vector versions cost more than the scalar one, particularly AVX2. So
+                // check the first couple of frames here first.
+                const UInt32 theLeadingFrames = std::min(inFrameCount, 2u);
+
+                return AnySampleOutsideMargin_Scalar(inBuffer, theLeadingFrames, theLower, theUpper) ||
+                       sAnySampleOutsideMargin(inBuffer + theLeadingFrames * 2,
+                                               inFrameCount - theLeadingFrames,
+                                               theLower,
+                                               theUpper);
+            }
+
+        case 6:
+            return AnySampleOutsideMargin_Channels<6>(inBuffer, inChannelsPerFrame, inFrameCount, inMargin);
+
+        case 8:
+            return AnySampleOutsideMargin_Channels<8>(inBuffer, inChannelsPerFrame, inFrameCount, inMargin);
+
+        default:
+            return AnySampleOutsideMargin_Channels<0>(inBuffer, inChannelsPerFrame, inFrameCount, inMargin);
+    };
+}
+
+#pragma mark Dot Product
+
+Float32 EFF_AudioKernels::DotProduct(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    return sDotProduct(inA, inB, inCount);
+}
+
+#pragma clang assume_nonnull end
@@ -0,0 +1,166 @@
+//
+//  EFF_AudioKernels.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Sample-processing loops used on the IO thread. Each kernel has a scalar version and, where it
+//  helps, SSE/AVX2 (x86-64) or NEON (arm64) versions. The fastest version the CPU supports is
+//  chosen once when the driver is loaded, so calling a kernel never has to check.
+//
+//  Buffers are interleaved, with any number of channels. The kernels that depend on the channel
+//  layout are specialised for 1, 2, 6 and 8 channels and have a generic version for the rest. The
+//  stereo versions are the vectorised ones.
+//
+//  All of these are real-time safe.
+//
+
+#ifndef EFF_AudioKernels_h
+#define EFF_AudioKernels_h
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+// A 2x2 matrix applied to each interleaved stereo frame:
+//     L' = mLL * L + mRL * R
+//     R' = mLR * L + mRR * R
+struct EFF_StereoMatrix
+{
+    Float32                     mLL = 1.0f;
+    Float32                     mRL = 0.0f;
+    Float32                     mLR = 0.0f;
+    Float32                     mRR = 1.0f;
+
+    bool                        IsIdentity() const
+                                    { return mLL == 1.0f && mRL == 0.0f && mLR == 0.0f && mRR == 1.0f; }
+};
+
+// The gain matrix for a buffer with any number of channels. It only mixes channels within each
+// left/right pair, so rather than storing the full matrix, it stores the 2x2 block applied to
+// every pair and the gain for the channels that aren't in a pair. See IsUnpairedChannel.
+struct EFF_PanGainMatrix
+{
+    EFF_StereoMatrix            mPair;
+    Float32                     mUnpairedGain = 1.0f;
+
+    bool                        IsIdentity() const { return mPair.IsIdentity() && mUnpairedGain == 1.0f; }
+};
+
+class EFF_AudioKernels
+{
+
+public:
+    /*!
+     @abstract Builds the matrix that applies a client's pan position and then its relative volume.
+     @param inRelativeVolume The gain, as in EFF_Client::mRelativeVolume.
+     @param inPanPosition The pan position in [-1, 1]. Panning to one side crossfeeds the other
+                          side's signal into it, rather than just attenuating the other side. The
+                          unpaired channels only get the relative volume.
+     @discussion Applying the matrix gives the same results as applying the pan and then the volume
+                 separately, as ApplyClientRelativeVolume used to, except for rounding and
+                 non-finite samples:
+
+                 - The volume is multiplied into the coefficients, so a sample that was computed as
+                   (L * (1 - pan)) * vol is now computed as L * ((1 - pan) * vol), and (R + L * pan)
+                   * vol as (pan * vol) * L + vol * R. Each output sample can differ by a few ulps of
+                   the larger of its two terms. If only the volume or only the pan is changed, the
+                   channel that's just scaled comes out exactly the same. EFF_AudioKernelsTests
+                   checks both against a copy of the old code.
+                 - The terms that used to be skipped are now the other channel multiplied by a zero
+                   coefficient, so an Inf or NaN in one channel of a pair now makes the other
+                   channel NaN too, unless the matrix is the identity (and isn't applied).
+     */
+    static EFF_PanGainMatrix    MakePanGainMatrix(Float32 inRelativeVolume, Float32 inPanPosition);
+
+    /*!
+     @abstract Returns true if the channel isn't part of a left/right pair, so panning doesn't
+               affect it.
+     @discussion The channels are assumed to be in the order of the device's preferred channel
+                 layout. In the 5.1 and 7.1 layouts, those are the centre and LFE channels (2 and
+                 3). Otherwise, they're paired up in order and only the last channel of an odd
+                 number is unpaired, including the only channel of a mono buffer.
+     */
+    static constexpr bool       IsUnpairedChannel(UInt32 inChannelsPerFrame, UInt32 inChannel)
+                                    {
+                                        return (inChannelsPerFrame == 6 || inChannelsPerFrame == 8) ?
+                                            (inChannel == 2 || inChannel == 3) :
+                                            (inChannelsPerFrame % 2 == 1 && inChannel == inChannelsPerFrame - 1);
+                                    }
+
+    /*!
+     @abstract Applies inMatrix to each frame of an interleaved buffer in place.
+     @param inClip If true, the output samples are also clamped to [-1, 1].
+     */
+    static void                 ApplyPanGainMatrix(const EFF_PanGainMatrix& inMatrix,
+                                                   UInt32 inChannelsPerFrame,
+                                                   bool inClip,
+                                                   Float32* ioBuffer,
+                                                   UInt32 inFrameCount);
+
+    /*!
+     @abstract Like ApplyPanGainMatrix, but moves linearly from inStartMatrix to inEndMatrix over the
+               buffer, so the last frame has inEndMatrix applied to it.
+     @discussion Only used while a parameter is ramping, so only the stereo version is specialised.
+     */
+    static void                 ApplyPanGainMatrixRamp(const EFF_PanGainMatrix& inStartMatrix,
+                                                       const EFF_PanGainMatrix& inEndMatrix,
+                                                       UInt32 inChannelsPerFrame,
+                                                       bool inClip,
+                                                       Float32* ioBuffer,
+                                                       UInt32 inFrameCount);
+
+    /*!
+     @abstract Multiplies each sample in ioBuffer by inGain in place.
+     @discussion Works for any number of channels, since every sample gets the same gain.
+     */
+    static void                 ApplyGain(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount);
+
+    /*!
+     @abstract Like ApplyGain, but moving linearly from inStartGain to inEndGain over the buffer, so
+               the last frame has inEndGain applied to it. (Approximately. It can be off by
+               rounding errors.)
+     */
+    static void                 ApplyGainRamp(Float32 inStartGain,
+                                              Float32 inEndGain,
+                                              UInt32 inChannelsPerFrame,
+                                              Float32* ioBuffer,
+                                              UInt32 inFrameCount);
+
+    /*!
+     @abstract Checks whether any sample in an interleaved buffer is more than inMargin away from
+               the sample in the same channel of the first frame.
+     @discussion Returns as soon as it finds one. NaNs are never counted as outside the margin.
+     */
+    static bool                 AnySampleOutsideFirstFrameMargin(const Float32* inBuffer,
+                                                                 UInt32 inChannelsPerFrame,
+                                                                 UInt32 inFrameCount,
+                                                                 Float32 inMargin);
+
+    /*!
+     @abstract Returns the sum of inA[i] * inB[i] for i in [0, inCount).
+     @discussion The vectorised versions add the products in a different order, so the result can
+                 differ from the scalar version's by rounding errors.
+     */
+    static Float32              DotProduct(const Float32* inA, const Float32* inB, UInt32 inCount);
+
+private:
+    // The stereo versions of ApplyPanGainMatrix and ApplyPanGainMatrixRamp.
+    static void                 ApplyStereoMatrix(const EFF_StereoMatrix& inMatrix,
+                                                  bool inClip,
+                                                  Float32* ioBuffer,
+                                                  UInt32 inFrameCount);
+    static void                 ApplyStereoMatrixRamp(const EFF_StereoMatrix& inStartMatrix,
+                                                      const EFF_StereoMatrix& inEndMatrix,
+                                                      bool inClip,
+                                                      Float32* ioBuffer,
+                                                      UInt32 inFrameCount);
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_AudioKernels_h */
@@ -0,0 +1,148 @@
+//
+//  EFF_BoundedMPSCQueue.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A fixed-size FIFO queue that any number of threads can push to and one thread pops from.
+//
+//  Each slot has a sequence number that says whether it's ready to be written or read, so pushing
+//  only takes one compare-and-swap on the write position and popping takes none. Neither ever
+//  allocates or blocks, so both are real-time safe. Pushing fails if the queue is full.
+//
+//  Values pushed by the same thread are popped in the order they were pushed. If a producer has
+//  claimed a slot but not finished writing it, the consumer sees the queue as empty from that slot
+//  on until the producer finishes.
+//
+
+#ifndef EFF_BoundedMPSCQueue_h
+#define EFF_BoundedMPSCQueue_h
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <atomic>
+
+
+#pragma clang assume_nonnull begin
+
+template <typename T, UInt32 kCapacity>
+class EFF_BoundedMPSCQueue
+{
+
+    static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                  "EFF_BoundedMPSCQueue: kCapacity must be a power of two");
+
+public:
+                                EFF_BoundedMPSCQueue();
+                                // Disallow copying
+                                EFF_BoundedMPSCQueue(const EFF_BoundedMPSCQueue&) = delete;
+                                EFF_BoundedMPSCQueue& operator=(const EFF_BoundedMPSCQueue&) = delete;
+
+    /*! Add a copy of inValue to the end of the queue. Returns false if the queue is full. Any thread. */
+    bool                        TryPush(const T& inValue);
+
+    /*! Remove the value at the front of the queue. Returns false if there isn't one. Consumer only. */
+    bool                        TryPop(T& outValue);
+
+    /*! Consumer only. */
+    bool                        IsEmpty() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<UInt64>     mSequence;
+        T                       mValue;
+    };
+
+    Slot                        mSlots[kCapacity];
+    // On separate cache lines so producers and the consumer don't slow each other down.
+    alignas(64) std::atomic<UInt64> mPushPosition   { 0 };
+    alignas(64) UInt64          mPopPosition        = 0;
+
+};
+
+#pragma mark Implementation
+
+template <typename T, UInt32 kCapacity>
+EFF_BoundedMPSCQueue<T, kCapacity>::EFF_BoundedMPSCQueue()
+{
+    // Slot i is ready for the value at position i.
+    for(UInt32 i = 0; i < kCapacity; i++)
+    {
+        mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T, UInt32 kCapacity>
+bool    EFF_BoundedMPSCQueue<T, kCapacity>::TryPush(const T& inValue)
+{
+    UInt64 thePosition = mPushPosition.load(std::memory_order_relaxed);
+
+    while(true)
+    {
+        Slot& theSlot = mSlots[thePosition & (kCapacity - 1)];
+        UInt64 theSequence = theSlot.mSequence.load(std::memory_order_acquire);
+        SInt64 theDifference = static_cast<SInt64>(theSequence - thePosition);
+
+        if(theDifference == 0)
+        {
+            // The slot is free. Try to claim it.
+            if(mPushPosition.compare_exchange_weak(thePosition,
+                                                   thePosition + 1,
+                                                   std::memory_order_relaxed))
+            {
+                theSlot.mValue = inValue;
+                // Publish the value to the consumer.
+                theSlot.mSequence.store(thePosition + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Another producer claimed it first. compare_exchange_weak has updated thePosition, so
+            // just try again.
+        }
+        else if(theDifference < 0)
+        {
+            // The consumer hasn't popped the value from the last time around, so the queue is full.
+            return false;
+        }
+        else
+        {
+            // Another producer has already filled this slot.
+            thePosition = mPushPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T, UInt32 kCapacity>
+bool    EFF_BoundedMPSCQueue<T, kCapacity>::TryPop(T& outValue)
+{
+    Slot& theSlot = mSlots[mPopPosition & (kCapacity - 1)];
+
+    if(theSlot.mSequence.load(std::memory_order_acquire) != mPopPosition + 1)
+    {
+        return false;
+    }
+
+    outValue = theSlot.mValue;
+
+    // Free the slot for whichever producer gets to it next time around.
+    theSlot.mSequence.store(mPopPosition + kCapacity, std::memory_order_release);
+    mPopPosition++;
+
+    return true;
+}
+
+template <typename T, UInt32 kCapacity>
+bool    EFF_BoundedMPSCQueue<T, kCapacity>::IsEmpty()
+const
+{
+    const Slot& theSlot = mSlots[mPopPosition & (kCapacity - 1)];
+    return theSlot.mSequence.load(std::memory_order_acquire) != mPopPosition + 1;
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_BoundedMPSCQueue_h */
@@ -0,0 +1,167 @@
+//
+//  EFF_BundleIDTable.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_BundleIDTable.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+pthread_once_t      EFF_BundleIDTable::sStaticInitializer   = PTHREAD_ONCE_INIT;
+EFF_BundleIDTable*  EFF_BundleIDTable::sInstance            = nullptr;
+
+EFF_BundleIDTable&  EFF_BundleIDTable::GetInstance()
+{
+    pthread_once(&sStaticInitializer, StaticInitializer);
+    return *sInstance;
+}
+
+void    EFF_BundleIDTable::StaticInitializer()
+{
+    sInstance = new EFF_BundleIDTable;
+}
+
+
+#pragma mark API
+
+EFF_BundleIDAtom    EFF_BundleIDTable::Intern(CFStringRef __nullable inBundleID)
+{
+    if(inBundleID == NULL)
+    {
+        return kEFFNoBundleIDAtom;
+    }
+
+    const CFHashCode theHash = CFHash(inBundleID);
+
+    CAMutex::Locker theLocker(mMutex);
+
+    size_t theSlot = FindSlot(inBundleID, theHash);
+    if(mSlots[theSlot].mAtom != kEFFNoBundleIDAtom)
+    {
+        return mSlots[theSlot].mAtom;
+    }
+
+    ThrowIf(mBundleIDs.size() >= UINT32_MAX - 1,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_BundleIDTable::Intern: Ran out of atoms");
+
+    // Store our own copy in case the caller's string is mutable. (Bundle IDs from the HAL also only
+    // stay valid until we return control to it.)
+    CACFString theBundleID(CFStringCreateCopy(kCFAllocatorDefault, inBundleID));
+    ThrowIf(!theBundleID.IsValid(),
+            CAException(kAudioHardwareUnspecifiedError),
+            "EFF_BundleIDTable::Intern: Could not copy the bundle ID");
+
+    mBundleIDs.push_back(theBundleID);
+    EFF_BundleIDAtom theAtom = static_cast<EFF_BundleIDAtom>(mBundleIDs.size());
+    mSlots[theSlot] = { theHash, theAtom };
+
+    if(mBundleIDs.size() * 2 > mSlots.size())
+    {
+        Grow();
+    }
+
+    DebugMsg("EFF_BundleIDTable::Intern: Interned %s as %u",
+             CFStringGetCStringPtr(inBundleID, kCFStringEncodingUTF8),
+             theAtom);
+
+    return theAtom;
+}
+
+EFF_BundleIDAtom    EFF_BundleIDTable::Find(CFStringRef __nullable inBundleID)
+const
+{
+    if(inBundleID == NULL)
+    {
+        return kEFFNoBundleIDAtom;
+    }
+
+    const CFHashCode theHash = CFHash(inBundleID);
+
+    CAMutex::Locker theLocker(mMutex);
+
+    return mSlots[FindSlot(inBundleID, theHash)].mAtom;
+}
+
+CACFString  EFF_BundleIDTable::GetBundleID(EFF_BundleIDAtom inAtom)
+const
+{
+    if(inAtom == kEFFNoBundleIDAtom)
+    {
+        return CACFString();
+    }
+
+    CAMutex::Locker theLocker(mMutex);
+
+    ThrowIf(inAtom > mBundleIDs.size(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_BundleIDTable::GetBundleID: Unknown atom");
+
+    return mBundleIDs[inAtom - 1];
+}
+
+
+#pragma mark Implementation
+
+size_t  EFF_BundleIDTable::FindSlot(CFStringRef inBundleID, CFHashCode inHash)
+const
+{
+    const size_t theMask = mSlots.size() - 1;
+
+    // Linear probing. The table is never more than half full, so this always reaches an empty slot.
+    for(size_t theSlot = inHash & theMask; ; theSlot = (theSlot + 1) & theMask)
+    {
+        const Slot& theCandidate = mSlots[theSlot];
+
+        if(theCandidate.mAtom == kEFFNoBundleIDAtom)
+        {
+            return theSlot;
+        }
+
+        if(theCandidate.mHash == inHash &&
+           CFEqual(mBundleIDs[theCandidate.mAtom - 1].GetCFString(), inBundleID))
+        {
+            return theSlot;
+        }
+    }
+}
+
+void    EFF_BundleIDTable::Grow()
+{
+    std::vector<Slot> theSlots(mSlots.size() * 2);
+    const size_t theMask = theSlots.size() - 1;
+
+    for(const Slot& theSlot : mSlots)
+    {
+        if(theSlot.mAtom != kEFFNoBundleIDAtom)
+        {
+            size_t theIndex = theSlot.mHash & theMask;
+
+            while(theSlots[theIndex].mAtom != kEFFNoBundleIDAtom)
+            {
+                theIndex = (theIndex + 1) & theMask;
+            }
+
+            theSlots[theIndex] = theSlot;
+        }
+    }
+
+    mSlots.swap(theSlots);
+}
+
+#pragma clang assume_nonnull end
+
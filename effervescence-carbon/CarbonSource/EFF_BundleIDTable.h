@@ -0,0 +1,118 @@
+//
+//  EFF_BundleIDTable.h
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+#ifndef EFF_BundleIDTable_h
+#define EFF_BundleIDTable_h
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAMutex.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+#include <pthread.h>
+
+
+#pragma clang assume_nonnull begin
+
+// A bundle ID interned by EFF_BundleIDTable. Two clients have the same bundle ID if and only if
+// they have the same atom.
+typedef UInt32 EFF_BundleIDAtom;
+
+// The atom of clients that don't have a bundle ID.
+static const EFF_BundleIDAtom kEFFNoBundleIDAtom = 0;
+
+//==================================================================================================
+//    EFF_BundleIDTable
+//
+//  Assigns each bundle ID we see a small integer (an atom) that stays the same for as long as the
+//  driver is loaded. Clients store the atom instead of the bundle ID string, so they can be
+//  copied, compared and used as map keys without calling into CoreFoundation. That also means
+//  real-time threads can copy them.
+//
+//  Atoms are assigned densely, starting from 1, and never reused. Bundle IDs are never removed
+//  from the table, but only client registration interns them (properties that name apps, like the
+//  music player, use Find), so it only grows when a client with a new bundle ID is added and stays
+//  small.
+//
+//  The table is a flat, open-addressed hash table of atoms keyed by the bundle IDs' CFHash values,
+//  so a lookup is usually one hash and one CFEqual, without allocating or walking a tree.
+//
+//  None of the methods are real-time safe.
+//==================================================================================================
+
+class EFF_BundleIDTable
+{
+
+#pragma mark Construction/Destruction
+
+public:
+    static EFF_BundleIDTable&   GetInstance();
+
+private:
+                                EFF_BundleIDTable() = default;
+                                // Disallow copying
+                                EFF_BundleIDTable(const EFF_BundleIDTable&) = delete;
+                                EFF_BundleIDTable& operator=(const EFF_BundleIDTable&) = delete;
+
+    static void                 StaticInitializer();
+
+
+#pragma mark API
+
+public:
+    // Returns the atom for inBundleID, assigning it a new one if it hasn't been interned yet.
+    // Returns kEFFNoBundleIDAtom if inBundleID is null.
+    EFF_BundleIDAtom            Intern(CFStringRef __nullable inBundleID);
+    // Returns the atom for inBundleID, or kEFFNoBundleIDAtom if inBundleID is null or hasn't been
+    // interned. Use this to look up bundle IDs that might not belong to any client, so they don't
+    // grow the table.
+    EFF_BundleIDAtom            Find(CFStringRef __nullable inBundleID) const;
+    // Returns the bundle ID inAtom was assigned to, or an invalid CACFString for
+    // kEFFNoBundleIDAtom.
+    CACFString                  GetBundleID(EFF_BundleIDAtom inAtom) const;
+
+
+#pragma mark Implementation
+
+private:
+    static pthread_once_t       sStaticInitializer;
+    static EFF_BundleIDTable* __nullable sInstance;
+
+    static const size_t         kInitialSlots = 64;
+
+    struct Slot
+    {
+        CFHashCode              mHash               = 0;
+        // kEFFNoBundleIDAtom if the slot is empty.
+        EFF_BundleIDAtom        mAtom               = kEFFNoBundleIDAtom;
+    };
+
+    // Returns the index of inBundleID's slot in mSlots, or of the empty slot it would go in if it
+    // hasn't been interned. Must be called with mMutex locked.
+    size_t                      FindSlot(CFStringRef inBundleID, CFHashCode inHash) const;
+    // Doubles the size of mSlots and reinserts the atoms. Must be called with mMutex locked.
+    void                        Grow();
+
+    CAMutex                     mMutex { "Bundle ID table" };
+
+    // The hash table. Its size is always a power of two and at least twice the number of atoms, so
+    // there's always an empty slot to stop at and the probe sequences stay short.
+    std::vector<Slot>           mSlots = std::vector<Slot>(kInitialSlots);
+    // The bundle IDs, indexed by atom - 1.
+    std::vector<CACFString>     mBundleIDs;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_BundleIDTable_h */
+
@@ -0,0 +1,527 @@
+//
+//  EFF_CaptureFileWriter.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_CaptureFileWriter.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Header Helpers
+
+// Both header formats are padded to this size so the audio data starts on a page boundary.
+static const UInt32 kPaddedHeaderBytes = EFF_CaptureFileWriter::kAlignmentBytes;
+
+static void PutLE16(std::vector<UInt8>& ioHeader, size_t inOffset, UInt16 inValue)
+{
+    ioHeader[inOffset]     = static_cast<UInt8>(inValue);
+    ioHeader[inOffset + 1] = static_cast<UInt8>(inValue >> 8);
+}
+
+static void PutLE32(std::vector<UInt8>& ioHeader, size_t inOffset, UInt32 inValue)
+{
+    PutLE16(ioHeader, inOffset, static_cast<UInt16>(inValue));
+    PutLE16(ioHeader, inOffset + 2, static_cast<UInt16>(inValue >> 16));
+}
+
+static void PutLE64(std::vector<UInt8>& ioHeader, size_t inOffset, UInt64 inValue)
+{
+    PutLE32(ioHeader, inOffset, static_cast<UInt32>(inValue));
+    PutLE32(ioHeader, inOffset + 4, static_cast<UInt32>(inValue >> 32));
+}
+
+static void PutBE16(std::vector<UInt8>& ioHeader, size_t inOffset, UInt16 inValue)
+{
+    ioHeader[inOffset]     = static_cast<UInt8>(inValue >> 8);
+    ioHeader[inOffset + 1] = static_cast<UInt8>(inValue);
+}
+
+static void PutBE32(std::vector<UInt8>& ioHeader, size_t inOffset, UInt32 inValue)
+{
+    PutBE16(ioHeader, inOffset, static_cast<UInt16>(inValue >> 16));
+    PutBE16(ioHeader, inOffset + 2, static_cast<UInt16>(inValue));
+}
+
+static void PutBE64(std::vector<UInt8>& ioHeader, size_t inOffset, UInt64 inValue)
+{
+    PutBE32(ioHeader, inOffset, static_cast<UInt32>(inValue >> 32));
+    PutBE32(ioHeader, inOffset + 4, static_cast<UInt32>(inValue));
+}
+
+static void Put4CC(std::vector<UInt8>& ioHeader, size_t inOffset, const char* inFourCC)
+{
+    memcpy(&ioHeader[inOffset], inFourCC, 4);
+}
+
+#pragma mark Sample Conversion
+
+// The samples are written in the host's byte order, which is little-endian on every Mac
+// coreaudiod runs on. The WAV format requires it and the CAF header says so.
+static void ConvertSamples(const Float32* inSamples,
+                           UInt32 inSampleCount,
+                           EFFRecordingSampleFormat inSampleFormat,
+                           UInt8* outBytes)
+{
+    if(inSampleFormat == kEFFRecordingSampleFormatFloat32)
+    {
+        memcpy(outBytes, inSamples, inSampleCount * sizeof(Float32));
+        return;
+    }
+
+    // Scale to 24 bits, round and clip. 1.0 itself can't be represented, so it clips to the
+    // largest positive value.
+    const Float32 kInt24Scale = 8388608.0f;
+    const Float32 kInt24Max = 8388607.0f;
+    const Float32 kInt24Min = -8388608.0f;
+
+    for(UInt32 i = 0; i < inSampleCount; i++)
+    {
+        Float32 theScaledSample = inSamples[i] * kInt24Scale;
+        theScaledSample = (theScaledSample > kInt24Max) ? kInt24Max : theScaledSample;
+        theScaledSample = (theScaledSample < kInt24Min) ? kInt24Min : theScaledSample;
+
+        const SInt32 theSample = static_cast<SInt32>(lrintf(theScaledSample));
+
+        outBytes[0] = static_cast<UInt8>(theSample);
+        outBytes[1] = static_cast<UInt8>(theSample >> 8);
+        outBytes[2] = static_cast<UInt8>(theSample >> 16);
+        outBytes += 3;
+    }
+}
+
+#pragma mark Construction/Destruction
+
+EFF_CaptureFileWriter::~EFF_CaptureFileWriter()
+{
+    EFFLogAndSwallowExceptions("EFF_CaptureFileWriter::~EFF_CaptureFileWriter", [&] {
+        Close();
+    });
+}
+
+#pragma mark File
+
+void    EFF_CaptureFileWriter::Open(const char* inPath,
+                                    EFFRecordingFileFormat inFileFormat,
+                                    EFFRecordingSampleFormat inSampleFormat,
+                                    UInt32 inChannelsPerFrame,
+                                    Float64 inSampleRate)
+{
+    Close();
+
+    ThrowIf((inFileFormat != kEFFRecordingFileFormatWAV) &&
+                (inFileFormat != kEFFRecordingFileFormatCAF) &&
+                (inFileFormat != kEFFRecordingFileFormatRaw),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_CaptureFileWriter::Open: Unknown file format");
+    ThrowIf((inSampleFormat != kEFFRecordingSampleFormatFloat32) &&
+                (inSampleFormat != kEFFRecordingSampleFormatInt24),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_CaptureFileWriter::Open: Unknown sample format");
+    // WAV stores the channel count in 16 bits and the sample rate in 32.
+    ThrowIf((inChannelsPerFrame == 0) || (inChannelsPerFrame > UINT16_MAX),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "EFF_CaptureFileWriter::Open: Unsupported number of channels");
+    ThrowIf((inSampleRate < 1.0) || (inSampleRate > UINT32_MAX),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "EFF_CaptureFileWriter::Open: Unsupported sample rate");
+    ThrowIf(inPath[0] != '/',
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_CaptureFileWriter::Open: The path isn't absolute");
+
+    void* theBuffer = nullptr;
+    int theError = posix_memalign(&theBuffer, kAlignmentBytes, kWriteChunkBytes);
+    ThrowIf(theError != 0,
+            CAException(theError),
+            "EFF_CaptureFileWriter::Open: Failed to allocate the buffer");
+
+    // O_EXCL makes open fail if anything, even a dangling symlink, is already at the path.
+    mFile = open(inPath, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+
+    if(mFile < 0)
+    {
+        theError = errno;
+        free(theBuffer);
+        LogError("EFF_CaptureFileWriter::Open: Failed to create %s: %s", inPath, strerror(theError));
+        Throw(CAException(theError));
+    }
+
+    mBuffer = static_cast<UInt8*>(theBuffer);
+    mBufferUsedBytes = 0;
+
+    mFileFormat = inFileFormat;
+    mSampleFormat = inSampleFormat;
+    mChannelsPerFrame = inChannelsPerFrame;
+    mSampleRate = inSampleRate;
+    mBytesPerSample = (inSampleFormat == kEFFRecordingSampleFormatInt24) ? 3 : sizeof(Float32);
+    mBytesPerFrame = mBytesPerSample * inChannelsPerFrame;
+    mSplitFrame.assign(mBytesPerFrame, 0);
+
+    mFileOffset = 0;
+    mFramesWritten = 0;
+    mBytesSinceSync = 0;
+
+    // The header goes through the buffer like the audio, so the first write is a full chunk too.
+    std::vector<UInt8> theHeader;
+    BuildHeader(theHeader, /* inFinal = */ false);
+
+    if(!theHeader.empty())
+    {
+        AppendToBuffer(theHeader.data(), theHeader.size());
+    }
+}
+
+void    EFF_CaptureFileWriter::Close()
+{
+    if(!IsOpen())
+    {
+        return;
+    }
+
+    OSStatus theError = 0;
+
+    try
+    {
+        // The last write is the only one that can be a partial chunk.
+        if(mBufferUsedBytes > 0)
+        {
+            WriteToFile(mBuffer, mBufferUsedBytes, mFileOffset);
+            mFileOffset += mBufferUsedBytes;
+            mBufferUsedBytes = 0;
+        }
+
+        // WAV chunks have to be an even number of bytes long, which Int24 audio might not be.
+        if((mFileFormat == kEFFRecordingFileFormatWAV) && (GetBytesWritten() % 2 != 0))
+        {
+            const UInt8 thePadByte = 0;
+            WriteToFile(&thePadByte, 1, mFileOffset);
+            mFileOffset++;
+        }
+
+        std::vector<UInt8> theHeader;
+        BuildHeader(theHeader, /* inFinal = */ true);
+
+        if(!theHeader.empty())
+        {
+            WriteToFile(theHeader.data(), static_cast<UInt32>(theHeader.size()), 0);
+        }
+
+        ThrowIf(fsync(mFile) != 0,
+                CAException(errno),
+                "EFF_CaptureFileWriter::Close: fsync failed");
+    }
+    catch(const CAException& e)
+    {
+        theError = e.GetError();
+    }
+
+    close(mFile);
+    mFile = -1;
+    FreeBuffer();
+
+    ThrowIf(theError != 0,
+            CAException(theError),
+            "EFF_CaptureFileWriter::Close: Failed to finish writing the file");
+}
+
+#pragma mark Audio
+
+void    EFF_CaptureFileWriter::WriteFrames(const Float32* inFrames, UInt32 inFrameCount)
+{
+    EFFAssert(IsOpen(), "EFF_CaptureFileWriter::WriteFrames: The file isn't open");
+
+    while(inFrameCount > 0)
+    {
+        const UInt32 theFramesThatFit = (kWriteChunkBytes - mBufferUsedBytes) / mBytesPerFrame;
+
+        if(theFramesThatFit == 0)
+        {
+            // The next frame straddles the end of the buffer, so convert it separately.
+            ConvertSamples(inFrames, mChannelsPerFrame, mSampleFormat, mSplitFrame.data());
+            AppendToBuffer(mSplitFrame.data(), mBytesPerFrame);
+
+            inFrames += mChannelsPerFrame;
+            inFrameCount--;
+            mFramesWritten++;
+        }
+        else
+        {
+            // Convert straight into the buffer.
+            const UInt32 theFrames = std::min(theFramesThatFit, inFrameCount);
+
+            ConvertSamples(inFrames,
+                           theFrames * mChannelsPerFrame,
+                           mSampleFormat,
+                           mBuffer + mBufferUsedBytes);
+            mBufferUsedBytes += theFrames * mBytesPerFrame;
+
+            if(mBufferUsedBytes == kWriteChunkBytes)
+            {
+                WriteBuffer();
+            }
+
+            inFrames += theFrames * mChannelsPerFrame;
+            inFrameCount -= theFrames;
+            mFramesWritten += theFrames;
+        }
+    }
+}
+
+void    EFF_CaptureFileWriter::WriteSilence(UInt64 inFrameCount)
+{
+    EFFAssert(IsOpen(), "EFF_CaptureFileWriter::WriteSilence: The file isn't open");
+
+    // Silence is all zero bytes in both sample formats.
+    AppendToBuffer(nullptr, inFrameCount * mBytesPerFrame);
+    mFramesWritten += inFrameCount;
+}
+
+#pragma mark Implementation
+
+void    EFF_CaptureFileWriter::AppendToBuffer(const UInt8* __nullable inBytes, UInt64 inByteCount)
+{
+    while(inByteCount > 0)
+    {
+        const UInt32 theBytes =
+                static_cast<UInt32>(std::min<UInt64>(kWriteChunkBytes - mBufferUsedBytes, inByteCount));
+
+        if(inBytes)
+        {
+            memcpy(mBuffer + mBufferUsedBytes, inBytes, theBytes);
+            inBytes += theBytes;
+        }
+        else
+        {
+            memset(mBuffer + mBufferUsedBytes, 0, theBytes);
+        }
+
+        mBufferUsedBytes += theBytes;
+        inByteCount -= theBytes;
+
+        if(mBufferUsedBytes == kWriteChunkBytes)
+        {
+            WriteBuffer();
+        }
+    }
+}
+
+void    EFF_CaptureFileWriter::WriteBuffer()
+{
+    WriteToFile(mBuffer, mBufferUsedBytes, mFileOffset);
+    mFileOffset += mBufferUsedBytes;
+    mBytesSinceSync += mBufferUsedBytes;
+    mBufferUsedBytes = 0;
+
+    // Syncing after every write would make the writer wait for the disk far more often than it
+    // needs to, but leaving it all to the OS could leave a lot of the recording unwritten if the
+    // system crashed.
+    if(mBytesSinceSync >= kSyncIntervalBytes)
+    {
+        ThrowIf(fsync(mFile) != 0,
+                CAException(errno),
+                "EFF_CaptureFileWriter::WriteBuffer: fsync failed");
+        mBytesSinceSync = 0;
+    }
+}
+
+void    EFF_CaptureFileWriter::WriteToFile(const void* inBytes, UInt32 inByteCount, UInt64 inOffset)
+{
+    const UInt8* theBytes = static_cast<const UInt8*>(inBytes);
+
+    while(inByteCount > 0)
+    {
+        ssize_t theBytesWritten = pwrite(mFile, theBytes, inByteCount, static_cast<off_t>(inOffset));
+
+        if(theBytesWritten < 0)
+        {
+            const int theError = errno;
+
+            if(theError == EINTR)
+            {
+                continue;
+            }
+
+            LogError("EFF_CaptureFileWriter::WriteToFile: Write failed: %s", strerror(theError));
+            Throw(CAException(theError));
+        }
+
+        theBytes += theBytesWritten;
+        inByteCount -= static_cast<UInt32>(theBytesWritten);
+        inOffset += static_cast<UInt64>(theBytesWritten);
+    }
+}
+
+void    EFF_CaptureFileWriter::BuildHeader(std::vector<UInt8>& outHeader, bool inFinal)
+const
+{
+    switch(mFileFormat)
+    {
+        case kEFFRecordingFileFormatWAV:
+            BuildWAVHeader(outHeader, inFinal);
+            break;
+
+        case kEFFRecordingFileFormatCAF:
+            BuildCAFHeader(outHeader, inFinal);
+            break;
+
+        case kEFFRecordingFileFormatRaw:
+            outHeader.clear();
+            break;
+    }
+}
+
+void    EFF_CaptureFileWriter::BuildWAVHeader(std::vector<UInt8>& outHeader, bool inFinal)
+const
+{
+    // RIFF/RF64, a JUNK chunk that becomes RF64's ds64 chunk if the file is too big for RIFF's
+    // 32-bit sizes, WAVE_FORMAT_EXTENSIBLE fmt, fact, a JUNK chunk to pad the header out to
+    // kPaddedHeaderBytes and the data chunk's header.
+    static const size_t kDS64Offset = 12;
+    static const size_t kFmtOffset = 48;
+    static const size_t kFactOffset = 96;
+    static const size_t kPaddingOffset = 108;
+    static const size_t kDataOffset = kPaddedHeaderBytes - 8;
+
+    // The GUID of the KSDATAFORMAT_SUBTYPE_PCM and _IEEE_FLOAT sub-formats, minus the first byte,
+    // which is the format tag.
+    static const UInt8 kSubFormatGUIDTail[15] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+    };
+
+    const UInt64 theDataBytes = GetBytesWritten();
+    const UInt64 theRIFFBytes = kPaddedHeaderBytes - 8 + theDataBytes + (theDataBytes % 2);
+    const bool theFileIsRF64 = inFinal && (theRIFFBytes > UINT32_MAX);
+
+    // 0xFFFFFFFF marks a size as unknown, or as being in the ds64 chunk.
+    const UInt32 kUnknownSize = UINT32_MAX;
+    const bool theSizesAreKnown = inFinal && !theFileIsRF64;
+
+    outHeader.assign(kPaddedHeaderBytes, 0);
+
+    Put4CC(outHeader, 0, theFileIsRF64 ? "RF64" : "RIFF");
+    PutLE32(outHeader, 4, theSizesAreKnown ? static_cast<UInt32>(theRIFFBytes) : kUnknownSize);
+    Put4CC(outHeader, 8, "WAVE");
+
+    Put4CC(outHeader, kDS64Offset, theFileIsRF64 ? "ds64" : "JUNK");
+    PutLE32(outHeader, kDS64Offset + 4, 28);
+
+    if(theFileIsRF64)
+    {
+        PutLE64(outHeader, kDS64Offset + 8, theRIFFBytes);
+        PutLE64(outHeader, kDS64Offset + 16, theDataBytes);
+        PutLE64(outHeader, kDS64Offset + 24, mFramesWritten);
+        // The table length at kDS64Offset + 32 stays 0.
+    }
+
+    const UInt16 theBitsPerSample = static_cast<UInt16>(mBytesPerSample * 8);
+
+    Put4CC(outHeader, kFmtOffset, "fmt ");
+    PutLE32(outHeader, kFmtOffset + 4, 40);
+    PutLE16(outHeader, kFmtOffset + 8, 0xFFFE);  // WAVE_FORMAT_EXTENSIBLE
+    PutLE16(outHeader, kFmtOffset + 10, static_cast<UInt16>(mChannelsPerFrame));
+    PutLE32(outHeader, kFmtOffset + 12, static_cast<UInt32>(llround(mSampleRate)));
+    PutLE32(outHeader, kFmtOffset + 16, static_cast<UInt32>(llround(mSampleRate)) * mBytesPerFrame);
+    PutLE16(outHeader, kFmtOffset + 20, static_cast<UInt16>(mBytesPerFrame));
+    PutLE16(outHeader, kFmtOffset + 22, theBitsPerSample);
+    PutLE16(outHeader, kFmtOffset + 24, 22);  // cbSize
+    PutLE16(outHeader, kFmtOffset + 26, theBitsPerSample);  // wValidBitsPerSample
+    // Front left and right for stereo. Otherwise leave the speaker positions unspecified.
+    PutLE32(outHeader, kFmtOffset + 28, (mChannelsPerFrame == 2) ? 0x3 : 0x0);
+    outHeader[kFmtOffset + 32] = (mSampleFormat == kEFFRecordingSampleFormatFloat32) ? 0x03 : 0x01;
+    memcpy(&outHeader[kFmtOffset + 33], kSubFormatGUIDTail, sizeof(kSubFormatGUIDTail));
+
+    // Only required for the float format, but harmless for integers.
+    Put4CC(outHeader, kFactOffset, "fact");
+    PutLE32(outHeader, kFactOffset + 4, 4);
+    PutLE32(outHeader,
+            kFactOffset + 8,
+            (theSizesAreKnown && (mFramesWritten <= UINT32_MAX)) ? static_cast<UInt32>(mFramesWritten) :
+                                                                    kUnknownSize);
+
+    Put4CC(outHeader, kPaddingOffset, "JUNK");
+    PutLE32(outHeader, kPaddingOffset + 4, static_cast<UInt32>(kDataOffset - kPaddingOffset - 8));
+
+    Put4CC(outHeader, kDataOffset, "data");
+    PutLE32(outHeader, kDataOffset + 4, theSizesAreKnown ? static_cast<UInt32>(theDataBytes) : kUnknownSize);
+}
+
+void    EFF_CaptureFileWriter::BuildCAFHeader(std::vector<UInt8>& outHeader, bool inFinal)
+const
+{
+    // The file header, the desc chunk, a free chunk to pad the header out to kPaddedHeaderBytes
+    // and the data chunk's header, which is followed by the data chunk's edit count. All of the
+    // fields are big-endian.
+    static const size_t kDescOffset = 8;
+    static const size_t kFreeOffset = 52;
+    static const size_t kDataOffset = kPaddedHeaderBytes - 16;
+
+    // From CoreAudioTypes.h/CAFFile.h.
+    const UInt32 kCAFLinearPCMFormatFlagIsFloat = (1 << 0);
+    const UInt32 kCAFLinearPCMFormatFlagIsLittleEndian = (1 << 1);
+
+    outHeader.assign(kPaddedHeaderBytes, 0);
+
+    Put4CC(outHeader, 0, "caff");
+    PutBE16(outHeader, 4, 1);  // mFileVersion
+    PutBE16(outHeader, 6, 0);  // mFileFlags
+
+    UInt64 theSampleRateBits;
+    static_assert(sizeof(theSampleRateBits) == sizeof(mSampleRate), "Float64 isn't 64 bits");
+    memcpy(&theSampleRateBits, &mSampleRate, sizeof(theSampleRateBits));
+
+    Put4CC(outHeader, kDescOffset, "desc");
+    PutBE64(outHeader, kDescOffset + 4, 32);
+    PutBE64(outHeader, kDescOffset + 12, theSampleRateBits);
+    Put4CC(outHeader, kDescOffset + 20, "lpcm");
+    PutBE32(outHeader,
+            kDescOffset + 24,
+            kCAFLinearPCMFormatFlagIsLittleEndian |
+                ((mSampleFormat == kEFFRecordingSampleFormatFloat32) ? kCAFLinearPCMFormatFlagIsFloat : 0));
+    PutBE32(outHeader, kDescOffset + 28, mBytesPerFrame);  // mBytesPerPacket
+    PutBE32(outHeader, kDescOffset + 32, 1);  // mFramesPerPacket
+    PutBE32(outHeader, kDescOffset + 36, mChannelsPerFrame);
+    PutBE32(outHeader, kDescOffset + 40, mBytesPerSample * 8);  // mBitsPerChannel
+
+    Put4CC(outHeader, kFreeOffset, "free");
+    PutBE64(outHeader, kFreeOffset + 4, kDataOffset - kFreeOffset - 12);
+
+    // A size of -1 means the data chunk runs to the end of the file. The size includes the edit
+    // count, which stays 0.
+    Put4CC(outHeader, kDataOffset, "data");
+    PutBE64(outHeader,
+            kDataOffset + 4,
+            inFinal ? (GetBytesWritten() + 4) : static_cast<UInt64>(-1));
+}
+
+void    EFF_CaptureFileWriter::FreeBuffer()
+{
+    free(mBuffer);
+    mBuffer = nullptr;
+    mBufferUsedBytes = 0;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,143 @@
+//
+//  EFF_CaptureFileWriter.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Writes interleaved Float32 audio to a WAV, CAF or raw file, as Float32 or packed Int24. Used by
+//  EFF_MixRecorder's writer thread, which is the only thread that calls it while recording.
+//
+//  The samples are converted into a large page-aligned buffer, which is only written to the file
+//  once it's full, so almost all of the writes are big, aligned and a whole number of pages long.
+//  The WAV and CAF headers are padded so the audio data starts on a page boundary too. The file is
+//  fsynced after every few megabytes rather than after each write.
+//
+//  The header is written with the data sizes marked as unknown (which is allowed for CAF and
+//  understood by most WAV readers), so if recording stops without Close being called, e.g.
+//  because coreaudiod crashed, the file can still be read. Close fills in the real sizes.
+//
+//  None of the methods are real-time safe.
+//
+
+#ifndef EFF_CaptureFileWriter_h
+#define EFF_CaptureFileWriter_h
+
+// Local Includes
+#include "EFF_Types.h"
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_CaptureFileWriter
+{
+
+public:
+    // The size of the buffer samples are converted into, and so of each write to the file.
+    static const UInt32         kWriteChunkBytes = 1024 * 1024;
+    // The alignment of the buffer and of the start of the audio data in the file.
+    static const UInt32         kAlignmentBytes = 4096;
+    // How much audio to write between fsyncs.
+    static const UInt64         kSyncIntervalBytes = 32 * kWriteChunkBytes;
+
+#pragma mark Construction/Destruction
+
+                                EFF_CaptureFileWriter() = default;
+                                ~EFF_CaptureFileWriter();
+                                // Disallow copying
+                                EFF_CaptureFileWriter(const EFF_CaptureFileWriter&) = delete;
+                                EFF_CaptureFileWriter& operator=(const EFF_CaptureFileWriter&) = delete;
+
+#pragma mark File
+
+    /*!
+     Create the file and write its header. Closes the file that was already open, if there was one.
+     The file is opened as coreaudiod, so it never replaces an existing file or follows a symlink.
+
+     @param inPath An absolute path to a file that doesn't exist yet.
+     @throws CAException If inPath isn't absolute or already exists (EEXIST), the file can't be
+                         created or the parameters aren't supported. The error is the errno value
+                         if a system call failed.
+     */
+    void                        Open(const char* inPath,
+                                     EFFRecordingFileFormat inFileFormat,
+                                     EFFRecordingSampleFormat inSampleFormat,
+                                     UInt32 inChannelsPerFrame,
+                                     Float64 inSampleRate);
+
+    /*!
+     Write any buffered audio, fill in the header's sizes, fsync and close the file. Does nothing
+     if the file isn't open. The file is closed even if this throws.
+
+     @throws CAException If writing fails.
+     */
+    void                        Close();
+
+    bool                        IsOpen() const { return mFile >= 0; }
+
+#pragma mark Audio
+
+    /*!
+     Append inFrames frames of interleaved Float32 audio with the number of channels passed to Open.
+
+     @throws CAException If writing fails. The file is left open so it can still be closed.
+     */
+    void                        WriteFrames(const Float32* inFrames, UInt32 inFrameCount);
+    /*! Append inFrameCount frames of silence. @throws CAException If writing fails. */
+    void                        WriteSilence(UInt64 inFrameCount);
+
+    /*! The frames appended since Open, including any still in the buffer. */
+    UInt64                      GetFramesWritten() const { return mFramesWritten; }
+    /*! The bytes of audio data those frames take in the file, not including the header. */
+    UInt64                      GetBytesWritten() const { return mFramesWritten * mBytesPerFrame; }
+
+#pragma mark Implementation
+
+private:
+    // Append inByteCount bytes to the buffer, or zeros if inBytes is null, writing the buffer to
+    // the file each time it fills.
+    void                        AppendToBuffer(const UInt8* __nullable inBytes, UInt64 inByteCount);
+    // Write the full buffer to the file, empty it and fsync if it's time to.
+    void                        WriteBuffer();
+    // Write inByteCount bytes to the file at inOffset, retrying after short writes.
+    void                        WriteToFile(const void* inBytes, UInt32 inByteCount, UInt64 inOffset);
+
+    // Build the file's header. If inFinal is false, the sizes are marked as unknown.
+    void                        BuildHeader(std::vector<UInt8>& outHeader, bool inFinal) const;
+    void                        BuildWAVHeader(std::vector<UInt8>& outHeader, bool inFinal) const;
+    void                        BuildCAFHeader(std::vector<UInt8>& outHeader, bool inFinal) const;
+
+    void                        FreeBuffer();
+
+    int                         mFile                   = -1;
+    EFFRecordingFileFormat      mFileFormat             = kEFFRecordingFileFormatWAV;
+    EFFRecordingSampleFormat    mSampleFormat           = kEFFRecordingSampleFormatFloat32;
+    UInt32                      mChannelsPerFrame       = 0;
+    Float64                     mSampleRate             = 0.0;
+    UInt32                      mBytesPerSample         = 0;
+    UInt32                      mBytesPerFrame          = 0;
+
+    // kWriteChunkBytes long and aligned to kAlignmentBytes.
+    UInt8* __nullable           mBuffer                 = nullptr;
+    UInt32                      mBufferUsedBytes        = 0;
+    // Holds one converted frame that doesn't fit in the space left in mBuffer, so it can be split
+    // across two writes.
+    std::vector<UInt8>          mSplitFrame;
+
+    // The number of bytes written to the file so far, i.e. where the next write goes.
+    UInt64                      mFileOffset             = 0;
+    UInt64                      mFramesWritten          = 0;
+    UInt64                      mBytesSinceSync         = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_CaptureFileWriter_h */
+
@@ -17,24 +17,8 @@ EFF_Client::EFF_Client(const AudioServerPlugInClientInfo* inClientInfo)
     mClientID(inClientInfo->mClientID),
     mProcessID(inClientInfo->mProcessID),
     mIsNativeEndian(inClientInfo->mIsNativeEndian),
-    mBundleID(inClientInfo->mBundleID)
+    // The bundle ID ref we were passed is only valid until our plugin returns control to the HAL, but
+    // the table keeps its own copy.
+    mBundleIDAtom(EFF_BundleIDTable::GetInstance().Intern(inClientInfo->mBundleID))
 {
-    // The bundle ID ref we were passed is only valid until our plugin returns control to the HAL, so we need to retain
-    // it. (CACFString will handle the rest of its ownership/destruction.)
-    if(inClientInfo->mBundleID != NULL)
-    {
-        CFRetain(inClientInfo->mBundleID);
-    }
-}
-
-void    EFF_Client::Copy(const EFF_Client& inClient)
-{
-    mClientID = inClient.mClientID;
-    mProcessID = inClient.mProcessID;
-    mBundleID = inClient.mBundleID;
-    mIsNativeEndian = inClient.mIsNativeEndian;
-    mDoingIO = inClient.mDoingIO;
-    mIsMusicPlayer = inClient.mIsMusicPlayer;
-    mRelativeVolume = inClient.mRelativeVolume;
-    mPanPosition = inClient.mPanPosition;
 }
@@ -9,6 +9,10 @@
 #ifndef EFF_Client_h
 #define EFF_Client_h
 
+// Local Includes
+#include "EFF_Types.h"
+#include "EFF_BundleIDTable.h"
+
 // PublicUtility Includes
 #include "CACFString.h"
 
@@ -35,24 +39,25 @@ public:
                                 EFF_Client() = default;
                                 EFF_Client(const AudioServerPlugInClientInfo* inClientInfo);
                                 ~EFF_Client() = default;
-                                EFF_Client(const EFF_Client& inClient)
-                                    { Copy(inClient); };
-                                EFF_Client& operator=(const EFF_Client& inClient)
-                                    { Copy(inClient); return *this; }
-    
-private:
-    void                        Copy(const EFF_Client& inClient);
+                                // Clients are trivially copyable, so real-time threads can copy them.
+                                EFF_Client(const EFF_Client& inClient) = default;
+                                EFF_Client& operator=(const EFF_Client& inClient) = default;
     
 
 #pragma mark Implementation
 
 public:
+    // Returns the client's bundle ID, or an invalid CACFString if it doesn't have one. Not real-time
+    // safe.
+    CACFString                  GetBundleID() const
+                                    { return EFF_BundleIDTable::GetInstance().GetBundleID(mBundleIDAtom); }
+    
     // These fields are duplicated from AudioServerPlugInClientInfo (except the mBundleID CFStringRef is
-    // wrapped in a CACFString here).
+    // interned and stored as an atom here).
     UInt32                      mClientID;
     pid_t                       mProcessID;
     Boolean                     mIsNativeEndian = true;
-    CACFString                  mBundleID;
+    EFF_BundleIDAtom            mBundleIDAtom = kEFFNoBundleIDAtom;
     
     // Becomes true when the client triggers the plugin host to call StartIO or to begin
     // kAudioServerPlugInIOOperationThread, and false again on StopIO or when
@@ -62,12 +67,25 @@ public:
     // True if EFFApp has set this client as belonging to the music player app
     bool                        mIsMusicPlayer = false;
 
+    // The pair of channels in the per-app loopback stream the client's audio is mixed into, or -1 if
+    // kAudioDeviceCustomPropertyAppLoopback doesn't select it.
+    SInt32                      mAppLoopbackPair = -1;
+
     // The client's volume relative to other clients. In the range [0.0, 4.0], defaults to 1.0 (unchanged).
     // mRelativeVolumeCurve is applied to this value when it's set.
     Float32                     mRelativeVolume = 1.0;
 
     // The client's pan position, in the range [-100, 100] where -100 is left and 100 is right
     SInt32                      mPanPosition = 0;
+
+    // How changes to mRelativeVolume and mPanPosition are smoothed during IO. Set along with them.
+    // See kEFFAppVolumesKey_RampFrames and kEFFAppVolumesKey_RampShape.
+    UInt32                      mRampFrames = kAppRampDefaultFrames;
+    EFFAppVolumeRampShape       mRampShape = kEFFAppVolumeRampShapeLinear;
+    
+    // The EFF_ClientMap generation in which the client was added or mRelativeVolume or mPanPosition
+    // was last set. See kAudioDeviceCustomPropertyAppVolumesBinary.
+    UInt64                      mSettingsGeneration = 0;
     
 };
 
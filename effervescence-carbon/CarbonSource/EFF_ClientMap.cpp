@@ -12,130 +12,113 @@
 
 // Local Includes
 #include "EFF_Types.h"
+#include "EFF_Utils.h"
 
 // PublicUtility Includes
 #include "CACFDictionary.h"
 #include "CAException.h"
 
+// STL Includes
+#include <algorithm>
 
-#pragma clang assume_nonnull begin
 
-void    EFF_ClientMap::AddClient(EFF_Client inClient)
-{
-    // Only the shadow map needs to be locked; main map access is normal
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    
-    // If this client has been a client in the past (and has a bundle ID), copy its previous audio settings
-    auto pastClientItr = inClient.mBundleID.IsValid()
-                         ? mPastClientMap.find(inClient.mBundleID)
-                         : mPastClientMap.end();
-    if(pastClientItr != mPastClientMap.end())
-    {
-        DebugMsg("EFF_ClientMap::AddClient: Found previous volume %f and pan %d for client %u",
-                 pastClientItr->second.mRelativeVolume,
-                 pastClientItr->second.mPanPosition,
-                 inClient.mClientID);
-        inClient.mRelativeVolume = pastClientItr->second.mRelativeVolume;
-        inClient.mPanPosition    = pastClientItr->second.mPanPosition;
-    }
+#pragma clang assume_nonnull begin
 
-    // Add the new client to the shadow maps
-    AddClientToShadowMaps(inClient);
+#pragma mark Construction/Destruction
 
-    // Swap the maps with their shadow maps
-    SwapInShadowMaps();
+EFF_ClientMap::EFF_ClientMap()
+:
+    mMapsMutex("Maps mutex")
+{
+}
 
-    // The shadow maps (which were the main maps until we swapped them) are now missing the new client. Add it again to
-    // keep the sets of maps identical.
-    AddClientToShadowMaps(inClient);
+EFF_ClientMap::~EFF_ClientMap()
+{
+}
 
-    // Insert the client into the past clients map. We do this here rather than in RemoveClient
-    // because some apps add multiple clients with the same bundle ID and we want to give them all
-    // the same settings (volume, etc.).
-    if(inClient.mBundleID.IsValid())
-    {
-        mPastClientMap[inClient.mBundleID] = inClient;
-    }
+void    EFF_ClientMap::AddClient(EFF_Client inClient)
+{
+    Transaction theTransaction(*this);
+    theTransaction.AddClient(inClient);
+    theTransaction.Commit();
 }
 
-void    EFF_ClientMap::AddClientToShadowMaps(EFF_Client inClient)
+void    EFF_ClientMap::AddClientToMaps(EFF_Client inClient)
 {
-    ThrowIf(mClientMapShadow.count(inClient.mClientID) != 0,
+    ThrowIf(mClientMap.count(inClient.mClientID) != 0,
             EFF_InvalidClientException(),
-            "EFF_ClientMap::AddClientToShadowMaps: Tried to add client whose client ID was already in use");
+            "EFF_ClientMap::AddClientToMaps: Tried to add client whose client ID was already in use");
 
-    // Add to the client ID shadow map
-    mClientMapShadow[inClient.mClientID] = inClient;
+    // Add to the client ID map
+    mClientMap[inClient.mClientID] = inClient;
 
     // Get a reference to the client in the map so we can add it to the pointer maps
-    EFF_Client& clientInMap = mClientMapShadow.at(inClient.mClientID);
+    EFF_Client& clientInMap = mClientMap.at(inClient.mClientID);
 
-    // Add to the PID shadow map
-    mClientMapByPIDShadow[inClient.mProcessID].push_back(&clientInMap);
+    // Add to the PID map
+    mClientMapByPID[inClient.mProcessID].push_back(&clientInMap);
 
-    // Add to the bundle ID shadow map
-    if(inClient.mBundleID.IsValid())
+    // Add to the bundle ID map
+    if(inClient.mBundleIDAtom != kEFFNoBundleIDAtom)
     {
-        mClientMapByBundleIDShadow[inClient.mBundleID].push_back(&clientInMap);
+        mClientMapByBundleID[inClient.mBundleIDAtom].push_back(&clientInMap);
     }
 }
 
 EFF_Client    EFF_ClientMap::RemoveClient(UInt32 inClientID)
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    Transaction theTransaction(*this);
+    EFF_Client theClient = theTransaction.RemoveClient(inClientID);
+    theTransaction.Commit();
+    
+    return theClient;
+}
 
-    auto theClientItr = mClientMapShadow.find(inClientID);
+void    EFF_ClientMap::RemoveClientFromMaps(UInt32 inClientID, EFF_Client* outClient)
+{
+    auto theClientItr = mClientMap.find(inClientID);
     
     // Removing a client that was never added is an error
-    ThrowIf(theClientItr == mClientMapShadow.end(),
+    ThrowIf(theClientItr == mClientMap.end(),
             EFF_InvalidClientException(),
-            "EFF_ClientMap::RemoveClient: Could not find client to be removed");
-
-    EFF_Client theClient = theClientItr->second;
+            "EFF_ClientMap::RemoveClientFromMaps: Could not find client to be removed");
 
-    // Remove the client from the shadow maps
-    mClientMapShadow.erase(theClientItr);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
-    {
-        mClientMapByBundleID.erase(theClient.mBundleID);
-    }
+    *outClient = theClientItr->second;
+    EFF_Client* theClientInMap = &theClientItr->second;
     
-    // Swap the maps with their shadow maps
-    SwapInShadowMaps();
+    // Remove the client's pointers from the lookup maps before the client itself so they never
+    // point to a client that's been erased. Other clients with the same PID or bundle ID stay.
+    auto theRemovePointerFunc = [&] (auto& ioPointerMap, const auto& inKey) {
+        auto theListItr = ioPointerMap.find(inKey);
+        if(theListItr != ioPointerMap.end())
+        {
+            EFF_ClientPtrList& theList = theListItr->second;
+            theList.erase(std::remove(theList.begin(), theList.end(), theClientInMap), theList.end());
+            
+            if(theList.empty())
+            {
+                ioPointerMap.erase(theListItr);
+            }
+        }
+    };
     
-    // Erase the client again so the maps and their shadow maps are kept identical
-    mClientMapShadow.erase(inClientID);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
+    theRemovePointerFunc(mClientMapByPID, outClient->mProcessID);
+    if(outClient->mBundleIDAtom != kEFFNoBundleIDAtom)
     {
-        mClientMapByBundleID.erase(theClient.mBundleID);
+        theRemovePointerFunc(mClientMapByBundleID, outClient->mBundleIDAtom);
     }
     
-    return theClient;
-}
-
-bool    EFF_ClientMap::GetClientRT(UInt32 inClientID, EFF_Client* outClient)
-const
-{
-    CAMutex::Locker theMapsLocker(mMapsMutex);
-    return GetClient(mClientMap, inClientID, outClient);
+    mClientMap.erase(theClientItr);
 }
 
 bool    EFF_ClientMap::GetClientNonRT(UInt32 inClientID, EFF_Client* outClient)
 const
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    return GetClient(mClientMapShadow, inClientID, outClient);
-}
-
-bool    EFF_ClientMap::GetClient(const std::map<UInt32, EFF_Client>& inClientMap,
-                                 UInt32 inClientID,
-                                 EFF_Client* outClient)
-{
-    auto theClientItr = inClientMap.find(inClientID);
+    CAMutex::Locker theMapsLocker(mMapsMutex);
+    
+    auto theClientItr = mClientMap.find(inClientID);
 
-    if(theClientItr != inClientMap.end())
+    if(theClientItr != mClientMap.end())
     {
         *outClient = theClientItr->second;
         return true;
@@ -147,12 +130,12 @@ bool    EFF_ClientMap::GetClient(const std::map<UInt32, EFF_Client>& inClientMap
 std::vector<EFF_Client> EFF_ClientMap::GetClientsByPID(pid_t inPID)
 const
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    CAMutex::Locker theMapsLocker(mMapsMutex);
 
     std::vector<EFF_Client> theClients;
 
-    auto theMapItr = mClientMapByPIDShadow.find(inPID);
-    if(theMapItr != mClientMapByPIDShadow.end())
+    auto theMapItr = mClientMapByPID.find(inPID);
+    if(theMapItr != mClientMapByPID.end())
     {
         // Found clients with the PID, so copy them into the return vector
         for(auto& theClientPtrsItr : theMapItr->second)
@@ -169,33 +152,21 @@ const
 
 void    EFF_ClientMap::UpdateMusicPlayerFlags(pid_t inMusicPlayerPID)
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    
-    auto theIsMusicPlayerTest = [&] (EFF_Client theClient) {
-        return (theClient.mProcessID == inMusicPlayerPID);
-    };
-    
-    UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
-    SwapInShadowMaps();
-    UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
+    Transaction theTransaction(*this);
+    theTransaction.UpdateMusicPlayerFlags(inMusicPlayerPID);
+    theTransaction.Commit();
 }
 
 void    EFF_ClientMap::UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID)
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    
-    auto theIsMusicPlayerTest = [&] (EFF_Client theClient) {
-        return (theClient.mBundleID.IsValid() && theClient.mBundleID == inMusicPlayerBundleID);
-    };
-    
-    UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
-    SwapInShadowMaps();
-    UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
+    Transaction theTransaction(*this);
+    theTransaction.UpdateMusicPlayerFlags(inMusicPlayerBundleID);
+    theTransaction.Commit();
 }
 
-void    EFF_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(EFF_Client)> inIsMusicPlayerTest)
+void    EFF_ClientMap::UpdateMusicPlayerFlagsInMaps(std::function<bool(EFF_Client)> inIsMusicPlayerTest)
 {
-    for(auto& theItr : mClientMapShadow)
+    for(auto& theItr : mClientMap)
     {
         EFF_Client& theClient = theItr.second;
         theClient.mIsMusicPlayer = inIsMusicPlayerTest(theClient);
@@ -203,18 +174,26 @@ void    EFF_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(EFF
 }
 
 
+#pragma mark Per-App Loopback
+
+void    EFF_ClientMap::UpdateAppLoopbackPairs(std::function<SInt32(const EFF_Client&)> inGetPair)
+{
+    Transaction theTransaction(*this);
+    theTransaction.UpdateAppLoopbackPairs(inGetPair);
+    theTransaction.Commit();
+}
+
+
 #pragma mark App Volumes
 
-CACFArray   EFF_ClientMap::CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve)
+CACFArray   EFF_ClientMap::CopyClientRelativeVolumesAsAppVolumes(const EFF_VolumeCurve& inVolumeCurve)
 const
 {
-    // Since this is a read-only, non-real-time operation, we can read from the shadow maps to avoid
-    // locking the main maps.
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    CAMutex::Locker theMapsLocker(mMapsMutex);
     
     CACFArray theAppVolumes(false);
     
-    for(auto& theClientEntry : mClientMapShadow)
+    for(auto& theClientEntry : mClientMap)
     {
         CopyClientIntoAppVolumesArray(theClientEntry.second, inVolumeCurve, theAppVolumes);
     }
@@ -227,8 +206,47 @@ const
     return theAppVolumes;
 }
 
+std::vector<EFF_Client> EFF_ClientMap::CopyClientsChangedSince(UInt64 inSinceGeneration,
+                                                               UInt64& outGeneration,
+                                                               bool& outIsFullCopy)
+const
+{
+    CAMutex::Locker theMapsLocker(mMapsMutex);
+    
+    // The caller can't find out about the removed clients from the changes, so give it everything.
+    if(inSinceGeneration < mLastRemovalGeneration)
+    {
+        inSinceGeneration = 0;
+    }
+    
+    outIsFullCopy = (inSinceGeneration == 0);
+    
+    std::vector<EFF_Client> theClients;
+    
+    auto theCopyIfChangedFunc = [&] (const EFF_Client& inClient) {
+        if(inClient.mSettingsGeneration > inSinceGeneration)
+        {
+            theClients.push_back(inClient);
+        }
+    };
+    
+    for(auto& theClientEntry : mClientMap)
+    {
+        theCopyIfChangedFunc(theClientEntry.second);
+    }
+    
+    for(auto& thePastClientEntry : mPastClientMap)
+    {
+        theCopyIfChangedFunc(thePastClientEntry.second);
+    }
+    
+    outGeneration = mGeneration;
+    
+    return theClients;
+}
+
 void    EFF_ClientMap::CopyClientIntoAppVolumesArray(EFF_Client inClient,
-                                                     CAVolumeCurve inVolumeCurve,
+                                                     const EFF_VolumeCurve& inVolumeCurve,
                                                      CACFArray& ioAppVolumes)
 const
 {
@@ -238,7 +256,7 @@ const
         CACFDictionary theAppVolume(false);
 
         theAppVolume.AddSInt32(CFSTR(kEFFAppVolumesKey_ProcessID), inClient.mProcessID);
-        theAppVolume.AddString(CFSTR(kEFFAppVolumesKey_BundleID), inClient.mBundleID.CopyCFString());
+        theAppVolume.AddString(CFSTR(kEFFAppVolumesKey_BundleID), inClient.GetBundleID().CopyCFString());
         // Reverse the volume conversion from SetClientsRelativeVolumes
         theAppVolume.AddSInt32(CFSTR(kEFFAppVolumesKey_RelativeVolume),
                                inVolumeCurve.ConvertScalarToRaw(inClient.mRelativeVolume / 4));
@@ -250,7 +268,7 @@ const
 }
 
 template <typename T>
-std::vector<EFF_Client*> * _Nullable GetClientsFromMap(std::map<T, std::vector<EFF_Client*>> & map, T key) {
+std::vector<EFF_Client*> * _Nullable GetClientsFromMap(std::unordered_map<T, std::vector<EFF_Client*>> & map, T key) {
     auto theClientItr = map.find(key);
     if(theClientItr != map.end()) {
         return &theClientItr->second;
@@ -259,11 +277,17 @@ std::vector<EFF_Client*> * _Nullable GetClientsFromMap(std::map<T, std::vector<E
 }
 
 std::vector<EFF_Client*> * _Nullable EFF_ClientMap::GetClients(pid_t inAppPid) {
-    return GetClientsFromMap(mClientMapByPIDShadow, inAppPid);
+    return GetClientsFromMap(mClientMapByPID, inAppPid);
 }
 
 std::vector<EFF_Client*> * _Nullable EFF_ClientMap::GetClients(CACFString inAppBundleID) {
-    return GetClientsFromMap(mClientMapByBundleIDShadow, inAppBundleID);
+    // Bundle IDs that were never interned can't belong to any clients.
+    EFF_BundleIDAtom theAtom = EFF_BundleIDTable::GetInstance().Find(inAppBundleID.GetCFString());
+    return (theAtom == kEFFNoBundleIDAtom) ? nullptr : GetClientsByBundleIDAtom(theAtom);
+}
+
+std::vector<EFF_Client*> * _Nullable EFF_ClientMap::GetClientsByBundleIDAtom(EFF_BundleIDAtom inAppBundleIDAtom) {
+    return GetClientsFromMap(mClientMapByBundleID, inAppBundleIDAtom);
 }
 
 void ShowSetRelativeVolumeMessage(pid_t inAppPID, EFF_Client* theClient);
@@ -287,163 +311,372 @@ void ShowSetRelativeVolumeMessage(CACFString inAppBundleID, EFF_Client* theClien
              CFStringGetCStringPtr(inAppBundleID.GetCFString(), kCFStringEncodingUTF8));
 }
 
-// Template method declarations are running into LLVM bug 23987
-// TODO: template these.
-
-//bool EFF_ClientMap::SetClientsRelativeVolume(pid_t inAppPID, Float32 inRelativeVolume) {
-//    return SetClientsRelativeVolumeT<pid_t>(inAppPID, inRelativeVolume);
-//}
-
-//bool EFF_ClientMap::SetClientsRelativeVolume(CACFString inAppBundleID, Float32 inRelativeVolume) {
-//    return SetClientsRelativeVolumeT<CACFString>(inAppBundleID, inRelativeVolume)
-//}
+bool    EFF_ClientMap::SetClientsRelativeVolume(pid_t inAppPID,
+                                                Float32 inRelativeVolume,
+                                                UInt32 inRampFrames,
+                                                EFFAppVolumeRampShape inRampShape)
+{
+    Transaction theTransaction(*this);
+    bool didChangeVolume =
+            theTransaction.SetClientsRelativeVolume(inAppPID, inRelativeVolume, inRampFrames, inRampShape);
+    theTransaction.Commit();
+    
+    return didChangeVolume;
+}
 
-//template <typename T>
-//bool EFF_ClientMap::SetClientsRelativeVolume(T searchKey, Float32 inRelativeVolume)
+bool    EFF_ClientMap::SetClientsRelativeVolume(CACFString inAppBundleID,
+                                                Float32 inRelativeVolume,
+                                                UInt32 inRampFrames,
+                                                EFFAppVolumeRampShape inRampShape)
+{
+    Transaction theTransaction(*this);
+    bool didChangeVolume =
+            theTransaction.SetClientsRelativeVolume(inAppBundleID, inRelativeVolume, inRampFrames, inRampShape);
+    theTransaction.Commit();
+    
+    return didChangeVolume;
+}
 
-bool EFF_ClientMap::SetClientsRelativeVolume(pid_t searchKey, Float32 inRelativeVolume)
+bool    EFF_ClientMap::SetClientsPanPosition(pid_t inAppPID,
+                                             SInt32 inPanPosition,
+                                             UInt32 inRampFrames,
+                                             EFFAppVolumeRampShape inRampShape)
 {
-    bool didChangeVolume = false;
+    Transaction theTransaction(*this);
+    bool didChangePanPosition =
+            theTransaction.SetClientsPanPosition(inAppPID, inPanPosition, inRampFrames, inRampShape);
+    theTransaction.Commit();
     
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    return didChangePanPosition;
+}
+
+bool    EFF_ClientMap::SetClientsPanPosition(CACFString inAppBundleID,
+                                             SInt32 inPanPosition,
+                                             UInt32 inRampFrames,
+                                             EFFAppVolumeRampShape inRampShape)
+{
+    Transaction theTransaction(*this);
+    bool didChangePanPosition =
+            theTransaction.SetClientsPanPosition(inAppBundleID, inPanPosition, inRampFrames, inRampShape);
+    theTransaction.Commit();
     
-    auto theSetVolumesInShadowMapsFunc = [&] {
-        // Look up the clients for the key and update their volumes
+    return didChangePanPosition;
+}
+
+
+#pragma mark Transactions
+
+EFF_ClientMap::Transaction::Transaction(EFF_ClientMap& inClientMap)
+:
+    mClientMap(inClientMap),
+    mMapsLocker(inClientMap.mMapsMutex),
+    mGeneration(inClientMap.mGeneration + 1)
+{
+}
+
+EFF_ClientMap::Transaction::~Transaction()
+{
+    if(!mUndoLog.empty())
+    {
+        // The transaction wasn't committed, most likely because one of the changes threw. Undo the
+        // changes so the maps match the client params table again.
+        DebugMsg("EFF_ClientMap::Transaction::~Transaction: Discarding %lu uncommitted changes",
+                 static_cast<unsigned long>(mUndoLog.size()));
         
-        auto theClients = GetClients(searchKey);
-        if(theClients != nullptr)
-        {
-            for(EFF_Client* theClient : *theClients)
-            {
-                theClient->mRelativeVolume = inRelativeVolume;
-                
-                ShowSetRelativeVolumeMessage(searchKey, theClient);
-                
-                didChangeVolume = true;
-            }
-        }
-    };
+        EFFLogAndSwallowExceptions("EFF_ClientMap::Transaction::~Transaction", [&] {
+            Discard();
+        });
+    }
+}
+
+void    EFF_ClientMap::Transaction::AddClient(EFF_Client inClient)
+{
+    // If this client has been a client in the past (and has a bundle ID), copy its previous audio settings
+    auto pastClientItr = (inClient.mBundleIDAtom != kEFFNoBundleIDAtom)
+                         ? mClientMap.mPastClientMap.find(inClient.mBundleIDAtom)
+                         : mClientMap.mPastClientMap.end();
+    if(pastClientItr != mClientMap.mPastClientMap.end())
+    {
+        DebugMsg("EFF_ClientMap::Transaction::AddClient: Found previous volume %f and pan %d for client %u",
+                 pastClientItr->second.mRelativeVolume,
+                 pastClientItr->second.mPanPosition,
+                 inClient.mClientID);
+        inClient.mRelativeVolume = pastClientItr->second.mRelativeVolume;
+        inClient.mPanPosition    = pastClientItr->second.mPanPosition;
+    }
+
+    inClient.mSettingsGeneration = mGeneration;
     
-    theSetVolumesInShadowMapsFunc();
-    SwapInShadowMaps();
-    theSetVolumesInShadowMapsFunc();
+    UndoRecord theUndoRecord { UndoRecord::kAdded, inClient };
+    if(pastClientItr != mClientMap.mPastClientMap.end())
+    {
+        theUndoRecord.mHadPastClient = true;
+        theUndoRecord.mPastClient = pastClientItr->second;
+    }
     
-    return didChangeVolume;
+    // Reserve space first so recording the change can't throw after it's been made.
+    mUndoLog.reserve(mUndoLog.size() + 1);
+    mChangedClientIDs.reserve(mChangedClientIDs.size() + 1);
+    
+    mClientMap.AddClientToMaps(inClient);
+    mUndoLog.push_back(theUndoRecord);
+    mChangedClientIDs.push_back(inClient.mClientID);
+
+    // Insert the client into the past clients map. We do this here rather than in RemoveClient
+    // because some apps add multiple clients with the same bundle ID and we want to give them all
+    // the same settings (volume, etc.).
+    if(inClient.mBundleIDAtom != kEFFNoBundleIDAtom)
+    {
+        mClientMap.mPastClientMap[inClient.mBundleIDAtom] = inClient;
+    }
 }
 
-bool EFF_ClientMap::SetClientsRelativeVolume(CACFString searchKey, Float32 inRelativeVolume)
+EFF_Client  EFF_ClientMap::Transaction::RemoveClient(UInt32 inClientID)
 {
-    bool didChangeVolume = false;
+    mUndoLog.reserve(mUndoLog.size() + 1);
+    mChangedClientIDs.reserve(mChangedClientIDs.size() + 1);
     
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    EFF_Client theClient;
+    mClientMap.RemoveClientFromMaps(inClientID, &theClient);
+    mUndoLog.push_back(UndoRecord { UndoRecord::kRemoved, theClient });
+    mChangedClientIDs.push_back(inClientID);
+    mDidRemoveClient = true;
     
-    auto theSetVolumesInShadowMapsFunc = [&] {
-        // Look up the clients for the key and update their volumes
+    return theClient;
+}
+
+bool    EFF_ClientMap::Transaction::SetClientsRelativeVolume(pid_t inAppPID,
+                                                             Float32 inRelativeVolume,
+                                                             UInt32 inRampFrames,
+                                                             EFFAppVolumeRampShape inRampShape)
+{
+    return ChangeClients(mClientMap.GetClients(inAppPID), [&] (EFF_Client& ioClient) {
+        ioClient.mRelativeVolume = inRelativeVolume;
+        ioClient.mRampFrames = inRampFrames;
+        ioClient.mRampShape = inRampShape;
         
-        auto theClients = GetClients(searchKey);
-        if(theClients != nullptr)
-        {
-            for(EFF_Client* theClient : *theClients)
-            {
-                theClient->mRelativeVolume = inRelativeVolume;
-                
-                ShowSetRelativeVolumeMessage(searchKey, theClient);
-                
-                didChangeVolume = true;
-            }
-        }
-    };
-    
-    theSetVolumesInShadowMapsFunc();
-    SwapInShadowMaps();
-    theSetVolumesInShadowMapsFunc();
+        ShowSetRelativeVolumeMessage(inAppPID, &ioClient);
+    });
+}
+
+bool    EFF_ClientMap::Transaction::SetClientsRelativeVolume(CACFString inAppBundleID,
+                                                             Float32 inRelativeVolume,
+                                                             UInt32 inRampFrames,
+                                                             EFFAppVolumeRampShape inRampShape)
+{
+    return ChangeClients(mClientMap.GetClients(inAppBundleID), [&] (EFF_Client& ioClient) {
+        ioClient.mRelativeVolume = inRelativeVolume;
+        ioClient.mRampFrames = inRampFrames;
+        ioClient.mRampShape = inRampShape;
+        
+        ShowSetRelativeVolumeMessage(inAppBundleID, &ioClient);
+    });
+}
+
+bool    EFF_ClientMap::Transaction::SetClientsPanPosition(pid_t inAppPID,
+                                                          SInt32 inPanPosition,
+                                                          UInt32 inRampFrames,
+                                                          EFFAppVolumeRampShape inRampShape)
+{
+    return ChangeClients(mClientMap.GetClients(inAppPID), [&] (EFF_Client& ioClient) {
+        ioClient.mPanPosition = inPanPosition;
+        ioClient.mRampFrames = inRampFrames;
+        ioClient.mRampShape = inRampShape;
+    });
+}
+
+bool    EFF_ClientMap::Transaction::SetClientsPanPosition(CACFString inAppBundleID,
+                                                          SInt32 inPanPosition,
+                                                          UInt32 inRampFrames,
+                                                          EFFAppVolumeRampShape inRampShape)
+{
+    return ChangeClients(mClientMap.GetClients(inAppBundleID), [&] (EFF_Client& ioClient) {
+        ioClient.mPanPosition = inPanPosition;
+        ioClient.mRampFrames = inRampFrames;
+        ioClient.mRampShape = inRampShape;
+    });
+}
+
+void    EFF_ClientMap::Transaction::UpdateMusicPlayerFlags(pid_t inMusicPlayerPID)
+{
+    for(auto& theItr : mClientMap.mClientMap)
+    {
+        WillChangeClient(theItr.second);
+    }
     
-    return didChangeVolume;
+    mClientMap.UpdateMusicPlayerFlagsInMaps([&] (EFF_Client theClient) {
+        return (theClient.mProcessID == inMusicPlayerPID);
+    });
 }
 
-bool EFF_ClientMap::SetClientsPanPosition(pid_t searchKey, SInt32 inPanPosition)
+void    EFF_ClientMap::Transaction::UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID)
 {
-    bool didChangePanPosition = false;
+    // If no client has ever had the bundle ID, this is kEFFNoBundleIDAtom and no clients match.
+    EFF_BundleIDAtom theMusicPlayerAtom =
+            EFF_BundleIDTable::GetInstance().Find(inMusicPlayerBundleID.GetCFString());
     
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    for(auto& theItr : mClientMap.mClientMap)
+    {
+        WillChangeClient(theItr.second);
+    }
     
-    auto theSetPansInShadowMapsFunc = [&] {
-        // Look up the clients for the key and update their pan positions
-        auto theClients = GetClients(searchKey);
-        if(theClients != nullptr) {
-            for(auto theClient: *theClients) {
-                theClient->mPanPosition = inPanPosition;
-                didChangePanPosition = true;
-            }
+    mClientMap.UpdateMusicPlayerFlagsInMaps([&] (EFF_Client theClient) {
+        return (theMusicPlayerAtom != kEFFNoBundleIDAtom && theClient.mBundleIDAtom == theMusicPlayerAtom);
+    });
+}
+
+void    EFF_ClientMap::Transaction::UpdateAppLoopbackPairs(std::function<SInt32(const EFF_Client&)> inGetPair)
+{
+    for(auto& theItr : mClientMap.mClientMap)
+    {
+        EFF_Client& theClient = theItr.second;
+        SInt32 thePair = inGetPair(theClient);
+        
+        // Only publish the clients whose pairs actually changed.
+        if(theClient.mAppLoopbackPair != thePair)
+        {
+            WillChangeClient(theClient);
+            theClient.mAppLoopbackPair = thePair;
         }
-    };
-    
-    theSetPansInShadowMapsFunc();
-    SwapInShadowMaps();
-    theSetPansInShadowMapsFunc();
-    
-    return didChangePanPosition;
+    }
 }
 
-bool EFF_ClientMap::SetClientsPanPosition(CACFString searchKey, SInt32 inPanPosition)
+void    EFF_ClientMap::Transaction::Commit()
 {
-    bool didChangePanPosition = false;
+    if(mChangedClientIDs.empty())
+    {
+        return;
+    }
     
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    // Update the params table for all of the changes in one batch, so the IO thread gets them all in
+    // the same cycle. (See EFF_ClientParamsTable::GetParamsForCycleRT.)
+    mClientMap.mClientParamsTable.BeginBatch();
     
-    auto theSetPansInShadowMapsFunc = [&] {
-        // Look up the clients for the key and update their pan positions
-        auto theClients = GetClients(searchKey);
-        if(theClients != nullptr) {
-            for(auto theClient: *theClients) {
-                theClient->mPanPosition = inPanPosition;
-                didChangePanPosition = true;
-            }
+    for(UInt32 theClientID : mChangedClientIDs)
+    {
+        auto theClientItr = mClientMap.mClientMap.find(theClientID);
+        
+        if(theClientItr != mClientMap.mClientMap.end())
+        {
+            mClientMap.UpdateClientParamsTable(theClientItr->second);
         }
-    };
+        else
+        {
+            mClientMap.mClientParamsTable.RemoveClient(theClientID);
+        }
+    }
     
-    theSetPansInShadowMapsFunc();
-    SwapInShadowMaps();
-    theSetPansInShadowMapsFunc();
+    mClientMap.mClientParamsTable.EndBatch();
     
-    return didChangePanPosition;
+    if(mDidRemoveClient)
+    {
+        mClientMap.mLastRemovalGeneration = mGeneration;
+        mDidRemoveClient = false;
+    }
+    
+    mChangedClientIDs.clear();
+    mUndoLog.clear();
+    mClientMap.mGeneration = mGeneration++;
 }
 
-
-#pragma mark Mechanism
-
-void    EFF_ClientMap::UpdateClientIOStateNonRT(UInt32 inClientID, bool inDoingIO)
+void    EFF_ClientMap::Transaction::WillChangeClient(const EFF_Client& inClient)
 {
-    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    
-    mClientMapShadow[inClientID].mDoingIO = inDoingIO;
-    SwapInShadowMaps();
-    mClientMapShadow[inClientID].mDoingIO = inDoingIO;
+    mUndoLog.push_back(UndoRecord { UndoRecord::kChanged, inClient });
+    mChangedClientIDs.push_back(inClient.mClientID);
 }
 
-void    EFF_ClientMap::SwapInShadowMaps()
+void    EFF_ClientMap::Transaction::Discard()
 {
-    mTaskQueue->QueueSync_SwapClientShadowMaps(this);
+    for(auto theItr = mUndoLog.rbegin(); theItr != mUndoLog.rend(); theItr++)
+    {
+        const UndoRecord& theRecord = *theItr;
+        
+        switch(theRecord.mKind)
+        {
+            case UndoRecord::kAdded:
+                {
+                    EFF_Client theRemovedClient;
+                    mClientMap.RemoveClientFromMaps(theRecord.mClient.mClientID, &theRemovedClient);
+                    
+                    if(theRecord.mHadPastClient)
+                    {
+                        mClientMap.mPastClientMap[theRecord.mClient.mBundleIDAtom] = theRecord.mPastClient;
+                    }
+                    else if(theRecord.mClient.mBundleIDAtom != kEFFNoBundleIDAtom)
+                    {
+                        mClientMap.mPastClientMap.erase(theRecord.mClient.mBundleIDAtom);
+                    }
+                }
+                break;
+                
+            case UndoRecord::kRemoved:
+                mClientMap.AddClientToMaps(theRecord.mClient);
+                break;
+                
+            case UndoRecord::kChanged:
+                {
+                    // Assign rather than replace, so the pointers in the lookup maps stay valid.
+                    auto theClientItr = mClientMap.mClientMap.find(theRecord.mClient.mClientID);
+                    
+                    if(theClientItr != mClientMap.mClientMap.end())
+                    {
+                        theClientItr->second = theRecord.mClient;
+                    }
+                }
+                break;
+        }
+    }
+    
+    mUndoLog.clear();
+    mChangedClientIDs.clear();
+    mDidRemoveClient = false;
 }
 
-void    EFF_ClientMap::SwapInShadowMapsRT()
+bool    EFF_ClientMap::Transaction::ChangeClients(EFF_ClientPtrList* __nullable inClients,
+                                                  std::function<void(EFF_Client&)> inChange)
 {
-#if DEBUG
-    // This method should only be called by the realtime worker thread in EFF_TaskQueue.
-    // The only safe way to call it is on a realtime thread while a non-realtime thread is holding the shadow maps mutex.
-    // (These assertions assume that the realtime worker thread is the only thread we'll call this on,
-    // but we could decide to change that at some point.)
-    mTaskQueue->AssertCurrentThreadIsRTWorkerThread("EFF_ClientMap::SwapInShadowMapsRT");
+    if(inClients == nullptr || inClients->empty())
+    {
+        return false;
+    }
     
-    Assert(!mShadowMapsMutex.IsFree(), "Can't swap in the shadow maps while the shadow maps mutex is free");
-    Assert(!mShadowMapsMutex.IsOwnedByCurrentThread(), "The shadow maps mutex should not be held by a realtime thread");
-#endif
+    for(EFF_Client* theClient : *inClients)
+    {
+        WillChangeClient(*theClient);
+        inChange(*theClient);
+        theClient->mSettingsGeneration = mGeneration;
+    }
     
+    return true;
+}
+
+
+#pragma mark Mechanism
+
+void    EFF_ClientMap::UpdateClientIOStateNonRT(UInt32 inClientID, bool inDoingIO)
+{
     CAMutex::Locker theMapsLocker(mMapsMutex);
     
-    mClientMap.swap(mClientMapShadow);
-    mClientMapByPID.swap(mClientMapByPIDShadow);
-    mClientMapByBundleID.swap(mClientMapByBundleIDShadow);
+    auto theClientItr = mClientMap.find(inClientID);
+    if(theClientItr != mClientMap.end())
+    {
+        // IO doesn't read this flag, so the params table doesn't need updating.
+        theClientItr->second.mDoingIO = inDoingIO;
+    }
+}
+
+void    EFF_ClientMap::UpdateClientParamsTable(const EFF_Client& inClient)
+{
+    EFF_ClientIOParams theParams;
+    theParams.mRelativeVolume = inClient.mRelativeVolume;
+    theParams.mPanPosition = static_cast<SInt8>(inClient.mPanPosition);
+    theParams.mIsMusicPlayer = inClient.mIsMusicPlayer;
+    theParams.mHasAppLoopbackPair = (inClient.mAppLoopbackPair >= 0);
+    theParams.mAppLoopbackPair = static_cast<UInt8>(std::max(inClient.mAppLoopbackPair, 0));
+    theParams.mExponentialRamp = (inClient.mRampShape == kEFFAppVolumeRampShapeExponential);
+    theParams.mRampFrames = static_cast<UInt16>(std::min(inClient.mRampFrames, static_cast<UInt32>(kAppRampMaxFrames)));
+
+    mClientParamsTable.SetParams(inClient.mClientID, theParams);
 }
 
 #pragma clang assume_nonnull end
@@ -12,24 +12,21 @@
 
 // Local Includes
 #include "EFF_Client.h"
-#include "EFF_TaskQueue.h"
+#include "EFF_ClientParamsTable.h"
+#include "EFF_VolumeCurve.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
 #include "CACFString.h"
 #include "CACFArray.h"
-#include "CAVolumeCurve.h"
 
 // STL Includes
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <functional>
 
 
-// Forward Declarations
-class EFF_ClientTasks;
-
-
 #pragma clang assume_nonnull begin
 //==================================================================================================
 //    EFF_ClientMap
@@ -39,16 +36,10 @@ class EFF_ClientTasks;
 //  removed by the HAL we add it to a map of past clients to keep track of settings specific to that
 //  client. (Currently only the client's volume.)
 //
-//  Since the maps are read from during IO, this class has to to be real-time safe when accessing
-//  them. So each map has an identical "shadow" map, which we use to buffer update
-//  To update the clients we lock the shadow maps, modify them, have EFF_TaskQueue's real-time
-//  thread swap them with the main maps, and then repeat the modification to keep both sets of maps
-//  identical. We have to swap the maps on a real-time thread so we can take the main maps' lock
-//  without risking priority inversion, but this way the actual work doesn't need to be real-time
-//  safe.
-//
-//  Methods that only read from the maps and are called on non-real-time threads will just read
-//  from the shadow maps because it's easier.
+//  The maps are only accessed by non-real-time threads, which lock mMapsMutex to use them. The
+//  settings IO needs for each client are copied into mClientParamsTable after each change, and
+//  that's all real-time threads read, without locking or copying the client. So changing a client
+//  never has to wait for a real-time thread, and doesn't copy the other clients.
 //
 //  Methods whose names end with "RT" and "NonRT" can only safely be called from real-time and
 //  non-real-time threads respectively. (Methods with neither are most likely non-RT.)
@@ -56,17 +47,16 @@ class EFF_ClientTasks;
 
 class EFF_ClientMap
 {
-    friend class EFF_ClientTasks;
     typedef std::vector<EFF_Client*> EFF_ClientPtrList;
     
 #pragma mark Construction/Destruction
     
 public:
-                                EFF_ClientMap(EFF_TaskQueue* inTaskQueue)
-                                :
-                                    mTaskQueue(inTaskQueue),
-                                    mMapsMutex("Maps mutex"),
-                                    mShadowMapsMutex("Shadow maps mutex") { };
+                                EFF_ClientMap();
+                                ~EFF_ClientMap();
+                                // Disallow copying
+                                EFF_ClientMap(const EFF_ClientMap&) = delete;
+                                EFF_ClientMap& operator=(const EFF_ClientMap&) = delete;
     
 
 #pragma mark API
@@ -74,20 +64,47 @@ public:
     void                        AddClient(EFF_Client inClient);
     EFF_Client                  RemoveClient(UInt32 inClientID);
     
-    // These methods are functionally identical except that GetClientRT must only be called from real-time threads
-    // and GetClientNonRT must only be called from non-real-time threads. Both return true if a client was found.
-    bool                        GetClientRT(UInt32 inClientID, EFF_Client* outClient) const;
+    // Returns true if a client was found. Real-time threads should use GetClientIOParamsRT instead.
     bool                        GetClientNonRT(UInt32 inClientID, EFF_Client* outClient) const;
     std::vector<EFF_Client>     GetClientsByPID(pid_t inPID) const;
     
+    // Gets the settings IO needs for a client without locking or copying the client. Returns false
+    // (and the default settings) if the client wasn't found. Real-time safe. See
+    // EFF_ClientParamsTable::GetParamsRT.
+    bool                        GetClientIOParamsRT(UInt32 inClientID,
+                                                    EFF_ClientIOParams& outParams,
+                                                    EFF_ClientRampState* __nullable * __nullable outRampState = nullptr) const
+                                    { return mClientParamsTable.GetParamsRT(inClientID, outParams, outRampState); }
+    // The same, but every call for the same IO cycle sees the same committed transactions. IO thread
+    // only. See EFF_ClientParamsTable::GetParamsForCycleRT.
+    bool                        GetClientIOParamsForCycleRT(UInt64 inIOCycle,
+                                                            UInt32 inClientID,
+                                                            EFF_ClientIOParams& outParams,
+                                                            EFF_ClientRampState* __nullable * __nullable outRampState = nullptr) const
+                                    { return mClientParamsTable.GetParamsForCycleRT(inIOCycle, inClientID, outParams, outRampState); }
+    
     // Set the isMusicPlayer flag for each client. (True if the client has the given bundle ID/PID, false otherwise.)
     void                        UpdateMusicPlayerFlags(pid_t inMusicPlayerPID);
     void                        UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID);
+    
+    // Set each client's mAppLoopbackPair to the pair inGetPair returns for it. (-1 for none.)
+    void                        UpdateAppLoopbackPairs(std::function<SInt32(const EFF_Client&)> inGetPair);
 
     // Copies the current and past clients into an array in the format expected for
     // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
     // of unwrapped CFArray and CFDictionary refs.)
-    CACFArray                   CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve) const;
+    CACFArray                   CopyClientRelativeVolumesAsAppVolumes(const EFF_VolumeCurve& inVolumeCurve) const;
+    
+    // Copies the current and past clients whose mSettingsGeneration is after inSinceGeneration, in the
+    // same order as CopyClientRelativeVolumesAsAppVolumes, and sets outGeneration to the current
+    // generation. Pass 0 to copy all of them.
+    //
+    // Removed clients can't be copied, so if any were removed after inSinceGeneration, this copies
+    // all of the clients instead. outIsFullCopy is set to true if it copied all of them, for either
+    // reason.
+    std::vector<EFF_Client>     CopyClientsChangedSince(UInt64 inSinceGeneration,
+                                                        UInt64& outGeneration,
+                                                        bool& outIsFullCopy) const;
     
     // Using the template function hits LLVM Bug 23987
     // TODO Switch to template function
@@ -99,75 +116,175 @@ public:
     //template <typename T>
     //bool                        SetClientsPanPosition(T _Null_unspecified searchKey, SInt32 inPanPosition);
     
+    // inRampFrames and inRampShape control how the change is smoothed during IO. See EFF_Client::mRampFrames.
+    
     // Returns true if a client for PID inAppPID was found and its relative volume changed.
-    bool                        SetClientsRelativeVolume(pid_t inAppPID, Float32 inRelativeVolume);
+    bool                        SetClientsRelativeVolume(pid_t inAppPID,
+                                                         Float32 inRelativeVolume,
+                                                         UInt32 inRampFrames,
+                                                         EFFAppVolumeRampShape inRampShape);
     // Returns true if a client for bundle ID inAppBundleID was found and its relative volume changed.
-    bool                        SetClientsRelativeVolume(CACFString inAppBundleID, Float32 inRelativeVolume);
+    bool                        SetClientsRelativeVolume(CACFString inAppBundleID,
+                                                         Float32 inRelativeVolume,
+                                                         UInt32 inRampFrames,
+                                                         EFFAppVolumeRampShape inRampShape);
     
     // Returns true if a client for PID inAppPID was found and its pan position changed.
-    bool                        SetClientsPanPosition(pid_t inAppPID, SInt32 inPanPosition);
+    bool                        SetClientsPanPosition(pid_t inAppPID,
+                                                      SInt32 inPanPosition,
+                                                      UInt32 inRampFrames,
+                                                      EFFAppVolumeRampShape inRampShape);
     // Returns true if a client for bundle ID inAppBundleID was found and its pan position changed.
-    bool                        SetClientsPanPosition(CACFString inAppBundleID, SInt32 inPanPosition);
+    bool                        SetClientsPanPosition(CACFString inAppBundleID,
+                                                      SInt32 inPanPosition,
+                                                      UInt32 inRampFrames,
+                                                      EFFAppVolumeRampShape inRampShape);
     
     void                        StartIONonRT(UInt32 inClientID) { UpdateClientIOStateNonRT(inClientID, true ); }
     void                        StopIONonRT(UInt32 inClientID)  { UpdateClientIOStateNonRT(inClientID, false); }
 
     
+#pragma mark Transactions
+    
+    // Makes any number of changes to the clients and then publishes them to the client params table
+    // together, as one batch, so the IO thread sees all of them from the same cycle. The methods above each use a transaction with one
+    // change, which means that making several changes with them would lock the maps and update
+    // the table once per change.
+    //
+    // The transaction holds the maps mutex from when it's created until it's destroyed, so other
+    // threads can't read or change the clients in the meantime. Changes are applied to the maps
+    // immediately, so later changes in the same transaction see earlier ones. Commit must be called
+    // to publish them. If the transaction is destroyed with uncommitted changes, e.g. because a
+    // change threw, it discards them by undoing them in the maps, so the maps still match what was
+    // last published.
+    class Transaction
+    {
+    public:
+                                Transaction(EFF_ClientMap& inClientMap);
+                                ~Transaction();
+                                Transaction(const Transaction&) = delete;
+                                Transaction& operator=(const Transaction&) = delete;
+        
+        // These work the same way as the EFF_ClientMap methods with the same names.
+        void                    AddClient(EFF_Client inClient);
+        EFF_Client              RemoveClient(UInt32 inClientID);
+        
+        bool                    SetClientsRelativeVolume(pid_t inAppPID,
+                                                         Float32 inRelativeVolume,
+                                                         UInt32 inRampFrames,
+                                                         EFFAppVolumeRampShape inRampShape);
+        bool                    SetClientsRelativeVolume(CACFString inAppBundleID,
+                                                         Float32 inRelativeVolume,
+                                                         UInt32 inRampFrames,
+                                                         EFFAppVolumeRampShape inRampShape);
+        
+        bool                    SetClientsPanPosition(pid_t inAppPID,
+                                                      SInt32 inPanPosition,
+                                                      UInt32 inRampFrames,
+                                                      EFFAppVolumeRampShape inRampShape);
+        bool                    SetClientsPanPosition(CACFString inAppBundleID,
+                                                      SInt32 inPanPosition,
+                                                      UInt32 inRampFrames,
+                                                      EFFAppVolumeRampShape inRampShape);
+        
+        void                    UpdateMusicPlayerFlags(pid_t inMusicPlayerPID);
+        void                    UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID);
+        
+        void                    UpdateAppLoopbackPairs(std::function<SInt32(const EFF_Client&)> inGetPair);
+        
+        // Copies the changed clients' IO settings into the client params table as one batch. Does
+        // nothing if nothing has changed since the last commit. The transaction can still be used
+        // afterwards and can be committed again.
+        void                    Commit();
+        
+    private:
+        // What to restore to undo one change.
+        struct UndoRecord
+        {
+            enum Kind { kAdded, kRemoved, kChanged };
+            
+            Kind                mKind;
+            // For kAdded, the client that was added. Otherwise the client as it was before the
+            // change.
+            EFF_Client          mClient;
+            // For kAdded, the client's entry in the past clients map before it was replaced, if
+            // there was one.
+            bool                mHadPastClient = false;
+            EFF_Client          mPastClient;
+        };
+        
+        // Applies inChange to each client in inClients, which can be null.
+        bool                    ChangeClients(EFF_ClientPtrList* __nullable inClients,
+                                              std::function<void(EFF_Client&)> inChange);
+        // Records the client's current state and that it's about to be changed.
+        void                    WillChangeClient(const EFF_Client& inClient);
+        // Undoes the uncommitted changes, newest first.
+        void                    Discard();
+        
+        EFF_ClientMap&          mClientMap;
+        CAMutex::Locker         mMapsLocker;
+        // The IDs of the clients added, removed or changed since the last commit.
+        std::vector<UInt32>     mChangedClientIDs;
+        // True if a client has been removed since the last commit.
+        bool                    mDidRemoveClient = false;
+        // The changes since the last commit, oldest first.
+        std::vector<UndoRecord> mUndoLog;
+        // The generation the changes since the last commit will be published as.
+        UInt64                  mGeneration;
+    };
+
+    
 #pragma mark Implementation
 
 private:
-    void                        AddClientToShadowMaps(EFF_Client inClient);
-    static bool                 GetClient(const std::map<UInt32, EFF_Client>& inClientMap,
-                                          UInt32 inClientID,
-                                          EFF_Client* outClient);
-    void                        UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(EFF_Client)> inIsMusicPlayerTest);
+    void                        AddClientToMaps(EFF_Client inClient);
+    void                        RemoveClientFromMaps(UInt32 inClientID, EFF_Client* outClient);
+    void                        UpdateMusicPlayerFlagsInMaps(std::function<bool(EFF_Client)> inIsMusicPlayerTest);
     void                        CopyClientIntoAppVolumesArray(EFF_Client inClient,
-                                                              CAVolumeCurve inVolumeCurve,
+                                                              const EFF_VolumeCurve& inVolumeCurve,
                                                               CACFArray& ioAppVolumes) const;
     void                        UpdateClientIOStateNonRT(UInt32 inClientID, bool inDoingIO);
-    
-    // Has a real-time thread call SwapInShadowMapsRT. (Synchronously queues the call as a task on mTaskQueue.)
-    // The shadow maps mutex must be locked when calling this method.
-    void                        SwapInShadowMaps();
-    // Note that this method is called by EFF_TaskQueue through the EFF_ClientTasks interface.
-    // The shadow maps mutex must be locked when calling this method.
-    void                        SwapInShadowMapsRT();
+    // Copies the client's IO settings into mClientParamsTable. mMapsMutex must be locked when
+    // calling this method.
+    void                        UpdateClientParamsTable(const EFF_Client& inClient);
     
     // Client lookup for PID inAppPID
     std::vector<EFF_Client*> * _Nullable            GetClients(pid_t inAppPid);
     // Client lookup for bundle ID inAppBundleID
     std::vector<EFF_Client*> * _Nullable            GetClients(CACFString inAppBundleID);
+    std::vector<EFF_Client*> * _Nullable            GetClientsByBundleIDAtom(EFF_BundleIDAtom inAppBundleIDAtom);
     
 
 #pragma mark Members
 
-    EFF_TaskQueue*                                  mTaskQueue;
-    
-    // Must be held to access mClientMap or mClientMapByPID. Code that runs while holding this mutex needs
-    // to be real-time safe. Should probably not be held for most operations on mClientMapByBundleID because,
-    // as far as I can tell, code that works with CFStrings is unlikely to be real-time safe.
+    // Must be held to access the maps or mClientParamsTable (for writing). Should only be locked by
+    // non-real-time threads.
     CAMutex                                         mMapsMutex;
-    // Should only be locked by non-real-time threads. Should not be released until the maps have been
-    // made identical to their shadow maps.
-    CAMutex                                         mShadowMapsMutex;
     
     // The clients currently registered with EFFDevice. Indexed by client ID.
     std::map<UInt32, EFF_Client>                    mClientMap;
-    // We keep this in sync with mClientMap so it can be modified outside of real-time safe sections and
-    // then swapped in on a real-time thread, which is safe.
-    std::map<UInt32, EFF_Client>                    mClientMapShadow;
     
-    // These maps hold lists of pointers to clients in mClientMap/mClientMapShadow. Lists because a process
-    // can have multiple clients and clients can have the same bundle ID.
-    std::map<pid_t, EFF_ClientPtrList>              mClientMapByPID;
-    std::map<pid_t, EFF_ClientPtrList>              mClientMapByPIDShadow;
+    // These maps hold lists of pointers to clients in mClientMap. Lists because a process can have
+    // multiple clients and clients can have the same bundle ID. Bundle IDs are keyed by their atoms
+    // (see EFF_BundleIDTable) so looking clients up doesn't have to compare strings.
+    std::unordered_map<pid_t, EFF_ClientPtrList>    mClientMapByPID;
+    std::unordered_map<EFF_BundleIDAtom, EFF_ClientPtrList>
+                                                    mClientMapByBundleID;
     
-    std::map<CACFString, EFF_ClientPtrList>         mClientMapByBundleID;
-    std::map<CACFString, EFF_ClientPtrList>         mClientMapByBundleIDShadow;
+    // A copy of the IO settings of the clients in mClientMap that real-time threads can read without
+    // copying the clients. Only modified while holding mMapsMutex.
+    EFF_ClientParamsTable                           mClientParamsTable;
     
     // Clients are added to mPastClientMap so we can restore settings specific to them if they get
-    // added again.
-    std::map<CACFString, EFF_Client>                mPastClientMap;
+    // added again. Keyed by bundle ID atom.
+    std::unordered_map<EFF_BundleIDAtom, EFF_Client>
+                                                    mPastClientMap;
+    
+    // Incremented each time a transaction commits changes. Clients' mSettingsGeneration fields are set
+    // to the generation their settings were changed in.
+    UInt64                                          mGeneration = 0;
+    // The last generation in which a client was removed, or 0 if none have been.
+    UInt64                                          mLastRemovalGeneration = 0;
 };
 
 #pragma clang assume_nonnull end
@@ -0,0 +1,314 @@
+//
+//  EFF_ClientParamsTable.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_ClientParamsTable.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Writer API
+
+bool    EFF_ClientParamsTable::SetParams(UInt32 inClientID, EFF_ClientIOParams inParams)
+{
+    if(mInBatch)
+    {
+        return StoreParams(inClientID, inParams);
+    }
+
+    BeginBatch();
+    bool theStored = StoreParams(inClientID, inParams);
+    EndBatch();
+
+    return theStored;
+}
+
+void    EFF_ClientParamsTable::RemoveClient(UInt32 inClientID)
+{
+    if(mInBatch)
+    {
+        EraseClient(inClientID);
+        return;
+    }
+
+    BeginBatch();
+    EraseClient(inClientID);
+    EndBatch();
+}
+
+void    EFF_ClientParamsTable::BeginBatch()
+{
+    Assert(!mInBatch, "EFF_ClientParamsTable::BeginBatch: Already in a batch");
+    mInBatch = true;
+
+    // Make the sequence odd so the IO thread won't copy the table until the batch is finished. The
+    // fence keeps the batch's stores from being seen before the new sequence. (See UpdateCycleCopyRT.)
+    mBatchSequence.store(mBatchSequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void    EFF_ClientParamsTable::EndBatch()
+{
+    Assert(mInBatch, "EFF_ClientParamsTable::EndBatch: Not in a batch");
+    mInBatch = false;
+
+    // Publish the batch's stores along with the new, even, sequence.
+    mBatchSequence.store(mBatchSequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool    EFF_ClientParamsTable::StoreParams(UInt32 inClientID, EFF_ClientIOParams inParams)
+{
+    Assert(inClientID != kEmptySlot && inClientID != kRemovedSlot,
+           "EFF_ClientParamsTable::SetParams: Client ID is reserved");
+
+    // If the client is already in the table, just replace its settings. Readers will see either the
+    // old settings or the new ones.
+    UInt32 theSlot = FindSlot(inClientID);
+
+    if(theSlot != kCapacity)
+    {
+        mSlots[theSlot].mParams.store(inParams, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Otherwise, take the first free slot in the client's probe sequence. FindSlot has already
+    // checked the whole sequence, so reusing a removed slot won't create a duplicate.
+    theSlot = HomeSlot(inClientID);
+
+    for(UInt32 i = 0; i < kCapacity; i++, theSlot = NextSlot(theSlot))
+    {
+        UInt32 theSlotClientID = mSlots[theSlot].mClientID.load(std::memory_order_relaxed);
+
+        if(theSlotClientID == kEmptySlot || theSlotClientID == kRemovedSlot)
+        {
+            // A reader might still be reading this slot's previous client. The fence makes sure
+            // that, if it sees the new settings, it will also see that the slot's client ID has
+            // changed. (See GetParamsRT.)
+            std::atomic_thread_fence(std::memory_order_release);
+            mSlots[theSlot].mParams.store(inParams, std::memory_order_relaxed);
+            // Publish the settings along with the client ID.
+            mSlots[theSlot].mClientID.store(inClientID, std::memory_order_release);
+            return true;
+        }
+    }
+
+    DebugMsg("EFF_ClientParamsTable::SetParams: Table full. Client %u will use the default settings",
+             inClientID);
+    return false;
+}
+
+void    EFF_ClientParamsTable::EraseClient(UInt32 inClientID)
+{
+    UInt32 theSlot = FindSlot(inClientID);
+
+    if(theSlot == kCapacity)
+    {
+        return;
+    }
+
+    mSlots[theSlot].mClientID.store(kRemovedSlot, std::memory_order_release);
+
+    // If the slot after this one is empty, no probe sequence continues past this slot, so we can mark
+    // it, and any removed slots directly before it, as empty. This stops removed slots from building
+    // up as clients come and go, which would make lookups for missing clients slower.
+    if(mSlots[NextSlot(theSlot)].mClientID.load(std::memory_order_relaxed) == kEmptySlot)
+    {
+        for(UInt32 i = 0;
+            i < kCapacity && mSlots[theSlot].mClientID.load(std::memory_order_relaxed) == kRemovedSlot;
+            i++, theSlot = (theSlot - 1) & (kCapacity - 1))
+        {
+            mSlots[theSlot].mClientID.store(kEmptySlot, std::memory_order_release);
+        }
+    }
+}
+
+UInt32  EFF_ClientParamsTable::FindSlot(UInt32 inClientID)
+const
+{
+    UInt32 theSlot = HomeSlot(inClientID);
+
+    for(UInt32 i = 0; i < kCapacity; i++, theSlot = NextSlot(theSlot))
+    {
+        UInt32 theSlotClientID = mSlots[theSlot].mClientID.load(std::memory_order_relaxed);
+
+        if(theSlotClientID == inClientID)
+        {
+            return theSlot;
+        }
+
+        if(theSlotClientID == kEmptySlot)
+        {
+            break;
+        }
+    }
+
+    return kCapacity;
+}
+
+#pragma mark Reader API
+
+bool    EFF_ClientParamsTable::GetParamsRT(UInt32 inClientID,
+                                           EFF_ClientIOParams& outParams,
+                                           EFF_ClientRampState* __nullable * __nullable outRampState)
+const
+{
+    UInt32 theSlot = HomeSlot(inClientID);
+
+    for(UInt32 i = 0; i < kCapacity; i++, theSlot = NextSlot(theSlot))
+    {
+        UInt32 theSlotClientID = mSlots[theSlot].mClientID.load(std::memory_order_acquire);
+
+        if(theSlotClientID == inClientID)
+        {
+            EFF_ClientIOParams theParams = mSlots[theSlot].mParams.load(std::memory_order_relaxed);
+
+            // Check the slot wasn't given to another client while we were reading it. Pairs with the
+            // fence in SetParams.
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if(mSlots[theSlot].mClientID.load(std::memory_order_relaxed) == inClientID)
+            {
+                outParams = theParams;
+
+                if(outRampState)
+                {
+                    *outRampState = &mSlots[theSlot].mRampState;
+                }
+
+                return true;
+            }
+
+            // The client was removed, so treat it as missing.
+            break;
+        }
+
+        if(theSlotClientID == kEmptySlot)
+        {
+            break;
+        }
+    }
+
+    outParams = EFF_ClientIOParams();
+
+    if(outRampState)
+    {
+        *outRampState = nullptr;
+    }
+
+    return false;
+}
+
+bool    EFF_ClientParamsTable::GetParamsForCycleRT(UInt64 inIOCycle,
+                                                   UInt32 inClientID,
+                                                   EFF_ClientIOParams& outParams,
+                                                   EFF_ClientRampState* __nullable * __nullable outRampState)
+const
+{
+    if(inIOCycle != mCycleCopyIOCycle)
+    {
+        mCycleCopyIOCycle = inIOCycle;
+        UpdateCycleCopyRT();
+    }
+
+    const std::array<CopiedSlot, kCapacity>& theCopy = mCycleCopies[mCurrentCycleCopy];
+    UInt32 theSlot = HomeSlot(inClientID);
+
+    for(UInt32 i = 0; i < kCapacity; i++, theSlot = NextSlot(theSlot))
+    {
+        if(theCopy[theSlot].mClientID == inClientID)
+        {
+            outParams = theCopy[theSlot].mParams;
+
+            if(outRampState)
+            {
+                *outRampState = &mSlots[theSlot].mRampState;
+            }
+
+            return true;
+        }
+
+        if(theCopy[theSlot].mClientID == kEmptySlot)
+        {
+            break;
+        }
+    }
+
+    outParams = EFF_ClientIOParams();
+
+    if(outRampState)
+    {
+        *outRampState = nullptr;
+    }
+
+    return false;
+}
+
+void    EFF_ClientParamsTable::UpdateCycleCopyRT()
+const
+{
+    UInt64 theSequence = mBatchSequence.load(std::memory_order_acquire);
+
+    // Nothing has been published since the last copy, or a batch is half written.
+    if(theSequence == mCycleCopySequence || (theSequence & 1) != 0)
+    {
+        return;
+    }
+
+    std::array<CopiedSlot, kCapacity>& theCopy = mCycleCopies[mCurrentCycleCopy ^ 1];
+
+    for(UInt32 theSlot = 0; theSlot < kCapacity; theSlot++)
+    {
+        theCopy[theSlot].mClientID = mSlots[theSlot].mClientID.load(std::memory_order_relaxed);
+        theCopy[theSlot].mParams = mSlots[theSlot].mParams.load(std::memory_order_relaxed);
+    }
+
+    // If another batch started while we were copying, the copy might have some of its changes, so
+    // keep using the old copy. Pairs with the fence in BeginBatch.
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(mBatchSequence.load(std::memory_order_relaxed) != theSequence)
+    {
+        return;
+    }
+
+    mCurrentCycleCopy ^= 1;
+    mCycleCopySequence = theSequence;
+}
+
+#pragma mark Ramp State
+
+void    EFF_ClientRampState::UpdateTargets(UInt32 inClientID, const EFF_ClientIOParams& inParams)
+{
+    Float32 thePanPosition = static_cast<Float32>(inParams.mPanPosition) / 100.0f;
+
+    if(mClientID != inClientID)
+    {
+        mClientID = inClientID;
+        mRelativeVolume.Reset(inParams.mRelativeVolume);
+        mPanPosition.Reset(thePanPosition);
+        return;
+    }
+
+    if(mRelativeVolume.GetTarget() != inParams.mRelativeVolume)
+    {
+        mRelativeVolume.SetTarget(inParams.mRelativeVolume,
+                                  inParams.mRampFrames,
+                                  inParams.mExponentialRamp ? EFF_ParamRamp::kShapeExponential
+                                                            : EFF_ParamRamp::kShapeLinear);
+    }
+
+    if(mPanPosition.GetTarget() != thePanPosition)
+    {
+        mPanPosition.SetTarget(thePanPosition, inParams.mRampFrames, EFF_ParamRamp::kShapeLinear);
+    }
+}
+
+#pragma clang assume_nonnull end
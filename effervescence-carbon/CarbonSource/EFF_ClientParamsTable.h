@@ -0,0 +1,207 @@
+//
+//  EFF_ClientParamsTable.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A fixed-capacity, open-addressed table of the per-client settings the IO thread needs for each
+//  ProcessOutput call, keyed by client ID.
+//
+//  EFF_ClientMap keeps the full EFF_Client objects in std::maps, which IO can only read by locking
+//  mMapsMutex and copying the client (including its CACFString, i.e. a CFRetain/CFRelease pair).
+//  This table is updated alongside the maps and can be read from real-time threads without taking
+//  any locks, allocating or touching refcounts. Each client's settings are packed into a single
+//  8-byte atomic, so a reader always gets a consistent set of values from one load.
+//
+//  Changes can be grouped into batches, which the IO thread sees all at once. GetParamsRT only
+//  makes each client's settings consistent, so a reader could see some of a batch's changes and
+//  not others. GetParamsForCycleRT reads from a private copy of the table instead, which the IO
+//  thread takes at the start of each cycle, and only between batches, so every client it looks up
+//  in a cycle has the settings from the same batch.
+//
+//  Only one thread may modify the table at a time. (EFF_ClientMap only modifies it while holding
+//  its maps mutex.) Any number of threads can read from it concurrently with GetParamsRT, but only
+//  the IO thread can use GetParamsForCycleRT.
+//
+
+#ifndef EFF_ClientParamsTable_h
+#define EFF_ClientParamsTable_h
+
+// Local Includes
+#include "EFF_Types.h"
+#include "EFF_ParamRamp.h"
+
+// STL Includes
+#include <array>
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The settings for a client that are used during IO. Packed into 8 bytes so they can be loaded and
+// stored atomically.
+struct EFF_ClientIOParams
+{
+                                EFF_ClientIOParams()
+                                :
+                                    mRelativeVolume(1.0f),
+                                    mPanPosition(kAppPanCenterRawValue),
+                                    mIsMusicPlayer(false),
+                                    mExponentialRamp(false),
+                                    mHasAppLoopbackPair(false),
+                                    mAppLoopbackPair(0),
+                                    mRampFrames(0) { }
+
+    // See EFF_Client::mRelativeVolume.
+    Float32                     mRelativeVolume;
+    // See EFF_Client::mPanPosition. Always in [-100, 100].
+    SInt8                       mPanPosition;
+    // See EFF_Client::mIsMusicPlayer.
+    bool                        mIsMusicPlayer      : 1;
+    // True if EFF_Client::mRampShape is kEFFAppVolumeRampShapeExponential.
+    bool                        mExponentialRamp    : 1;
+    // True if EFF_Client::mAppLoopbackPair isn't -1, in which case mAppLoopbackPair is its value.
+    bool                        mHasAppLoopbackPair : 1;
+    UInt8                       mAppLoopbackPair    : 4;
+    // See EFF_Client::mRampFrames. Never more than kAppRampMaxFrames.
+    UInt16                      mRampFrames;
+};
+
+// The IO thread's state for smoothing changes to a client's settings. Each slot in
+// EFF_ClientParamsTable has one of these, but unlike the rest of the table they are only ever used
+// by the IO thread, so they don't need to be atomic.
+struct EFF_ClientRampState
+{
+    // Moves the ramps towards inParams if they've changed since the last call. If the state was last
+    // used for a different client, which happens when a slot is reused, it jumps to inParams instead.
+    void                        UpdateTargets(UInt32 inClientID, const EFF_ClientIOParams& inParams);
+
+    // The client this state belongs to.
+    UInt32                      mClientID           = UINT32_MAX;
+    EFF_ParamRamp               mRelativeVolume;
+    // The pan position in [-1, 1].
+    EFF_ParamRamp               mPanPosition;
+};
+
+class EFF_ClientParamsTable
+{
+
+public:
+    // The maximum number of clients the table can hold. Clients beyond this are treated as having
+    // the default settings. Must be a power of two. The HAL usually has far fewer clients
+    // registered than this, which keeps the probe sequences short.
+    static const UInt32         kCapacity = 1024;
+
+#pragma mark Construction/Destruction
+
+                                EFF_ClientParamsTable() = default;
+                                // Disallow copying
+                                EFF_ClientParamsTable(const EFF_ClientParamsTable&) = delete;
+                                EFF_ClientParamsTable& operator=(const EFF_ClientParamsTable&) = delete;
+
+#pragma mark Writer API
+
+    // Adds the client to the table or, if it's already in it, replaces its settings. Returns false
+    // if the table is full. Writer thread only.
+    bool                        SetParams(UInt32 inClientID, EFF_ClientIOParams inParams);
+    // Does nothing if the client isn't in the table. Writer thread only.
+    void                        RemoveClient(UInt32 inClientID);
+
+    // The changes made between BeginBatch and EndBatch are published to GetParamsForCycleRT
+    // together. SetParams and RemoveClient calls outside a batch are each published on their own.
+    // Batches can't be nested. Writer thread only.
+    void                        BeginBatch();
+    void                        EndBatch();
+
+#pragma mark Reader API
+
+    // Real-time safe and wait-free. Returns false and sets outParams to the default settings if the
+    // client isn't in the table.
+    //
+    // If outRampState isn't null, it's set to the client's ramp state, or null if the client isn't
+    // in the table. Only the IO thread may ask for the ramp state.
+    bool                        GetParamsRT(UInt32 inClientID,
+                                            EFF_ClientIOParams& outParams,
+                                            EFF_ClientRampState* __nullable * __nullable outRampState = nullptr) const;
+
+    // The same as GetParamsRT, except that every call with the same inIOCycle reads the same copy
+    // of the table, so a batch is either seen in full or not at all for the whole cycle. The copy
+    // is taken by the first call in each cycle, if a batch has been published since the last one.
+    // If a batch is being written at the time, the cycle keeps using the last copy. IO thread only.
+    bool                        GetParamsForCycleRT(UInt64 inIOCycle,
+                                                    UInt32 inClientID,
+                                                    EFF_ClientIOParams& outParams,
+                                                    EFF_ClientRampState* __nullable * __nullable outRampState = nullptr) const;
+
+#pragma mark Implementation
+
+private:
+    // Client IDs used to mark slots that have never been used and slots whose client was removed.
+    // (The HAL assigns client IDs incrementally, so it won't realistically use either value.)
+    static const UInt32         kEmptySlot          = UINT32_MAX;
+    static const UInt32         kRemovedSlot        = UINT32_MAX - 1;
+
+    static UInt32               HomeSlot(UInt32 inClientID)
+                                    { return (inClientID * 2654435761u) & (kCapacity - 1); }
+    static UInt32               NextSlot(UInt32 inSlot)
+                                    { return (inSlot + 1) & (kCapacity - 1); }
+
+    // Returns kCapacity if the client isn't in the table. Writer thread only.
+    UInt32                      FindSlot(UInt32 inClientID) const;
+
+    // SetParams and RemoveClient without starting their own batches.
+    bool                        StoreParams(UInt32 inClientID, EFF_ClientIOParams inParams);
+    void                        EraseClient(UInt32 inClientID);
+
+    // Copies the table into the IO thread's spare copy and switches to it, unless nothing has been
+    // published since the last copy or a batch is being written. IO thread only.
+    void                        UpdateCycleCopyRT() const;
+
+    struct Slot
+    {
+        std::atomic<UInt32>                 mClientID   { kEmptySlot };
+        std::atomic<EFF_ClientIOParams>     mParams     { EFF_ClientIOParams() };
+        // Only used by the IO thread. See EFF_ClientRampState.
+        mutable EFF_ClientRampState         mRampState;
+    };
+
+    // A slot in the IO thread's copies of the table. Copied slots are at the same indices as in
+    // mSlots, so their ramp states are still found in mSlots.
+    struct CopiedSlot
+    {
+        UInt32                              mClientID   = kEmptySlot;
+        EFF_ClientIOParams                  mParams;
+    };
+
+    static_assert(sizeof(EFF_ClientIOParams) == 8, "EFF_ClientIOParams should be packed into 8 bytes");
+    static_assert(kEFFAppLoopbackMaxPairs <= 16, "EFF_ClientIOParams::mAppLoopbackPair is only 4 bits");
+    static_assert(std::atomic<EFF_ClientIOParams>::is_always_lock_free,
+                  "EFF_ClientIOParams must be small enough to load and store atomically");
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+    std::array<Slot, kCapacity> mSlots;
+
+    // A sequence lock around the batches. Odd while a batch is being written and incremented again
+    // when it's published.
+    std::atomic<UInt64>         mBatchSequence      { 0 };
+    // True between BeginBatch and EndBatch. Writer thread only.
+    bool                        mInBatch            = false;
+
+    // The IO thread's copies of the table. It reads from mCycleCopies[mCurrentCycleCopy] and copies
+    // the table into the other one. Both start out empty, matching the empty table.
+    mutable std::array<CopiedSlot, kCapacity>   mCycleCopies[2];
+    mutable UInt32              mCurrentCycleCopy   = 0;
+    // The mBatchSequence value the current copy was taken at.
+    mutable UInt64              mCycleCopySequence  = 0;
+    // The IO cycle the current copy is being used for.
+    mutable UInt64              mCycleCopyIOCycle   = UINT64_MAX;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_ClientParamsTable_h */
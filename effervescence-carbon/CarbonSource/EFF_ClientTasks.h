@@ -5,7 +5,7 @@
 //  Created by Nerrons on 26/3/20.
 //  Copyright © 2020 nerrons. All rights reserved.
 //
-//  The interface between the client classes (EFF_Client, EFF_Clients and EFF_ClientMap) and EFF_TaskQueue.
+//  The interface between EFF_Clients and EFF_TaskQueue.
 //
 
 #ifndef EFF_ClientTasks_h
@@ -13,7 +13,6 @@
 
 // Local Includes
 #include "EFF_Clients.h"
-#include "EFF_ClientMap.h"
 
 
 // Forward Declarations
@@ -31,8 +30,6 @@ private:
                                     { return inClients->StartIONonRT(inClientID); }
     static bool                 StopIONonRT(EFF_Clients* inClients, UInt32 inClientID)
                                     { return inClients->StopIONonRT(inClientID); }
-    static void                 SwapInShadowMapsRT(EFF_ClientMap* inClientMap)
-                                    { inClientMap->SwapInShadowMapsRT(); }
 };
 
 #pragma clang assume_nonnull end
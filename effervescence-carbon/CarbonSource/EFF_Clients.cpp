@@ -12,20 +12,29 @@
 // Local Includes
 #include "EFF_Types.h"
 #include "EFF_PlugIn.h"
+#include "EFF_Utils.h"
 
 // PublicUtility Includes
 #include "CAException.h"
 #include "CACFDictionary.h"
 #include "CADispatchQueue.h"
 
+// STL Includes
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// System Includes
+#include <string.h>
+
 
 #pragma mark Construction/Destruction
 
-EFF_Clients::EFF_Clients(AudioObjectID inOwnerDeviceID,
-                         EFF_TaskQueue* inTaskQueue)
+EFF_Clients::EFF_Clients(AudioObjectID inOwnerDeviceID)
 :
     mOwnerDeviceID(inOwnerDeviceID),
-    mClientMap(inTaskQueue)
+    mEFFAppBundleIDAtom(EFF_BundleIDTable::GetInstance().Intern(CFSTR(kEFFAppBundleID)))
 {
     mRelativeVolumeCurve.AddRange(kAppRelativeVolumeMinRawValue,
                                   kAppRelativeVolumeMaxRawValue,
@@ -40,13 +49,14 @@ void    EFF_Clients::AddClient(EFF_Client inClient)
 {
     CAMutex::Locker theLocker(mMutex);
 
+    ResolveBundleIDAtoms(inClient);
+
     // Check whether this is the music player's client
     bool pidMatchesMusicPlayerProperty =
         (mMusicPlayerProcessIDProperty != 0 && inClient.mProcessID == mMusicPlayerProcessIDProperty);
     bool bundleIDMatchesMusicPlayerProperty =
-        (mMusicPlayerBundleIDProperty != "" &&
-         inClient.mBundleID.IsValid() &&
-         inClient.mBundleID == mMusicPlayerBundleIDProperty);
+        (mMusicPlayerBundleIDAtom != kEFFNoBundleIDAtom &&
+         inClient.mBundleIDAtom == mMusicPlayerBundleIDAtom);
     inClient.mIsMusicPlayer = (pidMatchesMusicPlayerProperty || bundleIDMatchesMusicPlayerProperty);
 
     if(inClient.mIsMusicPlayer)
@@ -54,12 +64,16 @@ void    EFF_Clients::AddClient(EFF_Client inClient)
         DebugMsg("EFF_Clients::AddClient: Adding music player client. mClientID = %u", inClient.mClientID);
     }
 
+    // Give it its pair in the per-app loopback stream, if its app is selected.
+    inClient.mAppLoopbackPair = GetAppLoopbackPair(inClient);
+
     mClientMap.AddClient(inClient);
 
     // If we're adding EFFApp, update our local copy of its client ID
-    if(inClient.mBundleID.IsValid() && inClient.mBundleID == kEFFAppBundleID)
+    if(inClient.mBundleIDAtom == mEFFAppBundleIDAtom)
     {
         mEFFAppClientID = inClient.mClientID;
+        mEFFAppProcessID = inClient.mProcessID;
     }
 }
 
@@ -73,9 +87,17 @@ void    EFF_Clients::RemoveClient(const UInt32 inClientID)
     if(theRemovedClient.mClientID == mEFFAppClientID)
     {
         mEFFAppClientID = -1;
+        mEFFAppProcessID = 0;
     }
 }
 
+bool    EFF_Clients::IsEFFAppProcess(pid_t inProcessID)
+const
+{
+    CAMutex::Locker theLocker(mMutex);
+    return (mEFFAppClientID != -1) && (inProcessID == mEFFAppProcessID);
+}
+
 
 #pragma mark IO Status
 
@@ -104,7 +126,7 @@ bool    EFF_Clients::StartIONonRT(UInt32 inClientID)
 
         DebugMsg("EFF_Clients::StartIO: Client %u (%s, %d) starting IO",
                  inClientID,
-                 CFStringGetCStringPtr(theClient.mBundleID.GetCFString(), kCFStringEncodingUTF8),
+                 CFStringGetCStringPtr(theClient.GetBundleID().GetCFString(), kCFStringEncodingUTF8),
                  theClient.mProcessID);
         
         mClientMap.StartIONonRT(inClientID);
@@ -160,7 +182,7 @@ bool    EFF_Clients::StopIONonRT(UInt32 inClientID)
     {
         DebugMsg("EFF_Clients::StopIO: Client %u (%s, %d) stopping IO",
                  inClientID,
-                 CFStringGetCStringPtr(theClient.mBundleID.GetCFString(), kCFStringEncodingUTF8),
+                 CFStringGetCStringPtr(theClient.GetBundleID().GetCFString(), kCFStringEncodingUTF8),
                  theClient.mProcessID);
         
         mClientMap.StopIONonRT(inClientID);
@@ -206,7 +228,7 @@ const
 {
     if(sendIsRunningNotification || sendIsRunningSomewhereOtherThanEFFAppNotification)
     {
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
             AudioObjectPropertyAddress theChangedProperties[2];
             UInt32 theNotificationCount = 0;
 
@@ -248,6 +270,7 @@ bool    EFF_Clients::SetMusicPlayer(const pid_t inPID)
     mMusicPlayerProcessIDProperty = inPID;
     // Unset the bundle ID property
     mMusicPlayerBundleIDProperty = "";
+    mMusicPlayerBundleIDAtom = kEFFNoBundleIDAtom;
     
     DebugMsg("EFF_Clients::SetMusicPlayer: Setting music player by PID. inPID=%d", inPID);
     
@@ -270,6 +293,11 @@ bool    EFF_Clients::SetMusicPlayer(const CACFString inBundleID)
     }
 
     mMusicPlayerBundleIDProperty = inBundleID;
+    // Only look it up. If no client has this bundle ID yet, AddClient will find the atom when one is
+    // added.
+    mMusicPlayerBundleIDAtom = (inBundleID == "")
+                               ? kEFFNoBundleIDAtom
+                               : EFF_BundleIDTable::GetInstance().Find(inBundleID.GetCFString());
     // Unset the PID property
     mMusicPlayerProcessIDProperty = 0;
     
@@ -282,37 +310,191 @@ bool    EFF_Clients::SetMusicPlayer(const CACFString inBundleID)
     return true;
 }
 
-bool    EFF_Clients::IsMusicPlayerRT(const UInt32 inClientID)
+#pragma mark Per-App Loopback
+
+CACFArray   EFF_Clients::CopyAppLoopbackSelection()
 const
 {
-    EFF_Client theClient;
-    bool didGetClient = mClientMap.GetClientRT(inClientID, &theClient);
-    return didGetClient && theClient.mIsMusicPlayer;
+    CAMutex::Locker theLocker(mMutex);
+    
+    CACFArray theSelection(false);
+    
+    for(const AppLoopbackSelection& thePair : mAppLoopbackSelection)
+    {
+        CACFDictionary theApp(false);
+        
+        if(thePair.mProcessID != 0)
+        {
+            theApp.AddSInt32(CFSTR(kEFFAppLoopbackKey_ProcessID), thePair.mProcessID);
+        }
+        else
+        {
+            theApp.AddString(CFSTR(kEFFAppLoopbackKey_BundleID), thePair.mBundleID.GetCFString());
+        }
+        
+        theSelection.AppendDictionary(theApp.GetDict());
+    }
+    
+    return theSelection;
 }
 
-#pragma mark App Volumes
+bool    EFF_Clients::SetAppLoopbackSelection(const CACFArray inSelection)
+{
+    ThrowIf(inSelection.GetNumberItems() > kEFFAppLoopbackMaxPairs,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_Clients::SetAppLoopbackSelection: Too many apps selected");
+    
+    // Read and validate the whole selection before changing anything.
+    std::vector<AppLoopbackSelection> theSelection;
+    theSelection.reserve(inSelection.GetNumberItems());
+    
+    for(UInt32 i = 0; i < inSelection.GetNumberItems(); i++)
+    {
+        CACFDictionary theApp(false);
+        inSelection.GetCACFDictionary(i, theApp);
+        
+        ThrowIf(!theApp.IsValid(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "EFF_Clients::SetAppLoopbackSelection: Selection wasn't a CFDictionary");
+        
+        SInt32 thePID = 0;
+        bool hasPID = theApp.GetSInt32(CFSTR(kEFFAppLoopbackKey_ProcessID), thePID);
+        CFStringRef theBundleID = nullptr;
+        bool hasBundleID = theApp.GetString(CFSTR(kEFFAppLoopbackKey_BundleID), theBundleID) &&
+                           (theBundleID != nullptr);
+        
+        ThrowIf(hasPID == hasBundleID,
+                CAException(kAudioHardwareIllegalOperationError),
+                "EFF_Clients::SetAppLoopbackSelection: Apps must be selected by either PID or bundle ID");
+        ThrowIf(hasPID && (thePID <= 0),
+                CAException(kAudioHardwareIllegalOperationError),
+                "EFF_Clients::SetAppLoopbackSelection: Invalid PID");
+        
+        AppLoopbackSelection thePair;
+        
+        if(hasPID)
+        {
+            thePair.mProcessID = thePID;
+        }
+        else
+        {
+            CFRetain(theBundleID);
+            thePair.mBundleID = CACFString(theBundleID);
+            // Only look it up. If the app isn't a client yet, AddClient will find the atom when it's
+            // added.
+            thePair.mBundleIDAtom = EFF_BundleIDTable::GetInstance().Find(theBundleID);
+        }
+        
+        theSelection.push_back(thePair);
+    }
+    
+    CAMutex::Locker theLocker(mMutex);
+    
+    bool isSameSelection =
+        std::equal(theSelection.begin(), theSelection.end(),
+                   mAppLoopbackSelection.begin(), mAppLoopbackSelection.end(),
+                   [] (const AppLoopbackSelection& inA, const AppLoopbackSelection& inB) {
+                       // Compare the strings because the atoms might not have been found yet.
+                       return (inA.mProcessID == inB.mProcessID) &&
+                              (inA.mBundleID.IsValid() == inB.mBundleID.IsValid()) &&
+                              (!inA.mBundleID.IsValid() || inA.mBundleID == inB.mBundleID);
+                   });
+    
+    if(isSameSelection)
+    {
+        return false;
+    }
+    
+    DebugMsg("EFF_Clients::SetAppLoopbackSelection: Selecting %lu apps",
+             static_cast<unsigned long>(theSelection.size()));
+    
+    mAppLoopbackSelection.swap(theSelection);
+    
+    // Move the clients to their new pairs.
+    mClientMap.UpdateAppLoopbackPairs([&] (const EFF_Client& inClient) {
+        return GetAppLoopbackPair(inClient);
+    });
+    
+    return true;
+}
 
-// not sure if we should differentiate "client not found" and "client doesn't have custom volume"
-Float32 EFF_Clients::GetClientRelativeVolumeRT(UInt32 inClientID)
+UInt32  EFF_Clients::GetAppLoopbackPairCount()
 const
 {
-    EFF_Client theClient;
-    bool didGetClient = mClientMap.GetClientRT(inClientID, &theClient);
-    return (didGetClient ? theClient.mRelativeVolume : 1.0f);
+    CAMutex::Locker theLocker(mMutex);
+    return static_cast<UInt32>(mAppLoopbackSelection.size());
+}
+
+void    EFF_Clients::ResolveBundleIDAtoms(const EFF_Client& inNewClient)
+{
+    // The client's bundle ID was interned when it was registered, so the only atom we could be
+    // missing now is the client's.
+    if(inNewClient.mBundleIDAtom == kEFFNoBundleIDAtom)
+    {
+        return;
+    }
+    
+    const CACFString theBundleID = inNewClient.GetBundleID();
+    
+    if(mMusicPlayerBundleIDAtom == kEFFNoBundleIDAtom &&
+       mMusicPlayerBundleIDProperty != "" &&
+       mMusicPlayerBundleIDProperty == theBundleID)
+    {
+        mMusicPlayerBundleIDAtom = inNewClient.mBundleIDAtom;
+    }
+    
+    for(AppLoopbackSelection& thePair : mAppLoopbackSelection)
+    {
+        if(thePair.mBundleIDAtom == kEFFNoBundleIDAtom &&
+           thePair.mBundleID.IsValid() &&
+           thePair.mBundleID == theBundleID)
+        {
+            thePair.mBundleIDAtom = inNewClient.mBundleIDAtom;
+        }
+    }
 }
 
-// same for this one, see GetClientRelativeVolumeRT(UInt32)
-SInt32 EFF_Clients::GetClientPanPositionRT(UInt32 inClientID)
+SInt32  EFF_Clients::GetAppLoopbackPair(const EFF_Client& inClient)
 const
 {
-    EFF_Client theClient;
-    bool didGetClient = mClientMap.GetClientRT(inClientID, &theClient);
-    return (didGetClient ? theClient.mPanPosition : kAppPanCenterRawValue);
+    for(size_t i = 0; i < mAppLoopbackSelection.size(); i++)
+    {
+        const AppLoopbackSelection& thePair = mAppLoopbackSelection[i];
+        
+        bool pidMatches = (thePair.mProcessID != 0 && inClient.mProcessID == thePair.mProcessID);
+        bool bundleIDMatches = (thePair.mBundleIDAtom != kEFFNoBundleIDAtom &&
+                                inClient.mBundleIDAtom == thePair.mBundleIDAtom);
+        
+        if(pidMatches || bundleIDMatches)
+        {
+            return static_cast<SInt32>(i);
+        }
+    }
+    
+    return -1;
 }
 
+#pragma mark IO
+
+// not sure if we should differentiate "client not found" and "client doesn't have custom volume"
+EFF_ClientIOParams  EFF_Clients::GetClientIOParamsRT(UInt64 inIOCycle,
+                                                     UInt32 inClientID,
+                                                     EFF_ClientRampState* __nullable * __nullable outRampState)
+const
+{
+    EFF_ClientIOParams theParams;
+    mClientMap.GetClientIOParamsForCycleRT(inIOCycle, inClientID, theParams, outRampState);
+    return theParams;
+}
+
+#pragma mark App Volumes
+
 bool    EFF_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
 {
-    bool didChangeAppVolumes = false;
+    // Read and validate all of the changes before applying any of them, so an invalid entry doesn't
+    // leave the apps half-updated.
+    std::vector<AppVolumeChange> theChanges;
+    theChanges.reserve(inAppVolumes.GetNumberItems());
     
     // Each element in appVolumes is a CFDictionary containing the process id and/or bundle id of an app, and its
     // new relative volume
@@ -321,28 +503,52 @@ bool    EFF_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
         CACFDictionary theAppVolume(false);
         inAppVolumes.GetCACFDictionary(i, theAppVolume);
         
+        AppVolumeChange theChange;
+        
         // Get the app's PID from the dict
-        pid_t theAppPID;
-        bool didFindPID = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_ProcessID), theAppPID);
+        theChange.mHasPID = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_ProcessID), theChange.mAppPID);
         
         // Get the app's bundle ID from the dict
-        CACFString theAppBundleID;
-        theAppBundleID.DontAllowRelease();
-        theAppVolume.GetCACFString(CFSTR(kEFFAppVolumesKey_BundleID), theAppBundleID);
+        theChange.mAppBundleID.DontAllowRelease();
+        theAppVolume.GetCACFString(CFSTR(kEFFAppVolumesKey_BundleID), theChange.mAppBundleID);
         
-        ThrowIf(!didFindPID && !theAppBundleID.IsValid(),
+        ThrowIf(!theChange.mHasPID && !theChange.mAppBundleID.IsValid(),
                 EFF_InvalidClientRelativeVolumeException(),
                 "EFF_Clients::SetClientsRelativeVolumes: App volume was sent without PID or bundle ID for app");
         
-        bool didGetVolume;
+        // Get the optional ramp settings, which apply to both the volume and the pan position.
+        {
+            SInt32 theRawRampFrames;
+            if(theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_RampFrames), theRawRampFrames))
+            {
+                ThrowIf(theRawRampFrames < 0 || theRawRampFrames > kAppRampMaxFrames,
+                        EFF_InvalidClientRelativeVolumeException(),
+                        "EFF_Clients::SetClientsRelativeVolumes: Ramp length for app out of valid range");
+                
+                theChange.mRampFrames = static_cast<UInt32>(theRawRampFrames);
+            }
+        }
+        
+        {
+            SInt32 theRawRampShape;
+            if(theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_RampShape), theRawRampShape))
+            {
+                ThrowIf(theRawRampShape != kEFFAppVolumeRampShapeLinear &&
+                        theRawRampShape != kEFFAppVolumeRampShapeExponential,
+                        EFF_InvalidClientRelativeVolumeException(),
+                        "EFF_Clients::SetClientsRelativeVolumes: Unknown ramp shape for app");
+                
+                theChange.mRampShape = static_cast<EFFAppVolumeRampShape>(theRawRampShape);
+            }
+        }
+        
         {
             SInt32 theRawRelativeVolume;
-            didGetVolume = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_RelativeVolume), theRawRelativeVolume);
+            theChange.mHasVolume = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_RelativeVolume), theRawRelativeVolume);
             
-            if (didGetVolume) {
-                ThrowIf(didGetVolume &&
-                        (theRawRelativeVolume < kAppRelativeVolumeMinRawValue ||
-                         theRawRelativeVolume > kAppRelativeVolumeMaxRawValue),
+            if (theChange.mHasVolume) {
+                ThrowIf(theRawRelativeVolume < kAppRelativeVolumeMinRawValue ||
+                        theRawRelativeVolume > kAppRelativeVolumeMaxRawValue,
                         EFF_InvalidClientRelativeVolumeException(),
                         "EFF_Clients::SetClientsRelativeVolumes: Relative volume for app out of valid range");
                 
@@ -350,54 +556,313 @@ bool    EFF_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
                 //
                 // mRelativeVolumeCurve uses the default kPow2Over1Curve transfer function, so we also multiply by 4 to
                 // keep the middle volume equal to 1 (meaning apps' volumes are unchanged by default).
-                Float32 theRelativeVolume = mRelativeVolumeCurve.ConvertRawToScalar(theRawRelativeVolume) * 4;
-
-                // Try to update the client's volume, first by PID and then by bundle ID. Always try
-                // both because apps can have multiple clients.
-                if(mClientMap.SetClientsRelativeVolume(theAppPID, theRelativeVolume))
-                {
-                    didChangeAppVolumes = true;
-                }
-
-                if(mClientMap.SetClientsRelativeVolume(theAppBundleID, theRelativeVolume))
-                {
-                    didChangeAppVolumes = true;
-                }
-
-                // TODO: If the app isn't currently a client, we should add it to the past clients
-                //       map, or update its past volume if it's already in there.
+                theChange.mRelativeVolume = mRelativeVolumeCurve.ConvertRawToScalar(theRawRelativeVolume) * 4;
             }
         }
         
-        bool didGetPanPosition;
         {
-            SInt32 thePanPosition;
-            didGetPanPosition = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_PanPosition), thePanPosition);
-            if (didGetPanPosition) {
-                ThrowIf(didGetPanPosition && (thePanPosition < kAppPanLeftRawValue || thePanPosition > kAppPanRightRawValue),
-                                              EFF_InvalidClientPanPositionException(),
-                                              "EFF_Clients::SetClientsRelativeVolumes: Pan position for app out of valid range");
-                
-                if(mClientMap.SetClientsPanPosition(theAppPID, thePanPosition))
-                {
-                    didChangeAppVolumes = true;
-                }
-
-                if(mClientMap.SetClientsPanPosition(theAppBundleID, thePanPosition))
-                {
-                    didChangeAppVolumes = true;
-                }
-
-                // TODO: If the app isn't currently a client, we should add it to the past clients
-                //       map, or update its past pan position if it's already in there.
+            theChange.mHasPanPosition = theAppVolume.GetSInt32(CFSTR(kEFFAppVolumesKey_PanPosition), theChange.mPanPosition);
+            
+            if (theChange.mHasPanPosition) {
+                ThrowIf(theChange.mPanPosition < kAppPanLeftRawValue || theChange.mPanPosition > kAppPanRightRawValue,
+                        EFF_InvalidClientPanPositionException(),
+                        "EFF_Clients::SetClientsRelativeVolumes: Pan position for app out of valid range");
             }
         }
         
-        ThrowIf(!didGetVolume && !didGetPanPosition,
+        ThrowIf(!theChange.mHasVolume && !theChange.mHasPanPosition,
                 EFF_InvalidClientRelativeVolumeException(),
                 "EFF_Clients::SetClientsRelativeVolumes: No volume or pan position in request");
+        
+        theChanges.push_back(theChange);
+    }
+    
+    return ApplyAppVolumeChanges(theChanges);
+}
+
+bool    EFF_Clients::ApplyAppVolumeChanges(const std::vector<AppVolumeChange>& inChanges)
+{
+    // Apply all of the changes in one transaction so the IO thread gets them together and we only
+    // publish the clients once, however many apps were changed.
+    bool didChangeAppVolumes = false;
+    EFF_ClientMap::Transaction theTransaction(mClientMap);
+    
+    for(const AppVolumeChange& theChange : inChanges)
+    {
+        // Try to update the clients first by PID and then by bundle ID. Always try both because apps
+        // can have multiple clients.
+        //
+        // TODO: If the app isn't currently a client, we should add it to the past clients map, or
+        //       update its past volume/pan position if it's already in there.
+        if(theChange.mHasVolume)
+        {
+            if(theChange.mHasPID &&
+               theTransaction.SetClientsRelativeVolume(theChange.mAppPID,
+                                                       theChange.mRelativeVolume,
+                                                       theChange.mRampFrames,
+                                                       theChange.mRampShape))
+            {
+                didChangeAppVolumes = true;
+            }
+            
+            if(theChange.mAppBundleID.IsValid() &&
+               theTransaction.SetClientsRelativeVolume(theChange.mAppBundleID,
+                                                       theChange.mRelativeVolume,
+                                                       theChange.mRampFrames,
+                                                       theChange.mRampShape))
+            {
+                didChangeAppVolumes = true;
+            }
+        }
+        
+        if(theChange.mHasPanPosition)
+        {
+            if(theChange.mHasPID &&
+               theTransaction.SetClientsPanPosition(theChange.mAppPID,
+                                                    theChange.mPanPosition,
+                                                    theChange.mRampFrames,
+                                                    theChange.mRampShape))
+            {
+                didChangeAppVolumes = true;
+            }
+            
+            if(theChange.mAppBundleID.IsValid() &&
+               theTransaction.SetClientsPanPosition(theChange.mAppBundleID,
+                                                    theChange.mPanPosition,
+                                                    theChange.mRampFrames,
+                                                    theChange.mRampShape))
+            {
+                didChangeAppVolumes = true;
+            }
+        }
     }
     
+    theTransaction.Commit();
+    
     return didChangeAppVolumes;
 }
 
+CFDataRef   EFF_Clients::CopyAppVolumesAsBinary(UInt64 inSinceGeneration)
+const
+{
+    UInt64 theGeneration;
+    bool isFullList;
+    std::vector<EFF_Client> theClients =
+            mClientMap.CopyClientsChangedSince(inSinceGeneration, theGeneration, isFullList);
+    
+    // Like kAudioDeviceCustomPropertyAppVolumes, a full read only includes the apps that aren't set to
+    // the default volume and pan. A delta read has to include them so the reader finds out about apps
+    // that were changed back to the defaults.
+    if(isFullList)
+    {
+        theClients.erase(std::remove_if(theClients.begin(),
+                                        theClients.end(),
+                                        [] (const EFF_Client& inClient) {
+                                            return inClient.mRelativeVolume == 1.0f && inClient.mPanPosition == 0;
+                                        }),
+                         theClients.end());
+    }
+    
+    const UInt32 theNumberApps = static_cast<UInt32>(theClients.size());
+    
+    // Build the string table, storing each bundle ID only once.
+    std::vector<char> theStringTable;
+    std::unordered_map<EFF_BundleIDAtom, UInt32> theStringOffsets;
+    std::vector<UInt32> theBundleIDOffsets(theNumberApps, kEFFAppVolumesBinaryNoBundleID);
+    
+    for(UInt32 i = 0; i < theNumberApps; i++)
+    {
+        const EFF_BundleIDAtom theBundleIDAtom = theClients[i].mBundleIDAtom;
+        
+        if(theBundleIDAtom == kEFFNoBundleIDAtom)
+        {
+            continue;
+        }
+        
+        auto theOffsetItr = theStringOffsets.find(theBundleIDAtom);
+        
+        if(theOffsetItr != theStringOffsets.end())
+        {
+            theBundleIDOffsets[i] = theOffsetItr->second;
+            continue;
+        }
+        
+        const CACFString theBundleID = theClients[i].GetBundleID();
+        UInt32 theOffset = static_cast<UInt32>(theStringTable.size());
+        UInt32 theLength = theBundleID.GetByteLength(kCFStringEncodingUTF8);
+        
+        // Leave room for the null terminator.
+        UInt32 theBufferSize = theLength + 1;
+        theStringTable.resize(theOffset + theBufferSize, '\0');
+        theBundleID.GetCString(theStringTable.data() + theOffset, theBufferSize, kCFStringEncodingUTF8);
+        
+        theStringOffsets[theBundleIDAtom] = theOffset;
+        theBundleIDOffsets[i] = theOffset;
+    }
+    
+    // Allocate the data and fill it in.
+    const size_t theArraySize = theNumberApps * sizeof(SInt32);
+    const size_t theDataSize = sizeof(EFFAppVolumesBinaryHeader) + 4 * theArraySize + theStringTable.size();
+    
+    CFMutableDataRef theData = CFDataCreateMutable(kCFAllocatorDefault, static_cast<CFIndex>(theDataSize));
+    ThrowIfNULL(theData,
+                CAException(kAudioHardwareUnspecifiedError),
+                "EFF_Clients::CopyAppVolumesAsBinary: Could not allocate the data");
+    CFDataSetLength(theData, static_cast<CFIndex>(theDataSize));
+    
+    UInt8* theBytes = CFDataGetMutableBytePtr(theData);
+    
+    EFFAppVolumesBinaryHeader theHeader = {};
+    theHeader.mFormatVersion = kEFFAppVolumesBinaryFormatVersion;
+    theHeader.mNumberApps = theNumberApps;
+    theHeader.mGeneration = theGeneration;
+    theHeader.mStringTableSize = static_cast<UInt32>(theStringTable.size());
+    theHeader.mFlags = (isFullList ? kEFFAppVolumesBinaryFlagFullList : 0);
+    memcpy(theBytes, &theHeader, sizeof(theHeader));
+    
+    SInt32* thePIDs = reinterpret_cast<SInt32*>(theBytes + sizeof(EFFAppVolumesBinaryHeader));
+    UInt32* theBundleIDs = reinterpret_cast<UInt32*>(thePIDs + theNumberApps);
+    SInt32* theVolumes = reinterpret_cast<SInt32*>(theBundleIDs + theNumberApps);
+    SInt32* thePanPositions = theVolumes + theNumberApps;
+    
+    for(UInt32 i = 0; i < theNumberApps; i++)
+    {
+        const EFF_Client& theClient = theClients[i];
+        
+        thePIDs[i] = theClient.mProcessID;
+        theBundleIDs[i] = theBundleIDOffsets[i];
+        // Reverse the volume conversion from SetClientsRelativeVolumes
+        theVolumes[i] = mRelativeVolumeCurve.ConvertScalarToRaw(theClient.mRelativeVolume / 4);
+        thePanPositions[i] = theClient.mPanPosition;
+    }
+    
+    if(!theStringTable.empty())
+    {
+        memcpy(thePanPositions + theNumberApps, theStringTable.data(), theStringTable.size());
+    }
+    
+    return theData;
+}
+
+bool    EFF_Clients::SetClientsRelativeVolumes(CFDataRef inAppVolumesBinary)
+{
+    const UInt8* theBytes = CFDataGetBytePtr(inAppVolumesBinary);
+    const size_t theDataSize = static_cast<size_t>(CFDataGetLength(inAppVolumesBinary));
+    
+    ThrowIf(theDataSize < sizeof(EFFAppVolumesBinaryHeader),
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: App volumes data too short for its header");
+    
+    EFFAppVolumesBinaryHeader theHeader;
+    memcpy(&theHeader, theBytes, sizeof(theHeader));
+    
+    ThrowIf(theHeader.mFormatVersion != kEFFAppVolumesBinaryFormatVersion,
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: Unknown app volumes data format version");
+    
+    // Check the size in 64-bit arithmetic so a huge mNumberApps can't overflow it.
+    const UInt64 theArraySize = static_cast<UInt64>(theHeader.mNumberApps) * sizeof(SInt32);
+    ThrowIf(theDataSize != sizeof(EFFAppVolumesBinaryHeader) + 4 * theArraySize + theHeader.mStringTableSize,
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: App volumes data is the wrong size");
+    
+    ThrowIf(theHeader.mRampFrames > kAppRampMaxFrames,
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: Ramp length for apps out of valid range");
+    ThrowIf(theHeader.mRampShape != kEFFAppVolumeRampShapeLinear &&
+            theHeader.mRampShape != kEFFAppVolumeRampShapeExponential,
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: Unknown ramp shape for apps");
+    
+    // The data is only guaranteed to be byte-aligned, so copy the values out rather than casting.
+    auto theReadFunc = [&] (UInt32 inArray, UInt32 inIndex) {
+        UInt32 theValue;
+        memcpy(&theValue,
+               theBytes + sizeof(EFFAppVolumesBinaryHeader) + inArray * theArraySize + inIndex * sizeof(UInt32),
+               sizeof(theValue));
+        return theValue;
+    };
+    
+    const char* theStringTable =
+            reinterpret_cast<const char*>(theBytes + sizeof(EFFAppVolumesBinaryHeader) + 4 * theArraySize);
+    
+    ThrowIf(theHeader.mStringTableSize > 0 && theStringTable[theHeader.mStringTableSize - 1] != '\0',
+            EFF_InvalidClientRelativeVolumeException(),
+            "EFF_Clients::SetClientsRelativeVolumes: App volumes string table isn't null-terminated");
+    
+    // Read and validate all of the changes before applying any of them.
+    std::vector<AppVolumeChange> theChanges(theHeader.mNumberApps);
+    std::map<UInt32, CACFString> theBundleIDs;
+    
+    for(UInt32 i = 0; i < theHeader.mNumberApps; i++)
+    {
+        AppVolumeChange& theChange = theChanges[i];
+        
+        SInt32 thePID = static_cast<SInt32>(theReadFunc(0, i));
+        UInt32 theBundleIDOffset = theReadFunc(1, i);
+        SInt32 theRawRelativeVolume = static_cast<SInt32>(theReadFunc(2, i));
+        SInt32 thePanPosition = static_cast<SInt32>(theReadFunc(3, i));
+        
+        theChange.mHasPID = (thePID != kEFFAppVolumesBinaryNoValue);
+        theChange.mAppPID = thePID;
+        
+        if(theBundleIDOffset != kEFFAppVolumesBinaryNoBundleID)
+        {
+            ThrowIf(theBundleIDOffset >= theHeader.mStringTableSize,
+                    EFF_InvalidClientRelativeVolumeException(),
+                    "EFF_Clients::SetClientsRelativeVolumes: Bundle ID offset for app out of range");
+            
+            // Only create one CFString for each bundle ID.
+            auto theBundleIDItr = theBundleIDs.find(theBundleIDOffset);
+            
+            if(theBundleIDItr == theBundleIDs.end())
+            {
+                CFStringRef theBundleID = CFStringCreateWithCString(kCFAllocatorDefault,
+                                                                    theStringTable + theBundleIDOffset,
+                                                                    kCFStringEncodingUTF8);
+                ThrowIfNULL(theBundleID,
+                            EFF_InvalidClientRelativeVolumeException(),
+                            "EFF_Clients::SetClientsRelativeVolumes: Bundle ID for app isn't valid UTF-8");
+                
+                theBundleIDItr = theBundleIDs.emplace(theBundleIDOffset, CACFString(theBundleID)).first;
+            }
+            
+            theChange.mAppBundleID = theBundleIDItr->second;
+        }
+        
+        ThrowIf(!theChange.mHasPID && !theChange.mAppBundleID.IsValid(),
+                EFF_InvalidClientRelativeVolumeException(),
+                "EFF_Clients::SetClientsRelativeVolumes: App volume was sent without PID or bundle ID for app");
+        
+        theChange.mRampFrames = theHeader.mRampFrames;
+        theChange.mRampShape = static_cast<EFFAppVolumeRampShape>(theHeader.mRampShape);
+        
+        theChange.mHasVolume = (theRawRelativeVolume != kEFFAppVolumesBinaryNoValue);
+        if(theChange.mHasVolume)
+        {
+            ThrowIf(theRawRelativeVolume < kAppRelativeVolumeMinRawValue ||
+                    theRawRelativeVolume > kAppRelativeVolumeMaxRawValue,
+                    EFF_InvalidClientRelativeVolumeException(),
+                    "EFF_Clients::SetClientsRelativeVolumes: Relative volume for app out of valid range");
+            
+            // See the other SetClientsRelativeVolumes.
+            theChange.mRelativeVolume = mRelativeVolumeCurve.ConvertRawToScalar(theRawRelativeVolume) * 4;
+        }
+        
+        theChange.mHasPanPosition = (thePanPosition != kEFFAppVolumesBinaryNoValue);
+        theChange.mPanPosition = thePanPosition;
+        if(theChange.mHasPanPosition)
+        {
+            ThrowIf(thePanPosition < kAppPanLeftRawValue || thePanPosition > kAppPanRightRawValue,
+                    EFF_InvalidClientPanPositionException(),
+                    "EFF_Clients::SetClientsRelativeVolumes: Pan position for app out of valid range");
+        }
+        
+        ThrowIf(!theChange.mHasVolume && !theChange.mHasPanPosition,
+                EFF_InvalidClientRelativeVolumeException(),
+                "EFF_Clients::SetClientsRelativeVolumes: No volume or pan position in request");
+    }
+    
+    return ApplyAppVolumeChanges(theChanges);
+}
+
@@ -12,9 +12,9 @@
 // Local Includes
 #include "EFF_Client.h"
 #include "EFF_ClientMap.h"
+#include "EFF_VolumeCurve.h"
 
 // PublicUtility Includes
-#include "CAVolumeCurve.h"
 #include "CAMutex.h"
 #include "CACFArray.h"
 
@@ -47,7 +47,7 @@ class EFF_Clients
 #pragma mark Construction/Destruction
 
 public:
-                                EFF_Clients(AudioObjectID inOwnerDeviceID, EFF_TaskQueue* inTaskQueue);
+                                EFF_Clients(AudioObjectID inOwnerDeviceID);
                                 ~EFF_Clients() = default;
                                 // Disallow copying. (It could make sense to implement these in future,
                                 // but we don't need them currently.)
@@ -67,21 +67,52 @@ public:
                                     { return inClientID == mEFFAppClientID; }
     bool                        EFFAppHasClientRegistered() const
                                     { return mEFFAppClientID != -1; }
+    // True if inProcessID is the process of EFFApp's client. The properties that let a client record
+    // the device's audio to a file are only accepted from EFFApp.
+    bool                        IsEFFAppProcess(pid_t inProcessID) const;
     
     // >>> Music player API <<<
     inline pid_t                GetMusicPlayerProcessIDProperty() const
                                     { return mMusicPlayerProcessIDProperty; }
     inline CFStringRef          CopyMusicPlayerBundleIDProperty() const
                                     { return mMusicPlayerBundleIDProperty.CopyCFString(); }
-    bool                        IsMusicPlayerRT(const UInt32 inClientID) const;
     // Returns true if the PID was changed
     bool                        SetMusicPlayer(const pid_t inPID);
     // Returns true if the bundle ID was changed
     bool                        SetMusicPlayer(const CACFString inBundleID);
     
+    // >>> Per-app loopback API <<<
+    // Copies the selection of apps for the per-app loopback stream into an array in the format of
+    // kAudioDeviceCustomPropertyAppLoopback. (Except that it's a CACFArray, like
+    // CopyClientRelativeVolumesAsAppVolumes returns.)
+    CACFArray                   CopyAppLoopbackSelection() const;
+    // Replaces the selection and moves the clients to their new pairs. inSelection is in the format of
+    // kAudioDeviceCustomPropertyAppLoopback. Throws CAException(kAudioHardwareIllegalOperationError) if
+    // it isn't valid, in which case the selection isn't changed.
+    //
+    // Returns true if the selection was changed.
+    bool                        SetAppLoopbackSelection(const CACFArray inSelection);
+    // The number of pairs selected, which is the number EFFDevice's per-app loopback stream should
+    // have. 0 if no apps are selected, in which case the device shouldn't have the stream.
+    UInt32                      GetAppLoopbackPairCount() const;
+    
+    // >>> IO API <<<
+    // Returns the client's relative volume, pan position and whether it's the music player, all from
+    // a single consistent snapshot. Clients that aren't found get the default settings, i.e. no
+    // volume or pan change. Lock-free and doesn't copy the client, so it's safe to call once per
+    // client per IO cycle. Every call with the same inIOCycle sees the same changes to the clients,
+    // so the clients in a cycle never get different halves of one change. IO thread only.
+    //
+    // If outRampState isn't null, it's set to the state used to smooth changes to the client's
+    // settings, or null if the client wasn't found.
+    EFF_ClientIOParams          GetClientIOParamsRT(UInt64 inIOCycle,
+                                                    UInt32 inClientID,
+                                                    EFF_ClientRampState* __nullable * __nullable outRampState = nullptr) const;
+    // Copies the client into outClient. Returns true if the client was found. Not real-time safe.
+    bool                        GetClientNonRT(UInt32 inClientID, EFF_Client* outClient) const
+                                    { return mClientMap.GetClientNonRT(inClientID, outClient); }
+    
     // >>> Volume API <<<
-    Float32                     GetClientRelativeVolumeRT(UInt32 inClientID) const;
-    SInt32                      GetClientPanPositionRT(UInt32 inClientID) const;
     // Copies the current and past clients into an array in the format expected for
     // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
     // of unwrapped CFArray and CFDictionary refs.)
@@ -89,15 +120,70 @@ public:
                                     { return mClientMap.CopyClientRelativeVolumesAsAppVolumes(mRelativeVolumeCurve); };
     // inAppVolumes is an array of dicts with the keys kEFFAppVolumesKey_ProcessID,
     // kEFFAppVolumesKey_BundleID and optionally kEFFAppVolumesKey_RelativeVolume and
-    // kEFFAppVolumesKey_PanPosition. This method finds the client for
-    // each app by PID or bundle ID, sets the volume and applies mRelativeVolumeCurve to it.
+    // kEFFAppVolumesKey_PanPosition, kEFFAppVolumesKey_RampFrames and kEFFAppVolumesKey_RampShape.
+    // This method finds the client for each app by PID or bundle ID, sets the volume and applies
+    // mRelativeVolumeCurve to it.
     //
     // Returns true if any clients' relative volumes were changed.
     bool                        SetClientsRelativeVolumes(const CACFArray inAppVolumes);
     
+    // Encodes the current and past clients' settings in the format of
+    // kAudioDeviceCustomPropertyAppVolumesBinary. If inSinceGeneration is 0, or any clients have been
+    // removed since that generation, the clients are the same as CopyClientRelativeVolumesAsAppVolumes
+    // returns and the header has kEFFAppVolumesBinaryFlagFullList set. Otherwise they're the clients
+    // whose settings have changed since that generation. The caller is responsible for releasing the
+    // returned data.
+    CFDataRef                   CopyAppVolumesAsBinary(UInt64 inSinceGeneration) const;
+    // The equivalent of SetClientsRelativeVolumes for kAudioDeviceCustomPropertyAppVolumesBinary.
+    //
+    // Returns true if any clients' relative volumes were changed.
+    bool                        SetClientsRelativeVolumes(CFDataRef inAppVolumesBinary);
+    
     
 #pragma mark Implementation
 private:
+    // A change to one app's settings, read from kAudioDeviceCustomPropertyAppVolumes or
+    // kAudioDeviceCustomPropertyAppVolumesBinary.
+    struct AppVolumeChange
+    {
+        bool                    mHasPID             = false;
+        pid_t                   mAppPID             = 0;
+        CACFString              mAppBundleID;
+        bool                    mHasVolume          = false;
+        Float32                 mRelativeVolume     = 1.0f;
+        bool                    mHasPanPosition     = false;
+        SInt32                  mPanPosition        = kAppPanCenterRawValue;
+        UInt32                  mRampFrames         = kAppRampDefaultFrames;
+        EFFAppVolumeRampShape   mRampShape          = kEFFAppVolumeRampShapeLinear;
+    };
+    
+    // The apps selected for one pair of the per-app loopback stream. See
+    // kAudioDeviceCustomPropertyAppLoopback.
+    struct AppLoopbackSelection
+    {
+        // Either mProcessID isn't 0 or mBundleID is valid.
+        pid_t                   mProcessID          = 0;
+        CACFString              mBundleID;
+        // The atom for mBundleID, or kEFFNoBundleIDAtom until a client with that bundle ID has been
+        // added. See ResolveBundleIDAtoms.
+        EFF_BundleIDAtom        mBundleIDAtom       = kEFFNoBundleIDAtom;
+    };
+    
+    // Looks up the atoms for the bundle IDs the music player and per-app loopback properties were
+    // set to before any clients had them. Setting those properties only looks their bundle IDs up,
+    // so that apps can't grow EFF_BundleIDTable with bundle IDs that never belong to a client, which
+    // means the atoms can only be found once a matching client has been added. mMutex must be
+    // locked when calling this method.
+    void                        ResolveBundleIDAtoms(const EFF_Client& inNewClient);
+    
+    // Returns the first pair whose selection includes the client, or -1 if none do. mMutex must be
+    // locked when calling this method.
+    SInt32                      GetAppLoopbackPair(const EFF_Client& inClient) const;
+    
+    // Applies the changes to the matching clients in one EFF_ClientMap transaction. Returns true if
+    // any clients were changed.
+    bool                        ApplyAppVolumeChanges(const std::vector<AppVolumeChange>& inChanges);
+    
     // Only EFF_TaskQueue is allowed to call these (through the EFF_ClientTasks interface). We get notifications
     // from the HAL when clients start/stop IO and they have to be processed in the order we receive them to
     // avoid race conditions. If these methods could be called directly those calls would skip any queued calls.
@@ -120,9 +206,13 @@ private:
     UInt64                      mStartCount = 0;
     UInt64                      mStartCountExcludingEFFApp = 0;
     
-    CAMutex                     mMutex { "Clients" };
+    mutable CAMutex             mMutex { "Clients" };
     
     SInt64                      mEFFAppClientID = -1;
+    // The process ID of EFFApp's client, or 0 if it isn't registered. Guarded by mMutex.
+    pid_t                       mEFFAppProcessID = 0;
+    // The atom for kEFFAppBundleID, so we can recognise EFFApp's client without comparing strings.
+    EFF_BundleIDAtom            mEFFAppBundleIDAtom;
     
     // The value of the kAudioDeviceCustomPropertyMusicPlayerProcessID property, or 0 if it's unset/null.
     // We store this separately because the music player might not always be a client, but could be added
@@ -136,9 +226,16 @@ private:
     // because there might be no client with that bundle ID. In that case we need to be able to give the
     // property's value if the HAL asks for it, and to recognise the music player if it's added a client.
     CACFString                  mMusicPlayerBundleIDProperty { "" };
+    // The atom for mMusicPlayerBundleIDProperty, or kEFFNoBundleIDAtom if it's unset or no client
+    // with that bundle ID has been added yet.
+    EFF_BundleIDAtom            mMusicPlayerBundleIDAtom = kEFFNoBundleIDAtom;
+    
+    // The value of kAudioDeviceCustomPropertyAppLoopback, one entry per pair. Like the music player
+    // properties, the selected apps don't have to be clients yet. Guarded by mMutex.
+    std::vector<AppLoopbackSelection> mAppLoopbackSelection;
     
     // The volume curve we apply to raw client volumes before they're used
-    CAVolumeCurve               mRelativeVolumeCurve;
+    EFF_VolumeCurve             mRelativeVolumeCurve;
     
 };
 
@@ -15,6 +15,8 @@
 
 // Local Includes
 #include "EFF_PlugIn.h"
+#include "EFF_AudioKernels.h"
+#include "EFF_LatencyProfile.h"
 // #include "EFF_XPCHelper.h"
 #include "EFF_Utils.h"
 
@@ -22,11 +24,13 @@
 #include "CADispatchQueue.h"
 #include "CAException.h"
 #include "CACFArray.h"
+#include "CACFDictionary.h"
 #include "CACFString.h"
 #include "CADebugMacros.h"
 #include "CAHostTimeBase.h"
 
 // STL Includes
+#include <algorithm>
 #include <stdexcept>
 
 // System Includes
@@ -63,8 +67,16 @@ void    EFF_Device::StaticInitializer()
                                    CFSTR(kEFFDeviceModelUID),
                                    kObjectID_Stream_Input,
                                    kObjectID_Stream_Output,
+                                   kObjectID_Stream_Input_Apps,
                                    kObjectID_Volume_Output_Master,
-                                   kObjectID_Mute_Output_Master);
+                                   kObjectID_Mute_Output_Master,
+                                   kChannelsPerFrameDefault);
+        // Fade the main instance's audio out and in when it's muted and unmuted. EFFApp mutes the
+        // real output device as well, but that cuts the audio off abruptly. The mute is applied in
+        // ProcessMix, so everything WriteMix does with the mix gets the muted audio: the device's
+        // input stream (which EFFApp plays through), the mix's level meters and mix recordings.
+        // Only the audible state is checked before the mute. See DoIOOperation.
+        sInstance->mMuteControl.SetWillApplyMuteToAudio(true);
         sInstance->Activate();
         
         // The instance for system (UI) sounds.
@@ -74,8 +86,10 @@ void    EFF_Device::StaticInitializer()
                                            CFSTR(kEFFDeviceModelUID_UISounds),
                                            kObjectID_Stream_Input_UI_Sounds,
                                            kObjectID_Stream_Output_UI_Sounds,
+                                           kAudioObjectUnknown,  // No per-app loopback stream.
                                            kObjectID_Volume_Output_Master_UI_Sounds,
-                                           kAudioObjectUnknown);  // No mute control.
+                                           kAudioObjectUnknown,  // No mute control.
+                                           kChannelsPerFrameDefault);
 
         // Set up the UI sounds device's volume control.
         EFF_VolumeControl& theUISoundsVolumeControl = sUISoundsInstance->mVolumeControl;
@@ -105,8 +119,10 @@ EFF_Device::EFF_Device(AudioObjectID inObjectID,
                        const CFStringRef __nonnull inDeviceModelUID,
                        AudioObjectID inInputStreamID,
                        AudioObjectID inOutputStreamID,
+                       AudioObjectID inAppLoopbackStreamID,
                        AudioObjectID inOutputVolumeControlID,
-                       AudioObjectID inOutputMuteControlID)
+                       AudioObjectID inOutputMuteControlID,
+                       UInt32 inChannelsPerFrame)
 :
     EFF_AbstractDevice(inObjectID, kAudioObjectPlugInObject),
     mStateMutex("Device State"),
@@ -114,10 +130,19 @@ EFF_Device::EFF_Device(AudioObjectID inObjectID,
     mDeviceName(inDeviceName),
     mDeviceUID(inDeviceUID),
     mDeviceModelUID(inDeviceModelUID),
+    mChannelsPerFrame(inChannelsPerFrame),
     mWrappedAudioEngine(nullptr),
-    mClients(inObjectID, &mTaskQueue),
-    mInputStream(inInputStreamID, inObjectID, false, kSampleRateDefault),
-    mOutputStream(inOutputStreamID, inObjectID, false, kSampleRateDefault),
+    mClients(inObjectID),
+    mInputStream(inInputStreamID, inObjectID, false, kSampleRateDefault, inChannelsPerFrame),
+    mOutputStream(inOutputStreamID, inObjectID, false, kSampleRateDefault, inChannelsPerFrame),
+    // One pair of channels per selected app, numbered after the main input stream's channels. It
+    // starts with one pair and is resized when it's added. See SetAppLoopbackStream.
+    mAppLoopbackStream(inAppLoopbackStreamID,
+                       inObjectID,
+                       true,
+                       kSampleRateDefault,
+                       inChannelsPerFrame,
+                       inChannelsPerFrame + 1),
     mAudibleState(),
     mVolumeControl(inOutputVolumeControlID, GetObjectID()),
     mMuteControl(inOutputMuteControlID, GetObjectID())
@@ -140,6 +165,7 @@ void    EFF_Device::Activate()
 
     mInputStream.Activate();
     mOutputStream.Activate();
+    // mAppLoopbackStream is activated when apps are selected for it. See SetAppLoopbackStream.
 
     if(mVolumeControl.GetObjectID() != kAudioObjectUnknown)
     {
@@ -165,6 +191,7 @@ void    EFF_Device::Deactivate()
     // Mark the device's sub-objects inactive.
     mInputStream.Deactivate();
     mOutputStream.Deactivate();
+    mAppLoopbackStream.Deactivate();
     mVolumeControl.Deactivate();
     mMuteControl.Deactivate();
 
@@ -177,16 +204,29 @@ void    EFF_Device::Deactivate()
 
 void    EFF_Device::InitLoopback()
 {
-    // Calculate the number of host clock ticks per frame for our loopback clock.
-    mLoopbackTime.hostTicksPerFrame = CAHostTimeBase::GetFrequency() / mLoopbackSampleRate;
+    // Set the rate and period of our loopback clock.
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+        mLoopbackClock.Initialize(CAHostTimeBase::GetFrequency(),
+                                  mLoopbackSampleRate,
+                                  EFF_LatencyProfile::GetParams(mLatencyProfile).mZeroTimeStampPeriod);
+    }
     
-    //  Allocate (or re-allocate) the loopback buffer.
-    //  2 channels * 32-bit float = bytes in each frame
-    //  Pass 1 for nChannels because it's going to be storing interleaved audio, which means we
-    //  don't need a separate buffer for each channel.
-    mLoopbackRingBuffer.Allocate(1,
-                                 2 * sizeof(Float32),
-                                 kLoopbackRingBufferFrameSize);
+    //  Allocate (or re-allocate) the loopback buffer. It stores interleaved audio in the streams'
+    //  format, i.e. mChannelsPerFrame Float32 samples per frame.
+    mLoopbackRingBuffer.Allocate(mChannelsPerFrame, EFF_LatencyProfile::kLoopbackRingBufferFrames);
+
+    // The per-app loopback buffer has the same capacity, but only exists while its stream does.
+    if(mAppLoopbackEnabled)
+    {
+        mAppLoopback.Allocate(mChannelsPerFrame,
+                              mAppLoopback.GetPairCount(),
+                              EFF_LatencyProfile::kLoopbackRingBufferFrames);
+    }
+
+    mMaxIOBufferFrameSize =
+        EFF_LatencyProfile::GetMaxIOBufferFrameSize(mLatencyProfile,
+                                                    mLoopbackRingBuffer.GetCapacityFrames());
 }
 
 
@@ -339,7 +379,15 @@ const
         case kAudioDeviceCustomPropertyMusicPlayerBundleID:
         case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanEFFApp:
         case kAudioDeviceCustomPropertyAppVolumes:
+        case kAudioDeviceCustomPropertyAppVolumesBinary:
+        case kAudioDeviceCustomPropertyLevelMeters:
+        case kAudioDeviceCustomPropertyIOStats:
         case kAudioDeviceCustomPropertyEnabledOutputControls:
+        case kAudioDeviceCustomPropertyClockReference:
+        case kAudioDeviceCustomPropertyLatencyProfile:
+        case kAudioDeviceCustomPropertyRecording:
+        case kAudioDeviceCustomPropertyStemRecording:
+        case kAudioDeviceCustomPropertyAppLoopback:
             theAnswer = true;
             break;
             
@@ -383,6 +431,8 @@ const
         case kAudioObjectPropertyCustomPropertyInfoList:
         case kAudioDeviceCustomPropertyDeviceAudibleState:
         case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanEFFApp:
+        case kAudioDeviceCustomPropertyLevelMeters:
+        case kAudioDeviceCustomPropertyIOStats:
             theAnswer = false;
             break;
             
@@ -390,7 +440,13 @@ const
         case kAudioDeviceCustomPropertyMusicPlayerProcessID:
         case kAudioDeviceCustomPropertyMusicPlayerBundleID:
         case kAudioDeviceCustomPropertyAppVolumes:
+        case kAudioDeviceCustomPropertyAppVolumesBinary:
         case kAudioDeviceCustomPropertyEnabledOutputControls:
+        case kAudioDeviceCustomPropertyClockReference:
+        case kAudioDeviceCustomPropertyLatencyProfile:
+        case kAudioDeviceCustomPropertyRecording:
+        case kAudioDeviceCustomPropertyStemRecording:
+        case kAudioDeviceCustomPropertyAppLoopback:
             theAnswer = true;
             break;
         
@@ -425,7 +481,7 @@ const
                         break;
                         
                     case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputSubObjects * sizeof(AudioObjectID);
+                        theAnswer = GetNumberOfInputStreams() * sizeof(AudioObjectID);
                         break;
                         
                     case kAudioObjectPropertyScopeOutput:
@@ -444,11 +500,11 @@ const
                 switch(inAddress.mScope)
                 {
                     case kAudioObjectPropertyScopeGlobal:
-                        theAnswer = kNumberOfStreams * sizeof(AudioObjectID);
+                        theAnswer = GetNumberOfStreams() * sizeof(AudioObjectID);
                         break;
                         
                     case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputStreams * sizeof(AudioObjectID);
+                        theAnswer = GetNumberOfInputStreams() * sizeof(AudioObjectID);
                         break;
                         
                     case kAudioObjectPropertyScopeOutput:
@@ -474,7 +530,8 @@ const
             break;
 
         case kAudioDevicePropertyPreferredChannelLayout:
-            theAnswer = offsetof(AudioChannelLayout, mChannelDescriptions) + (2 * sizeof(AudioChannelDescription));
+            theAnswer = offsetof(AudioChannelLayout, mChannelDescriptions) +
+                        (mChannelsPerFrame * sizeof(AudioChannelDescription));
             break;
 
         case kAudioDevicePropertyIcon:
@@ -482,7 +539,7 @@ const
             break;
             
         case kAudioObjectPropertyCustomPropertyInfoList:
-            theAnswer = sizeof(AudioServerPlugInCustomPropertyInfo) * 6;
+            theAnswer = sizeof(AudioServerPlugInCustomPropertyInfo) * 14;
             break;
             
         case kAudioDeviceCustomPropertyDeviceAudibleState:
@@ -504,10 +561,36 @@ const
         case kAudioDeviceCustomPropertyAppVolumes:
             theAnswer = sizeof(CFPropertyListRef);
             break;
+            
+        case kAudioDeviceCustomPropertyAppVolumesBinary:
+            theAnswer = sizeof(CFDataRef);
+            break;
+
+        case kAudioDeviceCustomPropertyLevelMeters:
+        case kAudioDeviceCustomPropertyIOStats:
+            theAnswer = sizeof(CFDictionaryRef);
+            break;
 
         case kAudioDeviceCustomPropertyEnabledOutputControls:
             theAnswer = sizeof(CFArrayRef);
             break;
+
+        case kAudioDeviceCustomPropertyClockReference:
+            theAnswer = sizeof(CFPropertyListRef);
+            break;
+
+        case kAudioDeviceCustomPropertyLatencyProfile:
+            theAnswer = sizeof(CFNumberRef);
+            break;
+
+        case kAudioDeviceCustomPropertyRecording:
+        case kAudioDeviceCustomPropertyStemRecording:
+            theAnswer = sizeof(CFPropertyListRef);
+            break;
+
+        case kAudioDeviceCustomPropertyAppLoopback:
+            theAnswer = sizeof(CFArrayRef);
+            break;
         
         default:
             theAnswer = EFF_AbstractDevice::GetPropertyDataSize(inObjectID,
@@ -521,6 +604,37 @@ const
     return theAnswer;
 }
 
+// Returns the label of the channel at inChannelIndex (0-based) in the preferred channel layout for
+// a device with inChannelsPerFrame channels. The 5.1 and 7.1 layouts are in the same order as
+// kAudioChannelLayoutTag_MPEG_5_1_A and kAudioChannelLayoutTag_MPEG_7_1_C.
+static AudioChannelLabel GetChannelLabel(UInt32 inChannelsPerFrame, UInt32 inChannelIndex)
+{
+    static const AudioChannelLabel kSurroundLabels[] = {
+        kAudioChannelLabel_Left,
+        kAudioChannelLabel_Right,
+        kAudioChannelLabel_Center,
+        kAudioChannelLabel_LFEScreen,
+        kAudioChannelLabel_LeftSurround,
+        kAudioChannelLabel_RightSurround,
+        kAudioChannelLabel_RearSurroundLeft,
+        kAudioChannelLabel_RearSurroundRight
+    };
+
+    switch(inChannelsPerFrame)
+    {
+        case 1:
+            return kAudioChannelLabel_Mono;
+
+        case 2:
+        case 6:
+        case 8:
+            return kSurroundLabels[inChannelIndex];
+
+        default:
+            return kAudioChannelLabel_Discrete_0 + inChannelIndex;
+    };
+}
+
 void    EFF_Device::Device_GetPropertyData(AudioObjectID inObjectID,
                                            pid_t inClientPID,
                                            const AudioObjectPropertyAddress& inAddress,
@@ -612,20 +726,38 @@ const
                         {
                             reinterpret_cast<AudioObjectID*>(outData)[3] = mMuteControl.GetObjectID();
                         }
+
+                        // The per-app loopback stream goes after the controls, if it's active and
+                        // there's room.
+                        UInt32 theAppLoopbackStreamIndex = 2 + GetNumberOfOutputControls();
+                        if(theNumberItemsToFetch > theAppLoopbackStreamIndex && mAppLoopbackStream.IsActive())
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[theAppLoopbackStreamIndex] =
+                                mAppLoopbackStream.GetObjectID();
+                        }
                     }
                     break;
                     
                 case kAudioObjectPropertyScopeInput:
                     //    input scope means just the objects on the input side
-                    if(theNumberItemsToFetch > kNumberOfInputSubObjects)
                     {
-                        theNumberItemsToFetch = kNumberOfInputSubObjects;
-                    }
-                    
-                    //    fill out the list with the right objects
-                    if(theNumberItemsToFetch > 0)
-                    {
-                        reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
+                        CAMutex::Locker theStateLocker(mStateMutex);
+
+                        if(theNumberItemsToFetch > GetNumberOfInputStreams())
+                        {
+                            theNumberItemsToFetch = GetNumberOfInputStreams();
+                        }
+
+                        //    fill out the list with the right objects
+                        if(theNumberItemsToFetch > 0)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
+                        }
+
+                        if(theNumberItemsToFetch > 1)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[1] = mAppLoopbackStream.GetObjectID();
+                        }
                     }
                     break;
 
@@ -733,33 +865,50 @@ const
             {
                 case kAudioObjectPropertyScopeGlobal:
                     //    global scope means return all streams
-                    if(theNumberItemsToFetch > kNumberOfStreams)
-                    {
-                        theNumberItemsToFetch = kNumberOfStreams;
-                    }
-                    
-                    //    fill out the list with as many objects as requested
-                    if(theNumberItemsToFetch > 0)
-                    {
-                        reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
-                    }
-                    if(theNumberItemsToFetch > 1)
                     {
-                        reinterpret_cast<AudioObjectID*>(outData)[1] = mOutputStream.GetObjectID();
+                        CAMutex::Locker theStateLocker(mStateMutex);
+
+                        if(theNumberItemsToFetch > GetNumberOfStreams())
+                        {
+                            theNumberItemsToFetch = GetNumberOfStreams();
+                        }
+
+                        //    fill out the list with as many objects as requested
+                        if(theNumberItemsToFetch > 0)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
+                        }
+                        if(theNumberItemsToFetch > 1)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[1] = mOutputStream.GetObjectID();
+                        }
+                        if(theNumberItemsToFetch > 2)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[2] = mAppLoopbackStream.GetObjectID();
+                        }
                     }
                     break;
                     
                 case kAudioObjectPropertyScopeInput:
-                    //    input scope means just the objects on the input side
-                    if(theNumberItemsToFetch > kNumberOfInputStreams)
-                    {
-                        theNumberItemsToFetch = kNumberOfInputStreams;
-                    }
-                    
-                    //    fill out the list with as many objects as requested
-                    if(theNumberItemsToFetch > 0)
+                    //    input scope means just the objects on the input side, the main input
+                    //    stream and then the per-app loopback stream, if it's active
                     {
-                        reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
+                        CAMutex::Locker theStateLocker(mStateMutex);
+
+                        if(theNumberItemsToFetch > GetNumberOfInputStreams())
+                        {
+                            theNumberItemsToFetch = GetNumberOfInputStreams();
+                        }
+
+                        //    fill out the list with as many objects as requested
+                        if(theNumberItemsToFetch > 0)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[0] = mInputStream.GetObjectID();
+                        }
+                        if(theNumberItemsToFetch > 1)
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[1] = mAppLoopbackStream.GetObjectID();
+                        }
                     }
                     break;
                     
@@ -823,9 +972,32 @@ const
             }
             break;
 
-        // TODO: Should we return the real kAudioDevicePropertyLatency and/or
-        //       kAudioDevicePropertySafetyOffset for the real/wrapped output device?
-        //       If so, should we also add on the extra latency added by Background Music?
+        case kAudioDevicePropertyLatency:
+            //    This property returns the presentation latency of the device. Audio played to the
+            //    device is presented once EFFApp's playthrough has passed it on to the output device,
+            //    which the latency profile estimates. Its input has no latency beyond the IO buffer.
+            ThrowIf(inDataSize < sizeof(UInt32),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyLatency for the device");
+            *reinterpret_cast<UInt32*>(outData) =
+                (inAddress.mScope == kAudioObjectPropertyScopeOutput) ?
+                    EFF_LatencyProfile::GetParams(GetLatencyProfile()).mOutputLatencyFrames : 0;
+            outDataSize = sizeof(UInt32);
+            break;
+
+        case kAudioDevicePropertySafetyOffset:
+            //    This property returns how close to now the HAL can read and write, which is set by
+            //    the latency profile.
+            ThrowIf(inDataSize < sizeof(UInt32),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertySafetyOffset for the device");
+            *reinterpret_cast<UInt32*>(outData) =
+                EFF_LatencyProfile::GetParams(GetLatencyProfile()).mSafetyOffsetFrames;
+            outDataSize = sizeof(UInt32);
+            break;
+
+        // TODO: Should we add the real/wrapped output device's kAudioDevicePropertyLatency and
+        //       kAudioDevicePropertySafetyOffset to ours?
 
         case kAudioDevicePropertyNominalSampleRate:
             //    This property returns the nominal sample rate of the device.
@@ -875,31 +1047,34 @@ const
 
         case kAudioDevicePropertyPreferredChannelsForStereo:
             //    This property returns which two channels to use as left/right for stereo
-            //    data by default. Note that the channel numbers are 1-based.
+            //    data by default. Note that the channel numbers are 1-based. The front left and
+            //    right channels are always first, and a mono device uses its only channel for both.
             ThrowIf(inDataSize < (2 * sizeof(UInt32)),
                     CAException(kAudioHardwareBadPropertySizeError),
                     "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelsForStereo for the device");
             ((UInt32*)outData)[0] = 1;
-            ((UInt32*)outData)[1] = 2;
+            ((UInt32*)outData)[1] = (mChannelsPerFrame > 1) ? 2 : 1;
             outDataSize = 2 * sizeof(UInt32);
             break;
 
         case kAudioDevicePropertyPreferredChannelLayout:
             //    This property returns the default AudioChannelLayout to use for the device
-            //    by default. For this device, we return a stereo ACL.
+            //    by default. For this device, we return a mono, stereo, 5.1 or 7.1 ACL depending
+            //    on the number of channels, or just number the channels if there's no standard
+            //    layout for them. EFF_AudioKernels::IsUnpairedChannel relies on this order.
             {
                 UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) +
-                                    (2 * sizeof(AudioChannelDescription));
+                                    (mChannelsPerFrame * sizeof(AudioChannelDescription));
                 ThrowIf(inDataSize < theACLSize,
                         CAException(kAudioHardwareBadPropertySizeError),
                         "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelLayout for the device");
                 ((AudioChannelLayout*)outData)->mChannelLayoutTag = kAudioChannelLayoutTag_UseChannelDescriptions;
                 ((AudioChannelLayout*)outData)->mChannelBitmap = 0;
-                ((AudioChannelLayout*)outData)->mNumberChannelDescriptions = 2;
-                for(theItemIndex = 0; theItemIndex < 2; ++theItemIndex)
+                ((AudioChannelLayout*)outData)->mNumberChannelDescriptions = mChannelsPerFrame;
+                for(theItemIndex = 0; theItemIndex < mChannelsPerFrame; ++theItemIndex)
                 {
                     ((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelLabel =
-                        kAudioChannelLabel_Left + theItemIndex;
+                        GetChannelLabel(mChannelsPerFrame, theItemIndex);
                     ((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelFlags = 0;
                     ((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mCoordinates[0] = 0;
                     ((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mCoordinates[1] = 0;
@@ -915,7 +1090,8 @@ const
             ThrowIf(inDataSize < sizeof(UInt32),
                     CAException(kAudioHardwareBadPropertySizeError),
                     "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyZeroTimeStampPeriod for the device");
-            *reinterpret_cast<UInt32*>(outData) = kLoopbackRingBufferFrameSize;
+            *reinterpret_cast<UInt32*>(outData) =
+                EFF_LatencyProfile::GetParams(GetLatencyProfile()).mZeroTimeStampPeriod;
             outDataSize = sizeof(UInt32);
             break;
 
@@ -945,9 +1121,9 @@ const
             theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
             
             //    clamp it to the number of items we have
-            if(theNumberItemsToFetch > 6)
+            if(theNumberItemsToFetch > 14)
             {
-                theNumberItemsToFetch = 6;
+                theNumberItemsToFetch = 14;
             }
             
             if(theNumberItemsToFetch > 0)
@@ -991,6 +1167,54 @@ const
                 ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
                 ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
             }
+            if(theNumberItemsToFetch > 6)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mSelector = kAudioDeviceCustomPropertyLevelMeters;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 7)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mSelector = kAudioDeviceCustomPropertyIOStats;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 8)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mSelector = kAudioDeviceCustomPropertyAppVolumesBinary;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+            }
+            if(theNumberItemsToFetch > 9)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mSelector = kAudioDeviceCustomPropertyClockReference;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 10)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mSelector = kAudioDeviceCustomPropertyLatencyProfile;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 11)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mSelector = kAudioDeviceCustomPropertyRecording;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 12)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[12].mSelector = kAudioDeviceCustomPropertyStemRecording;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[12].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[12].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 13)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[13].mSelector = kAudioDeviceCustomPropertyAppLoopback;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[13].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[13].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
 
             outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
             break;
@@ -1051,6 +1275,98 @@ const
                 outDataSize = sizeof(CFArrayRef);
             }
             break;
+            
+        case kAudioDeviceCustomPropertyAppVolumesBinary:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyAppVolumesBinary for the device");
+                
+                // The optional qualifier is the generation to get the changes since.
+                UInt64 theSinceGeneration = 0;
+                
+                if(inQualifierDataSize >= sizeof(CFNumberRef) && inQualifierData != nullptr)
+                {
+                    CFNumberRef theQualifier = *reinterpret_cast<const CFNumberRef*>(inQualifierData);
+                    
+                    ThrowIf(theQualifier == nullptr || CFGetTypeID(theQualifier) != CFNumberGetTypeID(),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_GetPropertyData: the qualifier for kAudioDeviceCustomPropertyAppVolumesBinary was not a CFNumber");
+                    
+                    SInt64 theGeneration = 0;
+                    CFNumberGetValue(theQualifier, kCFNumberSInt64Type, &theGeneration);
+                    theSinceGeneration = static_cast<UInt64>(std::max(theGeneration, SInt64(0)));
+                }
+                
+                CAMutex::Locker theStateLocker(mStateMutex);
+                *reinterpret_cast<CFDataRef*>(outData) = mClients.CopyAppVolumesAsBinary(theSinceGeneration);
+                outDataSize = sizeof(CFDataRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyLevelMeters:
+            ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyLevelMeters for the device");
+            // The levels are read without locking so polling this property can't hold up the IO thread.
+            *reinterpret_cast<CFDictionaryRef*>(outData) = CopyLevelMetersAsDictionary();
+            outDataSize = sizeof(CFDictionaryRef);
+            break;
+
+        case kAudioDeviceCustomPropertyIOStats:
+            ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyIOStats for the device");
+            // Also read without locking. See EFF_IOStats.
+            *reinterpret_cast<CFDictionaryRef*>(outData) = mIOStats.CopyAsDictionary();
+            outDataSize = sizeof(CFDictionaryRef);
+            break;
+
+        case kAudioDeviceCustomPropertyClockReference:
+            ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyClockReference for the device");
+            *reinterpret_cast<CFDictionaryRef*>(outData) = CopyClockStatusAsDictionary();
+            outDataSize = sizeof(CFDictionaryRef);
+            break;
+
+        case kAudioDeviceCustomPropertyLatencyProfile:
+            {
+                ThrowIf(inDataSize < sizeof(CFNumberRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyLatencyProfile for the device");
+                SInt32 theLatencyProfile = GetLatencyProfile();
+                *reinterpret_cast<CFNumberRef*>(outData) =
+                        CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &theLatencyProfile);
+                outDataSize = sizeof(CFNumberRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyRecording:
+            ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyRecording for the device");
+            *reinterpret_cast<CFDictionaryRef*>(outData) = mMixRecorder.CopyStatusAsDictionary();
+            outDataSize = sizeof(CFDictionaryRef);
+            break;
+
+        case kAudioDeviceCustomPropertyStemRecording:
+            ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyStemRecording for the device");
+            // Look up any clients that have been given tracks since the last time.
+            mStemRecorder.IdentifyTrackClients(mClients);
+            *reinterpret_cast<CFDictionaryRef*>(outData) = mStemRecorder.CopyStatusAsDictionary();
+            outDataSize = sizeof(CFDictionaryRef);
+            break;
+
+        case kAudioDeviceCustomPropertyAppLoopback:
+            ThrowIf(inDataSize < sizeof(CFArrayRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "EFF_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyAppLoopback for the device");
+            *reinterpret_cast<CFArrayRef*>(outData) = mClients.CopyAppLoopbackSelection().GetCFArray();
+            outDataSize = sizeof(CFArrayRef);
+            break;
 
         case kAudioDeviceCustomPropertyEnabledOutputControls:
             {
@@ -1141,7 +1457,7 @@ void    EFF_Device::Device_SetPropertyData(AudioObjectID inObjectID,
                 if(propertyWasChanged)
                 {
                     // Send notification
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,    ^{
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
                         AudioObjectPropertyAddress theChangedProperties[] = {
                             kEFFMusicPlayerProcessIDAddress,
                             kEFFMusicPlayerBundleIDAddress
@@ -1179,7 +1495,7 @@ void    EFF_Device::Device_SetPropertyData(AudioObjectID inObjectID,
                 if(propertyWasChanged)
                 {
                     // Send notification
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,    ^{
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
                         AudioObjectPropertyAddress theChangedProperties[] = {
                             kEFFMusicPlayerBundleIDAddress,
                             kEFFMusicPlayerProcessIDAddress
@@ -1223,9 +1539,58 @@ void    EFF_Device::Device_SetPropertyData(AudioObjectID inObjectID,
                 if(propertyWasChanged)
                 {
                     // Send notification
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,    ^{
-                        AudioObjectPropertyAddress theChangedProperties[] = { kEFFAppVolumesAddress };
-                        EFF_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+                        AudioObjectPropertyAddress theChangedProperties[] = {
+                            kEFFAppVolumesAddress,
+                            kEFFAppVolumesBinaryAddress
+                        };
+                        EFF_PlugIn::Host_PropertiesChanged(inObjectID, 2, theChangedProperties);
+                    });
+                }
+            }
+            break;
+            
+        case kAudioDeviceCustomPropertyAppVolumesBinary:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyAppVolumesBinary");
+                
+                CFDataRef theData = *reinterpret_cast<const CFDataRef*>(inData);
+                
+                ThrowIfNULL(theData,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: kAudioDeviceCustomPropertyAppVolumesBinary cannot be set to NULL");
+                ThrowIf(CFGetTypeID(theData) != CFDataGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyAppVolumesBinary was not a CFData");
+                
+                bool propertyWasChanged = false;
+                
+                CAMutex::Locker theStateLocker(mStateMutex);
+                
+                try
+                {
+                    propertyWasChanged = mClients.SetClientsRelativeVolumes(theData);
+                }
+                catch(EFF_InvalidClientRelativeVolumeException)
+                {
+                    Throw(CAException(kAudioHardwareIllegalOperationError));
+                }
+                catch(EFF_InvalidClientPanPositionException)
+                {
+                    Throw(CAException(kAudioHardwareIllegalOperationError));
+                }
+                
+                if(propertyWasChanged)
+                {
+                    // Send notification
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+                        AudioObjectPropertyAddress theChangedProperties[] = {
+                            kEFFAppVolumesAddress,
+                            kEFFAppVolumesBinaryAddress
+                        };
+                        EFF_PlugIn::Host_PropertiesChanged(inObjectID, 2, theChangedProperties);
                     });
                 }
             }
@@ -1276,6 +1641,185 @@ void    EFF_Device::Device_SetPropertyData(AudioObjectID inObjectID,
             }
             break;
 
+        case kAudioDeviceCustomPropertyClockReference:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyClockReference");
+
+                CFDataRef theData = *reinterpret_cast<const CFDataRef*>(inData);
+
+                ThrowIfNULL(theData,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: kAudioDeviceCustomPropertyClockReference cannot be set to NULL");
+                ThrowIf(CFGetTypeID(theData) != CFDataGetTypeID() ||
+                            CFDataGetLength(theData) != sizeof(EFFClockReferenceTimeStamp),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyClockReference was not an EFFClockReferenceTimeStamp");
+
+                EFFClockReferenceTimeStamp theTimeStamp;
+                memcpy(&theTimeStamp, CFDataGetBytePtr(theData), sizeof(EFFClockReferenceTimeStamp));
+
+                // The clock is only used while holding the IO mutex. Updating it is quick, so this
+                // won't hold up the IO thread for long.
+                CAMutex::Locker theIOLocker(mIOMutex);
+                mLoopbackClock.AddReferenceTimeStamp(theTimeStamp.mSampleTime,
+                                                     theTimeStamp.mHostTime,
+                                                     theTimeStamp.mNominalSampleRate);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyLatencyProfile:
+            {
+                ThrowIf(inDataSize < sizeof(CFNumberRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyLatencyProfile");
+
+                CFNumberRef theProfileRef = *reinterpret_cast<const CFNumberRef*>(inData);
+
+                ThrowIfNULL(theProfileRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: null reference given for kAudioDeviceCustomPropertyLatencyProfile");
+                ThrowIf(CFGetTypeID(theProfileRef) != CFNumberGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyLatencyProfile was not a CFNumber");
+
+                SInt32 theProfile = -1;
+                Boolean success = CFNumberGetValue(theProfileRef, kCFNumberSInt32Type, &theProfile);
+
+                ThrowIf(!success || !EFF_LatencyProfile::IsValid(theProfile),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: invalid value for kAudioDeviceCustomPropertyLatencyProfile");
+
+                RequestLatencyProfile(static_cast<EFFLatencyProfile>(theProfile));
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyRecording:
+        case kAudioDeviceCustomPropertyStemRecording:
+            {
+                // The two properties take the same settings, except that stem recordings also
+                // have a track count.
+                const bool isStemRecording = (inAddress.mSelector == kAudioDeviceCustomPropertyStemRecording);
+
+                // Recording writes files as coreaudiod and captures every app's audio, so only
+                // EFFApp is allowed to start or stop it.
+                ThrowIf(!mClients.IsEFFAppProcess(inClientPID),
+                        CAException(kAudioDevicePermissionsError),
+                        "EFF_Device::Device_SetPropertyData: only EFFApp can set a recording property");
+
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_SetPropertyData: wrong size for the data for a recording property");
+
+                CFDictionaryRef theSettingsRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIfNULL(theSettingsRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: null reference given for a recording property");
+                ThrowIf(CFGetTypeID(theSettingsRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: CFType given for a recording property was not a CFDictionary");
+
+                CACFDictionary theSettings(theSettingsRef, false);
+                CFStringRef thePath = nullptr;
+
+                if(!theSettings.GetString(CFSTR(kEFFRecordingKey_Path), thePath) || !thePath)
+                {
+                    // No path means stop recording. This blocks until the file's been closed.
+                    if(isStemRecording)
+                    {
+                        mStemRecorder.Stop();
+                    }
+                    else
+                    {
+                        mMixRecorder.Stop();
+                    }
+                }
+                else
+                {
+                    SInt32 theFileFormat = kEFFRecordingFileFormatWAV;
+                    SInt32 theSampleFormat = kEFFRecordingSampleFormatFloat32;
+                    SInt32 theTrackCount = kEFFStemRecordingDefaultTracks;
+                    theSettings.GetSInt32(CFSTR(kEFFRecordingKey_FileFormat), theFileFormat);
+                    theSettings.GetSInt32(CFSTR(kEFFRecordingKey_SampleFormat), theSampleFormat);
+                    theSettings.GetSInt32(CFSTR(kEFFStemRecordingKey_TrackCount), theTrackCount);
+
+                    ThrowIf((theFileFormat < kEFFRecordingFileFormatWAV) || (theFileFormat > kEFFRecordingFileFormatRaw),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: invalid file format for a recording property");
+                    ThrowIf((theSampleFormat < kEFFRecordingSampleFormatFloat32) ||
+                                (theSampleFormat > kEFFRecordingSampleFormatInt24),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: invalid sample format for a recording property");
+                    ThrowIf(isStemRecording &&
+                                ((theTrackCount < 1) || (theTrackCount > kEFFStemRecordingMaxTracks)),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: invalid track count for kAudioDeviceCustomPropertyStemRecording");
+
+                    // Hold the state lock so the sample rate can't change before the recording has
+                    // started. SetSampleRate stops recordings.
+                    CAMutex::Locker theStateLocker(mStateMutex);
+
+                    if(isStemRecording)
+                    {
+                        mStemRecorder.Start(thePath,
+                                            static_cast<EFFRecordingFileFormat>(theFileFormat),
+                                            static_cast<EFFRecordingSampleFormat>(theSampleFormat),
+                                            static_cast<UInt32>(theTrackCount),
+                                            mChannelsPerFrame,
+                                            GetSampleRate());
+                    }
+                    else
+                    {
+                        mMixRecorder.Start(thePath,
+                                           static_cast<EFFRecordingFileFormat>(theFileFormat),
+                                           static_cast<EFFRecordingSampleFormat>(theSampleFormat),
+                                           mChannelsPerFrame,
+                                           GetSampleRate());
+                    }
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyAppLoopback:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "EFF_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyAppLoopback");
+                // The UI sounds device doesn't have a per-app loopback stream.
+                ThrowIf(mAppLoopbackStream.GetObjectID() == kAudioObjectUnknown,
+                        CAException(kAudioHardwareUnsupportedOperationError),
+                        "EFF_Device::Device_SetPropertyData: kAudioDeviceCustomPropertyAppLoopback isn't supported by this device");
+
+                CFArrayRef theSelectionRef = *reinterpret_cast<const CFArrayRef*>(inData);
+
+                ThrowIfNULL(theSelectionRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "EFF_Device::Device_SetPropertyData: null reference given for kAudioDeviceCustomPropertyAppLoopback");
+                ThrowIf(CFGetTypeID(theSelectionRef) != CFArrayGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "EFF_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyAppLoopback was not a CFArray");
+
+                CACFArray theSelection(theSelectionRef, false);
+
+                CAMutex::Locker theStateLocker(mStateMutex);
+
+                // Clients that have already been selected start going to their new pairs straight
+                // away. Adding, removing or resizing the stream has to wait for the host to stop IO.
+                bool propertyWasChanged = mClients.SetAppLoopbackSelection(theSelection);
+                RequestAppLoopbackStream(mClients.GetAppLoopbackPairCount());
+
+                if(propertyWasChanged)
+                {
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+                        AudioObjectPropertyAddress theChangedProperties[] = { kEFFAppLoopbackAddress };
+                        EFF_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
         default:
             EFF_AbstractDevice::SetPropertyData(inObjectID,
                                                 inClientPID,
@@ -1394,34 +1938,15 @@ void    EFF_Device::GetZeroTimeStamp(Float64& outSampleTime,
     }
     else
     {
-        // Without a wrapped device, we base our timing on the host. This is mostly from Apple's NullAudio.c sample code
-        UInt64  theCurrentHostTime;
-        Float64 theHostTicksPerRingBuffer;
-        Float64 theHostTickOffset;
-        UInt64  theNextHostTime;
-
-        // get the current host time
-        theCurrentHostTime = CAHostTimeBase::GetTheCurrentTime();
-
-        // calculate the next host time
-        theHostTicksPerRingBuffer = mLoopbackTime.hostTicksPerFrame * kLoopbackRingBufferFrameSize;
-        // The offset is the # of ticks from the anchor time to the next sample time
-        // Consequently the next host time is the host time at the next sample time
-        theHostTickOffset = static_cast<Float64>(mLoopbackTime.numberTimeStamps + 1) * theHostTicksPerRingBuffer;
-        theNextHostTime = mLoopbackTime.anchorHostTime + static_cast<UInt64>(theHostTickOffset);
-        
-        // advance to the next sample time if the calculated next host time is less than the current host time
-        if(theNextHostTime <= theCurrentHostTime)
-        {
-            mLoopbackTime.numberTimeStamps++;
-        }
-
-        // set the return values
-        outSampleTime = mLoopbackTime.numberTimeStamps * kLoopbackRingBufferFrameSize;
-        outHostTime = static_cast<UInt64>(mLoopbackTime.anchorHostTime +
-                                          (static_cast<Float64>(mLoopbackTime.numberTimeStamps) * theHostTicksPerRingBuffer));
+        // Without a wrapped device, we base our timing on the host. This is mostly from Apple's
+        // NullAudio.c sample code, except that the clock's rate can follow the output device's. See
+        // EFF_LoopbackClock.
+        //
         // TODO: I think we should increment outSeed whenever this device switches to/from having a wrapped engine
-        outSeed = 1;
+        mLoopbackClock.GetZeroTimeStamp(CAHostTimeBase::GetTheCurrentTime(),
+                                        outSampleTime,
+                                        outHostTime,
+                                        outSeed);
     }
 }
 
@@ -1441,7 +1966,7 @@ const
             break;
 
         case kAudioServerPlugInIOOperationProcessMix:
-            outWillDo = mVolumeControl.WillApplyVolumeToAudioRT();
+            outWillDo = mVolumeControl.WillApplyVolumeToAudioRT() || mMuteControl.WillApplyMuteToAudioRT();
             outWillDoInPlace = true;
             break;
 
@@ -1477,7 +2002,12 @@ void    EFF_Device::BeginIOOperation(UInt32 inOperationID,
         //
         // We don't have to hold the IO mutex here because mTaskQueue and mClients don't change and
         // adding a task to mTaskQueue is thread safe.
-        mTaskQueue.QueueAsync_StartClientIO(&mClients, inClientID);
+        //
+        // mTaskQueue skips the task if the client is already known to be doing IO, e.g. because it
+        // was the first client and StartIO has already updated its state.
+        bool didQueueTask = mTaskQueue.QueueAsync_StartClientIO(&mClients, inClientID);
+        mIOStats.IncrementCounterRT(didQueueTask ? EFF_IOStats::kCounterClientIOTasksQueued :
+                                                   EFF_IOStats::kCounterClientIOTasksSkipped);
     }
 }
 
@@ -1489,70 +2019,173 @@ void    EFF_Device::DoIOOperation(AudioObjectID inStreamObjectID,
                                   void* ioMainBuffer,
                                   void* ioSecondaryBuffer)
 {
-    #pragma unused(inStreamObjectID, ioSecondaryBuffer)
+    #pragma unused(ioSecondaryBuffer)
     
     switch(inOperationID)
     {
         case kAudioServerPlugInIOOperationReadInput:
+            // Copy the audio data out of our ring buffer.
+            //
+            // We used to take the IO mutex here because CARingBuffer::Fetch could fail with
+            // kCARingBufferError_CPUOverload if WriteMix was storing at the same time, which would
+            // make us write silence instead and cause an audio glitch. EFF_LoopbackRingBuffer is
+            // wait-free for a single reader and writer, so there's nothing for the mutex to protect.
+            //
+            // If an IO operation misses its deadline, the host will log this message:
+            //     Audio IO Overload inputs: '<private>' outputs: '<private>' cause: 'Unknown'
+            //     prewarming: no recovering: no
+            //
+            // mIOStats records how long each operation takes so we can tell which one was slow.
+            //
+            // The host calls this once per input stream, so it's also called for the per-app
+            // loopback stream while that's active.
             {
-                CAMutex::Locker theIOLocker(mIOMutex);
+                EFF_IOStats::OperationTimer theTimer(mIOStats, EFF_IOStats::kOperationReadInput);
 
-                // Copy the audio data out of our ring buffer.
-                //
-                // Take the IO mutex because, in testing, not taking it seemed to make this function
-                // occasionally miss its deadline and cause an audio glitch. It's hard to be sure
-                // that was actually the cause, but it's probably not worth the risk anyway.
-                //
-                // If an IO operation misses its deadline, the host will log this message:
-                //     Audio IO Overload inputs: '<private>' outputs: '<private>' cause: 'Unknown'
-                //     prewarming: no recovering: no
-                ReadInputData(inIOBufferFrameSize,
-                              inIOCycleInfo.mInputTime.mSampleTime,
-                              ioMainBuffer);
+                if(inStreamObjectID == mAppLoopbackStream.GetObjectID())
+                {
+                    ReadAppLoopbackData(inIOBufferFrameSize,
+                                        inIOCycleInfo.mInputTime.mSampleTime,
+                                        ioMainBuffer);
+                }
+                else
+                {
+                    ReadInputData(inIOBufferFrameSize,
+                                  inIOCycleInfo.mInputTime.mSampleTime,
+                                  ioMainBuffer);
+                }
             }
             break;
 
         case kAudioServerPlugInIOOperationProcessOutput:
             // From docs: This operation is about the buffer for one particular client.
             {
-                bool theClientIsMusicPlayer = mClients.IsMusicPlayerRT(inClientID);
+                EFF_IOStats::OperationTimer theTimer(mIOStats, EFF_IOStats::kOperationProcessOutput);
 
-                CAMutex::Locker theIOLocker(mIOMutex);
-                // Called in this IO operation so we can get the music player client's data separately
-                mAudibleState.UpdateWithClientIO(theClientIsMusicPlayer,
-                                                 inIOBufferFrameSize,
-                                                 inIOCycleInfo.mOutputTime.mSampleTime,
-                                                 reinterpret_cast<const Float32*>(ioMainBuffer));
+                // Get all of the client's settings at once so they're consistent for the whole cycle.
+                EFF_ClientRampState* theClientRampState;
+                EFF_ClientIOParams theClientParams =
+                    mClients.GetClientIOParamsRT(inIOCycleInfo.mIOCycleCounter, inClientID, &theClientRampState);
+
+                {
+                    UInt64 theLockStartTime = CAHostTimeBase::GetTheCurrentTime();
+                    CAMutex::Locker theIOLocker(mIOMutex);
+                    mIOStats.RecordOperationRT(EFF_IOStats::kOperationIOMutexWait, theLockStartTime);
+
+                    // Called in this IO operation so we can get the music player client's data separately
+                    mAudibleState.UpdateWithClientIO(theClientParams.mIsMusicPlayer,
+                                                     mChannelsPerFrame,
+                                                     inIOBufferFrameSize,
+                                                     inIOCycleInfo.mOutputTime.mSampleTime,
+                                                     reinterpret_cast<const Float32*>(ioMainBuffer));
+                }
+
+                // Queue the client's audio to be recorded to its own track, if stems are being
+                // recorded. This is before its volume and pan are applied, so the stems can be
+                // remixed later.
+                mStemRecorder.CaptureClientRT(inClientID,
+                                              reinterpret_cast<const Float32*>(ioMainBuffer),
+                                              inIOBufferFrameSize,
+                                              inIOCycleInfo.mOutputTime.mSampleTime);
+
+                ApplyClientRelativeVolume(inClientID,
+                                          theClientParams,
+                                          theClientRampState,
+                                          inIOBufferFrameSize,
+                                          ioMainBuffer);
+
+                // Meter the client after applying its volume and pan so the levels match what it
+                // contributes to the mix.
+                mLevelMeters.MeterClientRT(inClientID,
+                                           mChannelsPerFrame,
+                                           inIOBufferFrameSize,
+                                           reinterpret_cast<const Float32*>(ioMainBuffer));
+
+                // Mix the client into its pair of the per-app loopback stream, if its app is
+                // selected. Also after its volume and pan, for the same reason.
+                if(mAppLoopbackEnabled && theClientParams.mHasAppLoopbackPair)
+                {
+                    mAppLoopback.MixClientRT(theClientParams.mAppLoopbackPair,
+                                             reinterpret_cast<const Float32*>(ioMainBuffer),
+                                             inIOBufferFrameSize,
+                                             inIOCycleInfo.mOutputTime.mSampleTime);
+                }
             }
-            ApplyClientRelativeVolume(inClientID, inIOBufferFrameSize, ioMainBuffer);
             break;
 
         case kAudioServerPlugInIOOperationProcessMix:
             // From docs: This operation processes the full mix of all clients' data in the canonical format.
             {
+                EFF_IOStats::OperationTimer theTimer(mIOStats, EFF_IOStats::kOperationProcessMix);
+
                 // Check the arguments.
                 ThrowIfNULL(ioMainBuffer,
                             CAException(kAudioHardwareIllegalOperationError),
                             "EFF_Device::DoIOOperation: Buffer for "
                                     "kAudioServerPlugInIOOperationProcessMix must not be null");
 
+                UInt64 theLockStartTime = CAHostTimeBase::GetTheCurrentTime();
                 CAMutex::Locker theIOLocker(mIOMutex);
+                mIOStats.RecordOperationRT(EFF_IOStats::kOperationIOMutexWait, theLockStartTime);
+
+                // We ask to do this IO operation so this device can apply its own volume and mute
+                // to the stream. Currently, only the UI sounds device applies its volume, and only
+                // the main device (which has the only mute control) applies its mute.
+                if(mVolumeControl.WillApplyVolumeToAudioRT())
+                {
+                    mVolumeControl.ApplyVolumeToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                        mChannelsPerFrame,
+                                                        inIOBufferFrameSize);
+                }
 
-                // We ask to do this IO operation so this device can apply its own volume to the
-                // stream. Currently, only the UI sounds device does.
-                mVolumeControl.ApplyVolumeToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                if(mMuteControl.WillApplyMuteToAudioRT())
+                {
+                    // Check whether the mix is audible before muting it, since WriteMix would only
+                    // see the muted mix. Otherwise muting EFFDevice would make it look silent to
+                    // EFFApp, which would e.g. make auto-pause unpause the music player.
+                    mAudibleStateChangedInProcessMix =
+                            mAudibleState.UpdateWithMixedIO(mChannelsPerFrame,
+                                                            inIOBufferFrameSize,
+                                                            inIOCycleInfo.mOutputTime.mSampleTime,
+                                                            reinterpret_cast<const Float32*>(ioMainBuffer));
+                    mAudibleStateUpdatedInProcessMix = true;
+
+                    mMuteControl.ApplyMuteToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                    mChannelsPerFrame,
                                                     inIOBufferFrameSize);
+                }
             }
             break;
 
         case kAudioServerPlugInIOOperationWriteMix:
-            // TODO: don't know but maybe this is where we can record things
             {
-                CAMutex::Locker theIOLocker(mIOMutex);
+                EFF_IOStats::OperationTimer theTimer(mIOStats, EFF_IOStats::kOperationWriteMix);
+                bool didChangeState;
+
+                {
+                    UInt64 theLockStartTime = CAHostTimeBase::GetTheCurrentTime();
+                    CAMutex::Locker theIOLocker(mIOMutex);
+                    mIOStats.RecordOperationRT(EFF_IOStats::kOperationIOMutexWait, theLockStartTime);
+
+                    if(mAudibleStateUpdatedInProcessMix)
+                    {
+                        // ProcessMix already checked the mix from before the mute.
+                        didChangeState = mAudibleStateChangedInProcessMix;
+                        mAudibleStateUpdatedInProcessMix = false;
+                    }
+                    else
+                    {
+                        didChangeState = mAudibleState.UpdateWithMixedIO(mChannelsPerFrame,
+                                                                         inIOBufferFrameSize,
+                                                                         inIOCycleInfo.mOutputTime.mSampleTime,
+                                                                         reinterpret_cast<const Float32*>(ioMainBuffer));
+                    }
+                }
 
-                bool didChangeState = mAudibleState.UpdateWithMixedIO(inIOBufferFrameSize,
-                                                                      inIOCycleInfo.mOutputTime.mSampleTime,
-                                                                      reinterpret_cast<const Float32*>(ioMainBuffer));
+                // Publishes the levels for this cycle, including the clients metered in ProcessOutput.
+                mLevelMeters.MeterMixRT(mChannelsPerFrame,
+                                        inIOBufferFrameSize,
+                                        reinterpret_cast<const Float32*>(ioMainBuffer));
 
                 if(didChangeState)
                 {
@@ -1561,11 +2194,44 @@ void    EFF_Device::DoIOOperation(AudioObjectID inStreamObjectID,
                                                                    GetObjectID());
                 }
 
-                // Copy the audio data into our ring buffer.
+                // Queue the mix to be recorded, if it's being recorded. This only copies it into a
+                // preallocated buffer. A separate thread writes it to the file.
+                UInt32 theDroppedBlocks = mMixRecorder.CaptureRT(reinterpret_cast<const Float32*>(ioMainBuffer),
+                                                                 inIOBufferFrameSize);
+
+                if(theDroppedBlocks > 0)
+                {
+                    mIOStats.IncrementCounterRT(EFF_IOStats::kCounterRecordingDroppedBlocks, theDroppedBlocks);
+                }
+
+                // Every client's audio for this cycle has been through ProcessOutput now, so let the
+                // stem recorder write the cycle.
+                mStemRecorder.EndCycleRT(inIOBufferFrameSize, inIOCycleInfo.mOutputTime.mSampleTime);
+
+                // The same goes for the per-app loopback stream. This stores the cycle's per-app audio
+                // so ReadInput can read it at the same sample time as the mix.
+                if(mAppLoopbackEnabled &&
+                   mAppLoopback.EndCycleRT(inIOBufferFrameSize,
+                                           inIOCycleInfo.mOutputTime.mSampleTime) != kEFFRingBufferError_OK)
+                {
+                    mIOStats.IncrementCounterRT(EFF_IOStats::kCounterRingBufferOverloads);
+                }
+
+                // Copy the audio data into our ring buffer. This doesn't need the IO mutex. See the
+                // ReadInput case above.
                 WriteOutputData(inIOBufferFrameSize,
                                 inIOCycleInfo.mOutputTime.mSampleTime,
                                 ioMainBuffer);
             }
+
+            // WriteMix is the last operation in each cycle. If our operations took longer than the
+            // buffer lasts, the HAL can't have finished the cycle on time.
+            if(mIOStats.EndCycleRT(static_cast<UInt64>(inIOCycleInfo.mDeviceHostTicksPerFrame * inIOBufferFrameSize)))
+            {
+                // Log the stats and tell any listeners they've changed. (Not real-time safe, so
+                // done on the non-real-time worker thread.)
+                mTaskQueue.QueueAsync_PublishIOStats(&mIOStats, GetObjectID());
+            }
             break;
 
         default:
@@ -1588,45 +2254,60 @@ void    EFF_Device::EndIOOperation(UInt32 inOperationID,
         //
         // We don't have to hold the IO mutex here because mTaskQueue and mClients don't change and adding a task to
         // mTaskQueue is thread safe.
-        mTaskQueue.QueueAsync_StopClientIO(&mClients, inClientID);
+        bool didQueueTask = mTaskQueue.QueueAsync_StopClientIO(&mClients, inClientID);
+        mIOStats.IncrementCounterRT(didQueueTask ? EFF_IOStats::kCounterClientIOTasksQueued :
+                                                   EFF_IOStats::kCounterClientIOTasksSkipped);
     }
 }
 
 void    EFF_Device::ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* outBuffer)
 {
-    // Wrap the provided buffer in an AudioBufferList.
-    AudioBufferList abl = {
-        .mNumberBuffers = 1,
-        .mBuffers[0] = {
-            .mNumberChannels = 2,
-            // Each frame is 2 Float32 samples (one per channel).
-            // # of frames * # of bytes per frame = size of outBuffer in bytes
-            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * 2),
-            .mData = outBuffer
-        }
-    };
+    // Copy the audio data from our ring buffer into the provided buffer. Each frame is
+    // mChannelsPerFrame Float32 samples (one per channel). Any frames that aren't in the ring buffer
+    // are filled with silence.
+    UInt32 theSilentFrames;
+    EFF_RingBufferError err = mLoopbackRingBuffer.Fetch(reinterpret_cast<Float32*>(outBuffer),
+                                                        inIOBufferFrameSize,
+                                                        static_cast<EFF_LoopbackRingBuffer::SampleTime>(inSampleTime),
+                                                        &theSilentFrames);
+
+    if(theSilentFrames > 0)
+    {
+        mIOStats.IncrementCounterRT(EFF_IOStats::kCounterSilentFrames, theSilentFrames);
+    }
+
+    // Handle errors. (Fetch can't actually fail at the moment, but handle it just in case.)
+    if(err != kEFFRingBufferError_OK)
+    {
+        // Write silence to the buffer and return an error code.
+        memset(outBuffer, 0, inIOBufferFrameSize * sizeof(Float32) * mChannelsPerFrame);
+        Throw(CAException(kAudioHardwareIllegalOperationError));
+    }
+}
 
-    // Copy the audio data from our ring buffer into the provided buffer.
-    CARingBufferError err = mLoopbackRingBuffer.Fetch(&abl,
-                                                      inIOBufferFrameSize,
-                                                      static_cast<CARingBuffer::SampleTime>(inSampleTime));
+void    EFF_Device::ReadAppLoopbackData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* outBuffer)
+{
+    // Each frame has one pair of channels for each selected app.
+    const size_t theBytesPerFrame = mAppLoopbackStream.GetChannelsPerFrame() * sizeof(Float32);
 
-    // Handle errors.
-    switch (err)
+    // The stream is only published while it's enabled, so this shouldn't happen.
+    if(!mAppLoopbackEnabled)
     {
-        case kCARingBufferError_CPUOverload:
-            // Write silence to the buffer.
-            memset(outBuffer, 0, abl.mBuffers[0].mDataByteSize);
-            break;
-        case kCARingBufferError_TooMuch:
-            // Should be impossible, but handle it just in case. Write silence to the buffer and
-            // return an error code.
-            memset(outBuffer, 0, abl.mBuffers[0].mDataByteSize);
-            Throw(CAException(kAudioHardwareIllegalOperationError));
-        case kCARingBufferError_OK:
-            break;
-        default:
-            throw CAException(kAudioHardwareUnspecifiedError);
+        memset(outBuffer, 0, inIOBufferFrameSize * theBytesPerFrame);
+        return;
+    }
+
+    // The silent frames aren't counted, unlike in ReadInputData, because they're expected whenever
+    // none of the selected apps are playing.
+    EFF_RingBufferError err = mAppLoopback.FetchRT(reinterpret_cast<Float32*>(outBuffer),
+                                                   inIOBufferFrameSize,
+                                                   inSampleTime,
+                                                   nullptr);
+
+    if(err != kEFFRingBufferError_OK)
+    {
+        memset(outBuffer, 0, inIOBufferFrameSize * theBytesPerFrame);
+        Throw(CAException(kAudioHardwareIllegalOperationError));
     }
 }
 
@@ -1634,79 +2315,183 @@ void    EFF_Device::WriteOutputData(UInt32 inIOBufferFrameSize,
                                     Float64 inSampleTime,
                                     const void* inBuffer)
 {
-    // Wrap the provided buffer in an AudioBufferList.
-    AudioBufferList abl = {
-        .mNumberBuffers = 1,
-        .mBuffers[0] = {
-            .mNumberChannels = 2,
-            // Each frame is 2 Float32 samples (one per channel). The number of frames * the number
-            // of bytes per frame = the size of inBuffer in bytes.
-            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * 2),
-            .mData = const_cast<void *>(inBuffer)
-        }
-    };
+    // The HAL lets clients choose IO buffers bigger than the loopback buffer can take, at least at
+    // high sample rates. Storing one would overwrite frames EFFApp still has to read, so drop it and
+    // count it as an overload instead.
+    if(inIOBufferFrameSize > mMaxIOBufferFrameSize)
+    {
+        mIOStats.IncrementCounterRT(EFF_IOStats::kCounterRingBufferOverloads);
+        Throw(CAException(kEFFRingBufferError_TooMuch));
+    }
 
-    // Copy the audio data from the provided buffer into our ring buffer.
-    CARingBufferError err = mLoopbackRingBuffer.Store(&abl,
-                                                      inIOBufferFrameSize,
-                                                      static_cast<CARingBuffer::SampleTime>(inSampleTime));
+    // Copy the audio data from the provided buffer into our ring buffer. Each frame is
+    // mChannelsPerFrame Float32 samples (one per channel).
+    EFF_RingBufferError err = mLoopbackRingBuffer.Store(reinterpret_cast<const Float32*>(inBuffer),
+                                                        inIOBufferFrameSize,
+                                                        static_cast<EFF_LoopbackRingBuffer::SampleTime>(inSampleTime));
 
-    // Return an error code if we failed to store the data. (But ignore CPU overload, which would be
-    // temporary.)
-    if (err != kCARingBufferError_OK && err != kCARingBufferError_CPUOverload)
+    // Return an error code if we failed to store the data.
+    if(err != kEFFRingBufferError_OK)
     {
+        mIOStats.IncrementCounterRT(EFF_IOStats::kCounterRingBufferOverloads);
         Throw(CAException(err));
     }
 }
 
 void    EFF_Device::ApplyClientRelativeVolume(UInt32 inClientID,
+                                              const EFF_ClientIOParams& inClientParams,
+                                              EFF_ClientRampState* __nullable ioClientRampState,
                                               UInt32 inIOBufferFrameSize,
                                               void* ioBuffer)
 const
 {
-    Float32* theBuffer = reinterpret_cast<Float32*>(ioBuffer);
-    Float32 theRelativeVolume = mClients.GetClientRelativeVolumeRT(inClientID);
-    
-    auto thePanPositionInt = mClients.GetClientPanPositionRT(inClientID);
-    Float32 thePanPosition = static_cast<Float32>(thePanPositionInt) / 100.0f;
+    // While a ramp is in progress, we recalculate the matrix every kRampSegmentFrames frames and
+    // interpolate linearly between those points. That's close enough to follow exponential ramps
+    // without audible steps.
+    static const UInt32 kRampSegmentFrames = 32;
     
-    // TODO When we get around to supporting devices with more than two channels it would be worth looking into
-    //      kAudioFormatProperty_PanningMatrix and kAudioFormatProperty_BalanceFade in AudioFormat.h.
-    
-    // TODO precompute matrix coefficients w/ volume and do everything in one pass
+    Float32* theBuffer = reinterpret_cast<Float32*>(ioBuffer);
+    Float32 theRelativeVolume = inClientParams.mRelativeVolume;
+    Float32 thePanPosition = static_cast<Float32>(inClientParams.mPanPosition) / 100.0f;
+    UInt32 theFramesDone = 0;
     
-    // Apply balance w/ crossfeed to the frames in the buffer.
-    // Expect samples interleaved, starting with left
-    if (thePanPosition > 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
+    if(ioClientRampState)
+    {
+        EFF_ParamRamp& theVolumeRamp = ioClientRampState->mRelativeVolume;
+        EFF_ParamRamp& thePanRamp = ioClientRampState->mPanPosition;
+
+        ioClientRampState->UpdateTargets(inClientID, inClientParams);
+
+        while(theFramesDone < inIOBufferFrameSize && (theVolumeRamp.IsRamping() || thePanRamp.IsRamping()))
+        {
+            UInt32 theSegmentFrames = std::min({ kRampSegmentFrames,
+                                                 inIOBufferFrameSize - theFramesDone,
+                                                 std::max(theVolumeRamp.GetFramesRemaining(),
+                                                          thePanRamp.GetFramesRemaining()) });
             
-            theBuffer[R] = theBuffer[R] + theBuffer[L] * thePanPosition;
-            theBuffer[L] = theBuffer[L] * (1 - thePanPosition);
-        }
-    } else if (thePanPosition < 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
+            Float32 theStartVolume = theVolumeRamp.GetValue();
+            EFF_PanGainMatrix theStartMatrix =
+                    EFF_AudioKernels::MakePanGainMatrix(theStartVolume, thePanRamp.GetValue());
+            
+            theVolumeRamp.Advance(theSegmentFrames);
+            thePanRamp.Advance(theSegmentFrames);
+            
+            EFF_PanGainMatrix theEndMatrix =
+                    EFF_AudioKernels::MakePanGainMatrix(theVolumeRamp.GetValue(), thePanRamp.GetValue());
+            
+            EFF_AudioKernels::ApplyPanGainMatrixRamp(theStartMatrix,
+                                                     theEndMatrix,
+                                                     mChannelsPerFrame,
+                                                     theStartVolume != 1.0f || theVolumeRamp.GetValue() != 1.0f,
+                                                     theBuffer + theFramesDone * mChannelsPerFrame,
+                                                     theSegmentFrames);
             
-            theBuffer[L] = theBuffer[L] + theBuffer[R] * (-thePanPosition);
-            theBuffer[R] = theBuffer[R] * (1 + thePanPosition);
+            theFramesDone += theSegmentFrames;
         }
+
+        // Any ramps have finished, so the values will have reached their targets.
+        theRelativeVolume = theVolumeRamp.GetValue();
+        thePanPosition = thePanRamp.GetValue();
+    }
+    
+    // Fold the pan (balance w/ crossfeed) and volume into one matrix so we only have to make one pass
+    // over the rest of the buffer. The matrix only mixes the channels within each left/right pair,
+    // so EFF_PanGainMatrix stores it as the block for one pair and the gain for the other channels.
+    EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(theRelativeVolume, thePanPosition);
+
+    if(theFramesDone < inIOBufferFrameSize && !theMatrix.IsIdentity())
+    {
+        // Only clamp to [-1, 1] if the volume was changed. Panning alone has never been clipped.
+        EFF_AudioKernels::ApplyPanGainMatrix(theMatrix,
+                                             mChannelsPerFrame,
+                                             theRelativeVolume != 1.0f,
+                                             theBuffer + theFramesDone * mChannelsPerFrame,
+                                             inIOBufferFrameSize - theFramesDone);
     }
+}
+
+// Adds the kEFFLevelMetersKey_Peak*/RMS* entries for inLevels.
+static void AddLevelsToDictionary(const EFF_Levels& inLevels, CACFDictionary& ioDictionary)
+{
+    ioDictionary.AddFloat32(CFSTR(kEFFLevelMetersKey_PeakLeft), inLevels.mPeak[0]);
+    ioDictionary.AddFloat32(CFSTR(kEFFLevelMetersKey_PeakRight), inLevels.mPeak[1]);
+    ioDictionary.AddFloat32(CFSTR(kEFFLevelMetersKey_RMSLeft), inLevels.mRMS[0]);
+    ioDictionary.AddFloat32(CFSTR(kEFFLevelMetersKey_RMSRight), inLevels.mRMS[1]);
+}
+
+CFDictionaryRef EFF_Device::CopyLevelMetersAsDictionary() const
+{
+    EFF_LevelMeters::Snapshot theSnapshot;
+
+    if(!mLevelMeters.CopySnapshot(theSnapshot))
+    {
+        // The IO thread kept publishing while we were copying. Report silence rather than levels
+        // that could be from different cycles.
+        DebugMsg("EFF_Device::CopyLevelMetersAsDictionary: Couldn't get a consistent snapshot");
+        theSnapshot = EFF_LevelMeters::Snapshot();
+    }
+
+    // The dictionary we return is released by the caller. The nested collections are released when
+    // they go out of scope, which is fine because their containers retain them.
+    CACFDictionary theLevelMeters(false);
 
-    if(theRelativeVolume != 1.0f)
+    CACFDictionary theMixLevels(true);
+    AddLevelsToDictionary(theSnapshot.mMix, theMixLevels);
+    theLevelMeters.AddDictionary(CFSTR(kEFFLevelMetersKey_Mix), theMixLevels.GetDict());
+
+    CACFArray theClientLevelsArray(true);
+
+    for(UInt32 i = 0; i < theSnapshot.mNumberClients; i++)
     {
-        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i++)
+        const EFF_LevelMeters::ClientLevels& theClientLevels = theSnapshot.mClients[i];
+
+        // Skip clients that were removed after the levels were published.
+        EFF_Client theClient;
+        if(mClients.GetClientNonRT(theClientLevels.mClientID, &theClient))
         {
-            Float32 theAdjustedSample = theBuffer[i] * theRelativeVolume;
+            CACFDictionary theClientDict(true);
+            theClientDict.AddSInt32(CFSTR(kEFFAppVolumesKey_ProcessID), theClient.mProcessID);
+
+            CFStringRef theBundleID = theClient.GetBundleID().CopyCFString();
+            if(theBundleID)
+            {
+                theClientDict.AddString(CFSTR(kEFFAppVolumesKey_BundleID), theBundleID);
+                CFRelease(theBundleID);
+            }
 
-            // Clamp to [-1, 1].
-            // (This way is roughly 6 times faster than using std::min and std::max because the compiler can vectorize the loop.)
-            const Float32 theAdjustedSampleClippedBelow = theAdjustedSample < -1.0f ? -1.0f : theAdjustedSample;
-            theBuffer[i] = theAdjustedSampleClippedBelow > 1.0f ? 1.0f : theAdjustedSampleClippedBelow;
+            AddLevelsToDictionary(theClientLevels.mLevels, theClientDict);
+            theClientLevelsArray.AppendDictionary(theClientDict.GetDict());
         }
     }
+
+    theLevelMeters.AddArray(CFSTR(kEFFLevelMetersKey_Clients), theClientLevelsArray.GetCFArray());
+
+    return theLevelMeters.GetDict();
+}
+
+CFDictionaryRef EFF_Device::CopyClockStatusAsDictionary() const
+{
+    bool theIsLocked;
+    Float64 theRateScalar;
+    Float64 theHostTicksPerFrame;
+    UInt64 theSeed;
+
+    // Copy the values first so the IO mutex isn't held while allocating.
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+        theIsLocked = mLoopbackClock.IsLocked();
+        theRateScalar = mLoopbackClock.GetRateScalar();
+        theHostTicksPerFrame = mLoopbackClock.GetHostTicksPerFrame();
+        theSeed = mLoopbackClock.GetSeed();
+    }
+
+    CACFDictionary theClockStatus(false);
+    theClockStatus.AddBool(CFSTR(kEFFClockReferenceKey_Locked), theIsLocked);
+    theClockStatus.AddFloat64(CFSTR(kEFFClockReferenceKey_RateScalar), theRateScalar);
+    theClockStatus.AddFloat64(CFSTR(kEFFClockReferenceKey_HostTicksPerFrame), theHostTicksPerFrame);
+    theClockStatus.AddUInt64(CFSTR(kEFFClockReferenceKey_Seed), theSeed);
+
+    return theClockStatus.GetDict();
 }
 
 
@@ -1740,7 +2525,32 @@ void    EFF_Device::RequestEnabledControls(bool inVolumeEnabled, bool inMuteEnab
         AudioObjectID theDeviceObjectID = GetObjectID();
         UInt64 action = static_cast<UInt64>(ChangeAction::SetEnabledControls);
         
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,    ^{
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+            EFF_PlugIn::Host_RequestDeviceConfigurationChange(theDeviceObjectID, action, nullptr);
+        });
+    }
+}
+
+void    EFF_Device::RequestAppLoopbackStream(UInt32 inPairCount)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    // Always update this, so if the stream is added and then removed again before the host gets to
+    // the first change, the change does nothing.
+    mPendingAppLoopbackPairCount = inPairCount;
+
+    if(mAppLoopback.GetPairCount() != inPairCount)
+    {
+        DebugMsg("EFF_Device::RequestAppLoopbackStream: Changing the per-app loopback stream from %u to %u pairs",
+                 mAppLoopback.GetPairCount(),
+                 inPairCount);
+
+        // Ask the host to stop IO so we can safely update the device's list of streams. See
+        // RequestEnabledControls.
+        AudioObjectID theDeviceObjectID = GetObjectID();
+        UInt64 action = static_cast<UInt64>(ChangeAction::SetAppLoopbackStream);
+
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
             EFF_PlugIn::Host_RequestDeviceConfigurationChange(theDeviceObjectID, action, nullptr);
         });
     }
@@ -1788,11 +2598,44 @@ void    EFF_Device::RequestSampleRate(Float64 inRequestedSampleRate)
         mPendingSampleRate = inRequestedSampleRate;
 
         // Dispatch this so the change can happen asynchronously.
-        auto requestSampleRate = ^{
+        auto requestSampleRate = [this] {
             UInt64 action = static_cast<UInt64>(ChangeAction::SetSampleRate);
             EFF_PlugIn::Host_RequestDeviceConfigurationChange(GetObjectID(), action, nullptr);
         };
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, requestSampleRate);
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), requestSampleRate);
+    }
+}
+
+EFFLatencyProfile    EFF_Device::GetLatencyProfile()
+const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    return mLatencyProfile;
+}
+
+void    EFF_Device::RequestLatencyProfile(EFFLatencyProfile inRequestedProfile)
+{
+    // Like the sample rate, this needs the RequestConfigChange/PerformConfigChange machinery
+    // because the loopback buffer can't be reallocated while IO is running.
+    ThrowIf(!EFF_LatencyProfile::IsValid(inRequestedProfile),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_Device::RequestLatencyProfile: unknown latency profile");
+
+    DebugMsg("EFF_Device::RequestLatencyProfile: Latency profile change requested: %d",
+             inRequestedProfile);
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(inRequestedProfile != mLatencyProfile)
+    {
+        mPendingLatencyProfile = inRequestedProfile;
+
+        AudioObjectID theDeviceObjectID = GetObjectID();
+        UInt64 action = static_cast<UInt64>(ChangeAction::SetLatencyProfile);
+
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+            EFF_PlugIn::Host_RequestDeviceConfigurationChange(theDeviceObjectID, action, nullptr);
+        });
     }
 }
 
@@ -1813,6 +2656,10 @@ const
     {
         return mOutputStream;
     }
+    else if(inObjectID == mAppLoopbackStream.GetObjectID())
+    {
+        return mAppLoopbackStream;
+    }
     else if(inObjectID == mVolumeControl.GetObjectID())
     {
         return mVolumeControl;
@@ -1831,7 +2678,20 @@ const
 UInt32    EFF_Device::GetNumberOfSubObjects()
 const
 {
-    return kNumberOfInputSubObjects + GetNumberOfOutputSubObjects();
+    return GetNumberOfInputStreams() + GetNumberOfOutputSubObjects();
+}
+
+UInt32    EFF_Device::GetNumberOfStreams()
+const
+{
+    return GetNumberOfInputStreams() + kNumberOfOutputStreams;
+}
+
+UInt32    EFF_Device::GetNumberOfInputStreams()
+const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    return mAppLoopbackStream.IsActive() ? 2 : 1;
 }
 
 UInt32    EFF_Device::GetNumberOfOutputSubObjects()
@@ -1895,6 +2755,42 @@ void    EFF_Device::SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled)
     }
 }
 
+void    EFF_Device::SetAppLoopbackStream(UInt32 inPairCount)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(mAppLoopback.GetPairCount() == inPairCount)
+    {
+        return;
+    }
+
+    DebugMsg("EFF_Device::SetAppLoopbackStream: Changing the per-app loopback stream from %u to %u pairs",
+             mAppLoopback.GetPairCount(),
+             inPairCount);
+
+    // IO is stopped, so the IO thread isn't using mAppLoopback. The host rereads the stream's
+    // format after the config change.
+    if(inPairCount > 0)
+    {
+        mAppLoopback.Allocate(mChannelsPerFrame,
+                              inPairCount,
+                              EFF_LatencyProfile::kLoopbackRingBufferFrames);
+        mAppLoopbackStream.SetChannelsPerFrame(mAppLoopback.GetChannelsPerFrame());
+        mAppLoopbackEnabled = true;
+
+        if(!mAppLoopbackStream.IsActive())
+        {
+            mAppLoopbackStream.Activate();
+        }
+    }
+    else
+    {
+        mAppLoopbackStream.Deactivate();
+        mAppLoopbackEnabled = false;
+        mAppLoopback.Deallocate();
+    }
+}
+
 void EFF_Device::SetSampleRate(Float64 inSampleRate, bool force)
 {
     // We try to support any sample rate a real output device might.
@@ -1922,6 +2818,20 @@ void EFF_Device::SetSampleRate(Float64 inSampleRate, bool force)
                                "wrapped audio device.");
         }
 
+        // A recording can't change sample rate part way through, so finish it. (This is only
+        // called while IO is stopped, so the recording is complete.)
+        if(mMixRecorder.IsRecording())
+        {
+            DebugMsg("EFF_Device::SetSampleRate: Stopping the recording");
+            mMixRecorder.Stop();
+        }
+
+        if(mStemRecorder.IsRecording())
+        {
+            DebugMsg("EFF_Device::SetSampleRate: Stopping the stem recording");
+            mStemRecorder.Stop();
+        }
+
         // Update the sample rate for loopback.
         mLoopbackSampleRate = inSampleRate;
         InitLoopback();
@@ -1929,6 +2839,7 @@ void EFF_Device::SetSampleRate(Float64 inSampleRate, bool force)
         // Update the streams.
         mInputStream.SetSampleRate(inSampleRate);
         mOutputStream.SetSampleRate(inSampleRate);
+        mAppLoopbackStream.SetSampleRate(inSampleRate);
     }
     else
     {
@@ -1936,10 +2847,36 @@ void EFF_Device::SetSampleRate(Float64 inSampleRate, bool force)
     }
 }
 
+void    EFF_Device::SetLatencyProfile(EFFLatencyProfile inNewProfile)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(inNewProfile != mLatencyProfile)
+    {
+        DebugMsg("EFF_Device::SetLatencyProfile: Changing the latency profile from %d to %d",
+                 mLatencyProfile,
+                 inNewProfile);
+
+        mLatencyProfile = inNewProfile;
+        InitLoopback();
+
+        // The host rereads the device's properties after a configuration change, but not our
+        // custom ones.
+        AudioObjectID theDeviceObjectID = GetObjectID();
+
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
+            AudioObjectPropertyAddress theChangedProperties[] = { kEFFLatencyProfileAddress };
+            EFF_PlugIn::Host_PropertiesChanged(theDeviceObjectID, 1, theChangedProperties);
+        });
+    }
+}
+
 bool    EFF_Device::IsStreamID(AudioObjectID inObjectID)
 const noexcept
 {
-    return (inObjectID == mInputStream.GetObjectID()) || (inObjectID == mOutputStream.GetObjectID());
+    return (inObjectID == mInputStream.GetObjectID()) ||
+           (inObjectID == mOutputStream.GetObjectID()) ||
+           (mAppLoopbackStream.IsActive() && (inObjectID == mAppLoopbackStream.GetObjectID()));
 }
 
 
@@ -1964,14 +2901,21 @@ kern_return_t    EFF_Device::_HW_StartIO()
     {
     }
     
-    // Reset the loopback timing values
-    mLoopbackTime.numberTimeStamps = 0;
-    mLoopbackTime.anchorHostTime = CAHostTimeBase::GetTheCurrentTime();
+    // Reset the loopback timing values. The clock is also used when kAudioDeviceCustomPropertyClockReference is set,
+    // so this needs the IO mutex even though IO hasn't started.
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+        mLoopbackClock.Start(CAHostTimeBase::GetTheCurrentTime());
+    }
     // ...and the most-recent audible/silent sample times. mAudibleState is usually guarded by the
     // IO mutex, but we haven't started IO yet (and this function can only be called by one thread
     // at a time).
     EFFAssert(mIOMutex.IsFree(), "EFF_Device::_HW_StartIO: IO mutex taken before starting IO");
     mAudibleState.Reset();
+    // Apply any volume or mute changes made while IO was stopped straight away, rather than ramping
+    // to them at the start of the first buffer. The ramps are also only used by the IO thread.
+    mVolumeControl.ResetVolumeRamp();
+    mMuteControl.ResetMuteFade();
     
     return KERN_SUCCESS;
 }
@@ -2041,6 +2985,12 @@ void    EFF_Device::RemoveClient(const AudioServerPlugInClientInfo* inClientInfo
         RequestEnabledControls(true, true);
     }
 
+    // Look the client up while we still can, in case it's been recorded to a stem.
+    if(mStemRecorder.IsRecording())
+    {
+        mStemRecorder.IdentifyTrackClients(mClients);
+    }
+
     mClients.RemoveClient(inClientInfo->mClientID);
 }
 
@@ -2062,6 +3012,14 @@ void    EFF_Device::PerformConfigChange(UInt64 inChangeAction, void* inChangeInf
             SetEnabledControls(mPendingOutputVolumeControlEnabled,
                                mPendingOutputMuteControlEnabled);
             break;
+
+        case ChangeAction::SetLatencyProfile:
+            SetLatencyProfile(mPendingLatencyProfile);
+            break;
+
+        case ChangeAction::SetAppLoopbackStream:
+            SetAppLoopbackStream(mPendingAppLoopbackPairCount);
+            break;
     }
 }
 
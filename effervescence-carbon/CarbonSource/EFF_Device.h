@@ -24,11 +24,17 @@
 #include "EFF_Stream.h"
 #include "EFF_VolumeControl.h"
 #include "EFF_MuteControl.h"
+#include "EFF_LoopbackRingBuffer.h"
+#include "EFF_LoopbackClock.h"
+#include "EFF_LevelMeters.h"
+#include "EFF_IOStats.h"
+#include "EFF_MixRecorder.h"
+#include "EFF_StemRecorder.h"
+#include "EFF_AppLoopback.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
 #include "CAVolumeCurve.h"
-#include "CARingBuffer.h"
 
 // System Includes
 #include <CoreFoundation/CoreFoundation.h>
@@ -53,8 +59,10 @@ protected:
                                            const CFStringRef __nonnull inDeviceModelUID,
                                            AudioObjectID inInputStreamID,
                                            AudioObjectID inOutputStreamID,
+                                           AudioObjectID inAppLoopbackStreamID,
                                            AudioObjectID inOutputVolumeControlID,
-                                           AudioObjectID inOutputMuteControlID);
+                                           AudioObjectID inOutputMuteControlID,
+                                           UInt32 inChannelsPerFrame);
     virtual                     ~EFF_Device();
 
     virtual void                Activate();
@@ -146,12 +154,17 @@ public:
                                                  const AudioServerPlugInIOCycleInfo& inIOCycleInfo,
                                                  UInt32 inClientID);
     /*!
-     @discussion All operations take IO lock.
+     @discussion All operations except ReadInput take IO lock.
         For each type of kAudioServerPlugInIOOperation{...}, we do:
-        ReadInput: Call ReadInputData() to copy from mLoopbackRingBuffer to ioMainBuffer
-        ProcessOutput: For inClientID, update audible state for that client and apply relative volume
-        ProcessMix: The device applies its own volume
-        WriteMix: Update audible state for the mix; copy data from ioMainBuffer to mLoopbackRingBuffer
+        ReadInput: Call ReadInputData() to copy from mLoopbackRingBuffer, or mAppLoopback for the
+            per-app loopback stream, to ioMainBuffer
+        ProcessOutput: For inClientID, update audible state for that client, apply relative volume
+            and mix it into its pair of mAppLoopback, if it has one
+        ProcessMix: The device applies its own volume and mute, with short ramps when they change
+        WriteMix: Update audible state for the mix; copy data from ioMainBuffer to mLoopbackRingBuffer;
+            store the cycle's per-app audio in mAppLoopback
+        mLoopbackRingBuffer is wait-free for one reader and one writer, so ReadInput and the copy in
+        WriteMix don't need the IO lock.
      */
     void                        DoIOOperation(AudioObjectID inStreamObjectID,
                                               UInt32 inClientID,
@@ -169,11 +182,18 @@ private:
     /*!
      @abstract Copy data in mLoopbackRingBuffer at inSampleTime to outBuffer
      @throws CAException(kAudioHardwareIllegalOperationError)
-     @throws CAException(kAudioHardwareUnspecifiedError)
      */
     void                        ReadInputData(UInt32 inIOBufferFrameSize,
                                               Float64 inSampleTime,
                                               void* __nonnull outBuffer);
+    /*!
+     @abstract Copy the per-app audio in mAppLoopback at inSampleTime to outBuffer, which has
+               mAppLoopbackStream's channels.
+     @throws CAException(kAudioHardwareIllegalOperationError)
+     */
+    void                        ReadAppLoopbackData(UInt32 inIOBufferFrameSize,
+                                                    Float64 inSampleTime,
+                                                    void* __nonnull outBuffer);
     /*!
      @abstract Copy data in inBuffer at inSampleTime to mLoopbackRingBuffer
      @throws CAException
@@ -182,11 +202,28 @@ private:
                                                 Float64 inSampleTime,
                                                 const void* __nonnull inBuffer);
     /*!
-     @abstract Applies volume and panning settings to a buffer with two channels.
+     @abstract Applies a client's volume and panning settings to a buffer with mChannelsPerFrame
+               channels.
+     @discussion If ioClientRampState is given, changes to the settings are ramped rather than
+                 applied all at once.
      */
     void                        ApplyClientRelativeVolume(UInt32 inClientID,
+                                                          const EFF_ClientIOParams& inClientParams,
+                                                          EFF_ClientRampState* __nullable ioClientRampState,
                                                           UInt32 inIOBufferFrameSize,
                                                           void* __nonnull inBuffer) const;
+    /*!
+     @abstract Builds the value of kAudioDeviceCustomPropertyLevelMeters from the levels most recently
+               published by the IO thread.
+     @return A new CFDictionary. The caller is responsible for releasing it.
+     */
+    CFDictionaryRef __nonnull   CopyLevelMetersAsDictionary() const;
+    /*!
+     @abstract Builds the value of kAudioDeviceCustomPropertyClockReference from the state of the
+               loopback clock.
+     @return A new CFDictionary. The caller is responsible for releasing it.
+     */
+    CFDictionaryRef __nonnull   CopyClockStatusAsDictionary() const;
     
 
 #pragma mark Accessors
@@ -199,6 +236,14 @@ public:
         See EFF_Device::PerformConfigChange and RequestDeviceConfigurationChange in AudioServerPlugIn.h.
      */
     void                        RequestEnabledControls(bool inVolumeEnabled, bool inMuteEnabled);
+    /*!
+     @abstract Request to add, remove or resize the device's per-app loopback stream, so it has
+        inPairCount pairs of channels, or isn't published if inPairCount is 0.
+     @discussion This function is async because it has to ask the host to stop IO for the device
+        before the stream can be changed. See kAudioDeviceCustomPropertyAppLoopback,
+        EFF_Device::PerformConfigChange and RequestDeviceConfigurationChange in AudioServerPlugIn.h.
+     */
+    void                        RequestAppLoopbackStream(UInt32 inPairCount);
 
     Float64                     GetSampleRate() const;
     /*!
@@ -209,6 +254,16 @@ public:
      */
     void                        RequestSampleRate(Float64 inRequestedSampleRate);
 
+    EFFLatencyProfile           GetLatencyProfile() const;
+    /*!
+     @abstract Request to change the device's latency profile.
+     @discussion This function is async because it has to ask the host to stop IO for the device
+        before the loopback buffer and clock can be changed.
+        See EFF_Device::PerformConfigChange and RequestDeviceConfigurationChange in AudioServerPlugIn.h.
+     @throws CAException if inRequestedProfile isn't one of the EFFLatencyProfile values.
+     */
+    void                        RequestLatencyProfile(EFFLatencyProfile inRequestedProfile);
+
 private:
     /*!
      @return The AudioObject that has the ID inObjectID and belongs to this device.
@@ -219,6 +274,13 @@ private:
     
     /*! @return The number of Audio Objects belonging to this device, e.g. streams and controls. */
     UInt32                      GetNumberOfSubObjects() const;
+    /*! @return The number of streams belonging to this device. */
+    UInt32                      GetNumberOfStreams() const;
+    /*!
+     @return The number of input streams belonging to this device, which are also its only Audio
+             Objects with input scope.
+     */
+    UInt32                      GetNumberOfInputStreams() const;
     /*! @return The number of Audio Objects with output scope belonging to this device. */
     UInt32                      GetNumberOfOutputSubObjects() const;
     /*!
@@ -235,6 +297,15 @@ private:
      RequestDeviceConfigurationChange in AudioServerPlugIn.h.
      */
     void                        SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled);
+    /*!
+     Give the device's per-app loopback stream inPairCount pairs of channels, adding it if it isn't
+     published, or remove it if inPairCount is 0. Reallocates or frees its buffers.
+
+     Private because this can only be called after asking the host to stop IO for the device. See
+     EFF_Device::RequestAppLoopbackStream, EFF_Device::PerformConfigChange and
+     RequestDeviceConfigurationChange in AudioServerPlugIn.h.
+     */
+    void                        SetAppLoopbackStream(UInt32 inPairCount);
     /*!
      Set the device's sample rate.
 
@@ -247,6 +318,14 @@ private:
      @throws CAException if inNewSampleRate < 1 or if applying the sample rate to one of the streams fails.
      */
     void                        SetSampleRate(Float64 inNewSampleRate, bool force = false);
+    /*!
+     Set the device's latency profile, reallocating the loopback buffer.
+
+     Private because this can only be called after asking the host to stop IO for the device. See
+     EFF_Device::RequestLatencyProfile, EFF_Device::PerformConfigChange and
+     RequestDeviceConfigurationChange in AudioServerPlugIn.h.
+     */
+    void                        SetLatencyProfile(EFFLatencyProfile inNewProfile);
     
     /*! @return True if inObjectID is the ID of one of this device's streams. */
     inline bool                 IsStreamID(AudioObjectID inObjectID) const noexcept;
@@ -268,6 +347,8 @@ private:
     
 public:
     CFStringRef __nonnull       CopyDeviceUID() const { return mDeviceUID; }
+    /*! The number of channels in each frame of both streams' audio. */
+    UInt32                      GetChannelsPerFrame() const { return mChannelsPerFrame; }
     void                        AddClient(const AudioServerPlugInClientInfo* __nonnull inClientInfo);
     void                        RemoveClient(const AudioServerPlugInClientInfo* __nonnull inClientInfo);
     /*!
@@ -293,11 +374,9 @@ private:
     
     enum
     {
-        // The number of global/output sub-objects varies because the controls can be disabled.
-                                        kNumberOfInputSubObjects            = 1,
-
-                                        kNumberOfStreams                    = 2,
-                                        kNumberOfInputStreams               = 1,
+        // The number of output sub-objects varies because the controls can be disabled, and the
+        // number of input sub-objects because the per-app loopback stream is optional. See
+        // GetNumberOfInputStreams.
                                         kNumberOfOutputStreams              = 1
     };
 
@@ -305,6 +384,10 @@ private:
     CAMutex                             mIOMutex;
     
     const Float64                       kSampleRateDefault = 44100.0;
+    static const UInt32                 kChannelsPerFrameDefault = 2;
+    // Both streams have this many channels. The loopback ring buffer and all of the IO operations
+    // use it too.
+    const UInt32                        mChannelsPerFrame;
     // Before we can change sample rate, the host has to stop the device. The new sample rate is
     // stored here while it does. Like the shadow maps in EFF_ClientMap
     Float64                             mPendingSampleRate = kSampleRateDefault;
@@ -315,31 +398,64 @@ private:
     
     EFF_Clients                         mClients;
     
-    #define kLoopbackRingBufferFrameSize    16384
+    // Sets the loopback clock's period and the safety offsets and latency the device reports. See
+    // EFF_LatencyProfile. Guarded by the state mutex. Only changed while IO is stopped, so the IO
+    // thread can read it without locking.
+    EFFLatencyProfile                   mLatencyProfile = kEFFLatencyProfileStandard;
+    // The latency profile to change to once the host has stopped IO. See mPendingSampleRate.
+    EFFLatencyProfile                   mPendingLatencyProfile = kEFFLatencyProfileStandard;
     Float64                             mLoopbackSampleRate;
-    CARingBuffer                        mLoopbackRingBuffer;
-    
-    // TODO: a comment explaining why we need a clock for loopback-only mode
-    // sample time := frames passed from hardware initialization to now == numberTimeStamps * kLoopbackRingBufferFrameSize
-    // host time := ticks passed from genesis to now == (anchorHostTime +
-    //                                                   numberTimeStamps * kLoopbackRingBufferFrameSize * hostTicksPerFrame)
-    // Side note: What GetZeroTimeStamp() does is return the timestamp of the next "rewind" of the ring buffer
-    //     in both sample time and host time formats
-    struct {
-        Float64                         hostTicksPerFrame = 0.0;    // Totally depends on the host
-        UInt64                          numberTimeStamps  = 0;      // # of sample times passed since _HW_StartIO
-        UInt64                          anchorHostTime    = 0;      // The host time when IO started in hardware
-    }                                   mLoopbackTime;
+    EFF_LoopbackRingBuffer              mLoopbackRingBuffer;
+    // The largest IO buffer mLoopbackRingBuffer can take with mLatencyProfile's safety offset.
+    // WriteMix rejects bigger ones rather than overwrite frames EFFApp hasn't read. Set with
+    // mLatencyProfile.
+    UInt32                              mMaxIOBufferFrameSize = 0;
+    
+    // Without a wrapped device, the device's timing comes from this clock, which GetZeroTimeStamp
+    // reads. It returns a timestamp every zero timestamp period of mLatencyProfile. Its rate can be
+    // slaved to the output device's clock by setting kAudioDeviceCustomPropertyClockReference.
+    // Guarded by the IO mutex.
+    EFF_LoopbackClock                   mLoopbackClock;
     
     EFF_Stream                          mInputStream;
     EFF_Stream                          mOutputStream;
+    // Only active, and so only published, while kAudioDeviceCustomPropertyAppLoopback selects any
+    // apps, and has a pair of channels for each one. Its audio is kept in mAppLoopback, which is
+    // only allocated while it's active.
+    EFF_Stream                          mAppLoopbackStream;
+    EFF_AppLoopback                     mAppLoopback;
+    // True while mAppLoopbackStream is active. Only changed while IO is stopped, so the IO thread can
+    // read it without locking.
+    bool                                mAppLoopbackEnabled = false;
+    // The number of pairs to give the stream once the host has stopped IO, or 0 to remove it. See
+    // mPendingSampleRate.
+    UInt32                              mPendingAppLoopbackPairCount = 0;
 
     EFF_AudibleState                    mAudibleState;
+    // Set when ProcessMix has updated mAudibleState with the mix from before the device's mute, so
+    // WriteMix doesn't update it again with the muted mix. Only used by the IO thread, while holding
+    // mIOMutex.
+    bool                                mAudibleStateUpdatedInProcessMix = false;
+    bool                                mAudibleStateChangedInProcessMix = false;
+    // Peak and RMS levels of each client and the mix. Written only by the IO thread and read
+    // without locking.
+    EFF_LevelMeters                     mLevelMeters;
+    // Timing histograms and error counts for the IO operations. Also written only by the IO thread
+    // and read without locking.
+    EFF_IOStats                         mIOStats;
+    // Records the mix WriteMix is given while kAudioDeviceCustomPropertyRecording is set. Never
+    // blocks the IO thread.
+    EFF_MixRecorder                     mMixRecorder;
+    // Records each client's audio from ProcessOutput to its own track while
+    // kAudioDeviceCustomPropertyStemRecording is set. Also never blocks the IO thread.
+    EFF_StemRecorder                    mStemRecorder;
     
     enum class ChangeAction : UInt64
     {
         SetSampleRate,
-        SetEnabledControls
+        SetEnabledControls,
+        SetLatencyProfile,
+        SetAppLoopbackStream
     };
     
     EFF_VolumeControl                   mVolumeControl;
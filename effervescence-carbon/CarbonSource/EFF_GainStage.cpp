@@ -0,0 +1,88 @@
+//
+//  EFF_GainStage.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_GainStage.h"
+
+// Local Includes
+#include "EFF_AudioKernels.h"
+
+// STL Includes
+#include <algorithm>
+
+// System Includes
+#include <string.h>
+
+
+#pragma clang assume_nonnull begin
+
+EFF_GainStage::EFF_GainStage(Float32 inInitialGain, UInt32 inRampFrames)
+:
+    mTargetGain(inInitialGain),
+    mRampFrames(inRampFrames)
+{
+    mRamp.Reset(inInitialGain);
+}
+
+void    EFF_GainStage::Reset()
+{
+    mRamp.Reset(GetGain());
+}
+
+void    EFF_GainStage::ProcessRT(Float32* ioBuffer, UInt32 inChannelsPerFrame, UInt32 inFrameCount)
+{
+    // If the gain has changed since the last buffer, start ramping to it. If a ramp was already in
+    // progress, the new one starts from wherever it had got to.
+    const Float32 theTargetGain = GetGain();
+
+    if(theTargetGain != mRamp.GetTarget())
+    {
+        mRamp.SetTarget(theTargetGain, mRampFrames, EFF_ParamRamp::kShapeLinear);
+    }
+
+    UInt32 theRampFrames = 0;
+
+    if(mRamp.IsRamping())
+    {
+        // The ramp might finish partway through the buffer.
+        theRampFrames = std::min(inFrameCount, mRamp.GetFramesRemaining());
+
+        const Float32 theStartGain = mRamp.GetValue();
+        mRamp.Advance(theRampFrames);
+
+        EFF_AudioKernels::ApplyGainRamp(theStartGain,
+                                        mRamp.GetValue(),
+                                        inChannelsPerFrame,
+                                        ioBuffer,
+                                        theRampFrames);
+    }
+
+    ApplyConstantGain(mRamp.GetValue(),
+                      ioBuffer + theRampFrames * inChannelsPerFrame,
+                      (inFrameCount - theRampFrames) * inChannelsPerFrame);
+}
+
+void    EFF_GainStage::ApplyConstantGain(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+    if(inGain == 1.0f)
+    {
+        return;
+    }
+
+    if(inGain == 0.0f)
+    {
+        // Silence the buffer. Writing zeros is cheaper than multiplying and also replaces any NaNs.
+        memset(ioBuffer, 0, inSampleCount * sizeof(Float32));
+        return;
+    }
+
+    EFF_AudioKernels::ApplyGain(inGain, ioBuffer, inSampleCount);
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,76 @@
+//
+//  EFF_GainStage.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Applies a gain to interleaved audio. When the gain is changed, the stage ramps from the
+//  old gain to the new one sample by sample over a fixed number of frames, rather than jumping to
+//  it at the start of the next buffer, so changing it doesn't cause an audible click.
+//
+//  Any thread can set the gain. Only the IO thread may call ProcessRT. Buffers are left untouched
+//  while the gain is exactly 1 and not ramping.
+//
+
+#ifndef EFF_GainStage_h
+#define EFF_GainStage_h
+
+// Local Includes
+#include "EFF_ParamRamp.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_GainStage
+{
+
+public:
+    /*!
+     @param inInitialGain The gain to start at.
+     @param inRampFrames The number of frames it takes to ramp to a new gain.
+     */
+                                EFF_GainStage(Float32 inInitialGain, UInt32 inRampFrames);
+                                // Disallow copying
+                                EFF_GainStage(const EFF_GainStage&) = delete;
+                                EFF_GainStage& operator=(const EFF_GainStage&) = delete;
+
+    /*! Set the gain to ramp to. Real-time safe. */
+    void                        SetGain(Float32 inGain)
+                                    { mTargetGain.store(inGain, std::memory_order_relaxed); }
+    Float32                     GetGain() const
+                                    { return mTargetGain.load(std::memory_order_relaxed); }
+
+    /*!
+     Jump straight to the gain, cancelling any ramp in progress. Must not be called while IO is
+     running, unless from the IO thread. This is so a change made while IO was stopped doesn't ramp
+     at the start of the next buffer.
+     */
+    void                        Reset();
+
+    /*! Apply the gain to an interleaved buffer in place. */
+    void                        ProcessRT(Float32* ioBuffer, UInt32 inChannelsPerFrame, UInt32 inFrameCount);
+
+private:
+    // Applies the gain to the samples without ramping. Skips the multiplication when inGain is 0
+    // or 1.
+    static void                 ApplyConstantGain(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount);
+
+    // The gain most recently set. Read by the IO thread at the start of each buffer.
+    std::atomic<Float32>        mTargetGain;
+    const UInt32                mRampFrames;
+    // The gain actually being applied. Only used by the IO thread (or while IO is stopped).
+    EFF_ParamRamp               mRamp;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_GainStage_h */
+
@@ -0,0 +1,295 @@
+//
+//  EFF_IOStats.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_IOStats.h"
+
+// Local Includes
+#include "EFF_Types.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <cstdio>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark IO Thread
+
+void    EFF_IOStats::RecordOperationRT(Operation inOperation, UInt64 inStartHostTime)
+{
+    UInt64 theEndHostTime = CAHostTimeBase::GetTheCurrentTime();
+    UInt64 theHostTicks = (theEndHostTime > inStartHostTime) ? (theEndHostTime - inStartHostTime) : 0;
+
+    AtomicOperationStats& theStats = mOperations[inOperation];
+
+    theStats.mCount.fetch_add(1, std::memory_order_relaxed);
+    theStats.mTotalHostTicks.fetch_add(theHostTicks, std::memory_order_relaxed);
+    theStats.mBuckets[BucketForHostTicks(theHostTicks)].fetch_add(1, std::memory_order_relaxed);
+
+    UInt64 theMaxHostTicks = theStats.mMaxHostTicks.load(std::memory_order_relaxed);
+    while(theHostTicks > theMaxHostTicks &&
+          !theStats.mMaxHostTicks.compare_exchange_weak(theMaxHostTicks,
+                                                        theHostTicks,
+                                                        std::memory_order_relaxed)) { }
+
+    // The mutex wait is part of an operation's time, so don't count it twice.
+    if(inOperation != kOperationIOMutexWait)
+    {
+        mCurrentCycleHostTicks += theHostTicks;
+    }
+}
+
+bool    EFF_IOStats::EndCycleRT(UInt64 inDeadlineHostTicks)
+{
+    IncrementCounterRT(kCounterCycles);
+
+    if(inDeadlineHostTicks > 0 && mCurrentCycleHostTicks > inDeadlineHostTicks)
+    {
+        IncrementCounterRT(kCounterDeadlineMisses);
+    }
+
+    mCurrentCycleHostTicks = 0;
+
+    if(++mCyclesSinceExport >= kExportIntervalCycles)
+    {
+        mCyclesSinceExport = 0;
+        return true;
+    }
+
+    return false;
+}
+
+#pragma mark Readers
+
+void    EFF_IOStats::CopyOperationStats(Operation inOperation, OperationStats& outStats)
+const
+{
+    const AtomicOperationStats& theStats = mOperations[inOperation];
+
+    outStats.mCount = theStats.mCount.load(std::memory_order_relaxed);
+    outStats.mTotalHostTicks = theStats.mTotalHostTicks.load(std::memory_order_relaxed);
+    outStats.mMaxHostTicks = theStats.mMaxHostTicks.load(std::memory_order_relaxed);
+
+    for(UInt32 i = 0; i < kNumberBuckets; i++)
+    {
+        outStats.mBuckets[i] = theStats.mBuckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+CFDictionaryRef EFF_IOStats::CopyAsDictionary()
+const
+{
+    // The dictionary we return is released by the caller. The nested collections are released when
+    // they go out of scope, which is fine because their containers retain them.
+    CACFDictionary theIOStats(false);
+
+    CACFArray theBucketBounds(true);
+    for(UInt32 i = 0; i < kNumberBuckets; i++)
+    {
+        theBucketBounds.AppendUInt64(CAHostTimeBase::ConvertToNanos(GetBucketLowerBoundHostTicks(i)));
+    }
+    theIOStats.AddArray(CFSTR(kEFFIOStatsKey_BucketBounds), theBucketBounds.GetCFArray());
+
+    CACFDictionary theOperations(true);
+    OperationStats theStats;
+
+    for(UInt32 theOperation = 0; theOperation < kNumberOperations; theOperation++)
+    {
+        CopyOperationStats(static_cast<Operation>(theOperation), theStats);
+
+        CACFDictionary theOperationDict(true);
+        theOperationDict.AddUInt64(CFSTR(kEFFIOStatsKey_Count), theStats.mCount);
+        theOperationDict.AddUInt64(CFSTR(kEFFIOStatsKey_TotalNanos),
+                                   CAHostTimeBase::ConvertToNanos(theStats.mTotalHostTicks));
+        theOperationDict.AddUInt64(CFSTR(kEFFIOStatsKey_MaxNanos),
+                                   CAHostTimeBase::ConvertToNanos(theStats.mMaxHostTicks));
+
+        CACFArray theHistogram(true);
+        for(UInt32 i = 0; i < kNumberBuckets; i++)
+        {
+            theHistogram.AppendUInt64(theStats.mBuckets[i]);
+        }
+        theOperationDict.AddArray(CFSTR(kEFFIOStatsKey_Histogram), theHistogram.GetCFArray());
+
+        theOperations.AddCFTypeWithCStringKey(GetOperationName(static_cast<Operation>(theOperation)),
+                                              theOperationDict.GetDict());
+    }
+
+    theIOStats.AddDictionary(CFSTR(kEFFIOStatsKey_Operations), theOperations.GetDict());
+
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_Cycles), GetCounter(kCounterCycles));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_DeadlineMisses), GetCounter(kCounterDeadlineMisses));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_RingBufferOverloads), GetCounter(kCounterRingBufferOverloads));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_SilentFrames), GetCounter(kCounterSilentFrames));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_ClientIOTasksQueued), GetCounter(kCounterClientIOTasksQueued));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_ClientIOTasksSkipped), GetCounter(kCounterClientIOTasksSkipped));
+    theIOStats.AddUInt64(CFSTR(kEFFIOStatsKey_RecordingDroppedBlocks), GetCounter(kCounterRecordingDroppedBlocks));
+
+    return theIOStats.GetDict();
+}
+
+void    EFF_IOStats::LogSummary()
+{
+    UInt64 theDeadlineMisses = GetCounter(kCounterDeadlineMisses);
+    UInt64 theOverloads = GetCounter(kCounterRingBufferOverloads);
+    UInt64 theRecordingDrops = GetCounter(kCounterRecordingDroppedBlocks);
+
+    // Only bother the system log if something went wrong since the last summary.
+    bool theSummaryIsWarning =
+            theDeadlineMisses != mLastLoggedDeadlineMisses ||
+            theOverloads != mLastLoggedOverloads ||
+            theRecordingDrops != mLastLoggedRecordingDrops;
+
+    mLastLoggedDeadlineMisses = theDeadlineMisses;
+    mLastLoggedOverloads = theOverloads;
+    mLastLoggedRecordingDrops = theRecordingDrops;
+
+#if !DEBUG
+    if(!theSummaryIsWarning)
+    {
+        return;
+    }
+#endif
+
+    auto theLog = [&] (const char* inMessage) {
+        if(theSummaryIsWarning)
+        {
+            LogWarning("%s", inMessage);
+        }
+        else
+        {
+            DebugMsg("%s", inMessage);
+        }
+    };
+
+    char theMessage[320];
+
+    snprintf(theMessage,
+             sizeof(theMessage),
+             "EFF_IOStats::LogSummary: cycles=%llu deadlineMisses=%llu ringBufferOverloads=%llu silentFrames=%llu "
+             "clientIOTasksQueued=%llu clientIOTasksSkipped=%llu recordingDroppedBlocks=%llu",
+             GetCounter(kCounterCycles),
+             theDeadlineMisses,
+             theOverloads,
+             GetCounter(kCounterSilentFrames),
+             GetCounter(kCounterClientIOTasksQueued),
+             GetCounter(kCounterClientIOTasksSkipped),
+             theRecordingDrops);
+    theLog(theMessage);
+
+    OperationStats theStats;
+
+    for(UInt32 theOperation = 0; theOperation < kNumberOperations; theOperation++)
+    {
+        CopyOperationStats(static_cast<Operation>(theOperation), theStats);
+
+        if(theStats.mCount == 0)
+        {
+            continue;
+        }
+
+        snprintf(theMessage,
+                 sizeof(theMessage),
+                 "EFF_IOStats::LogSummary:   %s: count=%llu meanNs=%llu p50Ns>=%llu p99Ns>=%llu maxNs=%llu",
+                 GetOperationName(static_cast<Operation>(theOperation)),
+                 theStats.mCount,
+                 CAHostTimeBase::ConvertToNanos(theStats.mTotalHostTicks / theStats.mCount),
+                 CAHostTimeBase::ConvertToNanos(GetQuantileHostTicks(theStats, 0.5)),
+                 CAHostTimeBase::ConvertToNanos(GetQuantileHostTicks(theStats, 0.99)),
+                 CAHostTimeBase::ConvertToNanos(theStats.mMaxHostTicks));
+        theLog(theMessage);
+    }
+}
+
+// static
+const char* EFF_IOStats::GetOperationName(Operation inOperation)
+{
+    switch(inOperation)
+    {
+        case kOperationReadInput:       return "ReadInput";
+        case kOperationProcessOutput:   return "ProcessOutput";
+        case kOperationProcessMix:      return "ProcessMix";
+        case kOperationWriteMix:        return "WriteMix";
+        case kOperationIOMutexWait:     return "IOMutexWait";
+        default:                        return "Unknown";
+    }
+}
+
+// static
+UInt32  EFF_IOStats::BucketForHostTicks(UInt64 inHostTicks)
+{
+    if(inHostTicks < kSubBuckets)
+    {
+        return static_cast<UInt32>(inHostTicks);
+    }
+
+    // The position of the highest set bit picks the power of two and the next kSubBucketBits bits
+    // pick the bucket within it.
+    UInt32 theExponent = 63 - static_cast<UInt32>(__builtin_clzll(inHostTicks));
+
+    if(theExponent >= kMaxExponent)
+    {
+        return kNumberBuckets - 1;
+    }
+
+    UInt32 theSubBucket = static_cast<UInt32>(inHostTicks >> (theExponent - kSubBucketBits)) & (kSubBuckets - 1);
+
+    return kSubBuckets * (theExponent - kSubBucketBits + 1) + theSubBucket;
+}
+
+// static
+UInt64  EFF_IOStats::GetBucketLowerBoundHostTicks(UInt32 inBucket)
+{
+    if(inBucket < kSubBuckets)
+    {
+        return inBucket;
+    }
+
+    if(inBucket >= kNumberBuckets - 1)
+    {
+        return 1ULL << kMaxExponent;
+    }
+
+    UInt32 theExponent = inBucket / kSubBuckets + kSubBucketBits - 1;
+    UInt64 theSubBucket = inBucket % kSubBuckets;
+
+    return (kSubBuckets + theSubBucket) << (theExponent - kSubBucketBits);
+}
+
+// static
+UInt64  EFF_IOStats::GetQuantileHostTicks(const OperationStats& inStats, Float64 inFraction)
+{
+    UInt64 theTotal = 0;
+    for(UInt32 i = 0; i < kNumberBuckets; i++)
+    {
+        theTotal += inStats.mBuckets[i];
+    }
+
+    // The number of values at or below the quantile, rounded to the nearest value.
+    UInt64 theTarget = static_cast<UInt64>(inFraction * static_cast<Float64>(theTotal) + 0.5);
+    UInt64 theSeen = 0;
+
+    for(UInt32 i = 0; i < kNumberBuckets; i++)
+    {
+        theSeen += inStats.mBuckets[i];
+
+        if(theSeen > 0 && theSeen >= theTarget)
+        {
+            return GetBucketLowerBoundHostTicks(i);
+        }
+    }
+
+    return 0;
+}
+
+#pragma clang assume_nonnull end
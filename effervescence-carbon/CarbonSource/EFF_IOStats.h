@@ -0,0 +1,184 @@
+//
+//  EFF_IOStats.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Timing and error counters for EFF_Device's IO operations, so we can tell which operation (or
+//  waiting for mIOMutex) was slow when the HAL logs an IO overload.
+//
+//  Each operation gets a log-linear histogram of how long it took, in host ticks: four buckets per
+//  power of two, so each bucket is within 25% of its neighbours. The IO thread records into
+//  relaxed atomics. The HAL runs a device's IO operations on its IO thread, so in practice there's
+//  only ever one writer and the counters are never contended. Reading them from other threads
+//  never blocks the IO thread, but the values read aren't a single consistent snapshot.
+//
+//  The RT methods are real-time safe. The others are only for non-real-time threads.
+//
+
+#ifndef EFF_IOStats_h
+#define EFF_IOStats_h
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_IOStats
+{
+
+public:
+    enum Operation : UInt32
+    {
+        kOperationReadInput,
+        kOperationProcessOutput,
+        kOperationProcessMix,
+        kOperationWriteMix,
+        // Time spent waiting to lock mIOMutex, which is also included in the operation's time.
+        kOperationIOMutexWait,
+        kNumberOperations
+    };
+
+    enum Counter : UInt32
+    {
+        // IO cycles completed, i.e. WriteMix operations.
+        kCounterCycles,
+        // Cycles where our operations took longer in total than the IO buffer's duration.
+        kCounterDeadlineMisses,
+        // Calls to EFF_LoopbackRingBuffer::Store that failed.
+        kCounterRingBufferOverloads,
+        // Input frames we had to replace with silence because they weren't in the ring buffer.
+        kCounterSilentFrames,
+        // Client IO state changes from BeginIOOperation/EndIOOperation that were queued as tasks.
+        kCounterClientIOTasksQueued,
+        // Client IO state changes from BeginIOOperation/EndIOOperation that EFF_TaskQueue didn't
+        // queue, because the client was already in that state with no other changes outstanding or
+        // (very rarely) because its queue was full.
+        kCounterClientIOTasksSkipped,
+        // Blocks of audio EFF_MixRecorder dropped because its writer thread had fallen behind.
+        kCounterRecordingDroppedBlocks,
+        kNumberCounters
+    };
+
+    // Histogram layout. Values below kSubBuckets ticks get a bucket each. Values of
+    // 2^kMaxExponent ticks and above all go in the last bucket.
+    static const UInt32         kSubBucketBits = 2;
+    static const UInt32         kSubBuckets = 1 << kSubBucketBits;
+    static const UInt32         kMaxExponent = 36;
+    static const UInt32         kNumberBuckets = kSubBuckets * (kMaxExponent - kSubBucketBits + 1) + 1;
+
+    struct OperationStats
+    {
+        UInt64                  mCount              = 0;
+        UInt64                  mTotalHostTicks     = 0;
+        UInt64                  mMaxHostTicks       = 0;
+        UInt64                  mBuckets[kNumberBuckets] = {};
+    };
+
+    // Records how long an operation took, including if it throws, when it goes out of scope.
+    class OperationTimer
+    {
+    public:
+                                OperationTimer(EFF_IOStats& inStats, Operation inOperation)
+                                :
+                                    mStats(inStats),
+                                    mOperation(inOperation),
+                                    mStartHostTime(CAHostTimeBase::GetTheCurrentTime()) { }
+                                ~OperationTimer()
+                                    { mStats.RecordOperationRT(mOperation, mStartHostTime); }
+                                OperationTimer(const OperationTimer&) = delete;
+                                OperationTimer& operator=(const OperationTimer&) = delete;
+
+    private:
+        EFF_IOStats&            mStats;
+        Operation               mOperation;
+        UInt64                  mStartHostTime;
+    };
+
+#pragma mark Construction/Destruction
+
+                                EFF_IOStats() = default;
+                                // Disallow copying
+                                EFF_IOStats(const EFF_IOStats&) = delete;
+                                EFF_IOStats& operator=(const EFF_IOStats&) = delete;
+
+#pragma mark IO Thread
+
+    /*! Record an operation that started at inStartHostTime and has just finished. */
+    void                        RecordOperationRT(Operation inOperation, UInt64 inStartHostTime);
+
+    void                        IncrementCounterRT(Counter inCounter, UInt64 inAmount = 1)
+                                    { mCounters[inCounter].fetch_add(inAmount, std::memory_order_relaxed); }
+
+    /*!
+     End the current IO cycle. Counts a deadline miss if the operations recorded since the last
+     call, not including kOperationIOMutexWait, took longer than inDeadlineHostTicks in total.
+
+     @return True if at least kExportIntervalCycles cycles have ended since the last time this
+             returned true, to tell the caller it's time to export the stats.
+     */
+    bool                        EndCycleRT(UInt64 inDeadlineHostTicks);
+
+    // Roughly every 10 seconds with a 512 frame buffer at 44.1 kHz.
+    static const UInt64         kExportIntervalCycles = 1024;
+
+#pragma mark Readers
+
+    void                        CopyOperationStats(Operation inOperation, OperationStats& outStats) const;
+    UInt64                      GetCounter(Counter inCounter) const
+                                    { return mCounters[inCounter].load(std::memory_order_relaxed); }
+
+    /*!
+     @return The current stats in the format of kAudioDeviceCustomPropertyIOStats. The caller is
+             responsible for releasing it.
+     */
+    CFDictionaryRef             CopyAsDictionary() const;
+
+    /*!
+     Write a summary of the stats to the log. Logged as a warning if there were any deadline misses
+     or ring buffer overloads since the last call, otherwise only in debug builds. Not thread safe.
+     */
+    void                        LogSummary();
+
+    static const char*          GetOperationName(Operation inOperation);
+    static UInt32               BucketForHostTicks(UInt64 inHostTicks);
+    static UInt64               GetBucketLowerBoundHostTicks(UInt32 inBucket);
+    /*! The lower bound of the bucket containing the inFraction quantile (0 to 1) of inStats. */
+    static UInt64               GetQuantileHostTicks(const OperationStats& inStats, Float64 inFraction);
+
+#pragma mark Implementation
+
+private:
+    struct AtomicOperationStats
+    {
+        std::atomic<UInt64>     mCount              { 0 };
+        std::atomic<UInt64>     mTotalHostTicks     { 0 };
+        std::atomic<UInt64>     mMaxHostTicks       { 0 };
+        std::atomic<UInt64>     mBuckets[kNumberBuckets] = {};
+    };
+
+    AtomicOperationStats        mOperations[kNumberOperations];
+    std::atomic<UInt64>         mCounters[kNumberCounters] = {};
+
+    // Only used by the IO thread.
+    UInt64                      mCurrentCycleHostTicks      = 0;
+    UInt64                      mCyclesSinceExport          = 0;
+
+    // Only used by LogSummary.
+    UInt64                      mLastLoggedDeadlineMisses   = 0;
+    UInt64                      mLastLoggedOverloads        = 0;
+    UInt64                      mLastLoggedRecordingDrops   = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_IOStats_h */
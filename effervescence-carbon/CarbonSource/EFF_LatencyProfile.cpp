@@ -0,0 +1,57 @@
+//
+//  EFF_LatencyProfile.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_LatencyProfile.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// Indexed by EFFLatencyProfile. The safety offsets trade latency for robustness along with the rest
+// of the profile: playback can afford about 5 ms of margin, live monitoring only a fraction of one.
+static const EFF_LatencyProfileParams kLatencyProfiles[] = {
+    // mZeroTimeStampPeriod, mSafetyOffsetFrames, mOutputLatencyFrames
+    { 16384, 256, 512 },    // kEFFLatencyProfileStandard
+    { 1024,  64,  256 },    // kEFFLatencyProfileLow
+    { 256,   16,  128 }     // kEFFLatencyProfileLive
+};
+
+static_assert(sizeof(kLatencyProfiles) / sizeof(kLatencyProfiles[0]) == kEFFLatencyProfileLive + 1,
+              "kLatencyProfiles needs an entry for each EFFLatencyProfile");
+
+bool    EFF_LatencyProfile::IsValid(SInt32 inProfile)
+{
+    return (inProfile >= kEFFLatencyProfileStandard) && (inProfile <= kEFFLatencyProfileLive);
+}
+
+const EFF_LatencyProfileParams& EFF_LatencyProfile::GetParams(EFFLatencyProfile inProfile)
+{
+    ThrowIf(!IsValid(inProfile),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_LatencyProfile::GetParams: unknown latency profile");
+
+    return kLatencyProfiles[inProfile];
+}
+
+UInt32  EFF_LatencyProfile::GetMaxIOBufferFrameSize(EFFLatencyProfile inProfile,
+                                                    UInt32 inRingBufferFrames)
+{
+    // EFFApp reads from (now - IO buffer - safety offset) while clients have written up to (now +
+    // IO buffer + safety offset), so the buffer has to hold twice both.
+    const UInt32 theSafetyOffset = GetParams(inProfile).mSafetyOffsetFrames;
+    return (inRingBufferFrames / 2 > theSafetyOffset) ? (inRingBufferFrames / 2 - theSafetyOffset) : 0;
+}
+
+#pragma clang assume_nonnull end
@@ -0,0 +1,74 @@
+//
+//  EFF_LatencyProfile.h
+//  effervescence-core
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  The settings EFF_Device uses for each EFFLatencyProfile (see EFF_Types.h).
+//
+//  The profiles don't change the size of the loopback buffer. The HAL decides which IO buffer sizes
+//  clients can choose (kAudioDevicePropertyBufferFrameSizeRange) and the device can't narrow that
+//  range, so every profile's buffer has to hold the largest IO buffer the HAL allows. Its size
+//  doesn't affect latency anyway, since frames are written and read by sample time.
+//
+
+#ifndef EFF_LatencyProfile_h
+#define EFF_LatencyProfile_h
+
+// Local Includes
+#include "EFF_Types.h"
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+struct EFF_LatencyProfileParams
+{
+    // The number of frames between the loopback clock's zero timestamps
+    // (kAudioDevicePropertyZeroTimeStampPeriod).
+    UInt32                      mZeroTimeStampPeriod;
+    // kAudioDevicePropertySafetyOffset, for both scopes: how close to the current time the HAL
+    // reads and writes the device. A bigger one leaves the HAL more margin for late IO cycles, but
+    // adds twice as many frames to the latency through the loopback, since EFFApp reads that much
+    // further behind the time clients write at.
+    UInt32                      mSafetyOffsetFrames;
+    // kAudioDevicePropertyLatency for the output scope. Audio played to EFFDevice isn't heard until
+    // EFFApp's playthrough has passed it on to the output device, which buffers about one of the
+    // profile's typical IO buffers. The input scope's latency is 0.
+    UInt32                      mOutputLatencyFrames;
+};
+
+class EFF_LatencyProfile
+{
+
+public:
+    /*! The largest IO buffer size the HAL lets clients choose at the usual sample rates. */
+    static const UInt32         kMaxIOBufferFrameSize = 4096;
+
+    /*!
+     The size of the loopback buffers in every profile. Holds two of the largest IO buffers plus
+     the largest safety offsets, since clients write one buffer (and the safety offset) ahead of
+     the current time while EFFApp reads one buffer (and the safety offset) behind it.
+     */
+    static const UInt32         kLoopbackRingBufferFrames = 16384;
+
+    static bool                 IsValid(SInt32 inProfile);
+
+    /*! @throws CAException if inProfile isn't one of the EFFLatencyProfile values. */
+    static const EFF_LatencyProfileParams& GetParams(EFFLatencyProfile inProfile);
+
+    /*!
+     The largest IO buffer a loopback buffer of inRingBufferFrames frames can take without the
+     output written in one cycle overwriting frames EFFApp hasn't read yet.
+     */
+    static UInt32               GetMaxIOBufferFrameSize(EFFLatencyProfile inProfile,
+                                                        UInt32 inRingBufferFrames);
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_LatencyProfile_h */
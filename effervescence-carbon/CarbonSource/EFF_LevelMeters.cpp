@@ -0,0 +1,122 @@
+//
+//  EFF_LevelMeters.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_LevelMeters.h"
+
+// STL Includes
+#include <algorithm>
+
+// System Includes
+#include <Accelerate/Accelerate.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The number of times CopySnapshot will try to get a consistent copy before giving up.
+static const UInt32 kMaxSnapshotAttempts = 16;
+
+#pragma mark IO Thread
+
+void    EFF_LevelMeters::MeterClientRT(UInt32 inClientID,
+                                       UInt32 inChannelsPerFrame,
+                                       UInt32 inIOBufferFrameSize,
+                                       const Float32* inBuffer)
+{
+    Snapshot& theBackBlock = GetBackBlock();
+
+    if(theBackBlock.mNumberClients < kMaxClients)
+    {
+        ClientLevels& theClientLevels = theBackBlock.mClients[theBackBlock.mNumberClients];
+        theClientLevels.mClientID = inClientID;
+        theClientLevels.mLevels = Measure(inChannelsPerFrame, inIOBufferFrameSize, inBuffer);
+        theBackBlock.mNumberClients++;
+    }
+}
+
+void    EFF_LevelMeters::MeterMixRT(UInt32 inChannelsPerFrame,
+                                    UInt32 inIOBufferFrameSize,
+                                    const Float32* inBuffer)
+{
+    GetBackBlock().mMix = Measure(inChannelsPerFrame, inIOBufferFrameSize, inBuffer);
+
+    // Publish the back block. Readers that see the new publish count will also see everything we
+    // wrote to the block.
+    UInt64 thePublishCount = mPublishCount.load(std::memory_order_relaxed) + 1;
+    mPublishCount.store(thePublishCount, std::memory_order_release);
+
+    // The block we published last time is now the back block, so start the next cycle's clients
+    // from scratch. A reader might still be copying this block, but it will notice when it checks
+    // mPublishCount again.
+    //
+    // The release store above doesn't stop our writes to the block from becoming visible before
+    // the new publish count does, which would let a reader copy some of them and still see the
+    // old count when it checks. This fence and the acquire fence in CopySnapshot make sure that if
+    // a reader sees any of them, it also sees the new count.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    GetBackBlock().mNumberClients = 0;
+}
+
+// static
+EFF_Levels  EFF_LevelMeters::Measure(UInt32 inChannelsPerFrame,
+                                     UInt32 inIOBufferFrameSize,
+                                     const Float32* inBuffer)
+{
+    EFF_Levels theLevels;
+
+    if(inIOBufferFrameSize > 0 && inChannelsPerFrame > 0)
+    {
+        // The buffer is interleaved, so use a stride of one frame to measure each channel
+        // separately. Only the front left and right channels are metered, which are the first two
+        // in all of our channel layouts.
+        for(UInt32 theChannel = 0; theChannel < 2; theChannel++)
+        {
+            const Float32* theSamples = inBuffer + std::min(theChannel, inChannelsPerFrame - 1);
+
+            vDSP_maxmgv(theSamples, inChannelsPerFrame, &theLevels.mPeak[theChannel], inIOBufferFrameSize);
+            vDSP_rmsqv(theSamples, inChannelsPerFrame, &theLevels.mRMS[theChannel], inIOBufferFrameSize);
+        }
+    }
+
+    return theLevels;
+}
+
+#pragma mark Readers
+
+bool    EFF_LevelMeters::CopySnapshot(Snapshot& outSnapshot)
+const
+{
+    for(UInt32 i = 0; i < kMaxSnapshotAttempts; i++)
+    {
+        UInt64 thePublishCount = mPublishCount.load(std::memory_order_acquire);
+        const Snapshot& theFrontBlock = mBlocks[thePublishCount & 1];
+
+        outSnapshot.mMix = theFrontBlock.mMix;
+        outSnapshot.mNumberClients = std::min(theFrontBlock.mNumberClients, static_cast<UInt32>(kMaxClients));
+
+        for(UInt32 j = 0; j < outSnapshot.mNumberClients; j++)
+        {
+            outSnapshot.mClients[j] = theFrontBlock.mClients[j];
+        }
+
+        // If the IO thread hasn't published again since we started, it can't have written to the
+        // block we copied. The fence pairs with the one in MeterMixRT and stops the check from
+        // happening before the copy.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if(mPublishCount.load(std::memory_order_relaxed) == thePublishCount)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#pragma clang assume_nonnull end
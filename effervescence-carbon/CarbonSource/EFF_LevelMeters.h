@@ -0,0 +1,121 @@
+//
+//  EFF_LevelMeters.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Measures the peak and RMS levels of each client's audio and of the mix during IO, and makes the
+//  latest levels available to non-real-time threads for kAudioDeviceCustomPropertyLevelMeters.
+//
+//  The levels are kept in two blocks. The IO thread fills in one block over the course of an IO
+//  cycle and then publishes it by incrementing mPublishCount, which makes the other block the one
+//  it fills in next. Readers copy the most recently published block and then check mPublishCount
+//  again to make sure the IO thread didn't start overwriting it during the copy. The IO thread
+//  never waits for readers; readers just retry.
+//
+//  The MeterRT methods must only be called from the IO thread. CopySnapshot can be called from any
+//  number of non-real-time threads.
+//
+
+#ifndef EFF_LevelMeters_h
+#define EFF_LevelMeters_h
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <atomic>
+
+
+#pragma clang assume_nonnull begin
+
+// Linear amplitude levels for the front left and right channels of one buffer of audio. Index 0 is
+// the left channel. Mono audio has the same levels in both.
+struct EFF_Levels
+{
+    Float32                     mPeak[2]            = { 0.0f, 0.0f };
+    Float32                     mRMS[2]             = { 0.0f, 0.0f };
+};
+
+class EFF_LevelMeters
+{
+
+public:
+    // The maximum number of clients metered in each IO cycle. Any more than this are left out.
+    static const UInt32         kMaxClients = 128;
+
+    struct ClientLevels
+    {
+        UInt32                  mClientID;
+        EFF_Levels              mLevels;
+    };
+
+    struct Snapshot
+    {
+        EFF_Levels              mMix;
+        UInt32                  mNumberClients      = 0;
+        ClientLevels            mClients[kMaxClients];
+    };
+
+#pragma mark Construction/Destruction
+
+                                EFF_LevelMeters() = default;
+                                // Disallow copying
+                                EFF_LevelMeters(const EFF_LevelMeters&) = delete;
+                                EFF_LevelMeters& operator=(const EFF_LevelMeters&) = delete;
+
+#pragma mark IO Thread
+
+    /*!
+     Measure a client's interleaved buffer and add the levels to the current cycle.
+
+     Real-time safe. IO thread only.
+     */
+    void                        MeterClientRT(UInt32 inClientID,
+                                              UInt32 inChannelsPerFrame,
+                                              UInt32 inIOBufferFrameSize,
+                                              const Float32* inBuffer);
+
+    /*!
+     Measure the mix's interleaved buffer and publish the levels for the cycle, including the
+     clients metered since the last call.
+
+     Real-time safe. IO thread only.
+     */
+    void                        MeterMixRT(UInt32 inChannelsPerFrame,
+                                           UInt32 inIOBufferFrameSize,
+                                           const Float32* inBuffer);
+
+#pragma mark Readers
+
+    /*!
+     Copy the most recently published levels into outSnapshot. Never blocks the IO thread.
+
+     Not real-time safe.
+
+     @return False if the IO thread kept overwriting the levels while we were copying them, which
+             should only happen if this thread is being starved.
+     */
+    bool                        CopySnapshot(Snapshot& outSnapshot) const;
+
+#pragma mark Implementation
+
+private:
+    static EFF_Levels           Measure(UInt32 inChannelsPerFrame,
+                                        UInt32 inIOBufferFrameSize,
+                                        const Float32* inBuffer);
+
+    Snapshot&                   GetBackBlock()
+                                    { return mBlocks[(mPublishCount.load(std::memory_order_relaxed) + 1) & 1]; }
+
+    // The block at index (mPublishCount & 1) is the most recently published one. The IO thread
+    // writes to the other one.
+    Snapshot                    mBlocks[2];
+    std::atomic<UInt64>         mPublishCount       { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_LevelMeters_h */
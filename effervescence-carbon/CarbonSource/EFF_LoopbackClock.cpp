@@ -0,0 +1,194 @@
+//
+//  EFF_LoopbackClock.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_LoopbackClock.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Loop Parameters
+
+// The loop's bandwidth starts at kWideLoopBandwidth, so it corrects the initial rate error quickly,
+// and narrows towards kNarrowLoopBandwidth with this time constant, so the timestamps' jitter barely
+// affects the estimate once it's locked.
+static const Float64 kWideLoopBandwidth = 1.0;
+static const Float64 kNarrowLoopBandwidth = 0.02;
+static const Float64 kLoopNarrowingSeconds = 3.0;
+
+// If the timestamps are updated too rarely for the bandwidth, the loop would overcorrect and become
+// unstable, so the gains are limited to what they'd be for this normalised bandwidth.
+static const Float64 kMaxLoopOmega = 0.5;
+
+// A reference timestamp this far from where the loop predicted it would be is treated as a
+// discontinuity rather than jitter.
+static const Float64 kMaxPhaseErrorSeconds = 0.002;
+
+// Real devices are nowhere near this far from their nominal rates, so if the estimate gets here
+// something is wrong with the timestamps.
+static const Float64 kMaxRateError = 0.005;
+
+
+#pragma mark Device Clock
+
+void    EFF_LoopbackClock::Initialize(Float64 inHostTicksPerSecond,
+                                      Float64 inSampleRate,
+                                      UInt32 inPeriodFrames)
+{
+    ThrowIf(!(inHostTicksPerSecond > 0.0) || !(inSampleRate > 0.0) || inPeriodFrames == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_LoopbackClock::Initialize: Invalid parameters");
+
+    mHostTicksPerSecond = inHostTicksPerSecond;
+    mNominalHostTicksPerFrame = inHostTicksPerSecond / inSampleRate;
+    mPeriodFrames = inPeriodFrames;
+    mHostTicksPerFrame = mNominalHostTicksPerFrame / mRateScalar;
+}
+
+void    EFF_LoopbackClock::Start(UInt64 inAnchorHostTime)
+{
+    mAnchorHostTime = static_cast<Float64>(inAnchorHostTime);
+    mAnchorTimeStampIndex = 0;
+    mTimeStampIndex = 0;
+}
+
+void    EFF_LoopbackClock::GetZeroTimeStamp(UInt64 inCurrentHostTime,
+                                            Float64& outSampleTime,
+                                            UInt64& outHostTime,
+                                            UInt64& outSeed)
+{
+    // Advance to the next zero timestamp if its host time has passed.
+    const UInt64 theNextHostTime = static_cast<UInt64>(GetHostTimeOfTimeStamp(mTimeStampIndex + 1));
+
+    if(theNextHostTime <= inCurrentHostTime)
+    {
+        mTimeStampIndex++;
+    }
+
+    outSampleTime = static_cast<Float64>(mTimeStampIndex) * mPeriodFrames;
+    outHostTime = static_cast<UInt64>(GetHostTimeOfTimeStamp(mTimeStampIndex));
+    outSeed = mSeed;
+}
+
+void    EFF_LoopbackClock::SetRateScalar(Float64 inRateScalar)
+{
+    mAnchorHostTime = GetHostTimeOfTimeStamp(mTimeStampIndex);
+    mAnchorTimeStampIndex = mTimeStampIndex;
+
+    mRateScalar = inRateScalar;
+    mHostTicksPerFrame = mNominalHostTicksPerFrame / inRateScalar;
+}
+
+Float64 EFF_LoopbackClock::GetHostTimeOfTimeStamp(UInt64 inTimeStampIndex)
+const
+{
+    const Float64 theTimeStamps = static_cast<Float64>(inTimeStampIndex - mAnchorTimeStampIndex);
+    return mAnchorHostTime + theTimeStamps * mPeriodFrames * mHostTicksPerFrame;
+}
+
+
+#pragma mark Reference Clock
+
+bool    EFF_LoopbackClock::AddReferenceTimeStamp(Float64 inSampleTime,
+                                                 UInt64 inHostTime,
+                                                 Float64 inNominalSampleRate)
+{
+    ThrowIf(!(inNominalSampleRate > 0.0),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_LoopbackClock::AddReferenceTimeStamp: Invalid sample rate");
+
+    if(!mReferenceLocked)
+    {
+        LockToReference(inSampleTime, inHostTime, inNominalSampleRate);
+        return false;
+    }
+
+    const Float64 theFrames = inSampleTime - mReferenceSampleTime;
+    bool isContinuous = (inNominalSampleRate == mReferenceNominalSampleRate) && (theFrames > 0.0);
+
+    if(isContinuous)
+    {
+        // The difference between the timestamp's host time and the one predicted from the
+        // previous timestamp at the estimated rate.
+        const Float64 thePredictedHostTime =
+            mReferenceHostTime + theFrames * mReferenceHostTicksPerFrame;
+        const Float64 theError = static_cast<Float64>(inHostTime) - thePredictedHostTime;
+
+        isContinuous = std::fabs(theError) <= kMaxPhaseErrorSeconds * mHostTicksPerSecond;
+
+        if(isContinuous)
+        {
+            // A standard second-order loop with critical damping, adjusted for the time between
+            // timestamps not being fixed.
+            const Float64 theElapsedSeconds =
+                theFrames * mReferenceHostTicksPerFrame / mHostTicksPerSecond;
+            const Float64 theOmega =
+                std::min(2.0 * M_PI * GetLoopBandwidth() * theElapsedSeconds, kMaxLoopOmega);
+
+            mReferenceSampleTime = inSampleTime;
+            mReferenceHostTime = thePredictedHostTime + M_SQRT2 * theOmega * theError;
+            mReferenceHostTicksPerFrame += theOmega * theOmega * theError / theFrames;
+            mReferenceLockedSeconds += theElapsedSeconds;
+
+            const Float64 theRateScalar =
+                (mHostTicksPerSecond / inNominalSampleRate) / mReferenceHostTicksPerFrame;
+
+            if(std::fabs(theRateScalar - 1.0) <= kMaxRateError)
+            {
+                SetRateScalar(theRateScalar);
+                return false;
+            }
+
+            // Start again from the nominal rate rather than the estimate.
+            DebugMsg("EFF_LoopbackClock::AddReferenceTimeStamp: Rate estimate out of range: %f",
+                     theRateScalar);
+            SetRateScalar(1.0);
+        }
+    }
+
+    DebugMsg("EFF_LoopbackClock::AddReferenceTimeStamp: Reference clock discontinuity");
+
+    LockToReference(inSampleTime, inHostTime, inNominalSampleRate);
+    mSeed++;
+
+    return true;
+}
+
+void    EFF_LoopbackClock::LockToReference(Float64 inSampleTime,
+                                           UInt64 inHostTime,
+                                           Float64 inNominalSampleRate)
+{
+    // Start from the current estimate. If the reference is the same device as before, it will
+    // probably still be right, and otherwise the wide bandwidth corrects it quickly.
+    mReferenceLocked = true;
+    mReferenceNominalSampleRate = inNominalSampleRate;
+    mReferenceSampleTime = inSampleTime;
+    mReferenceHostTime = static_cast<Float64>(inHostTime);
+    mReferenceHostTicksPerFrame = (mHostTicksPerSecond / inNominalSampleRate) / mRateScalar;
+    mReferenceLockedSeconds = 0.0;
+}
+
+Float64 EFF_LoopbackClock::GetLoopBandwidth()
+const
+{
+    return kNarrowLoopBandwidth +
+        (kWideLoopBandwidth - kNarrowLoopBandwidth) * std::exp(-mReferenceLockedSeconds / kLoopNarrowingSeconds);
+}
+
+#pragma clang assume_nonnull end
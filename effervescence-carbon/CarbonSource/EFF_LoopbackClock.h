@@ -0,0 +1,148 @@
+//
+//  EFF_LoopbackClock.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  The sample clock EFFDevice reports to the HAL through GetZeroTimeStamp when it doesn't have a
+//  wrapped device to take its timing from.
+//
+//  Left alone, the clock runs at exactly the nominal sample rate as measured by the host clock. Real
+//  devices never quite do, so EFFDevice would slowly drift against the output device EFFApp plays
+//  its audio through, and EFFApp would eventually have to drop or repeat frames. To avoid that, the
+//  clock can be slaved to a reference clock, normally the output device's, by passing it that
+//  device's timestamps as they come in. A second-order delay-locked loop filters out the jitter in
+//  the timestamps and estimates the reference's actual rate, and the clock runs at the same rate
+//  relative to its own nominal rate. Its phase isn't locked to the reference, only its rate, since
+//  the two devices' sample times aren't related.
+//
+//  The loop starts with a wide bandwidth so it locks quickly and narrows it over the first few
+//  seconds so the estimate settles. If the reference's timestamps jump, e.g. because the output
+//  device was restarted or changed, the loop starts locking again and the seed is incremented.
+//
+//  Not thread safe. EFF_Device only uses it while holding its IO mutex.
+//
+
+#ifndef EFF_LoopbackClock_h
+#define EFF_LoopbackClock_h
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_LoopbackClock
+{
+
+public:
+                                EFF_LoopbackClock() = default;
+                                // Disallow copying
+                                EFF_LoopbackClock(const EFF_LoopbackClock&) = delete;
+                                EFF_LoopbackClock& operator=(const EFF_LoopbackClock&) = delete;
+
+#pragma mark Device Clock
+
+    /*!
+     Set the clock's nominal rate. Keeps the rate estimate, since the reference's error relative to
+     its nominal rate doesn't depend on the device's. Must be followed by Start.
+
+     @param inHostTicksPerSecond The host clock's frequency.
+     @param inPeriodFrames The number of frames between the zero timestamps, i.e. the size of the
+                           device's ring buffer.
+     @throws CAException If any of the parameters are 0.
+     */
+    void                        Initialize(Float64 inHostTicksPerSecond,
+                                           Float64 inSampleRate,
+                                           UInt32 inPeriodFrames);
+
+    /*! Start counting from sample time 0 at inAnchorHostTime. Called when IO starts. */
+    void                        Start(UInt64 inAnchorHostTime);
+
+    /*!
+     The most recent zero timestamp at inCurrentHostTime. Moves on to the next one if its host time
+     has passed, so this has to be called at least once per period.
+     */
+    void                        GetZeroTimeStamp(UInt64 inCurrentHostTime,
+                                                 Float64& outSampleTime,
+                                                 UInt64& outHostTime,
+                                                 UInt64& outSeed);
+
+#pragma mark Reference Clock
+
+    /*!
+     Update the rate estimate with a timestamp from the reference clock.
+
+     @param inSampleTime The reference device's sample time.
+     @param inHostTime The host time at inSampleTime.
+     @param inNominalSampleRate The reference device's nominal sample rate.
+     @return True if the timestamp wasn't continuous with the previous ones, so the loop started
+             locking again and the seed was incremented.
+     @throws CAException If inNominalSampleRate isn't positive.
+     */
+    bool                        AddReferenceTimeStamp(Float64 inSampleTime,
+                                                      UInt64 inHostTime,
+                                                      Float64 inNominalSampleRate);
+
+    /*! True once a reference timestamp has been added. */
+    bool                        IsLocked() const { return mReferenceLocked; }
+
+    /*!
+     The reference's estimated actual rate divided by its nominal rate, which is also the clock's
+     rate divided by its nominal rate. 1.0 until a reference is added.
+     */
+    Float64                     GetRateScalar() const { return mRateScalar; }
+
+    /*! The number of host clock ticks per frame the clock is currently running at. */
+    Float64                     GetHostTicksPerFrame() const { return mHostTicksPerFrame; }
+
+    UInt64                      GetSeed() const { return mSeed; }
+
+#pragma mark Implementation
+
+private:
+    // Change the clock's rate without moving the current zero timestamp, so the timeline stays
+    // continuous.
+    void                        SetRateScalar(Float64 inRateScalar);
+
+    // The host time of the zero timestamp with the given index.
+    Float64                     GetHostTimeOfTimeStamp(UInt64 inTimeStampIndex) const;
+
+    // (Re)start locking to the reference from the given timestamp.
+    void                        LockToReference(Float64 inSampleTime,
+                                                UInt64 inHostTime,
+                                                Float64 inNominalSampleRate);
+
+    // The loop's bandwidth in Hz, which narrows as it locks.
+    Float64                     GetLoopBandwidth() const;
+
+    Float64                     mHostTicksPerSecond         = 0.0;
+    Float64                     mNominalHostTicksPerFrame   = 0.0;
+    UInt32                      mPeriodFrames               = 0;
+
+    // The device clock. Zero timestamp n is at host time
+    //     mAnchorHostTime + (n - mAnchorTimeStampIndex) * mPeriodFrames * mHostTicksPerFrame
+    // The anchor is moved to the current zero timestamp each time the rate changes.
+    Float64                     mHostTicksPerFrame          = 0.0;
+    Float64                     mAnchorHostTime             = 0.0;
+    UInt64                      mAnchorTimeStampIndex       = 0;
+    UInt64                      mTimeStampIndex             = 0;
+    Float64                     mRateScalar                 = 1.0;
+    UInt64                      mSeed                       = 1;
+
+    // The loop's model of the reference clock. mReferenceHostTime is the filtered host time of
+    // reference sample time mReferenceSampleTime.
+    bool                        mReferenceLocked            = false;
+    Float64                     mReferenceNominalSampleRate = 0.0;
+    Float64                     mReferenceSampleTime        = 0.0;
+    Float64                     mReferenceHostTime          = 0.0;
+    Float64                     mReferenceHostTicksPerFrame = 0.0;
+    // How long the loop has been locking to the current reference, in seconds.
+    Float64                     mReferenceLockedSeconds     = 0.0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_LoopbackClock_h */
@@ -0,0 +1,275 @@
+//
+//  EFF_LoopbackRingBuffer.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_LoopbackRingBuffer.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CABitOperations.h"
+
+// STL Includes
+#include <algorithm>
+
+// System Includes
+#include <string.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+void    EFF_LoopbackRingBuffer::Allocate(UInt32 inChannelsPerFrame, UInt32 inCapacityFrames)
+{
+    EFFAssert(inChannelsPerFrame > 0, "EFF_LoopbackRingBuffer::Allocate: No channels");
+
+    mChannelsPerFrame = inChannelsPerFrame;
+    mCapacityFrames = NextPowerOfTwo(inCapacityFrames);
+    mCapacityFramesMask = mCapacityFrames - 1;
+
+    // Allocate everything up front so Store and Fetch never have to.
+    mBuffer.assign(static_cast<size_t>(mCapacityFrames) * mChannelsPerFrame, 0.0f);
+
+    mResetCount.store(0, std::memory_order_relaxed);
+    mStartTime.store(0, std::memory_order_relaxed);
+    mEndTime.store(0, std::memory_order_release);
+}
+
+void    EFF_LoopbackRingBuffer::Deallocate()
+{
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+
+    mChannelsPerFrame = 0;
+    mCapacityFrames = 0;
+    mCapacityFramesMask = 0;
+
+    mStartTime.store(0, std::memory_order_relaxed);
+    mEndTime.store(0, std::memory_order_release);
+}
+
+#pragma mark IO
+
+EFF_RingBufferError EFF_LoopbackRingBuffer::Store(const Float32* inBuffer,
+                                                  UInt32 inNumberFrames,
+                                                  SampleTime inStartWrite)
+{
+    if(inNumberFrames == 0)
+    {
+        return kEFFRingBufferError_OK;
+    }
+
+    if(inNumberFrames > mCapacityFrames)
+    {
+        return kEFFRingBufferError_TooMuch;
+    }
+
+    // We're the only thread that writes these, so we don't need to synchronise with anything to
+    // read them.
+    SampleTime theStartTime = mStartTime.load(std::memory_order_relaxed);
+    SampleTime theEndTime = mEndTime.load(std::memory_order_relaxed);
+    SampleTime theEndWrite = inStartWrite + inNumberFrames;
+
+    if(inStartWrite < theEndTime)
+    {
+        // Going backwards, so throw everything out. Bump the reset count first so a reader that
+        // sees either of the new bounds will also see that it has to discard what it copied.
+        mResetCount.store(mResetCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        theStartTime = inStartWrite;
+        theEndTime = inStartWrite;
+        mEndTime.store(theEndTime, std::memory_order_release);
+        mStartTime.store(theStartTime, std::memory_order_release);
+    }
+
+    if(theEndWrite - theStartTime > mCapacityFrames)
+    {
+        // Advance the start time past the region we're about to overwrite.
+        theStartTime = theEndWrite - mCapacityFrames;
+
+        // If that overwrites everything in the buffer, there's no point filling the gap before
+        // inStartWrite with silence, which could mean zeroing almost the whole buffer. Fetch
+        // returns silence for frames before the start time anyway.
+        if(theStartTime >= theEndTime)
+        {
+            theStartTime = inStartWrite;
+        }
+
+        mStartTime.store(theStartTime, std::memory_order_release);
+    }
+
+    // Publish the new start time (and reset count) before we touch any of the frames they
+    // invalidate. Fetch has the matching acquire fence between copying frames and re-checking the
+    // start time, which is how it finds out which of the frames it copied might be torn.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // If we're skipping some frames, fill them with silence. (Only the ones still in the buffer.)
+    SampleTime theSilenceStart = std::max(theEndTime, theStartTime);
+    if(inStartWrite > theSilenceStart)
+    {
+        CopyIntoRing(theSilenceStart, static_cast<UInt32>(inStartWrite - theSilenceStart), nullptr);
+    }
+
+    CopyIntoRing(inStartWrite, inNumberFrames, inBuffer);
+
+    // Release the new frames to the reader.
+    mEndTime.store(theEndWrite, std::memory_order_release);
+
+    return kEFFRingBufferError_OK;
+}
+
+EFF_RingBufferError EFF_LoopbackRingBuffer::Fetch(Float32* outBuffer,
+                                                  UInt32 inNumberFrames,
+                                                  SampleTime inStartRead,
+                                                  UInt32* __nullable outSilentFrames)
+const
+{
+    UInt32 theSilentFrames = 0;
+
+    if(outSilentFrames)
+    {
+        *outSilentFrames = 0;
+    }
+
+    if(inNumberFrames == 0)
+    {
+        return kEFFRingBufferError_OK;
+    }
+
+    const size_t theBytesPerFrame = mChannelsPerFrame * sizeof(Float32);
+    auto zeroFrames = [&] (SampleTime inFrom, SampleTime inTo) {
+        if(inTo > inFrom)
+        {
+            theSilentFrames += static_cast<UInt32>(inTo - inFrom);
+            memset(outBuffer + (inFrom - inStartRead) * mChannelsPerFrame,
+                   0,
+                   static_cast<size_t>(inTo - inFrom) * theBytesPerFrame);
+        }
+    };
+
+    // Take a snapshot of the time bounds. See the comments on the members for why the order
+    // matters.
+    UInt64 theResetCount = mResetCount.load(std::memory_order_acquire);
+    SampleTime theEndTime = mEndTime.load(std::memory_order_acquire);
+    SampleTime theStartTime = mStartTime.load(std::memory_order_acquire);
+
+    SampleTime theEndRead = inStartRead + inNumberFrames;
+    SampleTime theValidStart = std::max(inStartRead, theStartTime);
+    SampleTime theValidEnd = std::min(theEndRead, theEndTime);
+
+    if(theValidStart >= theValidEnd)
+    {
+        // None of the frames requested are in the buffer.
+        zeroFrames(inStartRead, theEndRead);
+
+        if(outSilentFrames)
+        {
+            *outSilentFrames = theSilentFrames;
+        }
+
+        return kEFFRingBufferError_OK;
+    }
+
+    // Silence for anything before or after the frames we have.
+    zeroFrames(inStartRead, theValidStart);
+    zeroFrames(theValidEnd, theEndRead);
+
+    CopyOutOfRing(theValidStart,
+                  static_cast<UInt32>(theValidEnd - theValidStart),
+                  outBuffer + (theValidStart - inStartRead) * mChannelsPerFrame);
+
+    // Now check whether the writer moved the start time past any of the frames while we were
+    // copying them. Rather than retrying, which could fail indefinitely, we just replace the frames
+    // that might have been overwritten with silence. That can only happen if the reader has fallen
+    // almost a full buffer behind the writer, in which case those frames were about to be lost
+    // anyway.
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(mResetCount.load(std::memory_order_relaxed) != theResetCount)
+    {
+        theSilentFrames = 0;
+        zeroFrames(inStartRead, theEndRead);
+    }
+    else
+    {
+        SampleTime theNewStartTime = mStartTime.load(std::memory_order_relaxed);
+        zeroFrames(theValidStart, std::min(theNewStartTime, theValidEnd));
+    }
+
+    if(outSilentFrames)
+    {
+        *outSilentFrames = theSilentFrames;
+    }
+
+    return kEFFRingBufferError_OK;
+}
+
+void    EFF_LoopbackRingBuffer::GetTimeBounds(SampleTime& outStartTime, SampleTime& outEndTime)
+const
+{
+    outEndTime = mEndTime.load(std::memory_order_acquire);
+    outStartTime = std::min(mStartTime.load(std::memory_order_acquire), outEndTime);
+}
+
+#pragma mark Implementation
+
+Float32*    EFF_LoopbackRingBuffer::FramePtr(SampleTime inSampleTime)
+{
+    return mBuffer.data() + (static_cast<UInt64>(inSampleTime) & mCapacityFramesMask) * mChannelsPerFrame;
+}
+
+const Float32*    EFF_LoopbackRingBuffer::FramePtr(SampleTime inSampleTime)
+const
+{
+    return mBuffer.data() + (static_cast<UInt64>(inSampleTime) & mCapacityFramesMask) * mChannelsPerFrame;
+}
+
+void    EFF_LoopbackRingBuffer::CopyIntoRing(SampleTime inStartTime,
+                                             UInt32 inNumberFrames,
+                                             const Float32* __nullable inSource)
+{
+    const size_t theBytesPerFrame = mChannelsPerFrame * sizeof(Float32);
+
+    UInt32 theOffsetFrames = static_cast<UInt32>(static_cast<UInt64>(inStartTime) & mCapacityFramesMask);
+    UInt32 theFirstPartFrames = std::min(inNumberFrames, mCapacityFrames - theOffsetFrames);
+    UInt32 theSecondPartFrames = inNumberFrames - theFirstPartFrames;
+
+    if(inSource == nullptr)
+    {
+        memset(FramePtr(inStartTime), 0, theFirstPartFrames * theBytesPerFrame);
+        memset(mBuffer.data(), 0, theSecondPartFrames * theBytesPerFrame);
+    }
+    else
+    {
+        memcpy(FramePtr(inStartTime), inSource, theFirstPartFrames * theBytesPerFrame);
+        memcpy(mBuffer.data(),
+               inSource + theFirstPartFrames * mChannelsPerFrame,
+               theSecondPartFrames * theBytesPerFrame);
+    }
+}
+
+void    EFF_LoopbackRingBuffer::CopyOutOfRing(SampleTime inStartTime,
+                                              UInt32 inNumberFrames,
+                                              Float32* outDestination)
+const
+{
+    const size_t theBytesPerFrame = mChannelsPerFrame * sizeof(Float32);
+
+    UInt32 theOffsetFrames = static_cast<UInt32>(static_cast<UInt64>(inStartTime) & mCapacityFramesMask);
+    UInt32 theFirstPartFrames = std::min(inNumberFrames, mCapacityFrames - theOffsetFrames);
+    UInt32 theSecondPartFrames = inNumberFrames - theFirstPartFrames;
+
+    memcpy(outDestination, FramePtr(inStartTime), theFirstPartFrames * theBytesPerFrame);
+    memcpy(outDestination + theFirstPartFrames * mChannelsPerFrame,
+           mBuffer.data(),
+           theSecondPartFrames * theBytesPerFrame);
+}
+
+#pragma clang assume_nonnull end
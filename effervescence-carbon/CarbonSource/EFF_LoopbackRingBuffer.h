@@ -0,0 +1,131 @@
+//
+//  EFF_LoopbackRingBuffer.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A single-producer/single-consumer ring buffer of interleaved Float32 frames, keyed by sample
+//  time. Replaces CARingBuffer for EFF_Device's loopback audio.
+//
+//  CARingBuffer publishes its time bounds through a 32-entry queue and gives up with
+//  kCARingBufferError_CPUOverload if the reader can't get a consistent snapshot after 8 tries,
+//  which is why EFF_Device used to take the IO mutex around every Store/Fetch. This class keeps
+//  the time bounds in atomics instead. Store and Fetch are both wait-free: neither ever retries,
+//  blocks or fails because of the other thread. If the writer overwrites frames while the reader
+//  is copying them, the reader detects it afterwards and replaces just those frames with silence.
+//
+//  Store must only be called from one thread at a time, and Fetch from one thread at a time.
+//  Allocate and Deallocate must not be called while either is running.
+//
+
+#ifndef EFF_LoopbackRingBuffer_h
+#define EFF_LoopbackRingBuffer_h
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <atomic>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+// Deliberately the same values as the equivalent CARingBufferError codes.
+enum EFF_RingBufferError : SInt32
+{
+    kEFFRingBufferError_OK      = 0,
+    // More frames were passed to Store than the buffer can hold.
+    kEFFRingBufferError_TooMuch = 3
+};
+
+class EFF_LoopbackRingBuffer
+{
+
+public:
+    typedef SInt64              SampleTime;
+
+#pragma mark Construction/Destruction
+
+                                EFF_LoopbackRingBuffer() = default;
+                                // Disallow copying
+                                EFF_LoopbackRingBuffer(const EFF_LoopbackRingBuffer&) = delete;
+                                EFF_LoopbackRingBuffer& operator=(const EFF_LoopbackRingBuffer&) = delete;
+
+    /*!
+     Allocate (or reallocate) the buffer and empty it. Not real-time safe.
+
+     @param inChannelsPerFrame The number of interleaved samples in each frame.
+     @param inCapacityFrames The minimum number of frames the buffer can hold. Rounded up to a
+                             power of two.
+     */
+    void                        Allocate(UInt32 inChannelsPerFrame, UInt32 inCapacityFrames);
+    void                        Deallocate();
+
+#pragma mark IO
+
+    /*!
+     Copy inNumberFrames frames from inBuffer into the ring buffer at sample time inStartWrite.
+     Gaps since the previous call are filled with silence. If a gap is so long that the write
+     overwrites everything the buffer held, the buffer just starts at inStartWrite instead, and
+     Fetch returns (and counts) the frames before it as silent frames. If inStartWrite is earlier
+     than the end of the previous call, the buffer is emptied first.
+
+     Real-time safe and wait-free. Writer thread only.
+     */
+    EFF_RingBufferError         Store(const Float32* inBuffer,
+                                      UInt32 inNumberFrames,
+                                      SampleTime inStartWrite);
+
+    /*!
+     Copy inNumberFrames frames at sample time inStartRead into outBuffer. Frames that aren't in
+     the ring buffer, including ones the writer overwrote during the copy, are set to silence. If
+     outSilentFrames isn't null, it's set to the number of frames that were.
+
+     Real-time safe and wait-free. Reader thread only.
+     */
+    EFF_RingBufferError         Fetch(Float32* outBuffer,
+                                      UInt32 inNumberFrames,
+                                      SampleTime inStartRead,
+                                      UInt32* __nullable outSilentFrames = nullptr) const;
+
+    /*! The range of sample times currently held in the buffer, [outStartTime, outEndTime). */
+    void                        GetTimeBounds(SampleTime& outStartTime, SampleTime& outEndTime) const;
+
+    UInt32                      GetCapacityFrames() const { return mCapacityFrames; }
+
+#pragma mark Implementation
+
+private:
+    inline Float32*             FramePtr(SampleTime inSampleTime);
+    inline const Float32*       FramePtr(SampleTime inSampleTime) const;
+
+    // Copy frames between a linear buffer and the ring, splitting the copy where it wraps.
+    void                        CopyIntoRing(SampleTime inStartTime,
+                                             UInt32 inNumberFrames,
+                                             const Float32* __nullable inSource);
+    void                        CopyOutOfRing(SampleTime inStartTime,
+                                              UInt32 inNumberFrames,
+                                              Float32* outDestination) const;
+
+    std::vector<Float32>        mBuffer;
+    UInt32                      mChannelsPerFrame       = 0;
+    UInt32                      mCapacityFrames         = 0;
+    UInt32                      mCapacityFramesMask     = 0;
+
+    // Only written by Store. The reader loads mResetCount, then mEndTime, then mStartTime, and
+    // the writer stores them in that order, so a reader that sees a new start/end time is also
+    // guaranteed to see the reset that came with it.
+    //
+    // Aligned so the reader polling these doesn't share a cache line with mBuffer's bookkeeping.
+    alignas(64) std::atomic<SampleTime> mStartTime      { 0 };
+    std::atomic<SampleTime>     mEndTime                { 0 };
+    // Incremented whenever Store empties the buffer because the sample time went backwards.
+    std::atomic<UInt64>         mResetCount             { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_LoopbackRingBuffer_h */
@@ -0,0 +1,409 @@
+//
+//  EFF_MixRecorder.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_MixRecorder.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CABitOperations.h"
+#include "CACFDictionary.h"
+#include "CADebugMacros.h"
+#include "CAException.h"
+#include "CAPThread.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+EFF_MixRecorder::EFF_MixRecorder()
+{
+}
+
+EFF_MixRecorder::~EFF_MixRecorder()
+{
+    EFFLogAndSwallowExceptions("EFF_MixRecorder::~EFF_MixRecorder", [&] {
+        CAMutex::Locker theStateLocker(mStateMutex);
+
+        Stop();
+
+        if(mWriterThreadStarted)
+        {
+            SendWriterCommand(kWriterCommandExit);
+            mWriterThreadStarted = false;
+        }
+    });
+}
+
+#pragma mark Recording
+
+void    EFF_MixRecorder::Start(CFStringRef inPath,
+                               EFFRecordingFileFormat inFileFormat,
+                               EFFRecordingSampleFormat inSampleFormat,
+                               UInt32 inChannelsPerFrame,
+                               Float64 inSampleRate)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    Stop();
+
+    char thePath[PATH_MAX];
+    ThrowIf(!CFStringGetFileSystemRepresentation(inPath, thePath, sizeof(thePath)),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_MixRecorder::Start: Invalid path");
+    ThrowIf((inChannelsPerFrame == 0) || (inSampleRate < 1.0),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "EFF_MixRecorder::Start: Unsupported format");
+
+    DebugMsg("EFF_MixRecorder::Start: Recording to %s", thePath);
+
+    if(!mWriterThreadStarted)
+    {
+        // The writer thread's CAPThread deletes itself when the thread exits. CAPThread::Entry
+        // still uses it after WriterThreadProc returns, which can be after we've been destroyed.
+        std::unique_ptr<CAPThread> theWriterThread =
+                std::make_unique<CAPThread>(&EFF_MixRecorder::WriterThreadProc,
+                                            this,
+                                            CAPThread::kDefaultThreadPriority,
+                                            /* inFixedPriority = */ false,
+                                            /* inAutoDelete = */ true);
+        theWriterThread->Start();
+        theWriterThread.release();
+        mWriterThreadStarted = true;
+    }
+
+    // Allocate the FIFO before creating the file, so the file isn't left behind if this fails.
+    // Nothing else is using the FIFO while nothing is being recorded.
+    const Float64 theFIFOBlocks = std::ceil(kFIFOSeconds * inSampleRate / kBlockFrames);
+
+    mCapacityBlocks = NextPowerOfTwo(static_cast<UInt32>(std::min<Float64>(theFIFOBlocks, 1 << 30)));
+    mCapacityBlocksMask = mCapacityBlocks - 1;
+    mWakeBlocks = std::max<UInt64>(mCapacityBlocks / kWakeFraction, 1);
+
+    mBlockHeaders.assign(mCapacityBlocks, BlockHeader { 0, 0 });
+    mBlockSamples.assign(mCapacityBlocks * kBlockFrames * inChannelsPerFrame, 0.0f);
+    mWriteBlockIndex.store(0, std::memory_order_relaxed);
+    mReadBlockIndex.store(0, std::memory_order_relaxed);
+    mPendingDroppedFrames = 0;
+
+    // Throws if the file can't be created.
+    mFile.Open(thePath, inFileFormat, inSampleFormat, inChannelsPerFrame, inSampleRate);
+    mFileFailed = false;
+
+    mPath = inPath;
+    mFileFormat = inFileFormat;
+    mSampleFormat = inSampleFormat;
+    mChannelsPerFrame = inChannelsPerFrame;
+
+    mFramesWritten.store(0, std::memory_order_relaxed);
+    mBytesWritten.store(0, std::memory_order_relaxed);
+    mDroppedBlocks.store(0, std::memory_order_relaxed);
+    mDroppedFrames.store(0, std::memory_order_relaxed);
+    mError.store(0, std::memory_order_relaxed);
+
+    // Have the writer thread start watching the FIFO before the IO thread starts filling it.
+    SendWriterCommand(kWriterCommandBegin);
+
+    mIsRecording.store(true, std::memory_order_seq_cst);
+}
+
+void    EFF_MixRecorder::Stop()
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(!mIsRecording.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    DebugMsg("EFF_MixRecorder::Stop: Stopping");
+
+    // Stop the IO thread using the FIFO. It's only ever in CaptureRT for a few microseconds, so
+    // just poll until it's out.
+    mIsRecording.store(false, std::memory_order_seq_cst);
+
+    while(mIOThreadIsCapturing.load(std::memory_order_seq_cst))
+    {
+        usleep(100);
+    }
+
+    // Then have the writer write whatever's left and close the file.
+    SendWriterCommand(kWriterCommandFinish);
+}
+
+bool    EFF_MixRecorder::IsRecording()
+const
+{
+    return mIsRecording.load(std::memory_order_relaxed);
+}
+
+UInt32  EFF_MixRecorder::CaptureRT(const Float32* inMix, UInt32 inFrames)
+{
+    // Nothing is being recorded most of the time, so check that first without a fence.
+    if(!mIsRecording.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    // See Stop.
+    mIOThreadIsCapturing.store(true, std::memory_order_seq_cst);
+
+    UInt32 theDroppedBlocks = 0;
+
+    if(mIsRecording.load(std::memory_order_seq_cst))
+    {
+        UInt64 theWriteIndex = mWriteBlockIndex.load(std::memory_order_relaxed);
+        const UInt64 theSamplesPerBlock = static_cast<UInt64>(kBlockFrames) * mChannelsPerFrame;
+
+        while(inFrames > 0)
+        {
+            const UInt32 theFrames = std::min(inFrames, static_cast<UInt32>(kBlockFrames));
+
+            if(theWriteIndex - mReadBlockIndex.load(std::memory_order_acquire) >= mCapacityBlocks)
+            {
+                // The writer has fallen too far behind. Drop the block and have the writer replace
+                // it with silence.
+                mPendingDroppedFrames += theFrames;
+                mDroppedFrames.fetch_add(theFrames, std::memory_order_relaxed);
+                theDroppedBlocks++;
+            }
+            else
+            {
+                const UInt64 theBlock = theWriteIndex & mCapacityBlocksMask;
+
+                memcpy(&mBlockSamples[theBlock * theSamplesPerBlock],
+                       inMix,
+                       theFrames * mChannelsPerFrame * sizeof(Float32));
+                mBlockHeaders[theBlock] = BlockHeader { theFrames, mPendingDroppedFrames };
+                mPendingDroppedFrames = 0;
+
+                // Publish the block.
+                theWriteIndex++;
+                mWriteBlockIndex.store(theWriteIndex, std::memory_order_release);
+            }
+
+            inMix += theFrames * mChannelsPerFrame;
+            inFrames -= theFrames;
+        }
+
+        if(theDroppedBlocks > 0)
+        {
+            mDroppedBlocks.fetch_add(theDroppedBlocks, std::memory_order_relaxed);
+        }
+
+        // Wake the writer if there's enough for a large write and it's waiting. This fence pairs
+        // with the one in WriterThreadLoop, so one of the threads always sees the other's store.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if((GetQueuedBlocks() >= mWakeBlocks) &&
+           mWriterIsWaiting.load(std::memory_order_relaxed) &&
+           mWriterIsWaiting.exchange(false, std::memory_order_acq_rel))
+        {
+            mWakeSemaphore.Signal();
+        }
+    }
+
+    mIOThreadIsCapturing.store(false, std::memory_order_release);
+
+    return theDroppedBlocks;
+}
+
+#pragma mark Status
+
+CFDictionaryRef EFF_MixRecorder::CopyStatusAsDictionary()
+const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    CACFDictionary theStatus(false);
+    const bool theIsRecording = IsRecording();
+
+    theStatus.AddBool(CFSTR(kEFFRecordingKey_IsRecording), theIsRecording);
+
+    if(theIsRecording)
+    {
+        theStatus.AddString(CFSTR(kEFFRecordingKey_Path), mPath.GetCFString());
+        theStatus.AddSInt32(CFSTR(kEFFRecordingKey_FileFormat), mFileFormat);
+        theStatus.AddSInt32(CFSTR(kEFFRecordingKey_SampleFormat), mSampleFormat);
+    }
+
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_FramesWritten), mFramesWritten.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_BytesWritten), mBytesWritten.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_DroppedBlocks), mDroppedBlocks.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_DroppedFrames), mDroppedFrames.load(std::memory_order_relaxed));
+    theStatus.AddSInt32(CFSTR(kEFFRecordingKey_Error), mError.load(std::memory_order_relaxed));
+
+    return theStatus.GetDict();
+}
+
+#pragma mark Implementation
+
+UInt64  EFF_MixRecorder::GetQueuedBlocks()
+const
+{
+    return mWriteBlockIndex.load(std::memory_order_acquire) - mReadBlockIndex.load(std::memory_order_acquire);
+}
+
+//static
+void* __nullable    EFF_MixRecorder::WriterThreadProc(void* inRefCon)
+{
+    DebugMsg("EFF_MixRecorder::WriterThreadProc: The writer thread has started");
+
+    static_cast<EFF_MixRecorder*>(inRefCon)->WriterThreadLoop();
+
+    return NULL;
+}
+
+void    EFF_MixRecorder::WriterThreadLoop()
+{
+    // Only true between the Begin and Finish commands. The FIFO is only read while it's true, so
+    // Start can reallocate it while it's false.
+    bool theIsRecording = false;
+
+    while(true)
+    {
+        bool theShouldWait = true;
+
+        if(theIsRecording)
+        {
+            mWriterIsWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // If the IO thread queued enough blocks before it could see the flag, don't wait. If it
+            // cleared the flag first, it's signalled (or is about to), so wait anyway to consume it.
+            if((GetQueuedBlocks() >= mWakeBlocks) &&
+               mWriterIsWaiting.exchange(false, std::memory_order_acq_rel))
+            {
+                theShouldWait = false;
+            }
+        }
+
+        if(theShouldWait)
+        {
+            mWakeSemaphore.Wait();
+        }
+
+        switch(mWriterCommand.exchange(kWriterCommandNone, std::memory_order_acq_rel))
+        {
+            case kWriterCommandBegin:
+                theIsRecording = true;
+                mCommandDoneSemaphore.Signal();
+                break;
+
+            case kWriterCommandFinish:
+                DrainFIFO();
+
+                try
+                {
+                    // Stop has made sure the IO thread is done with mPendingDroppedFrames. Write
+                    // those frames too, so the recording is as long as the time it covered.
+                    if(!mFileFailed && (mPendingDroppedFrames > 0))
+                    {
+                        mFile.WriteSilence(mPendingDroppedFrames);
+                    }
+
+                    mFile.Close();
+                }
+                catch(const CAException& e)
+                {
+                    mError.store(e.GetError(), std::memory_order_relaxed);
+                }
+
+                mFramesWritten.store(mFile.GetFramesWritten(), std::memory_order_relaxed);
+                mBytesWritten.store(mFile.GetBytesWritten(), std::memory_order_relaxed);
+
+                DebugMsg("EFF_MixRecorder::WriterThreadLoop: Finished recording. frames=%llu droppedBlocks=%llu",
+                         mFramesWritten.load(std::memory_order_relaxed),
+                         mDroppedBlocks.load(std::memory_order_relaxed));
+
+                theIsRecording = false;
+                mWriterIsWaiting.store(false, std::memory_order_relaxed);
+                mCommandDoneSemaphore.Signal();
+                break;
+
+            case kWriterCommandExit:
+                mCommandDoneSemaphore.Signal();
+                return;
+
+            case kWriterCommandNone:
+            default:
+                // Woken by the IO thread. (Or a leftover signal, which is harmless.)
+                if(theIsRecording)
+                {
+                    DrainFIFO();
+                }
+                break;
+        }
+    }
+}
+
+void    EFF_MixRecorder::DrainFIFO()
+{
+    const UInt64 theSamplesPerBlock = static_cast<UInt64>(kBlockFrames) * mChannelsPerFrame;
+    UInt64 theReadIndex = mReadBlockIndex.load(std::memory_order_relaxed);
+
+    // Keep going until the FIFO's empty, including any blocks queued while writing.
+    while(theReadIndex != mWriteBlockIndex.load(std::memory_order_acquire))
+    {
+        const UInt64 theBlock = theReadIndex & mCapacityBlocksMask;
+        const BlockHeader& theHeader = mBlockHeaders[theBlock];
+
+        // After an error, keep emptying the FIFO so the IO thread doesn't count dropped blocks,
+        // but don't try to write any more.
+        if(!mFileFailed)
+        {
+            try
+            {
+                if(theHeader.mDroppedFramesBefore > 0)
+                {
+                    mFile.WriteSilence(theHeader.mDroppedFramesBefore);
+                }
+
+                mFile.WriteFrames(&mBlockSamples[theBlock * theSamplesPerBlock], theHeader.mFrames);
+            }
+            catch(const CAException& e)
+            {
+                LogError("EFF_MixRecorder::DrainFIFO: Stopped writing after an error: %d",
+                         static_cast<int>(e.GetError()));
+                mError.store(e.GetError(), std::memory_order_relaxed);
+                mFileFailed = true;
+            }
+        }
+
+        // Free the block for the IO thread.
+        theReadIndex++;
+        mReadBlockIndex.store(theReadIndex, std::memory_order_release);
+    }
+
+    mFramesWritten.store(mFile.GetFramesWritten(), std::memory_order_relaxed);
+    mBytesWritten.store(mFile.GetBytesWritten(), std::memory_order_relaxed);
+}
+
+void    EFF_MixRecorder::SendWriterCommand(WriterCommand inCommand)
+{
+    mWriterCommand.store(inCommand, std::memory_order_seq_cst);
+    mWakeSemaphore.Signal();
+    mCommandDoneSemaphore.Wait();
+}
+
+#pragma clang assume_nonnull end
+
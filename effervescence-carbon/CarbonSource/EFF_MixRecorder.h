@@ -0,0 +1,194 @@
+//
+//  EFF_MixRecorder.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Records EFF_Device's output mix to a file. See kAudioDeviceCustomPropertyRecording.
+//
+//  The IO thread can't wait for the disk, so CaptureRT just copies the mix into a preallocated
+//  single-producer/single-consumer FIFO of fixed-size blocks. A writer thread drains the FIFO and
+//  writes the blocks to the file with EFF_CaptureFileWriter. The IO thread only wakes the writer
+//  once enough blocks have queued up for a large write, so the writer sleeps for most of the
+//  recording.
+//
+//  If the writer falls so far behind that the FIFO fills up, e.g. because the disk stalled, the IO
+//  thread drops the blocks that don't fit rather than waiting. The number of frames dropped is
+//  stored in the next block that does fit, and the writer writes that many frames of silence
+//  before it, so the rest of the recording stays in time. The drops are counted for
+//  kEFFRecordingKey_DroppedBlocks.
+//
+//  While IO isn't running, nothing is recorded. The recording just continues from where it left
+//  off when IO starts again.
+//
+//  CaptureRT is real-time safe and must only be called from one thread at a time. The other
+//  methods aren't real-time safe, but can be called from any thread.
+//
+
+#ifndef EFF_MixRecorder_h
+#define EFF_MixRecorder_h
+
+// Local Includes
+#include "EFF_CaptureFileWriter.h"
+#include "EFF_Semaphore.h"
+#include "EFF_Types.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAMutex.h"
+
+// STL Includes
+#include <atomic>
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_MixRecorder
+{
+
+public:
+    // The number of frames in each block in the FIFO. Larger IO buffers are split across blocks.
+    static const UInt32         kBlockFrames = 512;
+    // How much audio the FIFO can hold, which is how long the writer can stall without losing any.
+    static constexpr Float64    kFIFOSeconds = 4.0;
+    // The fraction of the FIFO that has to be full before the IO thread wakes the writer.
+    static const UInt32         kWakeFraction = 8;
+
+#pragma mark Construction/Destruction
+
+                                EFF_MixRecorder();
+                                ~EFF_MixRecorder();
+                                // Disallow copying
+                                EFF_MixRecorder(const EFF_MixRecorder&) = delete;
+                                EFF_MixRecorder& operator=(const EFF_MixRecorder&) = delete;
+
+#pragma mark Recording
+
+    /*!
+     Create the file and start recording to it, after stopping the recording in progress, if there
+     is one. Resets the counts.
+
+     @param inPath The file's path. Kept for the status dictionary.
+     @throws CAException If the file can't be created. See EFF_CaptureFileWriter::Open.
+     */
+    void                        Start(CFStringRef inPath,
+                                      EFFRecordingFileFormat inFileFormat,
+                                      EFFRecordingSampleFormat inSampleFormat,
+                                      UInt32 inChannelsPerFrame,
+                                      Float64 inSampleRate);
+    /*!
+     Stop recording, write out the audio still in the FIFO and close the file. Blocks until the
+     file is closed. Does nothing if nothing is being recorded.
+     */
+    void                        Stop();
+
+    bool                        IsRecording() const;
+
+    /*!
+     Queue inFrames frames of the mix to be written. Does nothing if nothing is being recorded.
+     Real-time safe.
+
+     @param inMix Interleaved, with the number of channels passed to Start.
+     @return The number of blocks dropped because the FIFO was full.
+     */
+    UInt32                      CaptureRT(const Float32* inMix, UInt32 inFrames);
+
+#pragma mark Status
+
+    /*!
+     @return A new CFDictionary with the kAudioDeviceCustomPropertyRecording keys for the current or
+             most recent recording. The caller is responsible for releasing it.
+     */
+    CFDictionaryRef             CopyStatusAsDictionary() const;
+
+#pragma mark Implementation
+
+private:
+    struct BlockHeader
+    {
+        UInt32                  mFrames;
+        // The frames the IO thread dropped since the previous block it queued.
+        UInt64                  mDroppedFramesBefore;
+    };
+
+    enum WriterCommand : UInt32
+    {
+        kWriterCommandNone,
+        // Start reading the FIFO.
+        kWriterCommandBegin,
+        // Write the rest of the FIFO and close the file.
+        kWriterCommandFinish,
+        // Return from the writer thread.
+        kWriterCommandExit
+    };
+
+    UInt64                      GetQueuedBlocks() const;
+
+    static void* __nullable     WriterThreadProc(void* inRefCon);
+    void                        WriterThreadLoop();
+    // Write the blocks in the FIFO to the file, until it's empty.
+    void                        DrainFIFO();
+    // Send a command to the writer thread and wait for it to be done.
+    void                        SendWriterCommand(WriterCommand inCommand);
+
+    // Guards the recording's state (everything not written by the IO or writer threads) and
+    // serialises Start and Stop.
+    CAMutex                     mStateMutex { "EFF_MixRecorder state" };
+
+    // The writer thread is only started by the first recording.
+    bool                        mWriterThreadStarted    = false;
+    // Signalled to wake the writer thread.
+    EFF_Semaphore               mWakeSemaphore;
+    // Signalled by the writer thread when it's done a command.
+    EFF_Semaphore               mCommandDoneSemaphore;
+    std::atomic<UInt32>         mWriterCommand          { kWriterCommandNone };
+    // True while the writer thread is waiting on mWakeSemaphore. The IO thread clears it when it
+    // signals the semaphore, so it only signals once per wait.
+    std::atomic<bool>           mWriterIsWaiting        { false };
+
+    // Only used by the writer thread while recording. Start opens it before starting the recording.
+    EFF_CaptureFileWriter       mFile;
+    bool                        mFileFailed             = false;
+
+    CACFString                  mPath;
+    EFFRecordingFileFormat      mFileFormat             = kEFFRecordingFileFormatWAV;
+    EFFRecordingSampleFormat    mSampleFormat           = kEFFRecordingSampleFormatFloat32;
+    UInt32                      mChannelsPerFrame       = 0;
+
+    // The FIFO. Reallocated by Start while nothing is being recorded.
+    std::vector<BlockHeader>    mBlockHeaders;
+    std::vector<Float32>        mBlockSamples;
+    UInt64                      mCapacityBlocks         = 0;
+    UInt64                      mCapacityBlocksMask     = 0;
+    UInt64                      mWakeBlocks             = 0;
+    // The total number of blocks written to and read from the FIFO. Only written by the IO thread
+    // and the writer thread respectively.
+    std::atomic<UInt64>         mWriteBlockIndex        { 0 };
+    std::atomic<UInt64>         mReadBlockIndex         { 0 };
+
+    // Stops and starts CaptureRT without locking. Stop clears mIsRecording and then waits for
+    // mIOThreadIsCapturing to be false, after which the IO thread won't touch the FIFO.
+    std::atomic<bool>           mIsRecording            { false };
+    std::atomic<bool>           mIOThreadIsCapturing    { false };
+    // Only used by the IO thread while recording.
+    UInt64                      mPendingDroppedFrames   = 0;
+
+    // Counts for the status dictionary.
+    std::atomic<UInt64>         mFramesWritten          { 0 };
+    std::atomic<UInt64>         mBytesWritten           { 0 };
+    std::atomic<UInt64>         mDroppedBlocks          { 0 };
+    std::atomic<UInt64>         mDroppedFrames          { 0 };
+    std::atomic<OSStatus>       mError                  { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_MixRecorder_h */
+
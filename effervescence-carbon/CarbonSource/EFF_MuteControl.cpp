@@ -12,6 +12,7 @@
 
 // Local Includes
 #include "EFF_PlugIn.h"
+#include "EFF_Utils.h"
 
 // PublicUtility Includes
 #include "CADebugMacros.h"
@@ -35,10 +36,25 @@ EFF_MuteControl::EFF_MuteControl(AudioObjectID inObjectID,
                 inScope,
                 inElement),
     mMutex("Mute Control"),
-    mMuted(false)
+    mMuted(false),
+    mFadeStage(1.0f, kMuteFadeFrames),
+    mWillApplyMuteToAudio(false)
 {
 }
 
+#pragma mark EFF_Object
+
+void    EFF_MuteControl::Deactivate()
+{
+    {
+        CAMutex::Locker theLocker(mMutex);
+        mMuted = false;
+        mFadeStage.SetGain(1.0f);
+    }
+
+    EFF_Control::Deactivate();
+}
+
 #pragma mark Property Operations
 
 bool    EFF_MuteControl::HasProperty(AudioObjectID inObjectID,
@@ -182,9 +198,10 @@ void    EFF_MuteControl::SetPropertyData(AudioObjectID inObjectID,
                 if(mMuted != theNewMuted)
                 {
                     mMuted = theNewMuted;
+                    mFadeStage.SetGain(mMuted ? 0.0f : 1.0f);
 
                     // Send notifications.
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
                         AudioObjectPropertyAddress theChangedProperty[1];
                         theChangedProperty[0] = {
                                 kAudioBooleanControlPropertyValue, mScope, mElement
@@ -208,4 +225,31 @@ void    EFF_MuteControl::SetPropertyData(AudioObjectID inObjectID,
     };
 }
 
+#pragma mark Accessors
+
+void    EFF_MuteControl::SetWillApplyMuteToAudio(bool inWillApplyMuteToAudio)
+{
+    mWillApplyMuteToAudio = inWillApplyMuteToAudio;
+}
+
+#pragma mark IO Operations
+
+bool    EFF_MuteControl::WillApplyMuteToAudioRT() const
+{
+    return mWillApplyMuteToAudio;
+}
+
+void    EFF_MuteControl::ApplyMuteToAudioRT(Float32* ioBuffer,
+                                        UInt32 inChannelsPerFrame,
+                                        UInt32 inBufferFrameSize)
+{
+    ThrowIf(!mWillApplyMuteToAudio,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_MuteControl::ApplyMuteToAudioRT: This control doesn't process audio data");
+
+    // The fade stage doesn't touch the buffer while unmuted and just writes zeros while muted, so
+    // this only costs anything during the fades.
+    mFadeStage.ProcessRT(ioBuffer, inChannelsPerFrame, inBufferFrameSize);
+}
+
 #pragma clang assume_nonnull end
@@ -14,6 +14,9 @@
 // Superclass Includes
 #include "EFF_Control.h"
 
+// Local Includes
+#include "EFF_GainStage.h"
+
 // PublicUtility Includes
 #include "CAMutex.h"
 
@@ -39,6 +42,14 @@ public:
                                               AudioObjectPropertyElement inElement =
                                                       kAudioObjectPropertyElementMaster);
 
+#pragma mark EFF_Object
+
+    /*!
+     Also unmutes the control, so a mute control that's been hidden can't keep the device's audio
+     silenced with no way for the user to unmute it.
+     */
+    virtual void              Deactivate();
+
 #pragma mark Property Operations
 
     bool                      HasProperty(AudioObjectID inObjectID,
@@ -72,12 +83,56 @@ public:
                                               UInt32 inDataSize,
                                               const void* inData);
 
+#pragma mark Accessors
+
+    /*!
+     Set this mute control to mute audio data, which allows clients to call ApplyMuteToAudioRT.
+     When this is set true, WillApplyMuteToAudioRT will return true. Set to false initially.
+     */
+    void                      SetWillApplyMuteToAudio(bool inWillApplyMuteToAudio);
+
+#pragma mark IO Operations
+
+    /*!
+     @return True if clients should use ApplyMuteToAudioRT to apply this mute control's value to
+             their audio data while doing IO.
+     */
+    bool                      WillApplyMuteToAudioRT() const;
+    /*!
+     Silence the samples in ioBuffer if this control is muted. When the control is muted or
+     unmuted, the audio fades out or in over kMuteFadeFrames frames rather than cutting out or in
+     abruptly.
+
+     Only the IO thread may call this.
+
+     @param ioBuffer The interleaved audio sample buffer to process.
+     @param inChannelsPerFrame The number of channels in ioBuffer.
+     @param inBufferFrameSize The number of sample frames in ioBuffer.
+     @throws CAException If SetWillApplyMuteToAudio hasn't been used to set this control to apply
+                         its value to audio data.
+     */
+    void                      ApplyMuteToAudioRT(Float32* ioBuffer,
+                                                 UInt32 inChannelsPerFrame,
+                                                 UInt32 inBufferFrameSize);
+    /*!
+     Make ApplyMuteToAudioRT apply the current value immediately, rather than fading to it. Call
+     this before IO starts. Must not be called while IO is running.
+     */
+    void                      ResetMuteFade() { mFadeStage.Reset(); }
+
 #pragma mark Implementation
 
 private:
+    // About 6 ms at 44.1 kHz.
+    static const UInt32       kMuteFadeFrames = 256;
+
     CAMutex                   mMutex;
     bool                      mMuted;
 
+    // Applies mMuted to audio. Its gain is 0 while muted and 1 otherwise.
+    EFF_GainStage             mFadeStage;
+    bool                      mWillApplyMuteToAudio;
+
 };
 
 #pragma clang assume_nonnull end
@@ -11,6 +11,7 @@
 
 // Local Includes
 #include "EFF_PlugIn.h"
+#include "EFF_Utils.h"
 
 // PublicUtility Includes
 #include "CADebugMacros.h"
@@ -22,6 +23,7 @@
 #pragma clang assume_nonnull begin
 
 static const Float64 kSampleRate = 44100.0;
+static const UInt32 kChannelsPerFrame = 2;
 static const UInt32 kZeroTimeStampPeriod = 10000;  // Arbitrary.
 
 
@@ -56,7 +58,7 @@ EFF_NullDevice::EFF_NullDevice()
     EFF_AbstractDevice(kObjectID_Device_Null, kAudioObjectPlugInObject),
     mStateMutex("Null Device State"),
     mIOMutex("Null Device IO"),
-    mStream(kObjectID_Stream_Null, kObjectID_Device_Null, false, kSampleRate)
+    mStream(kObjectID_Stream_Null, kObjectID_Device_Null, false, kSampleRate, kChannelsPerFrame)
 {
 }
 
@@ -97,7 +99,7 @@ void    EFF_NullDevice::Deactivate()
 
 void    EFF_NullDevice::SendDeviceIsAlivePropertyNotifications()
 {
-    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
         AudioObjectPropertyAddress theChangedProperties[] = {
             CAPropertyAddress(kAudioDevicePropertyDeviceIsAlive)
         };
@@ -398,7 +400,7 @@ void    EFF_NullDevice::StartIO(UInt32 inClientID)
 
         // Send notifications.
         DebugMsg("EFF_NullDevice::StartIO: Sending kAudioDevicePropertyDeviceIsRunning");
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
             AudioObjectPropertyAddress theChangedProperty[] = {
                 CAPropertyAddress(kAudioDevicePropertyDeviceIsRunning)
             };
@@ -425,7 +427,7 @@ void    EFF_NullDevice::StopIO(UInt32 inClientID)
     {
         // Send notifications.
         DebugMsg("EFF_NullDevice::StopIO: Sending kAudioDevicePropertyDeviceIsRunning");
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
             AudioObjectPropertyAddress theChangedProperty[] = {
                 CAPropertyAddress(kAudioDevicePropertyDeviceIsRunning)
             };
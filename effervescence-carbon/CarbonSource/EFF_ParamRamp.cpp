@@ -0,0 +1,70 @@
+//
+//  EFF_ParamRamp.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_ParamRamp.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+
+#pragma clang assume_nonnull begin
+
+void    EFF_ParamRamp::Reset(Float32 inValue)
+{
+    mValue = inValue;
+    mTarget = inValue;
+    mFramesRemaining = 0;
+}
+
+void    EFF_ParamRamp::SetTarget(Float32 inTarget, UInt32 inFrames, Shape inShape)
+{
+    if(inFrames == 0 || inTarget == mValue)
+    {
+        Reset(inTarget);
+        return;
+    }
+
+    mTarget = inTarget;
+    mShape = inShape;
+    mFramesRemaining = inFrames;
+
+    if(mShape == kShapeExponential)
+    {
+        mValue = std::max(mValue, kExponentialFloor);
+        mStep = std::pow(std::max(mTarget, kExponentialFloor) / mValue, 1.0f / static_cast<Float32>(inFrames));
+    }
+    else
+    {
+        mStep = (mTarget - mValue) / static_cast<Float32>(inFrames);
+    }
+}
+
+void    EFF_ParamRamp::Advance(UInt32 inFrames)
+{
+    if(inFrames >= mFramesRemaining)
+    {
+        // Finish exactly on the target rather than wherever the rounding errors have left us.
+        Reset(mTarget);
+        return;
+    }
+
+    if(mShape == kShapeExponential)
+    {
+        mValue *= std::pow(mStep, static_cast<Float32>(inFrames));
+    }
+    else
+    {
+        mValue += mStep * static_cast<Float32>(inFrames);
+    }
+
+    mFramesRemaining -= inFrames;
+}
+
+#pragma clang assume_nonnull end
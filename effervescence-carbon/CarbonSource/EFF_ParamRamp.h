@@ -0,0 +1,70 @@
+//
+//  EFF_ParamRamp.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A parameter value that moves smoothly to a new target over a number of frames, rather than
+//  changing all at once, so that changing a gain or pan position doesn't cause an audible step.
+//
+//  Real-time safe. Not thread safe.
+//
+
+#ifndef EFF_ParamRamp_h
+#define EFF_ParamRamp_h
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_ParamRamp
+{
+
+public:
+    enum Shape
+    {
+        // The value changes by the same amount each frame.
+        kShapeLinear,
+        // The value changes by the same ratio each frame, i.e. linearly in dB. Only for values that
+        // are never negative, such as gains.
+        kShapeExponential
+    };
+
+    /*! Jump straight to inValue, cancelling any ramp in progress. */
+    void                        Reset(Float32 inValue);
+
+    /*!
+     Start ramping from the current value to inTarget over the next inFrames frames. If a ramp is
+     already in progress, the new one starts from wherever the old one had got to.
+     */
+    void                        SetTarget(Float32 inTarget, UInt32 inFrames, Shape inShape);
+
+    /*! Move the ramp forward by inFrames frames. */
+    void                        Advance(UInt32 inFrames);
+
+    bool                        IsRamping() const { return mFramesRemaining > 0; }
+    Float32                     GetValue() const { return mValue; }
+    Float32                     GetTarget() const { return mTarget; }
+    UInt32                      GetFramesRemaining() const { return mFramesRemaining; }
+
+private:
+    // Exponential ramps can't start or end at zero, so they use this instead and then jump to the
+    // real target at the end. (About -100 dB.)
+    static constexpr Float32    kExponentialFloor       = 1.0e-5f;
+
+    Float32                     mValue                  = 0.0f;
+    Float32                     mTarget                 = 0.0f;
+    Shape                       mShape                  = kShapeLinear;
+    // The amount added to mValue each frame for linear ramps, or the amount it's multiplied by
+    // for exponential ones.
+    Float32                     mStep                   = 0.0f;
+    UInt32                      mFramesRemaining        = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_ParamRamp_h */
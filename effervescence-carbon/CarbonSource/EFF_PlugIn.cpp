@@ -17,6 +17,7 @@
 // Local Includes
 #include "EFF_Device.h"
 #include "EFF_NullDevice.h"
+#include "EFF_Utils.h"
 
 // PublicUtility Includes
 #include "CAException.h"
@@ -382,7 +383,7 @@ void    EFF_PlugIn::SetPropertyData(AudioObjectID inObjectID,
                     }
 
                     // Send notifications.
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
                         AudioObjectPropertyAddress theChangedProperties[] = {
                             CAPropertyAddress(kAudioObjectPropertyOwnedObjects),
                             CAPropertyAddress(kAudioPlugInPropertyDeviceList)
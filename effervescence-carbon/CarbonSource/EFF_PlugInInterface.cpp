@@ -169,6 +169,7 @@ static EFF_Object& EFF_LookUpOwnerObject(AudioObjectID inObjectID)
         case kObjectID_Device:
         case kObjectID_Stream_Input:
         case kObjectID_Stream_Output:
+        case kObjectID_Stream_Input_Apps:
         case kObjectID_Volume_Output_Master:
         case kObjectID_Mute_Output_Master:
             return EFF_Device::GetInstance();
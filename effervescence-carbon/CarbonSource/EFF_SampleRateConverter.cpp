@@ -0,0 +1,304 @@
+//
+//  EFF_SampleRateConverter.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_SampleRateConverter.h"
+
+// Local Includes
+#include "EFF_AudioKernels.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <string.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Filter Design
+
+struct EFF_SRCQualityParams
+{
+    // The filter length when not downsampling. Downsampling lowers the cutoff, so the filter is
+    // lengthened by the same factor to keep the transition band the same width relative to it.
+    UInt32                      mTaps;
+    UInt32                      mPhases;
+    // The frequency where the filter is at -6 dB, as a fraction of the Nyquist frequency.
+    Float64                     mCutoff;
+    // Higher values attenuate more above the cutoff but make the transition band wider. The
+    // cutoffs are chosen so the transition band ends at about the Nyquist frequency.
+    Float64                     mKaiserBeta;
+};
+
+// Indexed by EFF_SampleRateConverter::Quality. The stopband attenuations are roughly 55, 70 and
+// 90 dB.
+static const EFF_SRCQualityParams kQualityParams[] = {
+    { 16,  64,  0.80, 5.0 },
+    { 32,  128, 0.86, 7.0 },
+    { 64,  256, 0.92, 9.0 }
+};
+
+// Downsampling by a large factor would need a very long filter. Past this, the filter just gets
+// worse instead.
+static const UInt32 kMaxTaps = 1024;
+
+// The zeroth order modified Bessel function of the first kind, for the Kaiser window.
+static Float64 BesselI0(Float64 inX)
+{
+    Float64 theSum = 1.0;
+    Float64 theTerm = 1.0;
+    const Float64 theHalfX = inX / 2.0;
+
+    for(int k = 1; k < 64 && theTerm > theSum * 1e-12; k++)
+    {
+        theTerm *= (theHalfX / k) * (theHalfX / k);
+        theSum += theTerm;
+    }
+
+    return theSum;
+}
+
+
+#pragma mark Construction/Destruction
+
+void    EFF_SampleRateConverter::Allocate(UInt32 inChannelsPerFrame,
+                                          Float64 inInputSampleRate,
+                                          Float64 inOutputSampleRate,
+                                          Quality inQuality,
+                                          UInt32 inMaxOutputFrames,
+                                          Float64 inMaxRateAdjustment)
+{
+    ThrowIf(inChannelsPerFrame == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::Allocate: No channels");
+    ThrowIf(!(inInputSampleRate > 0.0) || !(inOutputSampleRate > 0.0),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::Allocate: Invalid sample rate");
+    ThrowIf(inQuality > kQualityHigh,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::Allocate: Invalid quality");
+    ThrowIf(!(inMaxRateAdjustment >= 0.0) || !(inMaxRateAdjustment < 1.0),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::Allocate: Invalid rate adjustment");
+
+    const EFF_SRCQualityParams& theParams = kQualityParams[inQuality];
+
+    mChannelsPerFrame = inChannelsPerFrame;
+    mMaxOutputFrames = inMaxOutputFrames;
+    mNominalStep = inInputSampleRate / inOutputSampleRate;
+    mStep = mNominalStep;
+    mMaxRateAdjustment = inMaxRateAdjustment;
+    mPhases = theParams.mPhases;
+
+    // When downsampling, the cutoff has to be below the output's Nyquist frequency instead.
+    const Float64 theDownsamplingFactor = std::max(1.0, mNominalStep);
+    const Float64 theTaps = std::ceil(theParams.mTaps * theDownsamplingFactor / 2.0) * 2.0;
+    mTaps = static_cast<UInt32>(std::min(theTaps, static_cast<Float64>(kMaxTaps)));
+
+    GenerateFilterTable(theParams.mCutoff / theDownsamplingFactor, theParams.mKaiserBeta);
+    mCoefficients.assign(mTaps, 0.0f);
+
+    // The most input frames in use at once: the ones for the filter, plus the ones the output
+    // frames move past at the fastest adjusted rate, plus one for rounding.
+    const Float64 theMaxStep = mNominalStep * (1.0 + mMaxRateAdjustment);
+    mHistoryCapacityFrames = mTaps + static_cast<UInt32>(std::ceil(inMaxOutputFrames * theMaxStep)) + 1;
+    mHistory.assign(static_cast<size_t>(mHistoryCapacityFrames) * mChannelsPerFrame, 0.0f);
+
+    Reset();
+}
+
+void    EFF_SampleRateConverter::Deallocate()
+{
+    mFilterTable.clear();
+    mFilterTable.shrink_to_fit();
+    mCoefficients.clear();
+    mCoefficients.shrink_to_fit();
+    mHistory.clear();
+    mHistory.shrink_to_fit();
+
+    mChannelsPerFrame = 0;
+    mMaxOutputFrames = 0;
+    mTaps = 0;
+    mPhases = 0;
+    mHistoryCapacityFrames = 0;
+    mHistoryFrames = 0;
+    mPosition = 0.0;
+    mStep = 1.0;
+    mNominalStep = 1.0;
+    mMaxRateAdjustment = 0.0;
+}
+
+void    EFF_SampleRateConverter::Reset()
+{
+    // Start with silence before the first input frame, so the first output frame lines up with it
+    // exactly.
+    mHistoryFrames = (mTaps > 0) ? (mTaps / 2 - 1) : 0;
+    mPosition = 0.0;
+
+    for(UInt32 theChannel = 0; theChannel < mChannelsPerFrame; theChannel++)
+    {
+        memset(&mHistory[static_cast<size_t>(theChannel) * mHistoryCapacityFrames],
+               0,
+               mHistoryFrames * sizeof(Float32));
+    }
+}
+
+void    EFF_SampleRateConverter::GenerateFilterTable(Float64 inCutoff, Float64 inKaiserBeta)
+{
+    // inCutoff is a fraction of the input's Nyquist frequency, so this is in cycles per input frame.
+    const Float64 theCutoff = inCutoff / 2.0;
+    const Float64 theHalfLength = mTaps / 2.0;
+    const Float64 theWindowScale = 1.0 / BesselI0(inKaiserBeta);
+
+    mFilterTable.assign(static_cast<size_t>(mPhases + 1) * mTaps, 0.0f);
+
+    for(UInt32 thePhase = 0; thePhase <= mPhases; thePhase++)
+    {
+        const Float64 theFraction = static_cast<Float64>(thePhase) / mPhases;
+        Float32* theRow = &mFilterTable[static_cast<size_t>(thePhase) * mTaps];
+        Float64 theSum = 0.0;
+
+        for(UInt32 theTap = 0; theTap < mTaps; theTap++)
+        {
+            // The distance from the output frame to this tap's input frame. The output frame is
+            // between taps mTaps / 2 - 1 and mTaps / 2.
+            const Float64 theDistance = theTap - (theHalfLength - 1.0) - theFraction;
+            const Float64 theX = 2.0 * theCutoff * theDistance;
+            const Float64 theSinc = (theX == 0.0) ? 1.0 : std::sin(M_PI * theX) / (M_PI * theX);
+
+            const Float64 theWindowPosition = theDistance / theHalfLength;
+            const Float64 theWindow = (std::fabs(theWindowPosition) >= 1.0) ? 0.0 :
+                BesselI0(inKaiserBeta * std::sqrt(1.0 - theWindowPosition * theWindowPosition)) * theWindowScale;
+
+            const Float64 theCoefficient = 2.0 * theCutoff * theSinc * theWindow;
+            theRow[theTap] = static_cast<Float32>(theCoefficient);
+            theSum += theCoefficient;
+        }
+
+        // Normalise each phase to unity gain at DC, so a constant signal stays constant instead
+        // of picking up a ripple at the rate the phases cycle.
+        for(UInt32 theTap = 0; theTap < mTaps; theTap++)
+        {
+            theRow[theTap] = static_cast<Float32>(theRow[theTap] / theSum);
+        }
+    }
+}
+
+
+#pragma mark Conversion
+
+void    EFF_SampleRateConverter::SetRateAdjustmentRT(Float64 inAdjustment)
+{
+    // The position of the next output frame carries over, so the output stays continuous.
+    const Float64 theAdjustment = std::min(std::max(inAdjustment, -mMaxRateAdjustment), mMaxRateAdjustment);
+    mStep = mNominalStep * (1.0 + theAdjustment);
+}
+
+UInt32  EFF_SampleRateConverter::GetInputFramesNeeded(UInt32 inOutputFrames)
+const
+{
+    if(inOutputFrames == 0)
+    {
+        return 0;
+    }
+
+    // The last output frame's filter has to fit in the history. This has to calculate its
+    // position exactly the same way as ProcessRT.
+    const Float64 theLastPosition = mPosition + (inOutputFrames - 1) * mStep;
+    const UInt32 theFramesNeeded = static_cast<UInt32>(theLastPosition) + mTaps;
+
+    return (theFramesNeeded > mHistoryFrames) ? (theFramesNeeded - mHistoryFrames) : 0;
+}
+
+void    EFF_SampleRateConverter::ProcessRT(const Float32* inInput,
+                                           UInt32 inInputFrames,
+                                           Float32* outOutput,
+                                           UInt32 inOutputFrames)
+{
+    ThrowIf(inOutputFrames > mMaxOutputFrames,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::ProcessRT: Too many output frames");
+    ThrowIf(inInputFrames != GetInputFramesNeeded(inOutputFrames),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_SampleRateConverter::ProcessRT: Wrong number of input frames");
+
+    // Append the input to the history, splitting it into channels.
+    for(UInt32 theChannel = 0; theChannel < mChannelsPerFrame; theChannel++)
+    {
+        Float32* theHistory = &mHistory[static_cast<size_t>(theChannel) * mHistoryCapacityFrames + mHistoryFrames];
+
+        for(UInt32 i = 0; i < inInputFrames; i++)
+        {
+            theHistory[i] = inInput[i * mChannelsPerFrame + theChannel];
+        }
+    }
+
+    mHistoryFrames += inInputFrames;
+
+    for(UInt32 theOutputFrame = 0; theOutputFrame < inOutputFrames; theOutputFrame++)
+    {
+        // Calculated from the start each time, rather than by adding mStep, to match
+        // GetInputFramesNeeded.
+        const Float64 thePosition = mPosition + theOutputFrame * mStep;
+        const UInt32 theFirstTap = static_cast<UInt32>(thePosition);
+
+        InterpolateCoefficients(thePosition - theFirstTap);
+
+        for(UInt32 theChannel = 0; theChannel < mChannelsPerFrame; theChannel++)
+        {
+            const Float32* theHistory = &mHistory[static_cast<size_t>(theChannel) * mHistoryCapacityFrames + theFirstTap];
+
+            outOutput[theOutputFrame * mChannelsPerFrame + theChannel] =
+                EFF_AudioKernels::DotProduct(theHistory, mCoefficients.data(), mTaps);
+        }
+    }
+
+    // Drop the input frames the next output frame won't use.
+    mPosition += inOutputFrames * mStep;
+
+    const UInt32 theFramesUsed = std::min(static_cast<UInt32>(mPosition), mHistoryFrames);
+
+    if(theFramesUsed > 0)
+    {
+        for(UInt32 theChannel = 0; theChannel < mChannelsPerFrame; theChannel++)
+        {
+            Float32* theHistory = &mHistory[static_cast<size_t>(theChannel) * mHistoryCapacityFrames];
+            memmove(theHistory, theHistory + theFramesUsed, (mHistoryFrames - theFramesUsed) * sizeof(Float32));
+        }
+
+        mHistoryFrames -= theFramesUsed;
+        mPosition -= theFramesUsed;
+    }
+}
+
+void    EFF_SampleRateConverter::InterpolateCoefficients(Float64 inFraction)
+{
+    const Float64 thePhase = inFraction * mPhases;
+    const UInt32 thePhaseIndex = std::min(static_cast<UInt32>(thePhase), mPhases - 1);
+    const Float32 theMix = static_cast<Float32>(thePhase - thePhaseIndex);
+
+    const Float32* theRow = &mFilterTable[static_cast<size_t>(thePhaseIndex) * mTaps];
+    const Float32* theNextRow = theRow + mTaps;
+    Float32* theCoefficients = mCoefficients.data();
+
+    // Simple enough for the compiler to vectorise.
+    for(UInt32 theTap = 0; theTap < mTaps; theTap++)
+    {
+        theCoefficients[theTap] = theRow[theTap] + theMix * (theNextRow[theTap] - theRow[theTap]);
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,156 @@
+//
+//  EFF_SampleRateConverter.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A streaming sample rate converter for interleaved Float32 audio. It uses a Kaiser-windowed sinc
+//  filter stored as a polyphase table, and interpolates linearly between the two nearest phases
+//  for each output frame, so it works for any ratio rather than just ones with small integer
+//  terms.
+//
+//  The converter is pulled from the output side. The caller asks GetInputFramesNeeded how many
+//  input frames it needs to produce the output frames it wants and then passes exactly that many
+//  to ProcessRT. That way a consumer running at a different rate to EFF_LoopbackRingBuffer can
+//  fetch just the frames it needs from it each cycle.
+//
+//  The conversion ratio can also be adjusted slightly while it runs, e.g. to make up for the
+//  difference between two devices' clocks, without any discontinuity in the output.
+//
+//  Allocate and Deallocate aren't real-time safe and must not be called while ProcessRT is
+//  running. The other methods are real-time safe and never allocate. Not thread safe.
+//
+
+#ifndef EFF_SampleRateConverter_h
+#define EFF_SampleRateConverter_h
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_SampleRateConverter
+{
+
+public:
+    // Higher qualities use longer filters with sharper cutoffs and more attenuation above them,
+    // which costs more CPU time and adds more latency.
+    enum Quality : UInt32
+    {
+        kQualityLow         = 0,
+        kQualityMedium      = 1,
+        kQualityHigh        = 2
+    };
+
+#pragma mark Construction/Destruction
+
+                                EFF_SampleRateConverter() = default;
+                                // Disallow copying
+                                EFF_SampleRateConverter(const EFF_SampleRateConverter&) = delete;
+                                EFF_SampleRateConverter& operator=(const EFF_SampleRateConverter&) = delete;
+
+    /*!
+     Generate the filter, allocate the buffers and Reset. Not real-time safe.
+
+     @param inChannelsPerFrame The number of interleaved samples in each frame.
+     @param inMaxOutputFrames The most frames ProcessRT will be asked for at once.
+     @param inMaxRateAdjustment The largest adjustment SetRateAdjustmentRT will be able to make.
+     @throws CAException If either sample rate isn't positive, there are no channels or
+                         inMaxRateAdjustment isn't in [0, 1).
+     */
+    void                        Allocate(UInt32 inChannelsPerFrame,
+                                         Float64 inInputSampleRate,
+                                         Float64 inOutputSampleRate,
+                                         Quality inQuality,
+                                         UInt32 inMaxOutputFrames,
+                                         Float64 inMaxRateAdjustment = 0.0);
+    void                        Deallocate();
+
+    /*! Forget the input so far, as if it had been silent. Real-time safe. */
+    void                        Reset();
+
+#pragma mark Conversion
+
+    /*!
+     Consume input frames (1 + inAdjustment) times as fast as the sample rates passed to Allocate
+     would, starting from the next output frame. Clamped to the maximum passed to Allocate. Doesn't
+     change the filter, so it's only meant for adjustments small enough not to matter to it.
+
+     Real-time safe.
+     */
+    void                        SetRateAdjustmentRT(Float64 inAdjustment);
+    Float64                     GetRateAdjustment() const { return mStep / mNominalStep - 1.0; }
+
+    /*! The number of input frames ProcessRT needs to produce inOutputFrames output frames. */
+    UInt32                      GetInputFramesNeeded(UInt32 inOutputFrames) const;
+
+    /*!
+     Convert inInputFrames frames from inInput into inOutputFrames frames in outOutput. The input
+     frames are appended to the ones from previous calls.
+
+     Real-time safe.
+
+     @param inInputFrames Must be GetInputFramesNeeded(inOutputFrames).
+     @throws CAException If inInputFrames is wrong or inOutputFrames is more than the maximum
+                         passed to Allocate.
+     */
+    void                        ProcessRT(const Float32* inInput,
+                                          UInt32 inInputFrames,
+                                          Float32* outOutput,
+                                          UInt32 inOutputFrames);
+
+    /*!
+     The number of input frames the converter has to read ahead of each output frame. Output frame
+     n corresponds to input frame n * input rate / output rate, but can't be produced until the
+     input up to that frame plus this many has been passed in.
+     */
+    UInt32                      GetLatencyFrames() const { return mTaps / 2; }
+
+    UInt32                      GetChannelsPerFrame() const { return mChannelsPerFrame; }
+
+#pragma mark Implementation
+
+private:
+    void                        GenerateFilterTable(Float64 inCutoff, Float64 inKaiserBeta);
+
+    // Fills mCoefficients with the filter for an output frame that's inFraction of the way between
+    // two input frames.
+    void                        InterpolateCoefficients(Float64 inFraction);
+
+    UInt32                      mChannelsPerFrame       = 0;
+    UInt32                      mMaxOutputFrames        = 0;
+
+    // The length of the filter, in input frames. Always even.
+    UInt32                      mTaps                   = 0;
+    // The number of fractional positions between input frames that the table has a filter for.
+    UInt32                      mPhases                 = 0;
+    // The number of input frames per output frame, including the rate adjustment.
+    Float64                     mStep                   = 1.0;
+    Float64                     mNominalStep            = 1.0;
+    Float64                     mMaxRateAdjustment      = 0.0;
+
+    // mPhases + 1 rows of mTaps coefficients. Row p is the filter for an output frame p / mPhases
+    // of the way between two input frames, so the last row is for the next input frame.
+    std::vector<Float32>        mFilterTable;
+    // The filter for the output frame being produced.
+    std::vector<Float32>        mCoefficients;
+
+    // The input frames that are still needed, with each channel stored separately so the filter
+    // can be applied to contiguous samples. Channel c starts at c * mHistoryCapacityFrames.
+    std::vector<Float32>        mHistory;
+    UInt32                      mHistoryCapacityFrames  = 0;
+    UInt32                      mHistoryFrames          = 0;
+    // The position of the next output frame's first filter tap in mHistory, in input frames. The
+    // frames before it are dropped after each call, so it's always less than 1 between calls.
+    Float64                     mPosition               = 0.0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_SampleRateConverter_h */
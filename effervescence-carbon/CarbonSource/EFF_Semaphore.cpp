@@ -0,0 +1,117 @@
+//
+//  EFF_Semaphore.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_Semaphore.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#if defined(__APPLE__)
+#include <mach/mach_init.h>
+#include <mach/task.h>
+#else
+#include <errno.h>
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+#if defined(__APPLE__)
+
+EFF_Semaphore::EFF_Semaphore()
+{
+    kern_return_t theError = semaphore_create(mach_task_self(), &mSemaphore, SYNC_POLICY_FIFO, 0);
+    EFF_Utils::ThrowIfMachError("EFF_Semaphore::EFF_Semaphore", "semaphore_create", theError);
+
+    ThrowIf(mSemaphore == SEMAPHORE_NULL,
+            CAException(kAudioHardwareUnspecifiedError),
+            "EFF_Semaphore::EFF_Semaphore: Could not create semaphore");
+}
+
+EFF_Semaphore::~EFF_Semaphore()
+{
+    kern_return_t theError = semaphore_destroy(mach_task_self(), mSemaphore);
+    EFF_Utils::LogIfMachError("EFF_Semaphore::~EFF_Semaphore", "semaphore_destroy", theError);
+}
+
+void    EFF_Semaphore::Signal()
+{
+    // Note that semaphore_signal has an implicit barrier.
+    kern_return_t theError = semaphore_signal(mSemaphore);
+    EFF_Utils::ThrowIfMachError("EFF_Semaphore::Signal", "semaphore_signal", theError);
+}
+
+void    EFF_Semaphore::Wait()
+{
+    kern_return_t theError;
+
+    // semaphore_wait can return early if the thread is interrupted, so keep waiting until it's
+    // actually signalled.
+    do
+    {
+        theError = semaphore_wait(mSemaphore);
+    }
+    while(theError == KERN_ABORTED);
+
+    EFF_Utils::ThrowIfMachError("EFF_Semaphore::Wait", "semaphore_wait", theError);
+}
+
+#else
+
+EFF_Semaphore::EFF_Semaphore()
+{
+    int theError = sem_init(&mSemaphore, /* pshared = */ 0, /* value = */ 0);
+
+    ThrowIf(theError != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "EFF_Semaphore::EFF_Semaphore: Could not create semaphore");
+}
+
+EFF_Semaphore::~EFF_Semaphore()
+{
+    if(sem_destroy(&mSemaphore) != 0)
+    {
+        LogError("EFF_Semaphore::~EFF_Semaphore: sem_destroy failed. errno=%d", errno);
+    }
+}
+
+void    EFF_Semaphore::Signal()
+{
+    // sem_post is async-signal safe and only makes a syscall if a thread is waiting.
+    int theError = sem_post(&mSemaphore);
+
+    ThrowIf(theError != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "EFF_Semaphore::Signal: sem_post failed");
+}
+
+void    EFF_Semaphore::Wait()
+{
+    int theError;
+
+    // Like semaphore_wait, sem_wait can return early if the thread is interrupted.
+    do
+    {
+        theError = sem_wait(&mSemaphore);
+    }
+    while(theError != 0 && errno == EINTR);
+
+    ThrowIf(theError != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "EFF_Semaphore::Wait: sem_wait failed");
+}
+
+#endif /* defined(__APPLE__) */
+
+#pragma clang assume_nonnull end
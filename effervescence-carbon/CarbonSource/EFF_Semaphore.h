@@ -0,0 +1,59 @@
+//
+//  EFF_Semaphore.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A counting semaphore. EFF_TaskQueue uses these rather than Mach semaphores directly so the
+//  queueing logic doesn't depend on which kernel primitive is underneath.
+//
+//  On macOS, it's a Mach semaphore. Elsewhere (so far only when building the tests) it's an
+//  unnamed POSIX semaphore, which macOS doesn't support.
+//
+//  Signal is real-time safe. Signals are never lost: if Signal is called before Wait, Wait
+//  returns immediately.
+//
+
+#ifndef EFF_Semaphore_h
+#define EFF_Semaphore_h
+
+// System Includes
+#if defined(__APPLE__)
+#include <mach/semaphore.h>
+#else
+#include <semaphore.h>
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_Semaphore
+{
+
+public:
+    /*! @throws CAException if the semaphore couldn't be created. */
+                                EFF_Semaphore();
+                                ~EFF_Semaphore();
+                                // Disallow copying
+                                EFF_Semaphore(const EFF_Semaphore&) = delete;
+                                EFF_Semaphore& operator=(const EFF_Semaphore&) = delete;
+
+    /*! Wake one waiting thread, or the next thread to wait. Real-time safe. */
+    void                        Signal();
+
+    /*! Block until the semaphore is signalled. */
+    void                        Wait();
+
+private:
+#if defined(__APPLE__)
+    semaphore_t                 mSemaphore;
+#else
+    sem_t                       mSemaphore;
+#endif
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_Semaphore_h */
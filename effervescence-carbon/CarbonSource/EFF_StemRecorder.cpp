@@ -0,0 +1,563 @@
+//
+//  EFF_StemRecorder.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_StemRecorder.h"
+
+// Local Includes
+#include "EFF_Client.h"
+#include "EFF_Clients.h"
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CADebugMacros.h"
+#include "CAException.h"
+#include "CAPThread.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+EFF_StemRecorder::EFF_StemRecorder()
+{
+}
+
+EFF_StemRecorder::~EFF_StemRecorder()
+{
+    EFFLogAndSwallowExceptions("EFF_StemRecorder::~EFF_StemRecorder", [&] {
+        CAMutex::Locker theStateLocker(mStateMutex);
+
+        Stop();
+
+        if(mWriterThreadStarted)
+        {
+            SendWriterCommand(kWriterCommandExit);
+            mWriterThreadStarted = false;
+        }
+    });
+}
+
+#pragma mark Recording
+
+void    EFF_StemRecorder::Start(CFStringRef inPath,
+                                EFFRecordingFileFormat inFileFormat,
+                                EFFRecordingSampleFormat inSampleFormat,
+                                UInt32 inTrackCount,
+                                UInt32 inChannelsPerFrame,
+                                Float64 inSampleRate)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    Stop();
+
+    char thePath[PATH_MAX];
+    ThrowIf(!CFStringGetFileSystemRepresentation(inPath, thePath, sizeof(thePath)),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_StemRecorder::Start: Invalid path");
+    ThrowIf((inTrackCount == 0) || (inTrackCount > kMaxTracks),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_StemRecorder::Start: Invalid track count");
+    ThrowIf((inChannelsPerFrame == 0) || (inSampleRate < 1.0),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "EFF_StemRecorder::Start: Unsupported format");
+
+    DebugMsg("EFF_StemRecorder::Start: Recording %u tracks to %s", inTrackCount, thePath);
+
+    if(!mWriterThreadStarted)
+    {
+        // The writer thread's CAPThread deletes itself when the thread exits. CAPThread::Entry
+        // still uses it after WriterThreadProc returns, which can be after we've been destroyed.
+        std::unique_ptr<CAPThread> theWriterThread =
+                std::make_unique<CAPThread>(&EFF_StemRecorder::WriterThreadProc,
+                                            this,
+                                            CAPThread::kDefaultThreadPriority,
+                                            /* inFixedPriority = */ false,
+                                            /* inAutoDelete = */ true);
+        theWriterThread->Start();
+        theWriterThread.release();
+        mWriterThreadStarted = true;
+    }
+
+    // Allocate the ring buffers before creating the file, so the file isn't left behind if this
+    // fails. Nothing else is using them while nothing is being recorded. Free the ones this
+    // recording won't use, in case the last one had more tracks.
+    const UInt32 theRingFrames = static_cast<UInt32>(std::min<Float64>(std::ceil(kBufferSeconds * inSampleRate),
+                                                                       1 << 30));
+
+    for(UInt32 i = 0; i < kMaxTracks; i++)
+    {
+        if(i < inTrackCount)
+        {
+            mTracks[i].mRing.Allocate(inChannelsPerFrame, theRingFrames);
+        }
+        else
+        {
+            mTracks[i].mRing.Deallocate();
+        }
+
+        mTracks[i].mClientID = 0;
+        mTrackIdentities[i] = TrackIdentity();
+    }
+
+    mRingCapacityFrames = mTracks[0].mRing.GetCapacityFrames();
+    mWakeFrames = std::max<SInt64>(mRingCapacityFrames / kWakeFraction, 1);
+
+    mTrackBuffer.assign(kWriteFrames * inChannelsPerFrame, 0.0f);
+    mFileBuffer.assign(kWriteFrames * inChannelsPerFrame * inTrackCount, 0.0f);
+
+    mAssignedTracks.store(0, std::memory_order_relaxed);
+    mHasCycle = false;
+    mCycleSampleTime = 0;
+    mCycleFrames = 0;
+    mCycleRecordingTime = 0;
+    mCompleteTime.store(0, std::memory_order_relaxed);
+    mWriteTime.store(0, std::memory_order_relaxed);
+
+    // Throws if the file can't be created.
+    mFile.Open(thePath, inFileFormat, inSampleFormat, inTrackCount * inChannelsPerFrame, inSampleRate);
+    mFileFailed = false;
+
+    mPath = inPath;
+    mFileFormat = inFileFormat;
+    mSampleFormat = inSampleFormat;
+    mTrackCount = inTrackCount;
+    mChannelsPerFrame = inChannelsPerFrame;
+
+    mFramesWritten.store(0, std::memory_order_relaxed);
+    mBytesWritten.store(0, std::memory_order_relaxed);
+    mDroppedBlocks.store(0, std::memory_order_relaxed);
+    mDroppedFrames.store(0, std::memory_order_relaxed);
+    mUntrackedBuffers.store(0, std::memory_order_relaxed);
+    mError.store(0, std::memory_order_relaxed);
+
+    // Have the writer thread start watching the ring buffers before the IO thread starts filling
+    // them.
+    SendWriterCommand(kWriterCommandBegin);
+
+    mIsRecording.store(true, std::memory_order_seq_cst);
+}
+
+void    EFF_StemRecorder::Stop()
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(!mIsRecording.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    DebugMsg("EFF_StemRecorder::Stop: Stopping");
+
+    // Stop the IO thread using the ring buffers. See EFF_MixRecorder::Stop.
+    mIsRecording.store(false, std::memory_order_seq_cst);
+
+    while(mIOThreadIsCapturing.load(std::memory_order_seq_cst))
+    {
+        usleep(100);
+    }
+
+    // Then have the writer write whatever's left and close the file.
+    SendWriterCommand(kWriterCommandFinish);
+}
+
+bool    EFF_StemRecorder::IsRecording()
+const
+{
+    return mIsRecording.load(std::memory_order_relaxed);
+}
+
+void    EFF_StemRecorder::CaptureClientRT(UInt32 inClientID,
+                                          const Float32* inBuffer,
+                                          UInt32 inFrames,
+                                          Float64 inSampleTime)
+{
+    // Nothing is being recorded most of the time, so check that first without a fence.
+    if(!mIsRecording.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // See Stop.
+    mIOThreadIsCapturing.store(true, std::memory_order_seq_cst);
+
+    if(mIsRecording.load(std::memory_order_seq_cst))
+    {
+        BeginCycleRT(inFrames, static_cast<SampleTime>(inSampleTime));
+
+        Track* theTrack = GetClientTrackRT(inClientID);
+
+        if(theTrack)
+        {
+            // The ring buffer fills any cycles the client missed with silence.
+            theTrack->mRing.Store(inBuffer, inFrames, mCycleRecordingTime);
+        }
+        else
+        {
+            mUntrackedBuffers.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    mIOThreadIsCapturing.store(false, std::memory_order_release);
+}
+
+void    EFF_StemRecorder::EndCycleRT(UInt32 inFrames, Float64 inSampleTime)
+{
+    if(!mIsRecording.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    mIOThreadIsCapturing.store(true, std::memory_order_seq_cst);
+
+    if(mIsRecording.load(std::memory_order_seq_cst))
+    {
+        BeginCycleRT(inFrames, static_cast<SampleTime>(inSampleTime));
+
+        // Release the cycle's frames on every track to the writer thread.
+        mCompleteTime.store(mCycleRecordingTime + mCycleFrames, std::memory_order_release);
+
+        // Wake the writer if there's enough for a large write and it's waiting. This fence pairs
+        // with the one in WriterThreadLoop, so one of the threads always sees the other's store.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if((GetQueuedFrames() >= mWakeFrames) &&
+           mWriterIsWaiting.load(std::memory_order_relaxed) &&
+           mWriterIsWaiting.exchange(false, std::memory_order_acq_rel))
+        {
+            mWakeSemaphore.Signal();
+        }
+    }
+
+    mIOThreadIsCapturing.store(false, std::memory_order_release);
+}
+
+#pragma mark Status
+
+void    EFF_StemRecorder::IdentifyTrackClients(const EFF_Clients& inClients)
+const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    const UInt32 theAssignedTracks = std::min(mAssignedTracks.load(std::memory_order_acquire), mTrackCount);
+
+    for(UInt32 i = 0; i < theAssignedTracks; i++)
+    {
+        TrackIdentity& theIdentity = mTrackIdentities[i];
+        EFF_Client theClient;
+
+        if(!theIdentity.mIdentified && inClients.GetClientNonRT(mTracks[i].mClientID, &theClient))
+        {
+            theIdentity.mIdentified = true;
+            theIdentity.mProcessID = theClient.mProcessID;
+            theIdentity.mBundleID = theClient.GetBundleID();
+        }
+    }
+}
+
+CFDictionaryRef EFF_StemRecorder::CopyStatusAsDictionary()
+const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    CACFDictionary theStatus(false);
+    const bool theIsRecording = IsRecording();
+
+    theStatus.AddBool(CFSTR(kEFFRecordingKey_IsRecording), theIsRecording);
+
+    if(theIsRecording)
+    {
+        theStatus.AddString(CFSTR(kEFFRecordingKey_Path), mPath.GetCFString());
+        theStatus.AddSInt32(CFSTR(kEFFRecordingKey_FileFormat), mFileFormat);
+        theStatus.AddSInt32(CFSTR(kEFFRecordingKey_SampleFormat), mSampleFormat);
+        theStatus.AddSInt32(CFSTR(kEFFStemRecordingKey_TrackCount), static_cast<SInt32>(mTrackCount));
+    }
+
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_FramesWritten), mFramesWritten.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_BytesWritten), mBytesWritten.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_DroppedBlocks), mDroppedBlocks.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFRecordingKey_DroppedFrames), mDroppedFrames.load(std::memory_order_relaxed));
+    theStatus.AddUInt64(CFSTR(kEFFStemRecordingKey_UntrackedBuffers),
+                        mUntrackedBuffers.load(std::memory_order_relaxed));
+    theStatus.AddSInt32(CFSTR(kEFFRecordingKey_Error), mError.load(std::memory_order_relaxed));
+
+    // Describe the clients that have been given tracks.
+    CACFArray theTracks(true);
+    const UInt32 theAssignedTracks = std::min(mAssignedTracks.load(std::memory_order_acquire), mTrackCount);
+
+    for(UInt32 i = 0; i < theAssignedTracks; i++)
+    {
+        const TrackIdentity& theIdentity = mTrackIdentities[i];
+        CACFDictionary theTrack(true);
+
+        theTrack.AddSInt32(CFSTR(kEFFStemTrackKey_Index), static_cast<SInt32>(i));
+
+        if(theIdentity.mIdentified)
+        {
+            theTrack.AddSInt32(CFSTR(kEFFStemTrackKey_ProcessID), theIdentity.mProcessID);
+
+            if(theIdentity.mBundleID.IsValid())
+            {
+                theTrack.AddString(CFSTR(kEFFStemTrackKey_BundleID), theIdentity.mBundleID.GetCFString());
+            }
+        }
+
+        theTracks.AppendDictionary(theTrack.GetDict());
+    }
+
+    theStatus.AddArray(CFSTR(kEFFStemRecordingKey_Tracks), theTracks.GetCFArray());
+
+    return theStatus.GetDict();
+}
+
+#pragma mark Implementation
+
+void    EFF_StemRecorder::BeginCycleRT(UInt32 inFrames, SampleTime inSampleTime)
+{
+    if(mHasCycle && (inSampleTime == mCycleSampleTime))
+    {
+        // Already started by an earlier call in the same cycle.
+        return;
+    }
+
+    // Each cycle starts where the last one ended in the recording, whether or not it follows on
+    // from it in sample time. That leaves out the gaps while IO was stopped, and keeps the
+    // recording's time going forward even if the sample times jump backwards.
+    mCycleRecordingTime = mHasCycle ? (mCycleRecordingTime + mCycleFrames) : 0;
+    mCycleSampleTime = inSampleTime;
+    mCycleFrames = inFrames;
+    mHasCycle = true;
+}
+
+EFF_StemRecorder::Track* __nullable EFF_StemRecorder::GetClientTrackRT(UInt32 inClientID)
+{
+    // Only the IO thread writes mAssignedTracks, so it doesn't need to synchronise to read it.
+    const UInt32 theAssignedTracks = mAssignedTracks.load(std::memory_order_relaxed);
+
+    // There are at most kMaxTracks, so a linear search is fine.
+    for(UInt32 i = 0; i < theAssignedTracks; i++)
+    {
+        if(mTracks[i].mClientID == inClientID)
+        {
+            return &mTracks[i];
+        }
+    }
+
+    if(theAssignedTracks < mTrackCount)
+    {
+        Track& theTrack = mTracks[theAssignedTracks];
+        theTrack.mClientID = inClientID;
+        mAssignedTracks.store(theAssignedTracks + 1, std::memory_order_release);
+        return &theTrack;
+    }
+
+    return nullptr;
+}
+
+SInt64  EFF_StemRecorder::GetQueuedFrames()
+const
+{
+    return mCompleteTime.load(std::memory_order_acquire) - mWriteTime.load(std::memory_order_acquire);
+}
+
+//static
+void* __nullable    EFF_StemRecorder::WriterThreadProc(void* inRefCon)
+{
+    DebugMsg("EFF_StemRecorder::WriterThreadProc: The writer thread has started");
+
+    static_cast<EFF_StemRecorder*>(inRefCon)->WriterThreadLoop();
+
+    return NULL;
+}
+
+void    EFF_StemRecorder::WriterThreadLoop()
+{
+    // Only true between the Begin and Finish commands. The ring buffers are only read while it's
+    // true, so Start can reallocate them while it's false.
+    bool theIsRecording = false;
+
+    while(true)
+    {
+        bool theShouldWait = true;
+
+        if(theIsRecording)
+        {
+            mWriterIsWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // See EFF_MixRecorder::WriterThreadLoop.
+            if((GetQueuedFrames() >= mWakeFrames) &&
+               mWriterIsWaiting.exchange(false, std::memory_order_acq_rel))
+            {
+                theShouldWait = false;
+            }
+        }
+
+        if(theShouldWait)
+        {
+            mWakeSemaphore.Wait();
+        }
+
+        switch(mWriterCommand.exchange(kWriterCommandNone, std::memory_order_acq_rel))
+        {
+            case kWriterCommandBegin:
+                theIsRecording = true;
+                mCommandDoneSemaphore.Signal();
+                break;
+
+            case kWriterCommandFinish:
+                // Stop has made sure the IO thread is done, so this writes everything up to the
+                // end of the last complete cycle. The rest of an incomplete cycle is left out.
+                WriteCompleteCycles();
+
+                try
+                {
+                    mFile.Close();
+                }
+                catch(const CAException& e)
+                {
+                    mError.store(e.GetError(), std::memory_order_relaxed);
+                }
+
+                mFramesWritten.store(mFile.GetFramesWritten(), std::memory_order_relaxed);
+                mBytesWritten.store(mFile.GetBytesWritten(), std::memory_order_relaxed);
+
+                DebugMsg("EFF_StemRecorder::WriterThreadLoop: Finished recording. frames=%llu droppedFrames=%llu",
+                         mFramesWritten.load(std::memory_order_relaxed),
+                         mDroppedFrames.load(std::memory_order_relaxed));
+
+                theIsRecording = false;
+                mWriterIsWaiting.store(false, std::memory_order_relaxed);
+                mCommandDoneSemaphore.Signal();
+                break;
+
+            case kWriterCommandExit:
+                mCommandDoneSemaphore.Signal();
+                return;
+
+            case kWriterCommandNone:
+            default:
+                // Woken by the IO thread. (Or a leftover signal, which is harmless.)
+                if(theIsRecording)
+                {
+                    WriteCompleteCycles();
+                }
+                break;
+        }
+    }
+}
+
+void    EFF_StemRecorder::WriteCompleteCycles()
+{
+    const UInt32 theFileChannels = mTrackCount * mChannelsPerFrame;
+    SampleTime theWriteTime = mWriteTime.load(std::memory_order_relaxed);
+    SampleTime theCompleteTime;
+
+    // Keep going until we've caught up, including any cycles completed while writing.
+    while(theWriteTime < (theCompleteTime = mCompleteTime.load(std::memory_order_acquire)))
+    {
+        // The IO thread can be up to a cycle past mCompleteTime, so anything older than about the
+        // ring buffers' capacity before it might have been overwritten. Write those frames as
+        // silence on every track. (Fetch would also return silence for them, but wouldn't tell us
+        // they were lost rather than just silent.) mWakeFrames is much longer than an IO cycle.
+        const SampleTime theOldestSafeTime = theCompleteTime - mRingCapacityFrames + mWakeFrames;
+
+        if(theWriteTime < theOldestSafeTime)
+        {
+            const UInt64 theLostFrames = static_cast<UInt64>(theOldestSafeTime - theWriteTime);
+
+            LogWarning("EFF_StemRecorder::WriteCompleteCycles: Fell behind. Dropping %llu frames",
+                       theLostFrames);
+            mDroppedBlocks.fetch_add(1, std::memory_order_relaxed);
+            mDroppedFrames.fetch_add(theLostFrames, std::memory_order_relaxed);
+
+            if(!mFileFailed)
+            {
+                try
+                {
+                    mFile.WriteSilence(theLostFrames);
+                }
+                catch(const CAException& e)
+                {
+                    LogError("EFF_StemRecorder::WriteCompleteCycles: Stopped writing after an error: %d",
+                             static_cast<int>(e.GetError()));
+                    mError.store(e.GetError(), std::memory_order_relaxed);
+                    mFileFailed = true;
+                }
+            }
+
+            theWriteTime = theOldestSafeTime;
+            mWriteTime.store(theWriteTime, std::memory_order_release);
+            continue;
+        }
+
+        const UInt32 theFrames = static_cast<UInt32>(std::min<SampleTime>(theCompleteTime - theWriteTime,
+                                                                          kWriteFrames));
+
+        // After an error, keep reading so the lost frames aren't counted, but don't write any more.
+        if(!mFileFailed)
+        {
+            // Read the same frames from each track and interleave them into the file's frames.
+            for(UInt32 theTrack = 0; theTrack < mTrackCount; theTrack++)
+            {
+                mTracks[theTrack].mRing.Fetch(mTrackBuffer.data(), theFrames, theWriteTime);
+
+                const Float32* theSource = mTrackBuffer.data();
+                Float32* theDestination = mFileBuffer.data() + theTrack * mChannelsPerFrame;
+
+                for(UInt32 theFrame = 0; theFrame < theFrames; theFrame++)
+                {
+                    memcpy(theDestination, theSource, mChannelsPerFrame * sizeof(Float32));
+                    theSource += mChannelsPerFrame;
+                    theDestination += theFileChannels;
+                }
+            }
+
+            try
+            {
+                mFile.WriteFrames(mFileBuffer.data(), theFrames);
+            }
+            catch(const CAException& e)
+            {
+                LogError("EFF_StemRecorder::WriteCompleteCycles: Stopped writing after an error: %d",
+                         static_cast<int>(e.GetError()));
+                mError.store(e.GetError(), std::memory_order_relaxed);
+                mFileFailed = true;
+            }
+        }
+
+        theWriteTime += theFrames;
+        mWriteTime.store(theWriteTime, std::memory_order_release);
+    }
+
+    mFramesWritten.store(mFile.GetFramesWritten(), std::memory_order_relaxed);
+    mBytesWritten.store(mFile.GetBytesWritten(), std::memory_order_relaxed);
+}
+
+void    EFF_StemRecorder::SendWriterCommand(WriterCommand inCommand)
+{
+    mWriterCommand.store(inCommand, std::memory_order_seq_cst);
+    mWakeSemaphore.Signal();
+    mCommandDoneSemaphore.Wait();
+}
+
+#pragma clang assume_nonnull end
+
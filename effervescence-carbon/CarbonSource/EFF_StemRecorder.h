@@ -0,0 +1,263 @@
+//
+//  EFF_StemRecorder.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Records each client's audio to its own track (stem) of a single multi-channel file. See
+//  kAudioDeviceCustomPropertyStemRecording.
+//
+//  Each track is a group of adjacent channels in the file, one channel per channel of EFFDevice's
+//  stream. Clients are given tracks in the order they first play audio while recording, and keep
+//  them until the recording stops. Clients that start after all the tracks are taken aren't
+//  recorded.
+//
+//  In ProcessOutput, CaptureClientRT copies the client's audio into its track's ring buffer,
+//  stamped with the IO cycle's position in the recording. Each track's ring buffer only has one
+//  writer (the IO thread) and one reader (the writer thread), so this is wait-free no matter how
+//  many clients there are. WriteMix then calls EndCycleRT to tell the writer thread the cycle is
+//  complete. The writer thread reads the same range of sample times from every track, so the
+//  tracks stay aligned, and interleaves them into the file with EFF_CaptureFileWriter. A client
+//  that didn't play during part of that range has silence on its track for that part.
+//
+//  The position in the recording is the IO cycle's sample time, except that gaps in the sample
+//  times, e.g. while IO is stopped, are left out. So, like EFF_MixRecorder, nothing is recorded
+//  while IO isn't running.
+//
+//  If the writer thread falls so far behind that the IO thread overwrites audio it hasn't written
+//  yet, the overwritten frames are written as silence on every track and counted for
+//  kEFFRecordingKey_DroppedFrames.
+//
+//  CaptureClientRT and EndCycleRT are real-time safe and must only be called from one thread at a
+//  time. The other methods aren't real-time safe, but can be called from any thread.
+//
+
+#ifndef EFF_StemRecorder_h
+#define EFF_StemRecorder_h
+
+// Local Includes
+#include "EFF_CaptureFileWriter.h"
+#include "EFF_LoopbackRingBuffer.h"
+#include "EFF_Semaphore.h"
+#include "EFF_Types.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAMutex.h"
+
+// STL Includes
+#include <atomic>
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+#include <MacTypes.h>
+#include <sys/types.h>
+
+
+// Forward Declarations
+class EFF_Clients;
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_StemRecorder
+{
+
+public:
+    typedef EFF_LoopbackRingBuffer::SampleTime SampleTime;
+
+    // The most tracks a recording can have. See kEFFStemRecordingKey_TrackCount.
+    static const UInt32         kMaxTracks = kEFFStemRecordingMaxTracks;
+    // How much audio each track's ring buffer can hold, which is how long the writer can stall
+    // without losing any.
+    static constexpr Float64    kBufferSeconds = 2.0;
+    // The fraction of the ring buffers that has to be full before the IO thread wakes the writer.
+    static const UInt32         kWakeFraction = 8;
+    // The number of frames the writer reads from each track at a time.
+    static const UInt32         kWriteFrames = 1024;
+
+#pragma mark Construction/Destruction
+
+                                EFF_StemRecorder();
+                                ~EFF_StemRecorder();
+                                // Disallow copying
+                                EFF_StemRecorder(const EFF_StemRecorder&) = delete;
+                                EFF_StemRecorder& operator=(const EFF_StemRecorder&) = delete;
+
+#pragma mark Recording
+
+    /*!
+     Create the file and start recording to it, after stopping the recording in progress, if there
+     is one. Resets the counts.
+
+     @param inPath The file's path. Kept for the status dictionary.
+     @param inTrackCount The number of tracks in the file. Between 1 and kMaxTracks.
+     @param inChannelsPerFrame The number of channels in each track.
+     @throws CAException If the file can't be created. See EFF_CaptureFileWriter::Open.
+     */
+    void                        Start(CFStringRef inPath,
+                                      EFFRecordingFileFormat inFileFormat,
+                                      EFFRecordingSampleFormat inSampleFormat,
+                                      UInt32 inTrackCount,
+                                      UInt32 inChannelsPerFrame,
+                                      Float64 inSampleRate);
+    /*!
+     Stop recording, write out the audio still in the ring buffers and close the file. Blocks until
+     the file is closed. Does nothing if nothing is being recorded.
+     */
+    void                        Stop();
+
+    bool                        IsRecording() const;
+
+    /*!
+     Queue one client's audio for the current IO cycle to be written to its track. Does nothing if
+     nothing is being recorded. Real-time safe.
+
+     @param inClientID The client the audio is from.
+     @param inBuffer Interleaved, with the number of channels passed to Start.
+     @param inFrames The size of the IO cycle's buffer.
+     @param inSampleTime The IO cycle's output sample time.
+     */
+    void                        CaptureClientRT(UInt32 inClientID,
+                                                const Float32* inBuffer,
+                                                UInt32 inFrames,
+                                                Float64 inSampleTime);
+    /*!
+     Mark the IO cycle as complete, so the writer thread can write it. Call it after the last
+     CaptureClientRT call for the cycle. Does nothing if nothing is being recorded. Real-time safe.
+     */
+    void                        EndCycleRT(UInt32 inFrames, Float64 inSampleTime);
+
+#pragma mark Status
+
+    /*!
+     Look up the process and bundle ID of each client that's been given a track and hasn't been
+     looked up yet, so they can be included in the status dictionary. Call it before a client is
+     removed from inClients, so its track can still be identified after it's gone.
+     */
+    void                        IdentifyTrackClients(const EFF_Clients& inClients) const;
+
+    /*!
+     @return A new CFDictionary with the kAudioDeviceCustomPropertyStemRecording keys for the
+             current or most recent recording. The caller is responsible for releasing it.
+     */
+    CFDictionaryRef             CopyStatusAsDictionary() const;
+
+#pragma mark Implementation
+
+private:
+    struct Track
+    {
+        EFF_LoopbackRingBuffer  mRing;
+        // The client the track was given to. Written by the IO thread before it publishes the track
+        // by incrementing mAssignedTracks.
+        UInt32                  mClientID               = 0;
+    };
+
+    // Set by IdentifyTrackClients. Guarded by mStateMutex.
+    struct TrackIdentity
+    {
+        bool                    mIdentified             = false;
+        pid_t                   mProcessID              = -1;
+        CACFString              mBundleID;
+    };
+
+    enum WriterCommand : UInt32
+    {
+        kWriterCommandNone,
+        // Start reading the ring buffers.
+        kWriterCommandBegin,
+        // Write the rest of the ring buffers and close the file.
+        kWriterCommandFinish,
+        // Return from the writer thread.
+        kWriterCommandExit
+    };
+
+    // Called at the start of each IO cycle's first CaptureClientRT or EndCycleRT call. Works out
+    // where the cycle goes in the recording.
+    void                        BeginCycleRT(UInt32 inFrames, SampleTime inSampleTime);
+    // Find the client's track, giving it the next free one if it doesn't have one yet. Returns
+    // null if all the tracks are taken.
+    Track* __nullable           GetClientTrackRT(UInt32 inClientID);
+
+    SInt64                      GetQueuedFrames() const;
+
+    static void* __nullable     WriterThreadProc(void* inRefCon);
+    void                        WriterThreadLoop();
+    // Write the frames up to the end of the last complete IO cycle to the file.
+    void                        WriteCompleteCycles();
+    // Send a command to the writer thread and wait for it to be done.
+    void                        SendWriterCommand(WriterCommand inCommand);
+
+    // Guards the recording's state (everything not written by the IO or writer threads) and
+    // serialises Start and Stop.
+    CAMutex                     mStateMutex { "EFF_StemRecorder state" };
+
+    // The writer thread is only started by the first recording.
+    bool                        mWriterThreadStarted    = false;
+    // Signalled to wake the writer thread.
+    EFF_Semaphore               mWakeSemaphore;
+    // Signalled by the writer thread when it's done a command.
+    EFF_Semaphore               mCommandDoneSemaphore;
+    std::atomic<UInt32>         mWriterCommand          { kWriterCommandNone };
+    // True while the writer thread is waiting on mWakeSemaphore. The IO thread clears it when it
+    // signals the semaphore, so it only signals once per wait.
+    std::atomic<bool>           mWriterIsWaiting        { false };
+
+    // Only used by the writer thread while recording. Start opens it before starting the recording.
+    EFF_CaptureFileWriter       mFile;
+    bool                        mFileFailed             = false;
+    // The writer thread's buffers for reading one track and for interleaving all of them.
+    std::vector<Float32>        mTrackBuffer;
+    std::vector<Float32>        mFileBuffer;
+
+    CACFString                  mPath;
+    EFFRecordingFileFormat      mFileFormat             = kEFFRecordingFileFormatWAV;
+    EFFRecordingSampleFormat    mSampleFormat           = kEFFRecordingSampleFormatFloat32;
+    UInt32                      mTrackCount             = 0;
+    UInt32                      mChannelsPerFrame       = 0;
+    // Just a cache of what IdentifyTrackClients looked up, so it can be const.
+    mutable TrackIdentity       mTrackIdentities[kMaxTracks];
+
+    // The tracks' ring buffers are reallocated by Start while nothing is being recorded. Only the
+    // first mTrackCount are used.
+    Track                       mTracks[kMaxTracks];
+    // The number of tracks the IO thread has given to clients. Only written by the IO thread.
+    std::atomic<UInt32>         mAssignedTracks         { 0 };
+    UInt32                      mRingCapacityFrames     = 0;
+    SInt64                      mWakeFrames             = 0;
+
+    // The IO thread's state. Only used by the IO thread while recording.
+    bool                        mHasCycle               = false;
+    // The sample time and size of the current IO cycle, and where it starts in the recording.
+    SampleTime                  mCycleSampleTime        = 0;
+    UInt32                      mCycleFrames            = 0;
+    SampleTime                  mCycleRecordingTime     = 0;
+
+    // The position in the recording of the end of the last complete IO cycle, and of the next frame
+    // the writer thread will write. Only written by the IO thread and the writer thread
+    // respectively.
+    std::atomic<SampleTime>     mCompleteTime           { 0 };
+    std::atomic<SampleTime>     mWriteTime              { 0 };
+
+    // Stops and starts the IO thread without locking. Stop clears mIsRecording and then waits for
+    // mIOThreadIsCapturing to be false, after which the IO thread won't touch the ring buffers.
+    std::atomic<bool>           mIsRecording            { false };
+    std::atomic<bool>           mIOThreadIsCapturing    { false };
+
+    // Counts for the status dictionary.
+    std::atomic<UInt64>         mFramesWritten          { 0 };
+    std::atomic<UInt64>         mBytesWritten           { 0 };
+    std::atomic<UInt64>         mDroppedBlocks          { 0 };
+    std::atomic<UInt64>         mDroppedFrames          { 0 };
+    std::atomic<UInt64>         mUntrackedBuffers       { 0 };
+    std::atomic<OSStatus>       mError                  { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_StemRecorder_h */
+
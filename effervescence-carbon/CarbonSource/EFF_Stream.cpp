@@ -28,6 +28,7 @@ EFF_Stream::EFF_Stream(AudioObjectID inObjectID,
                        AudioDeviceID inOwnerDeviceID,
                        bool inIsInput,
                        Float64 inSampleRate,
+                       UInt32 inChannelsPerFrame,
                        UInt32 inStartingChannel)
 :
     EFF_Object(inObjectID,
@@ -38,8 +39,12 @@ EFF_Stream::EFF_Stream(AudioObjectID inObjectID,
     mIsInput(inIsInput),
     mIsStreamActive(false),
     mSampleRate(inSampleRate),
-    mStartingChannel(inStartingChannel)
+    mStartingChannel(inStartingChannel),
+    mChannelsPerFrame(inChannelsPerFrame)
 {
+    ThrowIf(inChannelsPerFrame == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_Stream::EFF_Stream: A stream must have at least one channel");
 }
 
 EFF_Stream::~EFF_Stream()
@@ -300,10 +305,10 @@ const
                 outASBD->mFormatID = kAudioFormatLinearPCM;
                 outASBD->mFormatFlags =
                     kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                outASBD->mBytesPerPacket = 8;
+                outASBD->mBytesPerPacket = mChannelsPerFrame * sizeof(Float32);
                 outASBD->mFramesPerPacket = 1;
-                outASBD->mBytesPerFrame = 8;
-                outASBD->mChannelsPerFrame = 2;
+                outASBD->mBytesPerFrame = mChannelsPerFrame * sizeof(Float32);
+                outASBD->mChannelsPerFrame = mChannelsPerFrame;
                 outASBD->mBitsPerChannel = 32;
 
                 outDataSize = sizeof(AudioStreamBasicDescription);
@@ -323,10 +328,10 @@ const
                 outASRD[0].mFormat.mFormatID = kAudioFormatLinearPCM;
                 outASRD[0].mFormat.mFormatFlags =
                     kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                outASRD[0].mFormat.mBytesPerPacket = 8;
+                outASRD[0].mFormat.mBytesPerPacket = mChannelsPerFrame * sizeof(Float32);
                 outASRD[0].mFormat.mFramesPerPacket = 1;
-                outASRD[0].mFormat.mBytesPerFrame = 8;
-                outASRD[0].mFormat.mChannelsPerFrame = 2;
+                outASRD[0].mFormat.mBytesPerFrame = mChannelsPerFrame * sizeof(Float32);
+                outASRD[0].mFormat.mChannelsPerFrame = mChannelsPerFrame;
                 outASRD[0].mFormat.mBitsPerChannel = 32;
                 // These match kAudioDevicePropertyAvailableNominalSampleRates.
                 outASRD[0].mSampleRateRange.mMinimum = 1.0;
@@ -381,7 +386,7 @@ void    EFF_Stream::SetPropertyData(AudioObjectID inObjectID,
                     mIsStreamActive = theNewIsActive;
 
                     // Send the notification.
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
                         AudioObjectPropertyAddress theProperty[] = {
                             CAPropertyAddress(kAudioStreamPropertyIsActive)
                         };
@@ -398,8 +403,8 @@ void    EFF_Stream::SetPropertyData(AudioObjectID inObjectID,
                 // to be handled via the RequestConfigChange/PerformConfigChange machinery. The
                 // stream only needs to validate the format at this point.
                 //
-                // Note that because our devices only supports 2 channel 32 bit float data, the only
-                // thing that can change is the sample rate.
+                // Note that because each stream only supports 32 bit float data with the number of
+                // channels it was created with, the only thing that can change is the sample rate.
                 ThrowIf(inDataSize != sizeof(AudioStreamBasicDescription),
                         CAException(kAudioHardwareBadPropertySizeError),
                         "EFF_Stream::SetPropertyData: wrong size for the data for "
@@ -419,7 +424,7 @@ void    EFF_Stream::SetPropertyData(AudioObjectID inObjectID,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "EFF_Stream::SetPropertyData: unsupported format flags for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mBytesPerPacket != 8,
+                ThrowIf(theNewFormat->mBytesPerPacket != mChannelsPerFrame * sizeof(Float32),
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "EFF_Stream::SetPropertyData: unsupported bytes per packet for "
                         "kAudioStreamPropertyPhysicalFormat");
@@ -427,11 +432,11 @@ void    EFF_Stream::SetPropertyData(AudioObjectID inObjectID,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "EFF_Stream::SetPropertyData: unsupported frames per packet for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mBytesPerFrame != 8,
+                ThrowIf(theNewFormat->mBytesPerFrame != mChannelsPerFrame * sizeof(Float32),
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "EFF_Stream::SetPropertyData: unsupported bytes per frame for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mChannelsPerFrame != 2,
+                ThrowIf(theNewFormat->mChannelsPerFrame != mChannelsPerFrame,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "EFF_Stream::SetPropertyData: unsupported channels per frame for "
                         "kAudioStreamPropertyPhysicalFormat");
@@ -466,4 +471,14 @@ void    EFF_Stream::SetSampleRate(Float64 inSampleRate)
     mSampleRate = inSampleRate;
 }
 
+void    EFF_Stream::SetChannelsPerFrame(UInt32 inChannelsPerFrame)
+{
+    ThrowIf(inChannelsPerFrame == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFF_Stream::SetChannelsPerFrame: A stream needs at least one channel");
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+    mChannelsPerFrame = inChannelsPerFrame;
+}
+
 #pragma clang assume_nonnull end
@@ -34,6 +34,7 @@ public:
                                            AudioObjectID inOwnerDeviceID,
                                            bool inIsInput,
                                            Float64 inSampleRate,
+                                           UInt32 inChannelsPerFrame,
                                            UInt32 inStartingChannel = 1);
     virtual                     ~EFF_Stream();
 
@@ -74,6 +75,11 @@ public:
     // make the decision to set the sample rates for both streams at once
     void                        SetSampleRate(Float64 inSampleRate);
 
+    UInt32                      GetChannelsPerFrame() const { return mChannelsPerFrame; }
+    // Only called by EFFDevice while IO is stopped for a config change, which is when the host
+    // rereads the stream's formats.
+    void                        SetChannelsPerFrame(UInt32 inChannelsPerFrame);
+
 private:
     CAMutex                     mStateMutex;
 
@@ -91,6 +97,13 @@ private:
      */
     UInt32                      mStartingChannel;
 
+    /*!
+     The number of channels in each frame of the stream's audio. The samples are always 32-bit
+     floats, so this is the only part of the format besides the sample rate that can differ between
+     streams. Only changes during config changes. See SetChannelsPerFrame.
+     */
+    UInt32                      mChannelsPerFrame;
+
 };
 
 #pragma clang assume_nonnull end
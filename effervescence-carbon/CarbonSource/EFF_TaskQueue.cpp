@@ -14,21 +14,16 @@
 #include "EFF_Utils.h"
 #include "EFF_PlugIn.h"
 #include "EFF_Clients.h"
-#include "EFF_ClientMap.h"
 #include "EFF_ClientTasks.h"
+#include "EFF_IOStats.h"
 
 // PublicUtility Includes
 #include "CAException.h"
 #include "CADebugMacros.h"
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wsign-conversion"
-#include "CAAtomic.h"
-#pragma clang diagnostic pop
 
 // System Includes
-#include <mach/mach_init.h>
 #include <mach/mach_time.h>
-#include <mach/task.h>
+#include <sched.h>
 
 
 #pragma clang assume_nonnull begin
@@ -50,32 +45,9 @@ EFF_TaskQueue::EFF_TaskQueue()
                     /* inIsPreemptible = */ true),
     mNonRealTimeThread(&EFF_TaskQueue::NonRealTimeThreadProc, this)
 {
-    // Init the semaphores
-    auto createSemaphore = [] () {
-        semaphore_t theSemaphore;
-        kern_return_t theError = semaphore_create(mach_task_self(),
-                                                  &theSemaphore,
-                                                  SYNC_POLICY_FIFO, 0);
-        EFF_Utils::ThrowIfMachError("EFF_TaskQueue::EFF_TaskQueue",
-                                    "semaphore_create",
-                                    theError);
-        ThrowIf(theSemaphore == SEMAPHORE_NULL,
-                CAException(kAudioHardwareUnspecifiedError),
-                "EFF_TaskQueue::EFF_TaskQueue: Could not create semaphore");
-        
-        return theSemaphore;
-    };
-    mRealTimeThreadWorkQueuedSemaphore              = createSemaphore();
-    mNonRealTimeThreadWorkQueuedSemaphore           = createSemaphore();
-    mRealTimeThreadSyncTaskCompletedSemaphore       = createSemaphore();
-    mNonRealTimeThreadSyncTaskCompletedSemaphore    = createSemaphore();
-    
-    // Pre-allocate enough tasks in mNonRealTimeThreadTasksFreeList that the real-time threads should never have to
-    // allocate memory when adding a task to the non-realtime queue.
-    for(UInt32 i = 0; i < kNonRealTimeThreadTaskBufferSize; i++)
+    for(UInt32 i = 0; i < kClientIOStatesSize; i++)
     {
-        EFF_Task* theTask = new EFF_Task;
-        mNonRealTimeThreadTasksFreeList.push_NA(theTask);
+        mClientIOStates[i].store(kClientIOStateUnknown, std::memory_order_relaxed);
     }
     
     // Start the worker threads
@@ -90,36 +62,8 @@ EFF_TaskQueue::~EFF_TaskQueue()
         QueueSync(kEFFTaskStopWorkerThread, /* inRunOnRealtimeThread = */ true);
         QueueSync(kEFFTaskStopWorkerThread, /* inRunOnRealtimeThread = */ false);
     }));
-
-    // Destroy the semaphores
-    auto destroySemaphore = [] (semaphore_t inSemaphore) {
-        kern_return_t theError = semaphore_destroy(mach_task_self(), inSemaphore);
-        EFF_Utils::LogIfMachError("EFF_TaskQueue::~EFF_TaskQueue",
-                                  "semaphore_destroy",
-                                  theError);
-    };
-    
-    destroySemaphore(mRealTimeThreadWorkQueuedSemaphore);
-    destroySemaphore(mNonRealTimeThreadWorkQueuedSemaphore);
-    destroySemaphore(mRealTimeThreadSyncTaskCompletedSemaphore);
-    destroySemaphore(mNonRealTimeThreadSyncTaskCompletedSemaphore);
-    
-    EFF_Task* theTask;
     
-    // Delete the tasks in the non-realtime tasks free list
-    while((theTask = mNonRealTimeThreadTasksFreeList.pop_atomic()) != NULL)
-    {
-        delete theTask;
-    }
-    
-    // Delete any tasks left on the non-realtime queue that need to be
-    while((theTask = mNonRealTimeThreadTasks.pop_atomic()) != NULL)
-    {
-        if(!theTask->IsSync())
-        {
-            delete theTask;
-        }
-    }
+    // Any async tasks left in the queues are just dropped along with them.
 }
 
 //static
@@ -138,19 +82,6 @@ UInt32  EFF_TaskQueue::NanosToAbsoluteTime(UInt32 inNanos)
 
 #pragma mark Task queueing
 
-void    EFF_TaskQueue::QueueSync_SwapClientShadowMaps(EFF_ClientMap* inClientMap)
-{
-    // TODO: Is there any reason to use uintptr_t when we pass pointers to tasks like this? I can't think of any
-    //       reason for a system to have (non-function) pointers larger than 64-bit, so I figure they should fit.
-    //
-    //       From http://en.cppreference.com/w/cpp/language/reinterpret_cast:
-    //       "A pointer converted to an integer of sufficient size and back to the same pointer type is guaranteed
-    //        to have its original value [...]"
-    QueueSync(kEFFTaskSwapClientShadowMaps,
-              /* inRunOnRealtimeThread = */ true,
-              reinterpret_cast<UInt64>(inClientMap));
-}
-
 void    EFF_TaskQueue::QueueAsync_SendPropertyNotification(AudioObjectPropertySelector inProperty,
                                                            AudioObjectID inDeviceID)
 {
@@ -158,24 +89,47 @@ void    EFF_TaskQueue::QueueAsync_SendPropertyNotification(AudioObjectPropertySe
              inProperty,
              inDeviceID);
     EFF_Task theTask(kEFFTaskSendPropertyNotification,
-                     /* inIsSync = */ false,
+                     /* inSyncTaskState = */ NULL,
                      inProperty,
                      inDeviceID);
     QueueOnNonRealtimeThread(theTask);
 }
 
+void    EFF_TaskQueue::QueueAsync_PublishIOStats(EFF_IOStats* inIOStats, AudioObjectID inDeviceID)
+{
+    // This is queued from the IO thread every few seconds, so unlike the other methods we don't log
+    // anything here.
+    EFF_Task theTask(kEFFTaskPublishIOStats,
+                     /* inSyncTaskState = */ NULL,
+                     reinterpret_cast<UInt64>(inIOStats),
+                     inDeviceID);
+    QueueOnNonRealtimeThread(theTask);
+}
+
 bool    EFF_TaskQueue::Queue_UpdateClientIOState(bool inSync,
                                                  EFF_Clients* inClients,
                                                  UInt32 inClientID,
                                                  bool inDoingIO)
 {
+    // BeginIOOperation and EndIOOperation request IO state changes for every client that does IO,
+    // including the first and last clients, which StartIO and StopIO have already updated. Skip the
+    // async requests that wouldn't change anything so they don't wake the worker thread. Sync
+    // requests are always queued because the caller needs the task's return value.
+    bool isTracked = false;
+    
+    if(!TrackClientIOStateTask(inClientID, inDoingIO, inSync, isTracked))
+    {
+        return false;
+    }
+    
     DebugMsg("EFF_TaskQueue::Queue_UpdateClientIOState: Queueing %s %s",
              (inDoingIO ? "kEFFTaskStartClientIO" : "kEFFTaskStopClientIO"),
              (inSync ? "synchronously" : "asynchronously"));
     
     EFF_TaskID theTaskID = (inDoingIO ? kEFFTaskStartClientIO : kEFFTaskStopClientIO);
     UInt64 theClientsPtrArg = reinterpret_cast<UInt64>(inClients);
-    UInt64 theClientIDTaskArg = static_cast<UInt64>(inClientID);
+    // The high bits tell the worker thread whether to finish the task in mClientIOStates.
+    UInt64 theClientIDTaskArg = static_cast<UInt64>(inClientID) | (isTracked ? (1ull << 32) : 0);
     
     if(inSync)
     {
@@ -187,14 +141,108 @@ bool    EFF_TaskQueue::Queue_UpdateClientIOState(bool inSync,
     else
     {
         EFF_Task theTask(theTaskID,
-                         /* inIsSync = */ false,
+                         /* inSyncTaskState = */ NULL,
                          theClientsPtrArg,
                          theClientIDTaskArg);
-        QueueOnNonRealtimeThread(theTask);
         
-        // This method's return value isn't used when queueing async, because we can't know what it should be yet.
-        return false;
+        if(!QueueOnNonRealtimeThread(theTask))
+        {
+            // Leave the client's applied state as it was, so the next request for it, which the HAL
+            // makes the next time the client starts or stops, isn't skipped.
+            if(isTracked)
+            {
+                FinishClientIOStateTask(inClientID, kClientIOStateUnchanged);
+            }
+            
+            return false;
+        }
+        
+        // When queueing async we can't know what the task will return yet, so just report that we
+        // queued it.
+        return true;
+    }
+}
+
+static inline UInt32 ClientIOStateIndex(UInt32 inClientID, UInt32 inTableSize)
+{
+    return (inClientID * 2654435761u) & (inTableSize - 1);
+}
+
+static inline UInt64 MakeClientIOState(UInt32 inClientID, UInt64 inOutstandingTasks, UInt64 inAppliedState)
+{
+    return (static_cast<UInt64>(inClientID) << 32) | (inOutstandingTasks << 8) | inAppliedState;
+}
+
+bool    EFF_TaskQueue::TrackClientIOStateTask(UInt32 inClientID,
+                                              bool inDoingIO,
+                                              bool inSync,
+                                              bool& outIsTracked)
+{
+    std::atomic<UInt64>& theEntry = mClientIOStates[ClientIOStateIndex(inClientID, kClientIOStatesSize)];
+    const UInt64 theRequestedState = (inDoingIO ? kClientIOStateStarted : kClientIOStateStopped);
+    
+    // Acquire pairs with the release in FinishClientIOStateTask, so if the worker thread has applied
+    // the state, EFF_Clients has it too.
+    UInt64 theOldEntry = theEntry.load(std::memory_order_acquire);
+    
+    while(true)
+    {
+        const UInt32 theEntryClientID = static_cast<UInt32>(theOldEntry >> 32);
+        const UInt64 theOutstandingTasks = (theOldEntry >> 8) & 0xFFFFFF;
+        const UInt64 theAppliedState = theOldEntry & 0xFF;
+        
+        UInt64 theNewEntry;
+        
+        if(theEntryClientID == inClientID)
+        {
+            if(!inSync && theOutstandingTasks == 0 && theAppliedState == theRequestedState)
+            {
+                return false;
+            }
+            
+            theNewEntry = MakeClientIOState(inClientID, theOutstandingTasks + 1, theAppliedState);
+        }
+        else if(theOutstandingTasks == 0)
+        {
+            // Take the entry over from the other client. We don't know this client's state yet.
+            theNewEntry = MakeClientIOState(inClientID, 1, kClientIOStateUnknown);
+        }
+        else
+        {
+            outIsTracked = false;
+            return true;
+        }
+        
+        if(theEntry.compare_exchange_weak(theOldEntry,
+                                          theNewEntry,
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire))
+        {
+            outIsTracked = true;
+            return true;
+        }
+    }
+}
+
+void    EFF_TaskQueue::FinishClientIOStateTask(UInt32 inClientID, UInt64 inAppliedState)
+{
+    std::atomic<UInt64>& theEntry = mClientIOStates[ClientIOStateIndex(inClientID, kClientIOStatesSize)];
+    UInt64 theOldEntry = theEntry.load(std::memory_order_relaxed);
+    UInt64 theNewEntry;
+    
+    // No other client can have taken the entry over, since this task was outstanding.
+    do
+    {
+        const UInt64 theOutstandingTasks = (theOldEntry >> 8) & 0xFFFFFF;
+        const UInt64 theAppliedState =
+                (inAppliedState == kClientIOStateUnchanged) ? (theOldEntry & 0xFF) : inAppliedState;
+        
+        theNewEntry = MakeClientIOState(inClientID, theOutstandingTasks - 1, theAppliedState);
     }
+    while(!theEntry.compare_exchange_weak(theOldEntry,
+                                          theNewEntry,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
 }
 
 // This function happens synchronously (i.e. it returns only after the work is done)
@@ -210,89 +258,91 @@ UInt64    EFF_TaskQueue::QueueSync(EFF_TaskID inTaskID,
              inTaskArg1,
              inTaskArg2);
     
-    // Create the task
+    // Each thread that queues sync tasks has its own semaphore, so the worker thread can wake just the
+    // thread whose task it finished. (We used to signal one shared semaphore with
+    // semaphore_signal_all, which woke every waiting thread after each task and could also miss
+    // threads that weren't waiting yet.)
+    static thread_local EFF_Semaphore sTaskCompletedSemaphore;
+    
+    // Create the task. The worker thread writes the return value into theSyncTaskState.
+    EFF_SyncTaskState theSyncTaskState { &sTaskCompletedSemaphore };
     EFF_Task theTask(inTaskID,
-                     /* inIsSync = */ true,
+                     &theSyncTaskState,
                      inTaskArg1,
                      inTaskArg2);
 
-    // Add the task to the queue
-    TAtomicStack<EFF_Task>& theTasks = (inRunOnRealtimeThread
-                                        ? mRealTimeThreadTasks
-                                        : mNonRealTimeThreadTasks);
-    theTasks.push_atomic(&theTask);
-
-    // Wake the worker thread so it'll process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(inRunOnRealtimeThread
-                                              ? mRealTimeThreadWorkQueuedSemaphore
-                                              : mNonRealTimeThreadWorkQueuedSemaphore);
-    EFF_Utils::ThrowIfMachError("EFF_TaskQueue::QueueSync",
-                                "semaphore_signal",
-                                theError);
-
-    // Wait until the task has been processed.
-    //
-    // The worker thread signals all threads waiting on this semaphore when it finishes a task.
-    // The comments in WorkerThreadProc explain why we have to check the condition in a loop here.
-    bool didLogTimeoutMessage = false;
-    while(!theTask.IsComplete())
+    // Add the task to the queue and wake the worker thread if it's waiting.
+    Push(inRunOnRealtimeThread ? mRealTimeThreadQueue : mNonRealTimeThreadQueue, theTask);
+
+    // Wait until the task has been processed. The semaphore counts signals, so this returns even if
+    // the worker finishes the task before we start waiting.
+    sTaskCompletedSemaphore.Wait();
+    
+    if(theSyncTaskState.mReturnValue != INT64_MAX)
     {
-        semaphore_t theTaskCompletedSemaphore = inRunOnRealtimeThread
-                                                ? mRealTimeThreadSyncTaskCompletedSemaphore
-                                                : mNonRealTimeThreadSyncTaskCompletedSemaphore;
-        // TODO: Because the worker threads use semaphore_signal_all instead of semaphore_signal,
-        // a thread can miss the signal if it isn't waiting at the right time.
-        // Using a timeout for now as a temporary fix so threads don't get stuck here.
-        theError = semaphore_timedwait(theTaskCompletedSemaphore,
-                                       (mach_timespec_t){ 0, kRealTimeThreadMaximumComputationNs * 4 });
-        
-        if(theError == KERN_OPERATION_TIMED_OUT)
-        {
-            if(!didLogTimeoutMessage && inRunOnRealtimeThread)
-            {
-                DebugMsg("EFF_TaskQueue::QueueSync: Task %d taking longer than expected.", theTask.GetTaskID());
-                didLogTimeoutMessage = true;
-            }
-        }
-        else
-        {
-            EFF_Utils::ThrowIfMachError("EFF_TaskQueue::QueueSync", "semaphore_timedwait", theError);
-        }
-        
-        CAMemoryBarrier();
+        DebugMsg("EFF_TaskQueue::QueueSync: Task %d returned %llu.", inTaskID, theSyncTaskState.mReturnValue);
     }
     
-    if(didLogTimeoutMessage)
+    return theSyncTaskState.mReturnValue;
+}
+
+bool   EFF_TaskQueue::QueueOnNonRealtimeThread(EFF_Task inTask)
+{
+    // The async tasks are queued from the IO thread, so this mustn't wait for room in the queue.
+    // The queue is large enough that it should never be full, and every async task is either
+    // repeated later (the client IO state requests) or can be missed (notifications and IO stats).
+    if(!TryPush(mNonRealTimeThreadQueue, inTask))
     {
-        DebugMsg("EFF_TaskQueue::QueueSync: Late task %d finished.", theTask.GetTaskID());
+        // Logged by the worker thread the next time it processes a task.
+        mDroppedTasks.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
     
-    if(theTask.GetReturnValue() != INT64_MAX)
+    return true;
+}
+
+bool    EFF_TaskQueue::TryPush(EFF_WorkerQueue& inQueue, const EFF_Task& inTask)
+{
+    if(!inQueue.mTasks.TryPush(inTask))
     {
-        DebugMsg("EFF_TaskQueue::QueueSync: Task %d returned %llu.", theTask.GetTaskID(), theTask.GetReturnValue());
+        return false;
     }
     
-    return theTask.GetReturnValue();
+    WakeWorkerIfWaiting(inQueue);
+    return true;
 }
 
-void   EFF_TaskQueue::QueueOnNonRealtimeThread(EFF_Task inTask)
+void    EFF_TaskQueue::Push(EFF_WorkerQueue& inQueue, const EFF_Task& inTask)
 {
-    // Add the task to our task list
-    EFF_Task* freeTask = mNonRealTimeThreadTasksFreeList.pop_atomic();
+    // Sync tasks can't be dropped, since the caller is waiting for them, so if the queue is full,
+    // wait for the worker thread to make room. The caller isn't a real-time thread, so it can log
+    // and yield.
+    bool didLogQueueFullMessage = false;
     
-    if(freeTask == NULL)
+    while(!TryPush(inQueue, inTask))
     {
-        LogWarning("EFF_TaskQueue::QueueOnNonRealtimeThread: No pre-allocated tasks left in the free list. Allocating new task.");
-        freeTask = new EFF_Task;
+        if(!didLogQueueFullMessage)
+        {
+            LogWarning("EFF_TaskQueue::Push: Task queue full. Waiting for the worker thread. Task ID %d",
+                       inTask.GetTaskID());
+            didLogQueueFullMessage = true;
+        }
+        
+        sched_yield();
     }
+}
+
+void    EFF_TaskQueue::WakeWorkerIfWaiting(EFF_WorkerQueue& inQueue)
+{
+    // Only signal the worker thread if it's waiting for work. If it's busy, it'll see the task
+    // before it waits again, so we can save the syscall. This pairs with the fence in
+    // WorkerThreadProc: either we see that it's waiting, or it sees our task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
     
-    *freeTask = inTask;
-    
-    mNonRealTimeThreadTasks.push_atomic(freeTask);
-    
-    // Signal the worker thread to process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(mNonRealTimeThreadWorkQueuedSemaphore);
-    EFF_Utils::ThrowIfMachError("EFF_TaskQueue::QueueOnNonRealtimeThread", "semaphore_signal", theError);
+    if(inQueue.mWorkerIsWaiting.exchange(false, std::memory_order_relaxed))
+    {
+        inQueue.mWorkQueuedSemaphore.Signal();
+    }
 }
 
 
@@ -319,10 +369,7 @@ void* __nullable    EFF_TaskQueue::RealTimeThreadProc(void* inRefCon)
     DebugMsg("EFF_TaskQueue::RealTimeThreadProc: The realtime worker thread has started");
     
     EFF_TaskQueue* refCon = static_cast<EFF_TaskQueue*>(inRefCon);
-    refCon->WorkerThreadProc(refCon->mRealTimeThreadWorkQueuedSemaphore,
-                             refCon->mRealTimeThreadSyncTaskCompletedSemaphore,
-                             &refCon->mRealTimeThreadTasks,
-                             NULL,
+    refCon->WorkerThreadProc(refCon->mRealTimeThreadQueue,
                              [&] (EFF_Task* inTask) { return refCon->ProcessRealTimeThreadTask(inTask); });
     
     return NULL;
@@ -334,85 +381,51 @@ void* __nullable    EFF_TaskQueue::NonRealTimeThreadProc(void* inRefCon)
     DebugMsg("EFF_TaskQueue::NonRealTimeThreadProc: The non-realtime worker thread has started");
     
     EFF_TaskQueue* refCon = static_cast<EFF_TaskQueue*>(inRefCon);
-    refCon->WorkerThreadProc(refCon->mNonRealTimeThreadWorkQueuedSemaphore,
-                             refCon->mNonRealTimeThreadSyncTaskCompletedSemaphore,
-                             &refCon->mNonRealTimeThreadTasks,
-                             &refCon->mNonRealTimeThreadTasksFreeList,
+    refCon->WorkerThreadProc(refCon->mNonRealTimeThreadQueue,
                              [&] (EFF_Task* inTask) { return refCon->ProcessNonRealTimeThreadTask(inTask); });
     
     return NULL;
 }
 
-void    EFF_TaskQueue::WorkerThreadProc(semaphore_t inWorkQueuedSemaphore,
-                                        semaphore_t inSyncTaskCompletedSemaphore,
-                                        TAtomicStack<EFF_Task>* inTasks,
-                                        TAtomicStack2<EFF_Task>* __nullable inFreeList,
+void    EFF_TaskQueue::WorkerThreadProc(EFF_WorkerQueue& inQueue,
                                         std::function<bool(EFF_Task*)> inProcessTask)
 {
     bool theThreadShouldStop = false;
     
-    while(!theThreadShouldStop)
+    while(!theThreadShouldStop)  // Stop processing tasks if we're shutting down
     {
-        // Wait until a thread signals that it's added tasks to the queue.
-        //
-        // Note that we don't have to hold any lock before waiting. If the semaphore is signalled before we begin waiting
-        // we'll still get the signal after we do.
-        kern_return_t theError = semaphore_wait(inWorkQueuedSemaphore);
-        EFF_Utils::ThrowIfMachError("EFF_TaskQueue::WorkerThreadProc", "semaphore_wait", theError);
+        EFF_Task theTask;
         
-        // Fetch the tasks from the queue.
-        //
-        // The tasks need to be processed in the order they were added to the queue. Since pop_all_reversed is atomic,
-        // other threads can't add new tasks while we're reading, which would mix up the order.
-        EFF_Task* theTask = inTasks->pop_all_reversed();
-        
-        while(theTask != NULL &&
-              !theThreadShouldStop)  // Stop processing tasks if we're shutting down
+        // Process the tasks in the order they were queued until the queue is empty.
+        if(inQueue.mTasks.TryPop(theTask))
         {
-            EFF_Task* theNextTask = theTask->mNext;
-            
-            EFFAssert(!theTask->IsComplete(),
-                      "EFF_TaskQueue::WorkerThreadProc: Cannot process already completed task (ID %d)",
-                      theTask->GetTaskID());
-            
-            EFFAssert(theTask != theNextTask,
-                      "EFF_TaskQueue::WorkerThreadProc: EFF_Task %p (ID %d) was added to %s multiple times. arg1=%llu arg2=%llu",
-                      theTask,
-                      theTask->GetTaskID(),
-                      (inTasks == &mRealTimeThreadTasks ? "mRealTimeThreadTasks" : "mNonRealTimeThreadTasks"),
-                      theTask->GetArg1(),
-                      theTask->GetArg2());
-            
-            // Process the task
-            theThreadShouldStop = inProcessTask(theTask);
+            theThreadShouldStop = inProcessTask(&theTask);
             
-            // If the task was queued synchronously, let the thread that queued it know we're finished
-            if(theTask->IsSync())
-            {
-                // Marking the task as completed allows QueueSync to return,
-                // which means it's possible for theTask to point to invalid memory after this point.
-                CAMemoryBarrier();
-                theTask->MarkCompleted();
-                
-                // Signal any threads waiting for their task to be processed.
-                //
-                // We use semaphore_signal_all instead of semaphore_signal to avoid a race condition in QueueSync.
-                // It's possible for threads calling QueueSync to wait on the semaphore in an order
-                // different to the order of the tasks they just added to the queue.
-                // So after each task is completed we have every waiting thread check if it was theirs.
-                //
-                // Note that semaphore_signal_all has an implicit barrier.
-                theError = semaphore_signal_all(inSyncTaskCompletedSemaphore);
-                EFF_Utils::ThrowIfMachError("EFF_TaskQueue::WorkerThreadProc", "semaphore_signal_all", theError);
-            }
-            else if(inFreeList != NULL)
-            {
-                // After completing an async task, move it to the free list so the memory can be reused
-                inFreeList->push_atomic(theTask);
-            }
+            // If the task was queued synchronously, let the thread that queued it know we're finished.
+            theTask.MarkCompleted();
             
-            theTask = theNextTask;
+            continue;
+        }
+        
+        // The queue is empty, so tell the other threads we're about to wait and then check again,
+        // in case a task was added after we checked. This pairs with the fence in Push: either that
+        // thread sees we're waiting and signals, or we see its task here.
+        inQueue.mWorkerIsWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        
+        if(!inQueue.mTasks.IsEmpty())
+        {
+            // If a thread already saw the flag and signalled the semaphore, we'll just wake up once
+            // more than we need to.
+            inQueue.mWorkerIsWaiting.store(false, std::memory_order_relaxed);
+            continue;
         }
+        
+        // Wait until a thread signals that it's added tasks to the queue.
+        //
+        // Note that we don't have to hold any lock before waiting. If the semaphore is signalled before we begin waiting
+        // we'll still get the signal after we do.
+        inQueue.mWorkQueuedSemaphore.Wait();
     }
 }
 
@@ -427,14 +440,6 @@ bool    EFF_TaskQueue::ProcessRealTimeThreadTask(EFF_Task* inTask)
             DebugMsg("EFF_TaskQueue::ProcessRealTimeThreadTask: Stopping");
             return true;
             
-        case kEFFTaskSwapClientShadowMaps:
-            {
-                DebugMsg("EFF_TaskQueue::ProcessRealTimeThreadTask: Swapping the shadow maps in EFF_ClientMap");
-                EFF_ClientMap* theClientMap = reinterpret_cast<EFF_ClientMap*>(inTask->GetArg1());
-                EFF_ClientTasks::SwapInShadowMapsRT(theClientMap);
-            }
-            break;
-            
         default:
             Assert(false, "EFF_TaskQueue::ProcessRealTimeThreadTask: Unexpected task ID");
             break;
@@ -453,6 +458,14 @@ bool    EFF_TaskQueue::ProcessNonRealTimeThreadTask(EFF_Task* inTask)
            "mNonRealTimeThread should not be in a time-constraint priority band.");
 #endif
     
+    UInt32 theDroppedTasks = mDroppedTasks.exchange(0, std::memory_order_relaxed);
+    
+    if(theDroppedTasks > 0)
+    {
+        LogWarning("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Dropped %u async tasks because the queue was full",
+                   theDroppedTasks);
+    }
+    
     switch(inTask->GetTaskID())
     {
         case kEFFTaskStopWorkerThread:
@@ -461,38 +474,63 @@ bool    EFF_TaskQueue::ProcessNonRealTimeThreadTask(EFF_Task* inTask)
             
         case kEFFTaskStartClientIO:
             DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Processing kEFFTaskStartClientIO");
-            try
             {
-                EFF_Clients* theClients = reinterpret_cast<EFF_Clients*>(inTask->GetArg1());
-                bool didStartIO = EFF_ClientTasks::StartIONonRT(theClients, static_cast<UInt32>(inTask->GetArg2()));
-                inTask->SetReturnValue(didStartIO);
-            }
-            // TODO: Catch the other types of exceptions EFF_ClientTasks::StartIONonRT can throw here as well.
-            // Set the task's return value (rather than rethrowing) so the exceptions can be handled
-            // if the task was queued sync.
-            // Then QueueSync_StartClientIO can throw some exception and EFF_StartIO can return
-            // an appropriate error code to the HAL, instead of the driver just crashing.
-            // Do the same for the kEFFTaskStopClientIO case below. And should we set a return value in the catch block for
-            // EFF_InvalidClientException as well, so it can also be rethrown in QueueSync_StartClientIO and then handled?
-            catch(EFF_InvalidClientException)
-            {
-                DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Ignoring EFF_InvalidClientException thrown by StartIONonRT. %s",
-                         "It's possible the client was removed before this task was processed.");
+                UInt32 theClientID = static_cast<UInt32>(inTask->GetArg2());
+                // If the client isn't found, its state is unknown until its next task.
+                UInt64 theAppliedState = kClientIOStateUnknown;
+                
+                try
+                {
+                    EFF_Clients* theClients = reinterpret_cast<EFF_Clients*>(inTask->GetArg1());
+                    bool didStartIO = EFF_ClientTasks::StartIONonRT(theClients, theClientID);
+                    inTask->SetReturnValue(didStartIO);
+                    theAppliedState = kClientIOStateStarted;
+                }
+                // TODO: Catch the other types of exceptions EFF_ClientTasks::StartIONonRT can throw here as well.
+                // Set the task's return value (rather than rethrowing) so the exceptions can be handled
+                // if the task was queued sync.
+                // Then QueueSync_StartClientIO can throw some exception and EFF_StartIO can return
+                // an appropriate error code to the HAL, instead of the driver just crashing.
+                // Do the same for the kEFFTaskStopClientIO case below. And should we set a return value in the catch block for
+                // EFF_InvalidClientException as well, so it can also be rethrown in QueueSync_StartClientIO and then handled?
+                catch(EFF_InvalidClientException)
+                {
+                    DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Ignoring EFF_InvalidClientException thrown by StartIONonRT. %s",
+                             "It's possible the client was removed before this task was processed.");
+                }
+                
+                // Finished before a sync task is marked completed, so the caller's next request can
+                // see the state.
+                if(inTask->GetArg2() >> 32)
+                {
+                    FinishClientIOStateTask(theClientID, theAppliedState);
+                }
             }
             break;
 
         case kEFFTaskStopClientIO:
             DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Processing kEFFTaskStopClientIO");
-            try
-            {
-                EFF_Clients* theClients = reinterpret_cast<EFF_Clients*>(inTask->GetArg1());
-                bool didStopIO = EFF_ClientTasks::StopIONonRT(theClients, static_cast<UInt32>(inTask->GetArg2()));
-                inTask->SetReturnValue(didStopIO);
-            }
-            catch(EFF_InvalidClientException)
             {
-                DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Ignoring EFF_InvalidClientException thrown by StopIONonRT. %s",
-                         "It's possible the client was removed before this task was processed.");
+                UInt32 theClientID = static_cast<UInt32>(inTask->GetArg2());
+                UInt64 theAppliedState = kClientIOStateUnknown;
+                
+                try
+                {
+                    EFF_Clients* theClients = reinterpret_cast<EFF_Clients*>(inTask->GetArg1());
+                    bool didStopIO = EFF_ClientTasks::StopIONonRT(theClients, theClientID);
+                    inTask->SetReturnValue(didStopIO);
+                    theAppliedState = kClientIOStateStopped;
+                }
+                catch(EFF_InvalidClientException)
+                {
+                    DebugMsg("EFF_TaskQueue::ProcessNonRealTimeThreadTask: Ignoring EFF_InvalidClientException thrown by StopIONonRT. %s",
+                             "It's possible the client was removed before this task was processed.");
+                }
+                
+                if(inTask->GetArg2() >> 32)
+                {
+                    FinishClientIOStateTask(theClientID, theAppliedState);
+                }
             }
             break;
 
@@ -506,6 +544,16 @@ bool    EFF_TaskQueue::ProcessNonRealTimeThreadTask(EFF_Task* inTask)
                 EFF_PlugIn::Host_PropertiesChanged(static_cast<AudioObjectID>(inTask->GetArg2()), 1, thePropertyAddress);
             }
             break;
+
+        case kEFFTaskPublishIOStats:
+            {
+                EFF_IOStats* theIOStats = reinterpret_cast<EFF_IOStats*>(inTask->GetArg1());
+                theIOStats->LogSummary();
+
+                AudioObjectPropertyAddress thePropertyAddress[] = { kEFFIOStatsAddress };
+                EFF_PlugIn::Host_PropertiesChanged(static_cast<AudioObjectID>(inTask->GetArg2()), 1, thePropertyAddress);
+            }
+            break;
             
         default:
             Assert(false, "EFF_TaskQueue::ProcessNonRealTimeThreadTask: Unexpected task ID");
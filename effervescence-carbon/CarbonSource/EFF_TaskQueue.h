@@ -9,24 +9,24 @@
 #ifndef EFF_TaskQueue_h
 #define EFF_TaskQueue_h
 
+// Local Includes
+#include "EFF_BoundedMPSCQueue.h"
+#include "EFF_Semaphore.h"
+
 // PublicUtility Includes
 #include "CAPThread.h"
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wsign-conversion"
-#include "CAAtomicStack.h"
-#pragma clang diagnostic pop
 
 // STL Includes
+#include <atomic>
 #include <functional>
 
 // System Includes
-#include <mach/semaphore.h>
 #include <CoreAudio/AudioHardware.h>
 
 
 // Forward declarations
 class EFF_Clients;
-class EFF_ClientMap;
+class EFF_IOStats;
 
 
 #pragma clang assume_nonnull begin
@@ -51,55 +51,78 @@ private:
         kEFFTaskUninitialized,
         kEFFTaskStopWorkerThread,
 
-        // Realtime thread only
-        kEFFTaskSwapClientShadowMaps,
-
         // Non-realtime thread only
         kEFFTaskStartClientIO,
         kEFFTaskStopClientIO,
-        kEFFTaskSendPropertyNotification
+        kEFFTaskSendPropertyNotification,
+        kEFFTaskPublishIOStats
+    };
+
+    // The thread that queues a sync task blocks until the worker thread fills this in and signals
+    // mTaskCompletedSemaphore.
+    struct EFF_SyncTaskState
+    {
+        EFF_Semaphore*                  mTaskCompletedSemaphore;
+        UInt64                          mReturnValue        = INT64_MAX;
     };
 
+    // Tasks are copied into the queues by value, so they must stay small and trivially copyable.
     class EFF_Task
     {
     public:
-                                        EFF_Task(EFF_TaskID inTaskID    = kEFFTaskUninitialized,
-                                                 bool inIsSync          = false,
-                                                 UInt64 inArg1          = 0,
-                                                 UInt64 inArg2          = 0)
+                                        EFF_Task(EFF_TaskID inTaskID                            = kEFFTaskUninitialized,
+                                                 EFF_SyncTaskState* __nullable inSyncTaskState  = NULL,
+                                                 UInt64 inArg1                                  = 0,
+                                                 UInt64 inArg2                                  = 0)
                                         :
-                                            mNext(NULL),
                                             mTaskID(inTaskID),
-                                            mIsSync(inIsSync),
+                                            mSyncTaskState(inSyncTaskState),
                                             mArg1(inArg1),
                                             mArg2(inArg2) { };
         
-        EFF_TaskID                      GetTaskID()         { return mTaskID; }
+        EFF_TaskID                      GetTaskID() const   { return mTaskID; }
         
         // True if the thread that queued this task is blocking until the task is completed
-        bool                            IsSync()            { return mIsSync; }
+        bool                            IsSync() const      { return mSyncTaskState != NULL; }
         
-        UInt64                          GetArg1()           { return mArg1; }
-        UInt64                          GetArg2()           { return mArg2; }
+        UInt64                          GetArg1() const     { return mArg1; }
+        UInt64                          GetArg2() const     { return mArg2; }
         
-        UInt64                          GetReturnValue()    { return mReturnValue; }
+        // Only has an effect for sync tasks. The return value of async tasks isn't used.
         void                            SetReturnValue(UInt64 inReturnValue)
-                                                            { mReturnValue = inReturnValue; }
-        
-        bool                            IsComplete()        { return mIsComplete; }
-        void                            MarkCompleted()     { mIsComplete = true; }
+                                            { if(mSyncTaskState != NULL) { mSyncTaskState->mReturnValue = inReturnValue; } }
         
-        // Used by TAtomicStack
-        EFF_Task* __nullable &          next()              { return mNext; }
-        EFF_Task* __nullable            mNext;
+        // Wakes the thread that queued the task, if it was queued sync. The task's sync state
+        // belongs to that thread, so this task mustn't touch it afterwards.
+        void                            MarkCompleted()
+                                        {
+                                            if(mSyncTaskState != NULL)
+                                            {
+                                                EFF_Semaphore* theSemaphore = mSyncTaskState->mTaskCompletedSemaphore;
+                                                mSyncTaskState = NULL;
+                                                theSemaphore->Signal();
+                                            }
+                                        }
         
     private:
         EFF_TaskID                      mTaskID;
-        bool                            mIsSync;
+        EFF_SyncTaskState* __nullable   mSyncTaskState;
         UInt64                          mArg1;
         UInt64                          mArg2;
-        UInt64                          mReturnValue        = INT64_MAX;
-        bool                            mIsComplete         = false;
+    };
+
+    // The maximum number of tasks that can be waiting in each worker thread's queue. Should be large
+    // enough that the queues never fill up. (At least not while IO could be running.)
+    static const UInt32                 kTaskQueueCapacity = 512;
+
+    // The tasks waiting for one of the worker threads, and what the other threads need to wake it.
+    struct EFF_WorkerQueue
+    {
+        EFF_BoundedMPSCQueue<EFF_Task, kTaskQueueCapacity>  mTasks;
+        // Signalled when a task is queued, but only if the worker thread is waiting (or about to
+        // wait) for one. While the worker is busy, queueing a task doesn't make any syscalls.
+        EFF_Semaphore                   mWorkQueuedSemaphore;
+        std::atomic<bool>               mWorkerIsWaiting    { false };
     };
 
     
@@ -116,24 +139,30 @@ public:
 #pragma mark API
 
 public:
-    void                        QueueSync_SwapClientShadowMaps(EFF_ClientMap* inClientMap);
-    
     // Sends a property changed notification to the EFFDevice host.
     // Assumes the scope and element are kAudioObjectPropertyScopeGlobal and
     // kAudioObjectPropertyElementMaster because currently those are the only ones we use.
     void                        QueueAsync_SendPropertyNotification(AudioObjectPropertySelector inProperty,
                                                                     AudioObjectID inDeviceID);
     
+    // Logs a summary of inIOStats and then sends a notification for kAudioDeviceCustomPropertyIOStats.
+    // inIOStats must stay alive until the task has run, and no other thread may log a summary of it.
+    void                        QueueAsync_PublishIOStats(EFF_IOStats* inIOStats, AudioObjectID inDeviceID);
+    
     // Set/unset a client's is-doing-IO flag
     inline bool                 QueueSync_StartClientIO(EFF_Clients* inClients, UInt32 inClientID)
                                     { return Queue_UpdateClientIOState(true, inClients, inClientID, true); }
     inline bool                 QueueSync_StopClientIO(EFF_Clients* inClients, UInt32 inClientID)
                                     { return Queue_UpdateClientIOState(true, inClients, inClientID, false); }
     
-    inline void                 QueueAsync_StartClientIO(EFF_Clients* inClients, UInt32 inClientID)
-                                    { Queue_UpdateClientIOState(false, inClients, inClientID, true); }
-    inline void                 QueueAsync_StopClientIO(EFF_Clients* inClients, UInt32 inClientID)
-                                    { Queue_UpdateClientIOState(false, inClients, inClientID, false); }
+    // The async versions don't queue a task if the client is already in the requested state and no
+    // other IO state tasks for it are waiting or running, since the task wouldn't change anything.
+    // Return true if a task was queued. Real-time safe. If the queue is full, the task is dropped
+    // and the client's state is left as it was, so the next request for it queues a task again.
+    inline bool                 QueueAsync_StartClientIO(EFF_Clients* inClients, UInt32 inClientID)
+                                    { return Queue_UpdateClientIOState(false, inClients, inClientID, true); }
+    inline bool                 QueueAsync_StopClientIO(EFF_Clients* inClients, UInt32 inClientID)
+                                    { return Queue_UpdateClientIOState(false, inClients, inClientID, false); }
     
     void                        AssertCurrentThreadIsRTWorkerThread(const char* inCallerMethodName);
 
@@ -148,20 +177,35 @@ private:
                                                           UInt32        inClientID,
                                                           bool          inDoingIO);
 
+    // Returns false if an async request can be skipped, i.e. the client's applied IO state is
+    // inDoingIO and it has no outstanding IO state tasks. Otherwise, counts the task about to be
+    // queued as outstanding in the client's entry in mClientIOStates, unless another client has the
+    // entry, and sets outIsTracked to whether it did. Real-time safe.
+    bool                        TrackClientIOStateTask(UInt32 inClientID,
+                                                       bool inDoingIO,
+                                                       bool inSync,
+                                                       bool& outIsTracked);
+    // Finishes a task TrackClientIOStateTask counted. inAppliedState is the client's IO state after
+    // the task ran, or kClientIOStateUnchanged if the task couldn't be queued. Real-time safe.
+    void                        FinishClientIOStateTask(UInt32 inClientID, UInt64 inAppliedState);
+
     UInt64                      QueueSync(EFF_TaskID    inTaskID,
                                           bool          inRunOnRealtimeThread,
                                           UInt64        inTaskArg1 = 0,
                                           UInt64        inTaskArg2 = 0);
 
-    void                        QueueOnNonRealtimeThread(EFF_Task inTask);
+    // Real-time safe. Returns false, and drops the task, if the queue is full.
+    bool                        QueueOnNonRealtimeThread(EFF_Task inTask);
+    bool                        TryPush(EFF_WorkerQueue& inQueue, const EFF_Task& inTask);
+    // Waits for the worker thread to make room if the queue is full, so only for non-real-time
+    // threads.
+    void                        Push(EFF_WorkerQueue& inQueue, const EFF_Task& inTask);
+    void                        WakeWorkerIfWaiting(EFF_WorkerQueue& inQueue);
     
     static void* __nullable     RealTimeThreadProc(void* inRefCon);
     static void* __nullable     NonRealTimeThreadProc(void* inRefCon);
 
-    void                        WorkerThreadProc(semaphore_t inWorkQueuedSemaphore,
-                                                 semaphore_t inSyncTaskCompletedSemaphore,
-                                                 TAtomicStack<EFF_Task>* inTasks,
-                                                 TAtomicStack2<EFF_Task>* __nullable inFreeList,
+    void                        WorkerThreadProc(EFF_WorkerQueue& inQueue,
                                                  std::function<bool(EFF_Task*)> inProcessTask);
     
     // These return true when the thread should be stopped
@@ -183,36 +227,30 @@ private:
     // The maximum amount of time the real-time thread can take to finish its computation after being scheduled.
     static const UInt32        kRealTimeThreadMaximumComputationNs = 60 * NSEC_PER_USEC;
     
-    // We use Mach semaphores for communication with the worker threads because signalling them is real-time safe.
-    
-    // Signalled to tell the worker threads when there are tasks for them process.
-    semaphore_t                mRealTimeThreadWorkQueuedSemaphore;
-    semaphore_t                mNonRealTimeThreadWorkQueuedSemaphore;
-    // Signalled when a worker thread completes a task, if the thread that queued that task is blocking on it.
-    semaphore_t                mRealTimeThreadSyncTaskCompletedSemaphore;
-    semaphore_t                mNonRealTimeThreadSyncTaskCompletedSemaphore;
+    // The tasks queued for each worker thread. Any thread can add tasks, including real-time threads.
+    EFF_WorkerQueue             mRealTimeThreadQueue;
+    EFF_WorkerQueue             mNonRealTimeThreadQueue;
+
+    // The async tasks dropped because the non-real-time thread's queue was full, since it last
+    // logged them. The real-time threads that drop them can't log.
+    std::atomic<UInt32>         mDroppedTasks               { 0 };
     
-    // When a task is queued we add it to one of these, depending on which worker thread it will run on. Using
-    // TAtomicStack lets us safely add and remove tasks on real-time threads.
-    //
-    // We use TAtomicStack rather than TAtomicStack2 because we need pop_all_reversed() to make sure
-    // we process the tasks in order.
-    // (It might have been better to use OSAtomicFifoEnqueue/OSAtomicFifoDequeue, but I only
-    // recently found out about them.)
-    TAtomicStack<EFF_Task>      mRealTimeThreadTasks;
-    TAtomicStack<EFF_Task>      mNonRealTimeThreadTasks;
-    
-    // The number of tasks to pre-allocate and add to the non-realtime task free list. Should be large enough that
-    // the free list is never emptied. (At least not while IO could be running.)
-    static const UInt32         kNonRealTimeThreadTaskBufferSize = 512;
-    // Realtime threads can't safely allocate memory, so when they queue a task the memory for it comes from this
-    // free list. We pre-allocate as many tasks as they should ever need in the constructor. (But if the free list
-    // runs out of tasks somehow the realtime thread will allocate a new one.)
-    //
-    // There's a similar free list used in Apple's CAThreadSafeList.h.
+    // Each client's IO state, as last applied by the non-real-time worker thread, and the number of
+    // IO state tasks for it that are queued or running, indexed by a hash of the client ID. Each
+    // entry is the client ID in the high 32 bits, the outstanding tasks in bits 8 to 31 and the
+    // applied state, one of the kClientIOState values, in the low bits.
     //
-    // We can use TAtomicStack2 instead of TAtomicStack because we never call pop_all on the free list.
-    TAtomicStack2<EFF_Task>     mNonRealTimeThreadTasksFreeList;
+    // A client only takes over an entry from another client whose ID hashes to the same index if
+    // the other client has no outstanding tasks. Until then, its tasks are queued untracked and
+    // never skipped, which only costs extra (harmless) tasks. Either way, the other client has to
+    // queue its next task. The HAL rarely has more than a few clients doing IO at once, so that
+    // should almost never happen.
+    static const UInt32         kClientIOStatesSize = 256;
+    static const UInt64         kClientIOStateUnknown = 0;
+    static const UInt64         kClientIOStateStopped = 1;
+    static const UInt64         kClientIOStateStarted = 2;
+    static const UInt64         kClientIOStateUnchanged = 3;
+    std::atomic<UInt64>         mClientIOStates[kClientIOStatesSize];
 };
 
 #pragma clang assume_nonnull end
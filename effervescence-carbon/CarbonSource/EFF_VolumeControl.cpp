@@ -26,7 +26,6 @@
 
 // System Includes
 #include <CoreAudio/AudioHardwareBase.h>
-#include <Accelerate/Accelerate.h>
 
 
 #pragma clang assume_nonnull begin
@@ -51,6 +50,7 @@ EFF_VolumeControl::EFF_VolumeControl(AudioObjectID inObjectID,
     mMaxVolumeRaw(kDefaultMaxRawVolume),
     mMinVolumeDb(kDefaultMinDbVolume),
     mMaxVolumeDb(kDefaultMaxDbVolume),
+    mGainStage(0.0f, kVolumeRampFrames),
     mWillApplyVolumeToAudio(false)
 {
     // Setup the volume curve with the one range
@@ -357,33 +357,18 @@ bool    EFF_VolumeControl::WillApplyVolumeToAudioRT() const
     return mWillApplyVolumeToAudio;
 }
 
-void    EFF_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBufferFrameSize) const
+void    EFF_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer,
+                                            UInt32 inChannelsPerFrame,
+                                            UInt32 inBufferFrameSize)
 {
     ThrowIf(!mWillApplyVolumeToAudio,
             CAException(kAudioHardwareIllegalOperationError),
             "EFF_VolumeControl::ApplyVolumeToAudioRT: This control doesn't process audio data");
 
-    // Don't bother if the change is very unlikely to be perceptible.
-    if((mAmplitudeGain < 0.99f) || (mAmplitudeGain > 1.01f))
-    {
-        // Apply the amount of gain/loss for the current volume to the audio signal by multiplying
-        // each sample. This call to vDSP_vsmul is equivalent to
-        //
-        // for(UInt32 i = 0; i < inBufferFrameSize * 2; i++)
-        // {
-        //     ioBuffer[i] *= mAmplitudeGain;
-        // }
-        //
-        // but a bit faster on processors with newer SIMD instructions. However, it shouldn't take
-        // more than a few microseconds either way. (Unless some of the samples were subnormal
-        // numbers for some reason.)
-        //
-        // It would be a tiny bit faster still to not do this in-place, i.e. use separate input and
-        // output buffers, but then we'd have to copy the data into the output buffer when the
-        // volume is at 1.0. With our current use of this class, most people will leave the volume
-        // at 1.0, so it wouldn't be worth it.
-        vDSP_vsmul(ioBuffer, 1, &mAmplitudeGain, ioBuffer, 1, inBufferFrameSize * 2);
-    }
+    // Apply the amount of gain/loss for the current volume to the audio signal by multiplying each
+    // sample. The gain stage leaves the buffer alone when the volume is at 1.0 and isn't changing,
+    // which is the common case since most people will leave it at 1.0.
+    mGainStage.ProcessRT(ioBuffer, inChannelsPerFrame, inBufferFrameSize);
 }
 
 #pragma mark Implementation
@@ -434,9 +419,10 @@ void    EFF_VolumeControl::SetVolumeRaw(SInt32 inNewVolumeRaw)
         mAmplitudeGain = mVolumeCurve.ConvertRawToScalar(theSliderPositionInRawSteps);
 
         EFFAssert((mAmplitudeGain >= 0.0f) && (mAmplitudeGain <= 1.0f), "Gain not in [0,1]");
+        mGainStage.SetGain(mAmplitudeGain);
 
         // Send notifications.
-        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+        EFF_Utils::DispatchAsync(CADispatchQueue::GetGlobalSerialQueue().GetDispatchQueue(), [=] {
             AudioObjectPropertyAddress theChangedProperties[2];
             theChangedProperties[0] = { kAudioLevelControlPropertyScalarValue, mScope, mElement };
             theChangedProperties[1] = { kAudioLevelControlPropertyDecibelValue, mScope, mElement };
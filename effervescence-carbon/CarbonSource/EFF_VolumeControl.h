@@ -13,8 +13,11 @@
 // Superclass Includes
 #include "EFF_Control.h"
 
+// Local Includes
+#include "EFF_GainStage.h"
+#include "EFF_VolumeCurve.h"
+
 // PublicUtility Includes
-#include "CAVolumeCurve.h"
 #include "CAMutex.h"
 
 
@@ -70,7 +73,7 @@ public:
      @return The curve used by this control to convert volume values from scalar into signal gain
              and/or decibels. A continuous 2D function.
      */
-    CAVolumeCurve&      GetVolumeCurve() { return mVolumeCurve; }
+    EFF_VolumeCurve&    GetVolumeCurve() { return mVolumeCurve; }
 
     /*!
      Set the volume of this control to a given position along its volume curve. (See
@@ -110,16 +113,25 @@ public:
     bool                WillApplyVolumeToAudioRT() const;
     /*!
      Apply this volume control's volume to the samples in ioBuffer. That is, increase/decrease the
-     volumes of the samples by the current volume of this control.
+     volumes of the samples by the current volume of this control. When the volume changes, the
+     gain ramps to the new volume over kVolumeRampFrames frames so the change doesn't click.
+
+     Only the IO thread may call this.
 
-     @param ioBuffer The audio sample buffer to process.
-     @param inBufferFrameSize The number of sample frames in ioBuffer. The audio is assumed to be in
-                              stereo, i.e. two samples per frame. (Though, hopefully we'll support
-                              more at some point.)
+     @param ioBuffer The interleaved audio sample buffer to process.
+     @param inChannelsPerFrame The number of channels in ioBuffer.
+     @param inBufferFrameSize The number of sample frames in ioBuffer.
      @throws CAException If SetWillApplyVolumeToAudio hasn't been used to set this control to apply
                          its volume to audio data.
      */
-    void                ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBufferFrameSize) const;
+    void                ApplyVolumeToAudioRT(Float32* ioBuffer,
+                                             UInt32 inChannelsPerFrame,
+                                             UInt32 inBufferFrameSize);
+    /*!
+     Make ApplyVolumeToAudioRT apply the current volume immediately, rather than ramping to it from
+     the volume it last applied. Call this before IO starts. Must not be called while IO is running.
+     */
+    void                ResetVolumeRamp() { mGainStage.Reset(); }
 
 #pragma mark Implementation
 
@@ -131,6 +143,8 @@ private:
     const SInt32        kDefaultMaxRawVolume = 96;
     const Float32       kDefaultMinDbVolume  = -96.0f;
     const Float32       kDefaultMaxDbVolume  = 0.0f;
+    // About 12 ms at 44.1 kHz.
+    static const UInt32 kVolumeRampFrames    = 512;
 
     CAMutex             mMutex;
 
@@ -140,10 +154,12 @@ private:
     Float32             mMinVolumeDb;
     Float32             mMaxVolumeDb;
 
-    CAVolumeCurve       mVolumeCurve;
+    EFF_VolumeCurve     mVolumeCurve;
     // The gain (or loss) to apply to an audio signal to increase/decrease its volume by the current
     // volume of this control.
     Float32             mAmplitudeGain;
+    // Applies mAmplitudeGain to audio. Its gain is set whenever mAmplitudeGain is.
+    EFF_GainStage       mGainStage;
 
     bool                mWillApplyVolumeToAudio;
 
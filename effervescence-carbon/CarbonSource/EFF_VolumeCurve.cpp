@@ -0,0 +1,155 @@
+//
+//  EFF_VolumeCurve.cpp
+//  effervescence-driver
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_VolumeCurve.h"
+
+// STL Includes
+#include <algorithm>
+
+// System Includes
+#include <string.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Bit Casts
+
+// Non-negative floats are ordered the same way as their bit patterns, which lets us binary search
+// the floats between two values.
+static inline UInt32    FloatToBits(Float32 inFloat)
+{
+    UInt32 theBits;
+    memcpy(&theBits, &inFloat, sizeof(theBits));
+    return theBits;
+}
+
+static inline Float32   BitsToFloat(UInt32 inBits)
+{
+    Float32 theFloat;
+    memcpy(&theFloat, &inBits, sizeof(theFloat));
+    return theFloat;
+}
+
+
+#pragma mark Changing the Curve
+
+void    EFF_VolumeCurve::AddRange(SInt32 inMinRaw, SInt32 inMaxRaw, Float32 inMinDB, Float32 inMaxDB)
+{
+    mCurve.AddRange(inMinRaw, inMaxRaw, inMinDB, inMaxDB);
+    GenerateTables();
+}
+
+void    EFF_VolumeCurve::ResetRange()
+{
+    mCurve.ResetRange();
+    GenerateTables();
+}
+
+void    EFF_VolumeCurve::SetTransferFunction(UInt32 inTransferFunction)
+{
+    mCurve.SetTransferFunction(inTransferFunction);
+    GenerateTables();
+}
+
+void    EFF_VolumeCurve::GenerateTables()
+{
+    mRawToScalar.clear();
+    mRawToDB.clear();
+    mScalarToRawThresholds.clear();
+
+    mMinRaw = mCurve.GetMinimumRaw();
+    const SInt32 theMaxRaw = mCurve.GetMaximumRaw();
+
+    // Leave the tables empty if the curve has no ranges (CAVolumeCurve can't convert anything in
+    // that case) or is too long to be worth tabulating.
+    if((theMaxRaw <= mMinRaw) || (theMaxRaw - mMinRaw >= kMaxTableSize))
+    {
+        return;
+    }
+
+    const size_t theTableSize = static_cast<size_t>(theMaxRaw - mMinRaw) + 1;
+    mRawToScalar.reserve(theTableSize);
+    mRawToDB.reserve(theTableSize);
+    mScalarToRawThresholds.reserve(theTableSize - 1);
+
+    for(SInt32 theRaw = mMinRaw; theRaw <= theMaxRaw; theRaw++)
+    {
+        mRawToScalar.push_back(mCurve.ConvertRawToScalar(theRaw));
+        mRawToDB.push_back(mCurve.ConvertRawToDB(theRaw));
+    }
+
+    // Find each threshold by binary searching the scalar volumes in [0, 1] for the first one the
+    // curve converts to a higher raw volume. The thresholds are in increasing order, so each
+    // search can start from the previous threshold. ConvertScalarToRaw(1.0) is always the maximum
+    // raw volume, so every search finds one.
+    const UInt32 theOneBits = FloatToBits(1.0f);
+    UInt32 theLowerBound = FloatToBits(0.0f);
+
+    for(SInt32 theRaw = mMinRaw; theRaw < theMaxRaw; theRaw++)
+    {
+        UInt32 theLow = theLowerBound;
+        UInt32 theHigh = theOneBits;
+
+        while(theLow < theHigh)
+        {
+            UInt32 theMiddle = theLow + (theHigh - theLow) / 2;
+
+            if(mCurve.ConvertScalarToRaw(BitsToFloat(theMiddle)) > theRaw)
+            {
+                theHigh = theMiddle;
+            }
+            else
+            {
+                theLow = theMiddle + 1;
+            }
+        }
+
+        mScalarToRawThresholds.push_back(BitsToFloat(theLow));
+        theLowerBound = theLow;
+    }
+}
+
+
+#pragma mark Conversions
+
+size_t  EFF_VolumeCurve::GetTableIndex(SInt32 inRaw) const
+{
+    SInt32 theMaxIndex = static_cast<SInt32>(mRawToScalar.size()) - 1;
+    return static_cast<size_t>(std::min(std::max(inRaw - mMinRaw, 0), theMaxIndex));
+}
+
+Float32 EFF_VolumeCurve::ConvertRawToScalar(SInt32 inRaw) const
+{
+    return HasTables() ? mRawToScalar[GetTableIndex(inRaw)] : mCurve.ConvertRawToScalar(inRaw);
+}
+
+Float32 EFF_VolumeCurve::ConvertRawToDB(SInt32 inRaw) const
+{
+    return HasTables() ? mRawToDB[GetTableIndex(inRaw)] : mCurve.ConvertRawToDB(inRaw);
+}
+
+SInt32  EFF_VolumeCurve::ConvertScalarToRaw(Float32 inScalar) const
+{
+    if(!HasTables())
+    {
+        return mCurve.ConvertScalarToRaw(inScalar);
+    }
+
+    // Clamp the same way CAVolumeCurve does. (This also turns NaN into 0.)
+    inScalar = std::min(1.0f, std::max(0.0f, inScalar));
+
+    auto theThresholdItr = std::upper_bound(mScalarToRawThresholds.begin(),
+                                            mScalarToRawThresholds.end(),
+                                            inScalar);
+
+    return mMinRaw + static_cast<SInt32>(theThresholdItr - mScalarToRawThresholds.begin());
+}
+
+#pragma clang assume_nonnull end
+
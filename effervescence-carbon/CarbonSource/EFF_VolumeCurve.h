@@ -0,0 +1,86 @@
+//
+//  EFF_VolumeCurve.h
+//  effervescence-core
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A CAVolumeCurve that precomputes its conversions from raw volumes into lookup tables. Each time
+//  the curve is changed, it's evaluated once at every raw volume in its range, so converting a raw
+//  volume is just a table lookup and converting a scalar volume to raw is a binary search, rather
+//  than walking the curve's segments and calling powf every time.
+//
+//  The tables are generated by the CAVolumeCurve itself, so the conversions give exactly the same
+//  results it would. Curves with too many raw volumes for a table just use the CAVolumeCurve.
+//
+//  Not thread safe. The const methods are real-time safe.
+//
+
+#ifndef EFF_VolumeCurve_h
+#define EFF_VolumeCurve_h
+
+// PublicUtility Includes
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+class EFF_VolumeCurve
+{
+
+public:
+    // These work the same way as the CAVolumeCurve methods with the same names, except that
+    // changing the curve regenerates the tables.
+    void                        AddRange(SInt32 inMinRaw, SInt32 inMaxRaw, Float32 inMinDB, Float32 inMaxDB);
+    void                        ResetRange();
+    void                        SetTransferFunction(UInt32 inTransferFunction);
+    UInt32                      GetTransferFunction() const { return mCurve.GetTransferFunction(); }
+
+    SInt32                      GetMinimumRaw() const { return mCurve.GetMinimumRaw(); }
+    SInt32                      GetMaximumRaw() const { return mCurve.GetMaximumRaw(); }
+    Float32                     GetMinimumDB() const { return mCurve.GetMinimumDB(); }
+    Float32                     GetMaximumDB() const { return mCurve.GetMaximumDB(); }
+
+    Float32                     ConvertRawToScalar(SInt32 inRaw) const;
+    Float32                     ConvertRawToDB(SInt32 inRaw) const;
+    SInt32                      ConvertScalarToRaw(Float32 inScalar) const;
+    Float32                     ConvertScalarToDB(Float32 inScalar) const
+                                    { return ConvertRawToDB(ConvertScalarToRaw(inScalar)); }
+    // Converting from dB isn't table-driven because it's only done when the user sets a volume.
+    SInt32                      ConvertDBToRaw(Float32 inDB) const { return mCurve.ConvertDBToRaw(inDB); }
+    Float32                     ConvertDBToScalar(Float32 inDB) const
+                                    { return ConvertRawToScalar(ConvertDBToRaw(inDB)); }
+
+private:
+    void                        GenerateTables();
+    bool                        HasTables() const { return !mRawToScalar.empty(); }
+    // Clamps inRaw to the curve's range and returns its index in the tables.
+    size_t                      GetTableIndex(SInt32 inRaw) const;
+
+    // The most raw volumes a curve can have and still use tables. Far more than any of our curves.
+    static const SInt32         kMaxTableSize = 4096;
+
+    CAVolumeCurve               mCurve;
+
+    // The curve's minimum raw volume, which is index 0 in the tables.
+    SInt32                      mMinRaw = 0;
+
+    // The scalar and dB volumes for each raw volume in the curve's range.
+    std::vector<Float32>        mRawToScalar;
+    std::vector<Float32>        mRawToDB;
+
+    // Element i is the smallest scalar volume that CAVolumeCurve::ConvertScalarToRaw converts to a
+    // raw volume greater than mMinRaw + i. Since that conversion never decreases as the scalar
+    // volume increases, a scalar volume's raw volume is mMinRaw plus the number of elements less
+    // than or equal to it.
+    std::vector<Float32>        mScalarToRawThresholds;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_VolumeCurve_h */
+
@@ -87,15 +87,11 @@ static const int kEFFErrorCode_ReturningEarly       = 2;
                                  dataSourceID:(UInt32)dataSourceID
                               revertOnFailure:(BOOL)revertOnFailure;
 
-// *** PlayThrough is currently not needed ***
-/*
 // Start playthrough synchronously. Blocks until IO has started on the output device and playthrough
 // is running. See EFFPlayThrough.
 //
-// Returns one of the error codes defined by this class or EFFPlayThrough, or an AudioHardware error
-// code received from the HAL.
+// Returns kAudioHardwareNoError or an AudioHardware error code received from the HAL.
 - (OSStatus) startPlayThroughSync:(BOOL)forUISoundsDevice;
- */
 
 // *** XPC is currently not needed **
 // /*!
@@ -14,10 +14,10 @@
 #import "EFF_Types.h"
 #import "EFF_Utils.h"
 #import "EFF_AudioDevice.h"
+#import "EFF_PlayThrough.h"
 //#import "EFFDeviceControlSync.h"
 //#import "EFFOutputDeviceMenuSection.h"
 //#import "EFFOutputVolumeMenuItem.h"
-//#import "EFFPlayThrough.h"
 //#import "EFFXPCProtocols.h"
 
 // PublicUtility Includes
@@ -42,8 +42,8 @@
     EFFAudioDevice outputDevice;
     
 //    EFFDeviceControlSync deviceControlSync;
-//    EFFPlayThrough playThrough;
-//    EFFPlayThrough playThrough_UISounds;
+    EFFPlayThrough playThrough;
+    EFFPlayThrough playThrough_UISounds;
 
     // A connection to EFFXPCHelper so we can send it the ID of the output device.
 //    NSXPCConnection* __nullable EFFXPCHelperConnection;
@@ -205,6 +205,32 @@
 }
 
 
+#pragma mark Playthrough
+
+- (OSStatus) startPlayThroughSync:(BOOL)forUISoundsDevice {
+    // Starting playthrough can block until the HAL has started IO on both devices, which can take
+    // a while and can send notifications that end up calling back into this class, so we copy the
+    // pointer and call Start without holding stateLock.
+    EFFPlayThrough* playThroughPtr;
+
+    @try {
+        [stateLock lock];
+        playThroughPtr = forUISoundsDevice ? &playThrough_UISounds : &playThrough;
+    } @finally {
+        [stateLock unlock];
+    }
+
+    try {
+        playThroughPtr->Start();
+    } catch (const CAException& e) {
+        EFFLogExceptionIn("EFFAudioDeviceManager::startPlayThroughSync", e);
+        return e.GetError();
+    }
+
+    return kAudioHardwareNoError;
+}
+
+
 #pragma mark Output Device
 
 - (NSError* __nullable) setOutputDeviceWithID:(AudioObjectID)deviceID
@@ -265,7 +291,7 @@
                    currentDeviceID:(AudioObjectID)currentDeviceID {
     if (newDeviceID != currentDeviceID) {
         EFFAudioDevice newOutputDevice(newDeviceID);
-//        [self setOutputDeviceForPlaythroughAndControlSync:newOutputDevice];
+        [self setOutputDeviceForPlaythrough:newOutputDevice];
         outputDevice = newOutputDevice;
     }
 
@@ -276,16 +302,13 @@
         [self setDataSource:*dataSourceID device:outputDevice];
     }
 
-//    if (newDeviceID != currentDeviceID) {
-//        // We successfully changed to the new device. Start playthrough on it, since audio might be
-//        // playing. (If we only changed the data source, playthrough will already be running if it
-//        // needs to be.)
-//        playThrough.Start();
-//        playThrough_UISounds.Start();
-//        // But stop playthrough if audio isn't playing, since it uses CPU.
-//        playThrough.StopIfIdle();
-//        playThrough_UISounds.StopIfIdle();
-//    }
+    if (newDeviceID != currentDeviceID) {
+        // We successfully changed to the new device. Start playthrough on it. (If we only changed
+        // the data source, playthrough will already be started.) IO only runs while EFFDevice is
+        // running for other clients, so this doesn't keep the devices busy while nothing's playing.
+        playThrough.Start();
+        playThrough_UISounds.Start();
+    }
 
     CFStringRef outputDeviceUID = outputDevice.CopyDeviceUID();
     DebugMsg("EFFAudioDeviceManager::setOutputDeviceWithIDImpl: Set output device to %s (%d)",
@@ -294,6 +317,14 @@
     CFRelease(outputDeviceUID);
 }
 
+// Throws CAException.
+- (void) setOutputDeviceForPlaythrough:(const EFFAudioDevice&)newOutputDevice {
+    // Stops playthrough on the old device, if it was running.
+    playThrough.SetDevices(*effSoundDevicePtr, newOutputDevice);
+    playThrough_UISounds.SetDevices(effSoundDevicePtr->GetEFFSystemDeviceInstance(),
+                                    newOutputDevice);
+}
+
 - (void) setDataSource:(UInt32)dataSourceID device:(EFFAudioDevice&)device {
     EFFLogAndSwallowExceptions("EFFAudioDeviceManager::setDataSource", ([&] {
         AudioObjectPropertyScope scope = kAudioObjectPropertyScopeOutput;
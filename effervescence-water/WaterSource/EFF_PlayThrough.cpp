@@ -0,0 +1,382 @@
+//
+//  EFF_PlayThrough.cpp
+//  effervescence-app
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_PlayThrough.h"
+
+// Local Includes
+#include "EFF_Types.h"
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+#include "CAHALAudioStream.h"
+
+// STL Includes
+#include <algorithm>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+EFFPlayThrough::EFFPlayThrough()
+:
+    mListenerQueue(dispatch_queue_create("com.nerrons.effervescence.PlayThrough.Listener",
+                                         DISPATCH_QUEUE_SERIAL))
+{
+}
+
+EFFPlayThrough::~EFFPlayThrough()
+{
+    Stop();
+
+    // Wait for any UpdateIOState calls the listener had already dispatched, since they use this
+    // object. The listener has been removed, so no more can be queued.
+    dispatch_sync_f(mListenerQueue, nullptr, [] (void* __nullable) { });
+    dispatch_release(mListenerQueue);
+}
+
+void    EFFPlayThrough::SetDevices(const EFFAudioDevice& inInputDevice,
+                                   const EFFAudioDevice& inOutputDevice)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    Stop();
+
+    mInputDevice = inInputDevice;
+    mOutputDevice = inOutputDevice;
+}
+
+
+#pragma mark Control Playthrough
+
+void    EFFPlayThrough::Start()
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(mStarted)
+    {
+        return;
+    }
+
+    ThrowIf((mInputDevice.GetObjectID() == kAudioObjectUnknown) ||
+                (mOutputDevice.GetObjectID() == kAudioObjectUnknown),
+            CAException(kAudioHardwareBadDeviceError),
+            "EFFPlayThrough::Start: Devices not set");
+
+    mInputDevice.AddPropertyListener(kEFFRunningSomewhereOtherThanEFFAppAddress,
+                                     &EFFPlayThrough::InputDeviceListenerProc,
+                                     this);
+    mStarted = true;
+
+    // A client might have started IO before the listener was added, so check now rather than
+    // waiting for the next notification.
+    try
+    {
+        if(IsInputDeviceRunningSomewhereElse())
+        {
+            StartIO();
+        }
+    }
+    catch(const CAException& e)
+    {
+        EFFLogExceptionIn("EFFPlayThrough::Start", e);
+        Stop();
+        throw;
+    }
+}
+
+void    EFFPlayThrough::Stop()
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(mStarted)
+    {
+        EFFLogAndSwallowExceptions("EFFPlayThrough::Stop", [&] {
+            mInputDevice.RemovePropertyListener(kEFFRunningSomewhereOtherThanEFFAppAddress,
+                                                &EFFPlayThrough::InputDeviceListenerProc,
+                                                this);
+        });
+        mStarted = false;
+    }
+
+    StopIO();
+}
+
+bool    EFFPlayThrough::IsStarted()
+const
+{
+    return mStarted;
+}
+
+bool    EFFPlayThrough::IsRunning()
+const
+{
+    return mInputDeviceIOProcID != nullptr;
+}
+
+
+#pragma mark IOProcs
+
+// static
+OSStatus    EFFPlayThrough::InputDeviceIOProc(AudioObjectID inDevice,
+                                              const AudioTimeStamp* inNow,
+                                              const AudioBufferList* inInputData,
+                                              const AudioTimeStamp* inInputTime,
+                                              AudioBufferList* outOutputData,
+                                              const AudioTimeStamp* inOutputTime,
+                                              void* __nullable inClientData)
+{
+    #pragma unused (inDevice, inNow, outOutputData, inOutputTime)
+
+    EFFPlayThrough* thePlayThrough = static_cast<EFFPlayThrough*>(inClientData);
+
+    if(thePlayThrough && inInputData->mNumberBuffers > 0 && inInputData->mBuffers[0].mData)
+    {
+        const AudioBuffer& theBuffer = inInputData->mBuffers[0];
+        const UInt32 theChannels = std::max(theBuffer.mNumberChannels, 1u);
+        const UInt32 theFrames = theBuffer.mDataByteSize / (theChannels * sizeof(Float32));
+
+        thePlayThrough->mEngine.InputRT(static_cast<const Float32*>(theBuffer.mData),
+                                        theChannels,
+                                        theFrames,
+                                        inInputTime->mSampleTime);
+    }
+
+    return kAudioHardwareNoError;
+}
+
+// static
+OSStatus    EFFPlayThrough::OutputDeviceIOProc(AudioObjectID inDevice,
+                                               const AudioTimeStamp* inNow,
+                                               const AudioBufferList* inInputData,
+                                               const AudioTimeStamp* inInputTime,
+                                               AudioBufferList* outOutputData,
+                                               const AudioTimeStamp* inOutputTime,
+                                               void* __nullable inClientData)
+{
+    #pragma unused (inDevice, inNow, inInputData, inInputTime, inOutputTime)
+
+    EFFPlayThrough* thePlayThrough = static_cast<EFFPlayThrough*>(inClientData);
+
+    // Only the output device's first stream is played through. The HAL has already zeroed the
+    // others.
+    if(thePlayThrough && outOutputData->mNumberBuffers > 0 && outOutputData->mBuffers[0].mData)
+    {
+        AudioBuffer& theBuffer = outOutputData->mBuffers[0];
+        const UInt32 theChannels = std::max(theBuffer.mNumberChannels, 1u);
+        const UInt32 theFrames = theBuffer.mDataByteSize / (theChannels * sizeof(Float32));
+
+        thePlayThrough->mEngine.OutputRT(static_cast<Float32*>(theBuffer.mData),
+                                         theChannels,
+                                         theFrames);
+    }
+
+    return kAudioHardwareNoError;
+}
+
+
+#pragma mark Idle Handling
+
+// static
+OSStatus    EFFPlayThrough::InputDeviceListenerProc(AudioObjectID inObjectID,
+                                                    UInt32 inNumberAddresses,
+                                                    const AudioObjectPropertyAddress* inAddresses,
+                                                    void* __nullable inClientData)
+{
+    #pragma unused (inObjectID, inNumberAddresses, inAddresses)
+
+    EFFPlayThrough* thePlayThrough = static_cast<EFFPlayThrough*>(inClientData);
+
+    if(thePlayThrough)
+    {
+        dispatch_async_f(thePlayThrough->mListenerQueue, thePlayThrough, &EFFPlayThrough::UpdateIOState);
+    }
+
+    return kAudioHardwareNoError;
+}
+
+// static
+void    EFFPlayThrough::UpdateIOState(void* __nullable inContext)
+{
+    EFFPlayThrough* thePlayThrough = static_cast<EFFPlayThrough*>(inContext);
+    EFFAssertNonNull(thePlayThrough);
+
+    CAMutex::Locker theStateLocker(thePlayThrough->mStateMutex);
+
+    // Stop might have been called since the notification was sent.
+    if(!thePlayThrough->mStarted)
+    {
+        return;
+    }
+
+    EFFLogAndSwallowExceptions("EFFPlayThrough::UpdateIOState", [&] {
+        if(thePlayThrough->IsInputDeviceRunningSomewhereElse())
+        {
+            thePlayThrough->StartIO();
+        }
+        else
+        {
+            DebugMsg("EFFPlayThrough::UpdateIOState: EFFDevice is idle. Stopping IO.");
+            thePlayThrough->StopIO();
+        }
+    });
+}
+
+bool    EFFPlayThrough::IsInputDeviceRunningSomewhereElse()
+const
+{
+    CFBooleanRef theIsRunning = static_cast<CFBooleanRef>(
+        mInputDevice.GetPropertyData_CFType(kEFFRunningSomewhereOtherThanEFFAppAddress));
+
+    const bool isRunning = theIsRunning && CFBooleanGetValue(theIsRunning);
+
+    if(theIsRunning)
+    {
+        CFRelease(theIsRunning);
+    }
+
+    return isRunning;
+}
+
+
+#pragma mark Implementation
+
+void    EFFPlayThrough::StartIO()
+{
+    if(IsRunning())
+    {
+        return;
+    }
+
+    DebugMsg("EFFPlayThrough::StartIO: Starting playthrough from %u to %u",
+             mInputDevice.GetObjectID(),
+             mOutputDevice.GetObjectID());
+
+    MatchInputDeviceToOutputDevice();
+
+    // The IOProc only reads the first input stream, which is the one EFFDevice's loopback audio
+    // is on.
+    AudioStreamBasicDescription theInputFormat;
+    CAHALAudioStream(mInputDevice.GetStreamByIndex(/* inIsInput = */ true, 0)).GetCurrentVirtualFormat(theInputFormat);
+
+    mEngine.Allocate(theInputFormat.mChannelsPerFrame,
+                     mInputDevice.GetIOBufferSize(),
+                     mOutputDevice.GetIOBufferSize(),
+                     std::max(GetMaxIOBufferSize(mInputDevice), GetMaxIOBufferSize(mOutputDevice)),
+                     mOutputDevice.GetNominalSampleRate());
+
+    try
+    {
+        mInputDeviceIOProcID = mInputDevice.CreateIOProcID(&EFFPlayThrough::InputDeviceIOProc, this);
+        mOutputDeviceIOProcID = mOutputDevice.CreateIOProcID(&EFFPlayThrough::OutputDeviceIOProc, this);
+
+        // Start the input first so the output has something to play as soon as it starts.
+        mInputDevice.StartIOProc(mInputDeviceIOProcID);
+        mOutputDevice.StartIOProc(mOutputDeviceIOProcID);
+    }
+    catch(const CAException& e)
+    {
+        EFFLogExceptionIn("EFFPlayThrough::StartIO", e);
+        StopIO();
+        throw;
+    }
+}
+
+void    EFFPlayThrough::StopIO()
+{
+    // Destroying the IOProc IDs doesn't return until the HAL has stopped calling the IOProcs, so
+    // after this nothing is using the engine.
+    if(mOutputDeviceIOProcID)
+    {
+        EFFLogAndSwallowExceptions("EFFPlayThrough::StopIO", [&] {
+            mOutputDevice.StopIOProc(mOutputDeviceIOProcID);
+        });
+        EFFLogAndSwallowExceptions("EFFPlayThrough::StopIO", [&] {
+            mOutputDevice.DestroyIOProcID(mOutputDeviceIOProcID);
+        });
+        mOutputDeviceIOProcID = nullptr;
+    }
+
+    if(mInputDeviceIOProcID)
+    {
+        EFFLogAndSwallowExceptions("EFFPlayThrough::StopIO", [&] {
+            mInputDevice.StopIOProc(mInputDeviceIOProcID);
+        });
+        EFFLogAndSwallowExceptions("EFFPlayThrough::StopIO", [&] {
+            mInputDevice.DestroyIOProcID(mInputDeviceIOProcID);
+        });
+        mInputDeviceIOProcID = nullptr;
+    }
+
+    if(mEngine.GetUnderrunCount() > 0 || mEngine.GetOverrunCount() > 0)
+    {
+        DebugMsg("EFFPlayThrough::StopIO: underruns=%llu overruns=%llu",
+                 mEngine.GetUnderrunCount(),
+                 mEngine.GetOverrunCount());
+    }
+}
+
+void    EFFPlayThrough::MatchInputDeviceToOutputDevice()
+{
+    // The engine only makes the tiny rate adjustments needed to correct for clock drift, so if the
+    // nominal sample rates didn't match, the audio would play at the wrong speed. EFFDevice
+    // supports the common rates, so this should only fail for unusual output devices.
+    EFFLogAndSwallowExceptionsMsg("EFFPlayThrough::MatchInputDeviceToOutputDevice",
+                                  "Failed to match the sample rate",
+                                  [&] {
+        const Float64 theSampleRate = mOutputDevice.GetNominalSampleRate();
+
+        if(mInputDevice.GetNominalSampleRate() != theSampleRate &&
+           mInputDevice.IsValidNominalSampleRate(theSampleRate))
+        {
+            DebugMsg("EFFPlayThrough::MatchInputDeviceToOutputDevice: Setting sample rate to %f",
+                     theSampleRate);
+            mInputDevice.SetNominalSampleRate(theSampleRate);
+        }
+    });
+
+    // The input's IO buffer size is the least latency the engine can have, so there's no point
+    // making it any smaller than the output's, and making it larger would add latency.
+    EFFLogAndSwallowExceptionsMsg("EFFPlayThrough::MatchInputDeviceToOutputDevice",
+                                  "Failed to match the IO buffer size",
+                                  [&] {
+        const UInt32 theBufferSize = mOutputDevice.GetIOBufferSize();
+
+        if(mInputDevice.IsIOBufferSizeSettable() && mInputDevice.GetIOBufferSize() != theBufferSize)
+        {
+            mInputDevice.SetIOBufferSize(theBufferSize);
+        }
+    });
+}
+
+// static
+UInt32  EFFPlayThrough::GetMaxIOBufferSize(const EFFAudioDevice& inDevice)
+{
+    UInt32 theMaxBufferSize = inDevice.GetIOBufferSize();
+
+    if(inDevice.HasIOBufferSizeRange())
+    {
+        UInt32 theMinimum;
+        UInt32 theMaximum;
+        inDevice.GetIOBufferSizeRange(theMinimum, theMaximum);
+        theMaxBufferSize = std::max(theMaxBufferSize, theMaximum);
+    }
+
+    if(inDevice.UsesVariableIOBufferSizes())
+    {
+        theMaxBufferSize = std::max(theMaxBufferSize, inDevice.GetMaximumVariableIOBufferSize());
+    }
+
+    return theMaxBufferSize;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,153 @@
+//
+//  EFF_PlayThrough.h
+//  effervescence-app
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Plays the audio from EFFDevice's loopback input stream on the output device. That's how the
+//  system's audio, after EFFDriver has processed it, gets to the user's real device.
+//
+//  An IOProc on EFFDevice reads its input stream and an IOProc on the output device writes to its
+//  output stream. The IOProcs only pass the audio through EFFPlayThroughEngine, which does all the
+//  buffering, so they never allocate, lock or call the HAL. See EFF_PlayThroughEngine.h.
+//
+//  Playthrough only runs IO while EFFDevice is running IO for some client other than EFFApp, so the
+//  IOProcs don't keep both devices (and the CPU) busy while nothing is playing. Once started, it
+//  listens to EFFDevice's kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanEFFApp,
+//  starts IO on both devices when a client starts playing to EFFDevice and stops it again when the
+//  last one stops. EFFDevice's kAudioDevicePropertyDeviceIsRunningSomewhere can't be used for that,
+//  because playthrough's own IOProc keeps it true.
+//
+//  Start and Stop block while the HAL starts and stops IO, so they shouldn't be called while
+//  holding locks the HAL's notification threads might need.
+//
+
+#ifndef EFF_PlayThrough_h
+#define EFF_PlayThrough_h
+
+// Local Includes
+#include "EFF_AudioDevice.h"
+#include "EFF_PlayThroughEngine.h"
+
+// PublicUtility Includes
+#include "CAMutex.h"
+
+// System Includes
+#include <CoreAudio/AudioHardware.h>
+#include <dispatch/dispatch.h>
+
+
+#pragma clang assume_nonnull begin
+
+class EFFPlayThrough
+{
+
+#pragma mark Construction/Destruction
+
+public:
+                        EFFPlayThrough();
+                        ~EFFPlayThrough();
+                        // Disallow copying
+                        EFFPlayThrough(const EFFPlayThrough&) = delete;
+                        EFFPlayThrough& operator=(const EFFPlayThrough&) = delete;
+
+    /*!
+     Set the device to read from (an instance of EFFDevice) and the device to play through. Stops
+     playthrough if it's running.
+     */
+    void                SetDevices(const EFFAudioDevice& inInputDevice,
+                                   const EFFAudioDevice& inOutputDevice);
+
+#pragma mark Control Playthrough
+
+    /*!
+     Start playthrough. IO is started on both devices now if EFFDevice is running for any other
+     client, or otherwise as soon as it is. Before starting IO, EFFDevice's sample rate and IO
+     buffer size are matched to the output device's, if they can be, since the engine only
+     corrects for clock drift and the buffer size sets the lowest latency it can reach.
+
+     @throws CAException If the HAL returns an error or either device hasn't been set.
+     */
+    void                Start();
+    /*!
+     Stop playthrough, including IO on both devices if it's running. Blocks until the IOProcs have
+     returned for the last time.
+     */
+    void                Stop();
+
+    /*! True if playthrough has been started, whether or not IO is running. */
+    bool                IsStarted() const;
+    /*! True if IO is running on the devices. */
+    bool                IsRunning() const;
+
+#pragma mark Statistics
+
+    UInt64              GetUnderrunCount() const { return mEngine.GetUnderrunCount(); }
+    UInt64              GetOverrunCount() const { return mEngine.GetOverrunCount(); }
+    /*! The latency playthrough adds between the two devices, in frames. */
+    UInt32              GetBufferedFrames() const { return mEngine.GetBufferedFrames(); }
+    /*! The current clock drift correction. See EFFPlayThroughEngine::GetRateAdjustment. */
+    Float64             GetRateAdjustment() const { return mEngine.GetRateAdjustment(); }
+
+#pragma mark IOProcs
+
+private:
+    static OSStatus     InputDeviceIOProc(AudioObjectID inDevice,
+                                          const AudioTimeStamp* inNow,
+                                          const AudioBufferList* inInputData,
+                                          const AudioTimeStamp* inInputTime,
+                                          AudioBufferList* outOutputData,
+                                          const AudioTimeStamp* inOutputTime,
+                                          void* __nullable inClientData);
+    static OSStatus     OutputDeviceIOProc(AudioObjectID inDevice,
+                                           const AudioTimeStamp* inNow,
+                                           const AudioBufferList* inInputData,
+                                           const AudioTimeStamp* inInputTime,
+                                           AudioBufferList* outOutputData,
+                                           const AudioTimeStamp* inOutputTime,
+                                           void* __nullable inClientData);
+
+#pragma mark Idle Handling
+
+    // Listens to kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanEFFApp on the input
+    // device. Starting and stopping IO blocks, and mustn't be done on the HAL's notification
+    // thread, so this only dispatches UpdateIOState to mListenerQueue.
+    static OSStatus     InputDeviceListenerProc(AudioObjectID inObjectID,
+                                                UInt32 inNumberAddresses,
+                                                const AudioObjectPropertyAddress* inAddresses,
+                                                void* __nullable inClientData);
+    static void         UpdateIOState(void* __nullable inContext);
+
+    // True if EFFDevice is running IO for a client other than EFFApp. Throws CAException.
+    bool                IsInputDeviceRunningSomewhereElse() const;
+
+#pragma mark Implementation
+
+    // These must be called with mStateMutex held. StartIO throws CAException.
+    void                StartIO();
+    void                StopIO();
+    void                MatchInputDeviceToOutputDevice();
+    // The most frames the device might pass to an IOProc, including if its IO buffer size changes.
+    static UInt32       GetMaxIOBufferSize(const EFFAudioDevice& inDevice);
+
+    CAMutex             mStateMutex { "Playthrough state" };
+
+    EFFAudioDevice      mInputDevice { kAudioObjectUnknown };
+    EFFAudioDevice      mOutputDevice { kAudioObjectUnknown };
+
+    AudioDeviceIOProcID __nullable mInputDeviceIOProcID = nullptr;
+    AudioDeviceIOProcID __nullable mOutputDeviceIOProcID = nullptr;
+
+    // Set between Start and Stop, while the listener is registered on mInputDevice.
+    bool                mStarted = false;
+    dispatch_queue_t    mListenerQueue;
+
+    EFFPlayThroughEngine mEngine;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_PlayThrough_h */
+
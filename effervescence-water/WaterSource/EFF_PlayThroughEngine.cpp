@@ -0,0 +1,374 @@
+//
+//  EFF_PlayThroughEngine.cpp
+//  effervescence-app
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+
+// Self Include
+#include "EFF_PlayThroughEngine.h"
+
+// Local Includes
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <string.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The ring buffer holds this many of the largest IO cycles, which leaves room for the safety
+// margin to grow to several cycles before the writer could overwrite the frames being read.
+static const UInt32 kRingBufferIOCycles = 8;
+
+// The safety margin grows by half an input cycle per underrun, but never less than this.
+static const UInt32 kMinSafetyStepFrames = 32;
+
+// How often the safety margin is checked for frames it can give back. Long enough that the
+// fewest frames left buffered in that time is a fair measure of the jitter the margin has to
+// cover.
+static const Float64 kSafetyCheckSeconds = 30.0;
+// How much faster than the drift correction alone the output consumes input while it drains the
+// frames the margin gave back. 500 ppm is under a hundredth of a semitone.
+static const Float64 kSafetyDrainRate = 0.0005;
+
+// The drift correction only has to make up for the difference between two crystal oscillators,
+// which is normally well under 100 ppm, so it's limited to an adjustment far too small to hear.
+static const Float64 kMaxRateAdjustment = 0.002;
+
+// The time constant of the average the drift controller works from. Long enough to smooth out
+// the jumps as each input cycle arrives.
+static const Float64 kFillAverageSeconds = 2.0;
+// How long to let the average settle after the reader starts before taking it as the target.
+static const Float64 kTargetSettleSeconds = 2.0 * kFillAverageSeconds;
+
+// The natural frequency of the drift control loop, in Hz. The loop is critically damped. It starts
+// at kWideDriftLoopFrequency, so it finds the drift quickly without letting the buffer level wander
+// far, and narrows towards kNarrowDriftLoopFrequency with this time constant, so the jitter left in
+// the average barely moves the adjustment once it has.
+static const Float64 kWideDriftLoopFrequency = 0.05;
+static const Float64 kNarrowDriftLoopFrequency = 0.002;
+static const Float64 kDriftLoopNarrowingSeconds = 20.0;
+
+
+#pragma mark Buffers
+
+void    EFFPlayThroughEngine::Allocate(UInt32 inChannelsPerFrame,
+                                       UInt32 inInputBufferFrames,
+                                       UInt32 inOutputBufferFrames,
+                                       UInt32 inMaxFrames,
+                                       Float64 inSampleRate)
+{
+    EFFAssert(inChannelsPerFrame > 0, "EFFPlayThroughEngine::Allocate: No channels");
+    ThrowIf(!(inSampleRate > 0.0),
+            CAException(kAudioHardwareIllegalOperationError),
+            "EFFPlayThroughEngine::Allocate: Invalid sample rate");
+
+    mChannelsPerFrame = inChannelsPerFrame;
+    mMaxFrames = std::max({ inMaxFrames, inInputBufferFrames, inOutputBufferFrames, 1u });
+    mSampleRate = inSampleRate;
+
+    mConverter.Allocate(mChannelsPerFrame,
+                        inSampleRate,
+                        inSampleRate,
+                        EFF_SampleRateConverter::kQualityMedium,
+                        mMaxFrames,
+                        kMaxRateAdjustment);
+
+    // The most input frames the converter can need for one output cycle: the cycle's frames at the
+    // fastest rate, plus the filter's length, plus one for rounding.
+    const UInt32 theMaxFetchFrames =
+        static_cast<UInt32>(std::ceil(mMaxFrames * (1.0 + kMaxRateAdjustment))) +
+        2 * mConverter.GetLatencyFrames() + 1;
+
+    mRingBuffer.Allocate(mChannelsPerFrame, mMaxFrames * kRingBufferIOCycles + theMaxFetchFrames);
+    mFetchBuffer.assign(static_cast<size_t>(theMaxFetchFrames) * mChannelsPerFrame, 0.0f);
+    mConvertedBuffer.assign(static_cast<size_t>(mMaxFrames) * mChannelsPerFrame, 0.0f);
+
+    // The input arrives a cycle at a time, so the newest input frame can be up to an input cycle
+    // older than it would be if it arrived continuously. That's the least the reader can stay
+    // behind it. Scheduling jitter usually needs a little more, which the underruns add.
+    //
+    // At most, the reader stays far enough behind that two full IO cycles can still be written
+    // without overwriting anything it's about to read.
+    mSafetyFrames.store(inInputBufferFrames, std::memory_order_relaxed);
+    mSafetyStepFrames = std::max(inInputBufferFrames / 2, kMinSafetyStepFrames);
+    mMinSafetyFrames = inInputBufferFrames;
+    mMaxSafetyFrames = mRingBuffer.GetCapacityFrames() - 2 * mMaxFrames - theMaxFetchFrames;
+
+    mInputStarted.store(false, std::memory_order_relaxed);
+    mNextInputTime = 0;
+    mInputDiscontinuities.store(0, std::memory_order_relaxed);
+
+    mReading = false;
+    mReadTime = 0;
+    mSeenInputDiscontinuities = 0;
+
+    mHasTargetFill = false;
+    mDriftIntegral = 0.0;
+    mDriftLoopSeconds = 0.0;
+
+    mBufferedFrames.store(0, std::memory_order_relaxed);
+    mUnderrunCount.store(0, std::memory_order_relaxed);
+    mOverrunCount.store(0, std::memory_order_relaxed);
+    mRateAdjustment.store(0.0, std::memory_order_relaxed);
+    mPeakFillDeviation.store(0.0, std::memory_order_relaxed);
+}
+
+void    EFFPlayThroughEngine::Deallocate()
+{
+    mRingBuffer.Deallocate();
+    mConverter.Deallocate();
+    mFetchBuffer.clear();
+    mFetchBuffer.shrink_to_fit();
+    mConvertedBuffer.clear();
+    mConvertedBuffer.shrink_to_fit();
+
+    mChannelsPerFrame = 0;
+    mMaxFrames = 0;
+    mInputStarted.store(false, std::memory_order_relaxed);
+    mReading = false;
+}
+
+
+#pragma mark IO
+
+void    EFFPlayThroughEngine::InputRT(const Float32* inInput,
+                                      UInt32 inChannelsPerFrame,
+                                      UInt32 inFrames,
+                                      Float64 inSampleTime)
+{
+    if(inChannelsPerFrame != mChannelsPerFrame || inFrames > mMaxFrames)
+    {
+        return;
+    }
+
+    const SampleTime theSampleTime = static_cast<SampleTime>(inSampleTime);
+    const bool wasStarted = mInputStarted.load(std::memory_order_relaxed);
+
+    if(wasStarted && theSampleTime != mNextInputTime)
+    {
+        // The output thread checks this before it reads, so it starts again from the new input
+        // rather than treating the gap as an underrun or overrun.
+        mInputDiscontinuities.fetch_add(1, std::memory_order_release);
+    }
+
+    mRingBuffer.Store(inInput, inFrames, theSampleTime);
+    mNextInputTime = theSampleTime + inFrames;
+
+    if(!wasStarted)
+    {
+        mInputStarted.store(true, std::memory_order_release);
+    }
+}
+
+void    EFFPlayThroughEngine::OutputRT(Float32* outOutput,
+                                       UInt32 inChannelsPerFrame,
+                                       UInt32 inFrames)
+{
+    if(inFrames > mMaxFrames || mChannelsPerFrame == 0)
+    {
+        mUnderrunCount.fetch_add(1, std::memory_order_relaxed);
+        Resync(outOutput, inChannelsPerFrame, inFrames);
+        return;
+    }
+
+    if(!mInputStarted.load(std::memory_order_acquire))
+    {
+        Resync(outOutput, inChannelsPerFrame, inFrames);
+        return;
+    }
+
+    const UInt64 theInputDiscontinuities = mInputDiscontinuities.load(std::memory_order_acquire);
+
+    if(theInputDiscontinuities != mSeenInputDiscontinuities)
+    {
+        mSeenInputDiscontinuities = theInputDiscontinuities;
+        mReading = false;
+    }
+
+    SampleTime theStartTime;
+    SampleTime theEndTime;
+    mRingBuffer.GetTimeBounds(theStartTime, theEndTime);
+
+    const UInt32 theSafetyFrames = mSafetyFrames.load(std::memory_order_relaxed);
+
+    if(!mReading)
+    {
+        mConverter.Reset();
+        mReadTime = theEndTime - mConverter.GetInputFramesNeeded(inFrames) - theSafetyFrames;
+
+        // Just after the input starts, there might not be a margin's worth of it yet. Wait for
+        // more rather than counting it as an overrun.
+        if(mReadTime < theStartTime)
+        {
+            Resync(outOutput, inChannelsPerFrame, inFrames);
+            return;
+        }
+
+        mReading = true;
+
+        mSecondsSinceSync = 0.0;
+        mHasTargetFill = false;
+
+        // The reader starts the (new) margin behind the input, so there's nothing left to drain.
+        mSecondsSinceSafetyCheck = 0.0;
+        mMinHeadroomFrames = UINT32_MAX;
+        mDrainFrames = 0.0;
+    }
+
+    const UInt32 theInputFrames = mConverter.GetInputFramesNeeded(inFrames);
+
+    if(mReadTime + theInputFrames > theEndTime)
+    {
+        // Back off a bit further from the newest input frame so this doesn't keep happening.
+        mUnderrunCount.fetch_add(1, std::memory_order_relaxed);
+        mSafetyFrames.store(std::min(theSafetyFrames + mSafetyStepFrames, mMaxSafetyFrames),
+                            std::memory_order_relaxed);
+        Resync(outOutput, inChannelsPerFrame, inFrames);
+        return;
+    }
+
+    if(mReadTime < theStartTime)
+    {
+        mOverrunCount.fetch_add(1, std::memory_order_relaxed);
+        Resync(outOutput, inChannelsPerFrame, inFrames);
+        return;
+    }
+
+    Float32* theConvertedBuffer = mConvertedBuffer.data();
+
+    mRingBuffer.Fetch(mFetchBuffer.data(), theInputFrames, mReadTime);
+    mConverter.ProcessRT(mFetchBuffer.data(), theInputFrames, theConvertedBuffer, inFrames);
+    mReadTime += theInputFrames;
+
+    const UInt32 theBufferedFrames = static_cast<UInt32>(theEndTime - mReadTime);
+    mBufferedFrames.store(theBufferedFrames, std::memory_order_relaxed);
+    UpdateRateAdjustment(theBufferedFrames, inFrames);
+
+    if(inChannelsPerFrame == mChannelsPerFrame)
+    {
+        memcpy(outOutput, theConvertedBuffer, static_cast<size_t>(inFrames) * inChannelsPerFrame * sizeof(Float32));
+        return;
+    }
+
+    const UInt32 theChannels = std::min(inChannelsPerFrame, mChannelsPerFrame);
+
+    for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++)
+    {
+        const Float32* theInputFrame = &theConvertedBuffer[static_cast<size_t>(theFrame) * mChannelsPerFrame];
+        Float32* theOutputFrame = &outOutput[static_cast<size_t>(theFrame) * inChannelsPerFrame];
+
+        for(UInt32 theChannel = 0; theChannel < inChannelsPerFrame; theChannel++)
+        {
+            theOutputFrame[theChannel] = (theChannel < theChannels) ? theInputFrame[theChannel] : 0.0f;
+        }
+    }
+}
+
+void    EFFPlayThroughEngine::UpdateRateAdjustment(UInt32 inBufferedFrames, UInt32 inFrames)
+{
+    const Float64 theSeconds = inFrames / mSampleRate;
+
+    if(mSecondsSinceSync == 0.0)
+    {
+        mFillAverage = inBufferedFrames;
+    }
+    else
+    {
+        mFillAverage += (inBufferedFrames - mFillAverage) * theSeconds / (kFillAverageSeconds + theSeconds);
+    }
+
+    mSecondsSinceSync += theSeconds;
+
+    if(!mHasTargetFill)
+    {
+        // Keep using the drift estimate while the average settles.
+        if(mSecondsSinceSync >= kTargetSettleSeconds)
+        {
+            mTargetFill = mFillAverage;
+            mHasTargetFill = true;
+        }
+
+        return;
+    }
+
+    const Float64 theDrainAdjustment = UpdateSafetyMargin(inBufferedFrames, theSeconds);
+    const Float64 theError = mFillAverage - mTargetFill;
+
+    if(std::fabs(theError) > mPeakFillDeviation.load(std::memory_order_relaxed))
+    {
+        mPeakFillDeviation.store(std::fabs(theError), std::memory_order_relaxed);
+    }
+
+    // A standard critically damped PI loop. With the error in seconds, the buffer level changes at
+    // (drift - adjustment) seconds per second, so the integral term converges on the drift.
+    mDriftLoopSeconds += theSeconds;
+
+    const Float64 theLoopFrequency = kNarrowDriftLoopFrequency +
+        (kWideDriftLoopFrequency - kNarrowDriftLoopFrequency) * std::exp(-mDriftLoopSeconds / kDriftLoopNarrowingSeconds);
+    const Float64 theOmega = 2.0 * M_PI * theLoopFrequency;
+    const Float64 theErrorSeconds = theError / mSampleRate;
+
+    mDriftIntegral += theOmega * theOmega * theErrorSeconds * theSeconds;
+    mDriftIntegral = std::min(std::max(mDriftIntegral, -kMaxRateAdjustment), kMaxRateAdjustment);
+
+    mConverter.SetRateAdjustmentRT(mDriftIntegral + 2.0 * theOmega * theErrorSeconds + theDrainAdjustment);
+    mRateAdjustment.store(mConverter.GetRateAdjustment(), std::memory_order_relaxed);
+}
+
+Float64 EFFPlayThroughEngine::UpdateSafetyMargin(UInt32 inBufferedFrames, Float64 inSeconds)
+{
+    if(mDrainFrames > 0.0)
+    {
+        // Move the target down at the rate the extra adjustment drains the buffer, so the drift
+        // controller sees no error from it and its estimate of the drift is left alone.
+        const Float64 theCycleFrames = inSeconds * mSampleRate;
+        const Float64 theDrainFrames = std::min(mDrainFrames, kSafetyDrainRate * theCycleFrames);
+
+        mDrainFrames -= theDrainFrames;
+        mTargetFill -= theDrainFrames;
+
+        return theDrainFrames / theCycleFrames;
+    }
+
+    mMinHeadroomFrames = std::min(mMinHeadroomFrames, inBufferedFrames);
+    mSecondsSinceSafetyCheck += inSeconds;
+
+    if(mSecondsSinceSafetyCheck >= kSafetyCheckSeconds)
+    {
+        // Keep half of the headroom the reader didn't use, for jitter it didn't see this time.
+        const UInt32 theSafetyFrames = mSafetyFrames.load(std::memory_order_relaxed);
+        const UInt32 theDecrease = std::min(mMinHeadroomFrames / 2, theSafetyFrames - mMinSafetyFrames);
+
+        if(theDecrease > 0)
+        {
+            mSafetyFrames.store(theSafetyFrames - theDecrease, std::memory_order_relaxed);
+            mDrainFrames = theDecrease;
+        }
+
+        mSecondsSinceSafetyCheck = 0.0;
+        mMinHeadroomFrames = UINT32_MAX;
+    }
+
+    return 0.0;
+}
+
+void    EFFPlayThroughEngine::Resync(Float32* outOutput, UInt32 inChannelsPerFrame, UInt32 inFrames)
+{
+    mReading = false;
+    memset(outOutput, 0, static_cast<size_t>(inFrames) * inChannelsPerFrame * sizeof(Float32));
+}
+
+#pragma clang assume_nonnull end
+
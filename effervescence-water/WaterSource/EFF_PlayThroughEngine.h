@@ -0,0 +1,209 @@
+//
+//  EFF_PlayThroughEngine.h
+//  effervescence-app
+//
+//  Created by Nerrons on 16/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  The device-independent half of EFFPlayThrough. EFFPlayThrough's IOProc on EFFDevice passes the
+//  audio from EFFDevice's loopback input stream to InputRT, which stores it in a single-producer/
+//  single-consumer ring buffer, the same EFF_LoopbackRingBuffer EFFDriver uses. The IOProc on the
+//  output device calls OutputRT, which fetches it back out into the output device's buffer.
+//
+//  The devices have separate sample timelines, so the reader keeps its own position in the input's
+//  timeline. It starts a safety margin behind the newest input frame and moves forward by the
+//  number of frames the output device asks for each cycle. If the input frames it needs haven't
+//  arrived yet (an underrun), the margin is increased and the reader starts again behind the newest
+//  input frame. That way the latency settles at just enough for the devices' IO cycle sizes and
+//  scheduling jitter, rather than a fixed worst case. If the reader falls so far behind that its
+//  frames get overwritten (an overrun), or the input skips, it also starts again.
+//
+//  A burst of jitter shouldn't leave the latency high for good, so the margin also shrinks again.
+//  If the reader never came within some number of frames of underrunning for a while, half that
+//  many are taken off the margin, down to an input cycle, and drained from the buffer by consuming
+//  the input slightly faster for a few seconds, rather than by skipping any of it.
+//
+//  The devices' clocks never run at exactly the same rate, so left alone the reader would slowly
+//  drift towards one end of the buffer until it underran or overran. To stop that, the output goes
+//  through an EFF_SampleRateConverter, and a PI controller adjusts its ratio very slightly to keep
+//  the amount of buffered input at the level it had when the reader started. The buffered amount
+//  jumps by an input cycle whenever the input arrives, so the controller works from a smoothed
+//  average. The adjustments are at most a fraction of a percent, far too small to hear, and the
+//  converter changes its ratio without any discontinuity.
+//
+//  The engine never calls the HAL, so it can also be run headless, without real devices, by
+//  anything that calls InputRT and OutputRT in the pattern the IOProcs would.
+//
+//  Allocate must not be called while IO is running. InputRT must only be called from one thread at
+//  a time, and OutputRT from one thread at a time. They never allocate, block or fail. The Get
+//  methods can be called from any thread.
+//
+
+#ifndef EFF_PlayThroughEngine_h
+#define EFF_PlayThroughEngine_h
+
+// Local Includes
+#include "EFF_LoopbackRingBuffer.h"
+#include "EFF_SampleRateConverter.h"
+
+// System Includes
+#include <MacTypes.h>
+
+// STL Includes
+#include <atomic>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+class EFFPlayThroughEngine
+{
+
+public:
+                        EFFPlayThroughEngine() = default;
+                        // Disallow copying
+                        EFFPlayThroughEngine(const EFFPlayThroughEngine&) = delete;
+                        EFFPlayThroughEngine& operator=(const EFFPlayThroughEngine&) = delete;
+
+#pragma mark Buffers
+
+    /*!
+     Allocate the buffers for the given IO buffer sizes and reset the engine, including its
+     statistics. Not real-time safe.
+
+     @param inChannelsPerFrame The number of channels in the input.
+     @param inInputBufferFrames The input device's IO buffer size.
+     @param inOutputBufferFrames The output device's IO buffer size.
+     @param inMaxFrames The most frames InputRT or OutputRT will be passed at once. Calls with more
+                        are treated as underruns.
+     @param inSampleRate The devices' nominal sample rate.
+     @throws CAException If inSampleRate isn't positive.
+     */
+    void                Allocate(UInt32 inChannelsPerFrame,
+                                 UInt32 inInputBufferFrames,
+                                 UInt32 inOutputBufferFrames,
+                                 UInt32 inMaxFrames,
+                                 Float64 inSampleRate);
+    void                Deallocate();
+
+#pragma mark IO
+
+    /*!
+     Store inFrames frames of interleaved input that start at the input device's sample time
+     inSampleTime. Input thread only.
+
+     @param inChannelsPerFrame If this isn't the number of channels passed to Allocate, the input
+                               is dropped.
+     */
+    void                InputRT(const Float32* inInput,
+                                UInt32 inChannelsPerFrame,
+                                UInt32 inFrames,
+                                Float64 inSampleTime);
+
+    /*!
+     Fill outOutput with the next inFrames frames of input, or silence if there aren't any.
+     Channels beyond the input's are set to silence and ones beyond the output's are dropped.
+     Output thread only.
+     */
+    void                OutputRT(Float32* outOutput,
+                                 UInt32 inChannelsPerFrame,
+                                 UInt32 inFrames);
+
+#pragma mark Statistics
+
+    /*! The number of times the input wasn't ready in time, since Allocate. */
+    UInt64              GetUnderrunCount() const { return mUnderrunCount.load(std::memory_order_relaxed); }
+    /*! The number of times the reader fell far enough behind to lose input, since Allocate. */
+    UInt64              GetOverrunCount() const { return mOverrunCount.load(std::memory_order_relaxed); }
+    /*!
+     The number of input frames that were buffered after the most recent output cycle, i.e. the
+     latency the ring buffer added to it.
+     */
+    UInt32              GetBufferedFrames() const { return mBufferedFrames.load(std::memory_order_relaxed); }
+    /*!
+     How far behind the newest input frame the reader starts, after adapting to any underruns and
+     to the time since the last one.
+     */
+    UInt32              GetSafetyFrames() const { return mSafetyFrames.load(std::memory_order_relaxed); }
+    /*!
+     How much faster than the nominal rate the output is currently consuming input, e.g. 0.0001 if
+     the input device's clock is running 100 ppm fast relative to the output device's.
+     */
+    Float64             GetRateAdjustment() const { return mRateAdjustment.load(std::memory_order_relaxed); }
+    /*!
+     The furthest the smoothed amount of buffered input has been from its target, in frames, since
+     Allocate.
+     */
+    Float64             GetPeakFillDeviation() const { return mPeakFillDeviation.load(std::memory_order_relaxed); }
+
+#pragma mark Implementation
+
+private:
+    typedef EFF_LoopbackRingBuffer::SampleTime SampleTime;
+
+    // Fill outOutput with silence and start reading again next cycle.
+    void                Resync(Float32* outOutput, UInt32 inChannelsPerFrame, UInt32 inFrames);
+
+    // Update the converter's rate adjustment after an output cycle of inFrames frames that left
+    // inBufferedFrames frames of input in the ring buffer.
+    void                UpdateRateAdjustment(UInt32 inBufferedFrames, UInt32 inFrames);
+
+    // Lower the safety margin if the reader hasn't come close to underrunning for a while, and
+    // lower the target fill to drain the frames that frees. Returns the extra rate adjustment to
+    // drain them with this cycle. Only called once the target has been set.
+    Float64             UpdateSafetyMargin(UInt32 inBufferedFrames, Float64 inSeconds);
+
+    EFF_LoopbackRingBuffer mRingBuffer;
+    UInt32              mChannelsPerFrame       = 0;
+    UInt32              mMaxFrames              = 0;
+
+    // Written by the input thread.
+    std::atomic<bool>   mInputStarted           { false };
+    SampleTime          mNextInputTime          = 0;
+    // Incremented when the input's sample time doesn't follow on from the previous call.
+    std::atomic<UInt64> mInputDiscontinuities   { 0 };
+
+    // Only used by the output thread.
+    EFF_SampleRateConverter mConverter;
+    std::vector<Float32> mFetchBuffer;
+    std::vector<Float32> mConvertedBuffer;
+    bool                mReading                = false;
+    SampleTime          mReadTime               = 0;
+    UInt64              mSeenInputDiscontinuities = 0;
+    UInt32              mSafetyStepFrames       = 0;
+    UInt32              mMinSafetyFrames        = 0;
+    UInt32              mMaxSafetyFrames        = 0;
+
+    // The safety margin's decay. Also only used by the output thread. The fewest frames left
+    // buffered after any output cycle since the margin was last checked, and the frames still to
+    // drain after lowering it.
+    Float64             mSecondsSinceSafetyCheck = 0.0;
+    UInt32              mMinHeadroomFrames      = 0;
+    Float64             mDrainFrames            = 0.0;
+
+    // The drift controller. Also only used by the output thread. The target isn't set until the
+    // average has had time to settle after the reader starts. The integral term is the estimate of
+    // the clocks' relative drift, so it's kept when the reader starts again, as is the loop's
+    // bandwidth, which narrows with mDriftLoopSeconds.
+    Float64             mSampleRate             = 0.0;
+    Float64             mFillAverage            = 0.0;
+    Float64             mTargetFill             = 0.0;
+    Float64             mSecondsSinceSync       = 0.0;
+    bool                mHasTargetFill          = false;
+    Float64             mDriftIntegral          = 0.0;
+    Float64             mDriftLoopSeconds       = 0.0;
+
+    // Written by the output thread.
+    std::atomic<UInt32> mSafetyFrames           { 0 };
+    std::atomic<UInt32> mBufferedFrames         { 0 };
+    std::atomic<UInt64> mUnderrunCount          { 0 };
+    std::atomic<UInt64> mOverrunCount           { 0 };
+    std::atomic<Float64> mRateAdjustment        { 0.0 };
+    std::atomic<Float64> mPeakFillDeviation     { 0.0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* EFF_PlayThroughEngine_h */
+
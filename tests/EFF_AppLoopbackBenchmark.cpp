@@ -0,0 +1,171 @@
+//
+//  EFF_AppLoopbackBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Runs EFF_AppLoopback's IO cycle (MixClientRT for each client, EndCycleRT, then FetchRT for the
+//  per-app loopback stream's ReadInput) for 1 to kMaxPairs selected stereo apps at 48 kHz, and
+//  prints the time per cycle and the memory it moves. The stream is sized to the selection, so
+//  both should grow with the number of pairs. The bytes moved are counted logically: each client's
+//  buffer read and written into its pair, and the cycle buffer read and written by both the store
+//  and the fetch.
+//
+//  Every 16th cycle's fetched audio is checked against the sum of the clients in each pair.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_AppLoopback.h"
+
+// STL Includes
+#include <cmath>
+#include <vector>
+
+
+static const UInt32 kChannelsPerPair = 2;
+static const Float64 kSampleRate = 48000.0;
+static const UInt32 kCapacityFrames = 16384;
+
+static const UInt32 kPairCounts[] = { 1, 2, 4, 8, 16 };
+static const UInt32 kCycleFrames[] = { 128, 512 };
+
+static Float32 SampleFor(UInt32 inClient, UInt64 inFrame, UInt32 inChannel)
+{
+    return static_cast<Float32>(static_cast<SInt32>((inClient * 7919 + inFrame * 31 + inChannel * 17) % 2001) - 1000) / 1000.0f;
+}
+
+static void Benchmark(UInt32 inPairCount, UInt32 inClientsPerPair, UInt32 inCycleFrames, Float64 inSeconds)
+{
+    EFF_AppLoopback theLoopback;
+    theLoopback.Allocate(kChannelsPerPair, inPairCount, kCapacityFrames);
+
+    const UInt32 theChannels = theLoopback.GetChannelsPerFrame();
+    const UInt32 theClients = inPairCount * inClientsPerPair;
+
+    std::vector<std::vector<Float32>> theClientBuffers(theClients, std::vector<Float32>(inCycleFrames * kChannelsPerPair));
+    std::vector<Float32> theFetched(inCycleFrames * theChannels);
+
+    const UInt64 theCycles = static_cast<UInt64>(inSeconds * kSampleRate / inCycleFrames);
+    std::vector<double> theTimes;
+    theTimes.reserve(theCycles);
+
+    UInt64 theWrongSamples = 0;
+
+    for(UInt64 theCycle = 0; theCycle < theCycles; theCycle++)
+    {
+        const UInt64 theSampleTime = theCycle * inCycleFrames;
+
+        for(UInt32 theClient = 0; theClient < theClients; theClient++)
+        {
+            for(UInt32 theFrame = 0; theFrame < inCycleFrames; theFrame++)
+            {
+                for(UInt32 theChannel = 0; theChannel < kChannelsPerPair; theChannel++)
+                {
+                    theClientBuffers[theClient][theFrame * kChannelsPerPair + theChannel] =
+                        SampleFor(theClient, theSampleTime + theFrame, theChannel);
+                }
+            }
+        }
+
+        const double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theClient = 0; theClient < theClients; theClient++)
+        {
+            theLoopback.MixClientRT(theClient % inPairCount,
+                                    theClientBuffers[theClient].data(),
+                                    inCycleFrames,
+                                    static_cast<Float64>(theSampleTime));
+        }
+
+        theLoopback.EndCycleRT(inCycleFrames, static_cast<Float64>(theSampleTime));
+        theLoopback.FetchRT(theFetched.data(), inCycleFrames, static_cast<Float64>(theSampleTime), nullptr);
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) * 1e9);
+
+        EFF_TestHarness::DoNotOptimise(theFetched.data());
+
+        if(theCycle % 16 != 0)
+        {
+            continue;
+        }
+
+        for(UInt32 theFrame = 0; theFrame < inCycleFrames; theFrame++)
+        {
+            for(UInt32 thePair = 0; thePair < inPairCount; thePair++)
+            {
+                for(UInt32 theChannel = 0; theChannel < kChannelsPerPair; theChannel++)
+                {
+                    Float32 theExpected = 0.0f;
+
+                    // The clients are mixed in this order too, so the sums match exactly.
+                    for(UInt32 theClient = thePair; theClient < theClients; theClient += inPairCount)
+                    {
+                        theExpected += SampleFor(theClient, theSampleTime + theFrame, theChannel);
+                    }
+
+                    const Float32 theSample = theFetched[theFrame * theChannels + thePair * kChannelsPerPair + theChannel];
+
+                    if(std::fabs(theSample - theExpected) > 1e-5f)
+                    {
+                        theWrongSamples++;
+                    }
+                }
+            }
+        }
+    }
+
+    EFFCheck(theWrongSamples == 0);
+
+    const EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(theTimes);
+
+    const double theCyclesPerSecond = kSampleRate / inCycleFrames;
+    const double theClientBytes = static_cast<double>(inCycleFrames) * kChannelsPerPair * sizeof(Float32);
+    const double theCycleBytes = static_cast<double>(inCycleFrames) * theChannels * sizeof(Float32);
+    const double theBytesPerCycle = theClients * 2.0 * theClientBytes + 4.0 * theCycleBytes;
+
+    printf("%6u %8u %8u %10.0f %10.0f %10.0f %12.1f %12.2f %12.2f %8.3f\n",
+           inCycleFrames,
+           inPairCount,
+           theClients,
+           theStats.mMean,
+           theStats.mP50,
+           theStats.mP99,
+           theBytesPerCycle / 1024.0,
+           theBytesPerCycle * theCyclesPerSecond / 1e6,
+           theChannels * sizeof(Float32) * kSampleRate / 1e6,
+           theStats.mMean * 1e-9 * theCyclesPerSecond * 100.0);
+}
+
+int main(int argc, char* argv[])
+{
+    const Float64 theSeconds = EFF_TestHarness::IsQuick(argc, argv) ? 2.0 : 60.0;
+
+    EFF_TestHarness::PinThreadToCPU(0);
+
+    printf("Stereo pairs at %.0f kHz, one client per pair, %.0f s of audio per run:\n",
+           kSampleRate / 1000.0, theSeconds);
+    printf("%6s %8s %8s %10s %10s %10s %12s %12s %12s %8s\n",
+           "frames", "pairs", "clients", "mean ns", "p50 ns", "p99 ns",
+           "KB/cycle", "moved MB/s", "stream MB/s", "CPU %");
+
+    for(UInt32 theCycleFrames : kCycleFrames)
+    {
+        for(UInt32 thePairCount : kPairCounts)
+        {
+            Benchmark(thePairCount, 1, theCycleFrames, theSeconds);
+        }
+    }
+
+    printf("\nFour clients per pair (e.g. an app with several audio clients), 512 frame cycles:\n");
+
+    for(UInt32 thePairCount : kPairCounts)
+    {
+        Benchmark(thePairCount, 4, 512, theSeconds);
+    }
+
+    return EFF_TestHarness::Finish("EFF_AppLoopbackBenchmark");
+}
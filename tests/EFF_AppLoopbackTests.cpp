@@ -0,0 +1,191 @@
+//
+//  EFF_AppLoopbackTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Checks that EFF_AppLoopback's frames only have the pairs it was allocated with, that clients
+//  sharing a pair are summed, that pairs nobody played into are silent even after an earlier cycle
+//  used them, and that clients whose pair the stream doesn't have yet are ignored. Runs with stereo
+//  pairs, which have their own code path, and with 6 channel pairs.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_AppLoopback.h"
+
+// STL Includes
+#include <vector>
+
+
+static const UInt32 kCapacityFrames = 4096;
+static const UInt32 kCycleFrames = 256;
+
+static Float32 SampleFor(UInt32 inClient, UInt64 inFrame, UInt32 inChannel)
+{
+    return static_cast<Float32>(static_cast<SInt32>((inClient * 7919 + inFrame * 31 + inChannel * 17) % 2001) - 1000) / 1024.0f;
+}
+
+static std::vector<Float32> ClientBuffer(UInt32 inClient, UInt32 inChannelsPerPair, Float64 inSampleTime)
+{
+    std::vector<Float32> theBuffer(kCycleFrames * inChannelsPerPair);
+
+    for(UInt32 theFrame = 0; theFrame < kCycleFrames; theFrame++)
+    {
+        for(UInt32 theChannel = 0; theChannel < inChannelsPerPair; theChannel++)
+        {
+            theBuffer[theFrame * inChannelsPerPair + theChannel] =
+                SampleFor(inClient, static_cast<UInt64>(inSampleTime) + theFrame, theChannel);
+        }
+    }
+
+    return theBuffer;
+}
+
+// Checks that inPair of inFetched has the sum of inClients' audio, or silence if there are none.
+static bool PairMatches(const std::vector<Float32>& inFetched,
+                        UInt32 inPairCount,
+                        UInt32 inChannelsPerPair,
+                        UInt32 inPair,
+                        const std::vector<UInt32>& inClients,
+                        Float64 inSampleTime)
+{
+    const UInt32 theStride = inPairCount * inChannelsPerPair;
+
+    for(UInt32 theFrame = 0; theFrame < kCycleFrames; theFrame++)
+    {
+        for(UInt32 theChannel = 0; theChannel < inChannelsPerPair; theChannel++)
+        {
+            Float32 theExpected = 0.0f;
+
+            for(UInt32 theClient : inClients)
+            {
+                theExpected += SampleFor(theClient, static_cast<UInt64>(inSampleTime) + theFrame, theChannel);
+            }
+
+            if(inFetched[theFrame * theStride + inPair * inChannelsPerPair + theChannel] != theExpected)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void TestPairs(UInt32 inChannelsPerPair)
+{
+    const UInt32 thePairCount = 3;
+
+    EFF_AppLoopback theLoopback;
+    EFFCheck(theLoopback.GetPairCount() == 0);
+    EFFCheck(theLoopback.GetChannelsPerFrame() == 0);
+
+    theLoopback.Allocate(inChannelsPerPair, thePairCount, kCapacityFrames);
+    EFFCheck(theLoopback.GetPairCount() == thePairCount);
+    EFFCheck(theLoopback.GetChannelsPerFrame() == thePairCount * inChannelsPerPair);
+
+    std::vector<Float32> theFetched(kCycleFrames * theLoopback.GetChannelsPerFrame());
+
+    // Cycle 1: clients 0 and 1 share pair 0, client 2 has pair 1 and nobody plays into pair 2.
+    // Client 3 has pair 3, which the stream doesn't have yet.
+    Float64 theSampleTime = 1000.0;
+
+    theLoopback.MixClientRT(0, ClientBuffer(0, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    theLoopback.MixClientRT(1, ClientBuffer(2, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    theLoopback.MixClientRT(0, ClientBuffer(1, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    theLoopback.MixClientRT(3, ClientBuffer(3, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, theSampleTime, nullptr) == kEFFRingBufferError_OK);
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 0, { 0, 1 }, theSampleTime));
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 1, { 2 }, theSampleTime));
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 2, { }, theSampleTime));
+
+    // Cycle 2: only pair 2 plays, so pairs 0 and 1 have to be silenced rather than keep cycle 1's
+    // audio.
+    theSampleTime += kCycleFrames;
+
+    theLoopback.MixClientRT(2, ClientBuffer(4, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, theSampleTime, nullptr) == kEFFRingBufferError_OK);
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 0, { }, theSampleTime));
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 1, { }, theSampleTime));
+    EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, 2, { 4 }, theSampleTime));
+
+    // Cycle 3: only the client without a pair plays, so nothing is stored and the cycle is silent.
+    theSampleTime += kCycleFrames;
+
+    theLoopback.MixClientRT(3, ClientBuffer(3, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+
+    UInt32 theSilentFrames = 0;
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, theSampleTime, &theSilentFrames) == kEFFRingBufferError_OK);
+    EFFCheck(theSilentFrames == kCycleFrames);
+
+    for(UInt32 thePair = 0; thePair < thePairCount; thePair++)
+    {
+        EFFCheck(PairMatches(theFetched, thePairCount, inChannelsPerPair, thePair, { }, theSampleTime));
+    }
+
+    // Resizing for a bigger selection gives client 3 its pair and discards the earlier audio.
+    theLoopback.Allocate(inChannelsPerPair, 4, kCapacityFrames);
+    EFFCheck(theLoopback.GetChannelsPerFrame() == 4 * inChannelsPerPair);
+
+    theFetched.assign(kCycleFrames * theLoopback.GetChannelsPerFrame(), 1.0f);
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, 1000.0, &theSilentFrames) == kEFFRingBufferError_OK);
+    EFFCheck(theSilentFrames == kCycleFrames);
+
+    theSampleTime += kCycleFrames;
+
+    theLoopback.MixClientRT(3, ClientBuffer(3, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, theSampleTime, nullptr) == kEFFRingBufferError_OK);
+    EFFCheck(PairMatches(theFetched, 4, inChannelsPerPair, 0, { }, theSampleTime));
+    EFFCheck(PairMatches(theFetched, 4, inChannelsPerPair, 3, { 3 }, theSampleTime));
+
+    theLoopback.Deallocate();
+    EFFCheck(theLoopback.GetPairCount() == 0);
+    EFFCheck(theLoopback.GetChannelsPerFrame() == 0);
+
+    // Clients are ignored while it isn't allocated.
+    theLoopback.MixClientRT(0, ClientBuffer(0, inChannelsPerPair, theSampleTime).data(), kCycleFrames, theSampleTime);
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+}
+
+static void TestMaxPairs()
+{
+    EFF_AppLoopback theLoopback;
+    theLoopback.Allocate(2, EFF_AppLoopback::kMaxPairs, kCapacityFrames);
+
+    const UInt32 thePairCount = EFF_AppLoopback::kMaxPairs;
+    std::vector<Float32> theFetched(kCycleFrames * theLoopback.GetChannelsPerFrame());
+    const Float64 theSampleTime = 0.0;
+
+    for(UInt32 thePair = 0; thePair < thePairCount; thePair++)
+    {
+        theLoopback.MixClientRT(thePair, ClientBuffer(thePair, 2, theSampleTime).data(), kCycleFrames, theSampleTime);
+    }
+
+    EFFCheck(theLoopback.EndCycleRT(kCycleFrames, theSampleTime) == kEFFRingBufferError_OK);
+    EFFCheck(theLoopback.FetchRT(theFetched.data(), kCycleFrames, theSampleTime, nullptr) == kEFFRingBufferError_OK);
+
+    for(UInt32 thePair = 0; thePair < thePairCount; thePair++)
+    {
+        EFFCheck(PairMatches(theFetched, thePairCount, 2, thePair, { thePair }, theSampleTime));
+    }
+}
+
+int main()
+{
+    TestPairs(2);
+    TestPairs(6);
+    TestMaxPairs();
+
+    return EFF_TestHarness::Finish("EFF_AppLoopbackTests");
+}
@@ -0,0 +1,202 @@
+//
+//  EFF_AudioKernelsBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Times applying a client's pan and volume to a stereo buffer with EFF_AudioKernels'
+//  ApplyPanGainMatrix against the old separate passes (EFF_OldPanAndVolume.h), for IO buffer sizes
+//  from the smallest the HAL uses to the largest.
+//
+//  Also times each channel count's kernel (the stereo, 1, 6 and 8 channel specialisations and the
+//  generic version for 3 and 16 channels) against a plain loop (EFF_NaivePanGainMatrix.h).
+//
+//  Also times the audibility check EFF_AudibleState does for every client every cycle, old scalar
+//  loop (EFF_OldBufferIsAudible.h) against AnySampleOutsideFirstFrameMargin, for 32 clients playing
+//  silent, near-silent and loud audio.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_NaivePanGainMatrix.h"
+#include "EFF_OldBufferIsAudible.h"
+#include "EFF_OldPanAndVolume.h"
+
+// Unit Include
+#include "EFF_AudioKernels.h"
+
+// STL Includes
+#include <cmath>
+#include <vector>
+
+
+static const UInt32 kFrameCounts[] = { 14, 64, 512, 4096 };
+
+// The mean time per call, in nanoseconds, of each of inRepeats runs of inCalls calls, summarised.
+template <typename F>
+static EFF_TestHarness::Stats TimeCalls(UInt32 inRepeats, UInt32 inCalls, F inFunction)
+{
+    std::vector<double> theTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theCall = 0; theCall < inCalls; theCall++)
+        {
+            inFunction();
+        }
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) / inCalls * 1e9);
+    }
+
+    return EFF_TestHarness::Summarise(theTimes);
+}
+
+static void Benchmark(const char* inName, Float32 inVolume, Float32 inPanPosition, bool inQuick)
+{
+    const EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(inVolume, inPanPosition);
+
+    printf("%s (volume %.2f, pan %.2f):\n", inName, inVolume, inPanPosition);
+
+    for(UInt32 theFrames : kFrameCounts)
+    {
+        // Each call gets a fresh copy of the input. Otherwise, applying the volume over and over
+        // would make the samples denormal, which would make both versions much slower. The copy
+        // costs the same for both.
+        const std::vector<Float32> theInput(theFrames * 2, 0.25f);
+        std::vector<Float32> theBuffer(theInput.size());
+        const UInt32 theCalls = std::max(1u, (inQuick ? 20000u : 2000000u) / theFrames);
+        const UInt32 theRepeats = inQuick ? 3 : 30;
+
+        EFF_TestHarness::Stats theOld = TimeCalls(theRepeats, theCalls, [&] {
+            memcpy(theBuffer.data(), theInput.data(), theInput.size() * sizeof(Float32));
+            EFF_OldApplyPanAndVolume(inVolume, inPanPosition, theFrames, theBuffer.data());
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        EFF_TestHarness::Stats theNew = TimeCalls(theRepeats, theCalls, [&] {
+            memcpy(theBuffer.data(), theInput.data(), theInput.size() * sizeof(Float32));
+            EFF_AudioKernels::ApplyPanGainMatrix(theMatrix, 2, inVolume != 1.0f, theBuffer.data(), theFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        printf("  %4u frames: separate passes %7.1f ns, matrix %7.1f ns (p50s), %.2f ns/frame, speed-up %.1fx\n",
+               theFrames,
+               theOld.mP50,
+               theNew.mP50,
+               theNew.mP50 / theFrames,
+               theOld.mP50 / theNew.mP50);
+    }
+}
+
+static void BenchmarkChannelCounts(bool inQuick)
+{
+    const UInt32 kFrames = 512;
+    const EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(0.8f, 0.3f);
+
+    printf("pan and volume by channel count, %u frames:\n", kFrames);
+
+    for(UInt32 theChannels : { 1u, 2u, 3u, 6u, 8u, 16u })
+    {
+        // A fresh copy of the input for each call, as in Benchmark.
+        const std::vector<Float32> theInput(kFrames * theChannels, 0.25f);
+        std::vector<Float32> theBuffer(theInput.size());
+        const UInt32 theCalls = std::max(1u, (inQuick ? 20000u : 2000000u) / (kFrames * theChannels / 2));
+        const UInt32 theRepeats = inQuick ? 3 : 30;
+
+        EFF_TestHarness::Stats theNaive = TimeCalls(theRepeats, theCalls, [&] {
+            memcpy(theBuffer.data(), theInput.data(), theInput.size() * sizeof(Float32));
+            EFF_NaiveApplyPanGainMatrix(theMatrix, theChannels, true, theBuffer.data(), kFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        EFF_TestHarness::Stats theKernel = TimeCalls(theRepeats, theCalls, [&] {
+            memcpy(theBuffer.data(), theInput.data(), theInput.size() * sizeof(Float32));
+            EFF_AudioKernels::ApplyPanGainMatrix(theMatrix, theChannels, true, theBuffer.data(), kFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        printf("  %2u channels: plain loop %8.1f ns, kernel %8.1f ns (p50s), %.2f ns/sample, speed-up %.1fx\n",
+               theChannels,
+               theNaive.mP50,
+               theKernel.mP50,
+               theKernel.mP50 / (kFrames * theChannels),
+               theNaive.mP50 / theKernel.mP50);
+    }
+}
+
+static void BenchmarkAudibility(bool inQuick)
+{
+    const UInt32 kClients = 32;
+    const UInt32 kFrames = 512;
+
+    // Silent and near-silent buffers have to be checked all the way through. Loud ones return at
+    // the second frame.
+    const char* const theNames[] = { "silent", "near-silent", "loud" };
+
+    printf("audibility check, %u clients, %u frames each, per IO cycle:\n", kClients, kFrames);
+
+    for(UInt32 theKind = 0; theKind < 3; theKind++)
+    {
+        std::vector<std::vector<Float32>> theClientBuffers(kClients, std::vector<Float32>(kFrames * 2));
+        UInt32 theSeed = 3;
+
+        for(std::vector<Float32>& theBuffer : theClientBuffers)
+        {
+            for(UInt32 i = 0; i < theBuffer.size(); i++)
+            {
+                theSeed = theSeed * 1664525 + 1013904223;
+                const Float32 theNoise = static_cast<Float32>(theSeed >> 8) / 16777216.0f - 0.5f;
+
+                theBuffer[i] = (theKind == 0) ? 0.0f :
+                               (theKind == 1) ? theNoise * kSampleVolumeMarginRaw :
+                                                0.5f * std::sin(static_cast<Float32>(i / 2) * 0.05f) + theNoise * 0.01f;
+            }
+        }
+
+        const UInt32 theCalls = inQuick ? 100 : 20000;
+        const UInt32 theRepeats = inQuick ? 3 : 20;
+        UInt32 theAudible = 0;
+
+        EFF_TestHarness::Stats theOld = TimeCalls(theRepeats, theCalls, [&] {
+            for(const std::vector<Float32>& theBuffer : theClientBuffers)
+            {
+                theAudible += EFF_OldBufferIsAudible(kFrames, theBuffer.data());
+            }
+        });
+
+        EFF_TestHarness::Stats theNew = TimeCalls(theRepeats, theCalls, [&] {
+            for(const std::vector<Float32>& theBuffer : theClientBuffers)
+            {
+                theAudible += EFF_AudioKernels::AnySampleOutsideFirstFrameMargin(theBuffer.data(),
+                                                                                 2,
+                                                                                 kFrames,
+                                                                                 kSampleVolumeMarginRaw);
+            }
+        });
+
+        EFF_TestHarness::DoNotOptimise(theAudible);
+
+        printf("  %-11s scalar loop %8.1f ns, vectorised %8.1f ns (p50s), speed-up %.1fx\n",
+               theNames[theKind],
+               theOld.mP50,
+               theNew.mP50,
+               theOld.mP50 / theNew.mP50);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+
+    Benchmark("pan and volume", 0.8f, 0.3f, theQuick);
+    Benchmark("pan only", 1.0f, -0.3f, theQuick);
+    Benchmark("volume only", 0.8f, 0.0f, theQuick);
+    BenchmarkChannelCounts(theQuick);
+    BenchmarkAudibility(theQuick);
+
+    return 0;
+}
+
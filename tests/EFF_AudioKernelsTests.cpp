@@ -0,0 +1,354 @@
+//
+//  EFF_AudioKernelsTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Compares EFF_AudioKernels::ApplyPanGainMatrix with the old separate pan and volume passes
+//  (EFF_OldPanAndVolume.h) for every pan position a client can have, a range of volumes and buffer
+//  sizes that exercise both the vector loops and their scalar tails. See the discussion of
+//  MakePanGainMatrix in EFF_AudioKernels.h for the differences this allows.
+//
+//  Checks the kernels for other channel counts (the 1, 6 and 8 channel specialisations and the
+//  generic version) against a plain loop (EFF_NaivePanGainMatrix.h), and which channels count as
+//  unpaired.
+//
+//  Also checks that AnySampleOutsideFirstFrameMargin gives exactly the same results as the old
+//  scalar loop in EFF_AudibleState::BufferIsAudible (EFF_OldBufferIsAudible.h), including at the
+//  edges of the margin and for non-finite samples.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_NaivePanGainMatrix.h"
+#include "EFF_OldBufferIsAudible.h"
+#include "EFF_OldPanAndVolume.h"
+
+// Unit Include
+#include "EFF_AudioKernels.h"
+
+// STL Includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+
+static const Float32 kVolumes[] = { 0.0f, 0.1f, 0.25f, 0.5f, 0.70710678f, 0.9f, 1.0f, 1.1f, 1.5f, 2.0f, 4.0f };
+static const UInt32 kFrameCounts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 14, 15, 16, 17, 31, 64, 511, 512, 4096 };
+
+// Samples in [-1.5, 1.5], so the clipping gets tested as well.
+static std::vector<Float32> MakeSignal(UInt32 inFrames, UInt32 inSeed)
+{
+    std::vector<Float32> theSignal(inFrames * 2);
+
+    for(Float32& theSample : theSignal)
+    {
+        inSeed = inSeed * 1664525 + 1013904223;
+        theSample = (static_cast<Float32>(inSeed >> 8) / 16777216.0f - 0.5f) * 3.0f;
+    }
+
+    return theSignal;
+}
+
+// The distance between two floats in units in the last place.
+static UInt32 ULPs(Float32 inA, Float32 inB)
+{
+    if(inA == inB)
+    {
+        return 0;
+    }
+
+    SInt32 theA, theB;
+    memcpy(&theA, &inA, sizeof(theA));
+    memcpy(&theB, &inB, sizeof(theB));
+    theA = (theA < 0) ? static_cast<SInt32>(0x80000000u - static_cast<UInt32>(theA)) : theA;
+    theB = (theB < 0) ? static_cast<SInt32>(0x80000000u - static_cast<UInt32>(theB)) : theB;
+
+    return static_cast<UInt32>(std::abs(static_cast<SInt64>(theA) - theB));
+}
+
+static void TestAgainstOldCode()
+{
+    UInt32 theMaxULPs = 0;
+    double theMaxDifference = 0;
+    UInt64 theSamples = 0, theDifferentSamples = 0;
+
+    for(SInt32 thePanPositionInt = -100; thePanPositionInt <= 100; thePanPositionInt++)
+    {
+        // As in EFF_Device::ApplyClientRelativeVolume.
+        const Float32 thePanPosition = static_cast<Float32>(thePanPositionInt) / 100.0f;
+
+        for(Float32 theVolume : kVolumes)
+        {
+            const EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(theVolume, thePanPosition);
+
+            for(UInt32 theFrames : kFrameCounts)
+            {
+                const std::vector<Float32> theIn = MakeSignal(theFrames, thePanPositionInt * 1000 + theFrames);
+                std::vector<Float32> theOld = theIn;
+                std::vector<Float32> theNew = theIn;
+
+                EFF_OldApplyPanAndVolume(theVolume, thePanPosition, theFrames, theOld.data());
+
+                // EFF_Device skips the identity matrix.
+                if(!theMatrix.IsIdentity())
+                {
+                    EFF_AudioKernels::ApplyPanGainMatrix(theMatrix, 2, theVolume != 1.0f, theNew.data(), theFrames);
+                }
+
+                for(UInt32 i = 0; i < theFrames * 2; i++)
+                {
+                    const bool theIsLeft = (i % 2 == 0);
+                    const Float32 L = theIn[i - (theIsLeft ? 0 : 1)];
+                    const Float32 R = theIn[i + (theIsLeft ? 1 : 0)];
+
+                    // The two terms the output sample is the sum of.
+                    const double theTermsMagnitude = theIsLeft ?
+                        std::fabs(static_cast<double>(theMatrix.mPair.mLL) * L) +
+                            std::fabs(static_cast<double>(theMatrix.mPair.mRL) * R) :
+                        std::fabs(static_cast<double>(theMatrix.mPair.mLR) * L) +
+                            std::fabs(static_cast<double>(theMatrix.mPair.mRR) * R);
+
+                    // Each version rounds at most three times, by at most half an ulp of the terms'
+                    // magnitude each time. Clipping can only bring the results closer together.
+                    const double theTolerance = 4.0 * FLT_EPSILON * theTermsMagnitude + FLT_MIN;
+                    const double theDifference = std::fabs(static_cast<double>(theNew[i]) - theOld[i]);
+
+                    EFFCheck(theDifference <= theTolerance);
+
+                    // A channel that's only scaled, i.e. every channel if the client isn't panned, or
+                    // the side the client is panned away from if its volume is 1, should be exactly
+                    // the same.
+                    const bool theIsOnlyScaled =
+                        (thePanPositionInt == 0) ||
+                        (theVolume == 1.0f && (theIsLeft ? thePanPositionInt > 0 : thePanPositionInt < 0));
+
+                    if(theIsOnlyScaled)
+                    {
+                        EFFCheck(theNew[i] == theOld[i]);
+                    }
+
+                    theMaxULPs = std::max(theMaxULPs, ULPs(theNew[i], theOld[i]));
+                    theMaxDifference = std::max(theMaxDifference, theDifference);
+                    theDifferentSamples += (theNew[i] != theOld[i]);
+                    theSamples++;
+                }
+            }
+        }
+    }
+
+    // Near zero, where the two terms cancel, the ulps can be large even though the difference isn't.
+    printf("against the old code: %llu of %llu samples differ, by at most %g (%u ulps of the result)\n",
+           static_cast<unsigned long long>(theDifferentSamples),
+           static_cast<unsigned long long>(theSamples),
+           theMaxDifference,
+           theMaxULPs);
+}
+
+// The matrix multiplies the other channel of each pair by 0 rather than skipping it, which spreads
+// non-finite samples across the pair.
+static void TestNonFiniteSamples()
+{
+    Float32 theBuffer[] = { 0.5f, NAN, 0.5f, INFINITY };
+    EFF_AudioKernels::ApplyPanGainMatrix(EFF_AudioKernels::MakePanGainMatrix(0.5f, 0.0f), 2, false, theBuffer, 2);
+    EFFCheck(std::isnan(theBuffer[0]));
+    EFFCheck(std::isnan(theBuffer[1]));
+    EFFCheck(std::isnan(theBuffer[2]));
+
+    // The old code kept them separate.
+    Float32 theOldBuffer[] = { 0.5f, NAN };
+    EFF_OldApplyPanAndVolume(0.5f, 0.0f, 1, theOldBuffer);
+    EFFCheck(theOldBuffer[0] == 0.25f);
+}
+
+// The specialised and generic kernels for other channel counts against a plain loop. They should
+// only differ by rounding (e.g. if the compiler fuses a multiply and add in one but not the other).
+static void TestChannelCounts()
+{
+    // Mono and odd numbers of channels have their last channel unpaired. 5.1 and 7.1 have the
+    // centre and LFE channels unpaired.
+    EFFCheck(EFF_AudioKernels::IsUnpairedChannel(1, 0));
+    EFFCheck(!EFF_AudioKernels::IsUnpairedChannel(2, 0) && !EFF_AudioKernels::IsUnpairedChannel(2, 1));
+    EFFCheck(EFF_AudioKernels::IsUnpairedChannel(3, 2) && !EFF_AudioKernels::IsUnpairedChannel(3, 1));
+
+    for(UInt32 theChannels : { 6u, 8u })
+    {
+        for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+        {
+            EFFCheck(EFF_AudioKernels::IsUnpairedChannel(theChannels, theChannel) ==
+                     (theChannel == 2 || theChannel == 3));
+        }
+    }
+
+    const Float32 kTolerance = 1.0e-6f;
+    Float32 theMaxDifference = 0.0f;
+
+    for(UInt32 theChannels : { 1u, 2u, 3u, 5u, 6u, 8u, 16u })
+    {
+        for(UInt32 theFrames : kFrameCounts)
+        {
+            for(Float32 thePan : { -1.0f, -0.7f, 0.0f, 0.4f, 1.0f })
+            {
+                for(bool theClip : { false, true })
+                {
+                    const EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(0.8f, thePan);
+
+                    std::vector<Float32> theInput = MakeSignal((theFrames * theChannels + 1) / 2,
+                                                               theChannels * 1000 + theFrames);
+                    theInput.resize(theFrames * theChannels);
+
+                    std::vector<Float32> theExpected = theInput;
+                    EFF_NaiveApplyPanGainMatrix(theMatrix, theChannels, theClip, theExpected.data(), theFrames);
+
+                    std::vector<Float32> theActual = theInput;
+                    EFF_AudioKernels::ApplyPanGainMatrix(theMatrix, theChannels, theClip, theActual.data(), theFrames);
+
+                    // A ramp between two identical matrices is the same as applying the matrix.
+                    std::vector<Float32> theRamped = theInput;
+                    EFF_AudioKernels::ApplyPanGainMatrixRamp(theMatrix,
+                                                             theMatrix,
+                                                             theChannels,
+                                                             theClip,
+                                                             theRamped.data(),
+                                                             theFrames);
+
+                    for(size_t i = 0; i < theInput.size(); i++)
+                    {
+                        theMaxDifference = std::max(theMaxDifference, std::fabs(theActual[i] - theExpected[i]));
+                        theMaxDifference = std::max(theMaxDifference, std::fabs(theRamped[i] - theExpected[i]));
+                    }
+                }
+            }
+
+            // The gain ramp reaches each frame's gain in every channel.
+            std::vector<Float32> theOnes(theFrames * theChannels, 1.0f);
+            EFF_AudioKernels::ApplyGainRamp(0.0f, 1.0f, theChannels, theOnes.data(), theFrames);
+
+            for(UInt32 theFrame = 0; theFrame < theFrames; theFrame++)
+            {
+                const Float32 theGain = static_cast<Float32>(theFrame + 1) / theFrames;
+
+                for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+                {
+                    theMaxDifference = std::max(theMaxDifference,
+                                                std::fabs(theOnes[theFrame * theChannels + theChannel] - theGain));
+                }
+            }
+        }
+    }
+
+    printf("channel counts: max difference from the plain loop %g\n", theMaxDifference);
+
+    EFFCheck(theMaxDifference <= kTolerance);
+}
+
+// A value for a sample that's interesting to compare against inFirstSample's margin.
+static Float32 SampleNear(Float32 inFirstSample, UInt32 inKind, UInt32 inRandom)
+{
+    const Float32 theLower = inFirstSample - kSampleVolumeMarginRaw;
+    const Float32 theUpper = inFirstSample + kSampleVolumeMarginRaw;
+    const Float32 theFraction = static_cast<Float32>(inRandom >> 8) / 16777216.0f;
+
+    switch(inKind % 10)
+    {
+        case 0: return theLower;
+        case 1: return theUpper;
+        case 2: return std::nextafter(theLower, -INFINITY);
+        case 3: return std::nextafter(theUpper, INFINITY);
+        case 4: return NAN;
+        case 5: return (inRandom & 1) ? INFINITY : -INFINITY;
+        case 6: return inFirstSample + (theFraction - 0.5f) * 0.5f;
+        default: return theLower + (theUpper - theLower) * theFraction;
+    }
+}
+
+// The old loop, generalised to any number of channels.
+static bool AnySampleOutsideFirstFrameMarginReference(const Float32* inBuffer, UInt32 inChannels, UInt32 inFrames)
+{
+    for(UInt32 i = 0; i < inFrames * inChannels; i++)
+    {
+        const Float32 theFirstSample = inBuffer[i % inChannels];
+
+        if(inBuffer[i] < theFirstSample - kSampleVolumeMarginRaw ||
+           inBuffer[i] > theFirstSample + kSampleVolumeMarginRaw)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void TestAudibilityAgainstOldCode()
+{
+    UInt32 theSeed = 5;
+    UInt64 theBuffers = 0, theAudibleBuffers = 0;
+
+    auto theRandom = [&theSeed] {
+        theSeed = theSeed * 1664525 + 1013904223;
+        return theSeed;
+    };
+
+    for(UInt32 theChannels : { 2u, 1u, 3u, 6u, 8u })
+    {
+        for(UInt32 theFrames : kFrameCounts)
+        {
+            for(UInt32 theTrial = 0; theTrial < 400; theTrial++)
+            {
+                std::vector<Float32> theBuffer(theFrames * theChannels);
+
+                // The first frame is usually silence or an ordinary sample, and occasionally NaN.
+                for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+                {
+                    UInt32 theKind = theRandom() % 8;
+                    theBuffer[theChannel] = (theKind == 0) ? NAN :
+                                            (theKind < 4) ? 0.0f :
+                                            (static_cast<Float32>(theRandom() >> 8) / 8388608.0f - 1.0f);
+                }
+
+                // The rest are within the margin, except for a few samples at random positions that
+                // might not be.
+                for(UInt32 i = theChannels; i < theBuffer.size(); i++)
+                {
+                    theBuffer[i] = SampleNear(theBuffer[i % theChannels], 7, theRandom());
+                }
+
+                for(UInt32 theSpecial = theRandom() % 4; theSpecial > 0 && theFrames > 1; theSpecial--)
+                {
+                    UInt32 i = theChannels + theRandom() % (theBuffer.size() - theChannels);
+                    theBuffer[i] = SampleNear(theBuffer[i % theChannels], theRandom() >> 4, theRandom());
+                }
+
+                const bool theResult = EFF_AudioKernels::AnySampleOutsideFirstFrameMargin(theBuffer.data(),
+                                                                                          theChannels,
+                                                                                          theFrames,
+                                                                                          kSampleVolumeMarginRaw);
+                const bool theExpected = (theChannels == 2) ?
+                    EFF_OldBufferIsAudible(theFrames, theBuffer.data()) :
+                    AnySampleOutsideFirstFrameMarginReference(theBuffer.data(), theChannels, theFrames);
+
+                EFFCheck(theResult == theExpected);
+
+                theBuffers++;
+                theAudibleBuffers += theExpected;
+            }
+        }
+    }
+
+    printf("audibility against the old code: %llu buffers, %llu audible\n",
+           static_cast<unsigned long long>(theBuffers),
+           static_cast<unsigned long long>(theAudibleBuffers));
+}
+
+int main()
+{
+    TestAgainstOldCode();
+    TestNonFiniteSamples();
+    TestChannelCounts();
+    TestAudibilityAgainstOldCode();
+
+    return EFF_TestHarness::Finish("EFF_AudioKernelsTests");
+}
+
@@ -0,0 +1,259 @@
+//
+//  EFF_BundleIDTableBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Times adding, looking up and removing 1000 clients, each with its own bundle ID, in
+//  EFF_ClientMap. Adding a client interns its bundle ID, like EFF_Client's constructor does when the
+//  HAL adds a client.
+//
+//  Then times the bundle ID keys on their own, for 10 to 1000 bundle IDs: interning them and adding
+//  them to a map of clients by bundle ID, looking them up by bundle ID (including ones that were
+//  never interned) and removing them, which moves the client to the past clients map. The "strings"
+//  column does the same with the std::maps keyed by CACFString that EFF_ClientMap used before
+//  EFF_BundleIDTable, where each copy of a client retained its bundle ID and removing it released
+//  the string.
+//
+//  Also checks that every bundle ID keeps its atom as the table grows and that Find never adds
+//  bundle IDs.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_BundleIDTable.h"
+#include "EFF_ClientMap.h"
+
+// STL Includes
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+static const UInt32 kBundleIDCounts[] = { 10, 100, 1000 };
+static const UInt32 kClients = 1000;
+
+namespace
+{
+    // A client as EFF_ClientMap stored them before bundle IDs were interned.
+    struct StringClient
+    {
+        UInt32                  mClientID = 0;
+        CACFString              mBundleID;
+    };
+
+    typedef std::vector<const void*> ClientPtrList;
+
+    struct Times
+    {
+        std::vector<double>     mAdd;
+        std::vector<double>     mFind;
+        std::vector<double>     mFindMissing;
+        std::vector<double>     mRemove;
+    };
+}
+
+static std::vector<CACFString> MakeBundleIDs(const char* inPrefix, UInt32 inCount)
+{
+    std::vector<CACFString> theBundleIDs;
+
+    for(UInt32 i = 0; i < inCount; i++)
+    {
+        char theBundleID[64];
+        snprintf(theBundleID, sizeof(theBundleID), "com.example.%s.app%u", inPrefix, i);
+        theBundleIDs.emplace_back(CFStringCreateWithCString(kCFAllocatorDefault, theBundleID, kCFStringEncodingUTF8));
+    }
+
+    return theBundleIDs;
+}
+
+// Runs inFunction(i) for i from 0 to inCalls and returns the time per call, in ns.
+template <typename F>
+static double TimePerCall(UInt32 inCalls, F inFunction)
+{
+    double theStart = EFF_TestHarness::NowSeconds();
+
+    for(UInt32 theCall = 0; theCall < inCalls; theCall++)
+    {
+        inFunction(theCall);
+    }
+
+    return (EFF_TestHarness::NowSeconds() - theStart) / inCalls * 1e9;
+}
+
+static void PrintRow(const char* inName, const std::vector<double>& inTimes)
+{
+    EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(inTimes);
+    printf("    %-22s %8.1f ns %8.1f ns p99 %10.0f/s\n", inName, theStats.mP50, theStats.mP99, 1e9 / theStats.mP50);
+}
+
+static void PrintRow(const char* inName, const std::vector<double>& inAtomTimes, const std::vector<double>& inStringTimes)
+{
+    printf("    %-22s %8.1f ns, strings %8.1f ns\n",
+           inName,
+           EFF_TestHarness::Summarise(inAtomTimes).mP50,
+           EFF_TestHarness::Summarise(inStringTimes).mP50);
+}
+
+static void BenchmarkClientMap(UInt32 inRepeats)
+{
+    const std::vector<CACFString> theBundleIDs = MakeBundleIDs("clientmap", kClients);
+    Times theTimes;
+
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        theTimes.mAdd.push_back(TimePerCall(kClients, [&] (UInt32 inClient) {
+            AudioServerPlugInClientInfo theClientInfo = {
+                inClient + 1, static_cast<pid_t>(1000 + inClient), true, theBundleIDs[inClient].GetCFString()
+            };
+            theClientMap->AddClient(EFF_Client(&theClientInfo));
+        }));
+
+        theTimes.mFind.push_back(TimePerCall(kClients, [&] (UInt32 inClient) {
+            EFF_Client theClient;
+            EFF_TestHarness::DoNotOptimise(theClientMap->GetClientNonRT(inClient + 1, &theClient));
+        }));
+
+        // Every client has its bundle ID's atom.
+        if(theRepeat == 0)
+        {
+            for(UInt32 theClientID = 1; theClientID <= kClients; theClientID++)
+            {
+                EFF_Client theClient;
+                EFFCheck(theClientMap->GetClientNonRT(theClientID, &theClient));
+                EFFCheck(theClient.GetBundleID() == theBundleIDs[theClientID - 1]);
+            }
+        }
+
+        theTimes.mRemove.push_back(TimePerCall(kClients, [&] (UInt32 inClient) {
+            EFF_TestHarness::DoNotOptimise(theClientMap->RemoveClient(inClient + 1).mBundleIDAtom);
+        }));
+
+        EFF_Client theRemovedClient;
+        EFFCheck(!theClientMap->GetClientNonRT(1, &theRemovedClient));
+    }
+
+    printf("EFF_ClientMap, %u clients (p50s):\n", kClients);
+    PrintRow("add", theTimes.mAdd);
+    PrintRow("lookup by client ID", theTimes.mFind);
+    PrintRow("remove", theTimes.mRemove);
+}
+
+static void BenchmarkBundleIDKeys(UInt32 inCount, UInt32 inRepeats)
+{
+    EFF_BundleIDTable& theTable = EFF_BundleIDTable::GetInstance();
+
+    // The table is a singleton, so give each round its own bundle IDs.
+    char thePrefix[32];
+    snprintf(thePrefix, sizeof(thePrefix), "bench%u", inCount);
+    const std::vector<CACFString> theBundleIDs = MakeBundleIDs(thePrefix, inCount);
+    snprintf(thePrefix, sizeof(thePrefix), "missing%u", inCount);
+    const std::vector<CACFString> theMissingBundleIDs = MakeBundleIDs(thePrefix, inCount);
+
+    std::vector<EFF_BundleIDAtom> theAtoms;
+    for(const CACFString& theBundleID : theBundleIDs)
+    {
+        theAtoms.push_back(theTable.Intern(theBundleID.GetCFString()));
+    }
+
+    // Every bundle ID still has its atom after the table has grown, and missing ones aren't found
+    // or added.
+    for(UInt32 i = 0; i < inCount; i++)
+    {
+        EFFCheck(theAtoms[i] != kEFFNoBundleIDAtom);
+        EFFCheck(theTable.Find(theBundleIDs[i].GetCFString()) == theAtoms[i]);
+        EFFCheck(theTable.Intern(theBundleIDs[i].GetCFString()) == theAtoms[i]);
+        EFFCheck(theTable.GetBundleID(theAtoms[i]) == theBundleIDs[i]);
+        EFFCheck(theTable.Find(theMissingBundleIDs[i].GetCFString()) == kEFFNoBundleIDAtom);
+    }
+
+    EFFCheck(theTable.Find(theMissingBundleIDs[0].GetCFString()) == kEFFNoBundleIDAtom);
+
+    // The bundle ID maps EFF_ClientMap has now, and the ones it had before.
+    std::vector<EFF_Client> theClients(inCount);
+    std::unordered_map<EFF_BundleIDAtom, ClientPtrList> theClientsByAtom;
+    std::unordered_map<EFF_BundleIDAtom, EFF_Client> thePastClientsByAtom;
+
+    std::vector<StringClient> theStringClients(inCount);
+    std::map<CACFString, ClientPtrList> theClientsByString;
+    std::map<CACFString, StringClient> thePastClientsByString;
+
+    Times theAtomTimes;
+    Times theStringTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        theAtomTimes.mAdd.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            theClients[i].mClientID = i + 1;
+            theClients[i].mBundleIDAtom = theTable.Intern(theBundleIDs[i].GetCFString());
+            theClientsByAtom[theClients[i].mBundleIDAtom].push_back(&theClients[i]);
+        }));
+
+        theStringTimes.mAdd.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            theStringClients[i].mClientID = i + 1;
+            theStringClients[i].mBundleID = theBundleIDs[i];
+            theClientsByString[theStringClients[i].mBundleID].push_back(&theStringClients[i]);
+        }));
+
+        theAtomTimes.mFind.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            EFF_BundleIDAtom theAtom = theTable.Find(theBundleIDs[i].GetCFString());
+            EFF_TestHarness::DoNotOptimise(theClientsByAtom.find(theAtom)->second.size());
+        }));
+
+        theStringTimes.mFind.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            auto theItr = theClientsByString.find(CACFString(theBundleIDs[i].GetCFString(), false));
+            EFF_TestHarness::DoNotOptimise(theItr->second.size());
+        }));
+
+        theAtomTimes.mFindMissing.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            EFF_TestHarness::DoNotOptimise(theTable.Find(theMissingBundleIDs[i].GetCFString()));
+        }));
+
+        theStringTimes.mFindMissing.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            auto theItr = theClientsByString.find(CACFString(theMissingBundleIDs[i].GetCFString(), false));
+            EFF_TestHarness::DoNotOptimise(theItr == theClientsByString.end());
+        }));
+
+        theAtomTimes.mRemove.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            theClientsByAtom.erase(theClients[i].mBundleIDAtom);
+            thePastClientsByAtom[theClients[i].mBundleIDAtom] = theClients[i];
+            theClients[i] = EFF_Client();
+        }));
+
+        theStringTimes.mRemove.push_back(TimePerCall(inCount, [&] (UInt32 i) {
+            theClientsByString.erase(theStringClients[i].mBundleID);
+            thePastClientsByString[theStringClients[i].mBundleID] = theStringClients[i];
+            theStringClients[i] = StringClient();
+        }));
+
+        EFFCheck(theClientsByAtom.empty() && theClientsByString.empty());
+        EFFCheck(thePastClientsByAtom.size() == inCount && thePastClientsByString.size() == inCount);
+    }
+
+    printf("%4u bundle IDs (p50s):\n", inCount);
+    PrintRow("intern and add", theAtomTimes.mAdd, theStringTimes.mAdd);
+    PrintRow("look up", theAtomTimes.mFind, theStringTimes.mFind);
+    PrintRow("look up, not interned", theAtomTimes.mFindMissing, theStringTimes.mFindMissing);
+    PrintRow("remove", theAtomTimes.mRemove, theStringTimes.mRemove);
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const UInt32 theRepeats = theQuick ? 3 : 50;
+
+    BenchmarkClientMap(theRepeats);
+
+    for(UInt32 theCount : kBundleIDCounts)
+    {
+        BenchmarkBundleIDKeys(theCount, theRepeats);
+    }
+
+    return EFF_TestHarness::Finish("EFF_BundleIDTableBenchmark");
+}
@@ -0,0 +1,135 @@
+//
+//  EFF_CaptureFileWriterBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Writes 8 channel 96 kHz audio, in 512 frame IO-cycle-sized blocks, through EFF_CaptureFileWriter
+//  as fast as it will go, for each file and sample format, and prints how many times faster than
+//  real time it wrote and at what rate. That's how far ahead of the real-time thread
+//  EFF_MixRecorder's writer thread can stay, so it's the margin before a recording drops blocks.
+//
+//  The files go in a new directory in $TMPDIR (or /tmp) and are deleted afterwards. Pass
+//  --seconds <n> to change how much audio each run writes, or --dir <path> to write somewhere
+//  else, e.g. to the disk recordings would go to.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_CaptureFileWriter.h"
+
+// STL Includes
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static const UInt32 kChannels = 8;
+static const Float64 kSampleRate = 96000.0;
+static const UInt32 kBlockFrames = 512;
+
+struct Format
+{
+    EFFRecordingFileFormat      mFileFormat;
+    EFFRecordingSampleFormat    mSampleFormat;
+    const char*                 mName;
+};
+
+static const Format kFormats[] = {
+    { kEFFRecordingFileFormatWAV, kEFFRecordingSampleFormatInt24, "wav int24" },
+    { kEFFRecordingFileFormatWAV, kEFFRecordingSampleFormatFloat32, "wav float32" },
+    { kEFFRecordingFileFormatCAF, kEFFRecordingSampleFormatInt24, "caf int24" },
+    { kEFFRecordingFileFormatCAF, kEFFRecordingSampleFormatFloat32, "caf float32" },
+    { kEFFRecordingFileFormatRaw, kEFFRecordingSampleFormatFloat32, "raw float32" }
+};
+
+int main(int argc, char* argv[])
+{
+    Float64 theSeconds = EFF_TestHarness::IsQuick(argc, argv) ? 5.0 : 600.0;
+    const char* theParentDirectory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    for(int theArg = 1; theArg + 1 < argc; theArg++)
+    {
+        if(strcmp(argv[theArg], "--seconds") == 0)
+        {
+            theSeconds = atof(argv[theArg + 1]);
+        }
+        else if(strcmp(argv[theArg], "--dir") == 0)
+        {
+            theParentDirectory = argv[theArg + 1];
+        }
+    }
+
+    std::string theDirectory = std::string(theParentDirectory) + "/EFF_CaptureFileWriterBenchmark.XXXXXX";
+
+    if(!mkdtemp(&theDirectory[0]))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    // Samples that are exact in Int24, so the conversion does the same work as for real audio.
+    std::vector<Float32> theBlock(kBlockFrames * kChannels);
+
+    for(size_t theIndex = 0; theIndex < theBlock.size(); theIndex++)
+    {
+        theBlock[theIndex] = static_cast<Float32>(static_cast<SInt32>(theIndex % 65536) - 32768) / 8388608.0f;
+    }
+
+    const UInt64 theTotalFrames = static_cast<UInt64>(theSeconds * kSampleRate);
+
+    printf("%u channels at %.0f kHz, %u frame blocks, %.0f s of audio per run, in %s\n",
+           kChannels, kSampleRate / 1000.0, kBlockFrames, theSeconds, theDirectory.c_str());
+    printf("%-12s %12s %10s %14s %10s %16s\n",
+           "format", "file MB", "wall s", "x real time", "MB/s", "worst block us");
+
+    for(const Format& theFormat : kFormats)
+    {
+        const std::string thePath = theDirectory + "/capture";
+
+        EFF_CaptureFileWriter theWriter;
+        theWriter.Open(thePath.c_str(), theFormat.mFileFormat, theFormat.mSampleFormat, kChannels, kSampleRate);
+
+        double theWorstBlock = 0.0;
+        const double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt64 theFrame = 0; theFrame < theTotalFrames; theFrame += kBlockFrames)
+        {
+            const double theBlockStart = EFF_TestHarness::NowSeconds();
+
+            theWriter.WriteFrames(theBlock.data(),
+                                  static_cast<UInt32>(std::min<UInt64>(kBlockFrames, theTotalFrames - theFrame)));
+
+            theWorstBlock = std::max(theWorstBlock, EFF_TestHarness::NowSeconds() - theBlockStart);
+        }
+
+        theWriter.Close();
+
+        const double theWall = EFF_TestHarness::NowSeconds() - theStart;
+        const double theMB = theWriter.GetBytesWritten() / 1e6;
+
+        EFFCheck(theWriter.GetFramesWritten() == theTotalFrames);
+
+        printf("%-12s %12.1f %10.2f %14.1f %10.0f %16.0f\n",
+               theFormat.mName,
+               theMB,
+               theWall,
+               theSeconds / theWall,
+               theMB / theWall,
+               theWorstBlock * 1e6);
+
+        unlink(thePath.c_str());
+    }
+
+    rmdir(theDirectory.c_str());
+
+    return EFF_TestHarness::Finish("EFF_CaptureFileWriterBenchmark");
+}
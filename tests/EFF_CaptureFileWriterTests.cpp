@@ -0,0 +1,336 @@
+//
+//  EFF_CaptureFileWriterTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Checks that EFF_CaptureFileWriter only ever creates new files: it refuses paths that already
+//  exist, symlinks (even dangling ones) and relative paths, and leaves whatever was there alone.
+//  Then writes WAV, CAF and raw files, as Float32 and Int24, and reads them back: the headers
+//  describe the audio, the audio starts on a page boundary, and every sample is the one written,
+//  across several of the writer's buffers and with silence in between.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_CaptureFileWriter.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <cmath>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const UInt32 kChannels = 3;
+static const Float64 kSampleRate = 48000.0;
+
+static std::string sDirectory;
+
+static std::string PathFor(const char* inName)
+{
+    return sDirectory + "/" + inName;
+}
+
+static std::vector<UInt8> ReadFile(const std::string& inPath)
+{
+    std::vector<UInt8> theBytes;
+    FILE* theFile = fopen(inPath.c_str(), "rb");
+
+    if(theFile)
+    {
+        UInt8 theBuffer[65536];
+        size_t theCount;
+
+        while((theCount = fread(theBuffer, 1, sizeof(theBuffer), theFile)) > 0)
+        {
+            theBytes.insert(theBytes.end(), theBuffer, theBuffer + theCount);
+        }
+
+        fclose(theFile);
+    }
+
+    return theBytes;
+}
+
+static void WriteFile(const std::string& inPath, const char* inContents)
+{
+    FILE* theFile = fopen(inPath.c_str(), "wb");
+    fputs(inContents, theFile);
+    fclose(theFile);
+}
+
+// Returns the CAException's error, or 0 if Open didn't throw.
+static OSStatus TryOpen(EFF_CaptureFileWriter& ioWriter, const std::string& inPath)
+{
+    try
+    {
+        ioWriter.Open(inPath.c_str(),
+                      kEFFRecordingFileFormatWAV,
+                      kEFFRecordingSampleFormatFloat32,
+                      kChannels,
+                      kSampleRate);
+    }
+    catch(const CAException& e)
+    {
+        return e.GetError();
+    }
+
+    return 0;
+}
+
+static void TestRefusesExistingPaths()
+{
+    EFF_CaptureFileWriter theWriter;
+
+    // An existing file.
+    const std::string theExisting = PathFor("existing.wav");
+    WriteFile(theExisting, "not audio");
+
+    EFFCheck(TryOpen(theWriter, theExisting) == EEXIST);
+    EFFCheck(!theWriter.IsOpen());
+    EFFCheck(ReadFile(theExisting) == std::vector<UInt8>({ 'n', 'o', 't', ' ', 'a', 'u', 'd', 'i', 'o' }));
+
+    // A symlink to a file that could be written.
+    const std::string theTarget = PathFor("target");
+    const std::string theLink = PathFor("link.wav");
+    WriteFile(theTarget, "target");
+    EFFCheck(symlink(theTarget.c_str(), theLink.c_str()) == 0);
+
+    EFFCheck(TryOpen(theWriter, theLink) == EEXIST);
+    EFFCheck(ReadFile(theTarget).size() == 6);
+
+    // A dangling symlink, which a plain O_CREAT would follow to create its target.
+    const std::string theMissingTarget = PathFor("missing-target");
+    const std::string theDanglingLink = PathFor("dangling.wav");
+    EFFCheck(symlink(theMissingTarget.c_str(), theDanglingLink.c_str()) == 0);
+
+    EFFCheck(TryOpen(theWriter, theDanglingLink) == EEXIST);
+
+    struct stat theStat;
+    EFFCheck(lstat(theMissingTarget.c_str(), &theStat) != 0);
+
+    // A directory.
+    EFFCheck(TryOpen(theWriter, sDirectory) == EEXIST);
+
+    // A relative path.
+    EFFCheck(TryOpen(theWriter, "relative.wav") == kAudioHardwareIllegalOperationError);
+    EFFCheck(access("relative.wav", F_OK) != 0);
+
+    // A path that's free.
+    const std::string theNew = PathFor("new.wav");
+    EFFCheck(TryOpen(theWriter, theNew) == 0);
+    EFFCheck(theWriter.IsOpen());
+    theWriter.Close();
+
+    // And now isn't.
+    EFFCheck(TryOpen(theWriter, theNew) == EEXIST);
+}
+
+// Each sample is exactly representable as Int24, so both sample formats read back exactly.
+static Float32 SampleFor(UInt64 inFrame, UInt32 inChannel)
+{
+    return static_cast<Float32>(static_cast<SInt32>((inFrame * kChannels + inChannel) % 65536) - 32768) / 8388608.0f;
+}
+
+static UInt32 LE32(const std::vector<UInt8>& inBytes, size_t inOffset)
+{
+    return inBytes[inOffset] | (inBytes[inOffset + 1] << 8) | (inBytes[inOffset + 2] << 16) |
+           (static_cast<UInt32>(inBytes[inOffset + 3]) << 24);
+}
+
+static UInt16 LE16(const std::vector<UInt8>& inBytes, size_t inOffset)
+{
+    return static_cast<UInt16>(inBytes[inOffset] | (inBytes[inOffset + 1] << 8));
+}
+
+static UInt32 BE32(const std::vector<UInt8>& inBytes, size_t inOffset)
+{
+    return (static_cast<UInt32>(inBytes[inOffset]) << 24) | (inBytes[inOffset + 1] << 16) |
+           (inBytes[inOffset + 2] << 8) | inBytes[inOffset + 3];
+}
+
+static UInt64 BE64(const std::vector<UInt8>& inBytes, size_t inOffset)
+{
+    return (static_cast<UInt64>(BE32(inBytes, inOffset)) << 32) | BE32(inBytes, inOffset + 4);
+}
+
+static Float32 ReadSample(const std::vector<UInt8>& inBytes, size_t inOffset, EFFRecordingSampleFormat inFormat)
+{
+    if(inFormat == kEFFRecordingSampleFormatFloat32)
+    {
+        Float32 theSample;
+        memcpy(&theSample, &inBytes[inOffset], sizeof(theSample));
+        return theSample;
+    }
+
+    // Sign-extend the 24 bits.
+    const SInt32 theSample =
+        static_cast<SInt32>((inBytes[inOffset] << 8) | (inBytes[inOffset + 1] << 16) |
+                            (static_cast<UInt32>(inBytes[inOffset + 2]) << 24)) >> 8;
+    return theSample / 8388608.0f;
+}
+
+static void TestRoundTrip(EFFRecordingFileFormat inFileFormat,
+                          EFFRecordingSampleFormat inSampleFormat,
+                          const char* inName)
+{
+    const std::string thePath = PathFor(inName);
+
+    // More than a few of the writer's buffers, in IO-cycle-sized blocks, with a gap of silence.
+    const UInt32 theBlockFrames = 512;
+    const UInt32 theBlocks = 400;
+    const UInt64 theSilentFrames = 1000;
+    const UInt32 theSilenceAfterBlock = 150;
+
+    EFF_CaptureFileWriter theWriter;
+    theWriter.Open(thePath.c_str(), inFileFormat, inSampleFormat, kChannels, kSampleRate);
+
+    std::vector<Float32> theBlock(theBlockFrames * kChannels);
+    UInt64 theFrame = 0;
+
+    for(UInt32 theBlockIndex = 0; theBlockIndex < theBlocks; theBlockIndex++)
+    {
+        for(UInt32 theOffset = 0; theOffset < theBlockFrames; theOffset++)
+        {
+            for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+            {
+                theBlock[theOffset * kChannels + theChannel] = SampleFor(theFrame + theOffset, theChannel);
+            }
+        }
+
+        theWriter.WriteFrames(theBlock.data(), theBlockFrames);
+        theFrame += theBlockFrames;
+
+        if(theBlockIndex == theSilenceAfterBlock)
+        {
+            theWriter.WriteSilence(theSilentFrames);
+            theFrame += theSilentFrames;
+        }
+    }
+
+    const UInt64 theTotalFrames = theFrame;
+    EFFCheck(theWriter.GetFramesWritten() == theTotalFrames);
+
+    theWriter.Close();
+    EFFCheck(!theWriter.IsOpen());
+
+    const std::vector<UInt8> theFile = ReadFile(thePath);
+    const UInt32 theBytesPerSample = (inSampleFormat == kEFFRecordingSampleFormatInt24) ? 3 : 4;
+    const UInt64 theDataBytes = theTotalFrames * kChannels * theBytesPerSample;
+
+    size_t theDataOffset = 0;
+
+    if(inFileFormat == kEFFRecordingFileFormatWAV)
+    {
+        theDataOffset = EFF_CaptureFileWriter::kAlignmentBytes;
+
+        EFFCheck(memcmp(&theFile[0], "RIFF", 4) == 0);
+        EFFCheck(LE32(theFile, 4) == theFile.size() - 8);
+        EFFCheck(memcmp(&theFile[8], "WAVE", 4) == 0);
+        EFFCheck(memcmp(&theFile[48], "fmt ", 4) == 0);
+        EFFCheck(LE16(theFile, 58) == kChannels);
+        EFFCheck(LE32(theFile, 60) == kSampleRate);
+        EFFCheck(LE16(theFile, 70) == theBytesPerSample * 8);
+        EFFCheck(memcmp(&theFile[theDataOffset - 8], "data", 4) == 0);
+        EFFCheck(LE32(theFile, theDataOffset - 4) == theDataBytes);
+    }
+    else if(inFileFormat == kEFFRecordingFileFormatCAF)
+    {
+        theDataOffset = EFF_CaptureFileWriter::kAlignmentBytes;
+
+        EFFCheck(memcmp(&theFile[0], "caff", 4) == 0);
+        EFFCheck(memcmp(&theFile[8], "desc", 4) == 0);
+        EFFCheck(BE32(theFile, 44) == kChannels);
+        EFFCheck(BE32(theFile, 48) == theBytesPerSample * 8);
+        EFFCheck(memcmp(&theFile[theDataOffset - 16], "data", 4) == 0);
+        // The size includes the 4 byte edit count before the audio.
+        EFFCheck(BE64(theFile, theDataOffset - 12) == theDataBytes + 4);
+    }
+
+    EFFCheck(theFile.size() >= theDataOffset + theDataBytes);
+    EFFCheck(theDataOffset % EFF_CaptureFileWriter::kAlignmentBytes == 0);
+
+    if(theFile.size() < theDataOffset + theDataBytes)
+    {
+        return;
+    }
+
+    UInt64 theWrongSamples = 0;
+
+    for(UInt64 theFrameIndex = 0; theFrameIndex < theTotalFrames; theFrameIndex++)
+    {
+        const UInt64 theSilenceStart = static_cast<UInt64>(theSilenceAfterBlock + 1) * theBlockFrames;
+        const bool isSilent = (theFrameIndex >= theSilenceStart) && (theFrameIndex < theSilenceStart + theSilentFrames);
+
+        for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+        {
+            const size_t theOffset =
+                theDataOffset + (theFrameIndex * kChannels + theChannel) * theBytesPerSample;
+            const Float32 theExpected = isSilent ? 0.0f : SampleFor(theFrameIndex, theChannel);
+
+            if(ReadSample(theFile, theOffset, inSampleFormat) != theExpected)
+            {
+                theWrongSamples++;
+            }
+        }
+    }
+
+    printf("%-16s %8llu frames, %9zu bytes, %llu wrong samples\n",
+           inName,
+           static_cast<unsigned long long>(theTotalFrames),
+           theFile.size(),
+           static_cast<unsigned long long>(theWrongSamples));
+
+    EFFCheck(theWrongSamples == 0);
+}
+
+static void RemoveDirectory()
+{
+    for(const char* theName : { "existing.wav", "target", "link.wav", "dangling.wav", "new.wav",
+                                "float.wav", "int24.wav", "float.caf", "int24.caf", "float.raw", "int24.raw" })
+    {
+        unlink(PathFor(theName).c_str());
+    }
+
+    rmdir(sDirectory.c_str());
+}
+
+int main()
+{
+    const char* theTemporaryDirectory = getenv("TMPDIR");
+    std::string theTemplate = std::string(theTemporaryDirectory ? theTemporaryDirectory : "/tmp") +
+                              "/EFF_CaptureFileWriterTests.XXXXXX";
+
+    if(!mkdtemp(&theTemplate[0]))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    sDirectory = theTemplate;
+
+    TestRefusesExistingPaths();
+
+    TestRoundTrip(kEFFRecordingFileFormatWAV, kEFFRecordingSampleFormatFloat32, "float.wav");
+    TestRoundTrip(kEFFRecordingFileFormatWAV, kEFFRecordingSampleFormatInt24, "int24.wav");
+    TestRoundTrip(kEFFRecordingFileFormatCAF, kEFFRecordingSampleFormatFloat32, "float.caf");
+    TestRoundTrip(kEFFRecordingFileFormatCAF, kEFFRecordingSampleFormatInt24, "int24.caf");
+    TestRoundTrip(kEFFRecordingFileFormatRaw, kEFFRecordingSampleFormatFloat32, "float.raw");
+    TestRoundTrip(kEFFRecordingFileFormatRaw, kEFFRecordingSampleFormatInt24, "int24.raw");
+
+    RemoveDirectory();
+
+    return EFF_TestHarness::Finish("EFF_CaptureFileWriterTests");
+}
@@ -0,0 +1,446 @@
+//
+//  EFF_ClientMapBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Times the EFF_ClientMap operations that happen while IO is running (a volume change, a client
+//  starting and stopping IO, and the IO thread's lookups), for different numbers of clients.
+//
+//  Also times changing the volumes of 16 apps at once, as EFFApp does when it sets
+//  kAudioDeviceCustomPropertyAppVolumes, with one transaction per change against one transaction
+//  for all of them.
+//
+//  Each change used to publish a heap-allocated copy of every client (EFF_ClientSnapshot) that
+//  nothing read. For comparison, the "with copy" column adds the cost of making and freeing that
+//  copy, which is what the same change cost before the snapshots were removed.
+//
+//  Then a thread standing in for the IO thread calls GetClientIOParamsRT as fast as it can while
+//  another changes an app's volume 1000 times a second, and prints the percentiles of how long each
+//  read and each change took. "shadow maps" runs the same storm against a copy of how EFF_ClientMap
+//  worked before this series: the IO thread locked the maps mutex to copy a client out of the maps,
+//  and each change was made to the shadow maps, swapped in by the real-time worker thread while the
+//  changing thread waited, and then made again. Every read has to find its client with one of the
+//  volumes being set. `--seconds <n>` sets how long each storm runs (10 s by default).
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_IOStats.h"
+#include "EFF_Semaphore.h"
+
+// Unit Include
+#include "EFF_ClientMap.h"
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+#include "CAMutex.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+static const UInt32 kClientCounts[] = { 8, 64, 256 };
+
+// The clients in the update storms.
+static const UInt32 kStormClients = 64;
+
+template <typename F>
+static EFF_TestHarness::Stats TimeCalls(UInt32 inRepeats, UInt32 inCalls, F inFunction)
+{
+    std::vector<double> theTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theCall = 0; theCall < inCalls; theCall++)
+        {
+            inFunction(theCall);
+        }
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) / inCalls * 1e9);
+    }
+
+    return EFF_TestHarness::Summarise(theTimes);
+}
+
+static EFF_Client MakeClient(UInt32 inClientID)
+{
+    EFF_Client theClient;
+    theClient.mClientID = inClientID;
+    theClient.mProcessID = static_cast<pid_t>(1000 + inClientID);
+    return theClient;
+}
+
+namespace
+{
+    // A client as EFF_ClientMap stored them before this series, which retained its bundle ID.
+    struct ShadowMapClient
+    {
+        EFF_Client              mClient;
+        CACFString              mBundleID;
+    };
+
+    // EFF_ClientMap before this series, cut down to what volume changes and the IO thread's
+    // lookups used.
+    class ShadowMapClientMap
+    {
+
+    public:
+        ShadowMapClientMap(UInt32 inClients)
+        {
+            for(UInt32 theClientID = 1; theClientID <= inClients; theClientID++)
+            {
+                ShadowMapClient theClient { MakeClient(theClientID), CACFString("com.example.app") };
+
+                for(auto* theMaps : { &mMaps, &mShadowMaps })
+                {
+                    ShadowMapClient& theClientInMap = theMaps->mClients[theClientID] = theClient;
+                    theMaps->mClientsByPID[theClient.mClient.mProcessID].push_back(&theClientInMap);
+                }
+            }
+
+            mWorkerThread = std::thread([this] { RTWorker(); });
+        }
+
+        ~ShadowMapClientMap()
+        {
+            mStopWorker = true;
+            mSwapRequested.Signal();
+            mWorkerThread.join();
+        }
+
+        // What the IO thread called for each client each cycle.
+        bool GetClientRT(UInt32 inClientID, ShadowMapClient& outClient) const
+        {
+            CAMutex::Locker theMapsLocker(mMapsMutex);
+
+            auto theClientItr = mMaps.mClients.find(inClientID);
+
+            if(theClientItr != mMaps.mClients.end())
+            {
+                outClient = theClientItr->second;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool SetClientsRelativeVolume(pid_t inAppPID, Float32 inRelativeVolume)
+        {
+            bool didChangeVolume = false;
+
+            CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+
+            auto theSetVolumesInShadowMapsFunc = [&] {
+                auto theClients = mShadowMaps.mClientsByPID.find(inAppPID);
+
+                if(theClients != mShadowMaps.mClientsByPID.end())
+                {
+                    for(ShadowMapClient* theClient : theClients->second)
+                    {
+                        theClient->mClient.mRelativeVolume = inRelativeVolume;
+                        didChangeVolume = true;
+                    }
+                }
+            };
+
+            theSetVolumesInShadowMapsFunc();
+            SwapInShadowMaps();
+            theSetVolumesInShadowMapsFunc();
+
+            return didChangeVolume;
+        }
+
+    private:
+        struct Maps
+        {
+            std::map<UInt32, ShadowMapClient>                   mClients;
+            std::map<pid_t, std::vector<ShadowMapClient*>>      mClientsByPID;
+        };
+
+        // EFF_TaskQueue::QueueSync_SwapClientShadowMaps: wakes the real-time worker thread and waits
+        // for it to swap the maps.
+        void SwapInShadowMaps()
+        {
+            mSwapRequested.Signal();
+            mSwapped.Wait();
+        }
+
+        void RTWorker()
+        {
+            while(true)
+            {
+                mSwapRequested.Wait();
+
+                if(mStopWorker)
+                {
+                    return;
+                }
+
+                {
+                    CAMutex::Locker theMapsLocker(mMapsMutex);
+                    std::swap(mMaps, mShadowMaps);
+                }
+
+                mSwapped.Signal();
+            }
+        }
+
+        mutable CAMutex             mMapsMutex { "Maps mutex" };
+        CAMutex                     mShadowMapsMutex { "Shadow maps mutex" };
+        Maps                        mMaps;
+        Maps                        mShadowMaps;
+
+        EFF_Semaphore               mSwapRequested;
+        EFF_Semaphore               mSwapped;
+        std::atomic<bool>           mStopWorker { false };
+        std::thread                 mWorkerThread;
+
+    };
+
+    struct StormResult
+    {
+        EFF_IOStats::OperationStats mReads;
+        EFF_IOStats::OperationStats mUpdates;
+        // Reads that didn't find their client or found a volume that was never set.
+        UInt64                      mBadReads = 0;
+    };
+}
+
+static void RecordHostTicks(EFF_IOStats::OperationStats& ioStats, UInt64 inStartHostTime)
+{
+    const UInt64 theHostTicks = CAHostTimeBase::GetTheCurrentTime() - inStartHostTime;
+
+    ioStats.mCount++;
+    ioStats.mTotalHostTicks += theHostTicks;
+    ioStats.mMaxHostTicks = std::max(ioStats.mMaxHostTicks, theHostTicks);
+    ioStats.mBuckets[EFF_IOStats::BucketForHostTicks(theHostTicks)]++;
+}
+
+// Calls inRead(i) on a reader thread, as fast as it can, while calling inUpdate(i) on this thread
+// once every millisecond for inSeconds. inRead returns the volume it read, or -1 if it didn't find
+// the client. inUpdate sets the volume to 0.5 or 0.75.
+template <typename R, typename U>
+static StormResult RunUpdateStorm(Float64 inSeconds, R inRead, U inUpdate)
+{
+    StormResult theResult;
+    std::atomic<bool> theStop { false };
+
+    std::thread theReader([&] {
+        for(UInt32 theCall = 0; !theStop.load(std::memory_order_relaxed); theCall++)
+        {
+            const UInt64 theStart = CAHostTimeBase::GetTheCurrentTime();
+            const Float32 theVolume = inRead(theCall);
+            RecordHostTicks(theResult.mReads, theStart);
+
+            if(theVolume != 0.5f && theVolume != 0.75f)
+            {
+                theResult.mBadReads++;
+            }
+        }
+    });
+
+    const UInt32 theUpdates = static_cast<UInt32>(inSeconds * 1000);
+    auto theNextUpdate = std::chrono::steady_clock::now();
+
+    for(UInt32 theUpdate = 0; theUpdate < theUpdates; theUpdate++)
+    {
+        theNextUpdate += std::chrono::milliseconds(1);
+        std::this_thread::sleep_until(theNextUpdate);
+
+        const UInt64 theStart = CAHostTimeBase::GetTheCurrentTime();
+        inUpdate(theUpdate);
+        RecordHostTicks(theResult.mUpdates, theStart);
+    }
+
+    theStop = true;
+    theReader.join();
+
+    return theResult;
+}
+
+static void PrintStormResult(const char* inName, const StormResult& inResult)
+{
+    auto Micros = [] (UInt64 inHostTicks) { return CAHostTimeBase::ConvertToNanos(inHostTicks) / 1000.0; };
+    auto Quantile = [&] (const EFF_IOStats::OperationStats& inStats, Float64 inFraction) {
+        return Micros(EFF_IOStats::GetQuantileHostTicks(inStats, inFraction));
+    };
+
+    printf("    %-12s %10llu %8.2f %8.2f %8.2f %9.1f %9llu %8.1f %8.1f %9.1f\n",
+           inName,
+           static_cast<unsigned long long>(inResult.mReads.mCount),
+           Quantile(inResult.mReads, 0.5),
+           Quantile(inResult.mReads, 0.99),
+           Quantile(inResult.mReads, 0.999),
+           Micros(inResult.mReads.mMaxHostTicks),
+           static_cast<unsigned long long>(inResult.mUpdates.mCount),
+           Quantile(inResult.mUpdates, 0.5),
+           Quantile(inResult.mUpdates, 0.99),
+           Micros(inResult.mUpdates.mMaxHostTicks));
+}
+
+static void BenchmarkUpdateStorms(Float64 inSeconds)
+{
+    auto theVolume = [] (UInt32 inUpdate) { return (inUpdate / kStormClients % 2 == 0) ? 0.75f : 0.5f; };
+
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+    for(UInt32 theClientID = 1; theClientID <= kStormClients; theClientID++)
+    {
+        theClientMap->AddClient(MakeClient(theClientID));
+        theClientMap->SetClientsRelativeVolume(MakeClient(theClientID).mProcessID, 0.5f, 0, kEFFAppVolumeRampShapeLinear);
+    }
+
+    const StormResult theSnapshots = RunUpdateStorm(inSeconds, [&] (UInt32 inCall) {
+        EFF_ClientIOParams theParams;
+        const bool didFind = theClientMap->GetClientIOParamsRT(1 + inCall % kStormClients, theParams);
+        return didFind ? theParams.mRelativeVolume : -1.0f;
+    }, [&] (UInt32 inUpdate) {
+        theClientMap->SetClientsRelativeVolume(MakeClient(1 + inUpdate % kStormClients).mProcessID,
+                                               theVolume(inUpdate),
+                                               0,
+                                               kEFFAppVolumeRampShapeLinear);
+    });
+
+    ShadowMapClientMap theShadowMapClientMap(kStormClients);
+    for(UInt32 theClientID = 1; theClientID <= kStormClients; theClientID++)
+    {
+        theShadowMapClientMap.SetClientsRelativeVolume(MakeClient(theClientID).mProcessID, 0.5f);
+    }
+
+    const StormResult theShadowMaps = RunUpdateStorm(inSeconds, [&] (UInt32 inCall) {
+        ShadowMapClient theClient;
+        const bool didFind = theShadowMapClientMap.GetClientRT(1 + inCall % kStormClients, theClient);
+        return didFind ? theClient.mClient.mRelativeVolume : -1.0f;
+    }, [&] (UInt32 inUpdate) {
+        theShadowMapClientMap.SetClientsRelativeVolume(MakeClient(1 + inUpdate % kStormClients).mProcessID,
+                                                       theVolume(inUpdate));
+    });
+
+    printf("\n1 kHz volume changes, %u clients, %.1f s (µs):\n", kStormClients, inSeconds);
+    printf("    %-12s %10s %8s %8s %8s %9s %9s %8s %8s %9s\n",
+           "", "reads", "p50", "p99", "p99.9", "max", "changes", "p50", "p99", "max");
+    PrintStormResult("snapshots", theSnapshots);
+    PrintStormResult("shadow maps", theShadowMaps);
+
+    for(const StormResult* theResult : { &theSnapshots, &theShadowMaps })
+    {
+        EFFCheck(theResult->mReads.mCount > 0);
+        EFFCheck(theResult->mUpdates.mCount == static_cast<UInt64>(inSeconds * 1000));
+        EFFCheck(theResult->mBadReads == 0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const UInt32 theCalls = theQuick ? 200 : 20000;
+    const UInt32 theRepeats = theQuick ? 3 : 20;
+    Float64 theStormSeconds = theQuick ? 0.2 : 10.0;
+
+    for(int theArg = 1; theArg < argc - 1; theArg++)
+    {
+        if(strcmp(argv[theArg], "--seconds") == 0)
+        {
+            theStormSeconds = atof(argv[theArg + 1]);
+        }
+    }
+
+    for(UInt32 theClientCount : kClientCounts)
+    {
+        auto theClientMap = std::make_unique<EFF_ClientMap>();
+        // What the old snapshots were copied from.
+        std::map<UInt32, EFF_Client> theClients;
+
+        for(UInt32 theClientID = 1; theClientID <= theClientCount; theClientID++)
+        {
+            theClientMap->AddClient(MakeClient(theClientID));
+            theClients[theClientID] = MakeClient(theClientID);
+        }
+
+        const pid_t theChangedPID = MakeClient(theClientCount / 2).mProcessID;
+
+        EFF_TestHarness::Stats theVolume = TimeCalls(theRepeats, theCalls, [&] (UInt32 inCall) {
+            theClientMap->SetClientsRelativeVolume(theChangedPID,
+                                                   (inCall % 2 == 0) ? 0.5f : 0.75f,
+                                                   0,
+                                                   kEFFAppVolumeRampShapeLinear);
+        });
+
+        EFF_TestHarness::Stats theIOState = TimeCalls(theRepeats, theCalls, [&] (UInt32 inCall) {
+            if(inCall % 2 == 0)
+            {
+                theClientMap->StartIONonRT(theClientCount / 2);
+            }
+            else
+            {
+                theClientMap->StopIONonRT(theClientCount / 2);
+            }
+        });
+
+        EFF_TestHarness::Stats theCopy = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+            auto* theSnapshot = new std::map<UInt32, EFF_Client>(theClients);
+            EFF_TestHarness::DoNotOptimise(theSnapshot->size());
+            delete theSnapshot;
+        });
+
+        EFF_TestHarness::Stats theLookup = TimeCalls(theRepeats, theCalls * 10, [&] (UInt32 inCall) {
+            EFF_ClientIOParams theParams;
+            theClientMap->GetClientIOParamsRT(1 + inCall % theClientCount, theParams);
+            EFF_TestHarness::DoNotOptimise(theParams.mRelativeVolume);
+        });
+
+        const UInt32 kBatchSize = std::min(16u, theClientCount);
+
+        EFF_TestHarness::Stats theSeparate = TimeCalls(theRepeats, theCalls / 10, [&] (UInt32 inCall) {
+            for(UInt32 i = 0; i < kBatchSize; i++)
+            {
+                theClientMap->SetClientsRelativeVolume(MakeClient(1 + i).mProcessID,
+                                                       (inCall % 2 == 0) ? 0.5f : 0.75f,
+                                                       0,
+                                                       kEFFAppVolumeRampShapeLinear);
+            }
+        });
+
+        EFF_TestHarness::Stats theBatched = TimeCalls(theRepeats, theCalls / 10, [&] (UInt32 inCall) {
+            EFF_ClientMap::Transaction theTransaction(*theClientMap);
+
+            for(UInt32 i = 0; i < kBatchSize; i++)
+            {
+                theTransaction.SetClientsRelativeVolume(MakeClient(1 + i).mProcessID,
+                                                        (inCall % 2 == 0) ? 0.5f : 0.75f,
+                                                        0,
+                                                        kEFFAppVolumeRampShapeLinear);
+            }
+
+            theTransaction.Commit();
+        });
+
+        printf("%3u clients (p50s):\n", theClientCount);
+        printf("    volume change      %8.0f ns, with copy %8.0f ns\n",
+               theVolume.mP50,
+               theVolume.mP50 + theCopy.mP50);
+        printf("    start/stop IO      %8.0f ns, with copy %8.0f ns\n",
+               theIOState.mP50,
+               theIOState.mP50 + theCopy.mP50);
+        printf("    IO params lookup   %8.1f ns\n", theLookup.mP50);
+        printf("    %u volume changes: separately %8.0f ns, in one transaction %8.0f ns\n",
+               kBatchSize,
+               theSeparate.mP50,
+               theBatched.mP50);
+    }
+
+    BenchmarkUpdateStorms(theStormSeconds);
+
+    return EFF_TestHarness::Finish("EFF_ClientMapBenchmark");
+}
@@ -0,0 +1,186 @@
+//
+//  EFF_ClientMapTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests that EFF_ClientMap's transactions publish their changes to the IO params only when they're
+//  committed, and that a transaction destroyed without being committed undoes its changes. Also
+//  tests that CopyClientsChangedSince tells the caller to resync when clients have been removed.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_ClientMap.h"
+
+// STL Includes
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+static EFF_Client MakeClient(UInt32 inClientID)
+{
+    EFF_Client theClient;
+    theClient.mClientID = inClientID;
+    theClient.mProcessID = static_cast<pid_t>(1000 + inClientID);
+    return theClient;
+}
+
+static Float32 IOVolume(const EFF_ClientMap& inClientMap, UInt32 inClientID)
+{
+    EFF_ClientIOParams theParams;
+    inClientMap.GetClientIOParamsRT(inClientID, theParams);
+    return theParams.mRelativeVolume;
+}
+
+static Float32 MapVolume(const EFF_ClientMap& inClientMap, UInt32 inClientID)
+{
+    EFF_Client theClient;
+    EFFCheck(inClientMap.GetClientNonRT(inClientID, &theClient));
+    return theClient.mRelativeVolume;
+}
+
+static void TestCommit()
+{
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+    theClientMap->AddClient(MakeClient(1));
+    theClientMap->AddClient(MakeClient(2));
+
+    {
+        EFF_ClientMap::Transaction theTransaction(*theClientMap);
+        theTransaction.SetClientsRelativeVolume(MakeClient(1).mProcessID, 0.5f, 0, kEFFAppVolumeRampShapeLinear);
+        theTransaction.SetClientsRelativeVolume(MakeClient(2).mProcessID, 0.25f, 0, kEFFAppVolumeRampShapeLinear);
+
+        // Not published yet.
+        EFFCheck(IOVolume(*theClientMap, 1) == 1.0f);
+
+        theTransaction.Commit();
+
+        EFFCheck(IOVolume(*theClientMap, 1) == 0.5f);
+        EFFCheck(IOVolume(*theClientMap, 2) == 0.25f);
+    }
+
+    EFFCheck(MapVolume(*theClientMap, 1) == 0.5f);
+    EFFCheck(MapVolume(*theClientMap, 2) == 0.25f);
+}
+
+static void TestDiscard()
+{
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+    theClientMap->AddClient(MakeClient(1));
+    theClientMap->AddClient(MakeClient(2));
+
+    // A change, an added client and a removed client, then an exception before the commit.
+    try
+    {
+        EFF_ClientMap::Transaction theTransaction(*theClientMap);
+        theTransaction.SetClientsRelativeVolume(MakeClient(1).mProcessID, 0.5f, 0, kEFFAppVolumeRampShapeLinear);
+        theTransaction.AddClient(MakeClient(3));
+        theTransaction.RemoveClient(2);
+        theTransaction.SetClientsPanPosition(MakeClient(1).mProcessID, 50, 0, kEFFAppVolumeRampShapeLinear);
+        throw std::runtime_error("Stopped before committing");
+    }
+    catch(const std::runtime_error&)
+    {
+    }
+
+    EFF_Client theClient;
+
+    EFFCheck(theClientMap->GetClientNonRT(1, &theClient));
+    EFFCheck(theClient.mRelativeVolume == 1.0f);
+    EFFCheck(theClient.mPanPosition == 0);
+    EFFCheck(theClientMap->GetClientNonRT(2, &theClient));
+    EFFCheck(!theClientMap->GetClientNonRT(3, &theClient));
+    EFFCheck(theClientMap->GetClientsByPID(MakeClient(2).mProcessID).size() == 1);
+    EFFCheck(theClientMap->GetClientsByPID(MakeClient(3).mProcessID).empty());
+
+    // The IO params never saw the changes.
+    EFF_ClientIOParams theParams;
+    EFFCheck(theClientMap->GetClientIOParamsRT(1, theParams));
+    EFFCheck(theParams.mRelativeVolume == 1.0f);
+    EFFCheck(theClientMap->GetClientIOParamsRT(2, theParams));
+    EFFCheck(!theClientMap->GetClientIOParamsRT(3, theParams));
+
+    // The clients still work normally afterwards.
+    EFFCheck(theClientMap->SetClientsRelativeVolume(MakeClient(2).mProcessID, 0.75f, 0, kEFFAppVolumeRampShapeLinear));
+    EFFCheck(IOVolume(*theClientMap, 2) == 0.75f);
+    theClientMap->RemoveClient(2);
+    EFFCheck(!theClientMap->GetClientIOParamsRT(2, theParams));
+}
+
+// Only the changes after the last commit are discarded.
+static void TestDiscardAfterCommit()
+{
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+    theClientMap->AddClient(MakeClient(1));
+
+    {
+        EFF_ClientMap::Transaction theTransaction(*theClientMap);
+        theTransaction.SetClientsRelativeVolume(MakeClient(1).mProcessID, 0.5f, 0, kEFFAppVolumeRampShapeLinear);
+        theTransaction.Commit();
+        theTransaction.SetClientsRelativeVolume(MakeClient(1).mProcessID, 0.25f, 0, kEFFAppVolumeRampShapeLinear);
+    }
+
+    EFFCheck(MapVolume(*theClientMap, 1) == 0.5f);
+    EFFCheck(IOVolume(*theClientMap, 1) == 0.5f);
+}
+
+static void TestChangedSince()
+{
+    auto theClientMap = std::make_unique<EFF_ClientMap>();
+    theClientMap->AddClient(MakeClient(1));
+    theClientMap->AddClient(MakeClient(2));
+    theClientMap->AddClient(MakeClient(3));
+
+    UInt64 theGeneration = 0;
+    bool isFullCopy = false;
+    EFFCheck(theClientMap->CopyClientsChangedSince(0, theGeneration, isFullCopy).size() == 3);
+    EFFCheck(isFullCopy);
+
+    // Only the change.
+    const UInt64 theGenerationBeforeChange = theGeneration;
+    theClientMap->SetClientsRelativeVolume(MakeClient(2).mProcessID, 0.5f, 0, kEFFAppVolumeRampShapeLinear);
+    std::vector<EFF_Client> theChanges =
+            theClientMap->CopyClientsChangedSince(theGenerationBeforeChange, theGeneration, isFullCopy);
+    EFFCheck(!isFullCopy);
+    EFFCheck(theChanges.size() == 1 && theChanges[0].mClientID == 2);
+    EFFCheck(theGeneration > theGenerationBeforeChange);
+
+    // Nothing changed since.
+    EFFCheck(theClientMap->CopyClientsChangedSince(theGeneration, theGeneration, isFullCopy).empty());
+    EFFCheck(!isFullCopy);
+
+    // A removal can't be reported as a change, so a caller from before it gets everything.
+    const UInt64 theGenerationBeforeRemoval = theGeneration;
+    theClientMap->RemoveClient(3);
+    theChanges = theClientMap->CopyClientsChangedSince(theGenerationBeforeRemoval, theGeneration, isFullCopy);
+    EFFCheck(isFullCopy);
+    EFFCheck(theChanges.size() == 2);
+
+    // But not a caller from after it.
+    EFFCheck(theClientMap->CopyClientsChangedSince(theGeneration, theGeneration, isFullCopy).empty());
+    EFFCheck(!isFullCopy);
+
+    // A discarded removal doesn't count.
+    const UInt64 theGenerationBeforeDiscard = theGeneration;
+    {
+        EFF_ClientMap::Transaction theTransaction(*theClientMap);
+        theTransaction.RemoveClient(1);
+    }
+    EFFCheck(theClientMap->CopyClientsChangedSince(theGenerationBeforeDiscard, theGeneration, isFullCopy).empty());
+    EFFCheck(!isFullCopy);
+}
+
+int main()
+{
+    TestCommit();
+    TestDiscard();
+    TestDiscardAfterCommit();
+    TestChangedSince();
+
+    return EFF_TestHarness::Finish("EFF_ClientMapTests");
+}
@@ -0,0 +1,173 @@
+//
+//  EFF_ClientParamsTableBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Compares the cost of getting every client's IO settings once per IO cycle from
+//  EFF_ClientParamsTable against the path ProcessOutput used before it: three separate lookups per
+//  client (IsMusicPlayerRT, GetClientRelativeVolumeRT and GetClientPanPositionRT), each of which
+//  locked the maps mutex, searched a std::map and copied the client.
+//
+//  The old path is modelled rather than run, since its code is gone. Copying an EFF_Client used to
+//  retain and release its CACFString. That's modelled as an atomic increment and decrement, which
+//  is cheaper than CFRetain/CFRelease, so the old path's numbers are a lower bound.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_ClientParamsTable.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+
+namespace
+{
+    // Stands in for a CFString's refcount.
+    struct RefCountedString
+    {
+        std::atomic<SInt32>     mRefCount   { 1 };
+        char                    mChars[32]  = "com.example.app";
+    };
+
+    // Stands in for CACFString: copying it retains the string and destroying it releases it.
+    class StringRef
+    {
+    public:
+        explicit StringRef(RefCountedString* inString) : mString(inString) { }
+        StringRef(const StringRef& inOther) : mString(inOther.mString) { mString->mRefCount.fetch_add(1); }
+        ~StringRef() { mString->mRefCount.fetch_sub(1); }
+        StringRef& operator=(const StringRef&) = delete;
+
+    private:
+        RefCountedString*       mString;
+    };
+
+    // The fields EFF_Client had when ProcessOutput copied it.
+    struct OldClient
+    {
+        UInt32                  mClientID;
+        pid_t                   mProcessID;
+        bool                    mIsNativeEndian;
+        StringRef               mBundleID;
+        bool                    mDoingIO;
+        bool                    mIsMusicPlayer;
+        Float32                 mRelativeVolume;
+        SInt32                  mPanPosition;
+    };
+
+    class OldClientMap
+    {
+    public:
+        void                    Add(const OldClient& inClient) { mClients.emplace(inClient.mClientID, inClient); }
+
+        // Each of these is one of the old EFF_Clients RT getters.
+        bool IsMusicPlayerRT(UInt32 inClientID) const { return GetClientRT(inClientID).mIsMusicPlayer; }
+        Float32 GetClientRelativeVolumeRT(UInt32 inClientID) const { return GetClientRT(inClientID).mRelativeVolume; }
+        SInt32 GetClientPanPositionRT(UInt32 inClientID) const { return GetClientRT(inClientID).mPanPosition; }
+
+    private:
+        OldClient GetClientRT(UInt32 inClientID) const
+        {
+            std::lock_guard<std::mutex> theLock(mMapsMutex);
+            return mClients.at(inClientID);
+        }
+
+        mutable std::mutex      mMapsMutex;
+        std::map<UInt32, OldClient> mClients;
+    };
+}
+
+static void Benchmark(UInt32 inClients, UInt32 inCycles)
+{
+    RefCountedString theBundleID;
+    OldClientMap theOldMap;
+    auto theTable = std::make_unique<EFF_ClientParamsTable>();
+
+    // The HAL assigns client IDs incrementally.
+    std::vector<UInt32> theClientIDs(inClients);
+    std::iota(theClientIDs.begin(), theClientIDs.end(), 1000);
+
+    for(UInt32 theClientID : theClientIDs)
+    {
+        theOldMap.Add(OldClient { theClientID, 100, true, StringRef(&theBundleID), true, false, 0.5f, 10 });
+
+        EFF_ClientIOParams theParams;
+        theParams.mRelativeVolume = 0.5f;
+        theParams.mPanPosition = 10;
+        theTable->SetParams(theClientID, theParams);
+    }
+
+    // The HAL doesn't necessarily call ProcessOutput in client ID order.
+    UInt32 theSeed = 7;
+    for(UInt32 i = inClients - 1; i > 0; i--)
+    {
+        theSeed = theSeed * 1664525 + 1013904223;
+        std::swap(theClientIDs[i], theClientIDs[(theSeed >> 8) % (i + 1)]);
+    }
+
+    std::vector<double> theOldTimes, theNewTimes;
+    Float32 theSum = 0;
+
+    for(UInt32 theCycle = 0; theCycle < inCycles; theCycle++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theClientID : theClientIDs)
+        {
+            bool theIsMusicPlayer = theOldMap.IsMusicPlayerRT(theClientID);
+            Float32 theVolume = theOldMap.GetClientRelativeVolumeRT(theClientID);
+            SInt32 thePan = theOldMap.GetClientPanPositionRT(theClientID);
+            theSum += theVolume + thePan + theIsMusicPlayer;
+        }
+
+        double theMiddle = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theClientID : theClientIDs)
+        {
+            EFF_ClientIOParams theParams;
+            EFF_ClientRampState* theRampState = nullptr;
+            theTable->GetParamsRT(theClientID, theParams, &theRampState);
+            theSum += theParams.mRelativeVolume + theParams.mPanPosition + theParams.mIsMusicPlayer;
+            EFF_TestHarness::DoNotOptimise(theRampState);
+        }
+
+        double theEnd = EFF_TestHarness::NowSeconds();
+
+        theOldTimes.push_back(theMiddle - theStart);
+        theNewTimes.push_back(theEnd - theMiddle);
+    }
+
+    EFF_TestHarness::DoNotOptimise(theSum);
+
+    EFF_TestHarness::Stats theOld = EFF_TestHarness::Summarise(theOldTimes);
+    EFF_TestHarness::Stats theNew = EFF_TestHarness::Summarise(theNewTimes);
+
+    printf("%u clients, per IO cycle:\n", inClients);
+    printf("  three locked map lookups: mean %8.0f ns (%5.1f ns/client), p99 %8.0f ns\n",
+           theOld.mMean * 1e9, theOld.mMean * 1e9 / inClients, theOld.mP99 * 1e9);
+    printf("  params table:             mean %8.0f ns (%5.1f ns/client), p99 %8.0f ns\n",
+           theNew.mMean * 1e9, theNew.mMean * 1e9 / inClients, theNew.mP99 * 1e9);
+    printf("  speed-up: %.1fx\n", theOld.mMean / theNew.mMean);
+}
+
+int main(int argc, char* argv[])
+{
+    UInt32 theCycles = EFF_TestHarness::IsQuick(argc, argv) ? 200 : 20000;
+
+    Benchmark(64, theCycles);
+    Benchmark(512, theCycles);
+
+    return 0;
+}
+
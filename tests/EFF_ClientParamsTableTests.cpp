@@ -0,0 +1,349 @@
+//
+//  EFF_ClientParamsTableTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests EFF_ClientParamsTable's lookups through client churn, that a reader running alongside
+//  the writer only ever sees a complete set of settings that was stored for the client it asked
+//  for, and that the IO thread's per-cycle lookups only ever see whole batches.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_ClientParamsTable.h"
+
+// STL Includes
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+
+// Settings derived from a client ID and a version number, so a reader can tell whether what it got
+// is a consistent set for that client.
+static EFF_ClientIOParams ParamsFor(UInt32 inClientID, UInt32 inVersion)
+{
+    EFF_ClientIOParams theParams;
+    theParams.mRelativeVolume = static_cast<Float32>(inVersion % 1000) / 500.0f;
+    theParams.mPanPosition = static_cast<SInt8>(static_cast<SInt32>((inClientID + inVersion) % 201) - 100);
+    theParams.mIsMusicPlayer = ((inClientID + inVersion) % 3) == 0;
+    theParams.mRampFrames = static_cast<UInt16>(inClientID % 4096);
+    return theParams;
+}
+
+static bool ParamsAreConsistent(UInt32 inClientID, const EFF_ClientIOParams& inParams)
+{
+    // The volume gives the version mod 1000 and the pan position gives it mod 201, so only 201
+    // versions need to be tried.
+    UInt32 theVersion = static_cast<UInt32>(inParams.mRelativeVolume * 500.0f + 0.5f);
+
+    for(UInt32 theCandidate = theVersion; theCandidate < theVersion + 201 * 1000; theCandidate += 1000)
+    {
+        EFF_ClientIOParams theExpected = ParamsFor(inClientID, theCandidate);
+
+        if(theExpected.mPanPosition == inParams.mPanPosition &&
+           theExpected.mIsMusicPlayer == inParams.mIsMusicPlayer &&
+           theExpected.mRampFrames == inParams.mRampFrames &&
+           theExpected.mRelativeVolume == inParams.mRelativeVolume)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ParamsEqual(const EFF_ClientIOParams& inA, const EFF_ClientIOParams& inB)
+{
+    return inA.mRelativeVolume == inB.mRelativeVolume &&
+           inA.mPanPosition == inB.mPanPosition &&
+           inA.mIsMusicPlayer == inB.mIsMusicPlayer &&
+           inA.mRampFrames == inB.mRampFrames;
+}
+
+// Add and remove clients at random, checking every lookup against a std::map.
+static void TestChurn()
+{
+    auto theTable = std::make_unique<EFF_ClientParamsTable>();
+    std::map<UInt32, EFF_ClientIOParams> theExpected;
+    UInt32 theSeed = 1;
+    UInt32 theNextClientID = 1;
+
+    for(UInt32 theStep = 0; theStep < 200000; theStep++)
+    {
+        theSeed = theSeed * 1664525 + 1013904223;
+        UInt32 theAction = (theSeed >> 16) % 4;
+
+        if(theAction == 0 && theExpected.size() < 700)
+        {
+            UInt32 theClientID = theNextClientID++;
+            theExpected[theClientID] = ParamsFor(theClientID, theStep);
+            EFFCheck(theTable->SetParams(theClientID, theExpected[theClientID]));
+        }
+        else if(theAction == 1 && !theExpected.empty())
+        {
+            auto theClient = theExpected.begin();
+            std::advance(theClient, (theSeed >> 4) % theExpected.size());
+            theTable->RemoveClient(theClient->first);
+            theExpected.erase(theClient);
+        }
+        else if(theAction == 2 && !theExpected.empty())
+        {
+            auto theClient = theExpected.begin();
+            std::advance(theClient, (theSeed >> 4) % theExpected.size());
+            theClient->second = ParamsFor(theClient->first, theStep);
+            EFFCheck(theTable->SetParams(theClient->first, theClient->second));
+        }
+        else
+        {
+            UInt32 theClientID = 1 + (theSeed >> 4) % theNextClientID;
+            EFF_ClientIOParams theParams;
+            bool theFound = theTable->GetParamsRT(theClientID, theParams);
+            auto theExpectedParams = theExpected.find(theClientID);
+
+            EFFCheck(theFound == (theExpectedParams != theExpected.end()));
+            EFFCheck(ParamsEqual(theParams, theFound ? theExpectedParams->second : EFF_ClientIOParams()));
+        }
+    }
+}
+
+static void TestFull()
+{
+    auto theTable = std::make_unique<EFF_ClientParamsTable>();
+
+    for(UInt32 theClientID = 1; theClientID <= EFF_ClientParamsTable::kCapacity; theClientID++)
+    {
+        EFFCheck(theTable->SetParams(theClientID, ParamsFor(theClientID, 1)));
+    }
+
+    // Full, so new clients get the defaults.
+    EFFCheck(!theTable->SetParams(EFF_ClientParamsTable::kCapacity + 1, ParamsFor(1, 1)));
+
+    EFF_ClientIOParams theParams;
+    EFFCheck(!theTable->GetParamsRT(EFF_ClientParamsTable::kCapacity + 1, theParams));
+    EFFCheck(ParamsEqual(theParams, EFF_ClientIOParams()));
+
+    // Existing clients can still be updated.
+    EFFCheck(theTable->SetParams(7, ParamsFor(7, 2)));
+    EFFCheck(theTable->GetParamsRT(7, theParams));
+    EFFCheck(ParamsEqual(theParams, ParamsFor(7, 2)));
+}
+
+// The writer keeps changing settings, and removing clients and adding new ones (which reuses their
+// slots), while the reader looks clients up.
+static void TestConcurrentReads(double inSeconds)
+{
+    auto theTable = std::make_unique<EFF_ClientParamsTable>();
+    const UInt32 kClients = 64;
+
+    for(UInt32 theClientID = 1; theClientID <= kClients; theClientID++)
+    {
+        theTable->SetParams(theClientID, ParamsFor(theClientID, 0));
+    }
+
+    std::atomic<bool> theStop { false };
+    std::atomic<UInt32> theHighestClientID { kClients };
+
+    std::thread theWriter([&] {
+        EFF_TestHarness::PinThreadToCPU(0);
+
+        UInt32 theVersion = 1;
+        UInt32 theOldestClientID = 1;
+
+        while(!theStop.load(std::memory_order_relaxed))
+        {
+            UInt32 theHighest = theHighestClientID.load(std::memory_order_relaxed);
+
+            for(UInt32 theClientID = theOldestClientID; theClientID <= theHighest; theClientID++)
+            {
+                theTable->SetParams(theClientID, ParamsFor(theClientID, theVersion));
+            }
+
+            // Replace the oldest client with a new one.
+            theTable->RemoveClient(theOldestClientID++);
+            theTable->SetParams(theHighest + 1, ParamsFor(theHighest + 1, theVersion));
+            theHighestClientID.store(theHighest + 1, std::memory_order_relaxed);
+
+            theVersion++;
+        }
+    });
+
+    EFF_TestHarness::PinThreadToCPU(1);
+
+    UInt64 theLookups = 0, theFound = 0, theInconsistent = 0;
+    UInt32 theSeed = 99;
+    double theEndTime = EFF_TestHarness::NowSeconds() + inSeconds;
+
+    while(EFF_TestHarness::NowSeconds() < theEndTime)
+    {
+        theSeed = theSeed * 1664525 + 1013904223;
+        UInt32 theHighest = theHighestClientID.load(std::memory_order_relaxed);
+        UInt32 theLag = (theSeed >> 8) % (2 * kClients);
+
+        if(theLag >= theHighest)
+        {
+            continue;
+        }
+
+        // Sometimes a current client and sometimes a removed one.
+        UInt32 theClientID = theHighest - theLag;
+
+        EFF_ClientIOParams theParams;
+        if(theTable->GetParamsRT(theClientID, theParams))
+        {
+            theFound++;
+
+            if(!ParamsAreConsistent(theClientID, theParams))
+            {
+                theInconsistent++;
+            }
+        }
+        else if(!ParamsEqual(theParams, EFF_ClientIOParams()))
+        {
+            theInconsistent++;
+        }
+
+        theLookups++;
+    }
+
+    theStop = true;
+    theWriter.join();
+
+    printf("concurrent: %llu lookups, %llu found, %llu inconsistent\n",
+           static_cast<unsigned long long>(theLookups),
+           static_cast<unsigned long long>(theFound),
+           static_cast<unsigned long long>(theInconsistent));
+
+    EFFCheck(theInconsistent == 0);
+    EFFCheck(theFound > 0);
+}
+
+// Settings that give the batch they were stored in. Float32 holds the version exactly up to 2^24.
+static EFF_ClientIOParams ParamsForBatch(UInt32 inVersion)
+{
+    EFF_ClientIOParams theParams;
+    theParams.mRelativeVolume = static_cast<Float32>(inVersion);
+    theParams.mPanPosition = static_cast<SInt8>(static_cast<SInt32>(inVersion % 201) - 100);
+    return theParams;
+}
+
+// The writer changes every client's settings to the next version in each batch, and replaces a
+// client with a new one. The reader plays the IO thread, looking every client up once per cycle,
+// slowly enough that batches land mid-cycle, and checks that each cycle only has one version and
+// that the versions only go forward.
+static void TestBatches(double inSeconds)
+{
+    auto theTable = std::make_unique<EFF_ClientParamsTable>();
+    const UInt32 kClients = 32;
+    const UInt32 kMaxVersion = 1 << 24;
+    // Batch n replaces client kReplacedClientIDBase + n - 1 with kReplacedClientIDBase + n.
+    const UInt32 kReplacedClientIDBase = 1000;
+
+    for(UInt32 theClientID = 1; theClientID <= kClients; theClientID++)
+    {
+        theTable->SetParams(theClientID, ParamsForBatch(0));
+    }
+
+    theTable->SetParams(kReplacedClientIDBase, ParamsForBatch(0));
+
+    std::atomic<bool> theStop { false };
+
+    std::thread theWriter([&] {
+        EFF_TestHarness::PinThreadToCPU(0);
+
+        for(UInt32 theVersion = 1; theVersion < kMaxVersion && !theStop.load(std::memory_order_relaxed); theVersion++)
+        {
+            theTable->BeginBatch();
+
+            for(UInt32 theClientID = 1; theClientID <= kClients; theClientID++)
+            {
+                theTable->SetParams(theClientID, ParamsForBatch(theVersion));
+
+                // Let the reader run mid-batch, even with one CPU.
+                if(theClientID == kClients / 2)
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            theTable->RemoveClient(kReplacedClientIDBase + theVersion - 1);
+            theTable->SetParams(kReplacedClientIDBase + theVersion, ParamsForBatch(theVersion));
+
+            theTable->EndBatch();
+
+            // Leave gaps between the batches, as EFF_ClientMap's writers do, or the reader would
+            // rarely find the table between batches and would keep using its old copy.
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+
+    EFF_TestHarness::PinThreadToCPU(1);
+
+    UInt64 theCycles = 0, thePartialCycles = 0, theUnbatchedPartialCycles = 0, theVersionsSeen = 0;
+    UInt32 theLastVersion = 0;
+    double theEndTime = EFF_TestHarness::NowSeconds() + inSeconds;
+
+    for(UInt64 theCycle = 0; EFF_TestHarness::NowSeconds() < theEndTime; theCycle++)
+    {
+        EFF_ClientIOParams theParams;
+        EFF_ClientRampState* theRampState;
+        bool thePartial = !theTable->GetParamsForCycleRT(theCycle, 1, theParams, &theRampState);
+        const UInt32 theVersion = static_cast<UInt32>(theParams.mRelativeVolume);
+        bool theUnbatchedPartial = false;
+
+        for(UInt32 theClientID = 1; theClientID <= kClients; theClientID++)
+        {
+            thePartial |= !theTable->GetParamsForCycleRT(theCycle, theClientID, theParams, &theRampState);
+            thePartial |= (theRampState == nullptr) || !ParamsEqual(theParams, ParamsForBatch(theVersion));
+
+            // The same lookup without the cycle's copy, to show how often a batch lands mid-cycle.
+            theTable->GetParamsRT(theClientID, theParams);
+            theUnbatchedPartial |= !ParamsEqual(theParams, ParamsForBatch(theVersion));
+
+            for(volatile UInt32 theDelay = 0; theDelay < 200; theDelay++) { }
+        }
+
+        // The client the batch added should be in the cycle's copy and the one it removed shouldn't.
+        thePartial |= !theTable->GetParamsForCycleRT(theCycle, kReplacedClientIDBase + theVersion, theParams);
+        thePartial |= (theVersion > 0) &&
+                      theTable->GetParamsForCycleRT(theCycle, kReplacedClientIDBase + theVersion - 1, theParams);
+
+        // Batches are only published in order.
+        thePartial |= (theVersion < theLastVersion);
+
+        thePartialCycles += thePartial ? 1 : 0;
+        theUnbatchedPartialCycles += theUnbatchedPartial ? 1 : 0;
+        theVersionsSeen += (theVersion != theLastVersion) ? 1 : 0;
+        theLastVersion = theVersion;
+        theCycles++;
+    }
+
+    theStop = true;
+    theWriter.join();
+
+    printf("batches: %llu cycles, %llu versions seen, %llu partial (%llu with unbatched lookups)\n",
+           static_cast<unsigned long long>(theCycles),
+           static_cast<unsigned long long>(theVersionsSeen),
+           static_cast<unsigned long long>(thePartialCycles),
+           static_cast<unsigned long long>(theUnbatchedPartialCycles));
+
+    EFFCheck(thePartialCycles == 0);
+    EFFCheck(theVersionsSeen > 1);
+}
+
+int main(int argc, char* argv[])
+{
+    const double theSeconds = EFF_TestHarness::IsQuick(argc, argv) ? 0.3 : 2.0;
+
+    TestChurn();
+    TestFull();
+    TestConcurrentReads(theSeconds);
+    TestBatches(theSeconds);
+
+    return EFF_TestHarness::Finish("EFF_ClientParamsTableTests");
+}
+
@@ -0,0 +1,560 @@
+//
+//  EFF_DeviceSimulator.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Plays the HAL's part for EFFDevice, so the whole driver IO path can be benchmarked without
+//  installing the driver and restarting coreaudiod. It registers fake clients with
+//  EFF_Device::AddClient, gives them volumes and pan positions, starts IO for them and then runs
+//  IO cycles the way the HAL does: ReadInput for EFFApp, ProcessOutput for each client, then
+//  ProcessMix and WriteMix for the mix. It records the time each operation and each cycle takes
+//  and prints their distributions.
+//
+//  By default the cycles run back to back, which makes the results repeatable. With --realtime,
+//  each cycle starts when it would on real hardware, and cycles that take longer than the buffer's
+//  duration are counted as deadline misses.
+//
+//  --rate sets the device's nominal sample rate through kAudioDevicePropertyNominalSampleRate, the
+//  way the HAL would, before any IO starts.
+//
+//      EFF_DeviceSimulator [--clients N] [--frames N] [--rate HZ] [--cycles N] [--realtime] [--quick]
+//
+//  On macOS this links the real driver classes against the real frameworks. Elsewhere the driver
+//  is built against the stand-ins in compat, so the results show the driver's own costs but not
+//  CoreFoundation's or libdispatch's.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_Device.h"
+#include "EFF_PlugIn.h"
+#include "EFF_Types.h"
+
+// PublicUtility Includes
+#include "CADispatchQueue.h"
+#include "CAException.h"
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <mach/mach_time.h>
+#include <unistd.h>
+
+
+namespace
+{
+    struct Options
+    {
+        UInt32                  mClients        = 8;
+        UInt32                  mFrames         = 512;
+        Float64                 mSampleRate     = 44100.0;
+        UInt32                  mCycles         = 20000;
+        bool                    mRealTime       = false;
+    };
+
+    enum Operation
+    {
+        kOperationReadInput,
+        kOperationProcessOutput,
+        kOperationProcessMix,
+        kOperationWriteMix,
+        kOperationCycle,
+        kNumberOperations
+    };
+
+    const char* const kOperationNames[kNumberOperations] = {
+        "ReadInput",
+        "ProcessOutput",
+        "ProcessMix",
+        "WriteMix",
+        "Whole cycle"
+    };
+
+    // The client IDs the HAL would give EFFApp and the other clients. It numbers them from 1 in the
+    // order they're added.
+    const UInt32 kEFFAppClientID = 1;
+    const UInt32 kFirstClientID = 2;
+
+    // A fake process ID for each client other than EFFApp, which gets this process's.
+    pid_t FakeProcessID(UInt32 inClientID)
+    {
+        return static_cast<pid_t>(100000 + inClientID);
+    }
+}
+
+// The parts of the HAL's host interface the driver calls outside of IO. Nothing is stored and
+// property changes aren't sent anywhere. Configuration changes are performed straight away, which
+// is only safe because the simulator never requests one while IO is running.
+static OSStatus Host_PropertiesChanged(AudioServerPlugInHostRef,
+                                       AudioObjectID,
+                                       UInt32,
+                                       const AudioObjectPropertyAddress*)
+{
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_CopyFromStorage(AudioServerPlugInHostRef, CFStringRef, CFPropertyListRef* outData)
+{
+    *outData = nullptr;
+    return kAudioHardwareUnspecifiedError;
+}
+
+static OSStatus Host_WriteToStorage(AudioServerPlugInHostRef, CFStringRef, CFPropertyListRef)
+{
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_DeleteFromStorage(AudioServerPlugInHostRef, CFStringRef)
+{
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_RequestDeviceConfigurationChange(AudioServerPlugInHostRef,
+                                                      AudioObjectID inDeviceObjectID,
+                                                      UInt64 inChangeAction,
+                                                      void* inChangeInfo)
+{
+    if(inDeviceObjectID != kObjectID_Device)
+    {
+        return kAudioHardwareBadObjectError;
+    }
+
+    try
+    {
+        EFF_Device::GetInstance().PerformConfigChange(inChangeAction, inChangeInfo);
+    }
+    catch(const CAException& e)
+    {
+        return e.GetError();
+    }
+
+    return kAudioHardwareNoError;
+}
+
+static const AudioServerPlugInHostInterface kHost = {
+    Host_PropertiesChanged,
+    Host_CopyFromStorage,
+    Host_WriteToStorage,
+    Host_DeleteFromStorage,
+    Host_RequestDeviceConfigurationChange
+};
+
+static Options ParseOptions(int argc, char* argv[])
+{
+    Options theOptions;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string theArg = argv[i];
+        bool theHasValue = (i + 1 < argc);
+
+        if(theArg == "--clients" && theHasValue)
+        {
+            theOptions.mClients = static_cast<UInt32>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(theArg == "--frames" && theHasValue)
+        {
+            theOptions.mFrames = static_cast<UInt32>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(theArg == "--rate" && theHasValue)
+        {
+            theOptions.mSampleRate = strtod(argv[++i], nullptr);
+        }
+        else if(theArg == "--cycles" && theHasValue)
+        {
+            theOptions.mCycles = static_cast<UInt32>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(theArg == "--realtime")
+        {
+            theOptions.mRealTime = true;
+        }
+        else if(theArg == "--quick")
+        {
+            theOptions.mCycles = 200;
+        }
+        else
+        {
+            fprintf(stderr,
+                    "Usage: %s [--clients N] [--frames N] [--rate HZ] [--cycles N] [--realtime] [--quick]\n",
+                    argv[0]);
+            exit(2);
+        }
+    }
+
+    return theOptions;
+}
+
+// Gives each client other than EFFApp a volume and a pan position through
+// kAudioDeviceCustomPropertyAppVolumes, as EFFApp would, so ProcessOutput has to apply them.
+static void SetAppVolumes(EFF_Device& inDevice, const Options& inOptions)
+{
+    CFMutableArrayRef theAppVolumes = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+
+    for(UInt32 i = 0; i < inOptions.mClients; i++)
+    {
+        SInt32 theProcessID = FakeProcessID(kFirstClientID + i);
+        SInt32 theVolume = 80;
+        SInt32 thePan = static_cast<SInt32>(i % 5) * 25 - 50;
+
+        CFNumberRef theProcessIDRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &theProcessID);
+        CFNumberRef theVolumeRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &theVolume);
+        CFNumberRef thePanRef = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &thePan);
+
+        CFMutableDictionaryRef theApp = CFDictionaryCreateMutable(kCFAllocatorDefault,
+                                                                  0,
+                                                                  &kCFTypeDictionaryKeyCallBacks,
+                                                                  &kCFTypeDictionaryValueCallBacks);
+        CFDictionarySetValue(theApp, CFSTR(kEFFAppVolumesKey_ProcessID), theProcessIDRef);
+        CFDictionarySetValue(theApp, CFSTR(kEFFAppVolumesKey_RelativeVolume), theVolumeRef);
+        CFDictionarySetValue(theApp, CFSTR(kEFFAppVolumesKey_PanPosition), thePanRef);
+        CFArrayAppendValue(theAppVolumes, theApp);
+
+        CFRelease(theApp);
+        CFRelease(thePanRef);
+        CFRelease(theVolumeRef);
+        CFRelease(theProcessIDRef);
+    }
+
+    inDevice.SetPropertyData(kObjectID_Device,
+                             getpid(),
+                             kEFFAppVolumesAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFArrayRef),
+                             &theAppVolumes);
+
+    CFRelease(theAppVolumes);
+}
+
+// Sets the device's nominal sample rate as a HAL client would. The device requests the change from
+// the host asynchronously, on CADispatchQueue's global serial queue, so this waits for that queue
+// to run it before checking the result.
+static void SetSampleRate(EFF_Device& inDevice, Float64 inSampleRate)
+{
+    const AudioObjectPropertyAddress theAddress = {
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+
+    inDevice.SetPropertyData(kObjectID_Device, getpid(), theAddress, 0, nullptr, sizeof(Float64), &inSampleRate);
+
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, nullptr, [](void*) { });
+
+    Float64 theSampleRate = 0.0;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(kObjectID_Device,
+                             getpid(),
+                             theAddress,
+                             0,
+                             nullptr,
+                             sizeof(Float64),
+                             theSize,
+                             &theSampleRate);
+
+    if(theSampleRate != inSampleRate)
+    {
+        fprintf(stderr, "The device's sample rate is %.0f Hz, not %.0f Hz\n", theSampleRate, inSampleRate);
+        exit(1);
+    }
+}
+
+// A log-linear histogram: each power of two of nanoseconds is split into four buckets.
+static void PrintHistogram(const std::vector<double>& inNanos)
+{
+    const UInt32 kSubBuckets = 4;
+    std::vector<UInt64> theCounts(64 * kSubBuckets, 0);
+
+    for(double theNanos : inNanos)
+    {
+        UInt64 theValue = static_cast<UInt64>(std::max(theNanos, 1.0));
+        UInt32 theLog2 = 63 - static_cast<UInt32>(__builtin_clzll(theValue));
+        UInt32 theSub = (theLog2 >= 2) ? static_cast<UInt32>((theValue >> (theLog2 - 2)) & 3) : 0;
+        theCounts[theLog2 * kSubBuckets + theSub]++;
+    }
+
+    for(UInt32 i = 0; i < theCounts.size(); i++)
+    {
+        if(theCounts[i] == 0)
+        {
+            continue;
+        }
+
+        UInt32 theLog2 = i / kSubBuckets;
+        double theLowerBound = std::ldexp(1.0 + (i % kSubBuckets) / 4.0, static_cast<int>(theLog2));
+        double theFraction = static_cast<double>(theCounts[i]) / inNanos.size();
+
+        printf("      >= %9.0f ns %8llu %5.1f%% %s\n",
+               theLowerBound,
+               static_cast<unsigned long long>(theCounts[i]),
+               theFraction * 100.0,
+               std::string(static_cast<size_t>(std::ceil(theFraction * 40.0)), '#').c_str());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const Options theOptions = ParseOptions(argc, argv);
+    const UInt32 theFrames = theOptions.mFrames;
+
+    EFF_PlugIn::SetHost(&kHost);
+
+    EFF_Device& theDevice = EFF_Device::GetInstance();
+    const UInt32 theChannels = theDevice.GetChannelsPerFrame();
+
+    SetSampleRate(theDevice, theOptions.mSampleRate);
+
+    printf("%u clients, %u frame buffers at %.0f Hz, %u cycles%s\n",
+           theOptions.mClients,
+           theFrames,
+           theOptions.mSampleRate,
+           theOptions.mCycles,
+           theOptions.mRealTime ? ", real time" : "");
+
+    // Register EFFApp, which reads the device's input, and the clients that play audio.
+    std::vector<AudioServerPlugInClientInfo> theClients;
+    std::vector<CFStringRef> theBundleIDs;
+    theClients.reserve(theOptions.mClients + 1);
+
+    for(UInt32 theClientID = kEFFAppClientID; theClientID < kFirstClientID + theOptions.mClients; theClientID++)
+    {
+        bool theIsEFFApp = (theClientID == kEFFAppClientID);
+        std::string theBundleID = theIsEFFApp ? kEFFAppBundleID :
+                                                "com.example.simulator.client" + std::to_string(theClientID);
+
+        theBundleIDs.push_back(CFStringCreateWithCString(kCFAllocatorDefault,
+                                                         theBundleID.c_str(),
+                                                         kCFStringEncodingUTF8));
+
+        AudioServerPlugInClientInfo theClient;
+        theClient.mClientID = theClientID;
+        theClient.mProcessID = theIsEFFApp ? getpid() : FakeProcessID(theClientID);
+        theClient.mIsNativeEndian = true;
+        theClient.mBundleID = theBundleIDs.back();
+        theClients.push_back(theClient);
+
+        theDevice.AddClient(&theClients.back());
+    }
+
+    SetAppVolumes(theDevice, theOptions);
+
+    for(const AudioServerPlugInClientInfo& theClient : theClients)
+    {
+        theDevice.StartIO(theClient.mClientID);
+    }
+
+    // Each client plays a sine wave at a different frequency. It's copied into the client's buffer
+    // each cycle, since ProcessOutput changes it in place.
+    std::vector<std::vector<Float32>> theClientAudio(theOptions.mClients,
+                                                     std::vector<Float32>(theFrames * theChannels));
+    for(UInt32 i = 0; i < theOptions.mClients; i++)
+    {
+        for(UInt32 theFrame = 0; theFrame < theFrames; theFrame++)
+        {
+            Float32 theSample = 0.1f * std::sin(static_cast<Float32>(theFrame) * 0.01f * (i + 1));
+
+            for(UInt32 theChannel = 0; theChannel < theChannels; theChannel++)
+            {
+                theClientAudio[i][theFrame * theChannels + theChannel] = theSample;
+            }
+        }
+    }
+
+    std::vector<Float32> theClientBuffer(theFrames * theChannels);
+    std::vector<Float32> theMixBuffer(theFrames * theChannels);
+    std::vector<Float32> theInputBuffer(theFrames * theChannels);
+
+    std::vector<double> theTimes[kNumberOperations];
+    for(std::vector<double>& theOperationTimes : theTimes)
+    {
+        theOperationTimes.reserve(theOptions.mCycles * (theOptions.mClients + 1));
+    }
+
+    const Float64 theTicksPerFrame = CAHostTimeBase::GetFrequency() / theOptions.mSampleRate;
+    const UInt64 theCycleTicks = static_cast<UInt64>(theTicksPerFrame * theFrames);
+    const UInt64 theStartTime = CAHostTimeBase::GetTheCurrentTime();
+    UInt64 theDeadlineMisses = 0;
+    UInt64 theErrors = 0;
+
+    auto TimeOperation = [&theTimes, &theErrors](Operation inOperation, auto inFunction) {
+        UInt64 theOperationStart = CAHostTimeBase::GetTheCurrentTime();
+
+        try
+        {
+            inFunction();
+        }
+        catch(const CAException&)
+        {
+            theErrors++;
+        }
+
+        UInt64 theOperationEnd = CAHostTimeBase::GetTheCurrentTime();
+        theTimes[inOperation].push_back(
+                static_cast<double>(CAHostTimeBase::ConvertToNanos(theOperationEnd - theOperationStart)));
+    };
+
+    for(UInt32 theCycle = 0; theCycle < theOptions.mCycles; theCycle++)
+    {
+        const UInt64 theCycleHostTime = theStartTime + theCycleTicks * theCycle;
+
+        if(theOptions.mRealTime)
+        {
+            mach_wait_until(theCycleHostTime);
+        }
+
+        const UInt64 theCycleStart = CAHostTimeBase::GetTheCurrentTime();
+
+        // The HAL reads input from before the current time and writes output for after it, by the
+        // device's safety offsets. A buffer's length either way is enough here.
+        AudioServerPlugInIOCycleInfo theCycleInfo = {};
+        theCycleInfo.mIOCycleCounter = theCycle;
+        theCycleInfo.mNominalIOBufferFrameSize = theFrames;
+        theCycleInfo.mInputTime.mSampleTime = static_cast<Float64>(theCycle) * theFrames - theFrames;
+        theCycleInfo.mInputTime.mHostTime = theCycleHostTime - theCycleTicks;
+        theCycleInfo.mInputTime.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid;
+        theCycleInfo.mOutputTime.mSampleTime = static_cast<Float64>(theCycle) * theFrames + theFrames;
+        theCycleInfo.mOutputTime.mHostTime = theCycleHostTime + theCycleTicks;
+        theCycleInfo.mOutputTime.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid;
+        theCycleInfo.mMainHostTicksPerFrame = theTicksPerFrame;
+        theCycleInfo.mDeviceHostTicksPerFrame = theTicksPerFrame;
+
+        // EFFApp reads the device's input.
+        TimeOperation(kOperationReadInput, [&] {
+            theDevice.BeginIOOperation(kAudioServerPlugInIOOperationReadInput, theFrames, theCycleInfo, kEFFAppClientID);
+            theDevice.DoIOOperation(kObjectID_Stream_Input,
+                                    kEFFAppClientID,
+                                    kAudioServerPlugInIOOperationReadInput,
+                                    theFrames,
+                                    theCycleInfo,
+                                    theInputBuffer.data(),
+                                    nullptr);
+            theDevice.EndIOOperation(kAudioServerPlugInIOOperationReadInput, theFrames, theCycleInfo, kEFFAppClientID);
+        });
+
+        // Each client's output is processed and then mixed by the HAL.
+        std::fill(theMixBuffer.begin(), theMixBuffer.end(), 0.0f);
+
+        for(UInt32 i = 0; i < theOptions.mClients; i++)
+        {
+            const UInt32 theClientID = kFirstClientID + i;
+            std::copy(theClientAudio[i].begin(), theClientAudio[i].end(), theClientBuffer.begin());
+
+            TimeOperation(kOperationProcessOutput, [&] {
+                theDevice.BeginIOOperation(kAudioServerPlugInIOOperationProcessOutput,
+                                           theFrames,
+                                           theCycleInfo,
+                                           theClientID);
+                theDevice.DoIOOperation(kObjectID_Stream_Output,
+                                        theClientID,
+                                        kAudioServerPlugInIOOperationProcessOutput,
+                                        theFrames,
+                                        theCycleInfo,
+                                        theClientBuffer.data(),
+                                        nullptr);
+                theDevice.EndIOOperation(kAudioServerPlugInIOOperationProcessOutput,
+                                         theFrames,
+                                         theCycleInfo,
+                                         theClientID);
+            });
+
+            for(UInt32 j = 0; j < theMixBuffer.size(); j++)
+            {
+                theMixBuffer[j] += theClientBuffer[j];
+            }
+        }
+
+        bool theWillDoProcessMix, theWillDoInPlace;
+        theDevice.WillDoIOOperation(kAudioServerPlugInIOOperationProcessMix, theWillDoProcessMix, theWillDoInPlace);
+
+        if(theWillDoProcessMix)
+        {
+            TimeOperation(kOperationProcessMix, [&] {
+                theDevice.DoIOOperation(kObjectID_Stream_Output,
+                                        kFirstClientID,
+                                        kAudioServerPlugInIOOperationProcessMix,
+                                        theFrames,
+                                        theCycleInfo,
+                                        theMixBuffer.data(),
+                                        nullptr);
+            });
+        }
+
+        TimeOperation(kOperationWriteMix, [&] {
+            theDevice.DoIOOperation(kObjectID_Stream_Output,
+                                    kFirstClientID,
+                                    kAudioServerPlugInIOOperationWriteMix,
+                                    theFrames,
+                                    theCycleInfo,
+                                    theMixBuffer.data(),
+                                    nullptr);
+        });
+
+        const UInt64 theCycleEnd = CAHostTimeBase::GetTheCurrentTime();
+        theTimes[kOperationCycle].push_back(
+                static_cast<double>(CAHostTimeBase::ConvertToNanos(theCycleEnd - theCycleStart)));
+
+        // In real time, the cycle has to finish before the next one is due.
+        if(theOptions.mRealTime && theCycleEnd > theCycleHostTime + theCycleTicks)
+        {
+            theDeadlineMisses++;
+        }
+    }
+
+    for(const AudioServerPlugInClientInfo& theClient : theClients)
+    {
+        theDevice.StopIO(theClient.mClientID);
+        theDevice.RemoveClient(&theClient);
+    }
+
+    for(CFStringRef theBundleID : theBundleIDs)
+    {
+        CFRelease(theBundleID);
+    }
+
+    const double theBufferNanos = theFrames / theOptions.mSampleRate * 1e9;
+
+    for(UInt32 theOperation = 0; theOperation < kNumberOperations; theOperation++)
+    {
+        if(theTimes[theOperation].empty())
+        {
+            continue;
+        }
+
+        EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(theTimes[theOperation]);
+
+        printf("  %s: %zu calls, mean %.0f ns, p50 %.0f ns, p99 %.0f ns, max %.0f ns\n",
+               kOperationNames[theOperation],
+               theTimes[theOperation].size(),
+               theStats.mMean,
+               theStats.mP50,
+               theStats.mP99,
+               theStats.mMax);
+        PrintHistogram(theTimes[theOperation]);
+    }
+
+    EFF_TestHarness::Stats theCycleStats = EFF_TestHarness::Summarise(theTimes[kOperationCycle]);
+    printf("  mean cycle uses %.2f%% of the buffer's %.0f us\n",
+           theCycleStats.mMean / theBufferNanos * 100.0,
+           theBufferNanos / 1000.0);
+
+    if(theOptions.mRealTime)
+    {
+        printf("  deadline misses: %llu\n", static_cast<unsigned long long>(theDeadlineMisses));
+    }
+
+    printf("  errors: %llu\n", static_cast<unsigned long long>(theErrors));
+
+    return theErrors == 0 ? 0 : 1;
+}
+
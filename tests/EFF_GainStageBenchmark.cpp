@@ -0,0 +1,130 @@
+//
+//  EFF_GainStageBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Times EFF_GainStage applying the master volume to a stereo IO buffer, against the single
+//  vDSP_vsmul call EFF_VolumeControl used before it had a gain stage. The stage is timed holding a
+//  gain, ramping to a new one, and at gains of exactly 1 and 0, which it skips and zeroes.
+//
+//  Every call first copies the same input into the buffer, so repeated gains can't decay the
+//  samples into denormals. That copy is included in every column.
+//
+//  Off Apple there's no vDSP, so a plain loop stands in for vDSP_vsmul.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_GainStage.h"
+
+// STL Includes
+#include <algorithm>
+#include <vector>
+
+// System Includes
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+
+static const UInt32 kFrameCounts[] = { 14, 64, 512, 4096 };
+static const UInt32 kRampFrames = 512;
+
+// The old EFF_VolumeControl::ApplyVolumeToAudioRT.
+static void ApplyVolumeWithVDSP(Float32 inGain, Float32* ioBuffer, UInt32 inSampleCount)
+{
+#if defined(__APPLE__)
+    vDSP_vsmul(ioBuffer, 1, &inGain, ioBuffer, 1, inSampleCount);
+#else
+    for(UInt32 i = 0; i < inSampleCount; i++)
+    {
+        ioBuffer[i] *= inGain;
+    }
+#endif
+}
+
+template <typename F>
+static EFF_TestHarness::Stats TimeCalls(UInt32 inRepeats, UInt32 inCalls, F inFunction)
+{
+    std::vector<double> theTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theCall = 0; theCall < inCalls; theCall++)
+        {
+            inFunction(theCall);
+        }
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) / inCalls * 1e9);
+    }
+
+    return EFF_TestHarness::Summarise(theTimes);
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const UInt32 theRepeats = theQuick ? 3 : 20;
+
+    printf("Stereo buffer, p50 ns per buffer:\n");
+    printf("%6s %10s %10s %10s %10s %10s\n", "frames", "vsmul", "holding", "ramping", "gain 1", "gain 0");
+
+    for(UInt32 theFrames : kFrameCounts)
+    {
+        const UInt32 theCalls = (theQuick ? 200000 : 20000000) / theFrames;
+        const std::vector<Float32> theInput(theFrames * 2, 0.5f);
+        std::vector<Float32> theBuffer(theFrames * 2);
+
+        EFF_TestHarness::Stats theVDSP = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+            std::copy(theInput.begin(), theInput.end(), theBuffer.begin());
+            ApplyVolumeWithVDSP(0.5f, theBuffer.data(), theFrames * 2);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        EFF_GainStage theHolding(0.5f, kRampFrames);
+        EFF_TestHarness::Stats theHold = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+            std::copy(theInput.begin(), theInput.end(), theBuffer.begin());
+            theHolding.ProcessRT(theBuffer.data(), 2, theFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        // Set a new gain every call, so the stage is always ramping.
+        EFF_GainStage theRamping(0.5f, kRampFrames);
+        EFF_TestHarness::Stats theRamp = TimeCalls(theRepeats, theCalls, [&] (UInt32 inCall) {
+            std::copy(theInput.begin(), theInput.end(), theBuffer.begin());
+            theRamping.SetGain((inCall % 2 == 0) ? 0.25f : 0.75f);
+            theRamping.ProcessRT(theBuffer.data(), 2, theFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        EFF_GainStage theUnity(1.0f, kRampFrames);
+        EFF_TestHarness::Stats theOne = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+            std::copy(theInput.begin(), theInput.end(), theBuffer.begin());
+            theUnity.ProcessRT(theBuffer.data(), 2, theFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        EFF_GainStage theSilent(0.0f, kRampFrames);
+        EFF_TestHarness::Stats theZero = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+            std::copy(theInput.begin(), theInput.end(), theBuffer.begin());
+            theSilent.ProcessRT(theBuffer.data(), 2, theFrames);
+            EFF_TestHarness::DoNotOptimise(theBuffer[0]);
+        });
+
+        printf("%6u %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               theFrames,
+               theVDSP.mP50,
+               theHold.mP50,
+               theRamp.mP50,
+               theOne.mP50,
+               theZero.mP50);
+    }
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+//
+//  EFF_GainStageTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Feeds step changes through EFF_GainStage with the ramp lengths of the master volume ramp
+//  (EFF_VolumeControl) and the mute fade (EFF_MuteControl), split into IO buffers of various sizes,
+//  and checks the step responses: the gain moves monotonically, never jumps by more than a ramp of
+//  that length should allow, reaches the new gain exactly when the ramp ends and stays there. Also
+//  checks changing the gain partway through a ramp, Reset, and that a gain of exactly 1 or 0
+//  leaves the audio alone or silences it.
+//
+//  EFF_VolumeControl and EFF_MuteControl need CoreFoundation, so their gain stages are recreated
+//  here with the same initial gains and ramp lengths. Keep them in sync.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_GainStage.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// EFF_VolumeControl::kVolumeRampFrames and EFF_MuteControl::kMuteFadeFrames.
+static const UInt32 kVolumeRampFrames = 512;
+static const UInt32 kMuteFadeFrames = 256;
+
+static const UInt32 kBufferFrameSizes[] = { 1, 14, 64, 100, 256, 512, 4096 };
+
+// Runs a constant stereo signal through IO buffers of inBufferFrames frames, with the gain set to
+// inTo before the second buffer, and returns the left channel of the output.
+static std::vector<Float32> RunStep(UInt32 inRampFrames,
+                                    Float32 inFrom,
+                                    Float32 inTo,
+                                    UInt32 inBufferFrames,
+                                    Float32 inSignal)
+{
+    EFF_GainStage theStage(inFrom, inRampFrames);
+    std::vector<Float32> theOutput;
+    const UInt32 theBuffers = 2 + (inRampFrames + inBufferFrames - 1) / inBufferFrames;
+
+    for(UInt32 theBuffer = 0; theBuffer < theBuffers; theBuffer++)
+    {
+        if(theBuffer == 1)
+        {
+            theStage.SetGain(inTo);
+        }
+
+        std::vector<Float32> theSamples(inBufferFrames * 2, inSignal);
+        theStage.ProcessRT(theSamples.data(), 2, inBufferFrames);
+
+        for(UInt32 theFrame = 0; theFrame < inBufferFrames; theFrame++)
+        {
+            // Both channels get the same gain.
+            EFFCheck(theSamples[theFrame * 2] == theSamples[theFrame * 2 + 1]);
+            theOutput.push_back(theSamples[theFrame * 2]);
+        }
+    }
+
+    return theOutput;
+}
+
+static void CheckStep(UInt32 inRampFrames, Float32 inFrom, Float32 inTo, UInt32 inBufferFrames)
+{
+    const Float32 theSignal = 0.8f;
+    const std::vector<Float32> theOutput = RunStep(inRampFrames, inFrom, inTo, inBufferFrames, theSignal);
+
+    // The first buffer is untouched by the step.
+    for(UInt32 i = 0; i < inBufferFrames; i++)
+    {
+        EFFCheck(theOutput[i] == inFrom * theSignal);
+    }
+
+    // The largest change between two frames a linear ramp of this length allows, plus a little for
+    // rounding.
+    const Float32 theAllowedJump = std::fabs(inTo - inFrom) * theSignal / inRampFrames * 1.01f + 1.0e-6f;
+    const Float32 theDirection = (inTo > inFrom) ? 1.0f : -1.0f;
+    Float32 theMaxJump = 0.0f;
+    bool theIsMonotonic = true;
+
+    for(size_t i = 1; i < theOutput.size(); i++)
+    {
+        const Float32 theChange = theOutput[i] - theOutput[i - 1];
+        theMaxJump = std::max(theMaxJump, std::fabs(theChange));
+        theIsMonotonic = theIsMonotonic && (theChange * theDirection >= -1.0e-7f);
+    }
+
+    EFFCheck(theMaxJump <= theAllowedJump);
+    EFFCheck(theIsMonotonic);
+
+    // The ramp starts with the second buffer and ends inRampFrames frames later, after which the
+    // gain is exactly the new one.
+    const size_t theRampEnd = inBufferFrames + inRampFrames;
+    EFFCheck(std::fabs(theOutput[theRampEnd - 1] - inTo * theSignal) < 1.0e-5f);
+
+    for(size_t i = theRampEnd; i < theOutput.size(); i++)
+    {
+        EFFCheck(theOutput[i] == inTo * theSignal);
+    }
+
+    // It hasn't got there before the ramp ends.
+    if(inRampFrames > 2)
+    {
+        EFFCheck(theOutput[theRampEnd - 3] != theOutput[theRampEnd - 1]);
+    }
+}
+
+// The master volume ramp, for volume changes in both directions.
+static void TestVolumeSteps()
+{
+    for(UInt32 theBufferFrames : kBufferFrameSizes)
+    {
+        CheckStep(kVolumeRampFrames, 1.0f, 0.25f, theBufferFrames);
+        CheckStep(kVolumeRampFrames, 0.25f, 1.0f, theBufferFrames);
+        CheckStep(kVolumeRampFrames, 0.3f, 0.7f, theBufferFrames);
+        CheckStep(kVolumeRampFrames, 0.0f, 0.5f, theBufferFrames);
+    }
+}
+
+// The mute fade, muting and unmuting.
+static void TestMuteSteps()
+{
+    for(UInt32 theBufferFrames : kBufferFrameSizes)
+    {
+        CheckStep(kMuteFadeFrames, 1.0f, 0.0f, theBufferFrames);
+        CheckStep(kMuteFadeFrames, 0.0f, 1.0f, theBufferFrames);
+    }
+}
+
+// Changing the gain again before the ramp finishes starts a new ramp from where the old one got
+// to, so the output doesn't jump.
+static void TestRetarget()
+{
+    EFF_GainStage theStage(0.0f, kMuteFadeFrames);
+    theStage.SetGain(1.0f);
+
+    std::vector<Float32> theFirst(100 * 2, 1.0f);
+    theStage.ProcessRT(theFirst.data(), 2, 100);
+
+    theStage.SetGain(0.0f);
+
+    std::vector<Float32> theSecond(100 * 2, 1.0f);
+    theStage.ProcessRT(theSecond.data(), 2, 100);
+
+    EFFCheck(theFirst[198] > 0.0f);
+    EFFCheck(std::fabs(theSecond[0] - theFirst[198]) <= 1.0f / kMuteFadeFrames * 1.01f);
+    EFFCheck(theSecond[198] < theFirst[198]);
+}
+
+static void TestConstantGains()
+{
+    // Gain 1 leaves the buffer alone, even non-finite samples.
+    EFF_GainStage theUnity(1.0f, kVolumeRampFrames);
+    std::vector<Float32> theSamples { NAN, 0.5f, -0.25f, INFINITY };
+    theUnity.ProcessRT(theSamples.data(), 2, 2);
+    EFFCheck(std::isnan(theSamples[0]));
+    EFFCheck(theSamples[1] == 0.5f && theSamples[2] == -0.25f && std::isinf(theSamples[3]));
+
+    // Gain 0 silences it completely.
+    EFF_GainStage theMuted(0.0f, kMuteFadeFrames);
+    theSamples = { NAN, 0.5f, -0.25f, INFINITY };
+    theMuted.ProcessRT(theSamples.data(), 2, 2);
+    EFFCheck(std::all_of(theSamples.begin(), theSamples.end(), [] (Float32 inSample) { return inSample == 0.0f; }));
+
+    // Reset jumps straight to the gain without ramping, as EFF_Device does before IO starts.
+    EFF_GainStage theStage(1.0f, kVolumeRampFrames);
+    theStage.SetGain(0.5f);
+    theStage.Reset();
+    theSamples = { 1.0f, 1.0f, 1.0f, 1.0f };
+    theStage.ProcessRT(theSamples.data(), 2, 2);
+    EFFCheck(theSamples[0] == 0.5f && theSamples[3] == 0.5f);
+}
+
+int main()
+{
+    TestVolumeSteps();
+    TestMuteSteps();
+    TestRetarget();
+    TestConstantGains();
+
+    return EFF_TestHarness::Finish("EFF_GainStageTests");
+}
@@ -0,0 +1,205 @@
+//
+//  EFF_IOStatsTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests EFF_IOStats' log-linear histogram: which bucket values on either side of each power of two
+//  go in, that the buckets' lower bounds only go up and each bucket is within 25% of its lower
+//  bound, and that quantiles of known distributions land in the right buckets. Then records cycles
+//  that finish under, at and over their deadlines and checks which are counted as misses.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_IOStats.h"
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <cmath>
+
+
+static void TestBucketBoundaries()
+{
+    // Below kSubBuckets ticks, each value has its own bucket.
+    for(UInt64 theTicks = 0; theTicks < EFF_IOStats::kSubBuckets; theTicks++)
+    {
+        EFFCheck(EFF_IOStats::BucketForHostTicks(theTicks) == theTicks);
+    }
+
+    // From there, each power of two is split into four buckets.
+    EFFCheck(EFF_IOStats::BucketForHostTicks(4) == 4);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(7) == 7);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(8) == 8);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(9) == 8);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(10) == 9);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(15) == 11);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(16) == 12);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(1000) == EFF_IOStats::BucketForHostTicks(1023));
+    EFFCheck(EFF_IOStats::BucketForHostTicks(1023) + 1 == EFF_IOStats::BucketForHostTicks(1024));
+
+    // Either side of every power of two up to the last bucket.
+    for(UInt32 theExponent = EFF_IOStats::kSubBucketBits; theExponent < EFF_IOStats::kMaxExponent; theExponent++)
+    {
+        const UInt64 thePower = 1ULL << theExponent;
+        const UInt32 theBucket = EFF_IOStats::kSubBuckets * (theExponent - EFF_IOStats::kSubBucketBits + 1);
+
+        EFFCheck(EFF_IOStats::BucketForHostTicks(thePower) == theBucket);
+        EFFCheck(EFF_IOStats::BucketForHostTicks(thePower - 1) == theBucket - 1);
+        EFFCheck(EFF_IOStats::BucketForHostTicks(thePower * 2 - 1) == theBucket + EFF_IOStats::kSubBuckets - 1);
+    }
+
+    // Everything from 2^kMaxExponent ticks up shares the last bucket.
+    const UInt32 theLastBucket = EFF_IOStats::kNumberBuckets - 1;
+    EFFCheck(EFF_IOStats::BucketForHostTicks((1ULL << EFF_IOStats::kMaxExponent) - 1) == theLastBucket - 1);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(1ULL << EFF_IOStats::kMaxExponent) == theLastBucket);
+    EFFCheck(EFF_IOStats::BucketForHostTicks(UINT64_MAX) == theLastBucket);
+}
+
+static void TestLowerBounds()
+{
+    for(UInt32 theBucket = 0; theBucket < EFF_IOStats::kNumberBuckets; theBucket++)
+    {
+        const UInt64 theLowerBound = EFF_IOStats::GetBucketLowerBoundHostTicks(theBucket);
+
+        // A bucket's lower bound is in the bucket.
+        EFFCheck(EFF_IOStats::BucketForHostTicks(theLowerBound) == theBucket);
+
+        if(theBucket + 1 < EFF_IOStats::kNumberBuckets)
+        {
+            const UInt64 theNextLowerBound = EFF_IOStats::GetBucketLowerBoundHostTicks(theBucket + 1);
+
+            // The bounds only go up, and the value just below the next bound is still in this bucket.
+            EFFCheck(theNextLowerBound > theLowerBound);
+            EFFCheck(EFF_IOStats::BucketForHostTicks(theNextLowerBound - 1) == theBucket);
+
+            // So reporting a bucket's lower bound is never off by more than 25%.
+            if(theLowerBound >= EFF_IOStats::kSubBuckets)
+            {
+                EFFCheck(theNextLowerBound - theLowerBound <= theLowerBound / EFF_IOStats::kSubBuckets);
+            }
+        }
+    }
+}
+
+static void TestQuantiles()
+{
+    // Every value from 1 to 100000 once, so the exact p quantile is p * 100000.
+    const UInt64 kValues = 100000;
+    EFF_IOStats::OperationStats theUniform;
+
+    for(UInt64 theValue = 1; theValue <= kValues; theValue++)
+    {
+        theUniform.mBuckets[EFF_IOStats::BucketForHostTicks(theValue)]++;
+    }
+
+    for(Float64 theFraction : { 0.01, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0 })
+    {
+        const UInt64 theExact = static_cast<UInt64>(std::llround(theFraction * kValues));
+        const UInt64 theQuantile = EFF_IOStats::GetQuantileHostTicks(theUniform, theFraction);
+
+        EFFCheck(theQuantile == EFF_IOStats::GetBucketLowerBoundHostTicks(EFF_IOStats::BucketForHostTicks(theExact)));
+        EFFCheck(theQuantile <= theExact);
+        EFFCheck(theQuantile >= theExact - theExact / 4);
+    }
+
+    // 0 is the smallest value, even if it isn't in the first bucket.
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theUniform, 0.0) == 1);
+
+    // A typical IO thread: 990 fast operations and 10 slow ones. The p99 is the fastest value that
+    // 99% of them are at or below, so still fast, but the p99.9 is slow.
+    EFF_IOStats::OperationStats theBimodal;
+    theBimodal.mBuckets[EFF_IOStats::BucketForHostTicks(2000)] = 990;
+    theBimodal.mBuckets[EFF_IOStats::BucketForHostTicks(500000)] = 10;
+
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theBimodal, 0.5) == EFF_IOStats::GetBucketLowerBoundHostTicks(EFF_IOStats::BucketForHostTicks(2000)));
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theBimodal, 0.99) == EFF_IOStats::GetBucketLowerBoundHostTicks(EFF_IOStats::BucketForHostTicks(2000)));
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theBimodal, 0.999) == EFF_IOStats::GetBucketLowerBoundHostTicks(EFF_IOStats::BucketForHostTicks(500000)));
+
+    // An operation that never ran has no quantiles.
+    EFF_IOStats::OperationStats theEmpty;
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theEmpty, 0.5) == 0);
+}
+
+// Records an operation that took inNanos, as if it had started that long ago.
+static void RecordOperation(EFF_IOStats& inStats, EFF_IOStats::Operation inOperation, UInt64 inNanos)
+{
+    inStats.RecordOperationRT(inOperation,
+                              CAHostTimeBase::GetTheCurrentTime() - CAHostTimeBase::ConvertFromNanos(inNanos));
+}
+
+static void TestDeadlineMisses()
+{
+    EFF_IOStats theStats;
+
+    // A 10 ms deadline. The operations below are a few ms either side of it, so the time it takes
+    // to record them doesn't matter.
+    const UInt64 theDeadline = CAHostTimeBase::ConvertFromNanos(10000000);
+
+    // Under: 2 + 3 + 1 ms.
+    RecordOperation(theStats, EFF_IOStats::kOperationReadInput, 2000000);
+    RecordOperation(theStats, EFF_IOStats::kOperationProcessOutput, 3000000);
+    RecordOperation(theStats, EFF_IOStats::kOperationWriteMix, 1000000);
+    EFFCheck(!theStats.EndCycleRT(theDeadline));
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 0);
+
+    // Over: 6 + 7 ms, although neither operation is over on its own.
+    RecordOperation(theStats, EFF_IOStats::kOperationProcessOutput, 6000000);
+    RecordOperation(theStats, EFF_IOStats::kOperationWriteMix, 7000000);
+    theStats.EndCycleRT(theDeadline);
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 1);
+
+    // The last cycle's time doesn't carry over.
+    RecordOperation(theStats, EFF_IOStats::kOperationWriteMix, 6000000);
+    theStats.EndCycleRT(theDeadline);
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 1);
+
+    // Waiting for the IO mutex is already part of the operation's time, so it isn't counted again.
+    RecordOperation(theStats, EFF_IOStats::kOperationIOMutexWait, 5000000);
+    RecordOperation(theStats, EFF_IOStats::kOperationWriteMix, 6000000);
+    theStats.EndCycleRT(theDeadline);
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 1);
+
+    // A deadline of 0 means there isn't one.
+    RecordOperation(theStats, EFF_IOStats::kOperationWriteMix, 20000000);
+    theStats.EndCycleRT(0);
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 1);
+
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterCycles) == 5);
+
+    // The operations were all recorded in their histograms.
+    EFF_IOStats::OperationStats theWriteMix;
+    theStats.CopyOperationStats(EFF_IOStats::kOperationWriteMix, theWriteMix);
+    EFFCheck(theWriteMix.mCount == 5);
+    EFFCheck(theWriteMix.mMaxHostTicks >= CAHostTimeBase::ConvertFromNanos(20000000));
+    EFFCheck(EFF_IOStats::GetQuantileHostTicks(theWriteMix, 1.0) <= theWriteMix.mMaxHostTicks);
+
+    // EndCycleRT asks for the stats to be exported every kExportIntervalCycles cycles.
+    UInt64 theExports = 0;
+
+    for(UInt64 theCycle = 6; theCycle <= 3 * EFF_IOStats::kExportIntervalCycles; theCycle++)
+    {
+        bool theExport = theStats.EndCycleRT(theDeadline);
+
+        EFFCheck(theExport == (theCycle % EFF_IOStats::kExportIntervalCycles == 0));
+        theExports += theExport ? 1 : 0;
+    }
+
+    EFFCheck(theExports == 3);
+    EFFCheck(theStats.GetCounter(EFF_IOStats::kCounterDeadlineMisses) == 1);
+}
+
+int main()
+{
+    TestBucketBoundaries();
+    TestLowerBounds();
+    TestQuantiles();
+    TestDeadlineMisses();
+
+    return EFF_TestHarness::Finish("EFF_IOStatsTests");
+}
@@ -0,0 +1,317 @@
+//
+//  EFF_LatencyProfileTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Checks the latency profiles' settings, then runs the loopback buffer through the HAL's IO cycles
+//  for each profile, the way EFF_Device does: each cycle, ReadInput fetches the IO buffer that ends
+//  the safety offset before the cycle's time, then WriteMix stores the one that starts the safety
+//  offset and an IO buffer after it. For every IO buffer size the HAL offers, from 14 frames to
+//  EFF_LatencyProfile::kMaxIOBufferFrameSize, EFFApp reads every frame that was written, unchanged,
+//  with no underruns. Just above the largest IO buffer GetMaxIOBufferFrameSize allows, frames get
+//  overwritten before they're read, which is why WriteMix rejects those buffers.
+//
+//  Cycles the HAL skips, e.g. after an overload, only lose that cycle's frames. With EFFApp's reads
+//  and the clients' writes each delayed by up to 1 ms of scheduling jitter, so they run in either
+//  order, every profile still reads every frame as written, and twice the jitter its smallest IO
+//  buffers can take does cause underruns.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_LatencyProfile.h"
+#include "EFF_LoopbackRingBuffer.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+static const EFFLatencyProfile kProfiles[] = {
+    kEFFLatencyProfileStandard, kEFFLatencyProfileLow, kEFFLatencyProfileLive
+};
+
+static const char* const kProfileNames[] = { "standard", "low", "live" };
+
+static const UInt32 kChannels = 2;
+static const Float64 kSampleRate = 48000.0;
+
+// More scheduling jitter than the HAL's IO threads usually see.
+static const UInt32 kJitterMicroseconds = 1000;
+
+namespace
+{
+    struct Result
+    {
+        // Frames EFFApp read as silence after the first cycle it could have read written frames.
+        UInt64      mSilentFrames = 0;
+        // Frames that weren't what was written at their sample time.
+        UInt64      mWrongFrames = 0;
+        UInt64      mFramesRead = 0;
+    };
+}
+
+// Runs inCycles IO cycles of inIOBufferFrames frames through a loopback buffer of
+// kLoopbackRingBufferFrames, skipping WriteMix every inSkipEvery cycles if it's not 0.
+//
+// If inJitterMicroseconds isn't 0, each ReadInput and WriteMix is delayed by a random amount up to
+// that long (at 48 kHz), independently, so EFFApp's reads can run before or after the clients'
+// writes for the same cycle and fall behind or get ahead of them by up to the jitter. Each side
+// still runs its own cycles in order, like its IO thread would.
+static Result RunCycles(EFFLatencyProfile inProfile,
+                        UInt32 inIOBufferFrames,
+                        UInt32 inCycles,
+                        UInt32 inSkipEvery = 0,
+                        UInt32 inJitterMicroseconds = 0,
+                        UInt32 inSeed = 1)
+{
+    const SInt64 theSafetyOffset = EFF_LatencyProfile::GetParams(inProfile).mSafetyOffsetFrames;
+    const SInt64 theBuffer = inIOBufferFrames;
+
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, EFF_LatencyProfile::kLoopbackRingBufferFrames);
+
+    std::vector<Float32> theOutput(inIOBufferFrames * kChannels);
+    std::vector<Float32> theInput(inIOBufferFrames * kChannels);
+
+    // Each sample is its frame's sample time, which Float32 holds exactly for these runs.
+    auto ExpectedSample = [] (SInt64 inSampleTime) { return static_cast<Float32>(inSampleTime % (1 << 23)); };
+
+    Result theResult;
+    SInt64 theFirstWrite = -1;
+
+    auto ReadInput = [&] (UInt32 inCycle) {
+        const SInt64 theNow = static_cast<SInt64>(inCycle) * theBuffer;
+        const SInt64 theInputTime = theNow - theBuffer - theSafetyOffset;
+        theRing.Fetch(theInput.data(), inIOBufferFrames, theInputTime);
+
+        if(theFirstWrite >= 0 && theInputTime >= theFirstWrite)
+        {
+            theResult.mFramesRead += inIOBufferFrames;
+
+            // Count the silent frames from the samples, since Store fills gaps in with silence
+            // rather than leaving them out of the buffer.
+            for(UInt32 theFrame = 0; theFrame < inIOBufferFrames; theFrame++)
+            {
+                const Float32 theExpected = ExpectedSample(theInputTime + theFrame);
+
+                if(theInput[theFrame * kChannels] == 0.0f && theExpected != 0.0f)
+                {
+                    theResult.mSilentFrames++;
+                }
+                else if(theInput[theFrame * kChannels] != theExpected ||
+                        theInput[theFrame * kChannels + 1] != theExpected)
+                {
+                    theResult.mWrongFrames++;
+                }
+            }
+        }
+    };
+
+    auto WriteMix = [&] (UInt32 inCycle) {
+        if(inSkipEvery == 0 || inCycle % inSkipEvery != inSkipEvery - 1)
+        {
+            const SInt64 theNow = static_cast<SInt64>(inCycle) * theBuffer;
+            const SInt64 theOutputTime = theNow + theBuffer + theSafetyOffset;
+
+            for(UInt32 theFrame = 0; theFrame < inIOBufferFrames; theFrame++)
+            {
+                theOutput[theFrame * kChannels] = ExpectedSample(theOutputTime + theFrame);
+                theOutput[theFrame * kChannels + 1] = ExpectedSample(theOutputTime + theFrame);
+            }
+
+            EFFCheck(theRing.Store(theOutput.data(), inIOBufferFrames, theOutputTime) == kEFFRingBufferError_OK);
+
+            if(theFirstWrite < 0)
+            {
+                theFirstWrite = theOutputTime;
+            }
+        }
+    };
+
+    // How late each side's next operation runs, in frames. Each cycle, the delay moves by up to an
+    // IO buffer either way, which keeps the side's cycles in order, and stays within the jitter. So
+    // a side can be late for a while, like an IO thread on a busy system, and the two sides drift
+    // anywhere from one being the whole jitter behind the other to the other way around.
+    std::mt19937 theRandom(inSeed);
+    std::uniform_real_distribution<Float64> theStep(-static_cast<Float64>(theBuffer), static_cast<Float64>(theBuffer));
+    const Float64 theMaxDelay = inJitterMicroseconds * kSampleRate / 1000000.0;
+
+    auto NextDelay = [&] (Float64 inDelay) {
+        return (theMaxDelay > 0.0) ? std::min(theMaxDelay, std::max(0.0, inDelay + theStep(theRandom))) : 0.0;
+    };
+
+    UInt32 theReadCycle = 0;
+    UInt32 theWriteCycle = 0;
+    Float64 theReadDelay = NextDelay(0.0);
+    Float64 theWriteDelay = NextDelay(0.0);
+
+    while(theReadCycle < inCycles || theWriteCycle < inCycles)
+    {
+        const Float64 theReadTime = static_cast<Float64>(theReadCycle) * theBuffer + theReadDelay;
+        const Float64 theWriteTime = static_cast<Float64>(theWriteCycle) * theBuffer + theWriteDelay;
+
+        // The HAL calls ReadInput before WriteMix in the same cycle, so it goes first on a tie.
+        if(theWriteCycle == inCycles || (theReadCycle < inCycles && theReadTime <= theWriteTime))
+        {
+            ReadInput(theReadCycle++);
+            theReadDelay = NextDelay(theReadDelay);
+        }
+        else
+        {
+            WriteMix(theWriteCycle++);
+            theWriteDelay = NextDelay(theWriteDelay);
+        }
+    }
+
+    return theResult;
+}
+
+static void TestParams()
+{
+    EFFCheck(!EFF_LatencyProfile::IsValid(-1));
+    EFFCheck(!EFF_LatencyProfile::IsValid(kEFFLatencyProfileLive + 1));
+
+    bool didThrow = false;
+    try
+    {
+        EFF_LatencyProfile::GetParams(static_cast<EFFLatencyProfile>(3));
+    }
+    catch(const CAException&)
+    {
+        didThrow = true;
+    }
+    EFFCheck(didThrow);
+
+    UInt32 thePreviousPeriod = UINT32_MAX;
+
+    for(EFFLatencyProfile theProfile : kProfiles)
+    {
+        EFFCheck(EFF_LatencyProfile::IsValid(theProfile));
+
+        const EFF_LatencyProfileParams& theParams = EFF_LatencyProfile::GetParams(theProfile);
+
+        // Lower latency profiles have shorter periods, so the HAL's timeline is precise enough for
+        // their smaller IO buffers.
+        EFFCheck(theParams.mZeroTimeStampPeriod < thePreviousPeriod);
+        thePreviousPeriod = theParams.mZeroTimeStampPeriod;
+
+        // Every profile takes the largest IO buffer the HAL offers.
+        EFFCheck(EFF_LatencyProfile::GetMaxIOBufferFrameSize(theProfile, EFF_LatencyProfile::kLoopbackRingBufferFrames) >=
+                 EFF_LatencyProfile::kMaxIOBufferFrameSize);
+    }
+}
+
+static void TestIOBufferSizes()
+{
+    printf("%-9s %8s %14s %10s %12s %10s\n",
+           "profile", "IO frames", "latency frames", "silent", "overwritten", "read");
+
+    for(size_t theIndex = 0; theIndex < sizeof(kProfiles) / sizeof(kProfiles[0]); theIndex++)
+    {
+        const EFFLatencyProfile theProfile = kProfiles[theIndex];
+        const UInt32 theSafetyOffset = EFF_LatencyProfile::GetParams(theProfile).mSafetyOffsetFrames;
+        const UInt32 theMaxFrames =
+            EFF_LatencyProfile::GetMaxIOBufferFrameSize(theProfile, EFF_LatencyProfile::kLoopbackRingBufferFrames);
+
+        for(UInt32 theFrames : { 14u, 64u, 128u, 256u, 512u, 1024u, EFF_LatencyProfile::kMaxIOBufferFrameSize, theMaxFrames })
+        {
+            // About 20 s at 48 kHz, but at least 100 cycles.
+            const Result theResult = RunCycles(theProfile, theFrames, std::max(100u, 960000u / theFrames));
+
+            printf("%-9s %8u %14u %10llu %12llu %10llu\n",
+                   kProfileNames[theIndex],
+                   theFrames,
+                   2 * (theFrames + theSafetyOffset),
+                   static_cast<unsigned long long>(theResult.mSilentFrames),
+                   static_cast<unsigned long long>(theResult.mWrongFrames),
+                   static_cast<unsigned long long>(theResult.mFramesRead));
+
+            EFFCheck(theResult.mFramesRead > 0);
+            EFFCheck(theResult.mSilentFrames == 0);
+            EFFCheck(theResult.mWrongFrames == 0);
+        }
+
+        // A little bigger than GetMaxIOBufferFrameSize allows, and the frames EFFApp is about to
+        // read get overwritten.
+        const Result theTooBig = RunCycles(theProfile, theMaxFrames + 64, 100);
+        EFFCheck(theTooBig.mWrongFrames + theTooBig.mSilentFrames > 0);
+    }
+}
+
+// When the HAL skips a cycle, only the frames that cycle would have written are missing.
+static void TestSkippedCycles()
+{
+    for(EFFLatencyProfile theProfile : kProfiles)
+    {
+        for(UInt32 theFrames : { 128u, 512u })
+        {
+            const UInt32 theCycles = 2000;
+            const Result theResult = RunCycles(theProfile, theFrames, theCycles, 100);
+
+            // Give or take the last skipped write, which might not have been read yet.
+            EFFCheck(theResult.mWrongFrames == 0);
+            EFFCheck(theResult.mSilentFrames >= (theCycles / 100 - 1) * theFrames);
+            EFFCheck(theResult.mSilentFrames <= (theCycles / 100) * theFrames);
+        }
+    }
+}
+
+// EFFApp's IO and the clients' IO delayed by up to kJitterMicroseconds. A read still gets its
+// frames as long as the writes are less than two IO buffers and two safety offsets behind, which
+// for the live profile's 14 frame buffers is 1.25 ms.
+static void TestJitter()
+{
+    printf("\n%-9s %8s %10s %10s %12s %10s\n",
+           "profile", "IO frames", "jitter µs", "silent", "overwritten", "read");
+
+    for(size_t theIndex = 0; theIndex < sizeof(kProfiles) / sizeof(kProfiles[0]); theIndex++)
+    {
+        const EFFLatencyProfile theProfile = kProfiles[theIndex];
+        const UInt32 theSafetyOffset = EFF_LatencyProfile::GetParams(theProfile).mSafetyOffsetFrames;
+
+        for(UInt32 theFrames : { 14u, 64u, 128u, 256u, 512u, 1024u, EFF_LatencyProfile::kMaxIOBufferFrameSize })
+        {
+            const Result theResult =
+                RunCycles(theProfile, theFrames, std::max(100u, 960000u / theFrames), 0, kJitterMicroseconds, theFrames);
+
+            printf("%-9s %8u %10u %10llu %12llu %10llu\n",
+                   kProfileNames[theIndex],
+                   theFrames,
+                   kJitterMicroseconds,
+                   static_cast<unsigned long long>(theResult.mSilentFrames),
+                   static_cast<unsigned long long>(theResult.mWrongFrames),
+                   static_cast<unsigned long long>(theResult.mFramesRead));
+
+            EFFCheck(theResult.mFramesRead > 0);
+            EFFCheck(theResult.mSilentFrames == 0);
+            EFFCheck(theResult.mWrongFrames == 0);
+        }
+
+        // Twice the jitter the smallest buffer can take, and some reads run before the frames
+        // they need have been written, so the test would catch a safety offset that's too small.
+        const UInt32 theTooMuchJitter =
+            static_cast<UInt32>(4 * (14 + theSafetyOffset) * 1000000.0 / kSampleRate);
+        const Result theUnderrun = RunCycles(theProfile, 14, 960000 / 14, 0, theTooMuchJitter);
+        EFFCheck(theUnderrun.mSilentFrames > 0);
+    }
+}
+
+int main()
+{
+    TestParams();
+    TestIOBufferSizes();
+    TestSkippedCycles();
+    TestJitter();
+
+    return EFF_TestHarness::Finish("EFF_LatencyProfileTests");
+}
@@ -0,0 +1,180 @@
+//
+//  EFF_LevelMetersTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests the levels EFF_LevelMeters measures, and that a reader copying snapshots while the IO
+//  thread keeps metering and publishing only ever gets levels that were all published together.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_LevelMeters.h"
+
+// STL Includes
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+static void TestLevels()
+{
+    auto theMeters = std::make_unique<EFF_LevelMeters>();
+
+    // A full-scale square wave in the left channel and half that in the right.
+    std::vector<Float32> theStereo(512 * 2);
+    for(UInt32 i = 0; i < 512; i++)
+    {
+        theStereo[i * 2] = (i % 2 == 0) ? 1.0f : -1.0f;
+        theStereo[i * 2 + 1] = (i % 2 == 0) ? -0.5f : 0.5f;
+    }
+
+    std::vector<Float32> theMono(512, 0.25f);
+
+    theMeters->MeterClientRT(7, 2, 512, theStereo.data());
+    theMeters->MeterClientRT(8, 1, 512, theMono.data());
+    theMeters->MeterMixRT(2, 512, theStereo.data());
+
+    EFF_LevelMeters::Snapshot theSnapshot;
+    EFFCheck(theMeters->CopySnapshot(theSnapshot));
+    EFFCheck(theSnapshot.mNumberClients == 2);
+    EFFCheck(theSnapshot.mClients[0].mClientID == 7);
+    EFFCheck(theSnapshot.mClients[0].mLevels.mPeak[0] == 1.0f);
+    EFFCheck(theSnapshot.mClients[0].mLevels.mPeak[1] == 0.5f);
+    EFFCheck(std::fabs(theSnapshot.mClients[0].mLevels.mRMS[0] - 1.0f) < 1.0e-6f);
+    EFFCheck(std::fabs(theSnapshot.mClients[0].mLevels.mRMS[1] - 0.5f) < 1.0e-6f);
+
+    // Mono audio gets the same levels in both channels.
+    EFFCheck(theSnapshot.mClients[1].mClientID == 8);
+    EFFCheck(theSnapshot.mClients[1].mLevels.mPeak[0] == 0.25f);
+    EFFCheck(theSnapshot.mClients[1].mLevels.mPeak[1] == 0.25f);
+
+    EFFCheck(theSnapshot.mMix.mPeak[0] == 1.0f);
+
+    // The next cycle starts with no clients.
+    theMeters->MeterMixRT(1, 512, theMono.data());
+    EFFCheck(theMeters->CopySnapshot(theSnapshot));
+    EFFCheck(theSnapshot.mNumberClients == 0);
+    EFFCheck(theSnapshot.mMix.mPeak[0] == 0.25f);
+
+    // Clients beyond kMaxClients are left out.
+    for(UInt32 theClientID = 0; theClientID < EFF_LevelMeters::kMaxClients + 10; theClientID++)
+    {
+        theMeters->MeterClientRT(theClientID, 1, 512, theMono.data());
+    }
+    theMeters->MeterMixRT(1, 512, theMono.data());
+    EFFCheck(theMeters->CopySnapshot(theSnapshot));
+    EFFCheck(theSnapshot.mNumberClients == EFF_LevelMeters::kMaxClients);
+}
+
+// The level every buffer gets in a cycle, which identifies the cycle. Exactly representable.
+static Float32 CycleLevel(UInt32 inCycle)
+{
+    return static_cast<Float32>(inCycle % 4096 + 1) / 8192.0f;
+}
+
+// The number of clients metered in a cycle, which changes from cycle to cycle so a reader can tell
+// if it got the number of clients from a different cycle than their levels.
+static UInt32 CycleClients(UInt32 inCycle)
+{
+    return 1 + (inCycle % 4096) % 7;
+}
+
+// The IO thread meters and publishes as fast as it can while the reader copies snapshots. Each
+// snapshot's clients and mix should all be from the same cycle.
+static void TestConcurrentSnapshots(double inSeconds)
+{
+    auto theMeters = std::make_unique<EFF_LevelMeters>();
+    const UInt32 kFrames = 64;
+
+    std::atomic<bool> theStop { false };
+    std::atomic<UInt64> theCycles { 0 };
+
+    std::thread theIOThread([&] {
+        EFF_TestHarness::PinThreadToCPU(0);
+
+        std::vector<Float32> theBuffer(kFrames);
+
+        for(UInt32 theCycle = 0; !theStop.load(std::memory_order_relaxed); theCycle++)
+        {
+            std::fill(theBuffer.begin(), theBuffer.end(), CycleLevel(theCycle));
+
+            for(UInt32 theClient = 0; theClient < CycleClients(theCycle); theClient++)
+            {
+                theMeters->MeterClientRT(theCycle, 1, kFrames, theBuffer.data());
+            }
+
+            theMeters->MeterMixRT(1, kFrames, theBuffer.data());
+            theCycles.store(theCycle + 1, std::memory_order_relaxed);
+        }
+    });
+
+    EFF_TestHarness::PinThreadToCPU(1);
+
+    UInt64 theCopies = 0, theFailedCopies = 0, theInconsistent = 0;
+    double theEndTime = EFF_TestHarness::NowSeconds() + inSeconds;
+    auto theSnapshot = std::make_unique<EFF_LevelMeters::Snapshot>();
+
+    while(EFF_TestHarness::NowSeconds() < theEndTime)
+    {
+        if(!theMeters->CopySnapshot(*theSnapshot))
+        {
+            theFailedCopies++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        theCopies++;
+
+        // Nothing published yet.
+        if(theSnapshot->mMix.mPeak[0] == 0.0f)
+        {
+            continue;
+        }
+
+        const UInt32 theCycleMod = static_cast<UInt32>(theSnapshot->mMix.mPeak[0] * 8192.0f) - 1;
+        bool theIsConsistent = (theSnapshot->mNumberClients == CycleClients(theCycleMod));
+
+        for(UInt32 i = 0; i < theSnapshot->mNumberClients; i++)
+        {
+            const EFF_LevelMeters::ClientLevels& theClient = theSnapshot->mClients[i];
+
+            theIsConsistent = theIsConsistent &&
+                              (theClient.mClientID % 4096 == theCycleMod) &&
+                              (theClient.mLevels.mPeak[0] == theSnapshot->mMix.mPeak[0]) &&
+                              (theClient.mLevels.mPeak[1] == theSnapshot->mMix.mPeak[0]);
+        }
+
+        theInconsistent += !theIsConsistent;
+
+        // On a single CPU, give the IO thread a chance to run.
+        std::this_thread::yield();
+    }
+
+    theStop = true;
+    theIOThread.join();
+
+    printf("concurrent: %llu cycles, %llu copies, %llu failed, %llu inconsistent\n",
+           static_cast<unsigned long long>(theCycles.load()),
+           static_cast<unsigned long long>(theCopies),
+           static_cast<unsigned long long>(theFailedCopies),
+           static_cast<unsigned long long>(theInconsistent));
+
+    EFFCheck(theInconsistent == 0);
+    EFFCheck(theCopies > 0);
+}
+
+int main(int argc, char* argv[])
+{
+    TestLevels();
+    TestConcurrentSnapshots(EFF_TestHarness::IsQuick(argc, argv) ? 0.5 : 3.0);
+
+    return EFF_TestHarness::Finish("EFF_LevelMetersTests");
+}
+
@@ -0,0 +1,320 @@
+//
+//  EFF_LoopbackClockTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Simulates a reference device running off its nominal rate, with jittery timestamps, and feeds
+//  its timestamps to EFF_LoopbackClock the way EFFApp passes on the output device's. Checks, for
+//  ±50 and ±200 ppm references with up to 200 µs of jitter and host clocks of 24 MHz (Apple
+//  silicon) and 1 GHz (Intel, in nanoseconds):
+//
+//   - how long the rate estimate takes to converge to within 5 ppm,
+//   - the largest error in the estimate once it has settled,
+//   - that jitter alone never makes the loop re-lock.
+//
+//  Also checks that the device's zero timestamps run at the estimated rate without jumping when
+//  the rate changes, and that discontinuities in the reference increment the seed.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_LoopbackClock.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+static const Float64 kSampleRate = 48000.0;
+static const UInt32 kPeriodFrames = 16384;
+
+// The reference's IO buffer size, i.e. how often EFFApp gets one of its timestamps.
+static const UInt32 kReferenceBufferFrames = 512;
+
+static const Float64 kHostFrequencies[] = { 24.0e6, 1.0e9 };
+
+// Once the estimate is within this of the reference's actual rate, the device stays within about a
+// frame of the reference over a few minutes.
+static const Float64 kConvergedPPM = 5.0;
+
+namespace
+{
+    struct JitterCase
+    {
+        // The standard deviation of the reference timestamps' host times.
+        Float64     mJitterMicroseconds;
+        // How long the estimate can take to get within kConvergedPPM.
+        Float64     mMaxConvergenceSeconds;
+        // The largest error allowed after kSettledSeconds.
+        Float64     mMaxSteadyStatePPM;
+    };
+
+    struct Result
+    {
+        Float64     mConvergenceSeconds = 0.0;
+        Float64     mSteadyStatePPM = 0.0;
+        UInt32      mDiscontinuities = 0;
+    };
+}
+
+static const JitterCase kJitterCases[] = {
+    { 0.0,   1.5,  0.01 },
+    { 50.0,  7.0,  0.5 },
+    { 200.0, 11.0, 2.0 }
+};
+
+static const Float64 kSimulatedSeconds = 60.0;
+static const Float64 kSettledSeconds = 30.0;
+
+// Feeds kSimulatedSeconds of timestamps from a reference running inPPM off its nominal rate to a
+// new clock.
+static Result Simulate(Float64 inHostFrequency, Float64 inPPM, Float64 inJitterMicroseconds)
+{
+    EFF_LoopbackClock theClock;
+    theClock.Initialize(inHostFrequency, kSampleRate, kPeriodFrames);
+    theClock.Start(1000);
+
+    std::mt19937 theRandom(1);
+    std::normal_distribution<Float64> theJitter(0.0, inJitterMicroseconds * 1.0e-6 * inHostFrequency);
+
+    const Float64 theActualRate = 1.0 + inPPM * 1.0e-6;
+    const Float64 theHostTicksPerFrame = inHostFrequency / (kSampleRate * theActualRate);
+    const UInt32 theTimeStamps = static_cast<UInt32>(kSimulatedSeconds * kSampleRate / kReferenceBufferFrames);
+
+    Result theResult;
+
+    for(UInt32 i = 0; i < theTimeStamps; i++)
+    {
+        const Float64 theSampleTime = static_cast<Float64>(i) * kReferenceBufferFrames;
+        const Float64 theHostTime = 1.0e6 + theSampleTime * theHostTicksPerFrame + theJitter(theRandom);
+
+        if(theClock.AddReferenceTimeStamp(theSampleTime, static_cast<UInt64>(theHostTime), kSampleRate))
+        {
+            theResult.mDiscontinuities++;
+        }
+
+        const Float64 theErrorPPM = std::fabs(theClock.GetRateScalar() - theActualRate) * 1.0e6;
+        const Float64 theSeconds = theSampleTime / kSampleRate;
+
+        if(theErrorPPM > kConvergedPPM)
+        {
+            theResult.mConvergenceSeconds = theSeconds;
+        }
+
+        if(theSeconds >= kSettledSeconds)
+        {
+            theResult.mSteadyStatePPM = std::max(theResult.mSteadyStatePPM, theErrorPPM);
+        }
+    }
+
+    return theResult;
+}
+
+static void TestConvergence()
+{
+    printf("%10s %8s %10s %16s %14s\n", "host MHz", "ppm", "jitter us", "converged in s", "steady ppm");
+
+    for(Float64 theHostFrequency : kHostFrequencies)
+    {
+        for(Float64 thePPM : { 200.0, -200.0, 50.0, -50.0 })
+        {
+            for(const JitterCase& theCase : kJitterCases)
+            {
+                const Result theResult = Simulate(theHostFrequency, thePPM, theCase.mJitterMicroseconds);
+
+                printf("%10.0f %+8.0f %10.0f %16.2f %14.3f\n",
+                       theHostFrequency / 1.0e6,
+                       thePPM,
+                       theCase.mJitterMicroseconds,
+                       theResult.mConvergenceSeconds,
+                       theResult.mSteadyStatePPM);
+
+                EFFCheck(theResult.mConvergenceSeconds <= theCase.mMaxConvergenceSeconds);
+                EFFCheck(theResult.mSteadyStatePPM <= theCase.mMaxSteadyStatePPM);
+                EFFCheck(theResult.mDiscontinuities == 0);
+            }
+        }
+    }
+}
+
+// The zero timestamps the HAL sees: one per period, evenly spaced at the estimated rate, and never
+// jumping when the estimate changes.
+static void TestZeroTimeStamps()
+{
+    const Float64 theHostFrequency = 24.0e6;
+    const Float64 theActualRate = 1.0 + 150.0e-6;
+    const Float64 theReferenceTicksPerFrame = theHostFrequency / (kSampleRate * theActualRate);
+    const Float64 theNominalPeriodTicks = kPeriodFrames * theHostFrequency / kSampleRate;
+
+    EFF_LoopbackClock theClock;
+    theClock.Initialize(theHostFrequency, kSampleRate, kPeriodFrames);
+    theClock.Start(5000);
+
+    UInt64 theNow = 5000;
+    Float64 thePreviousSampleTime = -1.0;
+    UInt64 thePreviousHostTime = 0;
+    UInt32 theSettledPeriods = 0;
+
+    // 60 s, with a reference timestamp every 10 ms and the HAL asking for the zero timestamp every
+    // 1 ms.
+    for(UInt32 theStep = 0; theStep < 60000; theStep++)
+    {
+        if(theStep % 10 == 0)
+        {
+            const Float64 theSampleTime = theStep / 10 * 480.0;
+            EFFCheck(!theClock.AddReferenceTimeStamp(theSampleTime,
+                                                     static_cast<UInt64>(1.0e6 + theSampleTime * theReferenceTicksPerFrame),
+                                                     kSampleRate));
+        }
+
+        theNow += static_cast<UInt64>(theHostFrequency / 1000.0);
+
+        Float64 theSampleTime;
+        UInt64 theHostTime, theSeed;
+        theClock.GetZeroTimeStamp(theNow, theSampleTime, theHostTime, theSeed);
+
+        EFFCheck(theSeed == 1);
+        EFFCheck(theHostTime <= theNow);
+
+        if(theSampleTime != thePreviousSampleTime)
+        {
+            if(thePreviousSampleTime >= 0.0)
+            {
+                EFFCheck(theSampleTime == thePreviousSampleTime + kPeriodFrames);
+
+                // Never further from the nominal period than the loop's rate limit allows.
+                const Float64 thePeriodTicks = static_cast<Float64>(theHostTime - thePreviousHostTime);
+                EFFCheck(std::fabs(thePeriodTicks / theNominalPeriodTicks - 1.0) < 0.005);
+
+                // Once settled, at the reference's rate to within a couple of ppm, allowing for the
+                // host times being rounded to whole ticks.
+                if(theStep > 10000)
+                {
+                    const Float64 theIdealTicks = kPeriodFrames * theReferenceTicksPerFrame;
+                    EFFCheck(std::fabs(thePeriodTicks - theIdealTicks) <= theIdealTicks * 2.0e-6 + 1.0);
+                    theSettledPeriods++;
+                }
+            }
+
+            thePreviousSampleTime = theSampleTime;
+            thePreviousHostTime = theHostTime;
+        }
+    }
+
+    EFFCheck(theSettledPeriods > 100);
+    EFFCheck(std::fabs(theClock.GetRateScalar() - theActualRate) < 1.0e-7);
+}
+
+static void TestDiscontinuities()
+{
+    const Float64 theHostFrequency = 24.0e6;
+    const Float64 theActualRate = 1.0 + 150.0e-6;
+    const Float64 theTicksPerFrame = theHostFrequency / (kSampleRate * theActualRate);
+
+    EFF_LoopbackClock theClock;
+    theClock.Initialize(theHostFrequency, 44100.0, kPeriodFrames);
+    theClock.Start(0);
+
+    EFFCheck(!theClock.IsLocked());
+    EFFCheck(theClock.GetRateScalar() == 1.0);
+
+    Float64 theHostTime = 1.0e6;
+    Float64 theSampleTime = 0.0;
+
+    auto AddTimeStamps = [&] (UInt32 inCount) {
+        UInt32 theDiscontinuities = 0;
+        for(UInt32 i = 0; i < inCount; i++)
+        {
+            theDiscontinuities += theClock.AddReferenceTimeStamp(theSampleTime,
+                                                                 static_cast<UInt64>(theHostTime),
+                                                                 kSampleRate) ? 1 : 0;
+            theSampleTime += kReferenceBufferFrames;
+            theHostTime += kReferenceBufferFrames * theTicksPerFrame;
+        }
+        return theDiscontinuities;
+    };
+
+    EFFCheck(AddTimeStamps(1000) == 0);
+    EFFCheck(theClock.IsLocked());
+    EFFCheck(theClock.GetSeed() == 1);
+
+    const Float64 theLockedRate = theClock.GetRateScalar();
+    EFFCheck(std::fabs(theLockedRate - theActualRate) < 1.0e-6);
+
+    // The reference device restarted, so its sample time went back to 0. The loop re-locks, keeping
+    // its estimate, and the seed goes up once.
+    theSampleTime = 0.0;
+    EFFCheck(AddTimeStamps(100) == 1);
+    EFFCheck(theClock.GetSeed() == 2);
+    EFFCheck(std::fabs(theClock.GetRateScalar() - theLockedRate) < 1.0e-6);
+
+    // The reference's host times jumped, e.g. the output device stalled.
+    theHostTime += theHostFrequency * 0.01;
+    EFFCheck(AddTimeStamps(100) == 1);
+    EFFCheck(theClock.GetSeed() == 3);
+
+    // Its nominal sample rate changed.
+    EFFCheck(theClock.AddReferenceTimeStamp(theSampleTime, static_cast<UInt64>(theHostTime), 96000.0));
+    EFFCheck(theClock.GetSeed() == 4);
+
+    // A reference far outside any real device's tolerance never pulls the rate out of range. The
+    // loop gives up on its estimate and starts again instead.
+    EFF_LoopbackClock theBadClock;
+    theBadClock.Initialize(theHostFrequency, kSampleRate, kPeriodFrames);
+    theBadClock.Start(0);
+
+    const Float64 theBadTicksPerFrame = theHostFrequency / (kSampleRate * 1.01);
+    bool theRateStayedInRange = true;
+
+    for(UInt32 i = 0; i < 10000; i++)
+    {
+        theBadClock.AddReferenceTimeStamp(i * 512.0, static_cast<UInt64>(1.0e6 + i * 512.0 * theBadTicksPerFrame), kSampleRate);
+        theRateStayedInRange = theRateStayedInRange && std::fabs(theBadClock.GetRateScalar() - 1.0) <= 0.005;
+    }
+
+    EFFCheck(theRateStayedInRange);
+    EFFCheck(theBadClock.GetSeed() > 1);
+}
+
+static void TestInvalidParameters()
+{
+    EFF_LoopbackClock theClock;
+
+    auto Throws = [] (auto inFunction) {
+        try
+        {
+            inFunction();
+        }
+        catch(const CAException&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    EFFCheck(Throws([&] { theClock.Initialize(0.0, kSampleRate, kPeriodFrames); }));
+    EFFCheck(Throws([&] { theClock.Initialize(24.0e6, 0.0, kPeriodFrames); }));
+    EFFCheck(Throws([&] { theClock.Initialize(24.0e6, kSampleRate, 0); }));
+
+    theClock.Initialize(24.0e6, kSampleRate, kPeriodFrames);
+    EFFCheck(Throws([&] { theClock.AddReferenceTimeStamp(0.0, 1000, 0.0); }));
+    EFFCheck(Throws([&] { theClock.AddReferenceTimeStamp(0.0, 1000, NAN); }));
+}
+
+int main()
+{
+    TestConvergence();
+    TestZeroTimeStamps();
+    TestDiscontinuities();
+    TestInvalidParameters();
+
+    return EFF_TestHarness::Finish("EFF_LoopbackClockTests");
+}
@@ -0,0 +1,159 @@
+//
+//  EFF_LoopbackRingBufferBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Measures EFF_LoopbackRingBuffer's Store and Fetch throughput and per-call times, first with one
+//  thread doing both, then with a writer and a reader thread pinned to different CPUs (when the
+//  host has two) running at the same time. Also counts failed Stores, which should always be 0.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_LoopbackRingBuffer.h"
+
+// STL Includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+typedef EFF_LoopbackRingBuffer::SampleTime SampleTime;
+
+static const UInt32 kCapacityFrames = 16384;
+
+static void PrintCallTimes(const char* inName, const std::vector<double>& inSeconds, UInt32 inFrames)
+{
+    EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(inSeconds);
+    printf("  %-6s %5u frames: mean %7.0f ns, p50 %7.0f ns, p99 %7.0f ns, max %9.0f ns, %7.1f Mframes/s\n",
+           inName,
+           inFrames,
+           theStats.mMean * 1e9,
+           theStats.mP50 * 1e9,
+           theStats.mP99 * 1e9,
+           theStats.mMax * 1e9,
+           inFrames / theStats.mMean / 1e6);
+}
+
+static void BenchmarkOneThread(UInt32 inChannels, UInt32 inCycleFrames, UInt32 inCycles)
+{
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(inChannels, kCapacityFrames);
+
+    std::vector<Float32> theIn(static_cast<size_t>(inCycleFrames) * inChannels, 0.25f);
+    std::vector<Float32> theOut(theIn.size());
+    std::vector<double> theStoreTimes, theFetchTimes;
+    theStoreTimes.reserve(inCycles);
+    theFetchTimes.reserve(inCycles);
+
+    for(UInt32 theCycle = 0; theCycle < inCycles; theCycle++)
+    {
+        SampleTime theTime = static_cast<SampleTime>(theCycle) * inCycleFrames;
+
+        double theStart = EFF_TestHarness::NowSeconds();
+        theRing.Store(theIn.data(), inCycleFrames, theTime);
+        double theMiddle = EFF_TestHarness::NowSeconds();
+        theRing.Fetch(theOut.data(), inCycleFrames, theTime);
+        double theEnd = EFF_TestHarness::NowSeconds();
+
+        theStoreTimes.push_back(theMiddle - theStart);
+        theFetchTimes.push_back(theEnd - theMiddle);
+    }
+
+    EFF_TestHarness::DoNotOptimise(theOut[0]);
+
+    printf("one thread, %u channels:\n", inChannels);
+    PrintCallTimes("Store", theStoreTimes, inCycleFrames);
+    PrintCallTimes("Fetch", theFetchTimes, inCycleFrames);
+}
+
+static void BenchmarkTwoThreads(UInt32 inChannels, UInt32 inCycleFrames, double inSeconds)
+{
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(inChannels, kCapacityFrames);
+
+    std::atomic<bool> theStop { false };
+    std::atomic<SampleTime> theWriterTime { 0 };
+    UInt64 theStoreErrors = 0;
+    std::vector<double> theStoreTimes, theFetchTimes;
+
+    std::thread theWriter([&] {
+        bool thePinned = EFF_TestHarness::PinThreadToCPU(0);
+        std::vector<Float32> theIn(static_cast<size_t>(inCycleFrames) * inChannels, 0.25f);
+        SampleTime theTime = 0;
+
+        while(!theStop.load(std::memory_order_relaxed))
+        {
+            double theStart = EFF_TestHarness::NowSeconds();
+            if(theRing.Store(theIn.data(), inCycleFrames, theTime) != kEFFRingBufferError_OK)
+            {
+                theStoreErrors++;
+            }
+            theStoreTimes.push_back(EFF_TestHarness::NowSeconds() - theStart);
+
+            theTime += inCycleFrames;
+            theWriterTime.store(theTime, std::memory_order_release);
+        }
+
+        printf("two threads, %u channels (writer %s):\n", inChannels, thePinned ? "pinned" : "not pinned");
+    });
+
+    bool thePinned = EFF_TestHarness::PinThreadToCPU(1);
+    std::vector<Float32> theOut(static_cast<size_t>(inCycleFrames) * inChannels);
+    SampleTime theReadTime = 0;
+    double theEndTime = EFF_TestHarness::NowSeconds() + inSeconds;
+
+    while(EFF_TestHarness::NowSeconds() < theEndTime)
+    {
+        // Follow the writer one cycle behind, like ReadInput does.
+        SampleTime theWriterEnd = theWriterTime.load(std::memory_order_acquire);
+        if(theWriterEnd - theReadTime < 2 * static_cast<SampleTime>(inCycleFrames))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        theReadTime = theWriterEnd - 2 * inCycleFrames;
+
+        double theStart = EFF_TestHarness::NowSeconds();
+        theRing.Fetch(theOut.data(), inCycleFrames, theReadTime);
+        theFetchTimes.push_back(EFF_TestHarness::NowSeconds() - theStart);
+    }
+
+    theStop = true;
+    theWriter.join();
+
+    EFF_TestHarness::DoNotOptimise(theOut[0]);
+
+    printf("  (reader %s, %llu store errors)\n",
+           thePinned ? "pinned" : "not pinned",
+           static_cast<unsigned long long>(theStoreErrors));
+    PrintCallTimes("Store", theStoreTimes, inCycleFrames);
+    PrintCallTimes("Fetch", theFetchTimes, inCycleFrames);
+}
+
+int main(int argc, char* argv[])
+{
+    bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    UInt32 theCycles = theQuick ? 2000 : 200000;
+
+    for(UInt32 theChannels : { 2u, 8u })
+    {
+        for(UInt32 theCycleFrames : { 128u, 512u, 4096u })
+        {
+            BenchmarkOneThread(theChannels, theCycleFrames, theCycles);
+        }
+    }
+
+    for(UInt32 theChannels : { 2u, 8u })
+    {
+        BenchmarkTwoThreads(theChannels, 512, theQuick ? 0.2 : 5.0);
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,371 @@
+//
+//  EFF_LoopbackRingBufferTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests EFF_LoopbackRingBuffer's semantics, then stress tests it with a writer and a reader thread
+//  pinned to different CPUs (when the host has two). The stress test checks that every frame the
+//  reader gets is either exactly what was written at its sample time or silence, that frames the
+//  writer can't have overwritten are never silence, and that Store never fails.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_LoopbackRingBuffer.h"
+
+// STL Includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+typedef EFF_LoopbackRingBuffer::SampleTime SampleTime;
+
+// The value written for each sample. Never 0, so silence can be told apart, and always exactly
+// representable as a Float32.
+static Float32 SampleValue(SampleTime inSampleTime, UInt32 inChannel)
+{
+    return static_cast<Float32>((inSampleTime * 7 + inChannel) % 1000003 + 1);
+}
+
+static void FillFrames(std::vector<Float32>& outBuffer,
+                       SampleTime inStartTime,
+                       UInt32 inFrames,
+                       UInt32 inChannels)
+{
+    outBuffer.resize(static_cast<size_t>(inFrames) * inChannels);
+
+    for(UInt32 theFrame = 0; theFrame < inFrames; theFrame++)
+    {
+        for(UInt32 theChannel = 0; theChannel < inChannels; theChannel++)
+        {
+            outBuffer[theFrame * inChannels + theChannel] = SampleValue(inStartTime + theFrame, theChannel);
+        }
+    }
+}
+
+static bool FrameIs(const Float32* inFrame, SampleTime inSampleTime, UInt32 inChannels)
+{
+    for(UInt32 theChannel = 0; theChannel < inChannels; theChannel++)
+    {
+        if(inFrame[theChannel] != SampleValue(inSampleTime, theChannel))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool FrameIsSilent(const Float32* inFrame, UInt32 inChannels)
+{
+    for(UInt32 theChannel = 0; theChannel < inChannels; theChannel++)
+    {
+        if(inFrame[theChannel] != 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void TestRoundTripAndWrapping()
+{
+    const UInt32 kChannels = 2;
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, 1000);
+
+    // Rounded up to a power of two.
+    EFFCheck(theRing.GetCapacityFrames() == 1024);
+
+    std::vector<Float32> theIn, theOut(300 * kChannels);
+
+    // Enough 300-frame cycles to wrap around several times.
+    for(SampleTime theTime = 0; theTime < 10 * 1024; theTime += 300)
+    {
+        FillFrames(theIn, theTime, 300, kChannels);
+        EFFCheck(theRing.Store(theIn.data(), 300, theTime) == kEFFRingBufferError_OK);
+
+        UInt32 theSilentFrames = 99;
+        EFFCheck(theRing.Fetch(theOut.data(), 300, theTime, &theSilentFrames) == kEFFRingBufferError_OK);
+        EFFCheck(theSilentFrames == 0);
+        EFFCheck(theOut == theIn);
+    }
+
+    SampleTime theStart, theEnd;
+    theRing.GetTimeBounds(theStart, theEnd);
+    EFFCheck(theEnd - theStart == 1024);
+}
+
+static void TestGapsAndBounds()
+{
+    const UInt32 kChannels = 3;
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, 256);
+
+    std::vector<Float32> theIn, theOut(200 * kChannels);
+
+    FillFrames(theIn, 1000, 50, kChannels);
+    theRing.Store(theIn.data(), 50, 1000);
+    // Skip 30 frames.
+    FillFrames(theIn, 1080, 50, kChannels);
+    theRing.Store(theIn.data(), 50, 1080);
+
+    // From 20 frames before the first store to 20 after the second.
+    UInt32 theSilentFrames = 0;
+    theRing.Fetch(theOut.data(), 170, 980, &theSilentFrames);
+
+    for(UInt32 theFrame = 0; theFrame < 170; theFrame++)
+    {
+        SampleTime theTime = 980 + theFrame;
+        const Float32* theOutFrame = &theOut[theFrame * kChannels];
+        bool theFrameWasStored = (theTime >= 1000 && theTime < 1050) || (theTime >= 1080 && theTime < 1130);
+
+        EFFCheck(theFrameWasStored ? FrameIs(theOutFrame, theTime, kChannels) : FrameIsSilent(theOutFrame, kChannels));
+    }
+
+    // The frames before the first store and after the second are counted as silent, since they
+    // aren't in the buffer. (The first store jumped past the buffer's capacity from sample time 0,
+    // so nothing before it was stored.) The gap is stored as silence, so it isn't.
+    EFFCheck(theSilentFrames == 20 + 20);
+}
+
+static void TestGoingBackwards()
+{
+    const UInt32 kChannels = 2;
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, 512);
+
+    std::vector<Float32> theIn, theOut(100 * kChannels);
+
+    FillFrames(theIn, 5000, 100, kChannels);
+    theRing.Store(theIn.data(), 100, 5000);
+    FillFrames(theIn, 4000, 100, kChannels);
+    theRing.Store(theIn.data(), 100, 4000);
+
+    // Going backwards empties the buffer, so the frames at 5000 are gone.
+    SampleTime theStart, theEnd;
+    theRing.GetTimeBounds(theStart, theEnd);
+    EFFCheck(theStart == 4000);
+    EFFCheck(theEnd == 4100);
+
+    UInt32 theSilentFrames = 0;
+    theRing.Fetch(theOut.data(), 100, 5000, &theSilentFrames);
+    EFFCheck(theSilentFrames == 100);
+    EFFCheck(FrameIsSilent(theOut.data(), kChannels));
+
+    theRing.Fetch(theOut.data(), 100, 4000);
+    EFFCheck(theOut == theIn);
+}
+
+// A write that jumps so far ahead that it overwrites everything in the buffer moves the start time
+// to the write instead of storing silence for the gap.
+static void TestLargeForwardJump()
+{
+    const UInt32 kChannels = 2;
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, 1024);
+
+    std::vector<Float32> theIn, theOut(1024 * kChannels);
+
+    FillFrames(theIn, 0, 512, kChannels);
+    theRing.Store(theIn.data(), 512, 0);
+
+    // Jump well past the buffer's capacity.
+    const SampleTime kJumpTo = 100000;
+    FillFrames(theIn, kJumpTo, 256, kChannels);
+    EFFCheck(theRing.Store(theIn.data(), 256, kJumpTo) == kEFFRingBufferError_OK);
+
+    SampleTime theStart, theEnd;
+    theRing.GetTimeBounds(theStart, theEnd);
+    EFFCheck(theStart == kJumpTo);
+    EFFCheck(theEnd == kJumpTo + 256);
+
+    // The whole buffer's worth of frames before the jump read as silence, and are counted as
+    // silent frames because they aren't in the buffer.
+    UInt32 theSilentFrames = 0;
+    theRing.Fetch(theOut.data(), 1024, kJumpTo - 1024, &theSilentFrames);
+    EFFCheck(theSilentFrames == 1024);
+    for(UInt32 theFrame = 0; theFrame < 1024; theFrame++)
+    {
+        EFFCheck(FrameIsSilent(&theOut[theFrame * kChannels], kChannels));
+    }
+
+    // The old frames are gone and the new ones are intact.
+    theRing.Fetch(theOut.data(), 512, 0, &theSilentFrames);
+    EFFCheck(theSilentFrames == 512);
+
+    theRing.Fetch(theOut.data(), 256, kJumpTo, &theSilentFrames);
+    EFFCheck(theSilentFrames == 0);
+    EFFCheck(std::equal(theIn.begin(), theIn.end(), theOut.begin()));
+
+    // Writing on from there works as normal, including a short gap, which is still stored as
+    // silence, so its frames aren't counted as silent frames.
+    FillFrames(theIn, kJumpTo + 300, 256, kChannels);
+    theRing.Store(theIn.data(), 256, kJumpTo + 300);
+    theRing.Fetch(theOut.data(), 300, kJumpTo + 256, &theSilentFrames);
+    EFFCheck(theSilentFrames == 0);
+    EFFCheck(FrameIsSilent(theOut.data(), kChannels));
+    EFFCheck(FrameIs(&theOut[44 * kChannels], kJumpTo + 300, kChannels));
+
+    // A jump that only overwrites part of the buffer keeps the frames after the start time and
+    // stores silence in the gap, as before.
+    theRing.Allocate(kChannels, 1024);
+    FillFrames(theIn, 0, 512, kChannels);
+    theRing.Store(theIn.data(), 512, 0);
+    FillFrames(theIn, 900, 256, kChannels);
+    theRing.Store(theIn.data(), 256, 900);
+
+    theRing.GetTimeBounds(theStart, theEnd);
+    EFFCheck(theStart == 900 + 256 - 1024);
+    theRing.Fetch(theOut.data(), 900 - theStart, theStart, &theSilentFrames);
+    EFFCheck(theSilentFrames == 0);
+    EFFCheck(FrameIs(theOut.data(), theStart, kChannels));
+    EFFCheck(FrameIsSilent(&theOut[(512 - theStart) * kChannels], kChannels));
+}
+
+static void TestTooMuch()
+{
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(2, 128);
+
+    std::vector<Float32> theIn(129 * 2, 1.0f);
+    EFFCheck(theRing.Store(theIn.data(), 129, 0) == kEFFRingBufferError_TooMuch);
+    EFFCheck(theRing.Store(theIn.data(), 128, 0) == kEFFRingBufferError_OK);
+}
+
+// The writer stores kCycleFrames-frame cycles as fast as it can. The reader fetches cycles that
+// trail it by a random distance, sometimes too far behind for the frames to still be there, so
+// both the normal path and the overwrite detection are exercised.
+static void TestConcurrentStress(double inSeconds)
+{
+    const UInt32 kChannels = 2;
+    const UInt32 kCapacityFrames = 4096;
+    const UInt32 kCycleFrames = 256;
+
+    EFF_LoopbackRingBuffer theRing;
+    theRing.Allocate(kChannels, kCapacityFrames);
+
+    std::atomic<bool> theStop { false };
+    std::atomic<UInt64> theStoreErrors { 0 };
+    std::atomic<SampleTime> theWriterTime { 0 };
+
+    std::thread theWriter([&] {
+        bool thePinned = EFF_TestHarness::PinThreadToCPU(0);
+        printf("writer %s\n", thePinned ? "pinned to CPU 0" : "not pinned");
+
+        std::vector<Float32> theIn;
+        SampleTime theTime = 0;
+
+        while(!theStop.load(std::memory_order_relaxed))
+        {
+            FillFrames(theIn, theTime, kCycleFrames, kChannels);
+
+            if(theRing.Store(theIn.data(), kCycleFrames, theTime) != kEFFRingBufferError_OK)
+            {
+                theStoreErrors++;
+            }
+
+            theTime += kCycleFrames;
+            theWriterTime.store(theTime, std::memory_order_release);
+        }
+    });
+
+    UInt64 theFetches = 0, theFramesRead = 0, theSilentFramesRead = 0;
+    UInt64 theWrongFrames = 0, theUnexpectedSilence = 0;
+
+    {
+        bool thePinned = EFF_TestHarness::PinThreadToCPU(1);
+        printf("reader %s\n", thePinned ? "pinned to CPU 1" : "not pinned");
+
+        std::vector<Float32> theOut(kCycleFrames * kChannels);
+        UInt32 theSeed = 12345;
+        double theEndTime = EFF_TestHarness::NowSeconds() + inSeconds;
+
+        while(EFF_TestHarness::NowSeconds() < theEndTime)
+        {
+            SampleTime theWriterEnd = theWriterTime.load(std::memory_order_acquire);
+
+            if(theWriterEnd < 2 * kCapacityFrames)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Read somewhere between just behind the writer and one and a half buffers behind.
+            theSeed = theSeed * 1664525 + 1013904223;
+            SampleTime theLag = kCycleFrames + (theSeed >> 8) % (kCapacityFrames + kCapacityFrames / 2);
+            SampleTime theStartRead = theWriterEnd - theLag;
+
+            UInt32 theSilentFrames = 0;
+            theRing.Fetch(theOut.data(), kCycleFrames, theStartRead, &theSilentFrames);
+
+            // The bounds after the fetch. Frames after the start time at this point can't have
+            // been overwritten during it.
+            SampleTime theStartAfter, theEndAfter;
+            theRing.GetTimeBounds(theStartAfter, theEndAfter);
+
+            for(UInt32 theFrame = 0; theFrame < kCycleFrames; theFrame++)
+            {
+                SampleTime theTime = theStartRead + theFrame;
+                const Float32* theOutFrame = &theOut[theFrame * kChannels];
+
+                if(FrameIsSilent(theOutFrame, kChannels))
+                {
+                    // Every frame before theWriterEnd was stored, so silence is only allowed for
+                    // frames the writer might have overwritten by the end of the fetch.
+                    if(theTime >= theStartAfter && theTime < theWriterEnd)
+                    {
+                        theUnexpectedSilence++;
+                    }
+                }
+                else if(!FrameIs(theOutFrame, theTime, kChannels))
+                {
+                    theWrongFrames++;
+                }
+            }
+
+            theFetches++;
+            theFramesRead += kCycleFrames;
+            theSilentFramesRead += theSilentFrames;
+        }
+    }
+
+    theStop = true;
+    theWriter.join();
+
+    SampleTime theFramesWritten = theWriterTime.load();
+    printf("stress: %.1f s, %lld frames written, %llu fetches, %llu frames read, %llu silent\n",
+           inSeconds,
+           static_cast<long long>(theFramesWritten),
+           static_cast<unsigned long long>(theFetches),
+           static_cast<unsigned long long>(theFramesRead),
+           static_cast<unsigned long long>(theSilentFramesRead));
+    printf("stress: %llu store errors, %llu wrong frames, %llu unexpected silent frames\n",
+           static_cast<unsigned long long>(theStoreErrors.load()),
+           static_cast<unsigned long long>(theWrongFrames),
+           static_cast<unsigned long long>(theUnexpectedSilence));
+
+    EFFCheck(theStoreErrors == 0);
+    EFFCheck(theWrongFrames == 0);
+    EFFCheck(theUnexpectedSilence == 0);
+    EFFCheck(theFetches > 0);
+}
+
+int main(int argc, char* argv[])
+{
+    TestRoundTripAndWrapping();
+    TestGapsAndBounds();
+    TestGoingBackwards();
+    TestLargeForwardJump();
+    TestTooMuch();
+    TestConcurrentStress(EFF_TestHarness::IsQuick(argc, argv) ? 0.5 : 3.0);
+
+    return EFF_TestHarness::Finish("EFF_LoopbackRingBufferTests");
+}
+
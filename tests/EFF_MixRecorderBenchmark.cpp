@@ -0,0 +1,206 @@
+//
+//  EFF_MixRecorderBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Records 8 channel 96 kHz Int24 WAV through EFF_MixRecorder the way EFF_Device's IO thread
+//  would, with a thread that calls CaptureRT once per 512 frame cycle, paced at a multiple of real
+//  time. Prints the blocks the writer thread couldn't keep up with, the slowest CaptureRT call and
+//  how long Stop took to drain the FIFO. Then reads the file back and checks every sample, so the
+//  long run also checks the switch to RF64 once the file passes 4 GiB.
+//
+//  By default, records two hours of audio at 40 times real time (so about three minutes and a
+//  16.6 GB file). --seconds <n> and --speed <x> change those, with a speed of 0 meaning as fast as
+//  CaptureRT can be called, and --dir <path> sets the disk to record to. The file is deleted
+//  afterwards.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_MixRecorder.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+static const UInt32 kChannels = 8;
+static const Float64 kSampleRate = 96000.0;
+static const UInt32 kCycleFrames = 512;
+
+// An exact Int24 value for each frame and channel, so the file can be checked bit for bit.
+static Float32 SampleFor(UInt64 inFrame, UInt32 inChannel)
+{
+    return static_cast<Float32>(static_cast<SInt32>((inFrame * kChannels + inChannel) % 65536) - 32768) / 8388608.0f;
+}
+
+// Returns the number of samples in the file's audio data that aren't the ones recorded.
+static UInt64 VerifyFile(const std::string& inPath, UInt64 inFrames)
+{
+    FILE* theFile = fopen(inPath.c_str(), "rb");
+    EFFCheck(theFile != nullptr);
+
+    if(!theFile)
+    {
+        return inFrames * kChannels;
+    }
+
+    // EFF_CaptureFileWriter pads the header so the audio starts on a page boundary.
+    fseeko(theFile, 4096, SEEK_SET);
+
+    std::vector<UInt8> theBuffer(1024 * 1024 * 3 * kChannels);
+    UInt64 theFrame = 0;
+    UInt64 theWrongSamples = 0;
+
+    while(theFrame < inFrames)
+    {
+        const size_t theBytes = fread(theBuffer.data(), 1, theBuffer.size(), theFile);
+
+        if(theBytes == 0)
+        {
+            break;
+        }
+
+        for(size_t theOffset = 0; theOffset + 3 * kChannels <= theBytes; theOffset += 3 * kChannels)
+        {
+            for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+            {
+                const UInt8* theSample = &theBuffer[theOffset + theChannel * 3];
+                const SInt32 theValue = static_cast<SInt32>((theSample[0] << 8) | (theSample[1] << 16) |
+                                                            (static_cast<UInt32>(theSample[2]) << 24)) >> 8;
+
+                if(theValue / 8388608.0f != SampleFor(theFrame, theChannel))
+                {
+                    theWrongSamples++;
+                }
+            }
+
+            theFrame++;
+        }
+    }
+
+    fclose(theFile);
+
+    EFFCheck(theFrame == inFrames);
+
+    return theWrongSamples + (inFrames - std::min(theFrame, inFrames)) * kChannels;
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    Float64 theSeconds = theQuick ? 5.0 : 7200.0;
+    Float64 theSpeed = 40.0;
+    const char* theDirectory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    for(int theArg = 1; theArg + 1 < argc; theArg++)
+    {
+        if(strcmp(argv[theArg], "--seconds") == 0)
+        {
+            theSeconds = atof(argv[theArg + 1]);
+        }
+        else if(strcmp(argv[theArg], "--speed") == 0)
+        {
+            theSpeed = atof(argv[theArg + 1]);
+        }
+        else if(strcmp(argv[theArg], "--dir") == 0)
+        {
+            theDirectory = argv[theArg + 1];
+        }
+    }
+
+    const std::string thePath =
+        std::string(theDirectory) + "/EFF_MixRecorderBenchmark." + std::to_string(getpid()) + ".wav";
+    CFStringRef thePathString = CFStringCreateWithCString(kCFAllocatorDefault,
+                                                          thePath.c_str(),
+                                                          kCFStringEncodingUTF8);
+
+    printf("%u channels at %.0f kHz, %u frame cycles, %.0f s of Int24 WAV at %.0fx real time, to %s\n",
+           kChannels, kSampleRate / 1000.0, kCycleFrames, theSeconds, theSpeed, thePath.c_str());
+
+    EFF_MixRecorder theRecorder;
+    theRecorder.Start(thePathString,
+                      kEFFRecordingFileFormatWAV,
+                      kEFFRecordingSampleFormatInt24,
+                      kChannels,
+                      kSampleRate);
+
+    const UInt64 theTotalFrames = static_cast<UInt64>(theSeconds * kSampleRate);
+    std::vector<Float32> theMix(kCycleFrames * kChannels);
+    std::vector<double> theCaptureTimes;
+    UInt64 theDroppedBlocks = 0;
+
+    const auto theStart = std::chrono::steady_clock::now();
+
+    for(UInt64 theFrame = 0; theFrame < theTotalFrames; )
+    {
+        const UInt32 theFrames = static_cast<UInt32>(std::min<UInt64>(kCycleFrames, theTotalFrames - theFrame));
+
+        for(UInt32 theOffset = 0; theOffset < theFrames; theOffset++)
+        {
+            for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+            {
+                theMix[theOffset * kChannels + theChannel] = SampleFor(theFrame + theOffset, theChannel);
+            }
+        }
+
+        const double theCaptureStart = EFF_TestHarness::NowSeconds();
+        theDroppedBlocks += theRecorder.CaptureRT(theMix.data(), theFrames);
+        theCaptureTimes.push_back((EFF_TestHarness::NowSeconds() - theCaptureStart) * 1e9);
+
+        theFrame += theFrames;
+
+        if(theSpeed > 0.0)
+        {
+            std::this_thread::sleep_until(theStart + std::chrono::duration<double>(theFrame / kSampleRate / theSpeed));
+        }
+    }
+
+    const double theStopStart = EFF_TestHarness::NowSeconds();
+    theRecorder.Stop();
+    const double theStopSeconds = EFF_TestHarness::NowSeconds() - theStopStart;
+    const double theWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - theStart).count();
+
+    const EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(theCaptureTimes);
+
+    printf("%10s %14s %10s %16s %16s %16s\n",
+           "wall s", "x real time", "stop s", "dropped blocks", "CaptureRT p99 ns", "CaptureRT max ns");
+    printf("%10.1f %14.1f %10.2f %16llu %16.0f %16.0f\n",
+           theWall,
+           theSeconds / theWall,
+           theStopSeconds,
+           static_cast<unsigned long long>(theDroppedBlocks),
+           theStats.mP99,
+           theStats.mMax);
+
+    // Only paced runs should keep up. Unpaced ones show how the recorder degrades.
+    if(theSpeed > 0.0)
+    {
+        EFFCheck(theDroppedBlocks == 0);
+    }
+
+    if(theDroppedBlocks == 0)
+    {
+        const UInt64 theWrongSamples = VerifyFile(thePath, theTotalFrames);
+        printf("%llu wrong samples\n", static_cast<unsigned long long>(theWrongSamples));
+        EFFCheck(theWrongSamples == 0);
+    }
+
+    unlink(thePath.c_str());
+    CFRelease(thePathString);
+
+    return EFF_TestHarness::Finish("EFF_MixRecorderBenchmark");
+}
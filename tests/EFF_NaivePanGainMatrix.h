@@ -0,0 +1,56 @@
+//
+//  EFF_NaivePanGainMatrix.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A plain loop that applies an EFF_PanGainMatrix to any number of channels, one channel at a
+//  time, for the tests to check the specialised kernels against and the benchmark to compare them
+//  with.
+//
+
+#ifndef EFF_NaivePanGainMatrix_h
+#define EFF_NaivePanGainMatrix_h
+
+// Unit Include
+#include "EFF_AudioKernels.h"
+
+// STL Includes
+#include <algorithm>
+
+
+inline void EFF_NaiveApplyPanGainMatrix(const EFF_PanGainMatrix& inMatrix,
+                                        UInt32 inChannelsPerFrame,
+                                        bool inClip,
+                                        Float32* ioBuffer,
+                                        UInt32 inFrameCount)
+{
+    auto theClip = [inClip] (Float32 inSample) {
+        return inClip ? std::min(1.0f, std::max(-1.0f, inSample)) : inSample;
+    };
+
+    for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+    {
+        Float32* theSamples = ioBuffer + theFrame * inChannelsPerFrame;
+
+        for(UInt32 theChannel = 0; theChannel < inChannelsPerFrame; )
+        {
+            if(EFF_AudioKernels::IsUnpairedChannel(inChannelsPerFrame, theChannel))
+            {
+                theSamples[theChannel] = theClip(theSamples[theChannel] * inMatrix.mUnpairedGain);
+                theChannel++;
+            }
+            else
+            {
+                const Float32 theL = theSamples[theChannel];
+                const Float32 theR = theSamples[theChannel + 1];
+                theSamples[theChannel] = theClip(inMatrix.mPair.mLL * theL + inMatrix.mPair.mRL * theR);
+                theSamples[theChannel + 1] = theClip(inMatrix.mPair.mLR * theL + inMatrix.mPair.mRR * theR);
+                theChannel += 2;
+            }
+        }
+    }
+}
+
+#endif /* EFF_NaivePanGainMatrix_h */
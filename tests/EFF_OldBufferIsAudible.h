@@ -0,0 +1,51 @@
+//
+//  EFF_OldBufferIsAudible.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A copy of EFF_AudibleState::BufferIsAudible from before it used
+//  EFF_AudioKernels::AnySampleOutsideFirstFrameMargin, for the tests and benchmark to compare
+//  against. It only handled stereo buffers.
+//
+
+#ifndef EFF_OldBufferIsAudible_h
+#define EFF_OldBufferIsAudible_h
+
+// System Includes
+#include <MacTypes.h>
+
+
+// The same as in EFF_AudibleState.cpp.
+static const Float32 kSampleVolumeMarginRaw = 0.0001f;
+
+inline bool EFF_OldBufferIsAudible(UInt32 inIOBufferFrameSize, const Float32* inBuffer)
+{
+    if(inIOBufferFrameSize > 0)
+    {
+        // Bounds for the left channel samples.
+        Float32 firstSampleLLower = inBuffer[0] - kSampleVolumeMarginRaw;
+        Float32 firstSampleLUpper = inBuffer[0] + kSampleVolumeMarginRaw;
+        // Bounds for the right channel samples.
+        Float32 firstSampleRLower = inBuffer[1] - kSampleVolumeMarginRaw;
+        Float32 firstSampleRUpper = inBuffer[1] + kSampleVolumeMarginRaw;
+
+        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2)
+        {
+            bool audibleL =
+                    (inBuffer[i] < firstSampleLLower) || (inBuffer[i] > firstSampleLUpper);
+            bool audibleR =
+                    (inBuffer[i + 1] < firstSampleRLower) || (inBuffer[i + 1] > firstSampleRUpper);
+
+            if(audibleL || audibleR)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+#endif /* EFF_OldBufferIsAudible_h */
@@ -0,0 +1,58 @@
+//
+//  EFF_OldPanAndVolume.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  A copy of the body of EFF_Device::ApplyClientRelativeVolume from before it used
+//  EFF_AudioKernels, for the tests and benchmark to compare against. It applied the pan and then
+//  the volume in separate passes, and only handled stereo buffers.
+//
+
+#ifndef EFF_OldPanAndVolume_h
+#define EFF_OldPanAndVolume_h
+
+// System Includes
+#include <MacTypes.h>
+
+
+inline void EFF_OldApplyPanAndVolume(Float32 theRelativeVolume,
+                                     Float32 thePanPosition,
+                                     UInt32 inIOBufferFrameSize,
+                                     Float32* theBuffer)
+{
+    // Apply balance w/ crossfeed to the frames in the buffer.
+    // Expect samples interleaved, starting with left
+    if (thePanPosition > 0.0f) {
+        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
+            auto L = i;
+            auto R = i + 1;
+
+            theBuffer[R] = theBuffer[R] + theBuffer[L] * thePanPosition;
+            theBuffer[L] = theBuffer[L] * (1 - thePanPosition);
+        }
+    } else if (thePanPosition < 0.0f) {
+        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
+            auto L = i;
+            auto R = i + 1;
+
+            theBuffer[L] = theBuffer[L] + theBuffer[R] * (-thePanPosition);
+            theBuffer[R] = theBuffer[R] * (1 + thePanPosition);
+        }
+    }
+
+    if(theRelativeVolume != 1.0f)
+    {
+        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i++)
+        {
+            Float32 theAdjustedSample = theBuffer[i] * theRelativeVolume;
+
+            // Clamp to [-1, 1].
+            const Float32 theAdjustedSampleClippedBelow = theAdjustedSample < -1.0f ? -1.0f : theAdjustedSample;
+            theBuffer[i] = theAdjustedSampleClippedBelow > 1.0f ? 1.0f : theAdjustedSampleClippedBelow;
+        }
+    }
+}
+
+#endif /* EFF_OldPanAndVolume_h */
@@ -0,0 +1,241 @@
+//
+//  EFF_ParamRampTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Feeds step changes to a client's volume and pan position through the ramps and the ramp kernel,
+//  the way EFF_Device::ApplyClientRelativeVolume does, and checks that the output never jumps by
+//  more than a ramp of that length should allow, including across IO buffer boundaries.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_AudioKernels.h"
+#include "EFF_ClientParamsTable.h"
+#include "EFF_ParamRamp.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+static const UInt32 kClientID = 42;
+
+// The same steps as EFF_Device::ApplyClientRelativeVolume, for a stereo device.
+static void ApplyClientRelativeVolume(const EFF_ClientIOParams& inParams,
+                                      EFF_ClientRampState& ioRampState,
+                                      UInt32 inFrames,
+                                      Float32* ioBuffer)
+{
+    static const UInt32 kRampSegmentFrames = 32;
+
+    EFF_ParamRamp& theVolumeRamp = ioRampState.mRelativeVolume;
+    EFF_ParamRamp& thePanRamp = ioRampState.mPanPosition;
+    UInt32 theFramesDone = 0;
+
+    ioRampState.UpdateTargets(kClientID, inParams);
+
+    while(theFramesDone < inFrames && (theVolumeRamp.IsRamping() || thePanRamp.IsRamping()))
+    {
+        UInt32 theSegmentFrames = std::min({ kRampSegmentFrames,
+                                             inFrames - theFramesDone,
+                                             std::max(theVolumeRamp.GetFramesRemaining(),
+                                                      thePanRamp.GetFramesRemaining()) });
+
+        Float32 theStartVolume = theVolumeRamp.GetValue();
+        EFF_PanGainMatrix theStartMatrix =
+                EFF_AudioKernels::MakePanGainMatrix(theStartVolume, thePanRamp.GetValue());
+
+        theVolumeRamp.Advance(theSegmentFrames);
+        thePanRamp.Advance(theSegmentFrames);
+
+        EFF_PanGainMatrix theEndMatrix =
+                EFF_AudioKernels::MakePanGainMatrix(theVolumeRamp.GetValue(), thePanRamp.GetValue());
+
+        EFF_AudioKernels::ApplyPanGainMatrixRamp(theStartMatrix,
+                                                 theEndMatrix,
+                                                 2,
+                                                 theStartVolume != 1.0f || theVolumeRamp.GetValue() != 1.0f,
+                                                 ioBuffer + theFramesDone * 2,
+                                                 theSegmentFrames);
+
+        theFramesDone += theSegmentFrames;
+    }
+
+    EFF_PanGainMatrix theMatrix = EFF_AudioKernels::MakePanGainMatrix(theVolumeRamp.GetValue(),
+                                                                     thePanRamp.GetValue());
+
+    if(theFramesDone < inFrames && !theMatrix.IsIdentity())
+    {
+        EFF_AudioKernels::ApplyPanGainMatrix(theMatrix,
+                                             2,
+                                             theVolumeRamp.GetValue() != 1.0f,
+                                             ioBuffer + theFramesDone * 2,
+                                             inFrames - theFramesDone);
+    }
+}
+
+struct StepResponse
+{
+    // The largest change between consecutive samples in either channel.
+    Float32                     mMaxJump        = 0.0f;
+    // The last frame.
+    Float32                     mFinalL         = 0.0f;
+    Float32                     mFinalR         = 0.0f;
+};
+
+// Runs a constant signal through IO buffers of inBufferFrames frames each, with the client's
+// settings changed from inFrom to inTo after the first buffer.
+static StepResponse RunStep(const EFF_ClientIOParams& inFrom,
+                            const EFF_ClientIOParams& inTo,
+                            UInt32 inBufferFrames,
+                            Float32 inSignal)
+{
+    EFF_ClientRampState theRampState;
+    std::vector<Float32> theOutput;
+    const UInt32 theBuffers = 2 + (inTo.mRampFrames + inBufferFrames - 1) / inBufferFrames;
+
+    for(UInt32 theBuffer = 0; theBuffer < theBuffers; theBuffer++)
+    {
+        std::vector<Float32> theSamples(inBufferFrames * 2, inSignal);
+        ApplyClientRelativeVolume(theBuffer == 0 ? inFrom : inTo, theRampState, inBufferFrames, theSamples.data());
+        theOutput.insert(theOutput.end(), theSamples.begin(), theSamples.end());
+    }
+
+    StepResponse theResponse;
+
+    for(size_t i = 2; i < theOutput.size(); i++)
+    {
+        theResponse.mMaxJump = std::max(theResponse.mMaxJump, std::fabs(theOutput[i] - theOutput[i - 2]));
+    }
+
+    theResponse.mFinalL = theOutput[theOutput.size() - 2];
+    theResponse.mFinalR = theOutput[theOutput.size() - 1];
+
+    return theResponse;
+}
+
+static EFF_ClientIOParams MakeParams(Float32 inVolume, SInt8 inPanPosition, UInt16 inRampFrames, bool inExponential)
+{
+    EFF_ClientIOParams theParams;
+    theParams.mRelativeVolume = inVolume;
+    theParams.mPanPosition = inPanPosition;
+    theParams.mRampFrames = inRampFrames;
+    theParams.mExponentialRamp = inExponential;
+    return theParams;
+}
+
+static void TestLinearVolumeSteps()
+{
+    const UInt16 theRampFramesList[] = { 64, 512, 4096 };
+    const UInt32 theBufferFramesList[] = { 14, 100, 512 };
+
+    for(UInt16 theRampFrames : theRampFramesList)
+    {
+        for(UInt32 theBufferFrames : theBufferFramesList)
+        {
+            // Full scale up and down, and a smaller step.
+            const Float32 theSteps[][2] = { { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 1.0f, 0.25f } };
+
+            for(const auto& theStep : theSteps)
+            {
+                StepResponse theResponse = RunStep(MakeParams(theStep[0], 0, theRampFrames, false),
+                                                   MakeParams(theStep[1], 0, theRampFrames, false),
+                                                   theBufferFrames,
+                                                   1.0f);
+
+                // Each frame should move by the step divided by the ramp length. Allow a little for
+                // rounding.
+                const Float32 theIdealJump = std::fabs(theStep[1] - theStep[0]) / theRampFrames;
+                EFFCheck(theResponse.mMaxJump <= theIdealJump * 1.01f);
+                EFFCheck(theResponse.mFinalL == theStep[1]);
+                EFFCheck(theResponse.mFinalR == theStep[1]);
+            }
+        }
+    }
+}
+
+static void TestExponentialVolumeSteps()
+{
+    const UInt16 theRampFrames = 512;
+
+    for(UInt32 theBufferFrames : { 14u, 100u, 512u })
+    {
+        // From silence up to full scale and back. The ramps are linear in dB, so the largest change
+        // per frame is near full scale, where it's the value times the per-frame ratio minus one.
+        // The ratio is (1 / kExponentialFloor) ^ (1 / ramp frames).
+        const Float32 theRatio = std::pow(1.0e5f, 1.0f / theRampFrames);
+
+        StepResponse theUp = RunStep(MakeParams(0.0f, 0, theRampFrames, true),
+                                     MakeParams(1.0f, 0, theRampFrames, true),
+                                     theBufferFrames,
+                                     1.0f);
+        EFFCheck(theUp.mMaxJump <= (theRatio - 1.0f) * 1.01f);
+        EFFCheck(theUp.mFinalL == 1.0f);
+
+        StepResponse theDown = RunStep(MakeParams(1.0f, 0, theRampFrames, true),
+                                       MakeParams(0.0f, 0, theRampFrames, true),
+                                       theBufferFrames,
+                                       1.0f);
+        EFFCheck(theDown.mMaxJump <= (1.0f - 1.0f / theRatio) * 1.01f);
+        EFFCheck(theDown.mFinalL == 0.0f);
+
+        printf("exponential, %3u frame buffers: max jump %.4f up, %.4f down\n",
+               theBufferFrames,
+               theUp.mMaxJump,
+               theDown.mMaxJump);
+    }
+}
+
+static void TestPanSteps()
+{
+    const UInt16 theRampFrames = 512;
+
+    for(UInt32 theBufferFrames : { 14u, 100u, 512u })
+    {
+        // Hard left to hard right. With the same signal in both channels, the left output goes from
+        // 2 to 0 and the right from 0 to 2.
+        StepResponse theResponse = RunStep(MakeParams(1.0f, -100, theRampFrames, false),
+                                           MakeParams(1.0f, 100, theRampFrames, false),
+                                           theBufferFrames,
+                                           0.5f);
+
+        EFFCheck(theResponse.mMaxJump <= (2.0f * 0.5f / theRampFrames) * 1.01f);
+        EFFCheck(theResponse.mFinalL == 0.0f);
+        EFFCheck(theResponse.mFinalR == 1.0f);
+
+        // With the volume ramping at the same time.
+        StepResponse theBoth = RunStep(MakeParams(0.5f, -100, theRampFrames, false),
+                                       MakeParams(1.0f, 50, theRampFrames, false),
+                                       theBufferFrames,
+                                       0.5f);
+
+        EFFCheck(theBoth.mMaxJump <= 0.01f);
+        EFFCheck(std::fabs(theBoth.mFinalL - 0.25f) < 1.0e-6f);
+        EFFCheck(std::fabs(theBoth.mFinalR - 0.75f) < 1.0e-6f);
+    }
+}
+
+// Without a ramp, the step goes straight through, so the checks above would catch a ramp that
+// wasn't applied.
+static void TestNoRamp()
+{
+    StepResponse theResponse = RunStep(MakeParams(0.0f, 0, 0, false), MakeParams(1.0f, 0, 0, false), 100, 1.0f);
+    EFFCheck(theResponse.mMaxJump == 1.0f);
+}
+
+int main()
+{
+    TestLinearVolumeSteps();
+    TestExponentialVolumeSteps();
+    TestPanSteps();
+    TestNoRamp();
+
+    return EFF_TestHarness::Finish("EFF_ParamRampTests");
+}
+
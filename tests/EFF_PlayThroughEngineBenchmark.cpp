@@ -0,0 +1,125 @@
+//
+//  EFF_PlayThroughEngineBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Runs EFFPlayThroughEngine between simulated devices (see EFF_PlayThroughSimulation.h) for
+//  common pairs of IO buffer sizes and amounts of scheduling jitter, and prints the latency it
+//  settles at, its safety margin, the underruns, and how long each InputRT and OutputRT call takes.
+//
+//  Then runs an hour of audio with the input device's clock between 500 ppm slow and 500 ppm fast,
+//  and prints how closely the drift correction tracks it and how far the buffer level strays.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_PlayThroughSimulation.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+static const std::pair<UInt32, UInt32> kBufferSizes[] = {
+    // Input, output.
+    { 128, 128 }, { 256, 128 }, { 512, 480 }, { 512, 512 }, { 1024, 512 }
+};
+
+static const Float64 kJitterSeconds[] = { 0.0001, 0.0005, 0.002 };
+
+static const Float64 kDriftPPM[] = { -500.0, -100.0, 0.0, 100.0, 500.0 };
+
+static void BenchmarkDrift(Float64 inSeconds)
+{
+    printf("\n512/480 frame IO buffers, 0.3 ms jitter, %.0f s per run:\n", inSeconds);
+    printf("%8s %16s %22s %10s %10s %18s %8s\n",
+           "drift", "adjustment ppm", "max error >2 min ppm", "underruns", "overruns",
+           "peak deviation", "glitches");
+
+    for(Float64 thePPM : kDriftPPM)
+    {
+        EFF_PlayThroughSimulation::Config theConfig;
+        theConfig.mInputDriftPPM = thePPM;
+        theConfig.mJitterSeconds = 0.0003;
+
+        EFF_PlayThroughSimulation theSimulation(theConfig);
+        EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+        Float64 theMaxErrorPPM = 0.0;
+
+        theSimulation.RunFor(inSeconds, [&] {
+            if(theSimulation.GetNow() > 120.0)
+            {
+                theMaxErrorPPM = std::max(theMaxErrorPPM, std::fabs(theEngine.GetRateAdjustment() * 1e6 - thePPM));
+            }
+        });
+
+        printf("%+8.0f %16.2f %22.2f %10llu %10llu %11.1f frames %8llu\n",
+               thePPM,
+               theEngine.GetRateAdjustment() * 1e6,
+               theMaxErrorPPM,
+               static_cast<unsigned long long>(theEngine.GetUnderrunCount()),
+               static_cast<unsigned long long>(theEngine.GetOverrunCount()),
+               theEngine.GetPeakFillDeviation(),
+               static_cast<unsigned long long>(theSimulation.GetGlitchCount()));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const Float64 theSeconds = theQuick ? 5.0 : 300.0;
+
+    EFF_TestHarness::PinThreadToCPU(0);
+
+    printf("Stereo at 48 kHz, %.0f s per run. Latency is the mean frames buffered after each output cycle.\n",
+           theSeconds);
+    printf("%-10s %10s %12s %8s %10s %10s %12s %12s %12s %12s\n",
+           "in/out", "jitter ms", "latency ms", "safety", "underruns", "glitches",
+           "in p50 ns", "in p99 ns", "out p50 ns", "out p99 ns");
+
+    for(const auto& theSizes : kBufferSizes)
+    {
+        for(Float64 theJitter : kJitterSeconds)
+        {
+            EFF_PlayThroughSimulation::Config theConfig;
+            theConfig.mInputBufferFrames = theSizes.first;
+            theConfig.mOutputBufferFrames = theSizes.second;
+            theConfig.mJitterSeconds = theJitter;
+            theConfig.mTimeCalls = true;
+
+            EFF_PlayThroughSimulation theSimulation(theConfig);
+
+            Float64 theBufferedSum = 0.0;
+            UInt64 theCycles = 0;
+
+            theSimulation.RunFor(theSeconds, [&] {
+                theBufferedSum += theSimulation.GetEngine().GetBufferedFrames();
+                theCycles++;
+            });
+
+            const EFF_TestHarness::Stats theInputStats = EFF_TestHarness::Summarise(theSimulation.GetInputCallTimes());
+            const EFF_TestHarness::Stats theOutputStats = EFF_TestHarness::Summarise(theSimulation.GetOutputCallTimes());
+
+            printf("%4u/%-5u %10.1f %12.2f %8u %10llu %10llu %12.0f %12.0f %12.0f %12.0f\n",
+                   theSizes.first,
+                   theSizes.second,
+                   theJitter * 1000.0,
+                   theBufferedSum / std::max<UInt64>(theCycles, 1) / theConfig.mSampleRate * 1000.0,
+                   theSimulation.GetEngine().GetSafetyFrames(),
+                   static_cast<unsigned long long>(theSimulation.GetEngine().GetUnderrunCount()),
+                   static_cast<unsigned long long>(theSimulation.GetGlitchCount()),
+                   theInputStats.mP50,
+                   theInputStats.mP99,
+                   theOutputStats.mP50,
+                   theOutputStats.mP99);
+        }
+    }
+
+    BenchmarkDrift(theQuick ? 5.0 : 3600.0);
+
+    return 0;
+}
@@ -0,0 +1,308 @@
+//
+//  EFF_PlayThroughEngineTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Runs EFFPlayThroughEngine between simulated input and output devices (see
+//  EFF_PlayThroughSimulation.h). With typical scheduling jitter, the output is a continuous copy of
+//  the input once the engine has settled, with no underruns, for matched and mismatched IO buffer
+//  sizes. After a burst of heavy jitter has pushed the safety margin up, the margin decays back to
+//  an input cycle once the jitter has gone, without any glitches or underruns while it drains. With
+//  heavy jitter that doesn't go away, it keeps enough of the margin to only underrun rarely.
+//
+//  With the input device's clock up to 500 ppm fast or slow, the drift correction finds the drift
+//  and holds the buffer level, so there are no underruns, overruns or glitches at all.
+//
+//  Also checks discontinuities in the input's sample times, mismatched channel counts and the
+//  engine's handling of bad arguments.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_PlayThroughSimulation.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+static const std::pair<UInt32, UInt32> kBufferSizes[] = {
+    // Input, output.
+    { 512, 480 }, { 256, 128 }, { 1024, 512 }, { 128, 128 }, { 480, 512 }
+};
+
+// The average number of frames buffered after each output cycle over the next inSeconds.
+static Float64 AverageBufferedFrames(EFF_PlayThroughSimulation& ioSimulation, Float64 inSeconds)
+{
+    Float64 theSum = 0.0;
+    UInt64 theCycles = 0;
+
+    ioSimulation.RunFor(inSeconds, [&] {
+        theSum += ioSimulation.GetEngine().GetBufferedFrames();
+        theCycles++;
+    });
+
+    return (theCycles > 0) ? theSum / theCycles : 0.0;
+}
+
+static void TestSteadyState()
+{
+    printf("%-10s %10s %10s %14s %8s\n", "in/out", "underruns", "safety", "buffered (ms)", "glitches");
+
+    for(const auto& theSizes : kBufferSizes)
+    {
+        EFF_PlayThroughSimulation::Config theConfig;
+        theConfig.mInputBufferFrames = theSizes.first;
+        theConfig.mOutputBufferFrames = theSizes.second;
+
+        EFF_PlayThroughSimulation theSimulation(theConfig);
+        EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+        // Let the margin and the drift controller settle.
+        theSimulation.RunFor(10.0);
+
+        const UInt64 theUnderruns = theEngine.GetUnderrunCount();
+        const UInt64 theGlitches = theSimulation.GetGlitchCount();
+        const Float64 theBuffered = AverageBufferedFrames(theSimulation, 50.0);
+
+        printf("%4u/%-5u %10llu %10u %14.2f %8llu\n",
+               theSizes.first,
+               theSizes.second,
+               static_cast<unsigned long long>(theEngine.GetUnderrunCount()),
+               theEngine.GetSafetyFrames(),
+               theBuffered / theConfig.mSampleRate * 1000.0,
+               static_cast<unsigned long long>(theSimulation.GetGlitchCount()));
+
+        EFFCheck(theEngine.GetUnderrunCount() == theUnderruns);
+        EFFCheck(theEngine.GetOverrunCount() == 0);
+        EFFCheck(theSimulation.GetGlitchCount() == theGlitches);
+
+        // The output was a sine rather than silence.
+        EFFCheck(theSimulation.GetOutput()[0] != 0.0f || theSimulation.GetOutput()[1] != 0.0f);
+
+        // The latency stays within a couple of IO cycles of the least the input's cycle allows.
+        EFFCheck(theBuffered < theSizes.first + 2 * std::max(theSizes.first, theSizes.second));
+    }
+}
+
+static void TestSafetyDecay()
+{
+    for(const auto& theSizes : { std::make_pair(128u, 128u), std::make_pair(256u, 128u) })
+    {
+        EFF_PlayThroughSimulation::Config theConfig;
+        theConfig.mInputBufferFrames = theSizes.first;
+        theConfig.mOutputBufferFrames = theSizes.second;
+
+        EFF_PlayThroughSimulation theSimulation(theConfig);
+        EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+        theSimulation.RunFor(20.0);
+        EFFCheck(theEngine.GetSafetyFrames() == theSizes.first);
+
+        // A burst of heavy jitter, e.g. while the system is busy, makes the margin grow.
+        theSimulation.SetJitter(0.002);
+        theSimulation.RunFor(20.0);
+
+        const UInt32 theRaisedSafety = theEngine.GetSafetyFrames();
+        EFFCheck(theRaisedSafety > theSizes.first);
+
+        // Once it's passed, the margin and the latency come back down, smoothly.
+        theSimulation.SetJitter(0.0002);
+
+        const UInt64 theUnderruns = theEngine.GetUnderrunCount();
+        const UInt64 theGlitches = theSimulation.GetGlitchCount();
+        const Float64 theRaisedBuffered = AverageBufferedFrames(theSimulation, 30.0);
+
+        theSimulation.RunFor(270.0);
+
+        const Float64 theDecayedBuffered = AverageBufferedFrames(theSimulation, 30.0);
+
+        printf("%u/%u: safety %u -> %u, buffered %.0f -> %.0f frames\n",
+               theSizes.first,
+               theSizes.second,
+               theRaisedSafety,
+               theEngine.GetSafetyFrames(),
+               theRaisedBuffered,
+               theDecayedBuffered);
+
+        EFFCheck(theEngine.GetSafetyFrames() == theSizes.first);
+        EFFCheck(theDecayedBuffered < theRaisedBuffered - (theRaisedSafety - theSizes.first) / 2);
+        EFFCheck(theEngine.GetUnderrunCount() == theUnderruns);
+        EFFCheck(theSimulation.GetGlitchCount() == theGlitches);
+    }
+}
+
+static void TestSafetyUnderPersistentJitter()
+{
+    EFF_PlayThroughSimulation::Config theConfig;
+    theConfig.mInputBufferFrames = 128;
+    theConfig.mOutputBufferFrames = 128;
+    theConfig.mJitterSeconds = 0.002;
+
+    EFF_PlayThroughSimulation theSimulation(theConfig);
+    EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+    theSimulation.RunFor(300.0);
+    const UInt64 theUnderruns = theEngine.GetUnderrunCount();
+    theSimulation.RunFor(300.0);
+
+    printf("Persistent 2 ms jitter, 128/128: %llu underruns in the first 5 minutes, %llu in the next 5, "
+           "safety %u\n",
+           static_cast<unsigned long long>(theUnderruns),
+           static_cast<unsigned long long>(theEngine.GetUnderrunCount() - theUnderruns),
+           theEngine.GetSafetyFrames());
+
+    // The jitter still needs a bigger margin, so most of it stays.
+    EFFCheck(theEngine.GetSafetyFrames() > theConfig.mInputBufferFrames + 64);
+    EFFCheck(theEngine.GetUnderrunCount() - theUnderruns <= 3);
+}
+
+// The input device's clock running fast or slow relative to the output device's, as two real
+// devices' clocks do. Without the drift correction, the reader would underrun or overrun every
+// time the drift added up to the margin, e.g. every 20 s or so at 500 ppm.
+static void TestDrift()
+{
+    printf("%8s %16s %22s %10s %10s %18s %8s\n",
+           "drift", "adjustment ppm", "max error >2 min ppm", "underruns", "overruns",
+           "peak deviation", "glitches");
+
+    for(Float64 thePPM : { -500.0, -100.0, 0.0, 100.0, 500.0 })
+    {
+        EFF_PlayThroughSimulation::Config theConfig;
+        theConfig.mInputDriftPPM = thePPM;
+        theConfig.mJitterSeconds = 0.0003;
+
+        EFF_PlayThroughSimulation theSimulation(theConfig);
+        EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+        // Give the controller two minutes to find the drift, then track how far its estimate
+        // strays from it.
+        theSimulation.RunFor(120.0);
+
+        Float64 theMaxErrorPPM = 0.0;
+
+        theSimulation.RunFor(480.0, [&] {
+            theMaxErrorPPM = std::max(theMaxErrorPPM, std::fabs(theEngine.GetRateAdjustment() * 1e6 - thePPM));
+        });
+
+        printf("%+8.0f %16.2f %22.2f %10llu %10llu %11.1f frames %8llu\n",
+               thePPM,
+               theEngine.GetRateAdjustment() * 1e6,
+               theMaxErrorPPM,
+               static_cast<unsigned long long>(theEngine.GetUnderrunCount()),
+               static_cast<unsigned long long>(theEngine.GetOverrunCount()),
+               theEngine.GetPeakFillDeviation(),
+               static_cast<unsigned long long>(theSimulation.GetGlitchCount()));
+
+        EFFCheck(theEngine.GetUnderrunCount() == 0);
+        EFFCheck(theEngine.GetOverrunCount() == 0);
+        EFFCheck(theSimulation.GetGlitchCount() == 0);
+        EFFCheck(theMaxErrorPPM < 10.0);
+        EFFCheck(theEngine.GetPeakFillDeviation() < 100.0);
+    }
+}
+
+static void TestInputDiscontinuity()
+{
+    EFF_PlayThroughSimulation::Config theConfig;
+    EFF_PlayThroughSimulation theSimulation(theConfig);
+    EFFPlayThroughEngine& theEngine = theSimulation.GetEngine();
+
+    theSimulation.RunFor(5.0);
+
+    const UInt64 theUnderruns = theEngine.GetUnderrunCount();
+
+    // The reader starts again from the new input rather than counting the gap as an underrun or
+    // an overrun.
+    theSimulation.SkipInputSampleTime(100000);
+    theSimulation.RunFor(5.0);
+
+    EFFCheck(theEngine.GetUnderrunCount() == theUnderruns);
+    EFFCheck(theEngine.GetOverrunCount() == 0);
+    EFFCheck(theSimulation.GetOutput()[0] != 0.0f || theSimulation.GetOutput()[1] != 0.0f);
+}
+
+static void TestChannels()
+{
+    const UInt32 theFrames = 256;
+
+    EFFPlayThroughEngine theEngine;
+    theEngine.Allocate(2, theFrames, theFrames, theFrames, 48000.0);
+
+    std::vector<Float32> theInput(theFrames * 2, 0.25f);
+    std::vector<Float32> theOutput(theFrames * 4, 1.0f);
+
+    // Input with the wrong number of channels is dropped.
+    theEngine.InputRT(theInput.data(), 1, theFrames, 0.0);
+    theEngine.OutputRT(theOutput.data(), 2, theFrames);
+    EFFCheck(theOutput[0] == 0.0f);
+
+    for(UInt32 theCycle = 0; theCycle < 8; theCycle++)
+    {
+        theEngine.InputRT(theInput.data(), 2, theFrames, theCycle * theFrames);
+    }
+
+    // Channels beyond the input's are silent.
+    theEngine.OutputRT(theOutput.data(), 4, theFrames);
+
+    const UInt32 theLastFrame = theFrames - 1;
+    EFFCheck(std::fabs(theOutput[theLastFrame * 4] - 0.25f) < 1e-3f);
+    EFFCheck(std::fabs(theOutput[theLastFrame * 4 + 1] - 0.25f) < 1e-3f);
+    EFFCheck(theOutput[theLastFrame * 4 + 2] == 0.0f);
+    EFFCheck(theOutput[theLastFrame * 4 + 3] == 0.0f);
+
+    // Channels beyond the output's are dropped.
+    theEngine.InputRT(theInput.data(), 2, theFrames, 8 * theFrames);
+    theEngine.OutputRT(theOutput.data(), 1, theFrames);
+    EFFCheck(std::fabs(theOutput[theLastFrame] - 0.25f) < 1e-3f);
+
+    EFFCheck(theEngine.GetUnderrunCount() == 0);
+}
+
+static void TestInvalidArguments()
+{
+    EFFPlayThroughEngine theEngine;
+
+    bool didThrow = false;
+    try
+    {
+        theEngine.Allocate(2, 512, 512, 512, 0.0);
+    }
+    catch(const CAException&)
+    {
+        didThrow = true;
+    }
+    EFFCheck(didThrow);
+
+    // Before Allocate, and for more frames than Allocate was told about, the output is silence.
+    std::vector<Float32> theOutput(4096 * 2, 1.0f);
+    theEngine.OutputRT(theOutput.data(), 2, 512);
+    EFFCheck(theOutput[0] == 0.0f && theOutput[1023] == 0.0f);
+    EFFCheck(theEngine.GetUnderrunCount() == 1);
+
+    theEngine.Allocate(2, 512, 512, 512, 48000.0);
+    std::fill(theOutput.begin(), theOutput.end(), 1.0f);
+    theEngine.OutputRT(theOutput.data(), 2, 4096);
+    EFFCheck(theOutput[0] == 0.0f && theOutput[8191] == 0.0f);
+    EFFCheck(theEngine.GetUnderrunCount() == 1);
+}
+
+int main()
+{
+    TestSteadyState();
+    TestSafetyDecay();
+    TestSafetyUnderPersistentJitter();
+    TestDrift();
+    TestInputDiscontinuity();
+    TestChannels();
+    TestInvalidArguments();
+
+    return EFF_TestHarness::Finish("EFF_PlayThroughEngineTests");
+}
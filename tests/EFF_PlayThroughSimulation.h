@@ -0,0 +1,220 @@
+//
+//  EFF_PlayThroughSimulation.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Drives an EFFPlayThroughEngine headless, the way EFFPlayThrough's two IOProcs would, for the
+//  tests and the benchmark. Each simulated device calls the engine once per IO cycle, at the time
+//  its clock says the cycle is due plus a random scheduling delay. The input device's clock can run
+//  fast or slow relative to the output device's, and the delays can be changed mid-run.
+//
+//  The input is a 997 Hz sine, so the output should be a continuous sine (at a very slightly
+//  different frequency if the clocks drift). Any jump between consecutive output samples bigger
+//  than the sine's steepest step is counted as a glitch, which includes the silence after an
+//  underrun.
+//
+
+#ifndef EFF_PlayThroughSimulation_h
+#define EFF_PlayThroughSimulation_h
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_PlayThroughEngine.h"
+
+// STL Includes
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+class EFF_PlayThroughSimulation
+{
+
+public:
+    struct Config
+    {
+        UInt32                  mInputBufferFrames  = 512;
+        UInt32                  mOutputBufferFrames = 480;
+        UInt32                  mChannels           = 2;
+        Float64                 mSampleRate         = 48000.0;
+        // How fast the input device's clock runs relative to the output device's.
+        Float64                 mInputDriftPPM      = 0.0;
+        // The standard deviation of each IO cycle's scheduling delay.
+        Float64                 mJitterSeconds      = 0.0002;
+        unsigned                mSeed               = 1;
+        // Time each InputRT and OutputRT call.
+        bool                    mTimeCalls          = false;
+    };
+
+                                EFF_PlayThroughSimulation(const Config& inConfig)
+                                :
+                                    mConfig(inConfig),
+                                    mRandom(inConfig.mSeed),
+                                    mJitterSeconds(inConfig.mJitterSeconds),
+                                    mInputRate(inConfig.mSampleRate * (1.0 + inConfig.mInputDriftPPM * 1e-6)),
+                                    mInput(static_cast<size_t>(inConfig.mInputBufferFrames) * inConfig.mChannels),
+                                    mOutput(static_cast<size_t>(inConfig.mOutputBufferFrames) * inConfig.mChannels)
+                                {
+                                    mEngine.Allocate(mConfig.mChannels,
+                                                     mConfig.mInputBufferFrames,
+                                                     mConfig.mOutputBufferFrames,
+                                                     4096,
+                                                     mConfig.mSampleRate);
+
+                                    mNextInputCycle = mConfig.mInputBufferFrames / mInputRate;
+                                    mNextOutputCycle = mConfig.mOutputBufferFrames / mConfig.mSampleRate;
+                                    mInputLateness = NextLateness();
+                                    mOutputLateness = NextLateness();
+                                }
+
+    EFFPlayThroughEngine&       GetEngine() { return mEngine; }
+
+    /*! Change the standard deviation of the scheduling delays from now on. */
+    void                        SetJitter(Float64 inSeconds) { mJitterSeconds = inSeconds; }
+
+    /*! Skip the input's sample time forward, as if the input device had restarted. */
+    void                        SkipInputSampleTime(UInt32 inFrames) { mInputSampleTime += inFrames; }
+
+    /*!
+     Run both devices' IO cycles until the simulated time is inSeconds further on. Calls
+     inOnOutputCycle, if it's given, after each output cycle.
+     */
+    template <typename F>
+    void                        RunFor(Float64 inSeconds, F inOnOutputCycle)
+    {
+        const Float64 theEnd = mNow + inSeconds;
+
+        while(mNextOutputCycle + mOutputLateness < theEnd)
+        {
+            if(mNextInputCycle + mInputLateness <= mNextOutputCycle + mOutputLateness)
+            {
+                mNow = mNextInputCycle + mInputLateness;
+                InputCycle();
+                mNextInputCycle += mConfig.mInputBufferFrames / mInputRate;
+                mInputLateness = NextLateness();
+            }
+            else
+            {
+                mNow = mNextOutputCycle + mOutputLateness;
+                OutputCycle();
+                inOnOutputCycle();
+                mNextOutputCycle += mConfig.mOutputBufferFrames / mConfig.mSampleRate;
+                mOutputLateness = NextLateness();
+            }
+        }
+
+        mNow = theEnd;
+    }
+
+    void                        RunFor(Float64 inSeconds) { RunFor(inSeconds, [] { }); }
+
+    /*! The simulated time, in seconds. */
+    Float64                     GetNow() const { return mNow; }
+
+    UInt64                      GetGlitchCount() const { return mGlitches; }
+    UInt64                      GetOutputCycleCount() const { return mOutputCycles; }
+    const std::vector<Float32>& GetOutput() const { return mOutput; }
+
+    /*! The times of the InputRT and OutputRT calls, in ns, if Config::mTimeCalls was set. */
+    const std::vector<double>&  GetInputCallTimes() const { return mInputCallTimes; }
+    const std::vector<double>&  GetOutputCallTimes() const { return mOutputCallTimes; }
+
+private:
+    // Amplitude 0.5, so the steepest step between samples at 48 kHz is about 0.065.
+    static constexpr Float64    kToneHz             = 997.0;
+    static constexpr Float32    kGlitchThreshold    = 0.1f;
+
+    Float64                     NextLateness()
+    {
+        return std::fabs(std::normal_distribution<Float64>(0.0, 1.0)(mRandom)) * mJitterSeconds;
+    }
+
+    void                        InputCycle()
+    {
+        for(UInt32 theFrame = 0; theFrame < mConfig.mInputBufferFrames; theFrame++)
+        {
+            const Float32 theSample = static_cast<Float32>(0.5 * std::sin(2.0 * M_PI * mTonePhase));
+            mTonePhase += kToneHz / mInputRate;
+            mTonePhase -= std::floor(mTonePhase);
+
+            for(UInt32 theChannel = 0; theChannel < mConfig.mChannels; theChannel++)
+            {
+                mInput[theFrame * mConfig.mChannels + theChannel] = theSample;
+            }
+        }
+
+        const double theStart = mConfig.mTimeCalls ? EFF_TestHarness::NowSeconds() : 0.0;
+
+        mEngine.InputRT(mInput.data(),
+                        mConfig.mChannels,
+                        mConfig.mInputBufferFrames,
+                        static_cast<Float64>(mInputSampleTime));
+
+        if(mConfig.mTimeCalls)
+        {
+            mInputCallTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) * 1e9);
+        }
+
+        mInputSampleTime += mConfig.mInputBufferFrames;
+    }
+
+    void                        OutputCycle()
+    {
+        const double theStart = mConfig.mTimeCalls ? EFF_TestHarness::NowSeconds() : 0.0;
+
+        mEngine.OutputRT(mOutput.data(), mConfig.mChannels, mConfig.mOutputBufferFrames);
+
+        if(mConfig.mTimeCalls)
+        {
+            mOutputCallTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) * 1e9);
+        }
+
+        mOutputCycles++;
+
+        for(UInt32 theFrame = 0; theFrame < mConfig.mOutputBufferFrames; theFrame++)
+        {
+            const Float32 theSample = mOutput[theFrame * mConfig.mChannels];
+
+            if(mOutputStarted && std::fabs(theSample - mPreviousSample) > kGlitchThreshold)
+            {
+                mGlitches++;
+            }
+
+            mOutputStarted = mOutputStarted || (theSample != 0.0f);
+            mPreviousSample = theSample;
+        }
+    }
+
+    const Config                mConfig;
+    EFFPlayThroughEngine        mEngine;
+    std::mt19937                mRandom;
+    Float64                     mJitterSeconds;
+    const Float64               mInputRate;
+
+    Float64                     mNow                = 0.0;
+    Float64                     mNextInputCycle     = 0.0;
+    Float64                     mNextOutputCycle    = 0.0;
+    Float64                     mInputLateness      = 0.0;
+    Float64                     mOutputLateness     = 0.0;
+
+    // An arbitrary start, since the devices' sample times are unrelated.
+    SInt64                      mInputSampleTime    = 123456;
+    Float64                     mTonePhase          = 0.0;
+    std::vector<Float32>        mInput;
+    std::vector<Float32>        mOutput;
+
+    UInt64                      mOutputCycles       = 0;
+    UInt64                      mGlitches           = 0;
+    bool                        mOutputStarted      = false;
+    Float32                     mPreviousSample     = 0.0f;
+
+    std::vector<double>         mInputCallTimes;
+    std::vector<double>         mOutputCallTimes;
+
+};
+
+#endif /* EFF_PlayThroughSimulation_h */
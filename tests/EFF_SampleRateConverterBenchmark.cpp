@@ -0,0 +1,129 @@
+//
+//  EFF_SampleRateConverterBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Throughput of EFF_SampleRateConverter for each quality tier, in output frames per second and
+//  as a multiple of real time, converting stereo audio in 512 frame IO buffers. Also times the
+//  1.0 ratio with a small rate adjustment, which is how clock drift correction uses it.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_SampleRateConverter.h"
+
+// STL Includes
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+    struct Conversion
+    {
+        Float64     mInputRate;
+        Float64     mOutputRate;
+        Float64     mRateAdjustment;
+    };
+}
+
+static const UInt32 kBufferFrames = 512;
+static const UInt32 kChannels = 2;
+
+static const Conversion kConversions[] = {
+    { 44100.0, 48000.0, 0.0 },
+    { 48000.0, 44100.0, 0.0 },
+    { 96000.0, 48000.0, 0.0 },
+    { 48000.0, 48000.0, 0.0001 }
+};
+
+static const std::pair<EFF_SampleRateConverter::Quality, const char*> kTiers[] = {
+    { EFF_SampleRateConverter::kQualityLow,    "low" },
+    { EFF_SampleRateConverter::kQualityMedium, "medium" },
+    { EFF_SampleRateConverter::kQualityHigh,   "high" }
+};
+
+// Returns the time per call in ns.
+template <typename F>
+static EFF_TestHarness::Stats TimeCalls(UInt32 inRepeats, UInt32 inCalls, F inFunction)
+{
+    std::vector<double> theTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 theCall = 0; theCall < inCalls; theCall++)
+        {
+            inFunction(theCall);
+        }
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) / inCalls * 1e9);
+    }
+
+    return EFF_TestHarness::Summarise(theTimes);
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const UInt32 theRepeats = theQuick ? 3 : 20;
+    const UInt32 theCalls = theQuick ? 50 : 2000;
+
+    printf("Stereo, %u frame buffers, p50s:\n", kBufferFrames);
+    printf("%-6s %-22s %12s %14s %12s\n", "tier", "conversion", "ns/buffer", "Mframes/s", "x real time");
+
+    for(const auto& theTier : kTiers)
+    {
+        for(const Conversion& theConversion : kConversions)
+        {
+            EFF_SampleRateConverter theConverter;
+            theConverter.Allocate(kChannels,
+                                  theConversion.mInputRate,
+                                  theConversion.mOutputRate,
+                                  theTier.first,
+                                  kBufferFrames,
+                                  theConversion.mRateAdjustment);
+            theConverter.SetRateAdjustmentRT(theConversion.mRateAdjustment);
+
+            // Enough input for any call, filled with noise-like samples.
+            std::vector<Float32> theInput(theConverter.GetInputFramesNeeded(kBufferFrames) * kChannels * 2);
+            for(size_t i = 0; i < theInput.size(); i++)
+            {
+                theInput[i] = static_cast<Float32>(0.5 * std::sin(i * 0.7));
+            }
+            std::vector<Float32> theOutput(kBufferFrames * kChannels);
+
+            EFF_TestHarness::Stats theStats = TimeCalls(theRepeats, theCalls, [&] (UInt32) {
+                theConverter.ProcessRT(theInput.data(),
+                                       theConverter.GetInputFramesNeeded(kBufferFrames),
+                                       theOutput.data(),
+                                       kBufferFrames);
+                EFF_TestHarness::DoNotOptimise(theOutput[0]);
+            });
+
+            char theLabel[64];
+            snprintf(theLabel,
+                     sizeof(theLabel),
+                     theConversion.mRateAdjustment != 0.0 ? "%.0f -> %.0f %+.0f ppm" : "%.0f -> %.0f",
+                     theConversion.mInputRate,
+                     theConversion.mOutputRate,
+                     theConversion.mRateAdjustment * 1e6);
+
+            const double theFramesPerSecond = kBufferFrames / (theStats.mP50 * 1e-9);
+
+            printf("%-6s %-22s %12.0f %14.2f %12.0f\n",
+                   theTier.second,
+                   theLabel,
+                   theStats.mP50,
+                   theFramesPerSecond / 1e6,
+                   theFramesPerSecond / theConversion.mOutputRate);
+        }
+    }
+
+    return 0;
+}
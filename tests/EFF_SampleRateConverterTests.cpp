@@ -0,0 +1,297 @@
+//
+//  EFF_SampleRateConverterTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Converts sine waves with EFF_SampleRateConverter and compares the output with the ideal sine at
+//  the output rate. Checks, for each quality tier:
+//
+//   - THD+N: a sweep of tones across the passband, for upsampling and downsampling, each comes out
+//     at least the tier's attenuation below the signal.
+//   - Aliasing: tones above the output's Nyquist frequency are attenuated by at least that much.
+//
+//  Also checks that the output doesn't depend on how it's split into ProcessRT calls, that the
+//  channels are converted identically, that adjusting the rate doesn't cause a discontinuity and
+//  that passing the wrong number of input frames is rejected.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_SampleRateConverter.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+    struct Conversion
+    {
+        Float64     mInputRate;
+        Float64     mOutputRate;
+    };
+
+    struct Tier
+    {
+        EFF_SampleRateConverter::Quality mQuality;
+        const char* mName;
+        // The highest tone checked, as a fraction of the lower rate's Nyquist frequency.
+        Float64     mPassband;
+        // The THD+N and aliasing have to be at least this far below the signal, in dB.
+        Float64     mAttenuationDB;
+    };
+}
+
+static const Conversion kConversions[] = {
+    { 44100.0, 48000.0 }, { 48000.0, 44100.0 }, { 96000.0, 44100.0 }, { 48000.0, 96000.0 }
+};
+
+// The attenuations are a little short of the stopband attenuations the tiers are designed for (55,
+// 70 and 90 dB), since the passband ripple and the phase interpolation error are counted as well.
+// Upsampling from 48 to 96 kHz is the worst case for each tier.
+static const Tier kTiers[] = {
+    { EFF_SampleRateConverter::kQualityLow,    "low",    0.45, 45.0 },
+    { EFF_SampleRateConverter::kQualityMedium, "medium", 0.60, 68.0 },
+    { EFF_SampleRateConverter::kQualityHigh,   "high",   0.70, 88.0 }
+};
+
+static const Float64 kAmplitude = 0.5;
+
+// The output frames before the filter has filled with input are skipped.
+static const UInt32 kSettleFrames = 4096;
+
+// Converts one second of a stereo sine wave (the right channel inverted) in inBlockFrames output
+// frame blocks and returns the output.
+static std::vector<Float32> Convert(const Conversion& inConversion,
+                                    EFF_SampleRateConverter::Quality inQuality,
+                                    Float64 inFrequency,
+                                    UInt32 inBlockFrames)
+{
+    EFF_SampleRateConverter theConverter;
+    theConverter.Allocate(2, inConversion.mInputRate, inConversion.mOutputRate, inQuality, 4096);
+
+    const UInt32 theOutputFrames = static_cast<UInt32>(inConversion.mOutputRate);
+    std::vector<Float32> theOutput(theOutputFrames * 2);
+    std::vector<Float32> theInput;
+    UInt64 theInputPosition = 0;
+
+    for(UInt32 theDone = 0; theDone < theOutputFrames; )
+    {
+        const UInt32 theFrames = std::min(inBlockFrames, theOutputFrames - theDone);
+        const UInt32 theNeeded = theConverter.GetInputFramesNeeded(theFrames);
+        theInput.resize(theNeeded * 2);
+
+        for(UInt32 i = 0; i < theNeeded; i++)
+        {
+            const Float64 theTime = static_cast<Float64>(theInputPosition + i) / inConversion.mInputRate;
+            const Float32 theSample = static_cast<Float32>(kAmplitude * std::sin(2.0 * M_PI * inFrequency * theTime));
+            theInput[i * 2] = theSample;
+            theInput[i * 2 + 1] = -theSample;
+        }
+
+        theConverter.ProcessRT(theInput.data(), theNeeded, theOutput.data() + theDone * 2, theFrames);
+        theInputPosition += theNeeded;
+        theDone += theFrames;
+    }
+
+    return theOutput;
+}
+
+// The power of the difference between the left channel of inOutput and the ideal sine at the
+// output rate (or silence, if inExpectSilence), relative to the power of the input sine, in dB.
+static Float64 ErrorDB(const std::vector<Float32>& inOutput,
+                       const Conversion& inConversion,
+                       Float64 inFrequency,
+                       bool inExpectSilence)
+{
+    Float64 theErrorPower = 0.0;
+    Float64 theSignalPower = 0.0;
+
+    for(size_t theFrame = kSettleFrames; theFrame < inOutput.size() / 2; theFrame++)
+    {
+        const Float64 theTime = static_cast<Float64>(theFrame) / inConversion.mOutputRate;
+        const Float64 theSine = kAmplitude * std::sin(2.0 * M_PI * inFrequency * theTime);
+        const Float64 theError = inOutput[theFrame * 2] - (inExpectSilence ? 0.0 : theSine);
+
+        theErrorPower += theError * theError;
+        theSignalPower += kAmplitude * kAmplitude / 2.0;
+    }
+
+    return 10.0 * std::log10(std::max(theErrorPower, 1e-30) / theSignalPower);
+}
+
+static void TestSweeps()
+{
+    for(const Tier& theTier : kTiers)
+    {
+        for(const Conversion& theConversion : kConversions)
+        {
+            const Float64 theNyquist = std::min(theConversion.mInputRate, theConversion.mOutputRate) / 2.0;
+            Float64 theWorstDB = -1000.0;
+
+            // From 100 Hz to the top of the passband, in steps of about a third of an octave.
+            for(Float64 theFrequency = 100.0; theFrequency <= theNyquist * theTier.mPassband; theFrequency *= 1.26)
+            {
+                const std::vector<Float32> theOutput = Convert(theConversion, theTier.mQuality, theFrequency, 512);
+                theWorstDB = std::max(theWorstDB, ErrorDB(theOutput, theConversion, theFrequency, false));
+
+                // The channels get exactly the same filter.
+                bool theChannelsMatch = true;
+                for(size_t i = 0; i < theOutput.size(); i += 2)
+                {
+                    theChannelsMatch = theChannelsMatch && (theOutput[i] == -theOutput[i + 1]);
+                }
+                EFFCheck(theChannelsMatch);
+            }
+
+            printf("%-6s %6.0f -> %6.0f Hz: worst THD+N across the passband %6.1f dB\n",
+                   theTier.mName,
+                   theConversion.mInputRate,
+                   theConversion.mOutputRate,
+                   theWorstDB);
+
+            EFFCheck(theWorstDB <= -theTier.mAttenuationDB);
+        }
+    }
+}
+
+static void TestAliasing()
+{
+    // Tones between the output's Nyquist frequency and the input's, which should be filtered out
+    // rather than folded back down.
+    const struct { Conversion mConversion; Float64 mFrequency; } theCases[] = {
+        { { 48000.0, 44100.0 }, 23000.0 },
+        { { 96000.0, 44100.0 }, 30000.0 },
+        { { 96000.0, 44100.0 }, 45000.0 }
+    };
+
+    for(const Tier& theTier : kTiers)
+    {
+        for(const auto& theCase : theCases)
+        {
+            const std::vector<Float32> theOutput =
+                    Convert(theCase.mConversion, theTier.mQuality, theCase.mFrequency, 512);
+            const Float64 theAliasDB = ErrorDB(theOutput, theCase.mConversion, theCase.mFrequency, true);
+
+            printf("%-6s %6.0f -> %6.0f Hz: %5.0f Hz tone aliased at %6.1f dB\n",
+                   theTier.mName,
+                   theCase.mConversion.mInputRate,
+                   theCase.mConversion.mOutputRate,
+                   theCase.mFrequency,
+                   theAliasDB);
+
+            EFFCheck(theAliasDB <= -theTier.mAttenuationDB);
+        }
+    }
+}
+
+// The output is the same however it's split into ProcessRT calls.
+static void TestBlockSizes()
+{
+    const Conversion theConversion { 44100.0, 48000.0 };
+    const std::vector<Float32> theReference =
+            Convert(theConversion, EFF_SampleRateConverter::kQualityMedium, 1000.0, 512);
+
+    for(UInt32 theBlockFrames : { 1u, 7u, 100u, 4096u })
+    {
+        EFFCheck(Convert(theConversion, EFF_SampleRateConverter::kQualityMedium, 1000.0, theBlockFrames) ==
+                 theReference);
+    }
+}
+
+// Adjusting the rate while running, as a clock drift correction would, doesn't make the output
+// jump.
+static void TestRateAdjustment()
+{
+    EFF_SampleRateConverter theConverter;
+    theConverter.Allocate(1, 48000.0, 48000.0, EFF_SampleRateConverter::kQualityMedium, 512, 0.01);
+
+    std::vector<Float32> theInput, theOutput;
+    std::vector<Float32> theBlock(512);
+    UInt64 theInputPosition = 0;
+
+    for(UInt32 theCycle = 0; theCycle < 40; theCycle++)
+    {
+        if(theCycle == 20)
+        {
+            theConverter.SetRateAdjustmentRT(0.001);
+        }
+
+        const UInt32 theNeeded = theConverter.GetInputFramesNeeded(512);
+        theInput.resize(theNeeded);
+
+        for(UInt32 i = 0; i < theNeeded; i++)
+        {
+            theInput[i] = static_cast<Float32>(kAmplitude * std::sin(2.0 * M_PI * 440.0 * (theInputPosition + i) / 48000.0));
+        }
+
+        theConverter.ProcessRT(theInput.data(), theNeeded, theBlock.data(), 512);
+        theInputPosition += theNeeded;
+        theOutput.insert(theOutput.end(), theBlock.begin(), theBlock.end());
+    }
+
+    // Clamped to the maximum.
+    theConverter.SetRateAdjustmentRT(0.5);
+    EFFCheck(std::fabs(theConverter.GetRateAdjustment() - 0.01) < 1e-9);
+
+    // A 440 Hz sine at this amplitude changes by at most about 0.029 per frame.
+    Float32 theMaxJump = 0.0f;
+    for(size_t i = kSettleFrames + 1; i < theOutput.size(); i++)
+    {
+        theMaxJump = std::max(theMaxJump, std::fabs(theOutput[i] - theOutput[i - 1]));
+    }
+
+    EFFCheck(theMaxJump < 0.0295f);
+}
+
+static void TestWrongInputFrames()
+{
+    EFF_SampleRateConverter theConverter;
+    theConverter.Allocate(2, 44100.0, 48000.0, EFF_SampleRateConverter::kQualityLow, 512);
+
+    const UInt32 theNeeded = theConverter.GetInputFramesNeeded(512);
+    std::vector<Float32> theInput((theNeeded + 1) * 2), theOutput(512 * 2);
+
+    bool didThrow = false;
+    try
+    {
+        theConverter.ProcessRT(theInput.data(), theNeeded + 1, theOutput.data(), 512);
+    }
+    catch(const CAException&)
+    {
+        didThrow = true;
+    }
+    EFFCheck(didThrow);
+
+    // Too many output frames.
+    didThrow = false;
+    try
+    {
+        theConverter.ProcessRT(theInput.data(), theConverter.GetInputFramesNeeded(513), theOutput.data(), 513);
+    }
+    catch(const CAException&)
+    {
+        didThrow = true;
+    }
+    EFFCheck(didThrow);
+}
+
+int main()
+{
+    TestSweeps();
+    TestAliasing();
+    TestBlockSizes();
+    TestRateAdjustment();
+    TestWrongInputFrames();
+
+    return EFF_TestHarness::Finish("EFF_SampleRateConverterTests");
+}
@@ -0,0 +1,283 @@
+//
+//  EFF_StemRecorderBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Feeds EFF_StemRecorder from simulated clients the way EFF_Device's IO thread would: each
+//  512 frame cycle, every client that's playing calls CaptureClientRT, then EndCycleRT ends the
+//  cycle, paced at a multiple of real time. The clients start one after another and skip some
+//  cycles, so their tracks have gaps, and IO stops for 10 s halfway through, which should be left
+//  out of the file.
+//
+//  Prints the IO thread's CPU time per cycle for all the clients together (not counting making the
+//  test signal), the dropped frames and how long Stop took, then reads the file back and checks
+//  every sample of every track.
+//
+//  By default, 32 stereo clients record to 32 tracks at 48 kHz, 60 s of audio at 20 times real
+//  time. --clients <n>, --tracks <n>, --seconds <n> and --speed <x> change those, with a speed of
+//  0 meaning unpaced, and --dir <path> sets the disk to record to. The file is deleted afterwards.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Include
+#include "EFF_StemRecorder.h"
+
+// PublicUtility Includes
+#include "CACFDictionary.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const UInt32 kChannels = 2;
+static const Float64 kSampleRate = 48000.0;
+static const UInt32 kCycleFrames = 512;
+static const UInt32 kClientIDBase = 100;
+
+// Exact in Float32, so the file can be checked bit for bit, and never 0, so silence stands out.
+static Float32 SampleFor(UInt32 inClient, UInt64 inCycle, UInt32 inFrame, UInt32 inChannel)
+{
+    return static_cast<Float32>(1 + ((inClient * 7919 + inCycle * 977 + inFrame * 2 + inChannel) % 60000)) / 8388608.0f;
+}
+
+// Client n starts at cycle n * 3 and then skips some cycles. Since they start in order, client n
+// gets track n.
+static bool IsPlaying(UInt32 inClient, UInt64 inCycle)
+{
+    return (inCycle >= inClient * 3) && (((inCycle / (inClient + 2)) % 7) != 3);
+}
+
+static double ThreadCPUSeconds()
+{
+    timespec theTime;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &theTime);
+    return theTime.tv_sec + theTime.tv_nsec / 1e9;
+}
+
+static SInt64 GetStatusNumber(CFDictionaryRef inStatus, const char* inKey)
+{
+    CACFDictionary theStatus(inStatus, false);
+    SInt64 theNumber = 0;
+    CFStringRef theKey = CFStringCreateWithCString(kCFAllocatorDefault, inKey, kCFStringEncodingUTF8);
+    theStatus.GetSInt64(theKey, theNumber);
+    CFRelease(theKey);
+    return theNumber;
+}
+
+// Returns the number of samples in the file that aren't the ones recorded.
+static UInt64 VerifyFile(const std::string& inPath, UInt32 inClients, UInt32 inTracks, UInt64 inCycles)
+{
+    FILE* theFile = fopen(inPath.c_str(), "rb");
+    EFFCheck(theFile != nullptr);
+
+    if(!theFile)
+    {
+        return inCycles * kCycleFrames * inTracks * kChannels;
+    }
+
+    // EFF_CaptureFileWriter pads the header so the audio starts on a page boundary.
+    fseeko(theFile, 4096, SEEK_SET);
+
+    const UInt32 theFileChannels = inTracks * kChannels;
+    std::vector<Float32> theCycle(kCycleFrames * theFileChannels);
+    UInt64 theWrongSamples = 0;
+
+    for(UInt64 theCycleIndex = 0; theCycleIndex < inCycles; theCycleIndex++)
+    {
+        if(fread(theCycle.data(), sizeof(Float32) * theFileChannels, kCycleFrames, theFile) != kCycleFrames)
+        {
+            printf("The file ends early, at cycle %llu\n", static_cast<unsigned long long>(theCycleIndex));
+            theWrongSamples += (inCycles - theCycleIndex) * kCycleFrames * theFileChannels;
+            break;
+        }
+
+        for(UInt32 theTrack = 0; theTrack < inTracks; theTrack++)
+        {
+            const bool isPlaying = (theTrack < inClients) && IsPlaying(theTrack, theCycleIndex);
+
+            for(UInt32 theFrame = 0; theFrame < kCycleFrames; theFrame++)
+            {
+                for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+                {
+                    const Float32 theExpected =
+                        isPlaying ? SampleFor(theTrack, theCycleIndex, theFrame, theChannel) : 0.0f;
+
+                    if(theCycle[(theFrame * inTracks + theTrack) * kChannels + theChannel] != theExpected)
+                    {
+                        theWrongSamples++;
+                    }
+                }
+            }
+        }
+    }
+
+    // The 10 s while IO was stopped shouldn't be in the file.
+    Float32 theExtraSample;
+    EFFCheck(fread(&theExtraSample, sizeof(theExtraSample), 1, theFile) == 0);
+
+    fclose(theFile);
+
+    return theWrongSamples;
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    UInt32 theClients = 32;
+    UInt32 theTracks = 32;
+    Float64 theSeconds = theQuick ? 5.0 : 60.0;
+    Float64 theSpeed = 20.0;
+    const char* theDirectory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    for(int theArg = 1; theArg + 1 < argc; theArg++)
+    {
+        if(strcmp(argv[theArg], "--clients") == 0)
+        {
+            theClients = static_cast<UInt32>(atoi(argv[theArg + 1]));
+        }
+        else if(strcmp(argv[theArg], "--tracks") == 0)
+        {
+            theTracks = static_cast<UInt32>(atoi(argv[theArg + 1]));
+        }
+        else if(strcmp(argv[theArg], "--seconds") == 0)
+        {
+            theSeconds = atof(argv[theArg + 1]);
+        }
+        else if(strcmp(argv[theArg], "--speed") == 0)
+        {
+            theSpeed = atof(argv[theArg + 1]);
+        }
+        else if(strcmp(argv[theArg], "--dir") == 0)
+        {
+            theDirectory = argv[theArg + 1];
+        }
+    }
+
+    const std::string thePath =
+        std::string(theDirectory) + "/EFF_StemRecorderBenchmark." + std::to_string(getpid()) + ".wav";
+    CFStringRef thePathString = CFStringCreateWithCString(kCFAllocatorDefault,
+                                                          thePath.c_str(),
+                                                          kCFStringEncodingUTF8);
+
+    printf("%u stereo clients, %u tracks, %.0f kHz, %u frame cycles, %.0f s of audio at %.0fx real time, to %s\n",
+           theClients, theTracks, kSampleRate / 1000.0, kCycleFrames, theSeconds, theSpeed, thePath.c_str());
+
+    EFF_StemRecorder theRecorder;
+    theRecorder.Start(thePathString,
+                      kEFFRecordingFileFormatWAV,
+                      kEFFRecordingSampleFormatFloat32,
+                      theTracks,
+                      kChannels,
+                      kSampleRate);
+
+    const UInt64 theCycles = static_cast<UInt64>(theSeconds * kSampleRate / kCycleFrames);
+    std::vector<Float32> theBuffer(kCycleFrames * kChannels);
+    std::vector<double> theCycleCPUTimes;
+    theCycleCPUTimes.reserve(theCycles);
+    Float64 theSampleTime = 123456.0;
+
+    const auto theStart = std::chrono::steady_clock::now();
+
+    for(UInt64 theCycle = 0; theCycle < theCycles; theCycle++)
+    {
+        double theCPUTime = 0.0;
+
+        for(UInt32 theClient = 0; theClient < theClients; theClient++)
+        {
+            if(!IsPlaying(theClient, theCycle))
+            {
+                continue;
+            }
+
+            for(UInt32 theFrame = 0; theFrame < kCycleFrames; theFrame++)
+            {
+                for(UInt32 theChannel = 0; theChannel < kChannels; theChannel++)
+                {
+                    theBuffer[theFrame * kChannels + theChannel] = SampleFor(theClient, theCycle, theFrame, theChannel);
+                }
+            }
+
+            const double theCaptureStart = ThreadCPUSeconds();
+            theRecorder.CaptureClientRT(kClientIDBase + theClient, theBuffer.data(), kCycleFrames, theSampleTime);
+            theCPUTime += ThreadCPUSeconds() - theCaptureStart;
+        }
+
+        const double theEndStart = ThreadCPUSeconds();
+        theRecorder.EndCycleRT(kCycleFrames, theSampleTime);
+        theCPUTime += ThreadCPUSeconds() - theEndStart;
+
+        theCycleCPUTimes.push_back(theCPUTime * 1e9);
+
+        theSampleTime += kCycleFrames;
+
+        // IO stops for 10 s.
+        if(theCycle == theCycles / 2)
+        {
+            theSampleTime += 10.0 * kSampleRate;
+        }
+
+        if(theSpeed > 0.0)
+        {
+            std::this_thread::sleep_until(
+                theStart + std::chrono::duration<double>((theCycle + 1) * kCycleFrames / kSampleRate / theSpeed));
+        }
+    }
+
+    const double theStopStart = EFF_TestHarness::NowSeconds();
+    theRecorder.Stop();
+    const double theStopSeconds = EFF_TestHarness::NowSeconds() - theStopStart;
+    const double theWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - theStart).count();
+
+    CFDictionaryRef theStatus = theRecorder.CopyStatusAsDictionary();
+    const SInt64 theDroppedFrames = GetStatusNumber(theStatus, kEFFRecordingKey_DroppedFrames);
+    const SInt64 theUntrackedBuffers = GetStatusNumber(theStatus, kEFFStemRecordingKey_UntrackedBuffers);
+    CFRelease(theStatus);
+
+    const EFF_TestHarness::Stats theStats = EFF_TestHarness::Summarise(theCycleCPUTimes);
+
+    printf("%10s %14s %10s %16s %12s %14s %14s %14s\n",
+           "wall s", "x real time", "stop s", "dropped frames", "untracked",
+           "cycle p50 ns", "cycle p99 ns", "cycle max ns");
+    printf("%10.1f %14.1f %10.2f %16lld %12lld %14.0f %14.0f %14.0f\n",
+           theWall,
+           theSeconds / theWall,
+           theStopSeconds,
+           static_cast<long long>(theDroppedFrames),
+           static_cast<long long>(theUntrackedBuffers),
+           theStats.mP50,
+           theStats.mP99,
+           theStats.mMax);
+
+    // Only paced runs should keep up. Unpaced ones show how the recorder degrades.
+    if(theSpeed > 0.0)
+    {
+        EFFCheck(theDroppedFrames == 0);
+    }
+
+    if(theDroppedFrames == 0)
+    {
+        const UInt64 theWrongSamples = VerifyFile(thePath, theClients, theTracks, theCycles);
+        printf("%llu wrong samples\n", static_cast<unsigned long long>(theWrongSamples));
+        EFFCheck(theWrongSamples == 0);
+    }
+
+    unlink(thePath.c_str());
+    CFRelease(thePathString);
+
+    return EFF_TestHarness::Finish("EFF_StemRecorderBenchmark");
+}
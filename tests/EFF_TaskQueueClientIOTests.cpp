@@ -0,0 +1,347 @@
+//
+//  EFF_TaskQueueClientIOTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests that EFF_TaskQueue only skips the async client IO state requests that can't change
+//  anything. Runs the HAL's StartIO, BeginIOOperation, EndIOOperation and StopIO sequence through
+//  EFF_Device and checks the queued and skipped counts it reports in
+//  kAudioDeviceCustomPropertyIOStats. Then, on a task queue of its own with the worker thread held
+//  up, checks clients whose IDs share an entry in the queue's table, a client started, stopped and
+//  started again before the worker gets to any of it, and a request dropped because the queue was
+//  full, which mustn't be skipped when it's made again.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_TaskQueue.h"
+#include "EFF_Clients.h"
+#include "EFF_Client.h"
+#include "EFF_Device.h"
+#include "EFF_PlugIn.h"
+#include "EFF_Types.h"
+
+// STL Includes
+#include <atomic>
+#include <thread>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <unistd.h>
+
+
+// Property notifications for this selector hold up the non-real-time worker thread until
+// sReleaseWorker is set.
+static const AudioObjectPropertySelector kHoldWorkerSelector = 'hold';
+static std::atomic<bool> sWorkerIsHeld { false };
+static std::atomic<bool> sReleaseWorker { false };
+
+static OSStatus Host_PropertiesChanged(AudioServerPlugInHostRef,
+                                       AudioObjectID,
+                                       UInt32 inNumberAddresses,
+                                       const AudioObjectPropertyAddress* inAddresses)
+{
+    if(inNumberAddresses == 1 && inAddresses[0].mSelector == kHoldWorkerSelector)
+    {
+        sWorkerIsHeld = true;
+
+        while(!sReleaseWorker)
+        {
+            std::this_thread::yield();
+        }
+
+        sWorkerIsHeld = false;
+    }
+
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_CopyFromStorage(AudioServerPlugInHostRef, CFStringRef, CFPropertyListRef* outData)
+{
+    *outData = nullptr;
+    return kAudioHardwareUnspecifiedError;
+}
+
+static OSStatus Host_WriteToStorage(AudioServerPlugInHostRef, CFStringRef, CFPropertyListRef)
+{
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_DeleteFromStorage(AudioServerPlugInHostRef, CFStringRef)
+{
+    return kAudioHardwareNoError;
+}
+
+static OSStatus Host_RequestDeviceConfigurationChange(AudioServerPlugInHostRef, AudioObjectID, UInt64, void*)
+{
+    return kAudioHardwareNoError;
+}
+
+static const AudioServerPlugInHostInterface kHost = {
+    Host_PropertiesChanged,
+    Host_CopyFromStorage,
+    Host_WriteToStorage,
+    Host_DeleteFromStorage,
+    Host_RequestDeviceConfigurationChange
+};
+
+static AudioServerPlugInClientInfo ClientInfo(UInt32 inClientID)
+{
+    AudioServerPlugInClientInfo theClientInfo = {};
+    theClientInfo.mClientID = inClientID;
+    theClientInfo.mProcessID = static_cast<pid_t>(100000 + inClientID);
+    theClientInfo.mIsNativeEndian = true;
+    theClientInfo.mBundleID = nullptr;
+    return theClientInfo;
+}
+
+static bool IsDoingIO(const EFF_Clients& inClients, UInt32 inClientID)
+{
+    EFF_Client theClient;
+    return inClients.GetClientNonRT(inClientID, &theClient) && theClient.mDoingIO;
+}
+
+#pragma mark EFF_Device
+
+static UInt64 GetIOStatsCounter(EFF_Device& inDevice, const char* inKey)
+{
+    const AudioObjectPropertyAddress theAddress = {
+        kAudioDeviceCustomPropertyIOStats,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+
+    CFDictionaryRef theIOStats = nullptr;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(kObjectID_Device,
+                             getpid(),
+                             theAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFDictionaryRef),
+                             theSize,
+                             &theIOStats);
+
+    CFStringRef theKey = CFStringCreateWithCString(kCFAllocatorDefault, inKey, kCFStringEncodingUTF8);
+    CFNumberRef theNumber = static_cast<CFNumberRef>(CFDictionaryGetValue(theIOStats, theKey));
+
+    SInt64 theValue = -1;
+    EFFCheck(theNumber != nullptr && CFNumberGetValue(theNumber, kCFNumberSInt64Type, &theValue));
+
+    CFRelease(theKey);
+    CFRelease(theIOStats);
+    return static_cast<UInt64>(theValue);
+}
+
+// The HAL calls StartIO and StopIO for the first and last clients to start and stop, and
+// Begin/EndIOOperation with kAudioServerPlugInIOOperationThread for every client. So in each IO
+// session, the first client's BeginIOOperation is redundant and the rest aren't.
+static void TestDeviceCounts()
+{
+    const UInt32 kFirstClientID = 9001;
+    const UInt32 kSecondClientID = 9002;
+    const UInt32 kSessions = 50;
+
+    EFF_Device& theDevice = EFF_Device::GetInstance();
+
+    AudioServerPlugInClientInfo theFirstClient = ClientInfo(kFirstClientID);
+    AudioServerPlugInClientInfo theSecondClient = ClientInfo(kSecondClientID);
+    theDevice.AddClient(&theFirstClient);
+    theDevice.AddClient(&theSecondClient);
+
+    const UInt64 theQueuedBefore = GetIOStatsCounter(theDevice, kEFFIOStatsKey_ClientIOTasksQueued);
+    const UInt64 theSkippedBefore = GetIOStatsCounter(theDevice, kEFFIOStatsKey_ClientIOTasksSkipped);
+
+    AudioServerPlugInIOCycleInfo theCycleInfo = {};
+
+    for(UInt32 theSession = 0; theSession < kSessions; theSession++)
+    {
+        theDevice.StartIO(kFirstClientID);
+        theDevice.BeginIOOperation(kAudioServerPlugInIOOperationThread, 512, theCycleInfo, kFirstClientID);
+        theDevice.BeginIOOperation(kAudioServerPlugInIOOperationThread, 512, theCycleInfo, kSecondClientID);
+        theDevice.EndIOOperation(kAudioServerPlugInIOOperationThread, 512, theCycleInfo, kSecondClientID);
+        theDevice.EndIOOperation(kAudioServerPlugInIOOperationThread, 512, theCycleInfo, kFirstClientID);
+        // Sync, so the worker thread has finished the session's async tasks when it returns.
+        theDevice.StopIO(kFirstClientID);
+    }
+
+    EFFCheck(GetIOStatsCounter(theDevice, kEFFIOStatsKey_ClientIOTasksQueued) - theQueuedBefore == 3 * kSessions);
+    EFFCheck(GetIOStatsCounter(theDevice, kEFFIOStatsKey_ClientIOTasksSkipped) - theSkippedBefore == kSessions);
+
+    theDevice.RemoveClient(&theSecondClient);
+    theDevice.RemoveClient(&theFirstClient);
+}
+
+#pragma mark EFF_TaskQueue
+
+// The queue's table has 256 entries and hashes by multiplying, so IDs 256 apart share an entry.
+static const UInt32 kClientID = 10;
+static const UInt32 kCollidingClientID = kClientID + 256;
+// Never added, so the sync tasks for it just wait for the worker thread to finish the tasks
+// queued before them.
+static const UInt32 kDrainClientID = 11;
+
+static void Drain(EFF_TaskQueue& inTaskQueue, EFF_Clients& inClients)
+{
+    inTaskQueue.QueueSync_StopClientIO(&inClients, kDrainClientID);
+}
+
+static void HoldWorker(EFF_TaskQueue& inTaskQueue)
+{
+    sReleaseWorker = false;
+    inTaskQueue.QueueAsync_SendPropertyNotification(kHoldWorkerSelector, kObjectID_Device);
+
+    while(!sWorkerIsHeld)
+    {
+        std::this_thread::yield();
+    }
+}
+
+static void ReleaseWorker()
+{
+    sReleaseWorker = true;
+}
+
+static void TestSteadyState(EFF_TaskQueue& inTaskQueue, EFF_Clients& inClients)
+{
+    // The same sequence as TestDeviceCounts, for one client.
+    UInt32 theQueued = 0, theSkipped = 0;
+
+    for(UInt32 theSession = 0; theSession < 100; theSession++)
+    {
+        inTaskQueue.QueueSync_StartClientIO(&inClients, kClientID);
+        (inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID) ? theQueued : theSkipped)++;
+        (inTaskQueue.QueueAsync_StopClientIO(&inClients, kClientID) ? theQueued : theSkipped)++;
+        inTaskQueue.QueueSync_StopClientIO(&inClients, kClientID);
+    }
+
+    EFFCheck(theQueued == 100);
+    EFFCheck(theSkipped == 100);
+    EFFCheck(!IsDoingIO(inClients, kClientID));
+}
+
+static void TestCollisions(EFF_TaskQueue& inTaskQueue, EFF_Clients& inClients)
+{
+    // The two clients take the entry from each other, so their requests can't be skipped, but they
+    // still have to end up in the right states.
+    for(UInt32 theSession = 0; theSession < 100; theSession++)
+    {
+        inTaskQueue.QueueSync_StartClientIO(&inClients, kClientID);
+        inTaskQueue.QueueSync_StartClientIO(&inClients, kCollidingClientID);
+        EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+        EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kCollidingClientID));
+        inTaskQueue.QueueAsync_StopClientIO(&inClients, kClientID);
+        Drain(inTaskQueue, inClients);
+
+        EFFCheck(!IsDoingIO(inClients, kClientID));
+        EFFCheck(IsDoingIO(inClients, kCollidingClientID));
+
+        inTaskQueue.QueueSync_StopClientIO(&inClients, kCollidingClientID);
+        EFFCheck(!IsDoingIO(inClients, kCollidingClientID));
+    }
+
+    // While one client's task is outstanding, the other's are queued without taking the entry.
+    HoldWorker(inTaskQueue);
+
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kCollidingClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kCollidingClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StopClientIO(&inClients, kCollidingClientID));
+
+    ReleaseWorker();
+    Drain(inTaskQueue, inClients);
+
+    EFFCheck(IsDoingIO(inClients, kClientID));
+    EFFCheck(!IsDoingIO(inClients, kCollidingClientID));
+
+    // The first client kept the entry, so its next redundant request is skipped.
+    EFFCheck(!inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+
+    inTaskQueue.QueueSync_StopClientIO(&inClients, kClientID);
+}
+
+static void TestChangesWithinOneDrain(EFF_TaskQueue& inTaskQueue, EFF_Clients& inClients)
+{
+    EFFCheck(!IsDoingIO(inClients, kClientID));
+
+    // None of these can be skipped before the worker thread has applied the earlier ones, even the
+    // last, which repeats the one before it.
+    HoldWorker(inTaskQueue);
+
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StopClientIO(&inClients, kClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+
+    ReleaseWorker();
+    Drain(inTaskQueue, inClients);
+
+    EFFCheck(IsDoingIO(inClients, kClientID));
+
+    // Now the state is applied and nothing's outstanding, a repeat is skipped and a change isn't.
+    EFFCheck(!inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+    EFFCheck(inTaskQueue.QueueAsync_StopClientIO(&inClients, kClientID));
+    Drain(inTaskQueue, inClients);
+
+    EFFCheck(!IsDoingIO(inClients, kClientID));
+    EFFCheck(!inTaskQueue.QueueAsync_StopClientIO(&inClients, kClientID));
+}
+
+static void TestRetryAfterQueueFull(EFF_TaskQueue& inTaskQueue, EFF_Clients& inClients)
+{
+    EFFCheck(!IsDoingIO(inClients, kClientID));
+
+    // Fill the queue. It only holds 512 tasks, so the rest of the notifications are dropped.
+    HoldWorker(inTaskQueue);
+
+    for(UInt32 i = 0; i < 1000; i++)
+    {
+        inTaskQueue.QueueAsync_SendPropertyNotification(kAudioDevicePropertyDeviceIsRunning, kObjectID_Device);
+    }
+
+    // Dropped, so the client doesn't start, but it must not be remembered as requested.
+    EFFCheck(!inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+
+    ReleaseWorker();
+    Drain(inTaskQueue, inClients);
+
+    EFFCheck(!IsDoingIO(inClients, kClientID));
+
+    // The HAL makes the request again next time, and this time it's queued.
+    EFFCheck(inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+    Drain(inTaskQueue, inClients);
+
+    EFFCheck(IsDoingIO(inClients, kClientID));
+    EFFCheck(!inTaskQueue.QueueAsync_StartClientIO(&inClients, kClientID));
+
+    inTaskQueue.QueueSync_StopClientIO(&inClients, kClientID);
+}
+
+int main()
+{
+    EFF_PlugIn::SetHost(&kHost);
+
+    TestDeviceCounts();
+
+    {
+        EFF_TaskQueue theTaskQueue;
+        EFF_Clients theClients(kObjectID_Device);
+
+        AudioServerPlugInClientInfo theClientInfo = ClientInfo(kClientID);
+        AudioServerPlugInClientInfo theCollidingClientInfo = ClientInfo(kCollidingClientID);
+        theClients.AddClient(EFF_Client(&theClientInfo));
+        theClients.AddClient(EFF_Client(&theCollidingClientInfo));
+
+        TestSteadyState(theTaskQueue, theClients);
+        TestCollisions(theTaskQueue, theClients);
+        TestChangesWithinOneDrain(theTaskQueue, theClients);
+        TestRetryAfterQueueFull(theTaskQueue, theClients);
+    }
+
+    return EFF_TestHarness::Finish("EFF_TaskQueueClientIOTests");
+}
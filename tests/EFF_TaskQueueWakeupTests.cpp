@@ -0,0 +1,253 @@
+//
+//  EFF_TaskQueueWakeupTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests EFF_BoundedMPSCQueue and EFF_Semaphore, and stress-tests the way EFF_TaskQueue uses them
+//  to wake its worker threads: several producers push tasks, only signalling the semaphore if the
+//  worker has said it's about to wait, while the worker pops them. No task should be lost or
+//  reordered within a producer, and the worker should never sleep with tasks in the queue.
+//
+//  EFF_TaskQueue itself needs CAPThread and the rest of the driver, so the producer and worker
+//  loops here are copies of EFF_TaskQueue::TryPush, WakeWorkerIfWaiting and WorkerThreadProc. Keep
+//  them in sync.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+
+// Unit Includes
+#include "EFF_BoundedMPSCQueue.h"
+#include "EFF_Semaphore.h"
+
+// STL Includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+static void TestQueue()
+{
+    EFF_BoundedMPSCQueue<UInt32, 4> theQueue;
+    UInt32 theValue = 0;
+
+    EFFCheck(theQueue.IsEmpty());
+    EFFCheck(!theQueue.TryPop(theValue));
+
+    // Fill it, go around a few times, and check it stays FIFO.
+    UInt32 theNextPush = 0, theNextPop = 0;
+
+    for(UInt32 theRound = 0; theRound < 10; theRound++)
+    {
+        while(theQueue.TryPush(theNextPush))
+        {
+            theNextPush++;
+        }
+
+        EFFCheck(theNextPush - theNextPop == 4);
+        EFFCheck(!theQueue.IsEmpty());
+
+        for(UInt32 i = 0; i < 3; i++)
+        {
+            EFFCheck(theQueue.TryPop(theValue));
+            EFFCheck(theValue == theNextPop);
+            theNextPop++;
+        }
+    }
+
+    while(theQueue.TryPop(theValue))
+    {
+        EFFCheck(theValue == theNextPop);
+        theNextPop++;
+    }
+
+    EFFCheck(theNextPop == theNextPush);
+    EFFCheck(theQueue.IsEmpty());
+}
+
+static void TestSemaphore()
+{
+    EFF_Semaphore theSemaphore;
+
+    // Signals before the wait aren't lost, and they're counted.
+    theSemaphore.Signal();
+    theSemaphore.Signal();
+    theSemaphore.Wait();
+    theSemaphore.Wait();
+
+    // A signal from another thread wakes a waiting thread.
+    std::atomic<bool> theDidWake { false };
+    std::thread theWaiter([&] {
+        theSemaphore.Wait();
+        theDidWake = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EFFCheck(!theDidWake);
+    theSemaphore.Signal();
+    theWaiter.join();
+    EFFCheck(theDidWake);
+}
+
+namespace
+{
+    struct Task
+    {
+        UInt32                  mProducer   = 0;
+        UInt64                  mSequence   = 0;
+        double                  mPushTime   = 0.0;
+    };
+
+    struct WorkerQueue
+    {
+        EFF_BoundedMPSCQueue<Task, 512> mTasks;
+        EFF_Semaphore           mWorkQueuedSemaphore;
+        std::atomic<bool>       mWorkerIsWaiting    { false };
+        std::atomic<UInt64>     mSignals            { 0 };
+    };
+
+    // EFF_TaskQueue::TryPush and WakeWorkerIfWaiting.
+    bool TryPush(WorkerQueue& inQueue, const Task& inTask)
+    {
+        if(!inQueue.mTasks.TryPush(inTask))
+        {
+            return false;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if(inQueue.mWorkerIsWaiting.exchange(false, std::memory_order_relaxed))
+        {
+            inQueue.mSignals.fetch_add(1, std::memory_order_relaxed);
+            inQueue.mWorkQueuedSemaphore.Signal();
+        }
+
+        return true;
+    }
+}
+
+// inProducers threads each push inTasksPerProducer tasks, in bursts with pauses between so the
+// worker keeps going to sleep and being woken.
+static void TestWakeups(UInt32 inProducers, UInt64 inTasksPerProducer)
+{
+    WorkerQueue theQueue;
+    std::vector<UInt64> theLastSequences(inProducers, 0);
+    std::vector<double> theLatencies;
+    std::atomic<UInt64> theFullCount { 0 };
+    // Only written by the worker. Atomic so this thread can watch it while waiting for the worker.
+    std::atomic<UInt64> theReceived { 0 };
+    UInt64 theOutOfOrder = 0;
+    const UInt64 theTotal = inProducers * inTasksPerProducer;
+
+    theLatencies.reserve(theTotal);
+
+    // EFF_TaskQueue::WorkerThreadProc. Stops after it's received every task.
+    std::thread theWorker([&] {
+        while(theReceived.load(std::memory_order_relaxed) < theTotal)
+        {
+            Task theTask;
+
+            if(theQueue.mTasks.TryPop(theTask))
+            {
+                theOutOfOrder += (theTask.mSequence != theLastSequences[theTask.mProducer] + 1);
+                theLastSequences[theTask.mProducer] = theTask.mSequence;
+                theLatencies.push_back((EFF_TestHarness::NowSeconds() - theTask.mPushTime) * 1e6);
+                theReceived.store(theReceived.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                continue;
+            }
+
+            theQueue.mWorkerIsWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if(!theQueue.mTasks.IsEmpty())
+            {
+                theQueue.mWorkerIsWaiting.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            theQueue.mWorkQueuedSemaphore.Wait();
+        }
+    });
+
+    std::vector<std::thread> theProducers;
+
+    for(UInt32 theProducer = 0; theProducer < inProducers; theProducer++)
+    {
+        theProducers.emplace_back([&, theProducer] {
+            for(UInt64 theSequence = 1; theSequence <= inTasksPerProducer; theSequence++)
+            {
+                Task theTask { theProducer, theSequence, EFF_TestHarness::NowSeconds() };
+
+                // Like EFF_TaskQueue::Push, which is what sync tasks use. (The async tasks would be
+                // dropped instead.)
+                while(!TryPush(theQueue, theTask))
+                {
+                    theFullCount.fetch_add(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+
+                if(theSequence % 64 == 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        });
+    }
+
+    for(std::thread& theProducer : theProducers)
+    {
+        theProducer.join();
+    }
+
+    // If a wakeup were lost, the worker would still be waiting with tasks in the queue. Give it
+    // plenty of time before deciding it's stuck.
+    double theDeadline = EFF_TestHarness::NowSeconds() + 10.0;
+
+    while(theReceived.load(std::memory_order_relaxed) < theTotal && EFF_TestHarness::NowSeconds() < theDeadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    bool theWorkerIsStuck = (theReceived.load(std::memory_order_relaxed) < theTotal);
+
+    if(theWorkerIsStuck)
+    {
+        // Unstick it so it can be joined, and fail.
+        theQueue.mWorkQueuedSemaphore.Signal();
+    }
+
+    theWorker.join();
+
+    EFF_TestHarness::Stats theLatency = EFF_TestHarness::Summarise(theLatencies);
+
+    printf("%u producers, %llu tasks: %llu out of order, %llu signals, %llu pushes to a full queue, "
+           "push to pop p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           inProducers,
+           static_cast<unsigned long long>(theTotal),
+           static_cast<unsigned long long>(theOutOfOrder),
+           static_cast<unsigned long long>(theQueue.mSignals.load()),
+           static_cast<unsigned long long>(theFullCount.load()),
+           theLatency.mP50,
+           theLatency.mP99,
+           theLatency.mMax);
+
+    EFFCheck(!theWorkerIsStuck);
+    EFFCheck(theReceived.load() == theTotal);
+    EFFCheck(theOutOfOrder == 0);
+    // Signals are only sent when the worker is waiting, which is at most once per task.
+    EFFCheck(theQueue.mSignals.load() <= theTotal);
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+
+    TestQueue();
+    TestSemaphore();
+    TestWakeups(1, theQuick ? 10000 : 100000);
+    TestWakeups(6, theQuick ? 10000 : 50000);
+
+    return EFF_TestHarness::Finish("EFF_TaskQueueWakeupTests");
+}
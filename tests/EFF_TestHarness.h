@@ -0,0 +1,155 @@
+//
+//  EFF_TestHarness.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  The little the test and benchmark programs share: check macros that count failures instead of
+//  stopping, a clock, summary statistics and thread pinning.
+//
+//  Each test is a standalone program that returns non-zero if any check failed. Each benchmark
+//  takes an optional "--quick" argument, which CTest passes so the benchmarks are also run (briefly)
+//  as smoke tests. Run them without it for the numbers.
+//
+
+#ifndef EFF_TestHarness_h
+#define EFF_TestHarness_h
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// System Includes
+#include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+
+namespace EFF_TestHarness
+{
+    inline int& FailureCount()
+    {
+        static int sFailures = 0;
+        return sFailures;
+    }
+
+    inline void Fail(const char* inFile, int inLine, const char* inExpression)
+    {
+        // Don't flood the output if a check fails in a loop.
+        if(FailureCount()++ < 20)
+        {
+            fprintf(stderr, "%s:%d: check failed: %s\n", inFile, inLine, inExpression);
+        }
+    }
+
+    // The test's exit status.
+    inline int Finish(const char* inName)
+    {
+        if(FailureCount() == 0)
+        {
+            printf("%s: passed\n", inName);
+            return 0;
+        }
+
+        printf("%s: %d check(s) failed\n", inName, FailureCount());
+        return 1;
+    }
+
+    inline bool IsQuick(int argc, char* const argv[])
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--quick") == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline double NowSeconds()
+    {
+        using namespace std::chrono;
+        return duration<double>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Summary statistics of a set of samples, e.g. per-cycle times.
+    struct Stats
+    {
+        double                  mMean       = 0;
+        double                  mP50        = 0;
+        double                  mP99        = 0;
+        double                  mMax        = 0;
+    };
+
+    inline Stats Summarise(std::vector<double> inSamples)
+    {
+        Stats theStats;
+
+        if(inSamples.empty())
+        {
+            return theStats;
+        }
+
+        std::sort(inSamples.begin(), inSamples.end());
+
+        double theSum = 0;
+        for(double theSample : inSamples)
+        {
+            theSum += theSample;
+        }
+
+        theStats.mMean = theSum / inSamples.size();
+        theStats.mP50 = inSamples[inSamples.size() / 2];
+        theStats.mP99 = inSamples[std::min(inSamples.size() - 1, inSamples.size() * 99 / 100)];
+        theStats.mMax = inSamples.back();
+
+        return theStats;
+    }
+
+    // Pin the calling thread to a CPU, if the host supports it and has that CPU. Returns false if it
+    // couldn't.
+    inline bool PinThreadToCPU(unsigned inCPU)
+    {
+#if defined(__linux__)
+        if(inCPU >= static_cast<unsigned>(sysconf(_SC_NPROCESSORS_ONLN)))
+        {
+            return false;
+        }
+
+        cpu_set_t theSet;
+        CPU_ZERO(&theSet);
+        CPU_SET(inCPU, &theSet);
+        return pthread_setaffinity_np(pthread_self(), sizeof(theSet), &theSet) == 0;
+#else
+        // macOS only has affinity hints, which don't guarantee anything.
+        (void)inCPU;
+        return false;
+#endif
+    }
+
+    // Stops the compiler from optimising away a benchmark's result.
+    template<typename T>
+    inline void DoNotOptimise(const T& inValue)
+    {
+        asm volatile("" : : "r,m"(inValue) : "memory");
+    }
+}
+
+#define EFFCheck(inCondition)                                                           \
+    do                                                                                  \
+    {                                                                                   \
+        if(!(inCondition))                                                              \
+        {                                                                               \
+            EFF_TestHarness::Fail(__FILE__, __LINE__, #inCondition);                    \
+        }                                                                               \
+    } while(0)
+
+#endif /* EFF_TestHarness_h */
+
@@ -0,0 +1,151 @@
+//
+//  EFF_VolumeCurveBenchmark.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Conversion throughput of EFF_VolumeCurve's lookup tables against the CAVolumeCurve they're
+//  generated from, for the app volume curve (one range) and a curve with three ranges. Also times
+//  generating the tables, which happens each time a curve is changed.
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_Types.h"
+
+// Unit Include
+#include "EFF_VolumeCurve.h"
+
+// STL Includes
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+    struct Range
+    {
+        SInt32  mMinRaw;
+        SInt32  mMaxRaw;
+        Float32 mMinDB;
+        Float32 mMaxDB;
+    };
+}
+
+// Returns the time per conversion in ns.
+template <typename F>
+static EFF_TestHarness::Stats TimeConversions(UInt32 inRepeats, UInt32 inConversions, F inConvert)
+{
+    std::vector<double> theTimes;
+
+    for(UInt32 theRepeat = 0; theRepeat < inRepeats; theRepeat++)
+    {
+        double theStart = EFF_TestHarness::NowSeconds();
+
+        for(UInt32 i = 0; i < inConversions; i++)
+        {
+            inConvert(i);
+        }
+
+        theTimes.push_back((EFF_TestHarness::NowSeconds() - theStart) / inConversions * 1e9);
+    }
+
+    return EFF_TestHarness::Summarise(theTimes);
+}
+
+template <typename Curve>
+static void MakeCurve(const std::vector<Range>& inRanges, Curve& outCurve)
+{
+    for(const Range& theRange : inRanges)
+    {
+        outCurve.AddRange(theRange.mMinRaw, theRange.mMaxRaw, theRange.mMinDB, theRange.mMaxDB);
+    }
+
+    outCurve.SetTransferFunction(CAVolumeCurve::kPow2Over1Curve);
+}
+
+template <typename Curve>
+static void TimeCurve(const char* inLabel,
+                      const Curve& inCurve,
+                      UInt32 inRepeats,
+                      UInt32 inConversions)
+{
+    const SInt32 theMinRaw = inCurve.GetMinimumRaw();
+    const UInt32 theRawCount = static_cast<UInt32>(inCurve.GetMaximumRaw() - theMinRaw) + 1;
+
+    // Pseudo-random scalar volumes, so the binary search's branches aren't predictable.
+    std::vector<Float32> theScalars(1024);
+    UInt32 theSeed = 12345;
+    for(Float32& theScalar : theScalars)
+    {
+        theSeed = theSeed * 1664525 + 1013904223;
+        theScalar = static_cast<Float32>(theSeed >> 8) / static_cast<Float32>(1 << 24);
+    }
+
+    EFF_TestHarness::Stats theRawToScalar = TimeConversions(inRepeats, inConversions, [&] (UInt32 i) {
+        EFF_TestHarness::DoNotOptimise(inCurve.ConvertRawToScalar(theMinRaw + static_cast<SInt32>(i % theRawCount)));
+    });
+
+    EFF_TestHarness::Stats theRawToDB = TimeConversions(inRepeats, inConversions, [&] (UInt32 i) {
+        EFF_TestHarness::DoNotOptimise(inCurve.ConvertRawToDB(theMinRaw + static_cast<SInt32>(i % theRawCount)));
+    });
+
+    EFF_TestHarness::Stats theScalarToRaw = TimeConversions(inRepeats, inConversions, [&] (UInt32 i) {
+        EFF_TestHarness::DoNotOptimise(inCurve.ConvertScalarToRaw(theScalars[i % theScalars.size()]));
+    });
+
+    EFF_TestHarness::Stats theScalarToDB = TimeConversions(inRepeats, inConversions, [&] (UInt32 i) {
+        EFF_TestHarness::DoNotOptimise(inCurve.ConvertScalarToDB(theScalars[i % theScalars.size()]));
+    });
+
+    printf("    %-16s raw->scalar %7.1f ns, raw->dB %7.1f ns, scalar->raw %7.1f ns, scalar->dB %7.1f ns\n",
+           inLabel,
+           theRawToScalar.mP50,
+           theRawToDB.mP50,
+           theScalarToRaw.mP50,
+           theScalarToDB.mP50);
+}
+
+int main(int argc, char* argv[])
+{
+    const bool theQuick = EFF_TestHarness::IsQuick(argc, argv);
+    const UInt32 theConversions = theQuick ? 10000 : 1000000;
+    const UInt32 theRepeats = theQuick ? 3 : 20;
+
+    const std::vector<Range> theAppCurve { { kAppRelativeVolumeMinRawValue,
+                                             kAppRelativeVolumeMaxRawValue,
+                                             kAppRelativeVolumeMinDbValue,
+                                             kAppRelativeVolumeMaxDbValue } };
+    const std::vector<Range> theThreeRangeCurve {
+        { 0, 20, -96.0f, -40.0f }, { 20, 60, -40.0f, -10.0f }, { 60, 100, -10.0f, 6.0f }
+    };
+
+    const std::pair<const char*, const std::vector<Range>*> theCurves[] = {
+        { "app curve", &theAppCurve },
+        { "three ranges", &theThreeRangeCurve }
+    };
+
+    for(const auto& theCurveDescription : theCurves)
+    {
+        EFF_VolumeCurve theCurve;
+        CAVolumeCurve theReference;
+        MakeCurve(*theCurveDescription.second, theCurve);
+        MakeCurve(*theCurveDescription.second, theReference);
+
+        printf("%s (p50s):\n", theCurveDescription.first);
+        TimeCurve("EFF_VolumeCurve", theCurve, theRepeats, theConversions);
+        TimeCurve("CAVolumeCurve", theReference, theRepeats, theConversions);
+
+        // Generating the tables, which each change to the curve does.
+        EFF_TestHarness::Stats theGenerate = TimeConversions(theRepeats, theQuick ? 2 : 20, [&] (UInt32) {
+            EFF_VolumeCurve theNewCurve;
+            MakeCurve(*theCurveDescription.second, theNewCurve);
+            EFF_TestHarness::DoNotOptimise(theNewCurve.ConvertRawToDB(0));
+        });
+
+        printf("    generating the tables %.1f us\n", theGenerate.mP50 / 1000.0);
+    }
+
+    return 0;
+}
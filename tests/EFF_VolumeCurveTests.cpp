@@ -0,0 +1,177 @@
+//
+//  EFF_VolumeCurveTests.cpp
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Tests that EFF_VolumeCurve's lookup tables give exactly the results CAVolumeCurve does, for the
+//  curves the driver uses, every transfer function and a few unusual ranges. The scalar volumes
+//  checked include a fine sweep of [0, 1], the float on each side of every scalar-to-raw threshold,
+//  and values outside [0, 1].
+//
+
+// Local Includes
+#include "EFF_TestHarness.h"
+#include "EFF_Types.h"
+
+// Unit Include
+#include "EFF_VolumeCurve.h"
+
+// STL Includes
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+namespace
+{
+    struct Range
+    {
+        SInt32  mMinRaw;
+        SInt32  mMaxRaw;
+        Float32 mMinDB;
+        Float32 mMaxDB;
+    };
+}
+
+// Builds the same curve as an EFF_VolumeCurve and a CAVolumeCurve.
+static void MakeCurves(const std::vector<Range>& inRanges,
+                       UInt32 inTransferFunction,
+                       EFF_VolumeCurve& outCurve,
+                       CAVolumeCurve& outReference)
+{
+    for(const Range& theRange : inRanges)
+    {
+        outCurve.AddRange(theRange.mMinRaw, theRange.mMaxRaw, theRange.mMinDB, theRange.mMaxDB);
+        outReference.AddRange(theRange.mMinRaw, theRange.mMaxRaw, theRange.mMinDB, theRange.mMaxDB);
+    }
+
+    outCurve.SetTransferFunction(inTransferFunction);
+    outReference.SetTransferFunction(inTransferFunction);
+}
+
+static void CheckScalar(const EFF_VolumeCurve& inCurve, const CAVolumeCurve& inReference, Float32 inScalar)
+{
+    EFFCheck(inCurve.ConvertScalarToRaw(inScalar) == inReference.ConvertScalarToRaw(inScalar));
+    EFFCheck(inCurve.ConvertScalarToDB(inScalar) == inReference.ConvertScalarToDB(inScalar));
+}
+
+static void CheckCurve(const std::vector<Range>& inRanges, UInt32 inTransferFunction)
+{
+    EFF_VolumeCurve theCurve;
+    CAVolumeCurve theReference;
+    MakeCurves(inRanges, inTransferFunction, theCurve, theReference);
+
+    EFFCheck(theCurve.GetMinimumRaw() == theReference.GetMinimumRaw());
+    EFFCheck(theCurve.GetMaximumRaw() == theReference.GetMaximumRaw());
+
+    // Every raw volume, and a few outside the range, which are clamped.
+    for(SInt32 theRaw = theReference.GetMinimumRaw() - 3; theRaw <= theReference.GetMaximumRaw() + 3; theRaw++)
+    {
+        EFFCheck(theCurve.ConvertRawToScalar(theRaw) == theReference.ConvertRawToScalar(theRaw));
+        EFFCheck(theCurve.ConvertRawToDB(theRaw) == theReference.ConvertRawToDB(theRaw));
+    }
+
+    // A fine sweep of the scalar volumes.
+    const UInt32 kSteps = 65536;
+    for(UInt32 i = 0; i <= kSteps; i++)
+    {
+        CheckScalar(theCurve, theReference, static_cast<Float32>(i) / kSteps);
+    }
+
+    // Each side of each threshold, where an off-by-one in the table would show.
+    for(Float32 theScalar = 0.0f; theScalar < 1.0f; )
+    {
+        SInt32 theRaw = theReference.ConvertScalarToRaw(theScalar);
+
+        if(theRaw >= theReference.GetMaximumRaw())
+        {
+            break;
+        }
+
+        // The first scalar volume that converts to a higher raw volume, by bisection.
+        Float32 theLow = theScalar, theHigh = 1.0f;
+        while(std::nextafter(theLow, 2.0f) < theHigh)
+        {
+            Float32 theMiddle = theLow + (theHigh - theLow) / 2.0f;
+
+            if(theMiddle <= theLow || theMiddle >= theHigh)
+            {
+                break;
+            }
+
+            (theReference.ConvertScalarToRaw(theMiddle) > theRaw ? theHigh : theLow) = theMiddle;
+        }
+
+        CheckScalar(theCurve, theReference, theLow);
+        CheckScalar(theCurve, theReference, theHigh);
+        CheckScalar(theCurve, theReference, std::nextafter(theHigh, 2.0f));
+
+        theScalar = theHigh;
+    }
+
+    // Outside [0, 1].
+    CheckScalar(theCurve, theReference, -0.5f);
+    CheckScalar(theCurve, theReference, -0.0f);
+    CheckScalar(theCurve, theReference, 1.5f);
+    CheckScalar(theCurve, theReference, std::numeric_limits<Float32>::infinity());
+
+    // Converting from dB, which just uses the curve.
+    for(Float32 theDB = theReference.GetMinimumDB() - 1.0f; theDB <= theReference.GetMaximumDB() + 1.0f; theDB += 0.25f)
+    {
+        EFFCheck(theCurve.ConvertDBToRaw(theDB) == theReference.ConvertDBToRaw(theDB));
+        EFFCheck(theCurve.ConvertDBToScalar(theDB) == theReference.ConvertDBToScalar(theDB));
+    }
+}
+
+int main()
+{
+    // EFF_Clients's app volume curve.
+    const std::vector<Range> theAppCurve { { kAppRelativeVolumeMinRawValue,
+                                             kAppRelativeVolumeMaxRawValue,
+                                             kAppRelativeVolumeMinDbValue,
+                                             kAppRelativeVolumeMaxDbValue } };
+    // EFF_VolumeControl's default curve.
+    const std::vector<Range> theVolumeControlCurve { { 0, 96, -96.0f, 0.0f } };
+
+    CheckCurve(theAppCurve, CAVolumeCurve::kPow2Over1Curve);
+    CheckCurve(theVolumeControlCurve, CAVolumeCurve::kPow2Over1Curve);
+    // The UI sounds volume control.
+    CheckCurve(theVolumeControlCurve, CAVolumeCurve::kPow4Over1Curve);
+
+    for(UInt32 theTransferFunction = CAVolumeCurve::kLinearCurve;
+        theTransferFunction <= CAVolumeCurve::kPow12Over1Curve;
+        theTransferFunction++)
+    {
+        CheckCurve(theAppCurve, theTransferFunction);
+    }
+
+    // Several ranges with different slopes, and a range that doesn't start at 0.
+    CheckCurve({ { 0, 20, -96.0f, -40.0f }, { 20, 60, -40.0f, -10.0f }, { 60, 100, -10.0f, 6.0f } },
+               CAVolumeCurve::kPow2Over1Curve);
+    CheckCurve({ { -50, 50, -60.0f, 0.0f } }, CAVolumeCurve::kLinearCurve);
+
+    // Too many raw volumes for the tables, so it falls back to the curve.
+    CheckCurve({ { 0, 10000, -96.0f, 0.0f } }, CAVolumeCurve::kPow2Over1Curve);
+
+    // Resetting the curve and adding a new range regenerates the tables.
+    {
+        EFF_VolumeCurve theCurve;
+        CAVolumeCurve theReference;
+        MakeCurves(theAppCurve, CAVolumeCurve::kPow2Over1Curve, theCurve, theReference);
+        theCurve.ResetRange();
+        theReference.ResetRange();
+        theCurve.AddRange(0, 40, -40.0f, 0.0f);
+        theReference.AddRange(0, 40, -40.0f, 0.0f);
+
+        for(UInt32 i = 0; i <= 1000; i++)
+        {
+            CheckScalar(theCurve, theReference, static_cast<Float32>(i) / 1000.0f);
+        }
+
+        EFFCheck(theCurve.GetMaximumRaw() == 40);
+    }
+
+    return EFF_TestHarness::Finish("EFF_VolumeCurveTests");
+}
@@ -0,0 +1,43 @@
+//
+//  Accelerate.h
+//  effervescence-tests
+//
+//  Stand-in for <Accelerate/Accelerate.h>, with scalar versions of the few vDSP functions the
+//  driver uses. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_Accelerate_h
+#define EFF_Compat_Accelerate_h
+
+#include <math.h>
+
+typedef long vDSP_Stride;
+typedef unsigned long vDSP_Length;
+
+// The largest absolute value of N elements of A, taken every IA elements.
+static inline void vDSP_maxmgv(const float* A, vDSP_Stride IA, float* C, vDSP_Length N)
+{
+    float theMax = 0.0f;
+
+    for(vDSP_Length i = 0; i < N; i++)
+    {
+        theMax = fmaxf(theMax, fabsf(A[i * IA]));
+    }
+
+    *C = theMax;
+}
+
+// The root mean square of N elements of A, taken every IA elements.
+static inline void vDSP_rmsqv(const float* A, vDSP_Stride IA, float* C, vDSP_Length N)
+{
+    float theSum = 0.0f;
+
+    for(vDSP_Length i = 0; i < N; i++)
+    {
+        theSum += A[i * IA] * A[i * IA];
+    }
+
+    *C = (N > 0) ? sqrtf(theSum / N) : 0.0f;
+}
+
+#endif /* EFF_Compat_Accelerate_h */
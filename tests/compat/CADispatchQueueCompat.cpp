@@ -0,0 +1,119 @@
+//
+//  CADispatchQueueCompat.cpp
+//  effervescence-tests
+//
+//  Stand-in for PublicUtility/CADispatchQueue.cpp, which needs blocks and Mach, on hosts without
+//  Apple's SDK. Only defines the function-based parts of CADispatchQueue, which are the same as in
+//  the real one, on top of DispatchCompat.cpp. The block-based functions and the Mach port event
+//  sources aren't defined, so code that calls them won't link.
+//
+
+// Unit Include
+#include "CADispatchQueue.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAException.h"
+#include "CAHostTimeBase.h"
+
+
+CADispatchQueue::CADispatchQueue(const char* inName)
+:
+	mDispatchQueue(NULL),
+	mPortDeathList(),
+	mMachPortReceiverList()
+{
+	mDispatchQueue = dispatch_queue_create(inName, NULL);
+	ThrowIfNULL(mDispatchQueue, CAException('what'), "CADispatchQueue::CADispatchQueue: failed to create the dispatch queue");
+}
+
+CADispatchQueue::CADispatchQueue(CFStringRef inName)
+:
+	mDispatchQueue(NULL),
+	mPortDeathList(),
+	mMachPortReceiverList()
+{
+	CACFString theCFName(inName, false);
+	char theName[256];
+	UInt32 theSize = 256;
+	theCFName.GetCString(theName, theSize);
+	mDispatchQueue = dispatch_queue_create(theName, NULL);
+	ThrowIfNULL(mDispatchQueue, CAException('what'), "CADispatchQueue::CADispatchQueue: failed to create the dispatch queue");
+}
+
+CADispatchQueue::~CADispatchQueue()
+{
+	dispatch_release(mDispatchQueue);
+}
+
+void	CADispatchQueue::Dispatch(bool inDoSync, void* inTaskContext, dispatch_function_t inTask) const
+{
+	if(inDoSync)
+	{
+		dispatch_sync_f(mDispatchQueue, inTaskContext, inTask);
+	}
+	else
+	{
+		dispatch_async_f(mDispatchQueue, inTaskContext, inTask);
+	}
+}
+
+void	CADispatchQueue::Dispatch(UInt64 inNanoseconds, void* inTaskContext, dispatch_function_t inTask) const
+{
+	if(inNanoseconds == 0)
+	{
+		dispatch_async_f(mDispatchQueue, inTaskContext, inTask);
+	}
+	else
+	{
+		dispatch_after_f(dispatch_time(0, static_cast<int64_t>(CAHostTimeBase::ConvertFromNanos(inNanoseconds))), mDispatchQueue, inTaskContext, inTask);
+	}
+}
+
+void	CADispatchQueue::Dispatch_Global(dispatch_queue_priority_t inQueuePriority, bool inDoSync, void* inTaskContext, dispatch_function_t inTask)
+{
+	dispatch_queue_t theDispatchQueue = dispatch_get_global_queue(inQueuePriority, 0);
+	if(inDoSync)
+	{
+		dispatch_sync_f(theDispatchQueue, inTaskContext, inTask);
+	}
+	else
+	{
+		dispatch_async_f(theDispatchQueue, inTaskContext, inTask);
+	}
+}
+
+void	CADispatchQueue::Dispatch_Global(dispatch_queue_priority_t inQueuePriority, UInt64 inNanoseconds, void* inTaskContext, dispatch_function_t inTask)
+{
+	dispatch_queue_t theDispatchQueue = dispatch_get_global_queue(inQueuePriority, 0);
+	if(inNanoseconds == 0)
+	{
+		dispatch_async_f(theDispatchQueue, inTaskContext, inTask);
+	}
+	else
+	{
+		dispatch_after_f(dispatch_time(0, static_cast<int64_t>(CAHostTimeBase::ConvertFromNanos(inNanoseconds))), theDispatchQueue, inTaskContext, inTask);
+	}
+}
+
+CADispatchQueue&	CADispatchQueue::GetGlobalSerialQueue()
+{
+	dispatch_once_f(&sGlobalSerialQueueInitialized, NULL, InitializeGlobalSerialQueue);
+	ThrowIfNULL(sGlobalSerialQueue, CAException('nope'), "CADispatchQueue::GetGlobalSerialQueue: there is no global serial queue");
+	return *sGlobalSerialQueue;
+}
+
+void	CADispatchQueue::InitializeGlobalSerialQueue(void*)
+{
+	try
+	{
+		sGlobalSerialQueue = new CADispatchQueue("com.apple.audio.CADispatchQueue.SerialQueue");
+	}
+	catch(...)
+	{
+		sGlobalSerialQueue = NULL;
+	}
+}
+
+CADispatchQueue*	CADispatchQueue::sGlobalSerialQueue = NULL;
+dispatch_once_t		CADispatchQueue::sGlobalSerialQueueInitialized = 0;
@@ -0,0 +1,34 @@
+//
+//  AudioHardware.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of <CoreAudio/AudioHardware.h> the driver uses. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_AudioHardware_h
+#define EFF_Compat_AudioHardware_h
+
+#include <CoreAudio/AudioHardwareBase.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <dispatch/dispatch.h>
+
+typedef AudioObjectID           AudioDeviceID;
+typedef AudioObjectID           AudioStreamID;
+
+enum
+{
+    kAudioObjectSystemObject                = 1
+};
+
+enum
+{
+    kAudioObjectPropertyCustomPropertyInfoList  = 'cust'
+};
+
+enum
+{
+    kAudioDevicePropertyBufferFrameSizeRange    = 'fsz#',
+    kAudioDevicePropertyZeroTimeStampPeriod     = 'ring'
+};
+
+#endif /* EFF_Compat_AudioHardware_h */
@@ -0,0 +1,222 @@
+//
+//  AudioHardwareBase.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of <CoreAudio/AudioHardwareBase.h> the driver uses. See
+//  EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_AudioHardwareBase_h
+#define EFF_Compat_AudioHardwareBase_h
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+typedef UInt32                  AudioObjectID;
+typedef UInt32                  AudioClassID;
+typedef UInt32                  AudioObjectPropertySelector;
+typedef UInt32                  AudioObjectPropertyScope;
+typedef UInt32                  AudioObjectPropertyElement;
+
+struct AudioObjectPropertyAddress
+{
+    AudioObjectPropertySelector mSelector;
+    AudioObjectPropertyScope    mScope;
+    AudioObjectPropertyElement  mElement;
+};
+typedef struct AudioObjectPropertyAddress AudioObjectPropertyAddress;
+
+enum
+{
+    kAudioHardwareNoError                   = 0,
+    kAudioHardwareNotRunningError           = 'stop',
+    kAudioHardwareUnspecifiedError          = 'what',
+    kAudioHardwareUnknownPropertyError      = 'who?',
+    kAudioHardwareBadPropertySizeError      = '!siz',
+    kAudioHardwareIllegalOperationError     = 'nope',
+    kAudioHardwareBadObjectError            = '!obj',
+    kAudioHardwareBadDeviceError            = '!dev',
+    kAudioHardwareBadStreamError            = '!str',
+    kAudioHardwareUnsupportedOperationError = 'unop',
+    kAudioDeviceUnsupportedFormatError      = '!dat',
+    kAudioDevicePermissionsError            = '!hog'
+};
+
+enum
+{
+    kAudioObjectUnknown                     = 0
+};
+
+enum
+{
+    kAudioObjectPropertyScopeGlobal         = 'glob',
+    kAudioObjectPropertyScopeInput          = 'inpt',
+    kAudioObjectPropertyScopeOutput         = 'outp',
+    kAudioObjectPropertyScopePlayThrough    = 'ptru',
+    kAudioObjectPropertyElementMaster       = 0,
+    kAudioObjectPropertyElementMain         = 0
+};
+
+enum
+{
+    kAudioObjectPropertySelectorWildcard    = '****',
+    kAudioObjectPropertyScopeWildcard       = '****',
+    kAudioObjectPropertyElementWildcard     = 0xFFFFFFFF,
+    kAudioObjectClassIDWildcard             = '****'
+};
+
+struct AudioValueRange
+{
+    Float64                     mMinimum;
+    Float64                     mMaximum;
+};
+typedef struct AudioValueRange AudioValueRange;
+
+struct AudioStreamRangedDescription
+{
+    AudioStreamBasicDescription mFormat;
+    AudioValueRange             mSampleRateRange;
+};
+typedef struct AudioStreamRangedDescription AudioStreamRangedDescription;
+
+#pragma mark AudioObject
+
+enum
+{
+    kAudioObjectClassID                     = 'aobj'
+};
+
+enum
+{
+    kAudioObjectPropertyBaseClass           = 'bcls',
+    kAudioObjectPropertyClass               = 'clas',
+    kAudioObjectPropertyOwner               = 'stdv',
+    kAudioObjectPropertyName                = 'lnam',
+    kAudioObjectPropertyModelName           = 'lmod',
+    kAudioObjectPropertyManufacturer        = 'lmak',
+    kAudioObjectPropertyElementName         = 'lchn',
+    kAudioObjectPropertyElementCategoryName = 'lccn',
+    kAudioObjectPropertyElementNumberName   = 'lcnn',
+    kAudioObjectPropertyOwnedObjects        = 'ownd',
+    kAudioObjectPropertyIdentify            = 'iden',
+    kAudioObjectPropertySerialNumber        = 'snum',
+    kAudioObjectPropertyFirmwareVersion     = 'fwvn'
+};
+
+#pragma mark AudioPlugIn
+
+enum
+{
+    kAudioPlugInClassID                     = 'aplg'
+};
+
+enum
+{
+    kAudioPlugInPropertyBundleID            = 'piid',
+    kAudioPlugInPropertyDeviceList          = 'dev#',
+    kAudioPlugInPropertyTranslateUIDToDevice = 'uidd',
+    kAudioPlugInPropertyBoxList             = 'box#',
+    kAudioPlugInPropertyClockDeviceList     = 'clk#',
+    kAudioPlugInPropertyResourceBundle      = 'rsrc'
+};
+
+#pragma mark AudioDevice
+
+enum
+{
+    kAudioDeviceClassID                     = 'adev'
+};
+
+enum
+{
+    kAudioDeviceTransportTypeUnknown        = 0,
+    kAudioDeviceTransportTypeBuiltIn        = 'bltn',
+    kAudioDeviceTransportTypeAggregate      = 'grup',
+    kAudioDeviceTransportTypeVirtual        = 'virt'
+};
+
+enum
+{
+    kAudioDevicePropertyConfigurationApplication        = 'capp',
+    kAudioDevicePropertyDeviceUID                       = 'uid ',
+    kAudioDevicePropertyModelUID                        = 'muid',
+    kAudioDevicePropertyTransportType                   = 'tran',
+    kAudioDevicePropertyRelatedDevices                  = 'akin',
+    kAudioDevicePropertyClockDomain                     = 'clkd',
+    kAudioDevicePropertyDeviceIsAlive                   = 'livn',
+    kAudioDevicePropertyDeviceIsRunning                 = 'goin',
+    kAudioDevicePropertyDeviceCanBeDefaultDevice        = 'dflt',
+    kAudioDevicePropertyDeviceCanBeDefaultSystemDevice  = 'sflt',
+    kAudioDevicePropertyLatency                         = 'ltnc',
+    kAudioDevicePropertyStreams                         = 'stm#',
+    kAudioObjectPropertyControlList                     = 'ctrl',
+    kAudioDevicePropertySafetyOffset                    = 'saft',
+    kAudioDevicePropertyNominalSampleRate               = 'nsrt',
+    kAudioDevicePropertyAvailableNominalSampleRates     = 'nsr#',
+    kAudioDevicePropertyIcon                            = 'icon',
+    kAudioDevicePropertyIsHidden                        = 'hidn',
+    kAudioDevicePropertyPreferredChannelsForStereo      = 'dch2',
+    kAudioDevicePropertyPreferredChannelLayout          = 'srnd'
+};
+
+#pragma mark AudioStream
+
+enum
+{
+    kAudioStreamClassID                     = 'astr'
+};
+
+enum
+{
+    kAudioStreamTerminalTypeUnknown         = 0,
+    kAudioStreamTerminalTypeLine            = 'line',
+    kAudioStreamTerminalTypeDigitalAudioInterface = 'spdf',
+    kAudioStreamTerminalTypeSpeaker         = 'spkr',
+    kAudioStreamTerminalTypeHeadphones      = 'hdph',
+    kAudioStreamTerminalTypeMicrophone      = 'micr'
+};
+
+enum
+{
+    kAudioStreamPropertyIsActive                    = 'sact',
+    kAudioStreamPropertyDirection                   = 'sdir',
+    kAudioStreamPropertyTerminalType                = 'term',
+    kAudioStreamPropertyStartingChannel             = 'schn',
+    kAudioStreamPropertyLatency                     = kAudioDevicePropertyLatency,
+    kAudioStreamPropertyVirtualFormat               = 'sfmt',
+    kAudioStreamPropertyAvailableVirtualFormats     = 'sfma',
+    kAudioStreamPropertyPhysicalFormat              = 'pft ',
+    kAudioStreamPropertyAvailablePhysicalFormats    = 'pfta'
+};
+
+#pragma mark AudioControl
+
+enum
+{
+    kAudioControlClassID                    = 'actl',
+    kAudioLevelControlClassID               = 'levl',
+    kAudioVolumeControlClassID              = 'vlme',
+    kAudioBooleanControlClassID             = 'togl',
+    kAudioMuteControlClassID                = 'mute'
+};
+
+enum
+{
+    kAudioControlPropertyScope              = 'cscp',
+    kAudioControlPropertyElement            = 'celm'
+};
+
+enum
+{
+    kAudioLevelControlPropertyScalarValue               = 'lcsv',
+    kAudioLevelControlPropertyDecibelValue              = 'lcdv',
+    kAudioLevelControlPropertyDecibelRange              = 'lcdr',
+    kAudioLevelControlPropertyConvertScalarToDecibels   = 'lcsd',
+    kAudioLevelControlPropertyConvertDecibelsToScalar   = 'lcds'
+};
+
+enum
+{
+    kAudioBooleanControlPropertyValue       = 'bcvl'
+};
+
+#endif /* EFF_Compat_AudioHardwareBase_h */
@@ -0,0 +1,93 @@
+//
+//  AudioServerPlugIn.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of <CoreAudio/AudioServerPlugIn.h> the driver uses, apart from the
+//  driver interface itself, which only EFF_PlugInInterface.cpp needs. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_AudioServerPlugIn_h
+#define EFF_Compat_AudioServerPlugIn_h
+
+#include <CoreAudio/AudioHardware.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <sys/types.h>
+
+enum
+{
+    kAudioObjectPlugInObject                = 1
+};
+
+struct AudioServerPlugInCustomPropertyInfo
+{
+    AudioObjectPropertySelector mSelector;
+    UInt32                      mPropertyDataType;
+    UInt32                      mQualifierDataType;
+};
+typedef struct AudioServerPlugInCustomPropertyInfo AudioServerPlugInCustomPropertyInfo;
+
+enum
+{
+    kAudioServerPlugInCustomPropertyDataTypeNone            = 0,
+    kAudioServerPlugInCustomPropertyDataTypeCFString        = 'cfst',
+    kAudioServerPlugInCustomPropertyDataTypeCFPropertyList  = 'plst'
+};
+
+struct AudioServerPlugInClientInfo
+{
+    UInt32                      mClientID;
+    pid_t                       mProcessID;
+    Boolean                     mIsNativeEndian;
+    CFStringRef                 mBundleID;
+};
+typedef struct AudioServerPlugInClientInfo AudioServerPlugInClientInfo;
+
+struct AudioServerPlugInIOCycleInfo
+{
+    UInt64                      mIOCycleCounter;
+    UInt32                      mNominalIOBufferFrameSize;
+    AudioTimeStamp              mInputTime;
+    AudioTimeStamp              mOutputTime;
+    AudioTimeStamp              mCurrentTime;
+    Float64                     mMainHostTicksPerFrame;
+    Float64                     mDeviceHostTicksPerFrame;
+};
+typedef struct AudioServerPlugInIOCycleInfo AudioServerPlugInIOCycleInfo;
+
+enum
+{
+    kAudioServerPlugInIOOperationThread         = 'thrd',
+    kAudioServerPlugInIOOperationCycle          = 'cycl',
+    kAudioServerPlugInIOOperationReadInput      = 'read',
+    kAudioServerPlugInIOOperationConvertInput   = 'cinp',
+    kAudioServerPlugInIOOperationProcessInput   = 'pinp',
+    kAudioServerPlugInIOOperationProcessOutput  = 'pout',
+    kAudioServerPlugInIOOperationMixOutput      = 'mixo',
+    kAudioServerPlugInIOOperationProcessMix     = 'pmix',
+    kAudioServerPlugInIOOperationConvertMix     = 'cmix',
+    kAudioServerPlugInIOOperationWriteMix       = 'rite'
+};
+
+typedef struct AudioServerPlugInHostInterface AudioServerPlugInHostInterface;
+typedef const AudioServerPlugInHostInterface* AudioServerPlugInHostRef;
+
+struct AudioServerPlugInHostInterface
+{
+    OSStatus    (*PropertiesChanged)(AudioServerPlugInHostRef inHost,
+                                     AudioObjectID inObjectID,
+                                     UInt32 inNumberAddresses,
+                                     const AudioObjectPropertyAddress* inAddresses);
+
+    OSStatus    (*CopyFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef* outData);
+
+    OSStatus    (*WriteToStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData);
+
+    OSStatus    (*DeleteFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey);
+
+    OSStatus    (*RequestDeviceConfigurationChange)(AudioServerPlugInHostRef inHost,
+                                                    AudioObjectID inDeviceObjectID,
+                                                    UInt64 inChangeAction,
+                                                    void* inChangeInfo);
+};
+
+#endif /* EFF_Compat_AudioServerPlugIn_h */
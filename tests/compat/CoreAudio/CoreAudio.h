@@ -0,0 +1,14 @@
+//
+//  CoreAudio.h
+//  effervescence-tests
+//
+//  See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CoreAudio_h
+#define EFF_Compat_CoreAudio_h
+
+#include <CoreAudio/CoreAudioTypes.h>
+#include <CoreAudio/AudioHardware.h>
+
+#endif /* EFF_Compat_CoreAudio_h */
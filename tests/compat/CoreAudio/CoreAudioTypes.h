@@ -0,0 +1,157 @@
+//
+//  CoreAudioTypes.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of <CoreAudio/CoreAudioTypes.h> the driver's portable classes use. See
+//  EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CoreAudioTypes_h
+#define EFF_Compat_CoreAudioTypes_h
+
+#include <MacTypes.h>
+#include <TargetConditionals.h>
+
+enum
+{
+    kAudio_UnimplementedError   = -4,
+    kAudio_FileNotFoundError    = -43,
+    kAudio_FilePermissionError  = -54,
+    kAudio_TooManyFilesOpenError = -42,
+    kAudio_BadFilePathError     = 'BADF',
+    kAudio_ParamError           = -50,
+    kAudio_MemFullError         = -108
+};
+
+typedef UInt32                  AudioFormatID;
+typedef UInt32                  AudioFormatFlags;
+
+struct AudioStreamBasicDescription
+{
+    Float64                     mSampleRate;
+    AudioFormatID               mFormatID;
+    AudioFormatFlags            mFormatFlags;
+    UInt32                      mBytesPerPacket;
+    UInt32                      mFramesPerPacket;
+    UInt32                      mBytesPerFrame;
+    UInt32                      mChannelsPerFrame;
+    UInt32                      mBitsPerChannel;
+    UInt32                      mReserved;
+};
+typedef struct AudioStreamBasicDescription AudioStreamBasicDescription;
+
+enum
+{
+    kAudioFormatLinearPCM       = 'lpcm'
+};
+
+enum
+{
+    kAudioFormatFlagIsFloat     = (1U << 0),
+    kAudioFormatFlagIsBigEndian = (1U << 1),
+    kAudioFormatFlagIsSignedInteger = (1U << 2),
+    kAudioFormatFlagIsPacked    = (1U << 3),
+    kAudioFormatFlagIsNonInterleaved = (1U << 5),
+    kAudioFormatFlagsNativeEndian = 0,
+    kAudioFormatFlagsNativeFloatPacked = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked
+};
+
+struct SMPTETime
+{
+    SInt16                      mSubframes;
+    SInt16                      mSubframeDivisor;
+    UInt32                      mCounter;
+    UInt32                      mType;
+    UInt32                      mFlags;
+    SInt16                      mHours;
+    SInt16                      mMinutes;
+    SInt16                      mSeconds;
+    SInt16                      mFrames;
+};
+typedef struct SMPTETime SMPTETime;
+
+struct AudioTimeStamp
+{
+    Float64                     mSampleTime;
+    UInt64                      mHostTime;
+    Float64                     mRateScalar;
+    UInt64                      mWordClockTime;
+    SMPTETime                   mSMPTETime;
+    UInt32                      mFlags;
+    UInt32                      mReserved;
+};
+typedef struct AudioTimeStamp AudioTimeStamp;
+
+enum
+{
+    kAudioTimeStampSampleTimeValid = (1U << 0),
+    kAudioTimeStampHostTimeValid = (1U << 1),
+    kAudioTimeStampRateScalarValid = (1U << 2),
+    kAudioTimeStampSampleHostTimeValid = (kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid)
+};
+
+struct AudioBuffer
+{
+    UInt32                      mNumberChannels;
+    UInt32                      mDataByteSize;
+    void*                       mData;
+};
+typedef struct AudioBuffer AudioBuffer;
+
+struct AudioBufferList
+{
+    UInt32                      mNumberBuffers;
+    AudioBuffer                 mBuffers[1];
+};
+typedef struct AudioBufferList AudioBufferList;
+
+typedef UInt32                  AudioChannelLabel;
+typedef UInt32                  AudioChannelLayoutTag;
+typedef UInt32                  AudioChannelFlags;
+typedef UInt32                  AudioChannelBitmap;
+
+enum
+{
+    kAudioChannelLabel_Unknown              = 0xFFFFFFFF,
+    kAudioChannelLabel_Unused               = 0,
+    kAudioChannelLabel_Left                 = 1,
+    kAudioChannelLabel_Right                = 2,
+    kAudioChannelLabel_Center               = 3,
+    kAudioChannelLabel_LFEScreen            = 4,
+    kAudioChannelLabel_LeftSurround         = 5,
+    kAudioChannelLabel_RightSurround        = 6,
+    kAudioChannelLabel_RearSurroundLeft     = 33,
+    kAudioChannelLabel_RearSurroundRight    = 34,
+    kAudioChannelLabel_Mono                 = 42,
+    kAudioChannelLabel_Discrete             = 400,
+    kAudioChannelLabel_Discrete_0           = (1U << 16) | 0
+};
+
+enum
+{
+    kAudioChannelLayoutTag_UseChannelDescriptions   = (0U << 16) | 0,
+    kAudioChannelLayoutTag_UseChannelBitmap         = (1U << 16) | 0,
+    kAudioChannelLayoutTag_Mono                     = (100U << 16) | 1,
+    kAudioChannelLayoutTag_Stereo                   = (101U << 16) | 2,
+    kAudioChannelLayoutTag_MPEG_5_1_A               = (121U << 16) | 6,
+    kAudioChannelLayoutTag_MPEG_7_1_C               = (128U << 16) | 8
+};
+
+struct AudioChannelDescription
+{
+    AudioChannelLabel           mChannelLabel;
+    AudioChannelFlags           mChannelFlags;
+    Float32                     mCoordinates[3];
+};
+typedef struct AudioChannelDescription AudioChannelDescription;
+
+struct AudioChannelLayout
+{
+    AudioChannelLayoutTag       mChannelLayoutTag;
+    AudioChannelBitmap          mChannelBitmap;
+    UInt32                      mNumberChannelDescriptions;
+    AudioChannelDescription     mChannelDescriptions[1];
+};
+typedef struct AudioChannelLayout AudioChannelLayout;
+
+#endif /* EFF_Compat_CoreAudioTypes_h */
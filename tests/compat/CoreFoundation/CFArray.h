@@ -0,0 +1,65 @@
+//
+//  CFArray.h
+//  effervescence-tests
+//
+//  Stand-in for CoreFoundation's CFArray.h. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFArray_h
+#define EFF_Compat_CFArray_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef const void* (*CFArrayRetainCallBack)(CFAllocatorRef allocator, const void* value);
+typedef void        (*CFArrayReleaseCallBack)(CFAllocatorRef allocator, const void* value);
+typedef CFStringRef (*CFArrayCopyDescriptionCallBack)(const void* value);
+typedef Boolean     (*CFArrayEqualCallBack)(const void* value1, const void* value2);
+
+typedef struct
+{
+    CFIndex                             version;
+    CFArrayRetainCallBack               retain;
+    CFArrayReleaseCallBack              release;
+    CFArrayCopyDescriptionCallBack      copyDescription;
+    CFArrayEqualCallBack                equal;
+} CFArrayCallBacks;
+
+typedef const struct __CFArray*         CFArrayRef;
+typedef struct __CFArray*               CFMutableArrayRef;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern const CFArrayCallBacks           kCFTypeArrayCallBacks;
+
+CFTypeID            CFArrayGetTypeID(void);
+
+CFArrayRef          CFArrayCreate(CFAllocatorRef allocator,
+                                  const void** values,
+                                  CFIndex numValues,
+                                  const CFArrayCallBacks* callBacks);
+CFArrayRef          CFArrayCreateCopy(CFAllocatorRef allocator, CFArrayRef theArray);
+CFMutableArrayRef   CFArrayCreateMutable(CFAllocatorRef allocator, CFIndex capacity, const CFArrayCallBacks* callBacks);
+CFMutableArrayRef   CFArrayCreateMutableCopy(CFAllocatorRef allocator, CFIndex capacity, CFArrayRef theArray);
+
+CFIndex             CFArrayGetCount(CFArrayRef theArray);
+const void*         CFArrayGetValueAtIndex(CFArrayRef theArray, CFIndex idx);
+Boolean             CFArrayContainsValue(CFArrayRef theArray, CFRange range, const void* value);
+CFIndex             CFArrayGetFirstIndexOfValue(CFArrayRef theArray, CFRange range, const void* value);
+
+void                CFArrayAppendValue(CFMutableArrayRef theArray, const void* value);
+void                CFArrayInsertValueAtIndex(CFMutableArrayRef theArray, CFIndex idx, const void* value);
+void                CFArraySetValueAtIndex(CFMutableArrayRef theArray, CFIndex idx, const void* value);
+void                CFArrayRemoveValueAtIndex(CFMutableArrayRef theArray, CFIndex idx);
+void                CFArrayRemoveAllValues(CFMutableArrayRef theArray);
+void                CFArraySortValues(CFMutableArrayRef theArray,
+                                      CFRange range,
+                                      CFComparatorFunction comparator,
+                                      void* context);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFArray_h */
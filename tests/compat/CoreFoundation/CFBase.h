@@ -0,0 +1,69 @@
+//
+//  CFBase.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of CoreFoundation's CFBase.h the driver and PublicUtility use. The
+//  objects are implemented by CoreFoundationCompat.cpp. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFBase_h
+#define EFF_Compat_CFBase_h
+
+#include <MacTypes.h>
+#include <TargetConditionals.h>
+
+typedef long                            CFIndex;
+typedef unsigned long                   CFTypeID;
+typedef unsigned long                   CFHashCode;
+typedef unsigned long                   CFOptionFlags;
+
+typedef const void*                     CFTypeRef;
+typedef const struct __CFAllocator*     CFAllocatorRef;
+typedef const struct __CFString*        CFStringRef;
+typedef struct __CFString*              CFMutableStringRef;
+typedef CFTypeRef                       CFPropertyListRef;
+
+typedef enum
+{
+    kCFCompareLessThan      = -1,
+    kCFCompareEqualTo       = 0,
+    kCFCompareGreaterThan   = 1
+} CFComparisonResult;
+
+typedef CFComparisonResult (*CFComparatorFunction)(const void* val1, const void* val2, void* context);
+
+typedef struct
+{
+    CFIndex                             location;
+    CFIndex                             length;
+} CFRange;
+
+static inline CFRange CFRangeMake(CFIndex loc, CFIndex len)
+{
+    CFRange theRange = { loc, len };
+    return theRange;
+}
+
+#define kCFAllocatorDefault             ((CFAllocatorRef)NULL)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern const double                     kCFCoreFoundationVersionNumber;
+
+#define kCFCoreFoundationVersionNumber10_9  855.11
+
+CFTypeRef       CFRetain(CFTypeRef cf);
+void            CFRelease(CFTypeRef cf);
+CFIndex         CFGetRetainCount(CFTypeRef cf);
+CFTypeID        CFGetTypeID(CFTypeRef cf);
+Boolean         CFEqual(CFTypeRef cf1, CFTypeRef cf2);
+CFHashCode      CFHash(CFTypeRef cf);
+void            CFShow(CFTypeRef obj);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFBase_h */
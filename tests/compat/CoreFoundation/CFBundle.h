@@ -0,0 +1,36 @@
+//
+//  CFBundle.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of CoreFoundation's CFBundle.h, CFURL.h and CFUUID.h the driver and
+//  PublicUtility use. There are no bundles on these hosts, so no bundle is ever found and no URLs
+//  or UUIDs are ever made. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFBundle_h
+#define EFF_Compat_CFBundle_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef struct __CFBundle*              CFBundleRef;
+typedef const struct __CFURL*           CFURLRef;
+typedef const struct __CFUUID*          CFUUIDRef;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+CFTypeID            CFURLGetTypeID(void);
+CFTypeID            CFUUIDGetTypeID(void);
+
+CFBundleRef         CFBundleGetBundleWithIdentifier(CFStringRef bundleID);
+CFURLRef            CFBundleCopyResourceURL(CFBundleRef bundle,
+                                            CFStringRef resourceName,
+                                            CFStringRef resourceType,
+                                            CFStringRef subDirName);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFBundle_h */
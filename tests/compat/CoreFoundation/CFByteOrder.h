@@ -0,0 +1,23 @@
+//
+//  CFByteOrder.h
+//  effervescence-tests
+//
+//  Stand-in for CoreFoundation's CFByteOrder.h, for little-endian hosts. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFByteOrder_h
+#define EFF_Compat_CFByteOrder_h
+
+#include <CoreFoundation/CFBase.h>
+
+static inline uint32_t CFSwapInt32BigToHost(uint32_t arg)
+{
+    return __builtin_bswap32(arg);
+}
+
+static inline uint32_t CFSwapInt32HostToBig(uint32_t arg)
+{
+    return __builtin_bswap32(arg);
+}
+
+#endif /* EFF_Compat_CFByteOrder_h */
@@ -0,0 +1,35 @@
+//
+//  CFData.h
+//  effervescence-tests
+//
+//  Stand-in for CoreFoundation's CFData.h. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFData_h
+#define EFF_Compat_CFData_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef const struct __CFData*          CFDataRef;
+typedef struct __CFData*                CFMutableDataRef;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+CFTypeID            CFDataGetTypeID(void);
+
+CFDataRef           CFDataCreate(CFAllocatorRef allocator, const UInt8* bytes, CFIndex length);
+CFMutableDataRef    CFDataCreateMutable(CFAllocatorRef allocator, CFIndex capacity);
+
+CFIndex             CFDataGetLength(CFDataRef theData);
+const UInt8*        CFDataGetBytePtr(CFDataRef theData);
+UInt8*              CFDataGetMutableBytePtr(CFMutableDataRef theData);
+void                CFDataSetLength(CFMutableDataRef theData, CFIndex length);
+void                CFDataAppendBytes(CFMutableDataRef theData, const UInt8* bytes, CFIndex length);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFData_h */
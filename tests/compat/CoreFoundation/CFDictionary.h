@@ -0,0 +1,81 @@
+//
+//  CFDictionary.h
+//  effervescence-tests
+//
+//  Stand-in for CoreFoundation's CFDictionary.h. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFDictionary_h
+#define EFF_Compat_CFDictionary_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef const void* (*CFDictionaryRetainCallBack)(CFAllocatorRef allocator, const void* value);
+typedef void        (*CFDictionaryReleaseCallBack)(CFAllocatorRef allocator, const void* value);
+typedef CFStringRef (*CFDictionaryCopyDescriptionCallBack)(const void* value);
+typedef Boolean     (*CFDictionaryEqualCallBack)(const void* value1, const void* value2);
+typedef CFHashCode  (*CFDictionaryHashCallBack)(const void* value);
+
+typedef struct
+{
+    CFIndex                             version;
+    CFDictionaryRetainCallBack          retain;
+    CFDictionaryReleaseCallBack         release;
+    CFDictionaryCopyDescriptionCallBack copyDescription;
+    CFDictionaryEqualCallBack           equal;
+    CFDictionaryHashCallBack            hash;
+} CFDictionaryKeyCallBacks;
+
+typedef struct
+{
+    CFIndex                             version;
+    CFDictionaryRetainCallBack          retain;
+    CFDictionaryReleaseCallBack         release;
+    CFDictionaryCopyDescriptionCallBack copyDescription;
+    CFDictionaryEqualCallBack           equal;
+} CFDictionaryValueCallBacks;
+
+typedef const struct __CFDictionary*    CFDictionaryRef;
+typedef struct __CFDictionary*          CFMutableDictionaryRef;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern const CFDictionaryKeyCallBacks   kCFTypeDictionaryKeyCallBacks;
+extern const CFDictionaryKeyCallBacks   kCFCopyStringDictionaryKeyCallBacks;
+extern const CFDictionaryValueCallBacks kCFTypeDictionaryValueCallBacks;
+
+CFTypeID                CFDictionaryGetTypeID(void);
+
+CFDictionaryRef         CFDictionaryCreate(CFAllocatorRef allocator,
+                                           const void** keys,
+                                           const void** values,
+                                           CFIndex numValues,
+                                           const CFDictionaryKeyCallBacks* keyCallBacks,
+                                           const CFDictionaryValueCallBacks* valueCallBacks);
+CFDictionaryRef         CFDictionaryCreateCopy(CFAllocatorRef allocator, CFDictionaryRef theDict);
+CFMutableDictionaryRef  CFDictionaryCreateMutable(CFAllocatorRef allocator,
+                                                  CFIndex capacity,
+                                                  const CFDictionaryKeyCallBacks* keyCallBacks,
+                                                  const CFDictionaryValueCallBacks* valueCallBacks);
+CFMutableDictionaryRef  CFDictionaryCreateMutableCopy(CFAllocatorRef allocator,
+                                                      CFIndex capacity,
+                                                      CFDictionaryRef theDict);
+
+CFIndex                 CFDictionaryGetCount(CFDictionaryRef theDict);
+Boolean                 CFDictionaryContainsKey(CFDictionaryRef theDict, const void* key);
+const void*             CFDictionaryGetValue(CFDictionaryRef theDict, const void* key);
+Boolean                 CFDictionaryGetValueIfPresent(CFDictionaryRef theDict, const void* key, const void** value);
+void                    CFDictionaryGetKeysAndValues(CFDictionaryRef theDict, const void** keys, const void** values);
+
+void                    CFDictionaryAddValue(CFMutableDictionaryRef theDict, const void* key, const void* value);
+void                    CFDictionarySetValue(CFMutableDictionaryRef theDict, const void* key, const void* value);
+void                    CFDictionaryRemoveValue(CFMutableDictionaryRef theDict, const void* key);
+void                    CFDictionaryRemoveAllValues(CFMutableDictionaryRef theDict);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFDictionary_h */
@@ -0,0 +1,59 @@
+//
+//  CFNumber.h
+//  effervescence-tests
+//
+//  Stand-in for CoreFoundation's CFNumber.h, including CFBoolean. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFNumber_h
+#define EFF_Compat_CFNumber_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef const struct __CFBoolean*       CFBooleanRef;
+typedef const struct __CFNumber*        CFNumberRef;
+
+typedef enum
+{
+    kCFNumberSInt8Type          = 1,
+    kCFNumberSInt16Type         = 2,
+    kCFNumberSInt32Type         = 3,
+    kCFNumberSInt64Type         = 4,
+    kCFNumberFloat32Type        = 5,
+    kCFNumberFloat64Type        = 6,
+    kCFNumberCharType           = 7,
+    kCFNumberShortType          = 8,
+    kCFNumberIntType            = 9,
+    kCFNumberLongType           = 10,
+    kCFNumberLongLongType       = 11,
+    kCFNumberFloatType          = 12,
+    kCFNumberDoubleType         = 13,
+    kCFNumberCFIndexType        = 14,
+    kCFNumberNSIntegerType      = 15,
+    kCFNumberCGFloatType        = 16,
+    kCFNumberMaxType            = 16
+} CFNumberType;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern const CFBooleanRef               kCFBooleanTrue;
+extern const CFBooleanRef               kCFBooleanFalse;
+
+CFTypeID            CFBooleanGetTypeID(void);
+Boolean             CFBooleanGetValue(CFBooleanRef boolean);
+
+CFTypeID            CFNumberGetTypeID(void);
+CFNumberRef         CFNumberCreate(CFAllocatorRef allocator, CFNumberType theType, const void* valuePtr);
+CFNumberType        CFNumberGetType(CFNumberRef number);
+Boolean             CFNumberIsFloatType(CFNumberRef number);
+// Returns false if the number had to be rounded or truncated to fit theType.
+Boolean             CFNumberGetValue(CFNumberRef number, CFNumberType theType, void* valuePtr);
+CFComparisonResult  CFNumberCompare(CFNumberRef number, CFNumberRef otherNumber, void* context);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFNumber_h */
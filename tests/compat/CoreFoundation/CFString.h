@@ -0,0 +1,87 @@
+//
+//  CFString.h
+//  effervescence-tests
+//
+//  Stand-in for the parts of CoreFoundation's CFString.h the driver and PublicUtility use. Only
+//  ASCII and UTF-8 are supported. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CFString_h
+#define EFF_Compat_CFString_h
+
+#include <CoreFoundation/CFBase.h>
+
+typedef UInt32                          CFStringEncoding;
+
+enum
+{
+    kCFStringEncodingMacRoman   = 0,
+    kCFStringEncodingASCII      = 0x0600,
+    kCFStringEncodingUTF8       = 0x08000100
+};
+
+typedef CFOptionFlags                   CFStringCompareFlags;
+
+enum
+{
+    kCFCompareCaseInsensitive   = 1,
+    kCFCompareBackwards         = 4,
+    kCFCompareAnchored          = 8,
+    kCFCompareNonliteral        = 16,
+    kCFCompareLocalized         = 32,
+    kCFCompareNumerically       = 64
+};
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Returns the same immortal string for every use of the same literal, as CFSTR does.
+CFStringRef         __CFStringMakeConstantString(const char* cStr);
+
+#define CFSTR(cStr)                     __CFStringMakeConstantString("" cStr "")
+
+CFTypeID            CFStringGetTypeID(void);
+
+CFStringRef         CFStringCreateWithCString(CFAllocatorRef alloc, const char* cStr, CFStringEncoding encoding);
+CFStringRef         CFStringCreateWithCharacters(CFAllocatorRef alloc, const UniChar* chars, CFIndex numChars);
+CFStringRef         CFStringCreateCopy(CFAllocatorRef alloc, CFStringRef theString);
+CFMutableStringRef  CFStringCreateMutable(CFAllocatorRef alloc, CFIndex maxLength);
+CFMutableStringRef  CFStringCreateMutableCopy(CFAllocatorRef alloc, CFIndex maxLength, CFStringRef theString);
+
+CFIndex             CFStringGetLength(CFStringRef theString);
+UniChar             CFStringGetCharacterAtIndex(CFStringRef theString, CFIndex idx);
+void                CFStringGetCharacters(CFStringRef theString, CFRange range, UniChar* buffer);
+Boolean             CFStringGetCString(CFStringRef theString,
+                                       char* buffer,
+                                       CFIndex bufferSize,
+                                       CFStringEncoding encoding);
+const char*         CFStringGetCStringPtr(CFStringRef theString, CFStringEncoding encoding);
+CFIndex             CFStringGetBytes(CFStringRef theString,
+                                     CFRange range,
+                                     CFStringEncoding encoding,
+                                     UInt8 lossByte,
+                                     Boolean isExternalRepresentation,
+                                     UInt8* buffer,
+                                     CFIndex maxBufLen,
+                                     CFIndex* usedBufLen);
+CFIndex             CFStringGetMaximumSizeForEncoding(CFIndex length, CFStringEncoding encoding);
+Boolean             CFStringGetFileSystemRepresentation(CFStringRef string, char* buffer, CFIndex maxBufLen);
+
+CFComparisonResult  CFStringCompare(CFStringRef theString1,
+                                    CFStringRef theString2,
+                                    CFStringCompareFlags compareOptions);
+Boolean             CFStringHasPrefix(CFStringRef theString, CFStringRef prefix);
+Boolean             CFStringHasSuffix(CFStringRef theString, CFStringRef suffix);
+
+SInt32              CFStringGetIntValue(CFStringRef str);
+double              CFStringGetDoubleValue(CFStringRef str);
+
+void                CFStringAppend(CFMutableStringRef theString, CFStringRef appendedString);
+void                CFStringAppendCString(CFMutableStringRef theString, const char* cStr, CFStringEncoding encoding);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_CFString_h */
@@ -0,0 +1,21 @@
+//
+//  CoreFoundation.h
+//  effervescence-tests
+//
+//  See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_CoreFoundation_h
+#define EFF_Compat_CoreFoundation_h
+
+#include <CoreFoundation/CFBase.h>
+#include <CoreFoundation/CFArray.h>
+#include <CoreFoundation/CFBundle.h>
+#include <CoreFoundation/CFByteOrder.h>
+#include <CoreFoundation/CFData.h>
+#include <CoreFoundation/CFDictionary.h>
+#include <CoreFoundation/CFNumber.h>
+#include <CoreFoundation/CFString.h>
+#include <dispatch/dispatch.h>
+
+#endif /* EFF_Compat_CoreFoundation_h */
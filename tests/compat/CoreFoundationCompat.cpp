@@ -0,0 +1,1361 @@
+//
+//  CoreFoundationCompat.cpp
+//  effervescence-tests
+//
+//  Stand-in for the parts of CoreFoundation declared in compat/CoreFoundation, on hosts without
+//  it. Objects are reference counted like CF's, and collections use their callbacks to retain,
+//  release and compare their values, so code that leaks or over-releases behaves the same way it
+//  would with CF. Like CF's, mutable objects aren't thread-safe. Strings are kept as UTF-8, with
+//  their UTF-16 length and characters worked out when they're asked for.
+//
+
+// Unit Include
+#include <CoreFoundation/CoreFoundation.h>
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+#pragma mark Objects
+
+namespace
+{
+    enum : CFTypeID
+    {
+        kTypeID_String = 7,
+        kTypeID_Boolean = 21,
+        kTypeID_Number = 22,
+        kTypeID_Data = 20,
+        kTypeID_Array = 19,
+        kTypeID_Dictionary = 18,
+        kTypeID_URL = 29,
+        kTypeID_UUID = 30
+    };
+
+    // CFSTR strings and the booleans are never freed.
+    const long kImmortal = -1;
+}
+
+// Not polymorphic, so the booleans can be constant-initialised and are there before any other
+// static initialiser runs. CFRelease deletes objects as their real type.
+struct __CFObject
+{
+    constexpr explicit __CFObject(CFTypeID inTypeID, long inRetainCount = 1)
+    :
+        mTypeID(inTypeID),
+        mRetainCount(inRetainCount)
+    {
+    }
+
+    const CFTypeID      mTypeID;
+    std::atomic<long>   mRetainCount;
+};
+
+struct __CFString : __CFObject
+{
+    explicit __CFString(std::string inUTF8, long inRetainCount = 1)
+    :
+        __CFObject(kTypeID_String, inRetainCount),
+        mUTF8(std::move(inUTF8))
+    {
+    }
+
+    std::u16string UTF16() const;
+
+    std::string         mUTF8;
+};
+
+struct __CFBoolean : __CFObject
+{
+    constexpr explicit __CFBoolean(bool inValue)
+    :
+        __CFObject(kTypeID_Boolean, kImmortal),
+        mValue(inValue)
+    {
+    }
+
+    const bool          mValue;
+};
+
+struct __CFNumber : __CFObject
+{
+    __CFNumber(CFNumberType inType, SInt64 inInteger, Float64 inFloat)
+    :
+        __CFObject(kTypeID_Number),
+        mType(inType),
+        mInteger(inInteger),
+        mFloat(inFloat)
+    {
+    }
+
+    bool IsFloat() const
+    {
+        return mType == kCFNumberFloat32Type || mType == kCFNumberFloat64Type ||
+               mType == kCFNumberFloatType || mType == kCFNumberDoubleType || mType == kCFNumberCGFloatType;
+    }
+
+    const CFNumberType  mType;
+    // Integers are kept in mInteger and floats in mFloat, and each is converted to the other when
+    // it's asked for.
+    const SInt64        mInteger;
+    const Float64       mFloat;
+};
+
+struct __CFData : __CFObject
+{
+    __CFData()
+    :
+        __CFObject(kTypeID_Data)
+    {
+    }
+
+    std::vector<UInt8>  mBytes;
+};
+
+struct __CFArray : __CFObject
+{
+    explicit __CFArray(const CFArrayCallBacks* inCallBacks)
+    :
+        __CFObject(kTypeID_Array),
+        mCallBacks(inCallBacks ? *inCallBacks : CFArrayCallBacks {})
+    {
+    }
+
+    ~__CFArray()
+    {
+        for(const void* theValue : mValues)
+        {
+            Release(theValue);
+        }
+    }
+
+    const void* Retain(const void* inValue) const
+    {
+        return mCallBacks.retain ? mCallBacks.retain(kCFAllocatorDefault, inValue) : inValue;
+    }
+
+    void Release(const void* inValue) const
+    {
+        if(mCallBacks.release)
+        {
+            mCallBacks.release(kCFAllocatorDefault, inValue);
+        }
+    }
+
+    bool Equal(const void* inValue1, const void* inValue2) const
+    {
+        return mCallBacks.equal ? mCallBacks.equal(inValue1, inValue2) : (inValue1 == inValue2);
+    }
+
+    const CFArrayCallBacks      mCallBacks;
+    std::vector<const void*>    mValues;
+};
+
+struct __CFDictionary : __CFObject
+{
+    __CFDictionary(const CFDictionaryKeyCallBacks* inKeyCallBacks, const CFDictionaryValueCallBacks* inValueCallBacks)
+    :
+        __CFObject(kTypeID_Dictionary),
+        mKeyCallBacks(inKeyCallBacks ? *inKeyCallBacks : CFDictionaryKeyCallBacks {}),
+        mValueCallBacks(inValueCallBacks ? *inValueCallBacks : CFDictionaryValueCallBacks {})
+    {
+    }
+
+    ~__CFDictionary()
+    {
+        RemoveAll();
+    }
+
+    // The dictionaries the driver makes are small, so a linear search is fine and keeps the
+    // entries in the order they were added.
+    std::vector<std::pair<const void*, const void*>>::iterator Find(const void* inKey)
+    {
+        return std::find_if(mEntries.begin(), mEntries.end(), [this, inKey](const auto& inEntry) {
+            return mKeyCallBacks.equal ? mKeyCallBacks.equal(inEntry.first, inKey) : (inEntry.first == inKey);
+        });
+    }
+
+    void Set(const void* inKey, const void* inValue, bool inReplace, bool inAdd)
+    {
+        auto theEntry = Find(inKey);
+
+        if(theEntry != mEntries.end())
+        {
+            if(inReplace)
+            {
+                const void* theOldValue = theEntry->second;
+                theEntry->second = RetainValue(inValue);
+                ReleaseValue(theOldValue);
+            }
+        }
+        else if(inAdd)
+        {
+            mEntries.emplace_back(RetainKey(inKey), RetainValue(inValue));
+        }
+    }
+
+    void Remove(const void* inKey)
+    {
+        auto theEntry = Find(inKey);
+
+        if(theEntry != mEntries.end())
+        {
+            std::pair<const void*, const void*> theRemoved = *theEntry;
+            mEntries.erase(theEntry);
+            ReleaseKey(theRemoved.first);
+            ReleaseValue(theRemoved.second);
+        }
+    }
+
+    void RemoveAll()
+    {
+        std::vector<std::pair<const void*, const void*>> theEntries;
+        theEntries.swap(mEntries);
+
+        for(const auto& theEntry : theEntries)
+        {
+            ReleaseKey(theEntry.first);
+            ReleaseValue(theEntry.second);
+        }
+    }
+
+    const void* RetainKey(const void* inKey) const
+    {
+        return mKeyCallBacks.retain ? mKeyCallBacks.retain(kCFAllocatorDefault, inKey) : inKey;
+    }
+
+    void ReleaseKey(const void* inKey) const
+    {
+        if(mKeyCallBacks.release)
+        {
+            mKeyCallBacks.release(kCFAllocatorDefault, inKey);
+        }
+    }
+
+    const void* RetainValue(const void* inValue) const
+    {
+        return mValueCallBacks.retain ? mValueCallBacks.retain(kCFAllocatorDefault, inValue) : inValue;
+    }
+
+    void ReleaseValue(const void* inValue) const
+    {
+        if(mValueCallBacks.release)
+        {
+            mValueCallBacks.release(kCFAllocatorDefault, inValue);
+        }
+    }
+
+    const CFDictionaryKeyCallBacks                      mKeyCallBacks;
+    const CFDictionaryValueCallBacks                    mValueCallBacks;
+    std::vector<std::pair<const void*, const void*>>    mEntries;
+};
+
+static const __CFObject* Object(CFTypeRef inObject)
+{
+    return static_cast<const __CFObject*>(inObject);
+}
+
+template <typename T>
+static T* Cast(CFTypeRef inObject, CFTypeID inTypeID)
+{
+    if(!inObject || Object(inObject)->mTypeID != inTypeID)
+    {
+        fprintf(stderr, "CoreFoundationCompat: expected an object of type %lu\n", inTypeID);
+        abort();
+    }
+
+    return const_cast<T*>(static_cast<const T*>(Object(inObject)));
+}
+
+#pragma mark CFBase
+
+const double kCFCoreFoundationVersionNumber = 1575.0;
+
+CFTypeRef CFRetain(CFTypeRef cf)
+{
+    __CFObject* theObject = const_cast<__CFObject*>(Object(cf));
+
+    if(theObject->mRetainCount.load(std::memory_order_relaxed) != kImmortal)
+    {
+        theObject->mRetainCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return cf;
+}
+
+void CFRelease(CFTypeRef cf)
+{
+    __CFObject* theObject = const_cast<__CFObject*>(Object(cf));
+
+    if(theObject->mRetainCount.load(std::memory_order_relaxed) != kImmortal &&
+       theObject->mRetainCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        switch(theObject->mTypeID)
+        {
+            case kTypeID_String:
+                delete static_cast<__CFString*>(theObject);
+                break;
+            case kTypeID_Number:
+                delete static_cast<__CFNumber*>(theObject);
+                break;
+            case kTypeID_Data:
+                delete static_cast<__CFData*>(theObject);
+                break;
+            case kTypeID_Array:
+                delete static_cast<__CFArray*>(theObject);
+                break;
+            case kTypeID_Dictionary:
+                delete static_cast<__CFDictionary*>(theObject);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+CFIndex CFGetRetainCount(CFTypeRef cf)
+{
+    const long theCount = Object(cf)->mRetainCount.load(std::memory_order_relaxed);
+    return (theCount == kImmortal) ? LONG_MAX : theCount;
+}
+
+CFTypeID CFGetTypeID(CFTypeRef cf)
+{
+    return Object(cf)->mTypeID;
+}
+
+Boolean CFEqual(CFTypeRef cf1, CFTypeRef cf2)
+{
+    if(cf1 == cf2)
+    {
+        return true;
+    }
+
+    if(CFGetTypeID(cf1) != CFGetTypeID(cf2))
+    {
+        return false;
+    }
+
+    switch(CFGetTypeID(cf1))
+    {
+        case kTypeID_String:
+            return static_cast<const __CFString*>(Object(cf1))->mUTF8 ==
+                   static_cast<const __CFString*>(Object(cf2))->mUTF8;
+
+        case kTypeID_Number:
+            return CFNumberCompare(static_cast<CFNumberRef>(cf1), static_cast<CFNumberRef>(cf2), nullptr) ==
+                   kCFCompareEqualTo;
+
+        case kTypeID_Data:
+            return static_cast<const __CFData*>(Object(cf1))->mBytes ==
+                   static_cast<const __CFData*>(Object(cf2))->mBytes;
+
+        case kTypeID_Array:
+        {
+            const __CFArray* theArray1 = static_cast<const __CFArray*>(Object(cf1));
+            const __CFArray* theArray2 = static_cast<const __CFArray*>(Object(cf2));
+
+            if(theArray1->mValues.size() != theArray2->mValues.size())
+            {
+                return false;
+            }
+
+            for(size_t i = 0; i < theArray1->mValues.size(); i++)
+            {
+                if(!theArray1->Equal(theArray1->mValues[i], theArray2->mValues[i]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        case kTypeID_Dictionary:
+        {
+            __CFDictionary* theDict1 = Cast<__CFDictionary>(cf1, kTypeID_Dictionary);
+            __CFDictionary* theDict2 = Cast<__CFDictionary>(cf2, kTypeID_Dictionary);
+
+            if(theDict1->mEntries.size() != theDict2->mEntries.size())
+            {
+                return false;
+            }
+
+            for(const auto& theEntry : theDict1->mEntries)
+            {
+                auto theOther = theDict2->Find(theEntry.first);
+
+                if(theOther == theDict2->mEntries.end())
+                {
+                    return false;
+                }
+
+                const bool theValuesEqual = theDict1->mValueCallBacks.equal ?
+                                            theDict1->mValueCallBacks.equal(theEntry.second, theOther->second) :
+                                            (theEntry.second == theOther->second);
+
+                if(!theValuesEqual)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        default:
+            // Booleans are singletons, so they were handled above.
+            return false;
+    }
+}
+
+CFHashCode CFHash(CFTypeRef cf)
+{
+    switch(CFGetTypeID(cf))
+    {
+        case kTypeID_String:
+            return std::hash<std::string>()(static_cast<const __CFString*>(Object(cf))->mUTF8);
+
+        case kTypeID_Number:
+        {
+            Float64 theValue = 0.0;
+            CFNumberGetValue(static_cast<CFNumberRef>(cf), kCFNumberFloat64Type, &theValue);
+            return std::hash<Float64>()(theValue);
+        }
+
+        case kTypeID_Data:
+            return static_cast<const __CFData*>(Object(cf))->mBytes.size();
+
+        case kTypeID_Array:
+            return static_cast<const __CFArray*>(Object(cf))->mValues.size();
+
+        case kTypeID_Dictionary:
+            return static_cast<const __CFDictionary*>(Object(cf))->mEntries.size();
+
+        default:
+            return reinterpret_cast<CFHashCode>(cf);
+    }
+}
+
+static void Show(CFTypeRef inObject, int inIndent)
+{
+    if(!inObject)
+    {
+        fprintf(stderr, "(null)");
+        return;
+    }
+
+    switch(CFGetTypeID(inObject))
+    {
+        case kTypeID_String:
+            fprintf(stderr, "\"%s\"", static_cast<const __CFString*>(Object(inObject))->mUTF8.c_str());
+            break;
+
+        case kTypeID_Boolean:
+            fprintf(stderr, "%s", CFBooleanGetValue(static_cast<CFBooleanRef>(inObject)) ? "true" : "false");
+            break;
+
+        case kTypeID_Number:
+        {
+            const __CFNumber* theNumber = static_cast<const __CFNumber*>(Object(inObject));
+
+            if(theNumber->IsFloat())
+            {
+                fprintf(stderr, "%g", theNumber->mFloat);
+            }
+            else
+            {
+                fprintf(stderr, "%lld", static_cast<long long>(theNumber->mInteger));
+            }
+
+            break;
+        }
+
+        case kTypeID_Data:
+            fprintf(stderr, "<%zu bytes>", static_cast<const __CFData*>(Object(inObject))->mBytes.size());
+            break;
+
+        case kTypeID_Array:
+            fprintf(stderr, "(\n");
+
+            for(const void* theValue : static_cast<const __CFArray*>(Object(inObject))->mValues)
+            {
+                fprintf(stderr, "%*s", inIndent + 4, "");
+                Show(theValue, inIndent + 4);
+                fprintf(stderr, ",\n");
+            }
+
+            fprintf(stderr, "%*s)", inIndent, "");
+            break;
+
+        case kTypeID_Dictionary:
+            fprintf(stderr, "{\n");
+
+            for(const auto& theEntry : static_cast<const __CFDictionary*>(Object(inObject))->mEntries)
+            {
+                fprintf(stderr, "%*s", inIndent + 4, "");
+                Show(theEntry.first, inIndent + 4);
+                fprintf(stderr, " = ");
+                Show(theEntry.second, inIndent + 4);
+                fprintf(stderr, ";\n");
+            }
+
+            fprintf(stderr, "%*s}", inIndent, "");
+            break;
+
+        default:
+            fprintf(stderr, "<%p>", inObject);
+            break;
+    }
+}
+
+void CFShow(CFTypeRef obj)
+{
+    Show(obj, 0);
+    fprintf(stderr, "\n");
+}
+
+#pragma mark CFString
+
+std::u16string __CFString::UTF16() const
+{
+    std::u16string theUTF16;
+    theUTF16.reserve(mUTF8.size());
+
+    for(size_t i = 0; i < mUTF8.size(); )
+    {
+        const UInt8 theLead = static_cast<UInt8>(mUTF8[i]);
+        const size_t theLength = (theLead < 0x80) ? 1 : (theLead < 0xE0) ? 2 : (theLead < 0xF0) ? 3 : 4;
+        UInt32 theCodePoint = (theLength == 1) ? theLead : (theLead & (0x7F >> theLength));
+
+        for(size_t j = 1; j < theLength && i + j < mUTF8.size(); j++)
+        {
+            theCodePoint = (theCodePoint << 6) | (static_cast<UInt8>(mUTF8[i + j]) & 0x3F);
+        }
+
+        if(theCodePoint >= 0x10000)
+        {
+            theCodePoint -= 0x10000;
+            theUTF16.push_back(static_cast<char16_t>(0xD800 + (theCodePoint >> 10)));
+            theUTF16.push_back(static_cast<char16_t>(0xDC00 + (theCodePoint & 0x3FF)));
+        }
+        else
+        {
+            theUTF16.push_back(static_cast<char16_t>(theCodePoint));
+        }
+
+        i += theLength;
+    }
+
+    return theUTF16;
+}
+
+static std::string UTF8FromUTF16(const char16_t* inCharacters, size_t inLength)
+{
+    std::string theUTF8;
+
+    for(size_t i = 0; i < inLength; i++)
+    {
+        UInt32 theCodePoint = inCharacters[i];
+
+        if(theCodePoint >= 0xD800 && theCodePoint < 0xDC00 && i + 1 < inLength)
+        {
+            theCodePoint = 0x10000 + ((theCodePoint - 0xD800) << 10) + (inCharacters[++i] - 0xDC00);
+        }
+
+        if(theCodePoint < 0x80)
+        {
+            theUTF8.push_back(static_cast<char>(theCodePoint));
+        }
+        else if(theCodePoint < 0x800)
+        {
+            theUTF8.push_back(static_cast<char>(0xC0 | (theCodePoint >> 6)));
+            theUTF8.push_back(static_cast<char>(0x80 | (theCodePoint & 0x3F)));
+        }
+        else if(theCodePoint < 0x10000)
+        {
+            theUTF8.push_back(static_cast<char>(0xE0 | (theCodePoint >> 12)));
+            theUTF8.push_back(static_cast<char>(0x80 | ((theCodePoint >> 6) & 0x3F)));
+            theUTF8.push_back(static_cast<char>(0x80 | (theCodePoint & 0x3F)));
+        }
+        else
+        {
+            theUTF8.push_back(static_cast<char>(0xF0 | (theCodePoint >> 18)));
+            theUTF8.push_back(static_cast<char>(0x80 | ((theCodePoint >> 12) & 0x3F)));
+            theUTF8.push_back(static_cast<char>(0x80 | ((theCodePoint >> 6) & 0x3F)));
+            theUTF8.push_back(static_cast<char>(0x80 | (theCodePoint & 0x3F)));
+        }
+    }
+
+    return theUTF8;
+}
+
+static bool IsASCII(const std::string& inString)
+{
+    return std::all_of(inString.begin(), inString.end(), [](char inChar) {
+        return static_cast<UInt8>(inChar) < 0x80;
+    });
+}
+
+static const std::string& UTF8(CFStringRef inString)
+{
+    return Cast<__CFString>(inString, kTypeID_String)->mUTF8;
+}
+
+CFStringRef __CFStringMakeConstantString(const char* cStr)
+{
+    static std::mutex sMutex;
+    static auto* sStrings = new std::unordered_map<std::string, __CFString*>();
+
+    std::lock_guard<std::mutex> theLock(sMutex);
+    __CFString*& theString = (*sStrings)[cStr];
+
+    if(!theString)
+    {
+        theString = new __CFString(cStr, kImmortal);
+    }
+
+    return theString;
+}
+
+CFTypeID CFStringGetTypeID(void)
+{
+    return kTypeID_String;
+}
+
+CFStringRef CFStringCreateWithCString(CFAllocatorRef alloc, const char* cStr, CFStringEncoding encoding)
+{
+    (void)alloc;
+
+    if(!cStr || (encoding == kCFStringEncodingASCII && !IsASCII(cStr)))
+    {
+        return nullptr;
+    }
+
+    return new __CFString(cStr);
+}
+
+CFStringRef CFStringCreateWithCharacters(CFAllocatorRef alloc, const UniChar* chars, CFIndex numChars)
+{
+    (void)alloc;
+    return new __CFString(UTF8FromUTF16(reinterpret_cast<const char16_t*>(chars), static_cast<size_t>(numChars)));
+}
+
+CFStringRef CFStringCreateCopy(CFAllocatorRef alloc, CFStringRef theString)
+{
+    (void)alloc;
+    return new __CFString(UTF8(theString));
+}
+
+CFMutableStringRef CFStringCreateMutable(CFAllocatorRef alloc, CFIndex maxLength)
+{
+    (void)alloc;
+    (void)maxLength;
+    return new __CFString("");
+}
+
+CFMutableStringRef CFStringCreateMutableCopy(CFAllocatorRef alloc, CFIndex maxLength, CFStringRef theString)
+{
+    (void)alloc;
+    (void)maxLength;
+    return new __CFString(UTF8(theString));
+}
+
+CFIndex CFStringGetLength(CFStringRef theString)
+{
+    const std::string& theUTF8 = UTF8(theString);
+    return IsASCII(theUTF8) ? static_cast<CFIndex>(theUTF8.size()) :
+                              static_cast<CFIndex>(Cast<__CFString>(theString, kTypeID_String)->UTF16().size());
+}
+
+UniChar CFStringGetCharacterAtIndex(CFStringRef theString, CFIndex idx)
+{
+    return Cast<__CFString>(theString, kTypeID_String)->UTF16().at(static_cast<size_t>(idx));
+}
+
+void CFStringGetCharacters(CFStringRef theString, CFRange range, UniChar* buffer)
+{
+    const std::u16string theUTF16 = Cast<__CFString>(theString, kTypeID_String)->UTF16();
+    std::copy_n(theUTF16.begin() + range.location, range.length, buffer);
+}
+
+Boolean CFStringGetCString(CFStringRef theString, char* buffer, CFIndex bufferSize, CFStringEncoding encoding)
+{
+    const std::string& theUTF8 = UTF8(theString);
+
+    if(static_cast<CFIndex>(theUTF8.size()) >= bufferSize || (encoding == kCFStringEncodingASCII && !IsASCII(theUTF8)))
+    {
+        return false;
+    }
+
+    memcpy(buffer, theUTF8.c_str(), theUTF8.size() + 1);
+    return true;
+}
+
+const char* CFStringGetCStringPtr(CFStringRef theString, CFStringEncoding encoding)
+{
+    const std::string& theUTF8 = UTF8(theString);
+    return (encoding == kCFStringEncodingUTF8 || IsASCII(theUTF8)) ? theUTF8.c_str() : nullptr;
+}
+
+CFIndex CFStringGetBytes(CFStringRef theString,
+                         CFRange range,
+                         CFStringEncoding encoding,
+                         UInt8 lossByte,
+                         Boolean isExternalRepresentation,
+                         UInt8* buffer,
+                         CFIndex maxBufLen,
+                         CFIndex* usedBufLen)
+{
+    (void)isExternalRepresentation;
+
+    const std::u16string theUTF16 = Cast<__CFString>(theString, kTypeID_String)->UTF16();
+    CFIndex theConverted = 0;
+    CFIndex theUsed = 0;
+
+    for(CFIndex i = range.location; i < range.location + range.length; i++)
+    {
+        std::string theBytes = UTF8FromUTF16(&theUTF16[static_cast<size_t>(i)], 1);
+
+        if(encoding == kCFStringEncodingASCII && !IsASCII(theBytes))
+        {
+            if(lossByte == 0)
+            {
+                break;
+            }
+
+            theBytes = std::string(1, static_cast<char>(lossByte));
+        }
+
+        if(buffer && theUsed + static_cast<CFIndex>(theBytes.size()) > maxBufLen)
+        {
+            break;
+        }
+
+        if(buffer)
+        {
+            memcpy(buffer + theUsed, theBytes.data(), theBytes.size());
+        }
+
+        theUsed += static_cast<CFIndex>(theBytes.size());
+        theConverted++;
+    }
+
+    if(usedBufLen)
+    {
+        *usedBufLen = theUsed;
+    }
+
+    return theConverted;
+}
+
+CFIndex CFStringGetMaximumSizeForEncoding(CFIndex length, CFStringEncoding encoding)
+{
+    return (encoding == kCFStringEncodingUTF8) ? length * 3 : length;
+}
+
+Boolean CFStringGetFileSystemRepresentation(CFStringRef string, char* buffer, CFIndex maxBufLen)
+{
+    return CFStringGetCString(string, buffer, maxBufLen, kCFStringEncodingUTF8);
+}
+
+CFComparisonResult CFStringCompare(CFStringRef theString1, CFStringRef theString2, CFStringCompareFlags compareOptions)
+{
+    std::string theUTF8_1 = UTF8(theString1);
+    std::string theUTF8_2 = UTF8(theString2);
+
+    if(compareOptions & kCFCompareCaseInsensitive)
+    {
+        auto theToLower = [](std::string& ioString) {
+            std::transform(ioString.begin(), ioString.end(), ioString.begin(), [](char inChar) {
+                return static_cast<char>(tolower(static_cast<unsigned char>(inChar)));
+            });
+        };
+
+        theToLower(theUTF8_1);
+        theToLower(theUTF8_2);
+    }
+
+    const int theResult = theUTF8_1.compare(theUTF8_2);
+    return (theResult < 0) ? kCFCompareLessThan : (theResult > 0) ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+Boolean CFStringHasPrefix(CFStringRef theString, CFStringRef prefix)
+{
+    const std::string& theUTF8 = UTF8(theString);
+    const std::string& thePrefix = UTF8(prefix);
+    return theUTF8.compare(0, thePrefix.size(), thePrefix) == 0;
+}
+
+Boolean CFStringHasSuffix(CFStringRef theString, CFStringRef suffix)
+{
+    const std::string& theUTF8 = UTF8(theString);
+    const std::string& theSuffix = UTF8(suffix);
+    return theUTF8.size() >= theSuffix.size() &&
+           theUTF8.compare(theUTF8.size() - theSuffix.size(), theSuffix.size(), theSuffix) == 0;
+}
+
+SInt32 CFStringGetIntValue(CFStringRef str)
+{
+    return static_cast<SInt32>(strtol(UTF8(str).c_str(), nullptr, 10));
+}
+
+double CFStringGetDoubleValue(CFStringRef str)
+{
+    return strtod(UTF8(str).c_str(), nullptr);
+}
+
+void CFStringAppend(CFMutableStringRef theString, CFStringRef appendedString)
+{
+    const std::string theAppended = UTF8(appendedString);
+    Cast<__CFString>(theString, kTypeID_String)->mUTF8 += theAppended;
+}
+
+void CFStringAppendCString(CFMutableStringRef theString, const char* cStr, CFStringEncoding encoding)
+{
+    (void)encoding;
+    Cast<__CFString>(theString, kTypeID_String)->mUTF8 += cStr;
+}
+
+#pragma mark CFBoolean and CFNumber
+
+static __CFBoolean sTrue(true);
+static __CFBoolean sFalse(false);
+
+const CFBooleanRef kCFBooleanTrue = &sTrue;
+const CFBooleanRef kCFBooleanFalse = &sFalse;
+
+CFTypeID CFBooleanGetTypeID(void)
+{
+    return kTypeID_Boolean;
+}
+
+Boolean CFBooleanGetValue(CFBooleanRef boolean)
+{
+    return Cast<__CFBoolean>(boolean, kTypeID_Boolean)->mValue;
+}
+
+CFTypeID CFNumberGetTypeID(void)
+{
+    return kTypeID_Number;
+}
+
+CFNumberRef CFNumberCreate(CFAllocatorRef allocator, CFNumberType theType, const void* valuePtr)
+{
+    (void)allocator;
+
+    switch(theType)
+    {
+        case kCFNumberSInt8Type:
+        case kCFNumberCharType:
+            return new __CFNumber(theType, *static_cast<const SInt8*>(valuePtr), 0.0);
+        case kCFNumberSInt16Type:
+        case kCFNumberShortType:
+            return new __CFNumber(theType, *static_cast<const SInt16*>(valuePtr), 0.0);
+        case kCFNumberSInt32Type:
+        case kCFNumberIntType:
+            return new __CFNumber(theType, *static_cast<const SInt32*>(valuePtr), 0.0);
+        case kCFNumberSInt64Type:
+        case kCFNumberLongLongType:
+            return new __CFNumber(theType, *static_cast<const SInt64*>(valuePtr), 0.0);
+        case kCFNumberLongType:
+        case kCFNumberCFIndexType:
+        case kCFNumberNSIntegerType:
+            return new __CFNumber(theType, *static_cast<const long*>(valuePtr), 0.0);
+        case kCFNumberFloat32Type:
+        case kCFNumberFloatType:
+            return new __CFNumber(theType, 0, *static_cast<const Float32*>(valuePtr));
+        case kCFNumberFloat64Type:
+        case kCFNumberDoubleType:
+        case kCFNumberCGFloatType:
+            return new __CFNumber(theType, 0, *static_cast<const Float64*>(valuePtr));
+    }
+
+    return nullptr;
+}
+
+CFNumberType CFNumberGetType(CFNumberRef number)
+{
+    return Cast<__CFNumber>(number, kTypeID_Number)->mType;
+}
+
+Boolean CFNumberIsFloatType(CFNumberRef number)
+{
+    return Cast<__CFNumber>(number, kTypeID_Number)->IsFloat();
+}
+
+template <typename T>
+static Boolean GetNumberValue(const __CFNumber* inNumber, void* outValue)
+{
+    if constexpr(std::is_floating_point<T>::value)
+    {
+        const Float64 theValue = inNumber->IsFloat() ? inNumber->mFloat : static_cast<Float64>(inNumber->mInteger);
+        *static_cast<T*>(outValue) = static_cast<T>(theValue);
+        return static_cast<Float64>(static_cast<T>(theValue)) == theValue || std::isnan(theValue);
+    }
+    else if(inNumber->IsFloat())
+    {
+        // CF truncates towards zero and clamps to the type's range.
+        const Float64 theValue = std::trunc(inNumber->mFloat);
+        const Float64 theClamped = std::min<Float64>(std::max<Float64>(theValue, std::numeric_limits<T>::min()),
+                                                     std::numeric_limits<T>::max());
+        *static_cast<T*>(outValue) = static_cast<T>(theClamped);
+        return theClamped == inNumber->mFloat;
+    }
+
+    else
+    {
+        *static_cast<T*>(outValue) = static_cast<T>(inNumber->mInteger);
+        return static_cast<SInt64>(static_cast<T>(inNumber->mInteger)) == inNumber->mInteger;
+    }
+}
+
+Boolean CFNumberGetValue(CFNumberRef number, CFNumberType theType, void* valuePtr)
+{
+    const __CFNumber* theNumber = Cast<__CFNumber>(number, kTypeID_Number);
+
+    switch(theType)
+    {
+        case kCFNumberSInt8Type:
+        case kCFNumberCharType:
+            return GetNumberValue<SInt8>(theNumber, valuePtr);
+        case kCFNumberSInt16Type:
+        case kCFNumberShortType:
+            return GetNumberValue<SInt16>(theNumber, valuePtr);
+        case kCFNumberSInt32Type:
+        case kCFNumberIntType:
+            return GetNumberValue<SInt32>(theNumber, valuePtr);
+        case kCFNumberSInt64Type:
+        case kCFNumberLongLongType:
+            return GetNumberValue<SInt64>(theNumber, valuePtr);
+        case kCFNumberLongType:
+        case kCFNumberCFIndexType:
+        case kCFNumberNSIntegerType:
+            return GetNumberValue<long>(theNumber, valuePtr);
+        case kCFNumberFloat32Type:
+        case kCFNumberFloatType:
+            return GetNumberValue<Float32>(theNumber, valuePtr);
+        case kCFNumberFloat64Type:
+        case kCFNumberDoubleType:
+        case kCFNumberCGFloatType:
+            return GetNumberValue<Float64>(theNumber, valuePtr);
+    }
+
+    return false;
+}
+
+CFComparisonResult CFNumberCompare(CFNumberRef number, CFNumberRef otherNumber, void* context)
+{
+    (void)context;
+
+    const __CFNumber* theNumber1 = Cast<__CFNumber>(number, kTypeID_Number);
+    const __CFNumber* theNumber2 = Cast<__CFNumber>(otherNumber, kTypeID_Number);
+
+    if(!theNumber1->IsFloat() && !theNumber2->IsFloat())
+    {
+        return (theNumber1->mInteger < theNumber2->mInteger) ? kCFCompareLessThan :
+               (theNumber1->mInteger > theNumber2->mInteger) ? kCFCompareGreaterThan : kCFCompareEqualTo;
+    }
+
+    const Float64 theValue1 = theNumber1->IsFloat() ? theNumber1->mFloat : static_cast<Float64>(theNumber1->mInteger);
+    const Float64 theValue2 = theNumber2->IsFloat() ? theNumber2->mFloat : static_cast<Float64>(theNumber2->mInteger);
+
+    return (theValue1 < theValue2) ? kCFCompareLessThan :
+           (theValue1 > theValue2) ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+#pragma mark CFData
+
+CFTypeID CFDataGetTypeID(void)
+{
+    return kTypeID_Data;
+}
+
+CFDataRef CFDataCreate(CFAllocatorRef allocator, const UInt8* bytes, CFIndex length)
+{
+    (void)allocator;
+
+    __CFData* theData = new __CFData();
+    theData->mBytes.assign(bytes, bytes + length);
+    return theData;
+}
+
+CFMutableDataRef CFDataCreateMutable(CFAllocatorRef allocator, CFIndex capacity)
+{
+    (void)allocator;
+
+    __CFData* theData = new __CFData();
+    theData->mBytes.reserve(static_cast<size_t>(capacity));
+    return theData;
+}
+
+CFIndex CFDataGetLength(CFDataRef theData)
+{
+    return static_cast<CFIndex>(Cast<__CFData>(theData, kTypeID_Data)->mBytes.size());
+}
+
+const UInt8* CFDataGetBytePtr(CFDataRef theData)
+{
+    return Cast<__CFData>(theData, kTypeID_Data)->mBytes.data();
+}
+
+UInt8* CFDataGetMutableBytePtr(CFMutableDataRef theData)
+{
+    return Cast<__CFData>(theData, kTypeID_Data)->mBytes.data();
+}
+
+void CFDataSetLength(CFMutableDataRef theData, CFIndex length)
+{
+    Cast<__CFData>(theData, kTypeID_Data)->mBytes.resize(static_cast<size_t>(length), 0);
+}
+
+void CFDataAppendBytes(CFMutableDataRef theData, const UInt8* bytes, CFIndex length)
+{
+    std::vector<UInt8>& theBytes = Cast<__CFData>(theData, kTypeID_Data)->mBytes;
+    theBytes.insert(theBytes.end(), bytes, bytes + length);
+}
+
+#pragma mark CFArray
+
+static const void* RetainCallBack(CFAllocatorRef inAllocator, const void* inValue)
+{
+    (void)inAllocator;
+    return CFRetain(inValue);
+}
+
+static void ReleaseCallBack(CFAllocatorRef inAllocator, const void* inValue)
+{
+    (void)inAllocator;
+    CFRelease(inValue);
+}
+
+static Boolean EqualCallBack(const void* inValue1, const void* inValue2)
+{
+    return CFEqual(inValue1, inValue2);
+}
+
+static CFHashCode HashCallBack(const void* inValue)
+{
+    return CFHash(inValue);
+}
+
+const CFArrayCallBacks kCFTypeArrayCallBacks = { 0, RetainCallBack, ReleaseCallBack, nullptr, EqualCallBack };
+
+CFTypeID CFArrayGetTypeID(void)
+{
+    return kTypeID_Array;
+}
+
+CFArrayRef CFArrayCreate(CFAllocatorRef allocator,
+                         const void** values,
+                         CFIndex numValues,
+                         const CFArrayCallBacks* callBacks)
+{
+    CFMutableArrayRef theArray = CFArrayCreateMutable(allocator, numValues, callBacks);
+
+    for(CFIndex i = 0; i < numValues; i++)
+    {
+        CFArrayAppendValue(theArray, values[i]);
+    }
+
+    return theArray;
+}
+
+CFArrayRef CFArrayCreateCopy(CFAllocatorRef allocator, CFArrayRef theArray)
+{
+    return CFArrayCreateMutableCopy(allocator, 0, theArray);
+}
+
+CFMutableArrayRef CFArrayCreateMutable(CFAllocatorRef allocator, CFIndex capacity, const CFArrayCallBacks* callBacks)
+{
+    (void)allocator;
+
+    __CFArray* theArray = new __CFArray(callBacks);
+    theArray->mValues.reserve(static_cast<size_t>(capacity));
+    return theArray;
+}
+
+CFMutableArrayRef CFArrayCreateMutableCopy(CFAllocatorRef allocator, CFIndex capacity, CFArrayRef theArray)
+{
+    const __CFArray* theSource = Cast<__CFArray>(theArray, kTypeID_Array);
+    CFMutableArrayRef theCopy = CFArrayCreateMutable(allocator, capacity, &theSource->mCallBacks);
+
+    for(const void* theValue : theSource->mValues)
+    {
+        CFArrayAppendValue(theCopy, theValue);
+    }
+
+    return theCopy;
+}
+
+CFIndex CFArrayGetCount(CFArrayRef theArray)
+{
+    return static_cast<CFIndex>(Cast<__CFArray>(theArray, kTypeID_Array)->mValues.size());
+}
+
+const void* CFArrayGetValueAtIndex(CFArrayRef theArray, CFIndex idx)
+{
+    return Cast<__CFArray>(theArray, kTypeID_Array)->mValues.at(static_cast<size_t>(idx));
+}
+
+CFIndex CFArrayGetFirstIndexOfValue(CFArrayRef theArray, CFRange range, const void* value)
+{
+    const __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+
+    for(CFIndex i = range.location; i < range.location + range.length; i++)
+    {
+        if(theCFArray->Equal(theCFArray->mValues.at(static_cast<size_t>(i)), value))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+Boolean CFArrayContainsValue(CFArrayRef theArray, CFRange range, const void* value)
+{
+    return CFArrayGetFirstIndexOfValue(theArray, range, value) != -1;
+}
+
+void CFArrayAppendValue(CFMutableArrayRef theArray, const void* value)
+{
+    __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+    theCFArray->mValues.push_back(theCFArray->Retain(value));
+}
+
+void CFArrayInsertValueAtIndex(CFMutableArrayRef theArray, CFIndex idx, const void* value)
+{
+    __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+    theCFArray->mValues.insert(theCFArray->mValues.begin() + idx, theCFArray->Retain(value));
+}
+
+void CFArraySetValueAtIndex(CFMutableArrayRef theArray, CFIndex idx, const void* value)
+{
+    __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+
+    if(idx == static_cast<CFIndex>(theCFArray->mValues.size()))
+    {
+        CFArrayAppendValue(theArray, value);
+        return;
+    }
+
+    const void* theOldValue = theCFArray->mValues.at(static_cast<size_t>(idx));
+    theCFArray->mValues[static_cast<size_t>(idx)] = theCFArray->Retain(value);
+    theCFArray->Release(theOldValue);
+}
+
+void CFArrayRemoveValueAtIndex(CFMutableArrayRef theArray, CFIndex idx)
+{
+    __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+    const void* theValue = theCFArray->mValues.at(static_cast<size_t>(idx));
+    theCFArray->mValues.erase(theCFArray->mValues.begin() + idx);
+    theCFArray->Release(theValue);
+}
+
+void CFArrayRemoveAllValues(CFMutableArrayRef theArray)
+{
+    __CFArray* theCFArray = Cast<__CFArray>(theArray, kTypeID_Array);
+    std::vector<const void*> theValues;
+    theValues.swap(theCFArray->mValues);
+
+    for(const void* theValue : theValues)
+    {
+        theCFArray->Release(theValue);
+    }
+}
+
+void CFArraySortValues(CFMutableArrayRef theArray, CFRange range, CFComparatorFunction comparator, void* context)
+{
+    std::vector<const void*>& theValues = Cast<__CFArray>(theArray, kTypeID_Array)->mValues;
+
+    std::stable_sort(theValues.begin() + range.location,
+                     theValues.begin() + range.location + range.length,
+                     [comparator, context](const void* inValue1, const void* inValue2) {
+                         return comparator(inValue1, inValue2, context) == kCFCompareLessThan;
+                     });
+}
+
+#pragma mark CFDictionary
+
+const CFDictionaryKeyCallBacks kCFTypeDictionaryKeyCallBacks =
+    { 0, RetainCallBack, ReleaseCallBack, nullptr, EqualCallBack, HashCallBack };
+
+// CF copies mutable keys with these. The driver only uses immutable ones, so retaining is the same.
+const CFDictionaryKeyCallBacks kCFCopyStringDictionaryKeyCallBacks =
+    { 0, RetainCallBack, ReleaseCallBack, nullptr, EqualCallBack, HashCallBack };
+
+const CFDictionaryValueCallBacks kCFTypeDictionaryValueCallBacks =
+    { 0, RetainCallBack, ReleaseCallBack, nullptr, EqualCallBack };
+
+CFTypeID CFDictionaryGetTypeID(void)
+{
+    return kTypeID_Dictionary;
+}
+
+CFDictionaryRef CFDictionaryCreate(CFAllocatorRef allocator,
+                                   const void** keys,
+                                   const void** values,
+                                   CFIndex numValues,
+                                   const CFDictionaryKeyCallBacks* keyCallBacks,
+                                   const CFDictionaryValueCallBacks* valueCallBacks)
+{
+    CFMutableDictionaryRef theDict = CFDictionaryCreateMutable(allocator, numValues, keyCallBacks, valueCallBacks);
+
+    for(CFIndex i = 0; i < numValues; i++)
+    {
+        CFDictionarySetValue(theDict, keys[i], values[i]);
+    }
+
+    return theDict;
+}
+
+CFDictionaryRef CFDictionaryCreateCopy(CFAllocatorRef allocator, CFDictionaryRef theDict)
+{
+    return CFDictionaryCreateMutableCopy(allocator, 0, theDict);
+}
+
+CFMutableDictionaryRef CFDictionaryCreateMutable(CFAllocatorRef allocator,
+                                                 CFIndex capacity,
+                                                 const CFDictionaryKeyCallBacks* keyCallBacks,
+                                                 const CFDictionaryValueCallBacks* valueCallBacks)
+{
+    (void)allocator;
+
+    __CFDictionary* theDict = new __CFDictionary(keyCallBacks, valueCallBacks);
+    theDict->mEntries.reserve(static_cast<size_t>(capacity));
+    return theDict;
+}
+
+CFMutableDictionaryRef CFDictionaryCreateMutableCopy(CFAllocatorRef allocator, CFIndex capacity, CFDictionaryRef theDict)
+{
+    const __CFDictionary* theSource = Cast<__CFDictionary>(theDict, kTypeID_Dictionary);
+    CFMutableDictionaryRef theCopy = CFDictionaryCreateMutable(allocator,
+                                                               capacity,
+                                                               &theSource->mKeyCallBacks,
+                                                               &theSource->mValueCallBacks);
+
+    for(const auto& theEntry : theSource->mEntries)
+    {
+        CFDictionarySetValue(theCopy, theEntry.first, theEntry.second);
+    }
+
+    return theCopy;
+}
+
+CFIndex CFDictionaryGetCount(CFDictionaryRef theDict)
+{
+    return static_cast<CFIndex>(Cast<__CFDictionary>(theDict, kTypeID_Dictionary)->mEntries.size());
+}
+
+Boolean CFDictionaryGetValueIfPresent(CFDictionaryRef theDict, const void* key, const void** value)
+{
+    __CFDictionary* theCFDict = Cast<__CFDictionary>(theDict, kTypeID_Dictionary);
+    auto theEntry = theCFDict->Find(key);
+
+    if(theEntry == theCFDict->mEntries.end())
+    {
+        return false;
+    }
+
+    if(value)
+    {
+        *value = theEntry->second;
+    }
+
+    return true;
+}
+
+Boolean CFDictionaryContainsKey(CFDictionaryRef theDict, const void* key)
+{
+    return CFDictionaryGetValueIfPresent(theDict, key, nullptr);
+}
+
+const void* CFDictionaryGetValue(CFDictionaryRef theDict, const void* key)
+{
+    const void* theValue = nullptr;
+    CFDictionaryGetValueIfPresent(theDict, key, &theValue);
+    return theValue;
+}
+
+void CFDictionaryGetKeysAndValues(CFDictionaryRef theDict, const void** keys, const void** values)
+{
+    const __CFDictionary* theCFDict = Cast<__CFDictionary>(theDict, kTypeID_Dictionary);
+
+    for(size_t i = 0; i < theCFDict->mEntries.size(); i++)
+    {
+        if(keys)
+        {
+            keys[i] = theCFDict->mEntries[i].first;
+        }
+
+        if(values)
+        {
+            values[i] = theCFDict->mEntries[i].second;
+        }
+    }
+}
+
+void CFDictionaryAddValue(CFMutableDictionaryRef theDict, const void* key, const void* value)
+{
+    Cast<__CFDictionary>(theDict, kTypeID_Dictionary)->Set(key, value, false, true);
+}
+
+void CFDictionarySetValue(CFMutableDictionaryRef theDict, const void* key, const void* value)
+{
+    Cast<__CFDictionary>(theDict, kTypeID_Dictionary)->Set(key, value, true, true);
+}
+
+void CFDictionaryRemoveValue(CFMutableDictionaryRef theDict, const void* key)
+{
+    Cast<__CFDictionary>(theDict, kTypeID_Dictionary)->Remove(key);
+}
+
+void CFDictionaryRemoveAllValues(CFMutableDictionaryRef theDict)
+{
+    Cast<__CFDictionary>(theDict, kTypeID_Dictionary)->RemoveAll();
+}
+
+#pragma mark CFBundle, CFURL and CFUUID
+
+CFTypeID CFURLGetTypeID(void)
+{
+    return kTypeID_URL;
+}
+
+CFTypeID CFUUIDGetTypeID(void)
+{
+    return kTypeID_UUID;
+}
+
+CFBundleRef CFBundleGetBundleWithIdentifier(CFStringRef bundleID)
+{
+    (void)bundleID;
+    return nullptr;
+}
+
+CFURLRef CFBundleCopyResourceURL(CFBundleRef bundle,
+                                 CFStringRef resourceName,
+                                 CFStringRef resourceType,
+                                 CFStringRef subDirName)
+{
+    (void)bundle;
+    (void)resourceName;
+    (void)resourceType;
+    (void)subDirName;
+    return nullptr;
+}
@@ -0,0 +1,207 @@
+//
+//  DispatchCompat.cpp
+//  effervescence-tests
+//
+//  Stand-in for libdispatch on hosts without it. Each queue is a thread that runs its tasks in
+//  order, at or after the time they were submitted for. See compat/dispatch/dispatch.h.
+//
+
+// Unit Include
+#include <dispatch/dispatch.h>
+
+// STL Includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// System Includes
+#include <mach/mach_time.h>
+
+
+struct dispatch_queue_s
+{
+    struct Task
+    {
+        dispatch_time_t         mWhen;
+        void*                   mContext;
+        dispatch_function_t     mWork;
+    };
+
+    explicit dispatch_queue_s(const char* inLabel)
+    :
+        mLabel(inLabel ? inLabel : ""),
+        mRetainCount(1)
+    {
+        // The thread owns the queue once the last reference is released, so it's never joined.
+        std::thread(&dispatch_queue_s::Run, this).detach();
+    }
+
+    void Submit(dispatch_time_t inWhen, void* inContext, dispatch_function_t inWork)
+    {
+        std::lock_guard<std::mutex> theLock(mMutex);
+
+        // Keep the tasks sorted by time, with tasks for the same time in the order they came.
+        auto theTask = mTasks.end();
+
+        while(theTask != mTasks.begin() && std::prev(theTask)->mWhen > inWhen)
+        {
+            --theTask;
+        }
+
+        mTasks.insert(theTask, Task { inWhen, inContext, inWork });
+        mCondition.notify_one();
+    }
+
+    void Release()
+    {
+        if(mRetainCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> theLock(mMutex);
+            mReleased = true;
+            mCondition.notify_one();
+        }
+    }
+
+    void Run()
+    {
+        std::unique_lock<std::mutex> theLock(mMutex);
+
+        while(true)
+        {
+            if(mTasks.empty())
+            {
+                // Like libdispatch, a released queue still runs the tasks it already has.
+                if(mReleased)
+                {
+                    break;
+                }
+
+                mCondition.wait(theLock);
+                continue;
+            }
+
+            const dispatch_time_t theNow = mach_absolute_time();
+
+            if(mTasks.front().mWhen > theNow)
+            {
+                mCondition.wait_for(theLock, std::chrono::nanoseconds(mTasks.front().mWhen - theNow));
+                continue;
+            }
+
+            Task theTask = mTasks.front();
+            mTasks.pop_front();
+
+            theLock.unlock();
+            theTask.mWork(theTask.mContext);
+            theLock.lock();
+        }
+
+        theLock.unlock();
+        delete this;
+    }
+
+    const std::string           mLabel;
+    std::atomic<long>           mRetainCount;
+    std::mutex                  mMutex;
+    std::condition_variable     mCondition;
+    std::deque<Task>            mTasks;
+    bool                        mReleased = false;
+};
+
+dispatch_queue_t dispatch_queue_create(const char* label, void* attr)
+{
+    (void)attr;
+    return new dispatch_queue_s(label);
+}
+
+dispatch_queue_t dispatch_get_global_queue(long identifier, unsigned long flags)
+{
+    (void)flags;
+
+    // Never released, so the queues outlive the static objects that might still use them at exit.
+    static dispatch_queue_t sHigh = dispatch_queue_create("com.apple.root.high-priority", NULL);
+    static dispatch_queue_t sDefault = dispatch_queue_create("com.apple.root.default-priority", NULL);
+    static dispatch_queue_t sLow = dispatch_queue_create("com.apple.root.low-priority", NULL);
+
+    return (identifier > DISPATCH_QUEUE_PRIORITY_DEFAULT) ? sHigh :
+           (identifier < DISPATCH_QUEUE_PRIORITY_DEFAULT) ? sLow : sDefault;
+}
+
+dispatch_queue_t dispatch_get_main_queue(void)
+{
+    static dispatch_queue_t sMain = dispatch_queue_create("com.apple.main-thread", NULL);
+    return sMain;
+}
+
+void dispatch_async_f(dispatch_queue_t queue, void* context, dispatch_function_t work)
+{
+    queue->Submit(DISPATCH_TIME_NOW, context, work);
+}
+
+void dispatch_sync_f(dispatch_queue_t queue, void* context, dispatch_function_t work)
+{
+    struct SyncTask
+    {
+        void*                   mContext;
+        dispatch_function_t     mWork;
+        std::mutex              mMutex;
+        std::condition_variable mCondition;
+        bool                    mDone = false;
+    } theTask { context, work };
+
+    queue->Submit(DISPATCH_TIME_NOW, &theTask, [](void* inTask) {
+        SyncTask* theSyncTask = static_cast<SyncTask*>(inTask);
+        theSyncTask->mWork(theSyncTask->mContext);
+
+        std::lock_guard<std::mutex> theLock(theSyncTask->mMutex);
+        theSyncTask->mDone = true;
+        theSyncTask->mCondition.notify_one();
+    });
+
+    // As with libdispatch, this deadlocks if it's called on the queue's own thread.
+    std::unique_lock<std::mutex> theLock(theTask.mMutex);
+    theTask.mCondition.wait(theLock, [&theTask] { return theTask.mDone; });
+}
+
+void dispatch_after_f(dispatch_time_t when, dispatch_queue_t queue, void* context, dispatch_function_t work)
+{
+    queue->Submit(when, context, work);
+}
+
+dispatch_time_t dispatch_time(dispatch_time_t when, int64_t delta)
+{
+    if(when == DISPATCH_TIME_FOREVER)
+    {
+        return DISPATCH_TIME_FOREVER;
+    }
+
+    return ((when == DISPATCH_TIME_NOW) ? mach_absolute_time() : when) + delta;
+}
+
+void dispatch_once_f(dispatch_once_t* predicate, void* context, dispatch_function_t function)
+{
+    // dispatch_once_t is a long, so this can't use a std::once_flag in place. Every caller waits
+    // for the first one instead. The mutex is recursive because function can call this too.
+    static std::recursive_mutex sMutex;
+    std::lock_guard<std::recursive_mutex> theLock(sMutex);
+
+    if(*predicate == 0)
+    {
+        function(context);
+        *predicate = ~0l;
+    }
+}
+
+void dispatch_retain(void* object)
+{
+    static_cast<dispatch_queue_t>(object)->mRetainCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void dispatch_release(void* object)
+{
+    static_cast<dispatch_queue_t>(object)->Release();
+}
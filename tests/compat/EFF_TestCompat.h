@@ -0,0 +1,103 @@
+//
+//  EFF_TestCompat.h
+//  effervescence-tests
+//
+//  Created by Nerrons on 17/10/26.
+//  Copyright © 2026 nerrons. All rights reserved.
+//
+//  Force-included into every source file when the tests are built on a host without Apple's SDK.
+//  The other headers in this directory stand in for the parts of MacTypes.h, CoreAudio,
+//  CoreFoundation, dispatch, mach, libkern and Accelerate that the driver uses, so its classes can
+//  be built and tested unmodified. The *Compat.cpp files implement the functions they declare.
+//
+
+#ifndef EFF_TestCompat_h
+#define EFF_TestCompat_h
+
+#if defined(__APPLE__)
+#error "EFF_TestCompat.h is only for hosts without Apple's SDK"
+#endif
+
+// Clang's nullability qualifiers. GCC doesn't have them.
+#if !defined(__clang__)
+#define _Nullable
+#define _Nonnull
+#define _Null_unspecified
+#endif
+
+#define __nullable              _Nullable
+#define __null_unspecified      _Null_unspecified
+
+// Apple's SDK defines __nonnull as a nullability qualifier, but glibc already uses the name for a
+// function attribute macro. Include the glibc headers that use it first, so redefining it here
+// doesn't break them. (They're all include-guarded, so they won't be expanded again.)
+#if defined(__cplusplus)
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#undef __nonnull
+#define __nonnull               _Nonnull
+
+// From Apple's <sys/cdefs.h>.
+#if !defined(__printflike)
+#define __printflike(inFormatArg, inFirstVararg) __attribute__((__format__(__printf__, inFormatArg, inFirstVararg)))
+#endif
+
+// From Apple's <string.h>. glibc only has it from 2.38.
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char* outDestination, const char* inSource, size_t inSize)
+{
+    const size_t theLength = strlen(inSource);
+
+    if(inSize != 0)
+    {
+        const size_t theCopied = (theLength < inSize) ? theLength : (inSize - 1);
+        memcpy(outDestination, inSource, theCopied);
+        outDestination[theCopied] = '\0';
+    }
+
+    return theLength;
+}
+#endif
+
+// From Apple's <stdlib.h>. Unlike realloc, frees the old block if it can't be resized.
+static inline void* reallocf(void* inPointer, size_t inSize)
+{
+    void* theResult = realloc(inPointer, inSize);
+
+    if(theResult == NULL && inSize != 0)
+    {
+        free(inPointer);
+    }
+
+    return theResult;
+}
+
+#endif /* EFF_TestCompat_h */
+
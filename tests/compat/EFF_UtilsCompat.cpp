@@ -0,0 +1,60 @@
+//
+//  EFF_UtilsCompat.cpp
+//  effervescence-tests
+//
+//  Stand-in for SharedSource/EFF_Utils.cpp, which needs Mach, on hosts without Apple's SDK. Only
+//  defines LogAndSwallowExceptions, for the classes that call it from their destructors. The
+//  exceptions are printed to stderr and swallowed, as the real one does.
+//
+
+// Unit Include
+#include "EFF_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <cstdio>
+#include <exception>
+
+
+namespace EFF_Utils
+{
+
+    OSStatus LogAndSwallowExceptions(const char* __nullable fileName,
+                                     int lineNumber,
+                                     const char* callerName,
+                                     const std::function<void(void)>& function)
+    {
+        return LogAndSwallowExceptions(fileName, lineNumber, callerName, nullptr, function);
+    }
+
+    OSStatus LogAndSwallowExceptions(const char* __nullable fileName,
+                                     int lineNumber,
+                                     const char* callerName,
+                                     const char* __nullable message,
+                                     const std::function<void(void)>& function)
+    {
+        try
+        {
+            function();
+        }
+        catch(const CAException& e)
+        {
+            fprintf(stderr, "%s (%s:%d): CAException %d%s%s\n",
+                    callerName, fileName ? fileName : "", lineNumber, static_cast<int>(e.GetError()),
+                    message ? ": " : "", message ? message : "");
+            return e.GetError();
+        }
+        catch(...)
+        {
+            fprintf(stderr, "%s (%s:%d): Unknown exception%s%s\n",
+                    callerName, fileName ? fileName : "", lineNumber,
+                    message ? ": " : "", message ? message : "");
+            return -1;
+        }
+
+        return noErr;
+    }
+
+}
@@ -0,0 +1,34 @@
+//
+//  MacTypes.h
+//  effervescence-tests
+//
+//  Stand-in for Apple's MacTypes.h. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_MacTypes_h
+#define EFF_Compat_MacTypes_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t                 UInt8;
+typedef int8_t                  SInt8;
+typedef uint16_t                UInt16;
+typedef int16_t                 SInt16;
+typedef uint32_t                UInt32;
+typedef int32_t                 SInt32;
+typedef unsigned long long      UInt64;
+typedef signed long long        SInt64;
+typedef float                   Float32;
+typedef double                  Float64;
+typedef unsigned char           Boolean;
+typedef unsigned char           Byte;
+typedef UInt16                  UniChar;
+typedef SInt32                  OSStatus;
+typedef SInt16                  OSErr;
+typedef UInt32                  FourCharCode;
+typedef FourCharCode            OSType;
+
+enum { noErr = 0 };
+
+#endif /* EFF_Compat_MacTypes_h */
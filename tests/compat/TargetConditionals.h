@@ -0,0 +1,33 @@
+//
+//  TargetConditionals.h
+//  effervescence-tests
+//
+//  Stand-in for Apple's TargetConditionals.h. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_TargetConditionals_h
+#define EFF_Compat_TargetConditionals_h
+
+#define TARGET_OS_MAC           1
+#define TARGET_OS_IPHONE        0
+#define TARGET_OS_WIN32         0
+#define TARGET_API_MAC_CARBON   0
+#define TARGET_RT_BIG_ENDIAN    0
+#define TARGET_RT_LITTLE_ENDIAN 1
+#define TARGET_RT_64_BIT        1
+
+#if defined(__x86_64__)
+#define TARGET_CPU_X86_64       1
+#define TARGET_CPU_X86          0
+#define TARGET_CPU_ARM64        0
+#elif defined(__aarch64__)
+#define TARGET_CPU_X86_64       0
+#define TARGET_CPU_X86          0
+#define TARGET_CPU_ARM64        1
+#else
+#define TARGET_CPU_X86_64       0
+#define TARGET_CPU_X86          0
+#define TARGET_CPU_ARM64        0
+#endif
+
+#endif /* EFF_Compat_TargetConditionals_h */
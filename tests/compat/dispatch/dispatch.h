@@ -0,0 +1,69 @@
+//
+//  dispatch.h
+//  effervescence-tests
+//
+//  Stand-in for <dispatch/dispatch.h>. Declares the function-based queue API the driver and
+//  CADispatchQueue use, implemented by DispatchCompat.cpp, and the time constants from
+//  <dispatch/time.h>. Blocks aren't supported, so dispatch_block_t is only there for the
+//  declarations that mention it. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_dispatch_h
+#define EFF_Compat_dispatch_h
+
+#include <mach/port.h>
+#include <stdint.h>
+
+typedef struct dispatch_queue_s*    dispatch_queue_t;
+typedef struct dispatch_source_s*   dispatch_source_t;
+typedef struct dispatch_block_s*    dispatch_block_t;
+typedef void                        (*dispatch_function_t)(void*);
+typedef long                        dispatch_queue_priority_t;
+typedef long                        dispatch_once_t;
+typedef uint64_t                    dispatch_time_t;
+
+#define DISPATCH_QUEUE_PRIORITY_HIGH        2
+#define DISPATCH_QUEUE_PRIORITY_DEFAULT     0
+#define DISPATCH_QUEUE_PRIORITY_LOW         (-2)
+#define DISPATCH_QUEUE_PRIORITY_BACKGROUND  INT16_MIN
+
+#define DISPATCH_QUEUE_SERIAL               NULL
+
+#define DISPATCH_TIME_NOW                   (0ull)
+#define DISPATCH_TIME_FOREVER               (~0ull)
+
+#define NSEC_PER_SEC            1000000000ull
+#define NSEC_PER_MSEC           1000000ull
+#define USEC_PER_SEC            1000000ull
+#define NSEC_PER_USEC           1000ull
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Every queue, including the global ones, is serial and runs its tasks on its own thread.
+dispatch_queue_t    dispatch_queue_create(const char* label, void* attr);
+dispatch_queue_t    dispatch_get_global_queue(long identifier, unsigned long flags);
+dispatch_queue_t    dispatch_get_main_queue(void);
+
+void                dispatch_async_f(dispatch_queue_t queue, void* context, dispatch_function_t work);
+void                dispatch_sync_f(dispatch_queue_t queue, void* context, dispatch_function_t work);
+void                dispatch_after_f(dispatch_time_t when,
+                                     dispatch_queue_t queue,
+                                     void* context,
+                                     dispatch_function_t work);
+
+// Times are nanoseconds of mach_absolute_time, which the compat mach_time.h also counts in.
+dispatch_time_t     dispatch_time(dispatch_time_t when, int64_t delta);
+
+void                dispatch_once_f(dispatch_once_t* predicate, void* context, dispatch_function_t function);
+
+// Queues are the only dispatch objects that can be created here.
+void                dispatch_retain(void* object);
+void                dispatch_release(void* object);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* EFF_Compat_dispatch_h */
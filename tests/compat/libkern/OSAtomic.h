@@ -0,0 +1,108 @@
+//
+//  OSAtomic.h
+//  effervescence-tests
+//
+//  Stand-in for the deprecated <libkern/OSAtomic.h> functions CAAtomic.h wraps, on GCC's atomic
+//  builtins. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_OSAtomic_h
+#define EFF_Compat_OSAtomic_h
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int32_t                 OSSpinLock;
+
+static inline void OSMemoryBarrier(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicAdd32Barrier(int32_t theAmount, volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, theAmount, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicOr32Barrier(uint32_t theMask, volatile uint32_t* theValue)
+{
+    return (int32_t)__atomic_or_fetch(theValue, theMask, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicAnd32Barrier(uint32_t theMask, volatile uint32_t* theValue)
+{
+    return (int32_t)__atomic_and_fetch(theValue, theMask, __ATOMIC_SEQ_CST);
+}
+
+static inline bool OSAtomicCompareAndSwap32Barrier(int32_t oldValue, int32_t newValue, volatile int32_t* theValue)
+{
+    return __atomic_compare_exchange_n(theValue, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool OSAtomicCompareAndSwap64Barrier(int64_t oldValue, int64_t newValue, volatile int64_t* theValue)
+{
+    return __atomic_compare_exchange_n(theValue, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicIncrement32(volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t OSAtomicDecrement32(volatile int32_t* theValue)
+{
+    return __atomic_sub_fetch(theValue, 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t OSAtomicIncrement32Barrier(volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicDecrement32Barrier(volatile int32_t* theValue)
+{
+    return __atomic_sub_fetch(theValue, 1, __ATOMIC_SEQ_CST);
+}
+
+// Bits are numbered from the most significant bit of the first byte, as in libkern.
+static inline bool OSAtomicTestAndSetBarrier(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    const uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_or(theByte, theMask, __ATOMIC_SEQ_CST) & theMask) != 0;
+}
+
+static inline bool OSAtomicTestAndClearBarrier(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    const uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_and(theByte, (uint8_t)~theMask, __ATOMIC_SEQ_CST) & theMask) != 0;
+}
+
+static inline bool OSAtomicTestAndClear(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    const uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_and(theByte, (uint8_t)~theMask, __ATOMIC_RELAXED) & theMask) != 0;
+}
+
+static inline bool OSSpinLockTry(volatile OSSpinLock* theLock)
+{
+    return __atomic_exchange_n(theLock, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void OSSpinLockLock(volatile OSSpinLock* theLock)
+{
+    while(!OSSpinLockTry(theLock))
+    {
+        sched_yield();
+    }
+}
+
+static inline void OSSpinLockUnlock(volatile OSSpinLock* theLock)
+{
+    __atomic_store_n(theLock, 0, __ATOMIC_RELEASE);
+}
+
+#endif /* EFF_Compat_OSAtomic_h */
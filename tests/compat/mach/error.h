@@ -0,0 +1,16 @@
+//
+//  error.h
+//  effervescence-tests
+//
+//  Stand-in for <mach/error.h>. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_mach_error_h
+#define EFF_Compat_mach_error_h
+
+typedef int                     kern_return_t;
+typedef kern_return_t           mach_error_t;
+
+#define KERN_SUCCESS            0
+
+#endif /* EFF_Compat_mach_error_h */
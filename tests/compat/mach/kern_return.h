@@ -0,0 +1,13 @@
+//
+//  kern_return.h
+//  effervescence-tests
+//
+//  Stand-in for <mach/kern_return.h>. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_mach_kern_return_h
+#define EFF_Compat_mach_kern_return_h
+
+#include <mach/error.h>
+
+#endif /* EFF_Compat_mach_kern_return_h */
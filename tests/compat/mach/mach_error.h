@@ -0,0 +1,19 @@
+//
+//  mach_error.h
+//  effervescence-tests
+//
+//  Stand-in for <mach/mach_error.h>. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_mach_mach_error_h
+#define EFF_Compat_mach_mach_error_h
+
+#include <mach/error.h>
+
+static inline char* mach_error_string(mach_error_t error_value)
+{
+    (void)error_value;
+    return (char*)"(compat) unknown mach error";
+}
+
+#endif /* EFF_Compat_mach_mach_error_h */
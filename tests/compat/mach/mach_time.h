@@ -0,0 +1,48 @@
+//
+//  mach_time.h
+//  effervescence-tests
+//
+//  Stand-in for <mach/mach_time.h>, with nanosecond host time from the monotonic clock. See
+//  EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_mach_time_h
+#define EFF_Compat_mach_time_h
+
+#include <mach/error.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+struct mach_timebase_info
+{
+    uint32_t numer;
+    uint32_t denom;
+};
+typedef struct mach_timebase_info* mach_timebase_info_t;
+typedef struct mach_timebase_info mach_timebase_info_data_t;
+
+static inline kern_return_t mach_timebase_info(mach_timebase_info_t info)
+{
+    info->numer = 1;
+    info->denom = 1;
+    return KERN_SUCCESS;
+}
+
+static inline uint64_t mach_absolute_time(void)
+{
+    struct timespec theTime;
+    clock_gettime(CLOCK_MONOTONIC, &theTime);
+    return (uint64_t)theTime.tv_sec * 1000000000ull + (uint64_t)theTime.tv_nsec;
+}
+
+static inline kern_return_t mach_wait_until(uint64_t deadline)
+{
+    struct timespec theDeadline;
+    theDeadline.tv_sec = (time_t)(deadline / 1000000000ull);
+    theDeadline.tv_nsec = (long)(deadline % 1000000000ull);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &theDeadline, NULL) == EINTR) { }
+    return KERN_SUCCESS;
+}
+
+#endif /* EFF_Compat_mach_time_h */
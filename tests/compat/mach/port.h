@@ -0,0 +1,15 @@
+//
+//  port.h
+//  effervescence-tests
+//
+//  Stand-in for <mach/port.h>. Only the types CADispatchQueue.h mentions. See EFF_TestCompat.h.
+//
+
+#ifndef EFF_Compat_mach_port_h
+#define EFF_Compat_mach_port_h
+
+typedef unsigned int            mach_port_t;
+
+#define MACH_PORT_NULL          0
+
+#endif /* EFF_Compat_mach_port_h */